@@ -21,6 +21,8 @@
 
 #include <string.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
 
 #ifdef _WIN32
 #include <io.h>
@@ -339,3 +341,308 @@ dctool_file_read (const char *filename)
 
 	return buffer;
 }
+
+// The fingerprint store keeps the most recent fingerprints of every
+// known device in a single indexed file, so launching a download loads
+// one file instead of probing the cache directory per device.
+#define FPSTORE_MAGIC 0x44434650
+#define FPSTORE_MAXFP 8
+
+typedef struct fpstore_entry_t {
+	struct fpstore_entry_t *next;
+	unsigned int family;
+	unsigned int serial;
+	unsigned int count;
+	// The fingerprints, ordered from newest to oldest.
+	dc_buffer_t *fingerprints[FPSTORE_MAXFP];
+} fpstore_entry_t;
+
+struct dctool_fpstore_t {
+	char filename[1024];
+	char cachedir[1024];
+	// Protects the entries, so concurrent downloads can share the
+	// store.
+	pthread_mutex_t mutex;
+	fpstore_entry_t *entries;
+	unsigned int modified;
+};
+
+static unsigned int
+fpstore_uint32 (const unsigned char data[])
+{
+	return data[0] | (data[1] << 8) | (data[2] << 16) | (data[3] << 24);
+}
+
+static void
+fpstore_append_uint32 (dc_buffer_t *buffer, unsigned int value)
+{
+	unsigned char data[4] = {
+		value & 0xFF,
+		(value >> 8) & 0xFF,
+		(value >> 16) & 0xFF,
+		(value >> 24) & 0xFF};
+	dc_buffer_append (buffer, data, sizeof (data));
+}
+
+static void
+fpstore_entry_free (fpstore_entry_t *entry)
+{
+	if (entry == NULL)
+		return;
+
+	for (unsigned int i = 0; i < entry->count; ++i) {
+		dc_buffer_free (entry->fingerprints[i]);
+	}
+
+	free (entry);
+}
+
+static fpstore_entry_t *
+fpstore_find (dctool_fpstore_t *store, dc_family_t family, unsigned int serial)
+{
+	fpstore_entry_t *entry = store->entries;
+	while (entry) {
+		if (entry->family == (unsigned int) family && entry->serial == serial)
+			return entry;
+		entry = entry->next;
+	}
+
+	return NULL;
+}
+
+dctool_fpstore_t *
+dctool_fpstore_open (const char *cachedir)
+{
+	if (cachedir == NULL)
+		return NULL;
+
+	// Allocate the store.
+	dctool_fpstore_t *store = (dctool_fpstore_t *) calloc (1, sizeof (dctool_fpstore_t));
+	if (store == NULL)
+		return NULL;
+
+	pthread_mutex_init (&store->mutex, NULL);
+	snprintf (store->cachedir, sizeof (store->cachedir), "%s", cachedir);
+	snprintf (store->filename, sizeof (store->filename), "%s/fingerprints.dat",
+		cachedir);
+
+	// Read the entire store in a single operation. A missing or
+	// malformed file is not an error; the store starts out empty, and
+	// the entries are migrated from the legacy per-device files on
+	// first use.
+	dc_buffer_t *buffer = dctool_file_read (store->filename);
+	if (buffer == NULL)
+		return store;
+
+	const unsigned char *data = dc_buffer_get_data (buffer);
+	size_t size = dc_buffer_get_size (buffer);
+	size_t offset = 0;
+
+	if (size < 4 || fpstore_uint32 (data) != FPSTORE_MAGIC) {
+		dc_buffer_free (buffer);
+		return store;
+	}
+	offset += 4;
+
+	while (offset + 12 <= size) {
+		unsigned int family = fpstore_uint32 (data + offset + 0);
+		unsigned int serial = fpstore_uint32 (data + offset + 4);
+		unsigned int count  = fpstore_uint32 (data + offset + 8);
+		offset += 12;
+
+		if (count > FPSTORE_MAXFP)
+			break;
+
+		fpstore_entry_t *entry = (fpstore_entry_t *) calloc (1, sizeof (fpstore_entry_t));
+		if (entry == NULL)
+			break;
+
+		entry->family = family;
+		entry->serial = serial;
+
+		for (unsigned int i = 0; i < count; ++i) {
+			if (offset + 4 > size)
+				break;
+			unsigned int fsize = fpstore_uint32 (data + offset);
+			offset += 4;
+
+			if (fsize > size - offset)
+				break;
+
+			dc_buffer_t *fingerprint = dc_buffer_new (fsize);
+			if (fingerprint == NULL)
+				break;
+			dc_buffer_append (fingerprint, data + offset, fsize);
+			offset += fsize;
+
+			entry->fingerprints[entry->count++] = fingerprint;
+		}
+
+		if (entry->count != count) {
+			// Truncated record. Discard it and stop parsing.
+			fpstore_entry_free (entry);
+			break;
+		}
+
+		entry->next = store->entries;
+		store->entries = entry;
+	}
+
+	dc_buffer_free (buffer);
+
+	return store;
+}
+
+void
+dctool_fpstore_apply (dctool_fpstore_t *store, dc_device_t *device, unsigned int serial)
+{
+	if (store == NULL || device == NULL)
+		return;
+
+	dc_family_t family = dc_device_get_type (device);
+
+	pthread_mutex_lock (&store->mutex);
+
+	fpstore_entry_t *entry = fpstore_find (store, family, serial);
+	if (entry == NULL) {
+		// Migrate the legacy per-device fingerprint file into the
+		// store.
+		char filename[1024] = {0};
+		snprintf (filename, sizeof (filename), "%s/%s-%08X.bin",
+			store->cachedir, dctool_family_name (family), serial);
+
+		dc_buffer_t *fingerprint = dctool_file_read (filename);
+		if (fingerprint && dc_buffer_get_size (fingerprint)) {
+			entry = (fpstore_entry_t *) calloc (1, sizeof (fpstore_entry_t));
+			if (entry) {
+				entry->family = family;
+				entry->serial = serial;
+				entry->count = 1;
+				entry->fingerprints[0] = fingerprint;
+				entry->next = store->entries;
+				store->entries = entry;
+				store->modified = 1;
+				fingerprint = NULL;
+			}
+		}
+		dc_buffer_free (fingerprint);
+	}
+
+	// Register the most recent fingerprint as the stop condition, and
+	// the older ones as additional known fingerprints, so the download
+	// can also short-circuit on dives that re-appeared after a
+	// ringbuffer wraparound. Without an entry, the registered
+	// fingerprint is cleared.
+	if (entry) {
+		dc_device_set_fingerprint (device,
+			dc_buffer_get_data (entry->fingerprints[0]),
+			dc_buffer_get_size (entry->fingerprints[0]));
+		for (unsigned int i = 1; i < entry->count; ++i) {
+			dc_device_add_fingerprint (device,
+				dc_buffer_get_data (entry->fingerprints[i]),
+				dc_buffer_get_size (entry->fingerprints[i]));
+		}
+	} else {
+		dc_device_set_fingerprint (device, NULL, 0);
+	}
+
+	pthread_mutex_unlock (&store->mutex);
+}
+
+void
+dctool_fpstore_update (dctool_fpstore_t *store, dc_family_t family, unsigned int serial, dc_buffer_t *fingerprint)
+{
+	if (store == NULL || fingerprint == NULL || dc_buffer_get_size (fingerprint) == 0)
+		return;
+
+	pthread_mutex_lock (&store->mutex);
+
+	fpstore_entry_t *entry = fpstore_find (store, family, serial);
+	if (entry == NULL) {
+		entry = (fpstore_entry_t *) calloc (1, sizeof (fpstore_entry_t));
+		if (entry == NULL)
+			goto out;
+		entry->family = family;
+		entry->serial = serial;
+		entry->next = store->entries;
+		store->entries = entry;
+	}
+
+	// Already the most recent fingerprint?
+	if (entry->count &&
+		dc_buffer_get_size (entry->fingerprints[0]) == dc_buffer_get_size (fingerprint) &&
+		memcmp (dc_buffer_get_data (entry->fingerprints[0]),
+			dc_buffer_get_data (fingerprint),
+			dc_buffer_get_size (fingerprint)) == 0)
+		goto out;
+
+	// Copy the fingerprint.
+	dc_buffer_t *copy = dc_buffer_new (dc_buffer_get_size (fingerprint));
+	if (copy == NULL)
+		goto out;
+	dc_buffer_append (copy,
+		dc_buffer_get_data (fingerprint),
+		dc_buffer_get_size (fingerprint));
+
+	// Insert at the front, pushing out the oldest fingerprint when
+	// the entry is full.
+	if (entry->count == FPSTORE_MAXFP) {
+		dc_buffer_free (entry->fingerprints[FPSTORE_MAXFP - 1]);
+		entry->count--;
+	}
+	for (unsigned int i = entry->count; i > 0; --i) {
+		entry->fingerprints[i] = entry->fingerprints[i - 1];
+	}
+	entry->fingerprints[0] = copy;
+	entry->count++;
+	store->modified = 1;
+
+out:
+	pthread_mutex_unlock (&store->mutex);
+}
+
+void
+dctool_fpstore_close (dctool_fpstore_t *store)
+{
+	if (store == NULL)
+		return;
+
+	if (store->modified) {
+		// Serialize the entries.
+		dc_buffer_t *buffer = dc_buffer_new (4096);
+		fpstore_append_uint32 (buffer, FPSTORE_MAGIC);
+		fpstore_entry_t *entry = store->entries;
+		while (entry) {
+			fpstore_append_uint32 (buffer, entry->family);
+			fpstore_append_uint32 (buffer, entry->serial);
+			fpstore_append_uint32 (buffer, entry->count);
+			for (unsigned int i = 0; i < entry->count; ++i) {
+				fpstore_append_uint32 (buffer, dc_buffer_get_size (entry->fingerprints[i]));
+				dc_buffer_append (buffer,
+					dc_buffer_get_data (entry->fingerprints[i]),
+					dc_buffer_get_size (entry->fingerprints[i]));
+			}
+			entry = entry->next;
+		}
+
+		// Write to a temporary file, and move it into place, so a
+		// crash or a concurrent reader never observes a partially
+		// written store.
+		char tmpname[1024 + 8] = {0};
+		snprintf (tmpname, sizeof (tmpname), "%s.tmp", store->filename);
+		dctool_file_write (tmpname, buffer);
+		rename (tmpname, store->filename);
+
+		dc_buffer_free (buffer);
+	}
+
+	fpstore_entry_t *entry = store->entries;
+	while (entry) {
+		fpstore_entry_t *next = entry->next;
+		fpstore_entry_free (entry);
+		entry = next;
+	}
+
+	pthread_mutex_destroy (&store->mutex);
+	free (store);
+}
@@ -26,6 +26,8 @@
 #include <libdivecomputer/descriptor.h>
 #include <libdivecomputer/device.h>
 
+#include "output.h"
+
 #ifdef __cplusplus
 extern "C" {
 #endif /* __cplusplus */
@@ -57,6 +59,33 @@ dctool_file_write (const char *filename, dc_buffer_t *buffer);
 dc_buffer_t *
 dctool_file_read (const char *filename);
 
+/*
+ * The fingerprint store holds the most recent fingerprints of every
+ * known device in a single indexed file in the cache directory. The
+ * store is loaded once when opened, consulted by device serial when
+ * the devinfo event arrives, and written back atomically when closed.
+ * Besides the most recent fingerprint, the older ones are registered
+ * with dc_device_add_fingerprint, so a download can also short-circuit
+ * on dives that re-appear after a ringbuffer wraparound. The store can
+ * be shared between concurrent downloads.
+ */
+typedef struct dctool_fpstore_t dctool_fpstore_t;
+
+dctool_fpstore_t *
+dctool_fpstore_open (const char *cachedir);
+
+void
+dctool_fpstore_apply (dctool_fpstore_t *store, dc_device_t *device, unsigned int serial);
+
+void
+dctool_fpstore_update (dctool_fpstore_t *store, dc_family_t family, unsigned int serial, dc_buffer_t *fingerprint);
+
+void
+dctool_fpstore_close (dctool_fpstore_t *store);
+
+dc_status_t
+dctool_download_device (dc_context_t *context, dc_descriptor_t *descriptor, const char *devname, const char *cachedir, dc_buffer_t *fingerprint, dctool_output_t *output);
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
@@ -60,10 +60,15 @@ static const dctool_command_t *g_commands[] = {
 	&dctool_list,
 	&dctool_download,
 	&dctool_dump,
+	&dctool_dumpdiff,
 	&dctool_parse,
 	&dctool_read,
 	&dctool_write,
 	&dctool_fwupdate,
+	&dctool_bench,
+	&dctool_corpus,
+	&dctool_generate,
+	&dctool_watch,
 	NULL
 };
 
@@ -274,12 +279,15 @@ main (int argc, char *argv[])
 	dc_context_set_loglevel (context, loglevel);
 	dc_context_set_logfunc (context, logfunc, NULL);
 
-	if (command->config & DCTOOL_CONFIG_DESCRIPTOR) {
+	if (command->config & (DCTOOL_CONFIG_DESCRIPTOR | DCTOOL_CONFIG_DESCRIPTOR_OPTIONAL)) {
 		// Check mandatory arguments.
 		if (device == NULL && family == DC_FAMILY_NULL) {
-			message ("No device name or family type specified.\n");
-			exitcode = EXIT_FAILURE;
-			goto cleanup;
+			if (command->config & DCTOOL_CONFIG_DESCRIPTOR) {
+				message ("No device name or family type specified.\n");
+				exitcode = EXIT_FAILURE;
+				goto cleanup;
+			}
+			goto nodescriptor;
 		}
 
 		// Search for a matching device descriptor.
@@ -303,6 +311,8 @@ main (int argc, char *argv[])
 		}
 	}
 
+nodescriptor:
+
 	// Execute the command.
 	exitcode = command->run (argc, argv, context, descriptor);
 
@@ -32,6 +32,10 @@ extern "C" {
 typedef enum dctool_config_t {
 	DCTOOL_CONFIG_NONE = 0,
 	DCTOOL_CONFIG_DESCRIPTOR = 1,
+	/* The descriptor is used when one is specified on the command
+	 * line, but the command can also run without one (e.g. with a
+	 * fixtures manifest that binds its own descriptors). */
+	DCTOOL_CONFIG_DESCRIPTOR_OPTIONAL = 2,
 } dctool_config_t;
 
 typedef struct dctool_command_t {
@@ -47,10 +51,15 @@ extern const dctool_command_t dctool_version;
 extern const dctool_command_t dctool_list;
 extern const dctool_command_t dctool_download;
 extern const dctool_command_t dctool_dump;
+extern const dctool_command_t dctool_dumpdiff;
 extern const dctool_command_t dctool_parse;
 extern const dctool_command_t dctool_read;
 extern const dctool_command_t dctool_write;
 extern const dctool_command_t dctool_fwupdate;
+extern const dctool_command_t dctool_bench;
+extern const dctool_command_t dctool_corpus;
+extern const dctool_command_t dctool_generate;
+extern const dctool_command_t dctool_watch;
 
 const dctool_command_t *
 dctool_command_find (const char *name);
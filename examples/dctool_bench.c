@@ -0,0 +1,230 @@
+/*
+ * libdivecomputer
+ *
+ * Copyright (C) 2015 Jef Driesen
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#ifdef HAVE_GETOPT_H
+#include <getopt.h>
+#endif
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <time.h>
+#include <sys/time.h>
+#endif
+
+#include <libdivecomputer/context.h>
+#include <libdivecomputer/descriptor.h>
+#include <libdivecomputer/parser.h>
+
+#include "dctool.h"
+#include "common.h"
+#include "utils.h"
+
+static double
+timestamp (void)
+{
+#ifdef _WIN32
+	LARGE_INTEGER frequency, counter;
+	QueryPerformanceFrequency (&frequency);
+	QueryPerformanceCounter (&counter);
+	return (double) counter.QuadPart / frequency.QuadPart;
+#else
+	struct timespec ts;
+	clock_gettime (CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+#endif
+}
+
+static void
+count_cb (dc_sample_type_t type, dc_sample_value_t value, void *userdata)
+{
+	unsigned long *count = (unsigned long *) userdata;
+
+	(*count)++;
+}
+
+static dc_status_t
+benchmark (dc_buffer_t *buffer, dc_context_t *context, dc_descriptor_t *descriptor, unsigned int iterations, unsigned long *nsamples, double *elapsed)
+{
+	dc_status_t rc = DC_STATUS_SUCCESS;
+	dc_parser_t *parser = NULL;
+	unsigned char *data = dc_buffer_get_data (buffer);
+	unsigned int size = dc_buffer_get_size (buffer);
+	unsigned long count = 0;
+
+	// Create the parser.
+	rc = dc_parser_new2 (&parser, context, descriptor, 0, 0);
+	if (rc != DC_STATUS_SUCCESS) {
+		ERROR ("Error creating the parser.");
+		return rc;
+	}
+
+	double start = timestamp ();
+
+	for (unsigned int i = 0; i < iterations; ++i) {
+		// Register the data.
+		rc = dc_parser_set_data (parser, data, size);
+		if (rc != DC_STATUS_SUCCESS) {
+			ERROR ("Error registering the data.");
+			goto cleanup;
+		}
+
+		// Decode all samples.
+		rc = dc_parser_samples_foreach (parser, count_cb, &count);
+		if (rc != DC_STATUS_SUCCESS) {
+			ERROR ("Error parsing the sample data.");
+			goto cleanup;
+		}
+	}
+
+	*elapsed = timestamp () - start;
+	*nsamples = count;
+
+cleanup:
+	dc_parser_destroy (parser);
+	return rc;
+}
+
+static int
+dctool_bench_run (int argc, char *argv[], dc_context_t *context, dc_descriptor_t *descriptor)
+{
+	// Default values.
+	int exitcode = EXIT_SUCCESS;
+	dc_status_t status = DC_STATUS_SUCCESS;
+	dc_buffer_t *buffer = NULL;
+
+	// Default option values.
+	unsigned int help = 0;
+	unsigned int iterations = 100;
+
+	// Parse the command-line options.
+	int opt = 0;
+	const char *optstring = "hn:";
+#ifdef HAVE_GETOPT_LONG
+	struct option options[] = {
+		{"help",       no_argument,       0, 'h'},
+		{"iterations", required_argument, 0, 'n'},
+		{0,            0,                 0,  0 }
+	};
+	while ((opt = getopt_long (argc, argv, optstring, options, NULL)) != -1) {
+#else
+	while ((opt = getopt (argc, argv, optstring)) != -1) {
+#endif
+		switch (opt) {
+		case 'h':
+			help = 1;
+			break;
+		case 'n':
+			iterations = strtoul (optarg, NULL, 0);
+			break;
+		default:
+			return EXIT_FAILURE;
+		}
+	}
+
+	argc -= optind;
+	argv += optind;
+
+	// Show help message.
+	if (help) {
+		dctool_command_showhelp (&dctool_bench);
+		return EXIT_SUCCESS;
+	}
+
+	if (iterations == 0)
+		iterations = 1;
+
+	unsigned long long total_bytes = 0;
+	unsigned long long total_samples = 0;
+	double total_elapsed = 0.0;
+
+	for (unsigned int i = 0; i < argc; ++i) {
+		// Read the input file.
+		buffer = dctool_file_read (argv[i]);
+		if (buffer == NULL) {
+			message ("Failed to open the input file.\n");
+			exitcode = EXIT_FAILURE;
+			goto cleanup;
+		}
+
+		// Benchmark the parser.
+		unsigned long nsamples = 0;
+		double elapsed = 0.0;
+		status = benchmark (buffer, context, descriptor, iterations, &nsamples, &elapsed);
+		if (status != DC_STATUS_SUCCESS) {
+			message ("ERROR: %s\n", dctool_errmsg (status));
+			exitcode = EXIT_FAILURE;
+			goto cleanup;
+		}
+
+		unsigned int size = dc_buffer_get_size (buffer);
+
+		printf ("%s: %u bytes, %lu samples, %u iterations, %.3f s, %.0f samples/s, %.2f MB/s\n",
+			argv[i], size, nsamples / iterations, iterations, elapsed,
+			elapsed > 0.0 ? nsamples / elapsed : 0.0,
+			elapsed > 0.0 ? ((double) size * iterations) / elapsed / (1024.0 * 1024.0) : 0.0);
+
+		total_bytes += (unsigned long long) size * iterations;
+		total_samples += nsamples;
+		total_elapsed += elapsed;
+
+		// Cleanup.
+		dc_buffer_free (buffer);
+		buffer = NULL;
+	}
+
+	if (total_elapsed > 0.0) {
+		printf ("total: %.3f s, %.0f samples/s, %.2f MB/s\n",
+			total_elapsed,
+			total_samples / total_elapsed,
+			total_bytes / total_elapsed / (1024.0 * 1024.0));
+	}
+
+cleanup:
+	dc_buffer_free (buffer);
+	return exitcode;
+}
+
+const dctool_command_t dctool_bench = {
+	dctool_bench_run,
+	DCTOOL_CONFIG_DESCRIPTOR,
+	"bench",
+	"Benchmark parsing of previously downloaded dives",
+	"Usage:\n"
+	"   dctool bench [options] <filename>\n"
+	"\n"
+	"Options:\n"
+#ifdef HAVE_GETOPT_LONG
+	"   -h, --help                Show help message\n"
+	"   -n, --iterations <count>  Number of iterations per file\n"
+#else
+	"   -h            Show help message\n"
+	"   -n <count>    Number of iterations per file\n"
+#endif
+};
@@ -0,0 +1,927 @@
+/*
+ * libdivecomputer
+ *
+ * Copyright (C) 2015 Jef Driesen
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdlib.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#ifdef HAVE_GETOPT_H
+#include <getopt.h>
+#endif
+
+#include <libdivecomputer/context.h>
+#include <libdivecomputer/descriptor.h>
+#include <libdivecomputer/parser.h>
+
+#include "dctool.h"
+#include "common.h"
+#include "utils.h"
+
+/*
+ * The corpus runner parses an archive of raw dives and reduces every
+ * dive to a canonical hash of its datetime, fields and samples. The
+ * hashes are written as a manifest (one line per file), and a manifest
+ * produced with a previous build can be passed back as a baseline, so
+ * a library upgrade is validated by re-running the corpus and diffing
+ * the manifests instead of inspecting full parser output.
+ *
+ * The hash is FNV-1a over the decoded values (not the output text), so
+ * it is independent of formatting, but sensitive to any change in the
+ * decoded data. A file that fails to parse is recorded with the error
+ * code in place of the hash, so a new failure or a new success shows
+ * up as a difference too.
+ */
+
+#define HASH_INIT 14695981039346656037ULL
+
+typedef unsigned long long hash_t;
+
+static hash_t
+hash_data (hash_t hash, const void *data, size_t size)
+{
+	const unsigned char *bytes = (const unsigned char *) data;
+	for (size_t i = 0; i < size; ++i) {
+		hash ^= bytes[i];
+		hash *= 1099511628211ULL;
+	}
+	return hash;
+}
+
+static hash_t
+hash_uint (hash_t hash, unsigned int value)
+{
+	unsigned char data[4];
+	data[0] = (value      ) & 0xFF;
+	data[1] = (value >>  8) & 0xFF;
+	data[2] = (value >> 16) & 0xFF;
+	data[3] = (value >> 24) & 0xFF;
+	return hash_data (hash, data, sizeof (data));
+}
+
+static hash_t
+hash_double (hash_t hash, double value)
+{
+	unsigned char data[sizeof (double)];
+	memcpy (data, &value, sizeof (data));
+	return hash_data (hash, data, sizeof (data));
+}
+
+static void
+sample_cb (dc_sample_type_t type, dc_sample_value_t value, void *userdata)
+{
+	hash_t *hash = (hash_t *) userdata;
+
+	// Hash only the active union member, to avoid the uninitialized
+	// padding of the smaller members.
+	*hash = hash_uint (*hash, type);
+	switch (type) {
+	case DC_SAMPLE_TIME:
+		*hash = hash_uint (*hash, value.time);
+		break;
+	case DC_SAMPLE_DEPTH:
+		*hash = hash_double (*hash, value.depth);
+		break;
+	case DC_SAMPLE_PRESSURE:
+		*hash = hash_uint (*hash, value.pressure.tank);
+		*hash = hash_double (*hash, value.pressure.value);
+		break;
+	case DC_SAMPLE_TEMPERATURE:
+		*hash = hash_double (*hash, value.temperature);
+		break;
+	case DC_SAMPLE_EVENT:
+		*hash = hash_uint (*hash, value.event.type);
+		*hash = hash_uint (*hash, value.event.time);
+		*hash = hash_uint (*hash, value.event.flags);
+		*hash = hash_uint (*hash, value.event.value);
+		break;
+	case DC_SAMPLE_RBT:
+		*hash = hash_uint (*hash, value.rbt);
+		break;
+	case DC_SAMPLE_HEARTBEAT:
+		*hash = hash_uint (*hash, value.heartbeat);
+		break;
+	case DC_SAMPLE_BEARING:
+		*hash = hash_uint (*hash, value.bearing);
+		break;
+	case DC_SAMPLE_VENDOR:
+		*hash = hash_uint (*hash, value.vendor.type);
+		*hash = hash_uint (*hash, value.vendor.size);
+		*hash = hash_data (*hash, value.vendor.data, value.vendor.size);
+		break;
+	case DC_SAMPLE_SETPOINT:
+		*hash = hash_double (*hash, value.setpoint);
+		break;
+	case DC_SAMPLE_PPO2:
+		*hash = hash_double (*hash, value.ppo2);
+		break;
+	case DC_SAMPLE_CNS:
+		*hash = hash_double (*hash, value.cns);
+		break;
+	case DC_SAMPLE_DECO:
+		*hash = hash_uint (*hash, value.deco.type);
+		*hash = hash_uint (*hash, value.deco.time);
+		*hash = hash_double (*hash, value.deco.depth);
+		break;
+	case DC_SAMPLE_GASMIX:
+		*hash = hash_uint (*hash, value.gasmix);
+		break;
+	default:
+		break;
+	}
+}
+
+/*
+ * Hash a field, with a presence marker so a field that becomes
+ * (un)supported changes the hash too. Any error other than
+ * DC_STATUS_UNSUPPORTED aborts the file.
+ */
+static dc_status_t
+hash_field (dc_parser_t *parser, dc_field_type_t type, unsigned int flags, void *value, size_t size, hash_t *hash)
+{
+	dc_status_t rc = dc_parser_get_field (parser, type, flags, value);
+	if (rc == DC_STATUS_SUCCESS) {
+		*hash = hash_uint (*hash, 1);
+		*hash = hash_data (*hash, value, size);
+	} else if (rc == DC_STATUS_UNSUPPORTED) {
+		*hash = hash_uint (*hash, 0);
+		rc = DC_STATUS_SUCCESS;
+	}
+	return rc;
+}
+
+static dc_status_t
+corpus_hash (dc_parser_t *parser, dc_buffer_t *buffer, hash_t *out)
+{
+	dc_status_t rc = DC_STATUS_SUCCESS;
+	hash_t hash = HASH_INIT;
+
+	// Register the data.
+	rc = dc_parser_set_data (parser,
+		dc_buffer_get_data (buffer), dc_buffer_get_size (buffer));
+	if (rc != DC_STATUS_SUCCESS)
+		return rc;
+
+	// Hash the datetime.
+	dc_datetime_t dt = {0};
+	rc = dc_parser_get_datetime (parser, &dt);
+	if (rc == DC_STATUS_SUCCESS) {
+		hash = hash_uint (hash, 1);
+		hash = hash_uint (hash, dt.year);
+		hash = hash_uint (hash, dt.month);
+		hash = hash_uint (hash, dt.day);
+		hash = hash_uint (hash, dt.hour);
+		hash = hash_uint (hash, dt.minute);
+		hash = hash_uint (hash, dt.second);
+	} else if (rc == DC_STATUS_UNSUPPORTED) {
+		hash = hash_uint (hash, 0);
+	} else {
+		goto cleanup;
+	}
+
+	// Hash the scalar fields.
+	unsigned int divetime = 0;
+	double maxdepth = 0.0, avgdepth = 0.0, atmospheric = 0.0;
+	double temperature = 0.0;
+	dc_salinity_t salinity = {DC_WATER_FRESH, 0.0};
+	dc_divemode_t divemode = DC_DIVEMODE_OC;
+	if ((rc = hash_field (parser, DC_FIELD_DIVETIME, 0, &divetime, sizeof (divetime), &hash)) != DC_STATUS_SUCCESS ||
+		(rc = hash_field (parser, DC_FIELD_MAXDEPTH, 0, &maxdepth, sizeof (maxdepth), &hash)) != DC_STATUS_SUCCESS ||
+		(rc = hash_field (parser, DC_FIELD_AVGDEPTH, 0, &avgdepth, sizeof (avgdepth), &hash)) != DC_STATUS_SUCCESS ||
+		(rc = hash_field (parser, DC_FIELD_ATMOSPHERIC, 0, &atmospheric, sizeof (atmospheric), &hash)) != DC_STATUS_SUCCESS ||
+		(rc = hash_field (parser, DC_FIELD_SALINITY, 0, &salinity, sizeof (salinity), &hash)) != DC_STATUS_SUCCESS ||
+		(rc = hash_field (parser, DC_FIELD_TEMPERATURE_SURFACE, 0, &temperature, sizeof (temperature), &hash)) != DC_STATUS_SUCCESS ||
+		(rc = hash_field (parser, DC_FIELD_TEMPERATURE_MINIMUM, 0, &temperature, sizeof (temperature), &hash)) != DC_STATUS_SUCCESS ||
+		(rc = hash_field (parser, DC_FIELD_TEMPERATURE_MAXIMUM, 0, &temperature, sizeof (temperature), &hash)) != DC_STATUS_SUCCESS ||
+		(rc = hash_field (parser, DC_FIELD_DIVEMODE, 0, &divemode, sizeof (divemode), &hash)) != DC_STATUS_SUCCESS)
+		goto cleanup;
+
+	// Hash the gas mixes.
+	unsigned int ngasmixes = 0;
+	rc = dc_parser_get_field (parser, DC_FIELD_GASMIX_COUNT, 0, &ngasmixes);
+	if (rc != DC_STATUS_SUCCESS && rc != DC_STATUS_UNSUPPORTED)
+		goto cleanup;
+	if (rc == DC_STATUS_UNSUPPORTED)
+		ngasmixes = 0;
+	hash = hash_uint (hash, ngasmixes);
+	for (unsigned int i = 0; i < ngasmixes; ++i) {
+		dc_gasmix_t gasmix = {0};
+		rc = dc_parser_get_field (parser, DC_FIELD_GASMIX, i, &gasmix);
+		if (rc != DC_STATUS_SUCCESS)
+			goto cleanup;
+		hash = hash_double (hash, gasmix.helium);
+		hash = hash_double (hash, gasmix.oxygen);
+		hash = hash_double (hash, gasmix.nitrogen);
+	}
+
+	// Hash the tanks.
+	unsigned int ntanks = 0;
+	rc = dc_parser_get_field (parser, DC_FIELD_TANK_COUNT, 0, &ntanks);
+	if (rc != DC_STATUS_SUCCESS && rc != DC_STATUS_UNSUPPORTED)
+		goto cleanup;
+	if (rc == DC_STATUS_UNSUPPORTED)
+		ntanks = 0;
+	hash = hash_uint (hash, ntanks);
+	for (unsigned int i = 0; i < ntanks; ++i) {
+		dc_tank_t tank = {0};
+		rc = dc_parser_get_field (parser, DC_FIELD_TANK, i, &tank);
+		if (rc != DC_STATUS_SUCCESS)
+			goto cleanup;
+		hash = hash_uint (hash, tank.gasmix);
+		hash = hash_uint (hash, tank.type);
+		hash = hash_double (hash, tank.volume);
+		hash = hash_double (hash, tank.workpressure);
+		hash = hash_double (hash, tank.beginpressure);
+		hash = hash_double (hash, tank.endpressure);
+	}
+
+	// Hash the samples.
+	rc = dc_parser_samples_foreach (parser, sample_cb, &hash);
+	if (rc != DC_STATUS_SUCCESS)
+		goto cleanup;
+
+	*out = hash;
+	rc = DC_STATUS_SUCCESS;
+
+cleanup:
+	dc_parser_reset (parser);
+	return rc;
+}
+
+typedef struct filelist_t {
+	char **names;
+	unsigned int count;
+	unsigned int capacity;
+} filelist_t;
+
+static int
+filelist_add (filelist_t *files, const char *name)
+{
+	if (files->count >= files->capacity) {
+		unsigned int capacity = files->capacity ? 2 * files->capacity : 64;
+		char **names = (char **) realloc (files->names, capacity * sizeof (char *));
+		if (names == NULL)
+			return 0;
+		files->names = names;
+		files->capacity = capacity;
+	}
+
+	files->names[files->count] = strdup (name);
+	if (files->names[files->count] == NULL)
+		return 0;
+	files->count++;
+
+	return 1;
+}
+
+static int
+filelist_compare (const void *a, const void *b)
+{
+	return strcmp (* (char * const *) a, * (char * const *) b);
+}
+
+/*
+ * Expand an argument into the file list. Unlike the expansion in the
+ * parse command, directories are walked recursively, so an entire
+ * archive tree can be passed as a single argument. The entries of each
+ * directory are visited in sorted order, for a reproducible manifest.
+ */
+static int
+filelist_expand (filelist_t *files, const char *path)
+{
+	struct stat st;
+	if (stat (path, &st) != 0) {
+		message ("Failed to open the input file: %s\n", path);
+		return 0;
+	}
+
+	if (!S_ISDIR (st.st_mode))
+		return filelist_add (files, path);
+
+	DIR *dir = opendir (path);
+	if (dir == NULL) {
+		message ("Failed to open the directory: %s\n", path);
+		return 0;
+	}
+
+	// Collect and sort the directory entries.
+	filelist_t entries = {0};
+	struct dirent *entry = NULL;
+	while ((entry = readdir (dir)) != NULL) {
+		if (strcmp (entry->d_name, ".") == 0 || strcmp (entry->d_name, "..") == 0)
+			continue;
+		if (!filelist_add (&entries, entry->d_name)) {
+			closedir (dir);
+			goto error;
+		}
+	}
+	closedir (dir);
+
+	qsort (entries.names, entries.count, sizeof (char *), filelist_compare);
+
+	// Expand the entries, recursing into subdirectories.
+	for (unsigned int i = 0; i < entries.count; ++i) {
+		char filename[1024] = {0};
+		snprintf (filename, sizeof (filename), "%s/%s", path, entries.names[i]);
+
+		if (stat (filename, &st) != 0)
+			continue;
+
+		if (S_ISDIR (st.st_mode)) {
+			if (!filelist_expand (files, filename))
+				goto error;
+		} else if (S_ISREG (st.st_mode)) {
+			if (!filelist_add (files, filename))
+				goto error;
+		}
+	}
+
+	for (unsigned int i = 0; i < entries.count; ++i)
+		free (entries.names[i]);
+	free (entries.names);
+	return 1;
+
+error:
+	for (unsigned int i = 0; i < entries.count; ++i)
+		free (entries.names[i]);
+	free (entries.names);
+	return 0;
+}
+
+static void
+filelist_free (filelist_t *files)
+{
+	for (unsigned int i = 0; i < files->count; ++i)
+		free (files->names[i]);
+	free (files->names);
+}
+
+/*
+ * A fixtures manifest binds every image to its device descriptor, so a
+ * single corpus run can cover images from multiple families. Each line
+ * holds a device name (in the same "vendor product" form as the -d
+ * option) and a path, separated by a tab; the path is relative to the
+ * manifest, and a directory binds its entire tree to the device. Blank
+ * lines and lines starting with '#' are ignored.
+ */
+typedef struct fixtures_t {
+	// One descriptor per input file, aligned with the file list.
+	dc_descriptor_t **descriptors;
+	unsigned int count;
+	unsigned int capacity;
+	// The unique descriptors owned by the manifest.
+	dc_descriptor_t **owned;
+	unsigned int nowned;
+	unsigned int ocapacity;
+} fixtures_t;
+
+static int
+fixtures_assign (fixtures_t *fixtures, unsigned int count, dc_descriptor_t *descriptor)
+{
+	if (count > fixtures->capacity) {
+		unsigned int capacity = fixtures->capacity ? 2 * fixtures->capacity : 64;
+		while (capacity < count)
+			capacity *= 2;
+		dc_descriptor_t **descriptors = (dc_descriptor_t **) realloc (
+			fixtures->descriptors, capacity * sizeof (dc_descriptor_t *));
+		if (descriptors == NULL)
+			return 0;
+		fixtures->descriptors = descriptors;
+		fixtures->capacity = capacity;
+	}
+
+	// Fill the slots up to the new file count. Slots belonging to
+	// files that entered the list outside the manifest stay NULL.
+	while (fixtures->count < count)
+		fixtures->descriptors[fixtures->count++] = descriptor;
+
+	return 1;
+}
+
+static int
+fixtures_read (const char *filename, filelist_t *files, fixtures_t *fixtures)
+{
+	FILE *fp = fopen (filename, "r");
+	if (fp == NULL) {
+		message ("Failed to open the fixtures manifest: %s\n", filename);
+		return 0;
+	}
+
+	// The entry paths are relative to the manifest.
+	char prefix[1024] = {0};
+	const char *sep = strrchr (filename, '/');
+	if (sep) {
+		size_t n = sep - filename + 1;
+		if (n >= sizeof (prefix))
+			n = sizeof (prefix) - 1;
+		memcpy (prefix, filename, n);
+	}
+
+	// Fill the slots of the files that are already in the list.
+	if (!fixtures_assign (fixtures, files->count, NULL)) {
+		fclose (fp);
+		return 0;
+	}
+
+	dc_descriptor_t *descriptor = NULL;
+	char name[256] = {0};
+	char line[1100];
+	unsigned int lineno = 0;
+	while (fgets (line, sizeof (line), fp)) {
+		lineno++;
+		line[strcspn (line, "\r\n")] = 0;
+		if (line[0] == 0 || line[0] == '#')
+			continue;
+
+		char *tab = strchr (line, '\t');
+		if (tab == NULL) {
+			message ("Invalid fixtures entry at line %u: %s\n", lineno, line);
+			goto error;
+		}
+		*tab = 0;
+
+		// Resolve the device name, caching the previous lookup since
+		// the entries of a device are usually consecutive.
+		if (descriptor == NULL || strcmp (name, line) != 0) {
+			dc_descriptor_t *current = NULL;
+			if (dctool_descriptor_search (&current, line, DC_FAMILY_NULL, 0) != DC_STATUS_SUCCESS ||
+				current == NULL) {
+				message ("No supported device found at line %u: %s\n", lineno, line);
+				goto error;
+			}
+			if (fixtures->nowned >= fixtures->ocapacity) {
+				unsigned int capacity = fixtures->ocapacity ? 2 * fixtures->ocapacity : 8;
+				dc_descriptor_t **owned = (dc_descriptor_t **) realloc (
+					fixtures->owned, capacity * sizeof (dc_descriptor_t *));
+				if (owned == NULL) {
+					dc_descriptor_free (current);
+					goto error;
+				}
+				fixtures->owned = owned;
+				fixtures->ocapacity = capacity;
+			}
+			fixtures->owned[fixtures->nowned++] = current;
+			descriptor = current;
+			snprintf (name, sizeof (name), "%s", line);
+		}
+
+		char path[1400] = {0};
+		snprintf (path, sizeof (path), "%s%s", prefix, tab + 1);
+		if (!filelist_expand (files, path))
+			goto error;
+
+		// Bind the expanded files to the descriptor.
+		if (!fixtures_assign (fixtures, files->count, descriptor))
+			goto error;
+	}
+
+	fclose (fp);
+	return 1;
+
+error:
+	fclose (fp);
+	return 0;
+}
+
+static void
+fixtures_free (fixtures_t *fixtures)
+{
+	for (unsigned int i = 0; i < fixtures->nowned; ++i)
+		dc_descriptor_free (fixtures->owned[i]);
+	free (fixtures->owned);
+	free (fixtures->descriptors);
+}
+
+typedef struct result_t {
+	hash_t hash;
+	dc_status_t status;
+} result_t;
+
+typedef struct corpus_t {
+	pthread_mutex_t mutex;
+	const filelist_t *files;
+	unsigned int next;
+	dc_context_t *context;
+	dc_descriptor_t *descriptor;
+	// Per-file descriptors from a fixtures manifest; a NULL entry (or
+	// an index past the array) selects the command line descriptor.
+	dc_descriptor_t **descriptors;
+	unsigned int ndescriptors;
+	result_t *results;
+	int errors;
+} corpus_t;
+
+static void *
+corpus_worker (void *arg)
+{
+	corpus_t *corpus = (corpus_t *) arg;
+	dc_parser_t *parser = NULL;
+	dc_descriptor_t *active = NULL;
+
+	while (1) {
+		// Claim the next file.
+		pthread_mutex_lock (&corpus->mutex);
+		unsigned int i = corpus->next++;
+		pthread_mutex_unlock (&corpus->mutex);
+		if (i >= corpus->files->count)
+			break;
+
+		// The parser is created lazily and reused for consecutive
+		// files with the same descriptor. The fixtures manifests group
+		// their files per device, so switching remains rare.
+		dc_descriptor_t *descriptor = corpus->descriptor;
+		if (corpus->descriptors && i < corpus->ndescriptors && corpus->descriptors[i])
+			descriptor = corpus->descriptors[i];
+		if (parser == NULL || descriptor != active) {
+			dc_parser_destroy (parser);
+			parser = NULL;
+			if (dc_parser_new2 (&parser, corpus->context, descriptor, 0, 0) != DC_STATUS_SUCCESS) {
+				corpus->results[i].status = DC_STATUS_UNSUPPORTED;
+				continue;
+			}
+			active = descriptor;
+		}
+
+		// Read and hash the file. A failing file is recorded in the
+		// manifest (so it still participates in the diff), but does
+		// not stop the run.
+		dc_buffer_t *buffer = dctool_file_read (corpus->files->names[i]);
+		if (buffer == NULL) {
+			corpus->results[i].status = DC_STATUS_IO;
+			continue;
+		}
+
+		corpus->results[i].status = corpus_hash (parser, buffer,
+			&corpus->results[i].hash);
+
+		dc_buffer_free (buffer);
+	}
+
+	dc_parser_destroy (parser);
+	return NULL;
+}
+
+/*
+ * Write one manifest line. A file that failed to parse gets the error
+ * code in place of the hash, so failures are diffable too.
+ */
+static void
+manifest_write (FILE *fp, const result_t *result, const char *name)
+{
+	if (result->status == DC_STATUS_SUCCESS) {
+		fprintf (fp, "%016llX %s\n", result->hash, name);
+	} else {
+		fprintf (fp, "ERROR%d %s\n", result->status, name);
+	}
+}
+
+typedef struct baseline_t {
+	char **names;
+	char **hashes;
+	unsigned int count;
+	unsigned int capacity;
+} baseline_t;
+
+static int
+baseline_read (baseline_t *baseline, const char *filename)
+{
+	FILE *fp = fopen (filename, "r");
+	if (fp == NULL) {
+		message ("Failed to open the baseline file: %s\n", filename);
+		return 0;
+	}
+
+	char line[1100];
+	while (fgets (line, sizeof (line), fp)) {
+		line[strcspn (line, "\r\n")] = 0;
+		char *sep = strchr (line, ' ');
+		if (sep == NULL)
+			continue;
+		*sep = 0;
+
+		if (baseline->count >= baseline->capacity) {
+			unsigned int capacity = baseline->capacity ? 2 * baseline->capacity : 64;
+			char **names = (char **) realloc (baseline->names, capacity * sizeof (char *));
+			char **hashes = (char **) realloc (baseline->hashes, capacity * sizeof (char *));
+			if (names)
+				baseline->names = names;
+			if (hashes)
+				baseline->hashes = hashes;
+			if (names == NULL || hashes == NULL) {
+				fclose (fp);
+				return 0;
+			}
+			baseline->capacity = capacity;
+		}
+
+		baseline->hashes[baseline->count] = strdup (line);
+		baseline->names[baseline->count] = strdup (sep + 1);
+		if (baseline->hashes[baseline->count] == NULL ||
+			baseline->names[baseline->count] == NULL) {
+			fclose (fp);
+			return 0;
+		}
+		baseline->count++;
+	}
+
+	fclose (fp);
+	return 1;
+}
+
+static const char *
+baseline_lookup (const baseline_t *baseline, const char *name)
+{
+	for (unsigned int i = 0; i < baseline->count; ++i) {
+		if (strcmp (baseline->names[i], name) == 0)
+			return baseline->hashes[i];
+	}
+	return NULL;
+}
+
+static void
+baseline_free (baseline_t *baseline)
+{
+	for (unsigned int i = 0; i < baseline->count; ++i) {
+		free (baseline->names[i]);
+		free (baseline->hashes[i]);
+	}
+	free (baseline->names);
+	free (baseline->hashes);
+}
+
+static int
+dctool_corpus_run (int argc, char *argv[], dc_context_t *context, dc_descriptor_t *descriptor)
+{
+	// Default values.
+	int exitcode = EXIT_SUCCESS;
+	filelist_t files = {0};
+	fixtures_t fixtures = {0};
+	result_t *results = NULL;
+	pthread_t *threads = NULL;
+	FILE *ostream = NULL;
+
+	// Default option values.
+	unsigned int help = 0;
+	unsigned int njobs = 1;
+	const char *filename = NULL;
+	const char *baselinename = NULL;
+	const char *fixturesname = NULL;
+
+	// Parse the command-line options.
+	int opt = 0;
+	const char *optstring = "ho:b:j:f:";
+#ifdef HAVE_GETOPT_LONG
+	struct option options[] = {
+		{"help",     no_argument,       0, 'h'},
+		{"output",   required_argument, 0, 'o'},
+		{"baseline", required_argument, 0, 'b'},
+		{"jobs",     required_argument, 0, 'j'},
+		{"fixtures", required_argument, 0, 'f'},
+		{0,          0,                 0,  0 }
+	};
+	while ((opt = getopt_long (argc, argv, optstring, options, NULL)) != -1) {
+#else
+	while ((opt = getopt (argc, argv, optstring)) != -1) {
+#endif
+		switch (opt) {
+		case 'h':
+			help = 1;
+			break;
+		case 'o':
+			filename = optarg;
+			break;
+		case 'b':
+			baselinename = optarg;
+			break;
+		case 'j':
+			njobs = strtoul (optarg, NULL, 0);
+			break;
+		case 'f':
+			fixturesname = optarg;
+			break;
+		default:
+			return EXIT_FAILURE;
+		}
+	}
+
+	argc -= optind;
+	argv += optind;
+
+	// Show help message.
+	if (help) {
+		dctool_command_showhelp (&dctool_corpus);
+		return EXIT_SUCCESS;
+	}
+
+	// Build the list of input files. The files given as arguments are
+	// parsed with the command line descriptor; the files of a fixtures
+	// manifest bring their own.
+	if (argc > 0 && descriptor == NULL) {
+		message ("No device name or family type specified.\n");
+		exitcode = EXIT_FAILURE;
+		goto cleanup;
+	}
+	for (unsigned int i = 0; i < argc; ++i) {
+		if (!filelist_expand (&files, argv[i])) {
+			exitcode = EXIT_FAILURE;
+			goto cleanup;
+		}
+	}
+	if (fixturesname) {
+		if (!fixtures_read (fixturesname, &files, &fixtures)) {
+			exitcode = EXIT_FAILURE;
+			goto cleanup;
+		}
+	}
+
+	if (files.count == 0) {
+		message ("No input files.\n");
+		exitcode = EXIT_FAILURE;
+		goto cleanup;
+	}
+
+	// Hash the files on multiple threads. Every worker claims files
+	// from the shared list with its own parser; the results land in a
+	// pre-allocated slot per file, so the manifest order is independent
+	// of the thread scheduling.
+	results = (result_t *) calloc (files.count, sizeof (result_t));
+	if (results == NULL) {
+		message ("Failed to allocate the results.\n");
+		exitcode = EXIT_FAILURE;
+		goto cleanup;
+	}
+
+	if (njobs < 1)
+		njobs = 1;
+	if (njobs > files.count)
+		njobs = files.count;
+
+	corpus_t corpus = {PTHREAD_MUTEX_INITIALIZER};
+	corpus.files = &files;
+	corpus.context = context;
+	corpus.descriptor = descriptor;
+	corpus.descriptors = fixtures.descriptors;
+	corpus.ndescriptors = fixtures.count;
+	corpus.results = results;
+
+	threads = (pthread_t *) calloc (njobs, sizeof (pthread_t));
+	if (threads == NULL) {
+		message ("Failed to allocate the workers.\n");
+		exitcode = EXIT_FAILURE;
+		goto cleanup;
+	}
+
+	unsigned int started = 0;
+	for (unsigned int i = 0; i < njobs; ++i) {
+		if (pthread_create (&threads[i], NULL, corpus_worker, &corpus) != 0)
+			break;
+		started++;
+	}
+	for (unsigned int i = 0; i < started; ++i)
+		pthread_join (threads[i], NULL);
+
+	if (started == 0 || corpus.errors) {
+		message ("Failed to run the corpus.\n");
+		exitcode = EXIT_FAILURE;
+		goto cleanup;
+	}
+
+	// Write the manifest.
+	ostream = stdout;
+	if (filename) {
+		ostream = fopen (filename, "w");
+		if (ostream == NULL) {
+			message ("Failed to open the output file: %s\n", filename);
+			ostream = NULL;
+			exitcode = EXIT_FAILURE;
+			goto cleanup;
+		}
+	}
+	for (unsigned int i = 0; i < files.count; ++i) {
+		manifest_write (ostream, results + i, files.names[i]);
+	}
+	if (ostream != stdout) {
+		fclose (ostream);
+	}
+	ostream = NULL;
+
+	// Diff against the baseline.
+	if (baselinename) {
+		baseline_t baseline = {0};
+		if (!baseline_read (&baseline, baselinename)) {
+			baseline_free (&baseline);
+			exitcode = EXIT_FAILURE;
+			goto cleanup;
+		}
+
+		unsigned int nchanged = 0, nnew = 0, nmissing = 0;
+
+		for (unsigned int i = 0; i < files.count; ++i) {
+			char current[32];
+			if (results[i].status == DC_STATUS_SUCCESS) {
+				snprintf (current, sizeof (current), "%016llX", results[i].hash);
+			} else {
+				snprintf (current, sizeof (current), "ERROR%d", results[i].status);
+			}
+
+			const char *previous = baseline_lookup (&baseline, files.names[i]);
+			if (previous == NULL) {
+				printf ("NEW %s\n", files.names[i]);
+				nnew++;
+			} else if (strcmp (previous, current) != 0) {
+				printf ("CHANGED %s (%s -> %s)\n", files.names[i], previous, current);
+				nchanged++;
+			}
+		}
+
+		for (unsigned int i = 0; i < baseline.count; ++i) {
+			unsigned int found = 0;
+			for (unsigned int j = 0; j < files.count; ++j) {
+				if (strcmp (baseline.names[i], files.names[j]) == 0) {
+					found = 1;
+					break;
+				}
+			}
+			if (!found) {
+				printf ("MISSING %s\n", baseline.names[i]);
+				nmissing++;
+			}
+		}
+
+		printf ("%u files, %u changed, %u new, %u missing\n",
+			files.count, nchanged, nnew, nmissing);
+
+		if (nchanged || nnew || nmissing)
+			exitcode = EXIT_FAILURE;
+
+		baseline_free (&baseline);
+	}
+
+cleanup:
+	if (ostream && ostream != stdout)
+		fclose (ostream);
+	free (threads);
+	free (results);
+	fixtures_free (&fixtures);
+	filelist_free (&files);
+	return exitcode;
+}
+
+const dctool_command_t dctool_corpus = {
+	dctool_corpus_run,
+	DCTOOL_CONFIG_DESCRIPTOR_OPTIONAL,
+	"corpus",
+	"Hash an archive of dives and diff against a baseline manifest",
+	"Usage:\n"
+	"   dctool corpus [options] <filename|directory> ...\n"
+	"\n"
+	"Options:\n"
+#ifdef HAVE_GETOPT_LONG
+	"   -h, --help                 Show help message\n"
+	"   -o, --output <filename>    Manifest output filename (default stdout)\n"
+	"   -b, --baseline <filename>  Diff against a baseline manifest\n"
+	"   -j, --jobs <number>        Number of parallel jobs\n"
+	"   -f, --fixtures <filename>  Add the files of a fixtures manifest\n"
+#else
+	"   -h              Show help message\n"
+	"   -o <filename>   Manifest output filename (default stdout)\n"
+	"   -b <filename>   Diff against a baseline manifest\n"
+	"   -j <number>     Number of parallel jobs\n"
+	"   -f <filename>   Add the files of a fixtures manifest\n"
+#endif
+	"\n"
+	"Every dive is reduced to a canonical hash of its decoded datetime,\n"
+	"fields and samples. Directories are walked recursively in sorted\n"
+	"order. With a baseline manifest (produced by an earlier run), the\n"
+	"differences are reported and the exit code is non-zero when any\n"
+	"file changed, appeared or disappeared.\n"
+	"\n"
+	"The files given as arguments are parsed with the descriptor from\n"
+	"the -d option. A fixtures manifest (see fixtures/README) instead\n"
+	"binds every image to its own device, so one run can cover images\n"
+	"from multiple families.\n"
+};
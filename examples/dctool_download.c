@@ -27,6 +27,7 @@
 #include <unistd.h>
 #include <stdio.h>
 #include <string.h>
+#include <pthread.h>
 #ifdef HAVE_GETOPT_H
 #include <getopt.h>
 #endif
@@ -34,6 +35,7 @@
 #include <libdivecomputer/context.h>
 #include <libdivecomputer/descriptor.h>
 #include <libdivecomputer/device.h>
+#include <libdivecomputer/download.h>
 #include <libdivecomputer/parser.h>
 
 #include "dctool.h"
@@ -41,18 +43,79 @@
 #include "output.h"
 #include "utils.h"
 
-typedef struct event_data_t {
-	const char *cachedir;
-	dc_event_devinfo_t devinfo;
-} event_data_t;
-
 typedef struct dive_data_t {
 	dc_device_t *device;
 	dc_buffer_t **fingerprint;
 	unsigned int number;
 	dctool_output_t *output;
+	const char *label;
+	// Session journal, see journal_open.
+	FILE *journal;
+	char journalname[1024];
 } dive_data_t;
 
+typedef struct event_data_t {
+	dctool_fpstore_t *fpstore;
+	const char *cachedir;
+	dive_data_t *divedata;
+	dc_event_devinfo_t devinfo;
+} event_data_t;
+
+// The session journal records the fingerprint of every dive that has
+// been written to the output, one hex line per dive, flushed per dive.
+// When a session is interrupted, the journal is left behind, and the
+// next session registers the journaled fingerprints as known dives, so
+// the dives already saved are not downloaded again. A completed
+// session removes its journal; the fingerprint store covers it from
+// then on.
+static void
+journal_open (dive_data_t *divedata, const char *cachedir, dc_device_t *device, unsigned int serial)
+{
+	if (cachedir == NULL)
+		return;
+
+	snprintf (divedata->journalname, sizeof (divedata->journalname), "%s/%s-%08X.journal",
+		cachedir, dctool_family_name (dc_device_get_type (device)), serial);
+
+	// Resume an interrupted session.
+	FILE *fp = fopen (divedata->journalname, "r");
+	if (fp) {
+		unsigned int count = 0;
+		char line[256];
+		while (fgets (line, sizeof (line), fp)) {
+			line[strcspn (line, "\r\n")] = 0;
+			dc_buffer_t *fingerprint = dctool_convert_hex2bin (line);
+			if (fingerprint == NULL)
+				continue;
+			dc_device_add_fingerprint (device,
+				dc_buffer_get_data (fingerprint),
+				dc_buffer_get_size (fingerprint));
+			dc_buffer_free (fingerprint);
+			count++;
+		}
+		fclose (fp);
+
+		if (count) {
+			message ("Resuming the previous session (%u dives already saved).\n", count);
+		}
+	}
+
+	divedata->journal = fopen (divedata->journalname, "a");
+}
+
+static void
+journal_finish (dive_data_t *divedata, int success)
+{
+	if (divedata->journal) {
+		fclose (divedata->journal);
+		divedata->journal = NULL;
+	}
+
+	if (success && divedata->journalname[0]) {
+		remove (divedata->journalname);
+	}
+}
+
 static int
 dive_cb (const unsigned char *data, unsigned int size, const unsigned char *fingerprint, unsigned int fsize, void *userdata)
 {
@@ -62,6 +125,8 @@ dive_cb (const unsigned char *data, unsigned int size, const unsigned char *fing
 
 	divedata->number++;
 
+	if (divedata->label)
+		message ("[%s] ", divedata->label);
 	message ("Dive: number=%u, size=%u, fingerprint=", divedata->number, size);
 	for (unsigned int i = 0; i < fsize; ++i)
 		message ("%02X", fingerprint[i]);
@@ -100,11 +165,111 @@ dive_cb (const unsigned char *data, unsigned int size, const unsigned char *fing
 		goto cleanup;
 	}
 
+	// Journal the saved dive, so an interrupted session can resume
+	// without downloading it again. The output writers flush per dive,
+	// so the dive is on disk before it is journaled.
+	if (divedata->journal && fingerprint) {
+		for (unsigned int i = 0; i < fsize; ++i)
+			fprintf (divedata->journal, "%02X", fingerprint[i]);
+		fprintf (divedata->journal, "\n");
+		fflush (divedata->journal);
+	}
+
 cleanup:
 	dc_parser_destroy (parser);
 	return 1;
 }
 
+// The maximum number of dives buffered between the download and the
+// parsing thread. The bound keeps a slow parser from accumulating an
+// entire download in memory.
+#define PIPELINE_QUEUE 4
+
+typedef struct dive_t {
+	struct dive_t *next;
+	unsigned int size;
+	unsigned int fsize;
+	// The dive data, followed by the fingerprint data.
+	unsigned char data[1];
+} dive_t;
+
+typedef struct pipeline_t {
+	pthread_mutex_t mutex;
+	pthread_cond_t cond;
+	dive_t *head, *tail;
+	unsigned int count;
+	int done;
+	dive_data_t *divedata;
+} pipeline_t;
+
+static void *
+pipeline_worker (void *arg)
+{
+	pipeline_t *pipeline = (pipeline_t *) arg;
+
+	while (1) {
+		// Wait for the next dive, or the end of the download.
+		pthread_mutex_lock (&pipeline->mutex);
+		while (pipeline->head == NULL && !pipeline->done)
+			pthread_cond_wait (&pipeline->cond, &pipeline->mutex);
+		dive_t *dive = pipeline->head;
+		if (dive) {
+			pipeline->head = dive->next;
+			if (pipeline->head == NULL)
+				pipeline->tail = NULL;
+			pipeline->count--;
+			pthread_cond_signal (&pipeline->cond);
+		}
+		pthread_mutex_unlock (&pipeline->mutex);
+
+		if (dive == NULL)
+			break; // Queue drained and download finished.
+
+		dive_cb (dive->data, dive->size,
+			dive->fsize ? dive->data + dive->size : NULL, dive->fsize,
+			pipeline->divedata);
+		free (dive);
+	}
+
+	return NULL;
+}
+
+static int
+pipeline_dive_cb (const unsigned char *data, unsigned int size, const unsigned char *fingerprint, unsigned int fsize, void *userdata)
+{
+	pipeline_t *pipeline = (pipeline_t *) userdata;
+
+	// Copy the dive and fingerprint data. The buffers passed to the
+	// callback are only valid for the duration of the call.
+	dive_t *dive = (dive_t *) malloc (sizeof (dive_t) + size + fsize);
+	if (dive == NULL) {
+		ERROR ("Error allocating the dive buffer.");
+		return 0;
+	}
+	dive->next = NULL;
+	dive->size = size;
+	dive->fsize = fsize;
+	if (size)
+		memcpy (dive->data, data, size);
+	if (fsize)
+		memcpy (dive->data + size, fingerprint, fsize);
+
+	// Queue the dive, blocking while the queue is full.
+	pthread_mutex_lock (&pipeline->mutex);
+	while (pipeline->count >= PIPELINE_QUEUE)
+		pthread_cond_wait (&pipeline->cond, &pipeline->mutex);
+	if (pipeline->tail)
+		pipeline->tail->next = dive;
+	else
+		pipeline->head = dive;
+	pipeline->tail = dive;
+	pipeline->count++;
+	pthread_cond_signal (&pipeline->cond);
+	pthread_mutex_unlock (&pipeline->mutex);
+
+	return 1;
+}
+
 static void
 event_cb (dc_device_t *device, dc_event_type_t event, const void *data, void *userdata)
 {
@@ -117,33 +282,20 @@ event_cb (dc_device_t *device, dc_event_type_t event, const void *data, void *us
 
 	switch (event) {
 	case DC_EVENT_DEVINFO:
-		// Load the fingerprint from the cache. If there is no
-		// fingerprint present in the cache, a NULL buffer is returned,
-		// and the registered fingerprint will be cleared.
-		if (eventdata->cachedir) {
-			char filename[1024] = {0};
-			dc_family_t family = DC_FAMILY_NULL;
-			dc_buffer_t *fingerprint = NULL;
-
-			// Generate the fingerprint filename.
-			family = dc_device_get_type (device);
-			snprintf (filename, sizeof (filename), "%s/%s-%08X.bin",
-				eventdata->cachedir, dctool_family_name (family), devinfo->serial);
-
-			// Read the fingerprint file.
-			fingerprint = dctool_file_read (filename);
-
-			// Register the fingerprint data.
-			dc_device_set_fingerprint (device,
-				dc_buffer_get_data (fingerprint),
-				dc_buffer_get_size (fingerprint));
+		// Register the known fingerprints from the store. If there is
+		// no entry for the device, the registered fingerprint will be
+		// cleared.
+		if (eventdata->fpstore) {
+			dctool_fpstore_apply (eventdata->fpstore, device, devinfo->serial);
+		}
 
-			// Free the buffer again.
-			dc_buffer_free (fingerprint);
+		// Open the session journal, resuming an interrupted session.
+		if (eventdata->divedata) {
+			journal_open (eventdata->divedata, eventdata->cachedir, device, devinfo->serial);
 		}
 
-		// Keep a copy of the event data. It will be used for generating
-		// the fingerprint filename again after a (successful) download.
+		// Keep a copy of the event data. It will be used for updating
+		// the fingerprint store after a (successful) download.
 		eventdata->devinfo = *devinfo;
 		break;
 	default:
@@ -151,12 +303,18 @@ event_cb (dc_device_t *device, dc_event_type_t event, const void *data, void *us
 	}
 }
 
-static dc_status_t
-download (dc_context_t *context, dc_descriptor_t *descriptor, const char *devname, const char *cachedir, dc_buffer_t *fingerprint, dctool_output_t *output)
+dc_status_t
+dctool_download_device (dc_context_t *context, dc_descriptor_t *descriptor, const char *devname, const char *cachedir, dc_buffer_t *fingerprint, dctool_output_t *output)
 {
 	dc_status_t rc = DC_STATUS_SUCCESS;
 	dc_device_t *device = NULL;
 	dc_buffer_t *ofingerprint = NULL;
+	dive_data_t divedata = {0};
+
+	// Open the fingerprint store. The entire store is loaded with a
+	// single read, instead of probing the cache directory during the
+	// download setup.
+	dctool_fpstore_t *fpstore = dctool_fpstore_open (cachedir);
 
 	// Open the device.
 	message ("Opening the device (%s %s, %s).\n",
@@ -169,13 +327,16 @@ download (dc_context_t *context, dc_descriptor_t *descriptor, const char *devnam
 		goto cleanup;
 	}
 
-	// Initialize the event data.
+	// Initialize the event data. With an explicit fingerprint on the
+	// command-line, the store is not consulted.
 	event_data_t eventdata = {0};
 	if (fingerprint) {
-		eventdata.cachedir = NULL;
+		eventdata.fpstore = NULL;
 	} else {
-		eventdata.cachedir = cachedir;
+		eventdata.fpstore = fpstore;
 	}
+	eventdata.cachedir = cachedir;
+	eventdata.divedata = &divedata;
 
 	// Register the event handler.
 	message ("Registering the event handler.\n");
@@ -205,40 +366,250 @@ download (dc_context_t *context, dc_descriptor_t *descriptor, const char *devnam
 	}
 
 	// Initialize the dive data.
-	dive_data_t divedata = {0};
 	divedata.device = device;
 	divedata.fingerprint = &ofingerprint;
 	divedata.number = 0;
 	divedata.output = output;
 
-	// Download the dives.
+	// Download the dives. The parsing and output run on a separate
+	// thread, fed through a small bounded queue, so the serial link
+	// does not idle while a dive is being parsed and written.
 	message ("Downloading the dives.\n");
-	rc = dc_device_foreach (device, dive_cb, &divedata);
+	pipeline_t pipeline = {PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER};
+	pipeline.divedata = &divedata;
+	pthread_t worker;
+	if (pthread_create (&worker, NULL, pipeline_worker, &pipeline) == 0) {
+		rc = dc_device_foreach (device, pipeline_dive_cb, &pipeline);
+
+		// Signal the end of the download, and wait for the worker to
+		// drain the queue.
+		pthread_mutex_lock (&pipeline.mutex);
+		pipeline.done = 1;
+		pthread_cond_signal (&pipeline.cond);
+		pthread_mutex_unlock (&pipeline.mutex);
+		pthread_join (worker, NULL);
+	} else {
+		// Fall back to parsing the dives inline.
+		rc = dc_device_foreach (device, dive_cb, &divedata);
+	}
 	if (rc != DC_STATUS_SUCCESS) {
 		ERROR ("Error downloading the dives.");
 		goto cleanup;
 	}
 
 	// Store the fingerprint data.
-	if (cachedir && ofingerprint) {
-		char filename[1024] = {0};
-		dc_family_t family = DC_FAMILY_NULL;
-
-		// Generate the fingerprint filename.
-		family = dc_device_get_type (device);
-		snprintf (filename, sizeof (filename), "%s/%s-%08X.bin",
-			cachedir, dctool_family_name (family), eventdata.devinfo.serial);
-
-		// Write the fingerprint file.
-		dctool_file_write (filename, ofingerprint);
+	if (fpstore && ofingerprint) {
+		dctool_fpstore_update (fpstore, dc_device_get_type (device), eventdata.devinfo.serial, ofingerprint);
 	}
 
 cleanup:
+	journal_finish (&divedata, rc == DC_STATUS_SUCCESS);
+	dctool_fpstore_close (fpstore);
 	dc_buffer_free (ofingerprint);
 	dc_device_close (device);
 	return rc;
 }
 
+static dctool_output_t *
+dctool_output_create (const char *format, const char *filename, dctool_units_t units)
+{
+	if (strcasecmp(format, "raw") == 0) {
+		return dctool_raw_output_new (filename);
+	} else if (strcasecmp(format, "xml") == 0) {
+		return dctool_xml_output_new (filename, units);
+	} else if (strcasecmp(format, "bin") == 0) {
+		return dctool_bin_output_new (filename);
+	} else if (strcasecmp(format, "archive") == 0) {
+		return dctool_archive_output_new (filename);
+	} else {
+		message ("Unknown output format: %s\n", format);
+		return NULL;
+	}
+}
+
+typedef struct download_job_t {
+	dc_descriptor_t *descriptor; // Owned when parsed from the argument.
+	const char *devname;
+	dctool_fpstore_t *fpstore; // Shared between all jobs.
+	const char *cachedir;
+	dc_family_t family;
+	dc_event_devinfo_t devinfo;
+	dc_buffer_t *ofingerprint;
+	dive_data_t divedata;
+	dctool_output_t *output;
+	dc_status_t status;
+} download_job_t;
+
+static void
+job_event_cb (dc_device_t *device, dc_event_type_t event, const void *data, void *userdata)
+{
+	const dc_event_progress_t *progress = (const dc_event_progress_t *) data;
+	const dc_event_devinfo_t *devinfo = (const dc_event_devinfo_t *) data;
+
+	download_job_t *job = (download_job_t *) userdata;
+
+	// Capture the device handle. It is needed to create the parser in
+	// the dive callback, and the events are guaranteed to arrive
+	// before the dives.
+	job->divedata.device = device;
+
+	switch (event) {
+	case DC_EVENT_WAITING:
+		message ("[%s] Event: waiting for user action\n", job->devname);
+		break;
+	case DC_EVENT_PROGRESS:
+		message ("[%s] Event: progress %3.2f%% (%u/%u)\n", job->devname,
+			100.0 * (double) progress->current / (double) progress->maximum,
+			progress->current, progress->maximum);
+		break;
+	case DC_EVENT_DEVINFO:
+		message ("[%s] Event: model=%u (0x%08x), firmware=%u (0x%08x), serial=%u (0x%08x)\n",
+			job->devname,
+			devinfo->model, devinfo->model,
+			devinfo->firmware, devinfo->firmware,
+			devinfo->serial, devinfo->serial);
+
+		// Register the known fingerprints from the store.
+		if (job->fpstore) {
+			dctool_fpstore_apply (job->fpstore, device, devinfo->serial);
+		}
+
+		// Open the session journal, resuming an interrupted session.
+		journal_open (&job->divedata, job->cachedir, device, devinfo->serial);
+
+		// Keep a copy of the event data, for updating the fingerprint
+		// store after a (successful) download.
+		job->family = dc_device_get_type (device);
+		job->devinfo = *devinfo;
+		break;
+	default:
+		break;
+	}
+}
+
+static int
+job_dive_cb (const unsigned char *data, unsigned int size, const unsigned char *fingerprint, unsigned int fsize, void *userdata)
+{
+	download_job_t *job = (download_job_t *) userdata;
+
+	return dive_cb (data, size, fingerprint, fsize, &job->divedata);
+}
+
+static void
+job_finished_cb (dc_status_t status, void *userdata)
+{
+	download_job_t *job = (download_job_t *) userdata;
+
+	job->status = status;
+
+	message ("[%s] Finished: %s\n", job->devname, dctool_errmsg (status));
+}
+
+static dc_status_t
+download_multi (dc_context_t *context, dc_descriptor_t *descriptor, unsigned int njobs,
+	int argc, char *argv[], const char *cachedir, const char *filename,
+	const char *format, dctool_units_t units)
+{
+	dc_status_t rc = DC_STATUS_SUCCESS;
+	dc_download_t *download = NULL;
+	download_job_t *jobs = NULL;
+	unsigned int count = argc;
+
+	jobs = (download_job_t *) calloc (count, sizeof (download_job_t));
+	if (jobs == NULL) {
+		ERROR ("Error allocating the download jobs.");
+		return DC_STATUS_NOMEMORY;
+	}
+
+	// Open the fingerprint store, shared between all jobs.
+	dctool_fpstore_t *fpstore = dctool_fpstore_open (cachedir);
+
+	// Create the download session.
+	rc = dc_download_new (&download, context);
+	if (rc != DC_STATUS_SUCCESS) {
+		ERROR ("Error creating the download session.");
+		goto cleanup;
+	}
+
+	for (unsigned int i = 0; i < count; ++i) {
+		download_job_t *job = jobs + i;
+
+		// Each argument is a device name, optionally prefixed with its
+		// own device description ("<device>=<devname>"). Without a
+		// prefix, the device specified on the command-line is used.
+		char *separator = strchr (argv[i], '=');
+		if (separator) {
+			*separator = 0;
+			rc = dctool_descriptor_search (&job->descriptor, argv[i], DC_FAMILY_NULL, 0);
+			if (rc != DC_STATUS_SUCCESS || job->descriptor == NULL) {
+				message ("No supported device found: %s\n", argv[i]);
+				rc = DC_STATUS_UNSUPPORTED;
+				goto cleanup;
+			}
+			job->devname = separator + 1;
+		} else {
+			job->devname = argv[i];
+		}
+		job->fpstore = fpstore;
+		job->cachedir = cachedir;
+
+		// Create a per-device output. The output filename is used as a
+		// template, with the job number appended.
+		char outname[1024] = {0};
+		snprintf (outname, sizeof (outname), "%s.%u", filename, i + 1);
+		job->output = dctool_output_create (format, outname, units);
+		if (job->output == NULL) {
+			message ("Failed to create the output.\n");
+			rc = DC_STATUS_INVALIDARGS;
+			goto cleanup;
+		}
+
+		// Initialize the dive data.
+		job->divedata.fingerprint = &job->ofingerprint;
+		job->divedata.output = job->output;
+		job->divedata.label = job->devname;
+
+		// Queue the download job.
+		int events = DC_EVENT_WAITING | DC_EVENT_PROGRESS | DC_EVENT_DEVINFO | DC_EVENT_CLOCK | DC_EVENT_VENDOR;
+		rc = dc_download_add (download,
+			job->descriptor ? job->descriptor : descriptor,
+			job->devname,
+			events, job_event_cb,
+			job_dive_cb,
+			job_finished_cb,
+			NULL, 0, job);
+		if (rc != DC_STATUS_SUCCESS) {
+			ERROR ("Error queueing the download job.");
+			goto cleanup;
+		}
+	}
+
+	// Download from all devices concurrently. Without an explicit job
+	// count, all devices are downloaded at the same time.
+	message ("Downloading from %u devices.\n", count);
+	rc = dc_download_run (download, njobs ? njobs : count);
+
+	// Store the fingerprint data, and finish the session journals.
+	for (unsigned int i = 0; i < count; ++i) {
+		download_job_t *job = jobs + i;
+		if (job->status == DC_STATUS_SUCCESS && job->ofingerprint) {
+			dctool_fpstore_update (fpstore, job->family, job->devinfo.serial, job->ofingerprint);
+		}
+		journal_finish (&job->divedata, job->status == DC_STATUS_SUCCESS);
+	}
+
+cleanup:
+	dctool_fpstore_close (fpstore);
+	dc_download_free (download);
+	for (unsigned int i = 0; i < count; ++i) {
+		dc_buffer_free (jobs[i].ofingerprint);
+		dctool_output_free (jobs[i].output);
+		dc_descriptor_free (jobs[i].descriptor);
+	}
+	free (jobs);
+	return rc;
+}
+
 static int
 dctool_download_run (int argc, char *argv[], dc_context_t *context, dc_descriptor_t *descriptor)
 {
@@ -250,6 +621,7 @@ dctool_download_run (int argc, char *argv[], dc_context_t *context, dc_descripto
 
 	// Default option values.
 	unsigned int help = 0;
+	unsigned int njobs = 0;
 	const char *fphex = NULL;
 	const char *filename = NULL;
 	const char *cachedir = NULL;
@@ -257,7 +629,7 @@ dctool_download_run (int argc, char *argv[], dc_context_t *context, dc_descripto
 
 	// Parse the command-line options.
 	int opt = 0;
-	const char *optstring = "ho:p:c:f:u:";
+	const char *optstring = "ho:p:c:f:u:j:";
 #ifdef HAVE_GETOPT_LONG
 	struct option options[] = {
 		{"help",        no_argument,       0, 'h'},
@@ -266,6 +638,7 @@ dctool_download_run (int argc, char *argv[], dc_context_t *context, dc_descripto
 		{"cache",       required_argument, 0, 'c'},
 		{"format",      required_argument, 0, 'f'},
 		{"units",       required_argument, 0, 'u'},
+		{"jobs",        required_argument, 0, 'j'},
 		{0,             0,                 0,  0 }
 	};
 	while ((opt = getopt_long (argc, argv, optstring, options, NULL)) != -1) {
@@ -294,6 +667,9 @@ dctool_download_run (int argc, char *argv[], dc_context_t *context, dc_descripto
 			if (strcmp (optarg, "imperial") == 0)
 				units = DCTOOL_UNITS_IMPERIAL;
 			break;
+		case 'j':
+			njobs = strtoul (optarg, NULL, 0);
+			break;
 		default:
 			return EXIT_FAILURE;
 		}
@@ -311,16 +687,29 @@ dctool_download_run (int argc, char *argv[], dc_context_t *context, dc_descripto
 	// Convert the fingerprint to binary.
 	fingerprint = dctool_convert_hex2bin (fphex);
 
-	// Create the output.
-	if (strcasecmp(format, "raw") == 0) {
-		output = dctool_raw_output_new (filename);
-	} else if (strcasecmp(format, "xml") == 0) {
-		output = dctool_xml_output_new (filename, units);
-	} else {
-		message ("Unknown output format: %s\n", format);
-		exitcode = EXIT_FAILURE;
+	// Download from multiple devices concurrently.
+	if (njobs || argc > 1) {
+		if (argc < 1) {
+			message ("No device names specified.\n");
+			exitcode = EXIT_FAILURE;
+			goto cleanup;
+		}
+		if (filename == NULL) {
+			message ("The multi device mode requires an output filename.\n");
+			exitcode = EXIT_FAILURE;
+			goto cleanup;
+		}
+
+		status = download_multi (context, descriptor, njobs, argc, argv, cachedir, filename, format, units);
+		if (status != DC_STATUS_SUCCESS) {
+			message ("ERROR: %s\n", dctool_errmsg (status));
+			exitcode = EXIT_FAILURE;
+		}
 		goto cleanup;
 	}
+
+	// Create the output.
+	output = dctool_output_create (format, filename, units);
 	if (output == NULL) {
 		message ("Failed to create the output.\n");
 		exitcode = EXIT_FAILURE;
@@ -328,7 +717,7 @@ dctool_download_run (int argc, char *argv[], dc_context_t *context, dc_descripto
 	}
 
 	// Download the dives.
-	status = download (context, descriptor, argv[0], cachedir, fingerprint, output);
+	status = dctool_download_device (context, descriptor, argv[0], cachedir, fingerprint, output);
 	if (status != DC_STATUS_SUCCESS) {
 		message ("ERROR: %s\n", dctool_errmsg (status));
 		exitcode = EXIT_FAILURE;
@@ -348,6 +737,7 @@ const dctool_command_t dctool_download = {
 	"Download the dives",
 	"Usage:\n"
 	"   dctool download [options] <devname>\n"
+	"   dctool download [options] -o <filename> [<device>=]<devname> ...\n"
 	"\n"
 	"Options:\n"
 #ifdef HAVE_GETOPT_LONG
@@ -357,6 +747,7 @@ const dctool_command_t dctool_download = {
 	"   -c, --cache <directory>    Cache directory\n"
 	"   -f, --format <format>      Output format\n"
 	"   -u, --units <units>        Set units (metric or imperial)\n"
+	"   -j, --jobs <number>        Number of concurrent downloads\n"
 #else
 	"   -h                 Show help message\n"
 	"   -o <filename>      Output filename\n"
@@ -364,7 +755,14 @@ const dctool_command_t dctool_download = {
 	"   -c <directory>     Cache directory\n"
 	"   -f <format>        Output format\n"
 	"   -u <units>         Set units (metric or imperial)\n"
+	"   -j <number>        Number of concurrent downloads\n"
 #endif
+	"\n"
+	"With multiple device names, the dives are downloaded from all devices\n"
+	"concurrently, on at most <number> threads. A device name can be\n"
+	"prefixed with its own device description, to mix different models in\n"
+	"a single run. The output filename is used as a template, with the\n"
+	"job number appended.\n"
 	"\n"
 	"Supported output formats:\n"
 	"\n"
@@ -378,6 +776,13 @@ const dctool_command_t dctool_download = {
 	"      files, the filename is interpreted as a template and should\n"
 	"      contain one or more placeholders.\n"
 	"\n"
+	"   ARCHIVE\n"
+	"\n"
+	"      All dives are appended as raw (binary) data to a single\n"
+	"      container file with an index, written sequentially in large\n"
+	"      chunks. Intended for slow storage, where creating one file\n"
+	"      per dive is expensive.\n"
+	"\n"
 	"Supported template placeholders:\n"
 	"\n"
 	"   %f   Fingerprint (hexadecimal format)\n"
@@ -37,10 +37,36 @@
 
 #include "dctool.h"
 #include "common.h"
+#include "dumpfile.h"
 #include "utils.h"
 
+static void
+event_cb (dc_device_t *device, dc_event_type_t event, const void *data, void *userdata)
+{
+	const dc_event_devinfo_t *devinfo = (const dc_event_devinfo_t *) data;
+	const dc_event_clock_t *clock = (const dc_event_clock_t *) data;
+	dctool_dumpfile_header_t *header = (dctool_dumpfile_header_t *) userdata;
+
+	// Capture the device identity and clock for the dump file header.
+	switch (event) {
+	case DC_EVENT_DEVINFO:
+		header->model = devinfo->model;
+		header->firmware = devinfo->firmware;
+		header->serial = devinfo->serial;
+		break;
+	case DC_EVENT_CLOCK:
+		header->devtime = clock->devtime;
+		header->systime = clock->systime;
+		break;
+	default:
+		break;
+	}
+
+	dctool_event_cb (device, event, data, userdata);
+}
+
 static dc_status_t
-dump (dc_context_t *context, dc_descriptor_t *descriptor, const char *devname, dc_buffer_t *fingerprint, dc_buffer_t *buffer)
+dump (dc_context_t *context, dc_descriptor_t *descriptor, const char *devname, dc_buffer_t *fingerprint, dc_buffer_t *buffer, dctool_dumpfile_header_t *header)
 {
 	dc_status_t rc = DC_STATUS_SUCCESS;
 	dc_device_t *device = NULL;
@@ -59,7 +85,7 @@ dump (dc_context_t *context, dc_descriptor_t *descriptor, const char *devname, d
 	// Register the event handler.
 	message ("Registering the event handler.\n");
 	int events = DC_EVENT_WAITING | DC_EVENT_PROGRESS | DC_EVENT_DEVINFO | DC_EVENT_CLOCK | DC_EVENT_VENDOR;
-	rc = dc_device_set_events (device, events, dctool_event_cb, NULL);
+	rc = dc_device_set_events (device, events, event_cb, header);
 	if (rc != DC_STATUS_SUCCESS) {
 		ERROR ("Error registering the event handler.");
 		goto cleanup;
@@ -108,13 +134,15 @@ dctool_dump_run (int argc, char *argv[], dc_context_t *context, dc_descriptor_t
 	unsigned int help = 0;
 	const char *fphex = NULL;
 	const char *filename = NULL;
+	const char *format = "raw";
 
 	// Parse the command-line options.
 	int opt = 0;
-	const char *optstring = "ho:p:";
+	const char *optstring = "hf:o:p:";
 #ifdef HAVE_GETOPT_LONG
 	struct option options[] = {
 		{"help",        no_argument,       0, 'h'},
+		{"format",      required_argument, 0, 'f'},
 		{"output",      required_argument, 0, 'o'},
 		{"fingerprint", required_argument, 0, 'p'},
 		{0,             0,                 0,  0 }
@@ -127,6 +155,9 @@ dctool_dump_run (int argc, char *argv[], dc_context_t *context, dc_descriptor_t
 		case 'h':
 			help = 1;
 			break;
+		case 'f':
+			format = optarg;
+			break;
 		case 'o':
 			filename = optarg;
 			break;
@@ -147,6 +178,21 @@ dctool_dump_run (int argc, char *argv[], dc_context_t *context, dc_descriptor_t
 		return EXIT_SUCCESS;
 	}
 
+	// Check the output format.
+	int container = 0;
+	if (strcasecmp (format, "dcmd") == 0) {
+		container = 1;
+	} else if (strcasecmp (format, "raw") != 0) {
+		message ("Unknown output format: %s\n", format);
+		return EXIT_FAILURE;
+	}
+
+	// The container format requires an output file.
+	if (container && filename == NULL) {
+		message ("No output filename specified.\n");
+		return EXIT_FAILURE;
+	}
+
 	// Convert the fingerprint to binary.
 	fingerprint = dctool_convert_hex2bin (fphex);
 
@@ -154,7 +200,9 @@ dctool_dump_run (int argc, char *argv[], dc_context_t *context, dc_descriptor_t
 	buffer = dc_buffer_new (0);
 
 	// Download the memory dump.
-	status = dump (context, descriptor, argv[0], fingerprint, buffer);
+	dctool_dumpfile_header_t header = {0};
+	header.family = dc_descriptor_get_type (descriptor);
+	status = dump (context, descriptor, argv[0], fingerprint, buffer, &header);
 	if (status != DC_STATUS_SUCCESS) {
 		message ("ERROR: %s\n", dctool_errmsg (status));
 		exitcode = EXIT_FAILURE;
@@ -162,7 +210,15 @@ dctool_dump_run (int argc, char *argv[], dc_context_t *context, dc_descriptor_t
 	}
 
 	// Write the memory dump to disk.
-	dctool_file_write (filename, buffer);
+	if (container) {
+		if (dctool_dumpfile_write (filename, &header, buffer) != 0) {
+			message ("ERROR: Failed to write the dump file.\n");
+			exitcode = EXIT_FAILURE;
+			goto cleanup;
+		}
+	} else {
+		dctool_file_write (filename, buffer);
+	}
 
 cleanup:
 	dc_buffer_free (buffer);
@@ -181,10 +237,12 @@ const dctool_command_t dctool_dump = {
 	"Options:\n"
 #ifdef HAVE_GETOPT_LONG
 	"   -h, --help                 Show help message\n"
+	"   -f, --format <format>      Output format (raw or dcmd)\n"
 	"   -o, --output <filename>    Output filename\n"
 	"   -p, --fingerprint <data>   Fingerprint data (hexadecimal)\n"
 #else
 	"   -h                 Show help message\n"
+	"   -f <format>        Output format (raw or dcmd)\n"
 	"   -o <filename>      Output filename\n"
 	"   -p <fingerprint>   Fingerprint data (hexadecimal)\n"
 #endif
@@ -0,0 +1,170 @@
+/*
+ * libdivecomputer
+ *
+ * Copyright (C) 2016 Jef Driesen
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdlib.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <string.h>
+#ifdef HAVE_GETOPT_H
+#include <getopt.h>
+#endif
+
+#include <libdivecomputer/context.h>
+
+#include "dctool.h"
+#include "common.h"
+#include "dumpfile.h"
+#include "utils.h"
+
+#ifdef _WIN32
+#define DC_TICKS_FORMAT "%I64d"
+#else
+#define DC_TICKS_FORMAT "%lld"
+#endif
+
+static int
+dctool_dumpdiff_run (int argc, char *argv[], dc_context_t *context, dc_descriptor_t *descriptor)
+{
+	int exitcode = EXIT_SUCCESS;
+	dctool_dumpfile_t *a = NULL;
+	dctool_dumpfile_t *b = NULL;
+
+	// Default option values.
+	unsigned int help = 0;
+
+	// Parse the command-line options.
+	int opt = 0;
+	const char *optstring = "h";
+#ifdef HAVE_GETOPT_LONG
+	struct option options[] = {
+		{"help", no_argument, 0, 'h'},
+		{0,      0,           0,  0 }
+	};
+	while ((opt = getopt_long (argc, argv, optstring, options, NULL)) != -1) {
+#else
+	while ((opt = getopt (argc, argv, optstring)) != -1) {
+#endif
+		switch (opt) {
+		case 'h':
+			help = 1;
+			break;
+		default:
+			return EXIT_FAILURE;
+		}
+	}
+
+	argc -= optind;
+	argv += optind;
+
+	// Show help message.
+	if (help) {
+		dctool_command_showhelp (&dctool_dumpdiff);
+		return EXIT_SUCCESS;
+	}
+
+	if (argc < 2) {
+		message ("No dump files specified.\n");
+		return EXIT_FAILURE;
+	}
+
+	// Open the dump files. The files are memory mapped (where
+	// available), so comparing two large dumps reads the data
+	// directly from the page cache, without copying it.
+	a = dctool_dumpfile_open (argv[0]);
+	b = dctool_dumpfile_open (argv[1]);
+	if (a == NULL || b == NULL) {
+		message ("ERROR: Failed to open the dump files.\n");
+		exitcode = EXIT_FAILURE;
+		goto cleanup;
+	}
+
+	const dctool_dumpfile_header_t *ha = dctool_dumpfile_get_header (a);
+	const dctool_dumpfile_header_t *hb = dctool_dumpfile_get_header (b);
+
+	// Warn when comparing dumps from different devices.
+	if (ha->family != hb->family || ha->model != hb->model ||
+		ha->serial != hb->serial) {
+		message ("WARNING: The dump files are from different devices.\n");
+	}
+
+	message ("Devtime: %u -> %u\n", ha->devtime, hb->devtime);
+	message ("Systime: " DC_TICKS_FORMAT " -> " DC_TICKS_FORMAT "\n",
+		ha->systime, hb->systime);
+
+	const unsigned char *da = dctool_dumpfile_get_data (a);
+	const unsigned char *db = dctool_dumpfile_get_data (b);
+	unsigned int sa = dctool_dumpfile_get_size (a);
+	unsigned int sb = dctool_dumpfile_get_size (b);
+
+	if (sa != sb) {
+		message ("WARNING: The dump sizes differ (%u and %u bytes).\n", sa, sb);
+	}
+
+	// Compare the common part of the two dumps, and coalesce the
+	// differences into ranges.
+	unsigned int size = sa < sb ? sa : sb;
+	unsigned int nranges = 0, nbytes = 0;
+	unsigned int offset = 0;
+	while (offset < size) {
+		if (da[offset] == db[offset]) {
+			offset++;
+			continue;
+		}
+
+		unsigned int start = offset;
+		while (offset < size && da[offset] != db[offset])
+			offset++;
+
+		printf ("%08X %8u\n", start, offset - start);
+		nranges++;
+		nbytes += offset - start;
+	}
+
+	message ("Differences: %u bytes in %u ranges.\n", nbytes, nranges);
+
+	if (nbytes || sa != sb)
+		exitcode = EXIT_FAILURE;
+
+cleanup:
+	dctool_dumpfile_close (a);
+	dctool_dumpfile_close (b);
+	return exitcode;
+}
+
+const dctool_command_t dctool_dumpdiff = {
+	dctool_dumpdiff_run,
+	DCTOOL_CONFIG_NONE,
+	"dumpdiff",
+	"Compare two memory dump files",
+	"Usage:\n"
+	"   dctool dumpdiff [options] <file1> <file2>\n"
+	"\n"
+	"Options:\n"
+#ifdef HAVE_GETOPT_LONG
+	"   -h, --help   Show help message\n"
+#else
+	"   -h           Show help message\n"
+#endif
+};
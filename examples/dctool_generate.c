@@ -0,0 +1,523 @@
+/*
+ * libdivecomputer
+ *
+ * Copyright (C) 2026 Jef Driesen
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#ifdef HAVE_GETOPT_H
+#include <getopt.h>
+#endif
+
+#include <libdivecomputer/context.h>
+#include <libdivecomputer/descriptor.h>
+#include <libdivecomputer/parser.h>
+#include <libdivecomputer/buffer.h>
+
+#include "dctool.h"
+#include "common.h"
+#include "utils.h"
+
+/*
+ * Synthetic dive generator. Real dive data is privacy sensitive and
+ * can't be shared freely, so the parser benchmarks and fuzz runs use
+ * generated dives instead: valid headers with a random but plausible
+ * profile (descent, bottom phase as a random walk, ascent), at a
+ * configurable number of samples. Each family encoder mirrors the
+ * layout its parser decodes, and every generated dive is verified by
+ * parsing it before it is written out.
+ */
+
+static unsigned int
+rng_next (unsigned int *state)
+{
+	// Xorshift32. A tiny deterministic generator, so the same seed
+	// produces the same corpus on every platform.
+	unsigned int x = *state;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	*state = x;
+	return x;
+}
+
+static unsigned int
+rng_range (unsigned int *state, unsigned int min, unsigned int max)
+{
+	return min + rng_next (state) % (max - min + 1);
+}
+
+static unsigned char
+dec2bcd (unsigned int value)
+{
+	return ((value / 10) << 4) | (value % 10);
+}
+
+/*
+ * Generate a depth profile of n points, in arbitrary units with the
+ * given maximum, as a descent, a random walk along the bottom, and an
+ * ascent. The profile starts and ends at zero depth.
+ */
+static void
+generate_profile (unsigned int profile[], unsigned int n, unsigned int maxdepth, unsigned int *seed)
+{
+	unsigned int bottom = maxdepth / 2 + rng_next (seed) % (maxdepth / 2 + 1);
+	unsigned int descent = n / 10 + 1;
+	unsigned int ascent = n / 10 + 1;
+
+	unsigned int depth = 0;
+	for (unsigned int i = 0; i < n; ++i) {
+		if (i < descent) {
+			depth = bottom * (i + 1) / descent;
+		} else if (i >= n - ascent) {
+			depth = depth * (n - i - 1) / (n - i);
+		} else {
+			unsigned int step = bottom / 20 + 1;
+			unsigned int delta = rng_next (seed) % (2 * step + 1);
+			if (delta > step && depth + (delta - step) <= maxdepth)
+				depth += delta - step;
+			else if (delta < step && depth >= step - delta)
+				depth -= step - delta;
+		}
+		profile[i] = depth;
+	}
+}
+
+/*
+ * Citizen Hyper Aqualand. A 32 byte header with BCD encoded fields,
+ * followed by two tables of 12 bit BCD values packed in nibbles: the
+ * depths (every 5 seconds), terminated with an EF marker byte, and the
+ * temperatures (every 5 minutes), terminated with an FF marker byte.
+ */
+
+static void
+citizen_put_nibble (unsigned char data[], unsigned int pos, unsigned int value)
+{
+	if (pos % 2)
+		data[pos / 2] |= value & 0x0F;
+	else
+		data[pos / 2] |= (value & 0x0F) << 4;
+}
+
+static dc_status_t
+generate_citizen_aqualand (dc_buffer_t *buffer, unsigned int nsamples, unsigned int *seed)
+{
+	const unsigned int header = 32;
+	unsigned int ntemperatures = nsamples / 60 + 1;
+
+	// Worst case: both tables, two markers and two padding nibbles.
+	unsigned int nibbles = 3 * (nsamples + ntemperatures) + 2 * 5;
+	unsigned int size = header + (nibbles + 1) / 2;
+
+	if (!dc_buffer_resize (buffer, size))
+		return DC_STATUS_NOMEMORY;
+
+	unsigned char *data = dc_buffer_get_data (buffer);
+	memset (data, 0, size);
+
+	unsigned int *profile = (unsigned int *) malloc (nsamples * sizeof (unsigned int));
+	if (profile == NULL)
+		return DC_STATUS_NOMEMORY;
+
+	// Depths in tenths of meters (three BCD digits, and 999 is the
+	// bogus filler value the parser interpolates away, so stay below).
+	generate_profile (profile, nsamples, 998, seed);
+
+	unsigned int maxdepth = 0;
+	for (unsigned int i = 0; i < nsamples; ++i) {
+		if (profile[i] > maxdepth)
+			maxdepth = profile[i];
+	}
+
+	// Header: metric units, datetime, maximum depth and dive time.
+	unsigned int divetime = nsamples * 5 / 60;
+	if (divetime > 999)
+		divetime = 999;
+	data[0x04] = 0x00; // Metric (any value other than A6).
+	data[0x05] = 0x20;
+	data[0x06] = dec2bcd (rng_range (seed, 20, 29));
+	data[0x07] = dec2bcd (rng_range (seed, 1, 12));
+	data[0x08] = dec2bcd (rng_range (seed, 1, 28));
+	data[0x0A] = dec2bcd (rng_range (seed, 0, 23));
+	data[0x0B] = dec2bcd (rng_range (seed, 0, 59));
+	data[0x0C] = dec2bcd (rng_range (seed, 0, 59));
+	data[0x12] = dec2bcd (maxdepth / 10);
+	data[0x13] = (maxdepth % 10) << 4;
+	data[0x16] = divetime / 100;
+	data[0x17] = dec2bcd (divetime % 100);
+
+	// The depth table.
+	unsigned int pos = header * 2;
+	for (unsigned int i = 0; i < nsamples; ++i) {
+		citizen_put_nibble (data, pos++, profile[i] / 100);
+		citizen_put_nibble (data, pos++, (profile[i] / 10) % 10);
+		citizen_put_nibble (data, pos++, profile[i] % 10);
+	}
+	if (pos % 2)
+		pos++; // Pad to a byte boundary.
+	data[pos / 2] = 0xEF;
+	pos += 2;
+
+	// The temperature table (tenths of degrees).
+	for (unsigned int i = 0; i < ntemperatures; ++i) {
+		unsigned int temperature = rng_range (seed, 150, 250);
+		citizen_put_nibble (data, pos++, temperature / 100);
+		citizen_put_nibble (data, pos++, (temperature / 10) % 10);
+		citizen_put_nibble (data, pos++, temperature % 10);
+	}
+	if (pos % 2)
+		pos++;
+	data[pos / 2] = 0xFF;
+	pos += 2;
+
+	free (profile);
+
+	return dc_buffer_resize (buffer, (pos + 1) / 2) ?
+		DC_STATUS_SUCCESS : DC_STATUS_NOMEMORY;
+}
+
+/*
+ * Mares Darwin and Darwin Air. A fixed size header (52 or 60 bytes)
+ * followed by one sample record per 20 seconds: a 16 bit little endian
+ * value with the depth in the lower 11 bits, plus a tank pressure drop
+ * byte every third sample on the Darwin Air.
+ */
+static dc_status_t
+generate_mares_darwin (dc_buffer_t *buffer, unsigned int nsamples, unsigned int *seed, unsigned int model)
+{
+	unsigned int headersize = (model == 1) ? 60 : 52;
+	unsigned int samplesize = (model == 1) ? 3 : 2;
+
+	// The dive time field is 16 bits, in units of 20 seconds.
+	if (nsamples > 0xFFFF)
+		nsamples = 0xFFFF;
+
+	unsigned int size = headersize + nsamples * samplesize;
+	if (!dc_buffer_resize (buffer, size))
+		return DC_STATUS_NOMEMORY;
+
+	unsigned char *data = dc_buffer_get_data (buffer);
+	memset (data, 0, size);
+
+	unsigned int *profile = (unsigned int *) malloc (nsamples * sizeof (unsigned int));
+	if (profile == NULL)
+		return DC_STATUS_NOMEMORY;
+
+	// Depths in tenths of meters (11 bits).
+	generate_profile (profile, nsamples, 0x7FF, seed);
+
+	unsigned int maxdepth = 0;
+	for (unsigned int i = 0; i < nsamples; ++i) {
+		if (profile[i] > maxdepth)
+			maxdepth = profile[i];
+	}
+
+	// Header.
+	unsigned int year = rng_range (seed, 2020, 2029);
+	data[0] = year >> 8;
+	data[1] = year & 0xFF;
+	data[2] = rng_range (seed, 1, 12);
+	data[3] = rng_range (seed, 1, 28);
+	data[4] = rng_range (seed, 0, 23);
+	data[5] = rng_range (seed, 0, 59);
+	data[6] = nsamples >> 8;
+	data[7] = nsamples & 0xFF;
+	data[8] = maxdepth >> 8;
+	data[9] = maxdepth & 0xFF;
+	data[0x0A] = rng_range (seed, 5, 25);
+	data[0x0C] = 0; // Air mode.
+	if (model == 1) {
+		data[0x13] = 120; // Tank volume (12.0 l).
+		unsigned int beginpressure = 220;
+		data[0x17] = beginpressure >> 8;
+		data[0x18] = beginpressure & 0xFF;
+	}
+
+	// Samples.
+	unsigned int offset = headersize;
+	for (unsigned int i = 0; i < nsamples; ++i) {
+		data[offset] = profile[i] & 0xFF;
+		data[offset + 1] = (profile[i] >> 8) & 0x07;
+		if (samplesize == 3) {
+			// Tank pressure drop (bar), consumed every third sample.
+			data[offset + 2] = rng_range (seed, 0, 1);
+		}
+		offset += samplesize;
+	}
+
+	free (profile);
+
+	return DC_STATUS_SUCCESS;
+}
+
+/*
+ * Suunto Eon. An 11 byte header (sample interval, units/pressure, BCD
+ * datetime), followed by signed depth deltas in feet with interleaved
+ * event bytes, an 80 end marker, the minimum temperature and the tank
+ * end pressure.
+ */
+static dc_status_t
+generate_suunto_eon (dc_buffer_t *buffer, unsigned int nsamples, unsigned int *seed)
+{
+	// Worst case: one event byte per sample, plus header and trailer.
+	unsigned int size = 11 + 2 * nsamples + 3;
+	if (!dc_buffer_resize (buffer, size))
+		return DC_STATUS_NOMEMORY;
+
+	unsigned char *data = dc_buffer_get_data (buffer);
+	memset (data, 0, size);
+
+	unsigned int *profile = (unsigned int *) malloc ((nsamples + 1) * sizeof (unsigned int));
+	if (profile == NULL)
+		return DC_STATUS_NOMEMORY;
+
+	// Depths in feet. The deltas are signed bytes, and the values 7D
+	// to 82 are reserved for events, so keep each step below 125.
+	profile[0] = 0;
+	generate_profile (profile + 1, nsamples, 300, seed);
+
+	// Header.
+	data[3] = 20; // Sample interval (seconds).
+	data[4] = 0x00; // Tank pressure mode.
+	data[5] = 220 / 2; // Begin pressure (bar).
+	data[6] = dec2bcd (rng_range (seed, 20, 29));
+	data[7] = dec2bcd (rng_range (seed, 1, 12));
+	data[8] = dec2bcd (rng_range (seed, 1, 28));
+	data[9] = dec2bcd (rng_range (seed, 0, 23));
+	data[10] = dec2bcd (rng_range (seed, 0, 59));
+
+	// Samples.
+	unsigned int offset = 11;
+	for (unsigned int i = 0; i < nsamples; ++i) {
+		int delta = (int) profile[i + 1] - (int) profile[i];
+		while (delta > 124) {
+			data[offset++] = 124;
+			delta -= 124;
+		}
+		while (delta < -124) {
+			data[offset++] = (unsigned char) -124;
+			delta += 124;
+		}
+		// Occasionally insert an event byte (ascent rate warning).
+		if (rng_next (seed) % 64 == 0)
+			data[offset++] = 0x81;
+		data[offset++] = (unsigned char) delta;
+	}
+
+	// Trailer: end marker, temperature and end pressure.
+	data[offset++] = 0x80;
+	data[offset++] = rng_range (seed, 5, 25) + 40;
+	data[offset++] = 100 / 2;
+
+	free (profile);
+
+	return dc_buffer_resize (buffer, offset) ?
+		DC_STATUS_SUCCESS : DC_STATUS_NOMEMORY;
+}
+
+static void
+count_cb (dc_sample_type_t type, dc_sample_value_t value, void *userdata)
+{
+	unsigned long *count = (unsigned long *) userdata;
+
+	(*count)++;
+}
+
+static dc_status_t
+generate (dc_buffer_t *buffer, dc_descriptor_t *descriptor, unsigned int nsamples, unsigned int *seed)
+{
+	switch (dc_descriptor_get_type (descriptor)) {
+	case DC_FAMILY_CITIZEN_AQUALAND:
+		return generate_citizen_aqualand (buffer, nsamples, seed);
+	case DC_FAMILY_MARES_DARWIN:
+		return generate_mares_darwin (buffer, nsamples, seed, dc_descriptor_get_model (descriptor));
+	case DC_FAMILY_SUUNTO_EON:
+		return generate_suunto_eon (buffer, nsamples, seed);
+	default:
+		return DC_STATUS_UNSUPPORTED;
+	}
+}
+
+static dc_status_t
+verify (dc_parser_t *parser, dc_buffer_t *buffer)
+{
+	dc_status_t rc = DC_STATUS_SUCCESS;
+	unsigned long count = 0;
+
+	// Parse the generated dive, to guarantee only valid dives enter
+	// the corpus.
+	rc = dc_parser_set_data (parser, dc_buffer_get_data (buffer), dc_buffer_get_size (buffer));
+	if (rc != DC_STATUS_SUCCESS)
+		return rc;
+
+	rc = dc_parser_samples_foreach (parser, count_cb, &count);
+	if (rc != DC_STATUS_SUCCESS)
+		return rc;
+
+	if (count == 0)
+		return DC_STATUS_DATAFORMAT;
+
+	return DC_STATUS_SUCCESS;
+}
+
+static int
+dctool_generate_run (int argc, char *argv[], dc_context_t *context, dc_descriptor_t *descriptor)
+{
+	int exitcode = EXIT_SUCCESS;
+	dc_status_t status = DC_STATUS_SUCCESS;
+	dc_buffer_t *buffer = NULL;
+	dc_parser_t *parser = NULL;
+
+	// Default option values.
+	unsigned int help = 0;
+	unsigned int count = 1;
+	unsigned int nsamples = 720;
+	unsigned int seed = 1;
+	const char *outdir = ".";
+
+	// Parse the command-line options.
+	int opt = 0;
+	const char *optstring = "hc:n:s:o:";
+#ifdef HAVE_GETOPT_LONG
+	struct option options[] = {
+		{"help",    no_argument,       0, 'h'},
+		{"count",   required_argument, 0, 'c'},
+		{"samples", required_argument, 0, 'n'},
+		{"seed",    required_argument, 0, 's'},
+		{"output",  required_argument, 0, 'o'},
+		{0,         0,                 0,  0 }
+	};
+	while ((opt = getopt_long (argc, argv, optstring, options, NULL)) != -1) {
+#else
+	while ((opt = getopt (argc, argv, optstring)) != -1) {
+#endif
+		switch (opt) {
+		case 'h':
+			help = 1;
+			break;
+		case 'c':
+			count = strtoul (optarg, NULL, 0);
+			break;
+		case 'n':
+			nsamples = strtoul (optarg, NULL, 0);
+			break;
+		case 's':
+			seed = strtoul (optarg, NULL, 0);
+			break;
+		case 'o':
+			outdir = optarg;
+			break;
+		default:
+			return EXIT_FAILURE;
+		}
+	}
+
+	argc -= optind;
+	argv += optind;
+
+	// Show help message.
+	if (help) {
+		dctool_command_showhelp (&dctool_generate);
+		return EXIT_SUCCESS;
+	}
+
+	if (nsamples == 0)
+		nsamples = 1;
+	if (seed == 0)
+		seed = 1;
+
+	// Create the parser for the verification.
+	status = dc_parser_new2 (&parser, context, descriptor, 0, 0);
+	if (status != DC_STATUS_SUCCESS) {
+		message ("Failed to create the parser.\n");
+		exitcode = EXIT_FAILURE;
+		goto cleanup;
+	}
+
+	buffer = dc_buffer_new (4096);
+	if (buffer == NULL) {
+		message ("Failed to allocate memory.\n");
+		exitcode = EXIT_FAILURE;
+		goto cleanup;
+	}
+
+	for (unsigned int i = 0; i < count; ++i) {
+		// Generate the dive.
+		status = generate (buffer, descriptor, nsamples, &seed);
+		if (status != DC_STATUS_SUCCESS) {
+			if (status == DC_STATUS_UNSUPPORTED)
+				message ("No generator available for this device.\n");
+			else
+				message ("ERROR: %s\n", dctool_errmsg (status));
+			exitcode = EXIT_FAILURE;
+			goto cleanup;
+		}
+
+		// Verify the dive parses.
+		status = verify (parser, buffer);
+		if (status != DC_STATUS_SUCCESS) {
+			message ("Generated dive %u failed to parse: %s\n", i, dctool_errmsg (status));
+			exitcode = EXIT_FAILURE;
+			goto cleanup;
+		}
+
+		// Release the parser's reference to the buffer before it is
+		// resized by the next iteration.
+		dc_parser_reset (parser);
+
+		// Write the output file.
+		char filename[1024];
+		snprintf (filename, sizeof (filename), "%s/dive-%08u.bin", outdir, i + 1);
+		dctool_file_write (filename, buffer);
+	}
+
+cleanup:
+	dc_parser_destroy (parser);
+	dc_buffer_free (buffer);
+	return exitcode;
+}
+
+const dctool_command_t dctool_generate = {
+	dctool_generate_run,
+	DCTOOL_CONFIG_DESCRIPTOR,
+	"generate",
+	"Generate synthetic dives for benchmarking and fuzzing",
+	"Usage:\n"
+	"   dctool generate [options]\n"
+	"\n"
+	"Options:\n"
+#ifdef HAVE_GETOPT_LONG
+	"   -h, --help               Show help message\n"
+	"   -c, --count <number>     Number of dives to generate\n"
+	"   -n, --samples <number>   Number of samples per dive\n"
+	"   -s, --seed <number>      Random generator seed\n"
+	"   -o, --output <directory> Output directory\n"
+#else
+	"   -h              Show help message\n"
+	"   -c <number>     Number of dives to generate\n"
+	"   -n <number>     Number of samples per dive\n"
+	"   -s <number>     Random generator seed\n"
+	"   -o <directory>  Output directory\n"
+#endif
+};
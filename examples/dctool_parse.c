@@ -27,6 +27,9 @@
 #include <unistd.h>
 #include <stdio.h>
 #include <string.h>
+#include <pthread.h>
+#include <dirent.h>
+#include <sys/stat.h>
 #ifdef HAVE_GETOPT_H
 #include <getopt.h>
 #endif
@@ -57,27 +60,18 @@
 #define REACTPROWHITE 0x4354
 
 static dc_status_t
-parse (dc_buffer_t *buffer, dc_context_t *context, dc_descriptor_t *descriptor, unsigned int devtime, dc_ticks_t systime, dctool_output_t *output)
+parse (dc_parser_t *parser, dc_buffer_t *buffer, dctool_output_t *output)
 {
 	dc_status_t rc = DC_STATUS_SUCCESS;
-	dc_parser_t *parser = NULL;
 	unsigned char *data = dc_buffer_get_data (buffer);
 	unsigned int size = dc_buffer_get_size (buffer);
 
-	// Create the parser.
-	message ("Creating the parser.\n");
-	rc = dc_parser_new2 (&parser, context, descriptor, devtime, systime);
-	if (rc != DC_STATUS_SUCCESS) {
-		ERROR ("Error creating the parser.");
-		goto cleanup;
-	}
-
 	// Register the data.
 	message ("Registering the data.\n");
 	rc = dc_parser_set_data (parser, data, size);
 	if (rc != DC_STATUS_SUCCESS) {
 		ERROR ("Error registering the data.");
-		goto cleanup;
+		return rc;
 	}
 
 	// Parse the dive data.
@@ -85,12 +79,181 @@ parse (dc_buffer_t *buffer, dc_context_t *context, dc_descriptor_t *descriptor,
 	rc = dctool_output_write (output, parser, data, size, NULL, 0);
 	if (rc != DC_STATUS_SUCCESS) {
 		ERROR ("Error parsing the dive data.");
-		goto cleanup;
+		return rc;
+	}
+
+	// Release the reference to the dive data, so the caller can free
+	// the buffer, and re-arm the parser for the next file.
+	return dc_parser_reset (parser);
+}
+
+typedef struct filelist_t {
+	char **names;
+	unsigned int count;
+	unsigned int capacity;
+} filelist_t;
+
+static int
+filelist_add (filelist_t *files, const char *name)
+{
+	if (files->count >= files->capacity) {
+		unsigned int capacity = files->capacity ? 2 * files->capacity : 64;
+		char **names = (char **) realloc (files->names, capacity * sizeof (char *));
+		if (names == NULL)
+			return 0;
+		files->names = names;
+		files->capacity = capacity;
+	}
+
+	files->names[files->count] = strdup (name);
+	if (files->names[files->count] == NULL)
+		return 0;
+	files->count++;
+
+	return 1;
+}
+
+static int
+filelist_compare (const void *a, const void *b)
+{
+	return strcmp (* (char * const *) a, * (char * const *) b);
+}
+
+/*
+ * Expand an argument into the file list. A directory contributes all
+ * its regular files, sorted by name for a reproducible order.
+ */
+static int
+filelist_expand (filelist_t *files, const char *path)
+{
+	struct stat st;
+	if (stat (path, &st) != 0) {
+		message ("Failed to open the input file: %s\n", path);
+		return 0;
+	}
+
+	if (!S_ISDIR (st.st_mode))
+		return filelist_add (files, path);
+
+	DIR *dir = opendir (path);
+	if (dir == NULL) {
+		message ("Failed to open the directory: %s\n", path);
+		return 0;
+	}
+
+	unsigned int first = files->count;
+	struct dirent *entry = NULL;
+	while ((entry = readdir (dir)) != NULL) {
+		char filename[1024] = {0};
+		snprintf (filename, sizeof (filename), "%s/%s", path, entry->d_name);
+
+		if (stat (filename, &st) != 0 || !S_ISREG (st.st_mode))
+			continue;
+
+		if (!filelist_add (files, filename)) {
+			closedir (dir);
+			return 0;
+		}
+	}
+	closedir (dir);
+
+	qsort (files->names + first, files->count - first,
+		sizeof (char *), filelist_compare);
+
+	return 1;
+}
+
+static void
+filelist_free (filelist_t *files)
+{
+	for (unsigned int i = 0; i < files->count; ++i)
+		free (files->names[i]);
+	free (files->names);
+}
+
+typedef struct batch_t {
+	pthread_mutex_t mutex;
+	const filelist_t *files;
+	unsigned int next;
+	dc_context_t *context;
+	dc_descriptor_t *descriptor;
+	unsigned int devtime;
+	dc_ticks_t systime;
+	const char *filename;
+	dctool_units_t units;
+	int errors;
+} batch_t;
+
+typedef struct batch_worker_t {
+	batch_t *batch;
+	unsigned int index;
+} batch_worker_t;
+
+static void *
+batch_worker (void *arg)
+{
+	batch_worker_t *worker = (batch_worker_t *) arg;
+	batch_t *batch = worker->batch;
+	dc_parser_t *parser = NULL;
+	dctool_output_t *output = NULL;
+
+	// Create a parser and an output per worker. The output filename is
+	// used as a template, with the worker number appended.
+	char outname[1024] = {0};
+	snprintf (outname, sizeof (outname), "%s.%u", batch->filename, worker->index + 1);
+	output = dctool_xml_output_new (outname, batch->units);
+	if (output == NULL) {
+		message ("Failed to create the output.\n");
+		goto error_cleanup;
+	}
+
+	if (dc_parser_new2 (&parser, batch->context, batch->descriptor, batch->devtime, batch->systime) != DC_STATUS_SUCCESS) {
+		ERROR ("Error creating the parser.");
+		goto error_cleanup;
+	}
+
+	while (1) {
+		// Claim the next file.
+		pthread_mutex_lock (&batch->mutex);
+		unsigned int i = batch->next++;
+		pthread_mutex_unlock (&batch->mutex);
+		if (i >= batch->files->count)
+			break;
+
+		// Read the input file.
+		dc_buffer_t *buffer = dctool_file_read (batch->files->names[i]);
+		if (buffer == NULL) {
+			message ("Failed to open the input file: %s\n", batch->files->names[i]);
+			goto error;
+		}
+
+		// Parse the dive. A failing dive is reported, but does not
+		// stop the batch.
+		if (parse (parser, buffer, output) != DC_STATUS_SUCCESS) {
+			dc_buffer_free (buffer);
+			goto error;
+		}
+
+		dc_buffer_free (buffer);
+		continue;
+
+error:
+		pthread_mutex_lock (&batch->mutex);
+		batch->errors++;
+		pthread_mutex_unlock (&batch->mutex);
 	}
 
-cleanup:
 	dc_parser_destroy (parser);
-	return rc;
+	dctool_output_free (output);
+	return NULL;
+
+error_cleanup:
+	pthread_mutex_lock (&batch->mutex);
+	batch->errors++;
+	pthread_mutex_unlock (&batch->mutex);
+	dc_parser_destroy (parser);
+	dctool_output_free (output);
+	return NULL;
 }
 
 static int
@@ -100,18 +263,21 @@ dctool_parse_run (int argc, char *argv[], dc_context_t *context, dc_descriptor_t
 	int exitcode = EXIT_SUCCESS;
 	dc_status_t status = DC_STATUS_SUCCESS;
 	dc_buffer_t *buffer = NULL;
+	dc_parser_t *parser = NULL;
 	dctool_output_t *output = NULL;
 	dctool_units_t units = DCTOOL_UNITS_METRIC;
+	filelist_t files = {0};
 
 	// Default option values.
 	unsigned int help = 0;
+	unsigned int njobs = 0;
 	const char *filename = NULL;
 	unsigned int devtime = 0;
 	dc_ticks_t systime = 0;
 
 	// Parse the command-line options.
 	int opt = 0;
-	const char *optstring = "ho:d:s:u:";
+	const char *optstring = "ho:d:s:u:j:";
 #ifdef HAVE_GETOPT_LONG
 	struct option options[] = {
 		{"help",        no_argument,       0, 'h'},
@@ -119,6 +285,7 @@ dctool_parse_run (int argc, char *argv[], dc_context_t *context, dc_descriptor_t
 		{"devtime",     required_argument, 0, 'd'},
 		{"systime",     required_argument, 0, 's'},
 		{"units",       required_argument, 0, 'u'},
+		{"jobs",        required_argument, 0, 'j'},
 		{0,             0,                 0,  0 }
 	};
 	while ((opt = getopt_long (argc, argv, optstring, options, NULL)) != -1) {
@@ -144,6 +311,9 @@ dctool_parse_run (int argc, char *argv[], dc_context_t *context, dc_descriptor_t
 			if (strcmp (optarg, "imperial") == 0)
 				units = DCTOOL_UNITS_IMPERIAL;
 			break;
+		case 'j':
+			njobs = strtoul (optarg, NULL, 0);
+			break;
 		default:
 			return EXIT_FAILURE;
 		}
@@ -158,6 +328,72 @@ dctool_parse_run (int argc, char *argv[], dc_context_t *context, dc_descriptor_t
 		return EXIT_SUCCESS;
 	}
 
+	// Build the list of input files. Directories are expanded into the
+	// regular files they contain.
+	for (unsigned int i = 0; i < argc; ++i) {
+		if (!filelist_expand (&files, argv[i])) {
+			exitcode = EXIT_FAILURE;
+			goto cleanup;
+		}
+	}
+
+	// Parse the files on multiple threads. Every worker claims files
+	// from the shared list, with its own parser and its own output
+	// file (the output filename with the worker number appended),
+	// since a dive is parsed while its output is written. A failing
+	// file is reported, but does not stop the batch.
+	if (njobs > 1 && files.count > 1) {
+		if (filename == NULL) {
+			message ("The parallel mode requires an output filename.\n");
+			exitcode = EXIT_FAILURE;
+			goto cleanup;
+		}
+
+		if (njobs > files.count)
+			njobs = files.count;
+
+		batch_t batch = {PTHREAD_MUTEX_INITIALIZER};
+		batch.files = &files;
+		batch.context = context;
+		batch.descriptor = descriptor;
+		batch.devtime = devtime;
+		batch.systime = systime;
+		batch.filename = filename;
+		batch.units = units;
+
+		batch_worker_t *workers = (batch_worker_t *) calloc (njobs, sizeof (batch_worker_t));
+		pthread_t *threads = (pthread_t *) calloc (njobs, sizeof (pthread_t));
+		if (workers == NULL || threads == NULL) {
+			message ("Failed to allocate the workers.\n");
+			free (workers);
+			free (threads);
+			exitcode = EXIT_FAILURE;
+			goto cleanup;
+		}
+
+		unsigned int started = 0;
+		for (unsigned int i = 0; i < njobs; ++i) {
+			workers[i].batch = &batch;
+			workers[i].index = i;
+			if (pthread_create (&threads[i], NULL, batch_worker, &workers[i]) != 0)
+				break;
+			started++;
+		}
+
+		for (unsigned int i = 0; i < started; ++i)
+			pthread_join (threads[i], NULL);
+
+		free (workers);
+		free (threads);
+
+		if (started == 0 || batch.errors) {
+			message ("Failed to parse %u files.\n",
+				started ? batch.errors : files.count);
+			exitcode = EXIT_FAILURE;
+		}
+		goto cleanup;
+	}
+
 	// Create the output.
 	output = dctool_xml_output_new (filename, units);
 	if (output == NULL) {
@@ -166,9 +402,18 @@ dctool_parse_run (int argc, char *argv[], dc_context_t *context, dc_descriptor_t
 		goto cleanup;
 	}
 
-	for (unsigned int i = 0; i < argc; ++i) {
+	// Create the parser. A single parser is reused for all files.
+	message ("Creating the parser.\n");
+	status = dc_parser_new2 (&parser, context, descriptor, devtime, systime);
+	if (status != DC_STATUS_SUCCESS) {
+		ERROR ("Error creating the parser.");
+		exitcode = EXIT_FAILURE;
+		goto cleanup;
+	}
+
+	for (unsigned int i = 0; i < files.count; ++i) {
 		// Read the input file.
-		buffer = dctool_file_read (argv[i]);
+		buffer = dctool_file_read (files.names[i]);
 		if (buffer == NULL) {
 			message ("Failed to open the input file.\n");
 			exitcode = EXIT_FAILURE;
@@ -176,7 +421,7 @@ dctool_parse_run (int argc, char *argv[], dc_context_t *context, dc_descriptor_t
 		}
 
 		// Parse the dive.
-		status = parse (buffer, context, descriptor, devtime, systime, output);
+		status = parse (parser, buffer, output);
 		if (status != DC_STATUS_SUCCESS) {
 			message ("ERROR: %s\n", dctool_errmsg (status));
 			exitcode = EXIT_FAILURE;
@@ -190,7 +435,9 @@ dctool_parse_run (int argc, char *argv[], dc_context_t *context, dc_descriptor_t
 
 cleanup:
 	dc_buffer_free (buffer);
+	dc_parser_destroy (parser);
 	dctool_output_free (output);
+	filelist_free (&files);
 	return exitcode;
 }
 
@@ -200,7 +447,7 @@ const dctool_command_t dctool_parse = {
 	"parse",
 	"Parse previously downloaded dives",
 	"Usage:\n"
-	"   dctool parse [options] <filename>\n"
+	"   dctool parse [options] <filename|directory> ...\n"
 	"\n"
 	"Options:\n"
 #ifdef HAVE_GETOPT_LONG
@@ -209,11 +456,18 @@ const dctool_command_t dctool_parse = {
 	"   -d, --devtime <timestamp>  Device time\n"
 	"   -s, --systime <timestamp>  System time\n"
 	"   -u, --units <units>        Set units (metric or imperial)\n"
+	"   -j, --jobs <number>        Number of parallel jobs\n"
 #else
 	"   -h              Show help message\n"
 	"   -o <filename>   Output filename\n"
 	"   -d <devtime>    Device time\n"
 	"   -s <systime>    System time\n"
 	"   -u <units>      Set units (metric or imperial)\n"
+	"   -j <number>     Number of parallel jobs\n"
 #endif
+	"\n"
+	"A directory argument expands to all the files it contains. A single\n"
+	"parser is reused for all files. With multiple jobs, the files are\n"
+	"distributed over parallel workers, each writing to its own output\n"
+	"file (the output filename with the worker number appended).\n"
 };
@@ -0,0 +1,355 @@
+/*
+ * libdivecomputer
+ *
+ * Copyright (C) 2016 Jef Driesen
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdlib.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+#ifdef HAVE_GETOPT_H
+#include <getopt.h>
+#endif
+
+#include <libdivecomputer/context.h>
+#include <libdivecomputer/descriptor.h>
+#include <libdivecomputer/device.h>
+
+#include "serial.h"
+
+#include "dctool.h"
+#include "common.h"
+#include "output.h"
+#include "utils.h"
+
+// The states of a watched serial port.
+#define WATCH_IDLE   0 // Present, waiting for removal.
+#define WATCH_ACTIVE 1 // Download in progress.
+#define WATCH_DONE   2 // Download finished, waiting for removal.
+
+typedef struct watch_port_t {
+	struct watch_port_t *next;
+	char *name;
+	unsigned int state;
+	unsigned int present;
+	struct watch_t *watch;
+} watch_port_t;
+
+typedef struct watch_t {
+	pthread_mutex_t mutex;
+	watch_port_t *ports;
+	dc_context_t *context;
+	dc_descriptor_t *descriptor;
+	const char *cachedir;
+	const char *filename;
+	const char *format;
+	dctool_units_t units;
+	unsigned int session;
+} watch_t;
+
+static watch_port_t *
+watch_find (watch_t *watch, const char *name)
+{
+	for (watch_port_t *port = watch->ports; port; port = port->next) {
+		if (strcmp (port->name, name) == 0)
+			return port;
+	}
+
+	return NULL;
+}
+
+static void *
+watch_worker (void *arg)
+{
+	watch_port_t *port = (watch_port_t *) arg;
+	watch_t *watch = port->watch;
+	dctool_output_t *output = NULL;
+
+	// Create a per-session output. The output filename is used as a
+	// template, with the session number appended.
+	pthread_mutex_lock (&watch->mutex);
+	unsigned int session = ++watch->session;
+	pthread_mutex_unlock (&watch->mutex);
+
+	char outname[1024] = {0};
+	snprintf (outname, sizeof (outname), "%s.%u", watch->filename, session);
+	if (strcasecmp (watch->format, "raw") == 0) {
+		output = dctool_raw_output_new (outname);
+	} else if (strcasecmp (watch->format, "archive") == 0) {
+		output = dctool_archive_output_new (outname);
+	} else {
+		output = dctool_xml_output_new (outname, watch->units);
+	}
+	if (output == NULL) {
+		message ("[%s] Failed to create the output.\n", port->name);
+		goto cleanup;
+	}
+
+	message ("[%s] Starting session %u.\n", port->name, session);
+
+	dc_status_t status = dctool_download_device (watch->context,
+		watch->descriptor, port->name, watch->cachedir, NULL, output);
+
+	message ("[%s] Session %u finished: %s\n", port->name, session,
+		dctool_errmsg (status));
+
+cleanup:
+	dctool_output_free (output);
+
+	// Wait for the removal of the port before downloading again.
+	pthread_mutex_lock (&watch->mutex);
+	port->state = WATCH_DONE;
+	pthread_mutex_unlock (&watch->mutex);
+
+	return NULL;
+}
+
+static void
+watch_enumerate_cb (const char *name, void *userdata)
+{
+	watch_t *watch = (watch_t *) userdata;
+
+	watch_port_t *port = watch_find (watch, name);
+	if (port) {
+		port->present = 1;
+		return;
+	}
+
+	// A new port. Track it, and leave it idle: the caller decides
+	// whether an arrival triggers a download.
+	port = (watch_port_t *) calloc (1, sizeof (watch_port_t));
+	if (port == NULL)
+		return;
+	port->name = strdup (name);
+	if (port->name == NULL) {
+		free (port);
+		return;
+	}
+	port->state = WATCH_IDLE;
+	port->present = 1;
+	port->watch = watch;
+	port->next = watch->ports;
+	watch->ports = port;
+}
+
+static int
+dctool_watch_run (int argc, char *argv[], dc_context_t *context, dc_descriptor_t *descriptor)
+{
+	int exitcode = EXIT_SUCCESS;
+	dctool_units_t units = DCTOOL_UNITS_METRIC;
+
+	// Default option values.
+	unsigned int help = 0;
+	unsigned int interval = 1;
+	const char *filename = NULL;
+	const char *cachedir = NULL;
+	const char *format = "xml";
+
+	// Parse the command-line options.
+	int opt = 0;
+	const char *optstring = "ho:c:f:u:i:";
+#ifdef HAVE_GETOPT_LONG
+	struct option options[] = {
+		{"help",        no_argument,       0, 'h'},
+		{"output",      required_argument, 0, 'o'},
+		{"cache",       required_argument, 0, 'c'},
+		{"format",      required_argument, 0, 'f'},
+		{"units",       required_argument, 0, 'u'},
+		{"interval",    required_argument, 0, 'i'},
+		{0,             0,                 0,  0 }
+	};
+	while ((opt = getopt_long (argc, argv, optstring, options, NULL)) != -1) {
+#else
+	while ((opt = getopt (argc, argv, optstring)) != -1) {
+#endif
+		switch (opt) {
+		case 'h':
+			help = 1;
+			break;
+		case 'o':
+			filename = optarg;
+			break;
+		case 'c':
+			cachedir = optarg;
+			break;
+		case 'f':
+			format = optarg;
+			break;
+		case 'u':
+			if (strcmp (optarg, "metric") == 0)
+				units = DCTOOL_UNITS_METRIC;
+			if (strcmp (optarg, "imperial") == 0)
+				units = DCTOOL_UNITS_IMPERIAL;
+			break;
+		case 'i':
+			interval = strtoul (optarg, NULL, 0);
+			if (interval == 0)
+				interval = 1;
+			break;
+		default:
+			return EXIT_FAILURE;
+		}
+	}
+
+	argc -= optind;
+	argv += optind;
+
+	// Show help message.
+	if (help) {
+		dctool_command_showhelp (&dctool_watch);
+		return EXIT_SUCCESS;
+	}
+
+	if (filename == NULL) {
+		message ("The watch mode requires an output filename.\n");
+		return EXIT_FAILURE;
+	}
+
+	watch_t watch = {PTHREAD_MUTEX_INITIALIZER};
+	watch.context = context;
+	watch.descriptor = descriptor;
+	watch.cachedir = cachedir;
+	watch.filename = filename;
+	watch.format = format;
+	watch.units = units;
+
+	// Take a baseline snapshot of the serial ports. The ports that are
+	// already present do not trigger a download: only an arrival does.
+	if (dc_serial_enumerate_cached (watch_enumerate_cb, &watch) != DC_STATUS_SUCCESS) {
+		message ("Failed to enumerate the serial ports.\n");
+		return EXIT_FAILURE;
+	}
+
+	message ("Watching for devices (%s %s).\n",
+		dc_descriptor_get_vendor (descriptor),
+		dc_descriptor_get_product (descriptor));
+
+	while (!dctool_cancel_cb (NULL)) {
+		// Mark all tracked ports as absent, and enumerate again. The
+		// callback marks the ports that are still present, and tracks
+		// the new arrivals.
+		pthread_mutex_lock (&watch.mutex);
+		for (watch_port_t *port = watch.ports; port; port = port->next)
+			port->present = 0;
+
+		watch_port_t *baseline = watch.ports;
+		pthread_mutex_unlock (&watch.mutex);
+
+		dc_serial_enumerate_cached (watch_enumerate_cb, &watch);
+
+		pthread_mutex_lock (&watch.mutex);
+
+		// Start a download for every new arrival. The new ports have
+		// been prepended to the list, in front of the baseline.
+		for (watch_port_t *port = watch.ports; port != baseline; port = port->next) {
+			message ("[%s] Device arrival.\n", port->name);
+			port->state = WATCH_ACTIVE;
+			pthread_t thread;
+			if (pthread_create (&thread, NULL, watch_worker, port) == 0) {
+				pthread_detach (thread);
+			} else {
+				message ("[%s] Failed to start the download.\n", port->name);
+				port->state = WATCH_IDLE;
+			}
+		}
+
+		// Forget the removed ports, so plugging them back in counts as
+		// a new arrival. Ports with an active download stay tracked
+		// until the download has finished.
+		watch_port_t **pport = &watch.ports;
+		while (*pport) {
+			watch_port_t *port = *pport;
+			if (!port->present && port->state != WATCH_ACTIVE) {
+				if (port->state == WATCH_DONE)
+					message ("[%s] Device removal.\n", port->name);
+				*pport = port->next;
+				free (port->name);
+				free (port);
+			} else {
+				pport = &port->next;
+			}
+		}
+
+		pthread_mutex_unlock (&watch.mutex);
+
+		sleep (interval);
+	}
+
+	// Wait for the active downloads to finish.
+	while (1) {
+		pthread_mutex_lock (&watch.mutex);
+		unsigned int active = 0;
+		for (watch_port_t *port = watch.ports; port; port = port->next) {
+			if (port->state == WATCH_ACTIVE)
+				active++;
+		}
+		pthread_mutex_unlock (&watch.mutex);
+		if (active == 0)
+			break;
+		sleep (1);
+	}
+
+	// Cleanup.
+	while (watch.ports) {
+		watch_port_t *port = watch.ports;
+		watch.ports = port->next;
+		free (port->name);
+		free (port);
+	}
+
+	return exitcode;
+}
+
+const dctool_command_t dctool_watch = {
+	dctool_watch_run,
+	DCTOOL_CONFIG_DESCRIPTOR,
+	"watch",
+	"Watch for devices and download on arrival",
+	"Usage:\n"
+	"   dctool watch [options] -o <filename>\n"
+	"\n"
+	"Options:\n"
+#ifdef HAVE_GETOPT_LONG
+	"   -h, --help                 Show help message\n"
+	"   -o, --output <filename>    Output filename\n"
+	"   -c, --cache <directory>    Cache directory\n"
+	"   -f, --format <format>      Output format\n"
+	"   -u, --units <units>        Set units (metric or imperial)\n"
+	"   -i, --interval <seconds>   Polling interval\n"
+#else
+	"   -h               Show help message\n"
+	"   -o <filename>    Output filename\n"
+	"   -c <directory>   Cache directory\n"
+	"   -f <format>      Output format\n"
+	"   -u <units>       Set units (metric or imperial)\n"
+	"   -i <seconds>     Polling interval\n"
+#endif
+	"\n"
+	"The serial ports are polled for new arrivals, and every arrival\n"
+	"immediately starts a download, reusing the already initialized\n"
+	"context and device descriptor. The output filename is used as a\n"
+	"template, with a session number appended. A port triggers a new\n"
+	"download only after it has been unplugged and plugged back in.\n"
+	"The watch runs until interrupted.\n"
+};
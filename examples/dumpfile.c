@@ -0,0 +1,272 @@
+/*
+ * libdivecomputer
+ *
+ * Copyright (C) 2016 Jef Driesen
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+#ifdef HAVE_SYS_MMAN_H
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include "dumpfile.h"
+#include "common.h"
+#include "utils.h"
+
+/*
+ * A container for raw memory dumps. Unlike a bare dump, the container
+ * records which device the memory belongs to, so an archive of dumps
+ * remains self describing, and multiple generations of the same
+ * device can be located and compared. All integers are stored in
+ * little endian byte order.
+ *
+ * The file starts with a fixed size header:
+ *
+ *   magic       4 bytes ("DCMD")
+ *   version     4 bytes
+ *   headersize  4 bytes (always 4096)
+ *   size        4 bytes (size of the memory dump)
+ *   family      4 bytes
+ *   model       4 bytes
+ *   firmware    4 bytes
+ *   serial      4 bytes
+ *   devtime     4 bytes
+ *   systime     8 bytes
+ *
+ * padded with zeros to 4096 bytes, followed by the raw memory dump.
+ * The padding keeps the payload aligned to the page size, so a reader
+ * can memory map the file and hand out a pointer into the mapping,
+ * without copying the dump into an allocated buffer.
+ */
+
+#define MAGIC "DCMD"
+#define DUMPFILE_VERSION 1
+#define HEADERSIZE 4096
+
+struct dctool_dumpfile_t {
+	dctool_dumpfile_header_t header;
+	const unsigned char *data;
+	unsigned int size;
+#ifdef HAVE_SYS_MMAN_H
+	void *mapping;
+	size_t length;
+#endif
+	dc_buffer_t *buffer;
+};
+
+static void
+dumpfile_set_uint32 (unsigned char data[], unsigned int value)
+{
+	data[0] = (value      ) & 0xFF;
+	data[1] = (value >>  8) & 0xFF;
+	data[2] = (value >> 16) & 0xFF;
+	data[3] = (value >> 24) & 0xFF;
+}
+
+static unsigned int
+dumpfile_get_uint32 (const unsigned char data[])
+{
+	return data[0] | (data[1] << 8) | (data[2] << 16) | ((unsigned int) data[3] << 24);
+}
+
+int
+dctool_dumpfile_write (const char *filename, const dctool_dumpfile_header_t *header, dc_buffer_t *buffer)
+{
+	if (filename == NULL || header == NULL || buffer == NULL)
+		return -1;
+
+	// Open the file.
+	FILE *fp = fopen (filename, "wb");
+	if (fp == NULL) {
+		ERROR ("Failed to open the file.");
+		return -1;
+	}
+
+	// Setup the header.
+	unsigned char hdr[HEADERSIZE] = {0};
+	memcpy (hdr, MAGIC, 4);
+	dumpfile_set_uint32 (hdr + 4, DUMPFILE_VERSION);
+	dumpfile_set_uint32 (hdr + 8, HEADERSIZE);
+	dumpfile_set_uint32 (hdr + 12, dc_buffer_get_size (buffer));
+	dumpfile_set_uint32 (hdr + 16, header->family);
+	dumpfile_set_uint32 (hdr + 20, header->model);
+	dumpfile_set_uint32 (hdr + 24, header->firmware);
+	dumpfile_set_uint32 (hdr + 28, header->serial);
+	dumpfile_set_uint32 (hdr + 32, header->devtime);
+	dumpfile_set_uint32 (hdr + 36, (unsigned int) (header->systime & 0xFFFFFFFF));
+	dumpfile_set_uint32 (hdr + 40, (unsigned int) ((header->systime >> 32) & 0xFFFFFFFF));
+
+	// Write the header and the memory dump.
+	size_t n = 0;
+	n += fwrite (hdr, 1, sizeof (hdr), fp);
+	n += fwrite (dc_buffer_get_data (buffer), 1, dc_buffer_get_size (buffer), fp);
+
+	// Close the file.
+	fclose (fp);
+
+	if (n != sizeof (hdr) + dc_buffer_get_size (buffer)) {
+		ERROR ("Failed to write the file.");
+		return -1;
+	}
+
+	return 0;
+}
+
+dctool_dumpfile_t *
+dctool_dumpfile_open (const char *filename)
+{
+	if (filename == NULL)
+		return NULL;
+
+	// Allocate memory.
+	dctool_dumpfile_t *dumpfile = (dctool_dumpfile_t *) calloc (1, sizeof (dctool_dumpfile_t));
+	if (dumpfile == NULL) {
+		ERROR ("Failed to allocate memory.");
+		return NULL;
+	}
+
+	const unsigned char *data = NULL;
+	size_t size = 0;
+
+#ifdef HAVE_SYS_MMAN_H
+	// Map the file into memory.
+	int fd = open (filename, O_RDONLY);
+	if (fd == -1) {
+		ERROR ("Failed to open the file.");
+		goto error_free;
+	}
+
+	struct stat st;
+	if (fstat (fd, &st) == -1 || st.st_size < HEADERSIZE) {
+		ERROR ("Failed to get the file size.");
+		close (fd);
+		goto error_free;
+	}
+
+	dumpfile->length = st.st_size;
+	dumpfile->mapping = mmap (NULL, dumpfile->length, PROT_READ, MAP_PRIVATE, fd, 0);
+	close (fd);
+	if (dumpfile->mapping == MAP_FAILED) {
+		ERROR ("Failed to map the file.");
+		dumpfile->mapping = NULL;
+		goto error_free;
+	}
+
+	data = (const unsigned char *) dumpfile->mapping;
+	size = dumpfile->length;
+#else
+	// Read the file into memory.
+	dumpfile->buffer = dctool_file_read (filename);
+	if (dumpfile->buffer == NULL) {
+		ERROR ("Failed to read the file.");
+		goto error_free;
+	}
+
+	data = dc_buffer_get_data (dumpfile->buffer);
+	size = dc_buffer_get_size (dumpfile->buffer);
+#endif
+
+	// Verify the header.
+	if (size < HEADERSIZE ||
+		memcmp (data, MAGIC, 4) != 0 ||
+		dumpfile_get_uint32 (data + 4) != DUMPFILE_VERSION ||
+		dumpfile_get_uint32 (data + 8) != HEADERSIZE ||
+		dumpfile_get_uint32 (data + 12) != size - HEADERSIZE) {
+		ERROR ("Invalid or corrupt dump file.");
+		goto error_close;
+	}
+
+	// Parse the header.
+	dumpfile->header.family = (dc_family_t) dumpfile_get_uint32 (data + 16);
+	dumpfile->header.model = dumpfile_get_uint32 (data + 20);
+	dumpfile->header.firmware = dumpfile_get_uint32 (data + 24);
+	dumpfile->header.serial = dumpfile_get_uint32 (data + 28);
+	dumpfile->header.devtime = dumpfile_get_uint32 (data + 32);
+	dumpfile->header.systime = (dc_ticks_t) (
+		(unsigned long long) dumpfile_get_uint32 (data + 36) |
+		((unsigned long long) dumpfile_get_uint32 (data + 40) << 32));
+
+	dumpfile->data = data + HEADERSIZE;
+	dumpfile->size = size - HEADERSIZE;
+
+	return dumpfile;
+
+error_close:
+	dctool_dumpfile_close (dumpfile);
+	return NULL;
+
+error_free:
+#ifdef HAVE_SYS_MMAN_H
+	if (dumpfile->mapping)
+		munmap (dumpfile->mapping, dumpfile->length);
+#endif
+	free (dumpfile);
+	return NULL;
+}
+
+const dctool_dumpfile_header_t *
+dctool_dumpfile_get_header (dctool_dumpfile_t *dumpfile)
+{
+	if (dumpfile == NULL)
+		return NULL;
+
+	return &dumpfile->header;
+}
+
+const unsigned char *
+dctool_dumpfile_get_data (dctool_dumpfile_t *dumpfile)
+{
+	if (dumpfile == NULL)
+		return NULL;
+
+	return dumpfile->data;
+}
+
+unsigned int
+dctool_dumpfile_get_size (dctool_dumpfile_t *dumpfile)
+{
+	if (dumpfile == NULL)
+		return 0;
+
+	return dumpfile->size;
+}
+
+void
+dctool_dumpfile_close (dctool_dumpfile_t *dumpfile)
+{
+	if (dumpfile == NULL)
+		return;
+
+#ifdef HAVE_SYS_MMAN_H
+	if (dumpfile->mapping)
+		munmap (dumpfile->mapping, dumpfile->length);
+#endif
+	dc_buffer_free (dumpfile->buffer);
+
+	free (dumpfile);
+}
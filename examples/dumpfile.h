@@ -0,0 +1,66 @@
+/*
+ * libdivecomputer
+ *
+ * Copyright (C) 2016 Jef Driesen
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA
+ */
+
+#ifndef DCTOOL_DUMPFILE_H
+#define DCTOOL_DUMPFILE_H
+
+#include <libdivecomputer/common.h>
+#include <libdivecomputer/buffer.h>
+#include <libdivecomputer/datetime.h>
+#include <libdivecomputer/descriptor.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+typedef struct dctool_dumpfile_header_t {
+	dc_family_t family;
+	unsigned int model;
+	unsigned int firmware;
+	unsigned int serial;
+	unsigned int devtime;
+	dc_ticks_t systime;
+} dctool_dumpfile_header_t;
+
+typedef struct dctool_dumpfile_t dctool_dumpfile_t;
+
+int
+dctool_dumpfile_write (const char *filename, const dctool_dumpfile_header_t *header, dc_buffer_t *buffer);
+
+dctool_dumpfile_t *
+dctool_dumpfile_open (const char *filename);
+
+const dctool_dumpfile_header_t *
+dctool_dumpfile_get_header (dctool_dumpfile_t *dumpfile);
+
+const unsigned char *
+dctool_dumpfile_get_data (dctool_dumpfile_t *dumpfile);
+
+unsigned int
+dctool_dumpfile_get_size (dctool_dumpfile_t *dumpfile);
+
+void
+dctool_dumpfile_close (dctool_dumpfile_t *dumpfile);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+#endif /* DCTOOL_DUMPFILE_H */
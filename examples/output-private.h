@@ -22,6 +22,8 @@
 #ifndef DCTOOL_OUTPUT_PRIVATE_H
 #define DCTOOL_OUTPUT_PRIVATE_H
 
+#include <stdio.h>
+
 #include <libdivecomputer/common.h>
 #include <libdivecomputer/parser.h>
 
@@ -52,6 +54,57 @@ dctool_output_allocate (const dctool_output_vtable_t *vtable);
 void
 dctool_output_deallocate (dctool_output_t *output);
 
+/*
+ * A buffered writer for the output backends. The formatted text is
+ * accumulated in a fixed size buffer and written to the underlying
+ * stream in large blocks. The formatting functions are limited to the
+ * integer, fixed-point and hexadecimal conversions the backends need,
+ * and avoid the overhead of the printf style formatting.
+ */
+
+#define DCTOOL_WRITER_SIZE 65536
+
+typedef struct dctool_writer_t {
+	FILE *ostream;
+	size_t offset;
+	unsigned char buffer[DCTOOL_WRITER_SIZE];
+} dctool_writer_t;
+
+void
+dctool_writer_init (dctool_writer_t *writer, FILE *ostream);
+
+void
+dctool_writer_flush (dctool_writer_t *writer);
+
+/*
+ * Flush the buffer and push the stream to the operating system, so the
+ * data survives a crash. Called at the per-dive boundaries.
+ */
+void
+dctool_writer_sync (dctool_writer_t *writer);
+
+void
+dctool_writer_data (dctool_writer_t *writer, const void *data, size_t size);
+
+void
+dctool_writer_string (dctool_writer_t *writer, const char *str);
+
+/* Unsigned decimal, zero padded to a minimum number of digits. */
+void
+dctool_writer_uint (dctool_writer_t *writer, unsigned int value, unsigned int width);
+
+/* Signed decimal, zero padded to a minimum number of digits. */
+void
+dctool_writer_int (dctool_writer_t *writer, int value, unsigned int width);
+
+/* Fixed-point decimal with the given number of fractional digits. */
+void
+dctool_writer_fixed (dctool_writer_t *writer, double value, unsigned int precision);
+
+/* Uppercase hexadecimal dump, two digits per byte. */
+void
+dctool_writer_hex (dctool_writer_t *writer, const unsigned char data[], size_t size);
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
@@ -20,6 +20,7 @@
  */
 
 #include <stdlib.h>
+#include <string.h>
 #include <assert.h>
 
 #include "output-private.h"
@@ -61,6 +62,124 @@ dctool_output_write (dctool_output_t *output, dc_parser_t *parser, const unsigne
 	return output->vtable->write (output, parser, data, size, fingerprint, fsize);
 }
 
+void
+dctool_writer_init (dctool_writer_t *writer, FILE *ostream)
+{
+	writer->ostream = ostream;
+	writer->offset = 0;
+}
+
+void
+dctool_writer_flush (dctool_writer_t *writer)
+{
+	if (writer->offset) {
+		fwrite (writer->buffer, 1, writer->offset, writer->ostream);
+		writer->offset = 0;
+	}
+}
+
+void
+dctool_writer_sync (dctool_writer_t *writer)
+{
+	dctool_writer_flush (writer);
+	fflush (writer->ostream);
+}
+
+void
+dctool_writer_data (dctool_writer_t *writer, const void *data, size_t size)
+{
+	if (size >= sizeof(writer->buffer)) {
+		// Bypass the buffer for oversized blocks.
+		dctool_writer_flush (writer);
+		fwrite (data, 1, size, writer->ostream);
+		return;
+	}
+
+	if (writer->offset + size > sizeof(writer->buffer))
+		dctool_writer_flush (writer);
+
+	memcpy (writer->buffer + writer->offset, data, size);
+	writer->offset += size;
+}
+
+void
+dctool_writer_string (dctool_writer_t *writer, const char *str)
+{
+	dctool_writer_data (writer, str, strlen (str));
+}
+
+void
+dctool_writer_uint (dctool_writer_t *writer, unsigned int value, unsigned int width)
+{
+	char digits[16], out[16];
+	unsigned int ndigits = 0;
+
+	if (width > sizeof(digits))
+		width = sizeof(digits);
+
+	// Generate the digits in reverse order.
+	do {
+		digits[ndigits++] = '0' + (value % 10);
+		value /= 10;
+	} while (value && ndigits < sizeof(digits));
+
+	while (ndigits < width)
+		digits[ndigits++] = '0';
+
+	for (unsigned int i = 0; i < ndigits; ++i)
+		out[i] = digits[ndigits - 1 - i];
+
+	dctool_writer_data (writer, out, ndigits);
+}
+
+void
+dctool_writer_int (dctool_writer_t *writer, int value, unsigned int width)
+{
+	if (value < 0) {
+		dctool_writer_data (writer, "-", 1);
+		dctool_writer_uint (writer, (unsigned int) -(long) value, width);
+	} else {
+		dctool_writer_uint (writer, (unsigned int) value, width);
+	}
+}
+
+void
+dctool_writer_fixed (dctool_writer_t *writer, double value, unsigned int precision)
+{
+	static const unsigned long scales[] = {
+		1, 10, 100, 1000, 10000, 100000, 1000000};
+
+	if (precision >= sizeof(scales) / sizeof(scales[0]))
+		precision = sizeof(scales) / sizeof(scales[0]) - 1;
+
+	if (value < 0) {
+		dctool_writer_data (writer, "-", 1);
+		value = -value;
+	}
+
+	// Scale and round to the requested precision.
+	unsigned long scaled = (unsigned long) (value * scales[precision] + 0.5);
+
+	dctool_writer_uint (writer, scaled / scales[precision], 0);
+	if (precision) {
+		dctool_writer_data (writer, ".", 1);
+		dctool_writer_uint (writer, scaled % scales[precision], precision);
+	}
+}
+
+void
+dctool_writer_hex (dctool_writer_t *writer, const unsigned char data[], size_t size)
+{
+	const char hex[] = "0123456789ABCDEF";
+
+	for (size_t i = 0; i < size; ++i) {
+		char out[2];
+		out[0] = hex[(data[i] >> 4) & 0x0F];
+		out[1] = hex[ data[i]       & 0x0F];
+		dctool_writer_data (writer, out, 2);
+	}
+}
+
 dc_status_t
 dctool_output_free (dctool_output_t *output)
 {
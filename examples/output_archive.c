@@ -0,0 +1,232 @@
+/*
+ * libdivecomputer
+ *
+ * Copyright (C) 2016 Jef Driesen
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+#include <libdivecomputer/buffer.h>
+
+#include "output-private.h"
+#include "utils.h"
+
+/*
+ * An append-only container for raw dive data. Unlike the raw output,
+ * which creates one file per dive, all dives are stored in a single
+ * file, so saving a large download performs no per-dive file
+ * creations. All integers are stored in little endian byte order.
+ *
+ * The file starts with a small header:
+ *
+ *   magic    4 bytes ("DCRA")
+ *   version  4 bytes
+ *
+ * followed by one record per dive:
+ *
+ *   number   4 bytes
+ *   size     4 bytes (size of the raw dive data)
+ *   fsize    4 bytes (size of the fingerprint)
+ *
+ * and the raw dive data and the fingerprint. The file ends with an
+ * index, with one entry per dive:
+ *
+ *   offset   8 bytes (offset of the dive record)
+ *   size     4 bytes
+ *   fsize    4 bytes
+ *   number   4 bytes
+ *
+ * and a footer:
+ *
+ *   offset   8 bytes (offset of the index)
+ *   ndives   4 bytes
+ *   magic    4 bytes ("DCRA")
+ *
+ * The index and footer are appended when the output is closed, so the
+ * file is written strictly sequentially: a reader locates the index
+ * through the footer at the end of the file. The writes go through a
+ * large stdio buffer, so the data reaches slow (SD card) storage in
+ * big sequential chunks, instead of many small writes.
+ */
+
+#define MAGIC "DCRA"
+#define VERSION 1
+
+#define STREAMBUFFER (1024 * 1024)
+
+static dc_status_t dctool_archive_output_write (dctool_output_t *output, dc_parser_t *parser, const unsigned char data[], unsigned int size, const unsigned char fingerprint[], unsigned int fsize);
+static dc_status_t dctool_archive_output_free (dctool_output_t *output);
+
+typedef struct dctool_archive_output_t {
+	dctool_output_t base;
+	FILE *ostream;
+	char *streambuffer;
+	dc_buffer_t *index;
+	unsigned long long offset;
+	unsigned int ndives;
+} dctool_archive_output_t;
+
+static const dctool_output_vtable_t archive_vtable = {
+	sizeof(dctool_archive_output_t), /* size */
+	dctool_archive_output_write, /* write */
+	dctool_archive_output_free, /* free */
+};
+
+static void
+archive_write_uint32 (FILE *ostream, unsigned int value)
+{
+	unsigned char data[4];
+	data[0] = (value      ) & 0xFF;
+	data[1] = (value >>  8) & 0xFF;
+	data[2] = (value >> 16) & 0xFF;
+	data[3] = (value >> 24) & 0xFF;
+	fwrite (data, 1, sizeof(data), ostream);
+}
+
+static void
+archive_write_uint64 (FILE *ostream, unsigned long long value)
+{
+	unsigned char data[8];
+	for (unsigned int i = 0; i < sizeof(data); ++i)
+		data[i] = (value >> (8 * i)) & 0xFF;
+	fwrite (data, 1, sizeof(data), ostream);
+}
+
+static void
+archive_append_uint32 (dc_buffer_t *buffer, unsigned int value)
+{
+	unsigned char data[4];
+	data[0] = (value      ) & 0xFF;
+	data[1] = (value >>  8) & 0xFF;
+	data[2] = (value >> 16) & 0xFF;
+	data[3] = (value >> 24) & 0xFF;
+	dc_buffer_append (buffer, data, sizeof(data));
+}
+
+static void
+archive_append_uint64 (dc_buffer_t *buffer, unsigned long long value)
+{
+	unsigned char data[8];
+	for (unsigned int i = 0; i < sizeof(data); ++i)
+		data[i] = (value >> (8 * i)) & 0xFF;
+	dc_buffer_append (buffer, data, sizeof(data));
+}
+
+dctool_output_t *
+dctool_archive_output_new (const char *filename)
+{
+	dctool_archive_output_t *output = NULL;
+
+	if (filename == NULL)
+		goto error_exit;
+
+	// Allocate memory.
+	output = (dctool_archive_output_t *) dctool_output_allocate (&archive_vtable);
+	if (output == NULL) {
+		goto error_exit;
+	}
+
+	output->index = dc_buffer_new (0);
+	if (output->index == NULL) {
+		goto error_free;
+	}
+
+	// Open the output file.
+	output->ostream = fopen (filename, "wb");
+	if (output->ostream == NULL) {
+		goto error_free_buffer;
+	}
+
+	// Enlarge the stdio buffer, to batch the dives into big sequential
+	// writes. The default buffer remains in place if the allocation
+	// fails.
+	output->streambuffer = (char *) malloc (STREAMBUFFER);
+	if (output->streambuffer) {
+		setvbuf (output->ostream, output->streambuffer, _IOFBF, STREAMBUFFER);
+	}
+
+	output->ndives = 0;
+
+	// Write the file header.
+	fwrite (MAGIC, 1, 4, output->ostream);
+	archive_write_uint32 (output->ostream, VERSION);
+	output->offset = 8;
+
+	return (dctool_output_t *) output;
+
+error_free_buffer:
+	dc_buffer_free (output->index);
+error_free:
+	dctool_output_deallocate ((dctool_output_t *) output);
+error_exit:
+	return NULL;
+}
+
+static dc_status_t
+dctool_archive_output_write (dctool_output_t *abstract, dc_parser_t *parser, const unsigned char data[], unsigned int size, const unsigned char fingerprint[], unsigned int fsize)
+{
+	dctool_archive_output_t *output = (dctool_archive_output_t *) abstract;
+
+	if (fingerprint == NULL)
+		fsize = 0;
+
+	// Append the index entry.
+	archive_append_uint64 (output->index, output->offset);
+	archive_append_uint32 (output->index, size);
+	archive_append_uint32 (output->index, fsize);
+	archive_append_uint32 (output->index, abstract->number);
+
+	// Append the dive record.
+	archive_write_uint32 (output->ostream, abstract->number);
+	archive_write_uint32 (output->ostream, size);
+	archive_write_uint32 (output->ostream, fsize);
+	fwrite (data, 1, size, output->ostream);
+	if (fsize)
+		fwrite (fingerprint, 1, fsize, output->ostream);
+
+	// Push the completed record to the OS, so a crash later in the
+	// session doesn't lose it. The index is only written on close, but
+	// the records are self delimiting and can be recovered without it.
+	fflush (output->ostream);
+
+	output->offset += 12 + size + fsize;
+	output->ndives++;
+
+	return DC_STATUS_SUCCESS;
+}
+
+static dc_status_t
+dctool_archive_output_free (dctool_output_t *abstract)
+{
+	dctool_archive_output_t *output = (dctool_archive_output_t *) abstract;
+
+	// Append the index and the footer.
+	fwrite (dc_buffer_get_data (output->index),
+		1, dc_buffer_get_size (output->index), output->ostream);
+	archive_write_uint64 (output->ostream, output->offset);
+	archive_write_uint32 (output->ostream, output->ndives);
+	fwrite (MAGIC, 1, 4, output->ostream);
+
+	fclose (output->ostream);
+	free (output->streambuffer);
+	dc_buffer_free (output->index);
+
+	return DC_STATUS_SUCCESS;
+}
@@ -0,0 +1,369 @@
+/*
+ * libdivecomputer
+ *
+ * Copyright (C) 2016 Jef Driesen
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+#include <libdivecomputer/buffer.h>
+
+#include "output-private.h"
+#include "utils.h"
+
+/*
+ * A compact binary output format, intended for post-processing with
+ * external tools. All integers are stored in little endian byte order,
+ * and all blocks are fixed width, so the file can be memory mapped and
+ * indexed without parsing.
+ *
+ * The file starts with a small header:
+ *
+ *   magic    4 bytes ("DCBF")
+ *   version  4 bytes
+ *   ndives   4 bytes
+ *
+ * Each dive is stored as a dive header, followed by one column block
+ * per sample type:
+ *
+ *   number    4 bytes
+ *   size      4 bytes (size of the raw dive data)
+ *   datetime  8 bytes (year 16bit, month, day, hour, minute, second, padding)
+ *   divetime  4 bytes (seconds)
+ *   maxdepth  4 bytes (millimetres)
+ *   fsize     4 bytes, followed by the fingerprint, padded to 4 bytes
+ *   ncolumns  4 bytes
+ *
+ * A column block contains the values of a single sample type:
+ *
+ *   type   4 bytes (the dc_sample_type_t value)
+ *   width  4 bytes (size of a single entry)
+ *   count  4 bytes
+ *
+ * followed by count entries of width bytes. Every entry starts with
+ * the index of the sample (row) it belongs to, except for the time
+ * column, whose entries define the rows. The values are stored in the
+ * native units of the library, scaled to integers: depths in
+ * millimetres, pressures in millibar, and temperatures in hundredths
+ * of a degree Celsius.
+ */
+
+#define MAGIC "DCBF"
+#define VERSION 1
+
+#define NCOLUMNS (DC_SAMPLE_GASMIX + 1)
+
+static dc_status_t dctool_bin_output_write (dctool_output_t *output, dc_parser_t *parser, const unsigned char data[], unsigned int size, const unsigned char fingerprint[], unsigned int fsize);
+static dc_status_t dctool_bin_output_free (dctool_output_t *output);
+
+typedef struct dctool_bin_output_t {
+	dctool_output_t base;
+	FILE *ostream;
+	unsigned int ndives;
+} dctool_bin_output_t;
+
+static const dctool_output_vtable_t bin_vtable = {
+	sizeof(dctool_bin_output_t), /* size */
+	dctool_bin_output_write, /* write */
+	dctool_bin_output_free, /* free */
+};
+
+typedef struct sample_data_t {
+	dc_buffer_t *columns[NCOLUMNS];
+	unsigned int nsamples;
+} sample_data_t;
+
+static void
+bin_append_uint32 (dc_buffer_t *buffer, unsigned int value)
+{
+	unsigned char data[4];
+	data[0] = (value      ) & 0xFF;
+	data[1] = (value >>  8) & 0xFF;
+	data[2] = (value >> 16) & 0xFF;
+	data[3] = (value >> 24) & 0xFF;
+	dc_buffer_append (buffer, data, sizeof(data));
+}
+
+static void
+bin_write_uint32 (FILE *ostream, unsigned int value)
+{
+	unsigned char data[4];
+	data[0] = (value      ) & 0xFF;
+	data[1] = (value >>  8) & 0xFF;
+	data[2] = (value >> 16) & 0xFF;
+	data[3] = (value >> 24) & 0xFF;
+	fwrite (data, 1, sizeof(data), ostream);
+}
+
+static void
+sample_cb (dc_sample_type_t type, dc_sample_value_t value, void *userdata)
+{
+	sample_data_t *sampledata = (sample_data_t *) userdata;
+	dc_buffer_t *column = NULL;
+
+	if (type >= NCOLUMNS)
+		return;
+
+	column = sampledata->columns[type];
+
+	switch (type) {
+	case DC_SAMPLE_TIME:
+		sampledata->nsamples++;
+		bin_append_uint32 (column, value.time);
+		return;
+	case DC_SAMPLE_VENDOR:
+		// Variable width data doesn't fit a fixed-width column.
+		return;
+	default:
+		break;
+	}
+
+	// The remaining columns reference the rows defined by the time
+	// column. Samples before the first time sample are dropped.
+	if (sampledata->nsamples == 0)
+		return;
+
+	bin_append_uint32 (column, sampledata->nsamples - 1);
+
+	switch (type) {
+	case DC_SAMPLE_DEPTH:
+		bin_append_uint32 (column, (unsigned int) (value.depth * 1000.0 + 0.5));
+		break;
+	case DC_SAMPLE_PRESSURE:
+		bin_append_uint32 (column, value.pressure.tank);
+		bin_append_uint32 (column, (unsigned int) (value.pressure.value * 1000.0 + 0.5));
+		break;
+	case DC_SAMPLE_TEMPERATURE:
+		bin_append_uint32 (column, (unsigned int) (int) (value.temperature * 100.0 + (value.temperature < 0 ? -0.5 : 0.5)));
+		break;
+	case DC_SAMPLE_EVENT:
+		bin_append_uint32 (column, value.event.type);
+		bin_append_uint32 (column, value.event.time);
+		bin_append_uint32 (column, value.event.flags);
+		bin_append_uint32 (column, value.event.value);
+		break;
+	case DC_SAMPLE_RBT:
+		bin_append_uint32 (column, value.rbt);
+		break;
+	case DC_SAMPLE_HEARTBEAT:
+		bin_append_uint32 (column, value.heartbeat);
+		break;
+	case DC_SAMPLE_BEARING:
+		bin_append_uint32 (column, value.bearing);
+		break;
+	case DC_SAMPLE_SETPOINT:
+		bin_append_uint32 (column, (unsigned int) (value.setpoint * 1000.0 + 0.5));
+		break;
+	case DC_SAMPLE_PPO2:
+		bin_append_uint32 (column, (unsigned int) (value.ppo2 * 1000.0 + 0.5));
+		break;
+	case DC_SAMPLE_CNS:
+		bin_append_uint32 (column, (unsigned int) (value.cns * 10000.0 + 0.5));
+		break;
+	case DC_SAMPLE_DECO:
+		bin_append_uint32 (column, value.deco.type);
+		bin_append_uint32 (column, value.deco.time);
+		bin_append_uint32 (column, (unsigned int) (value.deco.depth * 1000.0 + 0.5));
+		break;
+	case DC_SAMPLE_GASMIX:
+		bin_append_uint32 (column, value.gasmix);
+		break;
+	default:
+		break;
+	}
+}
+
+dctool_output_t *
+dctool_bin_output_new (const char *filename)
+{
+	dctool_bin_output_t *output = NULL;
+
+	if (filename == NULL)
+		goto error_exit;
+
+	// Allocate memory.
+	output = (dctool_bin_output_t *) dctool_output_allocate (&bin_vtable);
+	if (output == NULL) {
+		goto error_exit;
+	}
+
+	// Open the output file.
+	output->ostream = fopen (filename, "wb");
+	if (output->ostream == NULL) {
+		goto error_free;
+	}
+
+	output->ndives = 0;
+
+	// Write the file header. The number of dives is patched when the
+	// output is closed.
+	fwrite (MAGIC, 1, 4, output->ostream);
+	bin_write_uint32 (output->ostream, VERSION);
+	bin_write_uint32 (output->ostream, 0);
+
+	return (dctool_output_t *) output;
+
+error_free:
+	dctool_output_deallocate ((dctool_output_t *) output);
+error_exit:
+	return NULL;
+}
+
+static dc_status_t
+dctool_bin_output_write (dctool_output_t *abstract, dc_parser_t *parser, const unsigned char data[], unsigned int size, const unsigned char fingerprint[], unsigned int fsize)
+{
+	dctool_bin_output_t *output = (dctool_bin_output_t *) abstract;
+	dc_status_t status = DC_STATUS_SUCCESS;
+
+	// Initialize the sample data.
+	sample_data_t sampledata = {{0}};
+	sampledata.nsamples = 0;
+	for (unsigned int i = 0; i < NCOLUMNS; ++i) {
+		sampledata.columns[i] = dc_buffer_new (0);
+		if (sampledata.columns[i] == NULL) {
+			status = DC_STATUS_NOMEMORY;
+			goto cleanup;
+		}
+	}
+
+	// Parse the datetime.
+	message ("Parsing the datetime.\n");
+	dc_datetime_t dt = {0};
+	status = dc_parser_get_datetime (parser, &dt);
+	if (status != DC_STATUS_SUCCESS && status != DC_STATUS_UNSUPPORTED) {
+		ERROR ("Error parsing the datetime.");
+		goto cleanup;
+	}
+
+	// Parse the divetime.
+	message ("Parsing the divetime.\n");
+	unsigned int divetime = 0;
+	status = dc_parser_get_field (parser, DC_FIELD_DIVETIME, 0, &divetime);
+	if (status != DC_STATUS_SUCCESS && status != DC_STATUS_UNSUPPORTED) {
+		ERROR ("Error parsing the divetime.");
+		goto cleanup;
+	}
+
+	// Parse the maxdepth.
+	message ("Parsing the maxdepth.\n");
+	double maxdepth = 0.0;
+	status = dc_parser_get_field (parser, DC_FIELD_MAXDEPTH, 0, &maxdepth);
+	if (status != DC_STATUS_SUCCESS && status != DC_STATUS_UNSUPPORTED) {
+		ERROR ("Error parsing the maxdepth.");
+		goto cleanup;
+	}
+
+	// Parse the sample data.
+	message ("Parsing the sample data.\n");
+	status = dc_parser_samples_foreach (parser, sample_cb, &sampledata);
+	if (status != DC_STATUS_SUCCESS) {
+		ERROR ("Error parsing the sample data.");
+		goto cleanup;
+	}
+
+	// Write the dive header.
+	bin_write_uint32 (output->ostream, abstract->number);
+	bin_write_uint32 (output->ostream, size);
+	unsigned char datetime[8] = {0};
+	datetime[0] = (dt.year     ) & 0xFF;
+	datetime[1] = (dt.year >> 8) & 0xFF;
+	datetime[2] = dt.month;
+	datetime[3] = dt.day;
+	datetime[4] = dt.hour;
+	datetime[5] = dt.minute;
+	datetime[6] = dt.second;
+	fwrite (datetime, 1, sizeof(datetime), output->ostream);
+	bin_write_uint32 (output->ostream, divetime);
+	bin_write_uint32 (output->ostream, (unsigned int) (maxdepth * 1000.0 + 0.5));
+
+	// Write the fingerprint, padded to a multiple of four bytes.
+	const unsigned char padding[4] = {0};
+	bin_write_uint32 (output->ostream, fingerprint ? fsize : 0);
+	if (fingerprint) {
+		fwrite (fingerprint, 1, fsize, output->ostream);
+		if (fsize % 4)
+			fwrite (padding, 1, 4 - fsize % 4, output->ostream);
+	}
+
+	// Count the non-empty columns.
+	unsigned int ncolumns = 0;
+	for (unsigned int i = 0; i < NCOLUMNS; ++i) {
+		if (dc_buffer_get_size (sampledata.columns[i]))
+			ncolumns++;
+	}
+	bin_write_uint32 (output->ostream, ncolumns);
+
+	// Write the column blocks.
+	for (unsigned int i = 0; i < NCOLUMNS; ++i) {
+		static const unsigned int widths[NCOLUMNS] = {
+			4,  /* DC_SAMPLE_TIME */
+			8,  /* DC_SAMPLE_DEPTH */
+			12, /* DC_SAMPLE_PRESSURE */
+			8,  /* DC_SAMPLE_TEMPERATURE */
+			20, /* DC_SAMPLE_EVENT */
+			8,  /* DC_SAMPLE_RBT */
+			8,  /* DC_SAMPLE_HEARTBEAT */
+			8,  /* DC_SAMPLE_BEARING */
+			0,  /* DC_SAMPLE_VENDOR (variable width, not stored) */
+			8,  /* DC_SAMPLE_SETPOINT */
+			8,  /* DC_SAMPLE_PPO2 */
+			8,  /* DC_SAMPLE_CNS */
+			16, /* DC_SAMPLE_DECO */
+			8,  /* DC_SAMPLE_GASMIX */
+		};
+
+		size_t length = dc_buffer_get_size (sampledata.columns[i]);
+		if (length == 0)
+			continue;
+
+		bin_write_uint32 (output->ostream, i);
+		bin_write_uint32 (output->ostream, widths[i]);
+		bin_write_uint32 (output->ostream, length / widths[i]);
+		fwrite (dc_buffer_get_data (sampledata.columns[i]), 1, length, output->ostream);
+	}
+
+	// Push the completed record to the OS, so a crash later in the
+	// session doesn't lose it.
+	fflush (output->ostream);
+
+	output->ndives++;
+
+cleanup:
+	for (unsigned int i = 0; i < NCOLUMNS; ++i) {
+		dc_buffer_free (sampledata.columns[i]);
+	}
+
+	return status;
+}
+
+static dc_status_t
+dctool_bin_output_free (dctool_output_t *abstract)
+{
+	dctool_bin_output_t *output = (dctool_bin_output_t *) abstract;
+
+	// Patch the number of dives in the file header.
+	if (fseek (output->ostream, 8, SEEK_SET) == 0) {
+		bin_write_uint32 (output->ostream, output->ndives);
+	}
+
+	fclose (output->ostream);
+
+	return DC_STATUS_SUCCESS;
+}
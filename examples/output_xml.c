@@ -34,6 +34,7 @@ static dc_status_t dctool_xml_output_free (dctool_output_t *output);
 typedef struct dctool_xml_output_t {
 	dctool_output_t base;
 	FILE *ostream;
+	dctool_writer_t writer;
 	dctool_units_t units;
 } dctool_xml_output_t;
 
@@ -44,7 +45,7 @@ static const dctool_output_vtable_t xml_vtable = {
 };
 
 typedef struct sample_data_t {
-	FILE *ostream;
+	dctool_writer_t *writer;
 	dctool_units_t units;
 	unsigned int nsamples;
 } sample_data_t;
@@ -103,65 +104,102 @@ sample_cb (dc_sample_type_t type, dc_sample_value_t value, void *userdata)
 		"ndl", "safety", "deco", "deep"};
 
 	sample_data_t *sampledata = (sample_data_t *) userdata;
+	dctool_writer_t *writer = sampledata->writer;
 
 	switch (type) {
 	case DC_SAMPLE_TIME:
 		if (sampledata->nsamples++)
-			fprintf (sampledata->ostream, "</sample>\n");
-		fprintf (sampledata->ostream, "<sample>\n");
-		fprintf (sampledata->ostream, "   <time>%02u:%02u</time>\n", value.time / 60, value.time % 60);
+			dctool_writer_string (writer, "</sample>\n");
+		dctool_writer_string (writer, "<sample>\n   <time>");
+		dctool_writer_uint (writer, value.time / 60, 2);
+		dctool_writer_string (writer, ":");
+		dctool_writer_uint (writer, value.time % 60, 2);
+		dctool_writer_string (writer, "</time>\n");
 		break;
 	case DC_SAMPLE_DEPTH:
-		fprintf (sampledata->ostream, "   <depth>%.2f</depth>\n",
-			convert_depth(value.depth, sampledata->units));
+		dctool_writer_string (writer, "   <depth>");
+		dctool_writer_fixed (writer, convert_depth(value.depth, sampledata->units), 2);
+		dctool_writer_string (writer, "</depth>\n");
 		break;
 	case DC_SAMPLE_PRESSURE:
-		fprintf (sampledata->ostream, "   <pressure tank=\"%u\">%.2f</pressure>\n",
-			value.pressure.tank,
-			convert_pressure(value.pressure.value, sampledata->units));
+		dctool_writer_string (writer, "   <pressure tank=\"");
+		dctool_writer_uint (writer, value.pressure.tank, 0);
+		dctool_writer_string (writer, "\">");
+		dctool_writer_fixed (writer, convert_pressure(value.pressure.value, sampledata->units), 2);
+		dctool_writer_string (writer, "</pressure>\n");
 		break;
 	case DC_SAMPLE_TEMPERATURE:
-		fprintf (sampledata->ostream, "   <temperature>%.2f</temperature>\n",
-			convert_temperature(value.temperature, sampledata->units));
+		dctool_writer_string (writer, "   <temperature>");
+		dctool_writer_fixed (writer, convert_temperature(value.temperature, sampledata->units), 2);
+		dctool_writer_string (writer, "</temperature>\n");
 		break;
 	case DC_SAMPLE_EVENT:
 		if (value.event.type != SAMPLE_EVENT_GASCHANGE && value.event.type != SAMPLE_EVENT_GASCHANGE2) {
-			fprintf (sampledata->ostream, "   <event type=\"%u\" time=\"%u\" flags=\"%u\" value=\"%u\">%s</event>\n",
-				value.event.type, value.event.time, value.event.flags, value.event.value, events[value.event.type]);
+			dctool_writer_string (writer, "   <event type=\"");
+			dctool_writer_uint (writer, value.event.type, 0);
+			dctool_writer_string (writer, "\" time=\"");
+			dctool_writer_uint (writer, value.event.time, 0);
+			dctool_writer_string (writer, "\" flags=\"");
+			dctool_writer_uint (writer, value.event.flags, 0);
+			dctool_writer_string (writer, "\" value=\"");
+			dctool_writer_uint (writer, value.event.value, 0);
+			dctool_writer_string (writer, "\">");
+			dctool_writer_string (writer, events[value.event.type]);
+			dctool_writer_string (writer, "</event>\n");
 		}
 		break;
 	case DC_SAMPLE_RBT:
-		fprintf (sampledata->ostream, "   <rbt>%u</rbt>\n", value.rbt);
+		dctool_writer_string (writer, "   <rbt>");
+		dctool_writer_uint (writer, value.rbt, 0);
+		dctool_writer_string (writer, "</rbt>\n");
 		break;
 	case DC_SAMPLE_HEARTBEAT:
-		fprintf (sampledata->ostream, "   <heartbeat>%u</heartbeat>\n", value.heartbeat);
+		dctool_writer_string (writer, "   <heartbeat>");
+		dctool_writer_uint (writer, value.heartbeat, 0);
+		dctool_writer_string (writer, "</heartbeat>\n");
 		break;
 	case DC_SAMPLE_BEARING:
-		fprintf (sampledata->ostream, "   <bearing>%u</bearing>\n", value.bearing);
+		dctool_writer_string (writer, "   <bearing>");
+		dctool_writer_uint (writer, value.bearing, 0);
+		dctool_writer_string (writer, "</bearing>\n");
 		break;
 	case DC_SAMPLE_VENDOR:
-		fprintf (sampledata->ostream, "   <vendor type=\"%u\" size=\"%u\">", value.vendor.type, value.vendor.size);
-		for (unsigned int i = 0; i < value.vendor.size; ++i)
-			fprintf (sampledata->ostream, "%02X", ((unsigned char *) value.vendor.data)[i]);
-		fprintf (sampledata->ostream, "</vendor>\n");
+		dctool_writer_string (writer, "   <vendor type=\"");
+		dctool_writer_uint (writer, value.vendor.type, 0);
+		dctool_writer_string (writer, "\" size=\"");
+		dctool_writer_uint (writer, value.vendor.size, 0);
+		dctool_writer_string (writer, "\">");
+		dctool_writer_hex (writer, (const unsigned char *) value.vendor.data, value.vendor.size);
+		dctool_writer_string (writer, "</vendor>\n");
 		break;
 	case DC_SAMPLE_SETPOINT:
-		fprintf (sampledata->ostream, "   <setpoint>%.2f</setpoint>\n", value.setpoint);
+		dctool_writer_string (writer, "   <setpoint>");
+		dctool_writer_fixed (writer, value.setpoint, 2);
+		dctool_writer_string (writer, "</setpoint>\n");
 		break;
 	case DC_SAMPLE_PPO2:
-		fprintf (sampledata->ostream, "   <ppo2>%.2f</ppo2>\n", value.ppo2);
+		dctool_writer_string (writer, "   <ppo2>");
+		dctool_writer_fixed (writer, value.ppo2, 2);
+		dctool_writer_string (writer, "</ppo2>\n");
 		break;
 	case DC_SAMPLE_CNS:
-		fprintf (sampledata->ostream, "   <cns>%.1f</cns>\n", value.cns * 100.0);
+		dctool_writer_string (writer, "   <cns>");
+		dctool_writer_fixed (writer, value.cns * 100.0, 1);
+		dctool_writer_string (writer, "</cns>\n");
 		break;
 	case DC_SAMPLE_DECO:
-		fprintf (sampledata->ostream, "   <deco time=\"%u\" depth=\"%.2f\">%s</deco>\n",
-			value.deco.time,
-			convert_depth(value.deco.depth, sampledata->units),
-			decostop[value.deco.type]);
+		dctool_writer_string (writer, "   <deco time=\"");
+		dctool_writer_uint (writer, value.deco.time, 0);
+		dctool_writer_string (writer, "\" depth=\"");
+		dctool_writer_fixed (writer, convert_depth(value.deco.depth, sampledata->units), 2);
+		dctool_writer_string (writer, "\">");
+		dctool_writer_string (writer, decostop[value.deco.type]);
+		dctool_writer_string (writer, "</deco>\n");
 		break;
 	case DC_SAMPLE_GASMIX:
-		fprintf (sampledata->ostream, "   <gasmix>%u</gasmix>\n", value.gasmix);
+		dctool_writer_string (writer, "   <gasmix>");
+		dctool_writer_uint (writer, value.gasmix, 0);
+		dctool_writer_string (writer, "</gasmix>\n");
 		break;
 	default:
 		break;
@@ -188,9 +226,11 @@ dctool_xml_output_new (const char *filename, dctool_units_t units)
 		goto error_free;
 	}
 
+	dctool_writer_init (&output->writer, output->ostream);
+
 	output->units = units;
 
-	fprintf (output->ostream, "<device>\n");
+	dctool_writer_string (&output->writer, "<device>\n");
 
 	return (dctool_output_t *) output;
 
@@ -204,21 +244,25 @@ static dc_status_t
 dctool_xml_output_write (dctool_output_t *abstract, dc_parser_t *parser, const unsigned char data[], unsigned int size, const unsigned char fingerprint[], unsigned int fsize)
 {
 	dctool_xml_output_t *output = (dctool_xml_output_t *) abstract;
+	dctool_writer_t *writer = &output->writer;
 	dc_status_t status = DC_STATUS_SUCCESS;
 
 	// Initialize the sample data.
 	sample_data_t sampledata = {0};
 	sampledata.nsamples = 0;
-	sampledata.ostream = output->ostream;
+	sampledata.writer = writer;
 	sampledata.units = output->units;
 
-	fprintf (output->ostream, "<dive>\n<number>%u</number>\n<size>%u</size>\n", abstract->number, size);
+	dctool_writer_string (writer, "<dive>\n<number>");
+	dctool_writer_uint (writer, abstract->number, 0);
+	dctool_writer_string (writer, "</number>\n<size>");
+	dctool_writer_uint (writer, size, 0);
+	dctool_writer_string (writer, "</size>\n");
 
 	if (fingerprint) {
-		fprintf (output->ostream, "<fingerprint>");
-		for (unsigned int i = 0; i < fsize; ++i)
-			fprintf (output->ostream, "%02X", fingerprint[i]);
-		fprintf (output->ostream, "</fingerprint>\n");
+		dctool_writer_string (writer, "<fingerprint>");
+		dctool_writer_hex (writer, fingerprint, fsize);
+		dctool_writer_string (writer, "</fingerprint>\n");
 	}
 
 	// Parse the datetime.
@@ -230,9 +274,19 @@ dctool_xml_output_write (dctool_output_t *abstract, dc_parser_t *parser, const u
 		goto cleanup;
 	}
 
-	fprintf (output->ostream, "<datetime>%04i-%02i-%02i %02i:%02i:%02i</datetime>\n",
-		dt.year, dt.month, dt.day,
-		dt.hour, dt.minute, dt.second);
+	dctool_writer_string (writer, "<datetime>");
+	dctool_writer_int (writer, dt.year, 4);
+	dctool_writer_string (writer, "-");
+	dctool_writer_int (writer, dt.month, 2);
+	dctool_writer_string (writer, "-");
+	dctool_writer_int (writer, dt.day, 2);
+	dctool_writer_string (writer, " ");
+	dctool_writer_int (writer, dt.hour, 2);
+	dctool_writer_string (writer, ":");
+	dctool_writer_int (writer, dt.minute, 2);
+	dctool_writer_string (writer, ":");
+	dctool_writer_int (writer, dt.second, 2);
+	dctool_writer_string (writer, "</datetime>\n");
 
 	// Parse the divetime.
 	message ("Parsing the divetime.\n");
@@ -243,8 +297,11 @@ dctool_xml_output_write (dctool_output_t *abstract, dc_parser_t *parser, const u
 		goto cleanup;
 	}
 
-	fprintf (output->ostream, "<divetime>%02u:%02u</divetime>\n",
-		divetime / 60, divetime % 60);
+	dctool_writer_string (writer, "<divetime>");
+	dctool_writer_uint (writer, divetime / 60, 2);
+	dctool_writer_string (writer, ":");
+	dctool_writer_uint (writer, divetime % 60, 2);
+	dctool_writer_string (writer, "</divetime>\n");
 
 	// Parse the maxdepth.
 	message ("Parsing the maxdepth.\n");
@@ -255,8 +312,9 @@ dctool_xml_output_write (dctool_output_t *abstract, dc_parser_t *parser, const u
 		goto cleanup;
 	}
 
-	fprintf (output->ostream, "<maxdepth>%.2f</maxdepth>\n",
-		convert_depth(maxdepth, output->units));
+	dctool_writer_string (writer, "<maxdepth>");
+	dctool_writer_fixed (writer, convert_depth(maxdepth, output->units), 2);
+	dctool_writer_string (writer, "</maxdepth>\n");
 
 	// Parse the temperature.
 	message ("Parsing the temperature.\n");
@@ -274,9 +332,11 @@ dctool_xml_output_write (dctool_output_t *abstract, dc_parser_t *parser, const u
 		}
 
 		if (status != DC_STATUS_UNSUPPORTED) {
-			fprintf (output->ostream, "<temperature type=\"%s\">%.1f</temperature>\n",
-				names[i],
-				convert_temperature(temperature, output->units));
+			dctool_writer_string (writer, "<temperature type=\"");
+			dctool_writer_string (writer, names[i]);
+			dctool_writer_string (writer, "\">");
+			dctool_writer_fixed (writer, convert_temperature(temperature, output->units), 1);
+			dctool_writer_string (writer, "</temperature>\n");
 		}
 	}
 
@@ -297,15 +357,13 @@ dctool_xml_output_write (dctool_output_t *abstract, dc_parser_t *parser, const u
 			goto cleanup;
 		}
 
-		fprintf (output->ostream,
-			"<gasmix>\n"
-			"   <he>%.1f</he>\n"
-			"   <o2>%.1f</o2>\n"
-			"   <n2>%.1f</n2>\n"
-			"</gasmix>\n",
-			gasmix.helium * 100.0,
-			gasmix.oxygen * 100.0,
-			gasmix.nitrogen * 100.0);
+		dctool_writer_string (writer, "<gasmix>\n   <he>");
+		dctool_writer_fixed (writer, gasmix.helium * 100.0, 1);
+		dctool_writer_string (writer, "</he>\n   <o2>");
+		dctool_writer_fixed (writer, gasmix.oxygen * 100.0, 1);
+		dctool_writer_string (writer, "</o2>\n   <n2>");
+		dctool_writer_fixed (writer, gasmix.nitrogen * 100.0, 1);
+		dctool_writer_string (writer, "</n2>\n</gasmix>\n");
 	}
 
 	// Parse the tanks.
@@ -327,27 +385,26 @@ dctool_xml_output_write (dctool_output_t *abstract, dc_parser_t *parser, const u
 			goto cleanup;
 		}
 
-		fprintf (output->ostream, "<tank>\n");
+		dctool_writer_string (writer, "<tank>\n");
 		if (tank.gasmix != DC_GASMIX_UNKNOWN) {
-			fprintf (output->ostream,
-				"   <gasmix>%u</gasmix>\n",
-				tank.gasmix);
+			dctool_writer_string (writer, "   <gasmix>");
+			dctool_writer_uint (writer, tank.gasmix, 0);
+			dctool_writer_string (writer, "</gasmix>\n");
 		}
 		if (tank.type != DC_TANKVOLUME_NONE) {
-			fprintf (output->ostream,
-				"   <type>%s</type>\n"
-				"   <volume>%.1f</volume>\n"
-				"   <workpressure>%.2f</workpressure>\n",
-				names[tank.type],
-				convert_volume(tank.volume, output->units),
-				convert_pressure(tank.workpressure, output->units));
+			dctool_writer_string (writer, "   <type>");
+			dctool_writer_string (writer, names[tank.type]);
+			dctool_writer_string (writer, "</type>\n   <volume>");
+			dctool_writer_fixed (writer, convert_volume(tank.volume, output->units), 1);
+			dctool_writer_string (writer, "</volume>\n   <workpressure>");
+			dctool_writer_fixed (writer, convert_pressure(tank.workpressure, output->units), 2);
+			dctool_writer_string (writer, "</workpressure>\n");
 		}
-		fprintf (output->ostream,
-			"   <beginpressure>%.2f</beginpressure>\n"
-			"   <endpressure>%.2f</endpressure>\n"
-			"</tank>\n",
-			convert_pressure(tank.beginpressure, output->units),
-			convert_pressure(tank.endpressure, output->units));
+		dctool_writer_string (writer, "   <beginpressure>");
+		dctool_writer_fixed (writer, convert_pressure(tank.beginpressure, output->units), 2);
+		dctool_writer_string (writer, "</beginpressure>\n   <endpressure>");
+		dctool_writer_fixed (writer, convert_pressure(tank.endpressure, output->units), 2);
+		dctool_writer_string (writer, "</endpressure>\n</tank>\n");
 	}
 
 	// Parse the dive mode.
@@ -361,8 +418,9 @@ dctool_xml_output_write (dctool_output_t *abstract, dc_parser_t *parser, const u
 
 	if (status != DC_STATUS_UNSUPPORTED) {
 		const char *names[] = {"freedive", "gauge", "oc", "cc"};
-		fprintf (output->ostream, "<divemode>%s</divemode>\n",
-			names[divemode]);
+		dctool_writer_string (writer, "<divemode>");
+		dctool_writer_string (writer, names[divemode]);
+		dctool_writer_string (writer, "</divemode>\n");
 	}
 
 	// Parse the salinity.
@@ -375,8 +433,11 @@ dctool_xml_output_write (dctool_output_t *abstract, dc_parser_t *parser, const u
 	}
 
 	if (status != DC_STATUS_UNSUPPORTED) {
-		fprintf (output->ostream, "<salinity type=\"%u\">%.1f</salinity>\n",
-			salinity.type, salinity.density);
+		dctool_writer_string (writer, "<salinity type=\"");
+		dctool_writer_uint (writer, salinity.type, 0);
+		dctool_writer_string (writer, "\">");
+		dctool_writer_fixed (writer, salinity.density, 1);
+		dctool_writer_string (writer, "</salinity>\n");
 	}
 
 	// Parse the atmospheric pressure.
@@ -389,8 +450,9 @@ dctool_xml_output_write (dctool_output_t *abstract, dc_parser_t *parser, const u
 	}
 
 	if (status != DC_STATUS_UNSUPPORTED) {
-		fprintf (output->ostream, "<atmospheric>%.5f</atmospheric>\n",
-			convert_pressure(atmospheric, output->units));
+		dctool_writer_string (writer, "<atmospheric>");
+		dctool_writer_fixed (writer, convert_pressure(atmospheric, output->units), 5);
+		dctool_writer_string (writer, "</atmospheric>\n");
 	}
 
 	// Parse the sample data.
@@ -404,8 +466,11 @@ dctool_xml_output_write (dctool_output_t *abstract, dc_parser_t *parser, const u
 cleanup:
 
 	if (sampledata.nsamples)
-		fprintf (output->ostream, "</sample>\n");
-	fprintf (output->ostream, "</dive>\n");
+		dctool_writer_string (writer, "</sample>\n");
+	dctool_writer_string (writer, "</dive>\n");
+	// Push the completed dive to the OS, so a crash later in the
+	// session doesn't lose it.
+	dctool_writer_sync (writer);
 
 	return status;
 }
@@ -415,7 +480,8 @@ dctool_xml_output_free (dctool_output_t *abstract)
 {
 	dctool_xml_output_t *output = (dctool_xml_output_t *) abstract;
 
-	fprintf (output->ostream, "</device>\n");
+	dctool_writer_string (&output->writer, "</device>\n");
+	dctool_writer_flush (&output->writer);
 
 	fclose (output->ostream);
 
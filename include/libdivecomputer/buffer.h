@@ -30,21 +30,63 @@ extern "C" {
 
 typedef struct dc_buffer_t dc_buffer_t;
 
+/*
+ * The growth policy of a buffer, applied when an append or resize
+ * exceeds the current capacity.
+ */
+typedef enum dc_buffer_growth_t {
+	DC_BUFFER_GROWTH_DOUBLE, /**< Double the capacity (the default). */
+	DC_BUFFER_GROWTH_EXACT, /**< Allocate exactly the requested size. */
+	DC_BUFFER_GROWTH_CHUNKED /**< Round up to a multiple of the chunk size. */
+} dc_buffer_growth_t;
+
 dc_buffer_t *
 dc_buffer_new (size_t capacity);
 
+/*
+ * Create a view on a range of the buffer. The view shares the
+ * allocation of the parent buffer, so trimming headers or splitting a
+ * download doesn't copy the payload. The view keeps the parent alive,
+ * and is released with dc_buffer_free. Modifying a view detaches it
+ * from the parent with a copy; operations that would move the data of
+ * a buffer with outstanding views fail instead.
+ */
+dc_buffer_t *
+dc_buffer_view (dc_buffer_t *buffer, size_t offset, size_t size);
+
 void
 dc_buffer_free (dc_buffer_t *buffer);
 
 int
 dc_buffer_clear (dc_buffer_t *buffer);
 
+/*
+ * Set the growth policy of the buffer. The default doubling policy
+ * gives amortized constant time appends when the final size is
+ * unknown. When the caller can plan the capacity — the total size is
+ * known, or the data arrives in fixed size packets — the exact or
+ * chunked policy avoids the over-allocation and the repeated copies
+ * around the doubling boundaries. The chunk size is only used by the
+ * chunked policy, and must not be zero there.
+ */
+int
+dc_buffer_set_growth (dc_buffer_t *buffer, dc_buffer_growth_t growth, size_t chunksize);
+
 int
 dc_buffer_reserve (dc_buffer_t *buffer, size_t capacity);
 
 int
 dc_buffer_resize (dc_buffer_t *buffer, size_t size);
 
+/*
+ * Variant of dc_buffer_resize that leaves a grown region
+ * uninitialized, for callers that are about to overwrite it anyway,
+ * such as a dump reading the device memory straight into the buffer.
+ * Shrinking behaves exactly like dc_buffer_resize.
+ */
+int
+dc_buffer_extend (dc_buffer_t *buffer, size_t size);
+
 int
 dc_buffer_append (dc_buffer_t *buffer, const unsigned char data[], size_t size);
 
@@ -23,6 +23,7 @@
 #define DC_CONTEXT_H
 
 #include "common.h"
+#include "buffer.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -47,12 +48,192 @@ dc_context_new (dc_context_t **context);
 dc_status_t
 dc_context_free (dc_context_t *context);
 
+/*
+ * Eagerly initialize the state that the library otherwise builds
+ * lazily on first use (the descriptor lookup index, the shared worker
+ * pool). Everything works without this call; it only moves the one-time
+ * setup cost to a moment of the application's choosing. Long-running
+ * applications can warm up right after dc_context_new, while short
+ * lived invocations that may never need the state simply skip it.
+ */
+dc_status_t
+dc_context_warmup (dc_context_t *context);
+
 dc_status_t
 dc_context_set_loglevel (dc_context_t *context, dc_loglevel_t loglevel);
 
 dc_status_t
 dc_context_set_logfunc (dc_context_t *context, dc_logfunc_t logfunc, void *userdata);
 
+/*
+ * A fixed size binary log record, for the deferred formatting log ring.
+ * Message records store the format string and the decoded arguments
+ * instead of formatted text: numeric arguments in the args array (in
+ * format order, doubles as their bit pattern), and string arguments
+ * copied into the strings area (NUL separated, with the offset stored
+ * in args). Hexdump records store the raw data bytes in the strings
+ * area, without the hexadecimal text expansion. The file, function and
+ * format pointers refer to static strings with program lifetime, so the
+ * records can be formatted at any later time within the same process.
+ * Arguments that do not fit are dropped; the formatter marks the
+ * truncation.
+ */
+#define DC_LOGRECORD_MESSAGE 0
+#define DC_LOGRECORD_HEXDUMP 1
+
+#define DC_LOGRECORD_MAXARGS 6
+#define DC_LOGRECORD_MAXSTRINGS 48
+
+typedef struct dc_logrecord_t {
+	unsigned int sequence;
+	unsigned int type;
+	dc_loglevel_t loglevel;
+	unsigned int line;
+	unsigned long long timestamp;
+	const char *file;
+	const char *function;
+	const char *format;
+	unsigned int nargs;
+	unsigned int nstrings;
+	unsigned long long args[DC_LOGRECORD_MAXARGS];
+	char strings[DC_LOGRECORD_MAXSTRINGS];
+} dc_logrecord_t;
+
+/*
+ * Install a caller provided array of log records as the log sink,
+ * replacing the text callback until it is uninstalled again with a
+ * NULL array. Messages are captured as binary records, without the
+ * per-message printf formatting, so running at DC_LOGLEVEL_DEBUG
+ * during performance investigations stays affordable. The array is
+ * used as a ring: a record is overwritten by the record that is
+ * exactly 'count' sequence numbers younger, newer records win. The
+ * sequence numbers start at one (zero marks a never written slot) and
+ * have no gaps. Records are written under the context lock; a reader
+ * inspecting the ring while the library is active should copy a record
+ * and verify the sequence number afterwards to detect a concurrent
+ * overwrite.
+ */
+dc_status_t
+dc_context_set_logring (dc_context_t *context, dc_logrecord_t records[], unsigned int count);
+
+/*
+ * Format a binary log record back into text, equivalent (but not
+ * always byte identical) to what the text callback would have
+ * received. This is the offline half of the log ring: the formatting
+ * cost is paid here, after the fact, instead of on the hot path.
+ */
+dc_status_t
+dc_logrecord_format (const dc_logrecord_t *record, char *str, size_t size);
+
+/*
+ * Keep the transport connection alive across device sessions. When
+ * enabled, closing a device parks its (still configured) connection
+ * instead of closing it, and a subsequent open of the same device
+ * revives the parked connection. This makes repeated open and close
+ * cycles on the same physical device (e.g. probing followed by a
+ * download) considerably faster, because the port setup and the
+ * settle delays are skipped. A parked connection that went stale, for
+ * example because the cable was unplugged, is detected and reopened
+ * from scratch.
+ */
+dc_status_t
+dc_context_set_keepalive (dc_context_t *context, unsigned int value);
+
+/*
+ * The classification of a transfer for the scheduler callback.
+ */
+typedef enum dc_transfer_class_t {
+	DC_TRANSFER_CONTROL, /**< Short command or handshake exchange. */
+	DC_TRANSFER_BULK /**< Large streaming transfer. */
+} dc_transfer_class_t;
+
+typedef void (*dc_scheduler_callback_t) (dc_transfer_class_t type, size_t size, void *userdata);
+
+/*
+ * Register a transfer scheduler. The callback is invoked before every
+ * transfer on the transport connections opened under this context,
+ * with the transfer classified as a control exchange or a bulk
+ * transfer by comparing its size against the threshold: transfers
+ * larger than the threshold are classified as bulk. The callback may
+ * block to delay the transfer. This allows an application downloading
+ * from multiple devices over a shared bus to keep the short command
+ * exchanges of one connection responsive, while the bulk streams of
+ * the others consume the remaining bandwidth, instead of leaving the
+ * interleaving to the kernel. Connections already open keep the
+ * scheduler they inherited at open time.
+ */
+dc_status_t
+dc_context_set_scheduler (dc_context_t *context, dc_scheduler_callback_t callback, void *userdata, size_t threshold);
+
+/*
+ * Restrict the worker pool used by the parallel operations (such as
+ * dc_parser_parse_many) to the given list of logical processor cores.
+ * The workers are pinned round-robin over the list. On multi-socket
+ * machines, pinning the workers to the socket holding the dive buffers
+ * avoids parsing across the interconnect; with the usual first-touch
+ * memory policy, that is the socket where the download ran. The hint
+ * applies to the workers immediately if the pool already exists, and
+ * otherwise when it is created. An empty list (ncores zero) releases
+ * the workers to run on any core again. Returns DC_STATUS_UNSUPPORTED
+ * on platforms without an affinity interface, where thread placement
+ * remains under control of the operating system.
+ */
+dc_status_t
+dc_context_set_affinity (dc_context_t *context, const unsigned int cores[], unsigned int ncores);
+
+typedef void *(*dc_malloc_func_t) (size_t size, void *userdata);
+typedef void *(*dc_realloc_func_t) (void *ptr, size_t size, void *userdata);
+typedef void (*dc_free_func_t) (void *ptr, void *userdata);
+
+/*
+ * Install a custom allocator for the internal allocations of the
+ * objects owned by this context (devices, parsers and their per-dive
+ * arenas). Either all three functions are provided, or all three are
+ * NULL to restore the system allocator. The allocator must be
+ * installed right after creating the context, before any other object
+ * is created from it, so every allocation is released through the
+ * same allocator it came from.
+ */
+dc_status_t
+dc_context_set_allocator (dc_context_t *context, dc_malloc_func_t malloc_func, dc_realloc_func_t realloc_func, dc_free_func_t free_func, void *userdata);
+
+/*
+ * Retrieve the cumulative number of bytes and allocations requested
+ * through the context since its creation. The counters also advance
+ * with the system allocator, so the allocation churn of an operation
+ * can be measured by taking a snapshot before and after.
+ */
+dc_status_t
+dc_context_allocation_stats (dc_context_t *context, unsigned long long *nbytes, unsigned long long *nallocs);
+
+/*
+ * Retrieve the currently live number of bytes, and the high-water mark
+ * of live bytes, of the allocations routed through the context. To
+ * measure the peak memory of a single operation (a dump, an
+ * enumeration, a parse), reset the mark just before the operation and
+ * query it right after; the reset lowers the mark to the current live
+ * size. Only allocations made through the context allocator are
+ * counted, so the application's own buffers (e.g. the dc_buffer_t
+ * passed to dc_device_dump) are not included.
+ */
+dc_status_t
+dc_context_allocation_peak (dc_context_t *context, unsigned long long *live, unsigned long long *peak);
+
+dc_status_t
+dc_context_allocation_peak_reset (dc_context_t *context);
+
+/*
+ * Acquire a buffer from the pool of the context, or allocate a new
+ * one if the pool is empty. The buffer has at least the requested
+ * capacity, and is returned to the pool with the release function,
+ * so repeated operations reuse the same allocations.
+ */
+dc_buffer_t *
+dc_context_buffer_acquire (dc_context_t *context, size_t capacity);
+
+void
+dc_context_buffer_release (dc_context_t *context, dc_buffer_t *buffer);
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
@@ -22,6 +22,8 @@
 #ifndef DC_DATETIME_H
 #define DC_DATETIME_H
 
+#include <stddef.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif /* __cplusplus */
@@ -52,6 +54,25 @@ dc_datetime_t *
 dc_datetime_gmtime (dc_datetime_t *result,
                     dc_ticks_t ticks);
 
+/*
+ * Convert an array of ticks to broken-down calendar times in one call.
+ * Equivalent to calling dc_datetime_localtime (respectively
+ * dc_datetime_gmtime) on every element, but consecutive ticks that fall
+ * close together are derived from a cached conversion with integer
+ * arithmetic only, which is considerably faster for long monotonic
+ * sequences such as per-sample timestamps. Returns the result array, or
+ * NULL on failure.
+ */
+dc_datetime_t *
+dc_datetime_localtime_batch (dc_datetime_t result[],
+                             const dc_ticks_t ticks[],
+                             size_t count);
+
+dc_datetime_t *
+dc_datetime_gmtime_batch (dc_datetime_t result[],
+                          const dc_ticks_t ticks[],
+                          size_t count);
+
 dc_ticks_t
 dc_datetime_mktime (const dc_datetime_t *dt);
 
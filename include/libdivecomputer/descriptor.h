@@ -41,6 +41,36 @@ typedef struct dc_descriptor_t dc_descriptor_t;
 dc_status_t
 dc_descriptor_iterator (dc_iterator_t **iterator);
 
+/*
+ * Variant of dc_descriptor_iterator that only visits the descriptors
+ * matching the given family and/or transport. Pass DC_FAMILY_NULL
+ * (respectively DC_TRANSPORT_NONE) to not filter on that property.
+ */
+dc_status_t
+dc_descriptor_iterator_filter (dc_iterator_t **iterator, dc_family_t family, dc_transport_t transport);
+
+/*
+ * Resolve a (family, model) pair to its descriptor with an indexed
+ * lookup, without iterating the entire descriptor table. If several
+ * products share the same model number, the first entry is returned.
+ * Returns DC_STATUS_UNSUPPORTED if there is no matching descriptor.
+ */
+dc_status_t
+dc_descriptor_lookup (dc_descriptor_t **descriptor, dc_family_t family, unsigned int model);
+
+/*
+ * Copy (up to size) pointers to all available descriptors into the
+ * caller provided array, and store the total number of descriptors in
+ * count. Call with a zero size to query the required array size.
+ *
+ * Descriptor objects are immutable and remain valid for the lifetime of
+ * the process, so the snapshot can be taken once, cached, and shared
+ * freely between threads; no memory is allocated and nothing needs to
+ * be freed.
+ */
+dc_status_t
+dc_descriptor_snapshot (dc_descriptor_t *descriptors[], unsigned int size, unsigned int *count);
+
 void
 dc_descriptor_free (dc_descriptor_t *descriptor);
 
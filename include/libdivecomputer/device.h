@@ -37,7 +37,11 @@ typedef enum dc_event_type_t {
 	DC_EVENT_PROGRESS = (1 << 1),
 	DC_EVENT_DEVINFO = (1 << 2),
 	DC_EVENT_CLOCK = (1 << 3),
-	DC_EVENT_VENDOR = (1 << 4)
+	DC_EVENT_VENDOR = (1 << 4),
+	DC_EVENT_METRICS = (1 << 5),
+	DC_EVENT_SESSION = (1 << 6),
+	DC_EVENT_DIVESUMMARY = (1 << 7),
+	DC_EVENT_ESTIMATE = (1 << 8)
 } dc_event_type_t;
 
 typedef struct dc_device_t dc_device_t;
@@ -63,12 +67,101 @@ typedef struct dc_event_vendor_t {
 	unsigned int size;
 } dc_event_vendor_t;
 
+/*
+ * Transfer statistics, accumulated by the transport layer over the
+ * lifetime of the connection, and delivered once per session when the
+ * device is closed. The counters expose the effective throughput and
+ * the reliability of the physical link, which the progress events
+ * cannot show.
+ */
+typedef struct dc_event_metrics_t {
+	unsigned int rbytes;    /**< Number of bytes received. */
+	unsigned int wbytes;    /**< Number of bytes transmitted. */
+	unsigned int timeouts;  /**< Number of reads that ended in a timeout. */
+	unsigned int stalltime; /**< Time spent in those reads (milliseconds). */
+	unsigned int retries;   /**< Number of packet retransmissions. */
+} dc_event_metrics_t;
+
+/*
+ * Summary of an entire device session, delivered once from
+ * dc_device_close. Unlike the transfer statistics, which come from
+ * the transport layer, the summary is accumulated by the library
+ * itself, so it is available for every backend. The effective
+ * throughput of the session follows from the byte counters and the
+ * elapsed time. The byte counters are zero for backends whose
+ * transport does not report transfer statistics.
+ */
+typedef struct dc_event_session_t {
+	unsigned int elapsed;   /**< Session duration (milliseconds). */
+	unsigned int rbytes;    /**< Number of bytes received. */
+	unsigned int wbytes;    /**< Number of bytes transmitted. */
+	unsigned int retries;   /**< Number of packet retransmissions. */
+	unsigned int ndives;    /**< Number of dives delivered. */
+	unsigned int divebytes; /**< Total size of the delivered dives. */
+} dc_event_session_t;
+
+/*
+ * Early per-dive summary, emitted once per dive during dc_device_foreach
+ * while the logbook is enumerated, before the dive profiles are
+ * downloaded. On backends with a separate logbook ringbuffer (e.g. the
+ * Oceanic family), the raw logbook entry already contains the dive date
+ * and the profile location, so the application can populate its dive
+ * list immediately and fill in the profiles as the dive callbacks
+ * arrive. The number field counts the dives in delivery order, starting
+ * at 1 for the most recent dive, and the fingerprint matches the one
+ * passed to the dive callback later on. The pointers are only valid for
+ * the duration of the callback. Backends that download each dive in a
+ * single piece have no earlier moment than the dive callback itself,
+ * and do not emit this event.
+ */
+typedef struct dc_event_divesummary_t {
+	unsigned int number;              /**< Position in delivery order (1 = most recent). */
+	const unsigned char *data;        /**< Raw logbook entry. */
+	unsigned int size;                /**< Size of the logbook entry. */
+	const unsigned char *fingerprint; /**< Fingerprint of the dive. */
+	unsigned int fsize;               /**< Size of the fingerprint. */
+} dc_event_divesummary_t;
+
+/*
+ * Transfer estimate, emitted alongside each delivered progress event
+ * when subscribed. The byte counters mirror the progress event. The
+ * rate is measured by the library within the current phase of the
+ * operation, so applications get a usable time estimate without
+ * deriving rates from the raw progress stream themselves.
+ *
+ * Downloads with distinct phases (e.g. the logbook and profile passes
+ * of the Oceanic backends) transfer at different effective rates, so
+ * the measurement restarts at every phase boundary, and the remaining
+ * time only covers the current phase. The phase counter lets the
+ * application label the estimate ("phase 2 of 2"), and tells it when a
+ * new phase begins. Single-phase operations always report phase 1 of 1.
+ * The rate and remaining time are zero until the phase has made
+ * measurable progress.
+ */
+typedef struct dc_event_estimate_t {
+	unsigned int phase;     /**< Current phase, counting from 1. */
+	unsigned int nphases;   /**< Number of phases in the operation. */
+	unsigned int current;   /**< Number of bytes transferred. */
+	unsigned int maximum;   /**< Total number of bytes. */
+	unsigned int rate;      /**< Transfer rate within the phase (bytes per second). */
+	unsigned int remaining; /**< Estimated time remaining in the phase (milliseconds). */
+} dc_event_estimate_t;
+
 typedef int (*dc_cancel_callback_t) (void *userdata);
 
 typedef void (*dc_event_callback_t) (dc_device_t *device, dc_event_type_t event, const void *data, void *userdata);
 
 typedef int (*dc_dive_callback_t) (const unsigned char *data, unsigned int size, const unsigned char *fingerprint, unsigned int fsize, void *userdata);
 
+/*
+ * Ownership transfer variant of the dive callback. The callback becomes
+ * the owner of the buffer and is responsible for freeing it with
+ * dc_buffer_free, even when it aborts the enumeration by returning
+ * zero. The fingerprint pointer remains owned by the library and is
+ * only valid for the duration of the callback.
+ */
+typedef int (*dc_dive_buffer_callback_t) (dc_buffer_t *buffer, const unsigned char *fingerprint, unsigned int fsize, void *userdata);
+
 dc_status_t
 dc_device_open (dc_device_t **out, dc_context_t *context, dc_descriptor_t *descriptor, const char *name);
 
@@ -78,30 +171,360 @@ dc_device_get_type (dc_device_t *device);
 dc_status_t
 dc_device_set_cancel (dc_device_t *device, dc_cancel_callback_t callback, void *userdata);
 
+/*
+ * Request the cancellation of the ongoing operation. Unlike the
+ * callback installed with dc_device_set_cancel, which is invoked on
+ * every iteration of the transfer loops, the flag is only read there,
+ * and can be set safely from another thread. The flag remains set for
+ * the lifetime of the device.
+ */
+dc_status_t
+dc_device_cancel (dc_device_t *device);
+
+/*
+ * Wake a backend that is sleeping between two polls of a waiting loop
+ * (the loops that emit DC_EVENT_WAITING). The backends back off
+ * exponentially while nothing happens; a wake makes the backend
+ * re-probe immediately and restart the fast polling, so an application
+ * can react to a user action (e.g. a "retry" button) without waiting
+ * out the poll interval. Safe to call from another thread; a wake with
+ * no sleeper pending is remembered for the next sleep.
+ */
+dc_status_t
+dc_device_wake (dc_device_t *device);
+
+/*
+ * Override the retry behavior of the transfer loops, to fail fast on
+ * an unreliable connection instead of degrading the download to many
+ * times its nominal length. A maxretries value of -1 keeps the backend
+ * specific retry limits. The budget is a total time limit for the
+ * session in milliseconds (zero for no limit); once exceeded, the
+ * ongoing operation is aborted as if it was cancelled, and fails with
+ * DC_STATUS_CANCELLED.
+ */
+dc_status_t
+dc_device_set_retry (dc_device_t *device, int maxretries, unsigned int budget);
+
+/*
+ * Set a wall-clock deadline, in milliseconds, for each individual
+ * device operation (a read, a dump, an enumeration); zero disables the
+ * deadline. Unlike the per-transfer timeouts, which restart with every
+ * retry and can therefore compound into a multiple of their nominal
+ * value when a connection drops mid-transfer, the deadline bounds the
+ * entire operation: the transport layer checks it while waiting for
+ * data, so even a single hung read is abandoned shortly after the
+ * deadline expires. An expired deadline aborts the operation as if it
+ * was cancelled, and fails with DC_STATUS_CANCELLED. Unlike the
+ * session budget of dc_device_set_retry, the clock restarts with every
+ * operation, so a sequence of bounded operations remains possible on
+ * the same connection.
+ */
+dc_status_t
+dc_device_set_deadline (dc_device_t *device, unsigned int milliseconds);
+
+/*
+ * Limit the enumeration of dc_device_foreach, to deliver partial
+ * results quickly instead of downloading the complete logbook. The
+ * enumeration stops after maxdives dives have been delivered, or once
+ * timeout milliseconds have elapsed since the start of the enumeration
+ * (zero disables the respective limit). Dives delivered before the
+ * limit was reached remain valid, and most backends enumerate newest
+ * first, so the most recent dives arrive within the budget.
+ *
+ * The number of dives delivered so far acts as the continuation token:
+ * pass it as the skip count to resume a subsequent enumeration with
+ * the remaining dives. This assumes the dive order is unchanged between
+ * the two calls; when new dives may have been added in between, compare
+ * fingerprints instead.
+ */
+dc_status_t
+dc_device_set_foreach_limit (dc_device_t *device, unsigned int skip, unsigned int maxdives, unsigned int timeout);
+
+/*
+ * Keep the session alive while the application isn't talking to the
+ * device. Some devices drop the session after a few seconds of host
+ * inactivity, forcing a full renegotiation (and on some models a
+ * manual button press) before the next operation. With a keepalive
+ * interval configured, a background thread sends a protocol no-op
+ * exchange whenever the link has been idle for interval milliseconds.
+ * Pings are only sent while no operation is in progress: between the
+ * public device calls, and while the application's dive callback is
+ * executing during an enumeration. An interval of zero stops the
+ * service. Returns DC_STATUS_UNSUPPORTED for backends without a
+ * suitable no-op command.
+ */
+dc_status_t
+dc_device_set_keepalive (dc_device_t *device, unsigned int interval);
+
+/*
+ * Retrieve the 64 bit hash (XXH64) of the most recently delivered
+ * data. The hash is computed incrementally during the download itself,
+ * so applications using it for deduplication or integrity tracking
+ * don't need an extra pass over the data. During an enumeration
+ * (dc_device_foreach and dc_device_foreach_buffer), call it from
+ * inside the dive callback to obtain the hash of the dive being
+ * delivered. After a successful dump (dc_device_dump and
+ * dc_device_dump_stream), it returns the hash of the complete memory
+ * image. Returns DC_STATUS_UNSUPPORTED when no data has been
+ * delivered yet.
+ */
+dc_status_t
+dc_device_get_hash (dc_device_t *device, unsigned long long *hash);
+
 dc_status_t
 dc_device_set_events (dc_device_t *device, unsigned int events, dc_event_callback_t callback, void *userdata);
 
+/*
+ * Coalesce the progress events. A progress event is only delivered to
+ * the event callback when at least the given time (in milliseconds)
+ * has elapsed, or the progress has advanced by at least the given
+ * delta, since the previously delivered event. A threshold of zero is
+ * ignored, and with both thresholds zero (the default), every event is
+ * delivered. The first and last progress event are always delivered.
+ */
+dc_status_t
+dc_device_set_progress_interval (dc_device_t *device, unsigned int interval, unsigned int delta);
+
 dc_status_t
 dc_device_set_fingerprint (dc_device_t *device, const unsigned char data[], unsigned int size);
 
+/*
+ * Register an additional known fingerprint. Unlike the single
+ * fingerprint installed with dc_device_set_fingerprint, which stops
+ * the enumeration at the newest previously downloaded dive, the set
+ * built with this function filters individual dives: a dive whose
+ * fingerprint is in the set is silently skipped, while the enumeration
+ * continues. That also catches dives that arrive out of order, for
+ * example after a ringbuffer wraparound. The fingerprint is copied,
+ * and the set persists until dc_device_clear_fingerprints is called or
+ * the device is closed.
+ */
+dc_status_t
+dc_device_add_fingerprint (dc_device_t *device, const unsigned char data[], unsigned int size);
+
+dc_status_t
+dc_device_clear_fingerprints (dc_device_t *device);
+
 dc_status_t
 dc_device_version (dc_device_t *device, unsigned char data[], unsigned int size);
 
+/*
+ * Enable a page cache for dc_device_read. Page aligned reads are
+ * served from the cache when possible, so hot metadata pages (version
+ * blocks, ringbuffer pointers) are not fetched from the device again
+ * on every access. Unaligned reads bypass the cache. The page size
+ * should match the natural read granularity of the device. A size of
+ * zero (the default) disables the cache again. The cached pages are
+ * dropped when the region is written through dc_device_write, and can
+ * be dropped explicitly with dc_device_invalidate_read_cache, for
+ * example when the device contents may have changed behind the
+ * library's back.
+ */
+dc_status_t
+dc_device_set_read_cache (dc_device_t *device, unsigned int pagesize, unsigned int npages);
+
+dc_status_t
+dc_device_invalidate_read_cache (dc_device_t *device);
+
 dc_status_t
 dc_device_read (dc_device_t *device, unsigned int address, unsigned char data[], unsigned int size);
 
+/*
+ * A contiguous memory range, for the scatter-gather read.
+ */
+typedef struct dc_device_range_t {
+	unsigned int address;
+	unsigned int size;
+} dc_device_range_t;
+
+/*
+ * Read multiple memory ranges in a single operation. The ranges are
+ * stored back to back in the output buffer, whose size must equal the
+ * sum of the range sizes. Backends that can coalesce or pipeline the
+ * requests on the protocol side can take over the entire operation;
+ * otherwise adjacent ranges are merged and read with dc_device_read,
+ * so a region split by a ringbuffer wraparound is fetched with at most
+ * two transfers, through the read cache when one is enabled.
+ */
+dc_status_t
+dc_device_read_multiple (dc_device_t *device, const dc_device_range_t ranges[], unsigned int nranges, unsigned char data[], unsigned int size);
+
 dc_status_t
 dc_device_write (dc_device_t *device, unsigned int address, const unsigned char data[], unsigned int size);
 
+/*
+ * Write multiple memory ranges in a single operation. The new contents
+ * are stored back to back in the input buffer, whose size must equal
+ * the sum of the range sizes. Adjacent ranges are merged before they
+ * are written, so many small settings updates become a few larger
+ * transfers, and the written regions are verified afterwards with a
+ * single bulk read instead of a readback after every write. A
+ * verification mismatch fails with DC_STATUS_PROTOCOL; ranges written
+ * before a failure keep their new contents. On backends that cannot
+ * read their memory back, the verification is skipped.
+ */
+dc_status_t
+dc_device_write_multiple (dc_device_t *device, const dc_device_range_t ranges[], unsigned int nranges, const unsigned char data[], unsigned int size);
+
 dc_status_t
 dc_device_dump (dc_device_t *device, dc_buffer_t *buffer);
 
+/*
+ * Variant of dc_device_dump that accepts the dump from a previous
+ * session, and only transfers the memory regions that have changed
+ * since then. The result is always a complete memory dump, identical
+ * to what dc_device_dump would have returned. Backends without delta
+ * support, and any inconsistency between the previous dump and the
+ * device state, fall back to a full download.
+ */
+dc_status_t
+dc_device_dump_delta (dc_device_t *device, dc_buffer_t *buffer, dc_buffer_t *previous);
+
+/*
+ * Variant of dc_device_dump that resumes an interrupted transfer. The
+ * previous buffer contains the partial data of the earlier attempt,
+ * trimmed to the valid length reported by dc_device_dump_position.
+ * Before the data is re-used, the block at the resume position is read
+ * back and compared, and the transfer falls back to a full dump when
+ * it doesn't match, or when the backend doesn't support resuming. The
+ * check is a spot check: it catches a reconnect to a different device
+ * and new data written at the resume point, but not changes elsewhere
+ * in the already transferred region, so the token should only be
+ * re-used for an immediate retry of the same download.
+ */
+dc_status_t
+dc_device_dump_resume (dc_device_t *device, dc_buffer_t *buffer, dc_buffer_t *previous);
+
+/*
+ * Return the number of bytes of the output buffer that were filled
+ * with valid data by the last dump. After a failed dump, the prefix of
+ * that length can be saved and passed to dc_device_dump_resume on a
+ * new connection.
+ */
+dc_status_t
+dc_device_dump_position (dc_device_t *device, unsigned int *position);
+
+/*
+ * Compare two memory dumps and report the regions that have changed, as
+ * extents in the dc_device_range_t format accepted by
+ * dc_device_read_multiple. The rb_begin and rb_end parameters describe
+ * the profile ringbuffer of the memory layout; extents are split at the
+ * ringbuffer boundaries, so each extent lies entirely inside or outside
+ * the ringbuffer, and an extent ending at rb_end followed by one
+ * starting at rb_begin is a single run of new data that wrapped around.
+ * Pass zero for both when the layout is unknown. Dumps with a different
+ * size can't be compared, and yield a single extent covering the entire
+ * current dump. When there are more changed regions than the extents
+ * array can hold, the remaining regions are merged into the last
+ * extent, so the result always covers all differences, but may include
+ * some unchanged data in between.
+ */
+dc_status_t
+dc_dump_diff (dc_buffer_t *current, dc_buffer_t *previous, unsigned int rb_begin, unsigned int rb_end, dc_device_range_t extents[], unsigned int nextents, unsigned int *actual);
+
+/*
+ * The callback of the streaming dump. The chunks are delivered in
+ * order, and together form the same memory image dc_device_dump would
+ * have produced. The data pointer is only valid during the callback.
+ * Return a non-zero value to continue, or zero to abort the download.
+ */
+typedef int (*dc_dump_callback_t) (const unsigned char *data, unsigned int size, void *userdata);
+
+/*
+ * Variant of dc_device_dump that delivers the memory image in fixed
+ * size chunks, instead of one large buffer. Backends implementing the
+ * streaming entry hand out the data as it arrives from the device, so
+ * the resident size stays bounded by the chunk size regardless of the
+ * memory size of the device. Other backends fall back to a full
+ * in-memory dump that is delivered in chunks afterwards, which keeps
+ * the callback contract but not the memory bound. An aborted download
+ * returns DC_STATUS_CANCELLED.
+ */
+dc_status_t
+dc_device_dump_stream (dc_device_t *device, dc_dump_callback_t callback, void *userdata);
+
+/*
+ * Enumerate the dives, delivered to the callback newest first. With a
+ * fingerprint set, the enumeration stops before the first dive that is
+ * already known, so a sync costs time proportional to the number of new
+ * dives, not to the number of dives on the device. Backends whose
+ * protocol transfers a fixed memory image still transfer it in full,
+ * but the delivery order and the early stop are guaranteed regardless.
+ */
 dc_status_t
 dc_device_foreach (dc_device_t *device, dc_dive_callback_t callback, void *userdata);
 
+/*
+ * Variant of dc_device_foreach that transfers ownership of each dive to
+ * the callback, so the application does not need to copy the dive data
+ * before returning.
+ */
+dc_status_t
+dc_device_foreach_buffer (dc_device_t *device, dc_dive_buffer_callback_t callback, void *userdata);
+
+/*
+ * Identity of a single dive, delivered during dc_device_enumerate. The
+ * data pointer holds the raw logbook or manifest entry of the backend,
+ * which typically contains the dive date; its format matches the header
+ * portion the parser of the same family accepts. The fingerprint is the
+ * same value dc_device_foreach would pass to the dive callback, so it
+ * can be fed to dc_device_set_fingerprint or compared against stored
+ * fingerprints to decide which dives to download. The datasize field is
+ * the approximate size of the dive data a download would deliver, or
+ * zero when the backend cannot tell without downloading. The pointers
+ * are only valid for the duration of the callback.
+ */
+typedef struct dc_dive_summary_t {
+	unsigned int number;              /**< Position in delivery order (1 = most recent). */
+	const unsigned char *fingerprint; /**< Fingerprint of the dive. */
+	unsigned int fsize;               /**< Size of the fingerprint. */
+	const unsigned char *data;        /**< Raw logbook or manifest entry. */
+	unsigned int size;                /**< Size of the entry. */
+	unsigned int datasize;            /**< Approximate size of the dive data, or zero if unknown. */
+} dc_dive_summary_t;
+
+/*
+ * The callback of the enumeration. Return a non-zero value to continue,
+ * or zero to abort the enumeration.
+ */
+typedef int (*dc_dive_summary_callback_t) (const dc_dive_summary_t *summary, void *userdata);
+
+/*
+ * Enumerate the dive identities without downloading the dive profiles.
+ * Backends with a separate logbook or manifest phase only transfer that
+ * phase, so the application can present the dive list and decide which
+ * dives to fetch, instead of downloading the complete logbook with
+ * dc_device_foreach. The dives are delivered newest first, and a
+ * fingerprint installed with dc_device_set_fingerprint still stops the
+ * enumeration at the newest previously downloaded dive. Backends whose
+ * dive headers are interleaved with the profile data have no cheaper
+ * phase to offer, and return DC_STATUS_UNSUPPORTED; there is no generic
+ * fallback, because enumerating through a full download would transfer
+ * exactly the data the caller is trying to avoid.
+ */
+dc_status_t
+dc_device_enumerate (dc_device_t *device, dc_dive_summary_callback_t callback, void *userdata);
+
 dc_status_t
 dc_device_close (dc_device_t *device);
 
+typedef void (*dc_device_close_callback_t) (dc_status_t status, void *userdata);
+
+/*
+ * Variant of dc_device_close that returns immediately and completes the
+ * close on a background thread. Several backends send a quit command
+ * and wait out guard timeouts in their close handler, which otherwise
+ * blocks the caller for a second or more at the end of a download.
+ *
+ * The device must no longer be used after this call. The callback is
+ * invoked with the close status once the close has completed, normally
+ * from the background thread, or from the calling thread if no thread
+ * could be created (in which case the close has already completed
+ * synchronously). The callback is optional and can be NULL.
+ */
+dc_status_t
+dc_device_close_async (dc_device_t *device, dc_device_close_callback_t callback, void *userdata);
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
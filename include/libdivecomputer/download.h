@@ -0,0 +1,96 @@
+/*
+ * libdivecomputer
+ *
+ * Copyright (C) 2016 Jef Driesen
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA
+ */
+
+#ifndef DC_DOWNLOAD_H
+#define DC_DOWNLOAD_H
+
+#include "common.h"
+#include "context.h"
+#include "descriptor.h"
+#include "device.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/*
+ * A download session manager that schedules downloads from multiple
+ * devices concurrently on a pool of worker threads, so applications
+ * downloading from many dive computers do not need to implement their
+ * own thread management around the library.
+ *
+ * All callbacks of a job (events, dives, completion) are invoked from
+ * the worker thread executing that job. Callbacks of different jobs
+ * can run concurrently, so shared application state needs external
+ * synchronization. The context must not log through a callback that
+ * is not safe to call from multiple threads.
+ */
+typedef struct dc_download_t dc_download_t;
+
+/*
+ * Notification of the completion of a single download job, with the
+ * final status of the job.
+ */
+typedef void (*dc_download_finished_t) (dc_status_t status, void *userdata);
+
+dc_status_t
+dc_download_new (dc_download_t **download, dc_context_t *context);
+
+/*
+ * Queue a download job. The descriptor and name are used to open the
+ * device on a worker thread. The event and dive callbacks behave as
+ * in dc_device_set_events and dc_device_foreach. The fingerprint is
+ * optional and applied before the enumeration. All jobs must be
+ * queued before calling dc_download_run.
+ */
+dc_status_t
+dc_download_add (dc_download_t *download, dc_descriptor_t *descriptor, const char *name,
+	unsigned int events, dc_event_callback_t event_callback,
+	dc_dive_callback_t dive_callback,
+	dc_download_finished_t finished_callback,
+	const unsigned char fingerprint[], unsigned int fsize,
+	void *userdata);
+
+/*
+ * Execute all queued jobs on at most nthreads concurrent worker
+ * threads, and wait for their completion. Returns the status of the
+ * first failing job, or DC_STATUS_SUCCESS if all jobs succeeded. The
+ * per-job status is also delivered through the finished callback.
+ */
+dc_status_t
+dc_download_run (dc_download_t *download, unsigned int nthreads);
+
+/*
+ * Request cancellation of all jobs. Safe to call from any thread,
+ * including from inside a callback. Jobs that have not started yet
+ * are skipped, and running jobs are cancelled through the regular
+ * device cancellation mechanism.
+ */
+dc_status_t
+dc_download_cancel (dc_download_t *download);
+
+dc_status_t
+dc_download_free (dc_download_t *download);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+#endif /* DC_DOWNLOAD_H */
@@ -22,6 +22,8 @@
 #ifndef DC_ITERATOR_H
 #define DC_ITERATOR_H
 
+#include <stddef.h>
+
 #include "common.h"
 
 #ifdef __cplusplus
@@ -33,6 +35,18 @@ typedef struct dc_iterator_t dc_iterator_t;
 dc_status_t
 dc_iterator_next (dc_iterator_t *iterator, void *item);
 
+/*
+ * Retrieve up to count items in a single call. The items argument points
+ * to an array of count elements, each of the same size as the item filled
+ * in by dc_iterator_next, and size is that element size. On return, the
+ * actual argument contains the number of elements filled in. The function
+ * returns DC_STATUS_SUCCESS when at least one element was filled in
+ * (possibly fewer than requested), and DC_STATUS_DONE when the iterator
+ * is exhausted.
+ */
+dc_status_t
+dc_iterator_next_n (dc_iterator_t *iterator, void *items, size_t size, unsigned int count, unsigned int *actual);
+
 dc_status_t
 dc_iterator_free (dc_iterator_t *iterator);
 
@@ -92,6 +92,7 @@ typedef enum parser_sample_event_t {
 	SAMPLE_EVENT_HEADING,
 	SAMPLE_EVENT_TISSUELEVEL,
 	SAMPLE_EVENT_GASCHANGE2, /* Deprecated: replaced by DC_SAMPLE_GASMIX. */
+	SAMPLE_EVENT_GAP, /* Samples skipped over corrupt data, see dc_parser_set_recovery. */
 } parser_sample_event_t;
 
 /* For backwards compatibility */
@@ -215,6 +216,16 @@ typedef union dc_sample_value_t {
 	unsigned int gasmix; /* Gas mix index */
 } dc_sample_value_t;
 
+/*
+ * A single decoded sample, as delivered by the batch interface. Each
+ * record corresponds to one invocation of the sample callback in the
+ * traditional interface.
+ */
+typedef struct dc_sample_t {
+	dc_sample_type_t type;
+	dc_sample_value_t value;
+} dc_sample_t;
+
 typedef struct dc_parser_t dc_parser_t;
 
 typedef void (*dc_sample_callback_t) (dc_sample_type_t type, dc_sample_value_t value, void *userdata);
@@ -228,18 +239,254 @@ dc_parser_new2 (dc_parser_t **parser, dc_context_t *context, dc_descriptor_t *de
 dc_family_t
 dc_parser_get_type (dc_parser_t *parser);
 
+/*
+ * Install the dive data to parse. The parser borrows the memory: no
+ * copy is made, and all parsing reads the caller's buffer in place.
+ * The buffer must therefore remain valid and unmodified until new data
+ * is installed with dc_parser_set_data (or dc_parser_reset), or the
+ * parser is destroyed. Pointers handed out by the parser while this
+ * dive is active (e.g. vendor sample data) may point into the buffer,
+ * and follow the same lifetime.
+ */
 dc_status_t
 dc_parser_set_data (dc_parser_t *parser, const unsigned char *data, unsigned int size);
 
+/*
+ * Release the reference to the current dive data and clear all cached
+ * state, without deallocating the parser itself. Afterwards, the parser
+ * can be re-armed with dc_parser_set_data for the next dive, avoiding a
+ * dc_parser_destroy/dc_parser_new cycle per dive.
+ */
+dc_status_t
+dc_parser_reset (dc_parser_t *parser);
+
 dc_status_t
 dc_parser_get_datetime (dc_parser_t *parser, dc_datetime_t *datetime);
 
 dc_status_t
 dc_parser_get_field (dc_parser_t *parser, dc_field_type_t type, unsigned int flags, void *value);
 
+/* The maximum number of gas mixes and tanks in a dc_fieldset_t. */
+#define DC_FIELDSET_MAXGASMIXES 16
+#define DC_FIELDSET_MAXTANKS    16
+
+typedef struct dc_fieldset_t {
+	/* Bitmap with one bit per dc_field_type_t value, indicating which
+	 * of the fields below contain valid data. */
+	unsigned int supported;
+	unsigned int divetime;
+	double maxdepth;
+	double avgdepth;
+	unsigned int gasmix_count;
+	dc_gasmix_t gasmix[DC_FIELDSET_MAXGASMIXES];
+	dc_salinity_t salinity;
+	double atmospheric;
+	double temperature_surface;
+	double temperature_minimum;
+	double temperature_maximum;
+	unsigned int tank_count;
+	dc_tank_t tank[DC_FIELDSET_MAXTANKS];
+	dc_divemode_t divemode;
+} dc_fieldset_t;
+
+/*
+ * Query all standard fields in a single call. Fields the backend does
+ * not support are zeroed and have their bit cleared in the supported
+ * bitmap; everything else is filled in. The gas mix and tank arrays
+ * contain min(count, maximum) entries. Backends that derive several
+ * fields from one pass over the dive header only decode it once, since
+ * the queries are served through the field cache.
+ */
+dc_status_t
+dc_parser_get_fields (dc_parser_t *parser, dc_fieldset_t *fields);
+
 dc_status_t
 dc_parser_samples_foreach (dc_parser_t *parser, dc_sample_callback_t callback, void *userdata);
 
+/*
+ * Restrict the sample iteration to a set of sample types. The mask
+ * contains bit (1 << dc_sample_type_t) for every type of interest; a
+ * mask of zero (the default) selects all types. With a mask installed,
+ * dc_parser_samples_foreach only delivers the selected types, and
+ * backends can skip the decoding work of the unselected ones. A caller
+ * drawing a depth profile would select only DC_SAMPLE_TIME and
+ * DC_SAMPLE_DEPTH. The mask remains in effect until changed, and does
+ * not affect the field queries or the presence scans.
+ */
+dc_status_t
+dc_parser_set_sample_mask (dc_parser_t *parser, unsigned int mask);
+
+/*
+ * Enable the error recovery mode of the sample iteration. By default,
+ * corrupt sample data aborts the iteration with DC_STATUS_DATAFORMAT,
+ * and everything after the corruption is lost. With recovery enabled,
+ * backends with a fixed sample record size resynchronize at the next
+ * record boundary instead, and report the skipped region as an event
+ * of type SAMPLE_EVENT_GAP, whose value holds the number of skipped
+ * bytes. The samples before and after the gap are delivered normally,
+ * so a single corrupt byte no longer discards the rest of the dive.
+ * Backends without a recoverable format ignore the mode and abort as
+ * before. The mode remains in effect until changed.
+ */
+dc_status_t
+dc_parser_set_recovery (dc_parser_t *parser, unsigned int enable);
+
+/*
+ * A consumer of the sample stream, for the fan-out iteration.
+ */
+typedef struct dc_sample_sink_t {
+	dc_sample_callback_t callback;
+	void *userdata;
+} dc_sample_sink_t;
+
+/*
+ * Iterate over the samples of the current dive once, and fan every
+ * sample out to each of the registered sinks, in array order. An
+ * application feeding several independent consumers from the same dive
+ * (e.g. a profile renderer, a statistics pass and an exporter) pays a
+ * single decode pass instead of one dc_parser_samples_foreach pass per
+ * consumer. Pointers embedded in the sample values (e.g. vendor data)
+ * are shared between the sinks, and remain valid until the next call
+ * to dc_parser_set_data.
+ */
+dc_status_t
+dc_parser_samples_foreach_multi (dc_parser_t *parser, const dc_sample_sink_t sinks[], unsigned int nsinks);
+
+/*
+ * Decode all samples of the current dive into a caller provided array,
+ * without a callback invocation per sample. On return, the number of
+ * decoded samples is stored in the actual parameter. If the array is
+ * too small, the samples that do not fit are discarded, the total
+ * number of samples is still stored in the actual parameter, and
+ * DC_STATUS_NOMEMORY is returned. Pointers embedded in the sample
+ * values (e.g. vendor data) remain valid until the next call to
+ * dc_parser_set_data.
+ */
+dc_status_t
+dc_parser_samples_batch (dc_parser_t *parser, dc_sample_t *samples, unsigned int size, unsigned int *actual);
+
+/*
+ * Decode a single DC_SAMPLE_VENDOR blob back into typed samples. The
+ * type, data and size parameters are the fields of the vendor sample
+ * as they were delivered by the sample callback; the blob may also
+ * come from the application's own storage, so stored dives can be
+ * reprocessed without re-parsing the entire profile. The decoded
+ * fields are emitted through the callback as regular samples (e.g.
+ * DC_SAMPLE_DEPTH), without a DC_SAMPLE_TIME record: the timestamp
+ * belongs to the sample record the blob was taken from. Parser
+ * families whose vendor blobs carry no independently decodable fields
+ * return DC_STATUS_UNSUPPORTED.
+ */
+dc_status_t
+dc_parser_vendor_decode (dc_parser_t *parser, unsigned int type, const void *data, unsigned int size, dc_sample_callback_t callback, void *userdata);
+
+/*
+ * Extract a single column of the current dive into a caller provided
+ * array, one entry per sample record. A record is started by each time
+ * sample, and when a record carries several samples of the same type
+ * (e.g. the ppO2 of multiple CCR oxygen sensors), the n-th occurrence
+ * within the record belongs to channel n. Entries for records that do
+ * not carry the requested channel are zeroed. On return, the total
+ * number of records is stored in the actual parameter; if the array is
+ * too small, the remaining entries are discarded and DC_STATUS_NOMEMORY
+ * is returned. Querying with a size of zero returns just the count.
+ */
+dc_status_t
+dc_parser_samples_column (dc_parser_t *parser, dc_sample_type_t type, unsigned int channel, dc_sample_value_t values[], unsigned int size, unsigned int *actual);
+
+/*
+ * Accumulator for extracting all columns of the current dive in a
+ * single decode pass. Where dc_parser_samples_column requires one pass
+ * per column, dc_parser_samples_columns decodes the dive once and
+ * stores every (type, channel) combination that occurs in its own
+ * contiguous array, one entry per sample record, following the same
+ * record and channel rules. Entries for records that do not carry a
+ * column are zeroed.
+ *
+ * The arrays are owned by the accumulator and remain valid until it is
+ * freed; pointers embedded in the sample values (e.g. vendor data)
+ * remain valid until the next call to dc_parser_set_data. The get
+ * function returns NULL for a column that does not occur in the dive.
+ */
+typedef struct dc_sample_columns_t dc_sample_columns_t;
+
+dc_status_t
+dc_parser_samples_columns (dc_parser_t *parser, dc_sample_columns_t **columns);
+
+unsigned int
+dc_sample_columns_count (const dc_sample_columns_t *columns);
+
+const dc_sample_value_t *
+dc_sample_columns_get (const dc_sample_columns_t *columns, dc_sample_type_t type, unsigned int channel);
+
+dc_status_t
+dc_sample_columns_free (dc_sample_columns_t *columns);
+
+/*
+ * Iterate over the samples in decimated form, for low resolution
+ * rendering (thumbnails, overview plots). The dive is divided into
+ * buckets of 'interval' seconds. The first sample record of each
+ * bucket is delivered in full, and the minimum and maximum depth of
+ * the dropped records are preserved as synthetic records containing
+ * only a time and a depth sample, so descents, ascents and depth
+ * spikes survive the decimation. Records carrying discrete samples
+ * (events, gas mix changes, vendor data) are never dropped. With an
+ * interval of zero or one, all samples are delivered unmodified.
+ */
+dc_status_t
+dc_parser_samples_decimate (dc_parser_t *parser, unsigned int interval, dc_sample_callback_t callback, void *userdata);
+
+/*
+ * Scan the samples of the current dive and report which sample types
+ * and which events are present, without delivering the samples
+ * themselves. On return, the samples parameter contains a bitmask with
+ * bit (1 << dc_sample_type_t) set for every sample type that occurs in
+ * the dive, and the events parameter a bitmask with bit
+ * (1 << parser_sample_event_t) set for every event type. Either
+ * parameter can be NULL when only one of the bitmaps is needed. This
+ * is intended for list rendering (badges, icons), where decoding the
+ * full profile of every dive just to learn whether it contains e.g. a
+ * deco stop or a gas switch would be wasteful: the scan is a single
+ * pass with no per-sample callback into the application.
+ */
+dc_status_t
+dc_parser_samples_present (dc_parser_t *parser, unsigned int *samples, unsigned int *events);
+
+/*
+ * A single dive, as previously delivered by the dc_device_foreach
+ * callback.
+ */
+typedef struct dc_dive_data_t {
+	const unsigned char *data;
+	unsigned int size;
+} dc_dive_data_t;
+
+typedef void (*dc_parser_parse_callback_t) (unsigned int idx, dc_parser_t *parser, dc_status_t status, void *userdata);
+
+/*
+ * Parse a batch of dives, optionally distributed over multiple worker
+ * threads. For every dive, the callback receives the index of the dive
+ * in the input array, and a parser armed with the dive data, ready for
+ * dc_parser_get_datetime, dc_parser_get_field and the sample functions.
+ * Each worker thread uses its own parser instance, so the callback
+ * never shares a parser between two concurrent invocations.
+ *
+ * Invocations for different dives may run concurrently and in any
+ * order. The callback should store its results keyed by the dive index
+ * (e.g. in a pre-allocated array), which yields the results in input
+ * order without any synchronization on the caller side. A custom log
+ * function installed with dc_context_set_logfunc must be thread-safe;
+ * the built-in logging is serialized internally.
+ *
+ * With nthreads less than two, all dives are parsed on the calling
+ * thread, and no threads are used. Otherwise the work runs on a pool
+ * of worker threads shared by all operations on the context, so
+ * nthreads is an upper bound: the effective concurrency never exceeds
+ * the pool size (the number of processor cores).
+ */
+dc_status_t
+dc_parser_parse_many (dc_context_t *context, dc_descriptor_t *descriptor, unsigned int devtime, dc_ticks_t systime, const dc_dive_data_t dives[], unsigned int ndives, unsigned int nthreads, dc_parser_parse_callback_t callback, void *userdata);
+
 dc_status_t
 dc_parser_destroy (dc_parser_t *parser);
 
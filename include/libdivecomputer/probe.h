@@ -0,0 +1,57 @@
+/*
+ * libdivecomputer
+ *
+ * Copyright (C) 2016 Jef Driesen
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA
+ */
+
+#ifndef DC_PROBE_H
+#define DC_PROBE_H
+
+#include "common.h"
+#include "context.h"
+#include "descriptor.h"
+#include "device.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/*
+ * Detect which supported dive computer is attached to a serial port,
+ * by probing the candidate protocol families one at a time until a
+ * handshake succeeds. The candidates are ordered by prior probe
+ * successes, so the common case of the same device reappearing is
+ * detected with a single handshake instead of a full sweep.
+ *
+ * On success, the descriptor of the detected family is returned, and
+ * must be freed with dc_descriptor_free. If the device argument is
+ * not NULL, the device from the successful probe is also returned in
+ * its open state, so the application does not pay for the handshake a
+ * second time. The descriptor identifies the protocol family; the
+ * exact model is available from the DC_EVENT_DEVINFO event of the
+ * returned device.
+ *
+ * Returns DC_STATUS_UNSUPPORTED if no candidate responded.
+ */
+dc_status_t
+dc_probe (dc_device_t **device, dc_descriptor_t **descriptor, dc_context_t *context, const char *name);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+#endif /* DC_PROBE_H */
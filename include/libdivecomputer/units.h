@@ -34,5 +34,12 @@
 #define PSI         ((POUND * GRAVITY) / (INCH * INCH))
 #define CUFT        (FEET * FEET * FEET)
 
+/*
+ * Convert a temperature from Fahrenheit to Celsius. The constants fold
+ * at compile time, so the conversion costs a single multiply-add.
+ */
+#define FAHRENHEIT_TO_CELSIUS(value) \
+	(((value) - 32.0) * (5.0 / 9.0))
+
 
 #endif /* UNITS_H */
@@ -55,12 +55,17 @@ array_reverse_bits (unsigned char data[], unsigned int size)
 int
 array_isequal (const unsigned char data[], unsigned int size, unsigned char value)
 {
-	for (unsigned int i = 0; i < size; ++i) {
-		if (data[i] != value)
-			return 0;
-	}
+	if (size == 0)
+		return 1;
 
-	return 1;
+	// Compare the array against itself, shifted by one byte. Together
+	// with the check of the first byte, this proves all bytes are
+	// equal, and runs at the speed of the vectorized memcmp instead
+	// of a byte wise loop.
+	if (data[0] != value)
+		return 0;
+
+	return memcmp (data, data + 1, size - 1) == 0;
 }
 
 
@@ -68,7 +73,19 @@ const unsigned char *
 array_search_forward (const unsigned char *data, unsigned int size,
                       const unsigned char *marker, unsigned int msize)
 {
+	if (msize == 0)
+		return data;
+
+	// Locate the candidate positions with the vectorized memchr, and
+	// only compare the full marker there.
 	while (size >= msize) {
+		const unsigned char *p = (const unsigned char *) memchr (data, marker[0], size - msize + 1);
+		if (p == NULL)
+			return NULL;
+
+		size -= p - data;
+		data = p;
+
 		if (memcmp (data, marker, msize) == 0)
 			return data;
 		size--;
@@ -83,8 +100,15 @@ array_search_backward (const unsigned char *data, unsigned int size,
                        const unsigned char *marker, unsigned int msize)
 {
 	data += size;
+
+	if (msize == 0)
+		return data;
+
+	// Check the first marker byte before comparing the full marker,
+	// so most positions are rejected without a function call.
 	while (size >= msize) {
-		if (memcmp (data - msize, marker, msize) == 0)
+		if (data[-(int) msize] == marker[0] &&
+			memcmp (data - msize, marker, msize) == 0)
 			return data;
 		size--;
 		data--;
@@ -96,21 +120,32 @@ array_search_backward (const unsigned char *data, unsigned int size,
 int
 array_convert_bin2hex (const unsigned char input[], unsigned int isize, unsigned char output[], unsigned int osize)
 {
+	// Both hexadecimal digits of each byte value, stored as adjacent
+	// character pairs, so a byte is converted with a single lookup.
+	static const unsigned char ascii[] =
+		"000102030405060708090A0B0C0D0E0F"
+		"101112131415161718191A1B1C1D1E1F"
+		"202122232425262728292A2B2C2D2E2F"
+		"303132333435363738393A3B3C3D3E3F"
+		"404142434445464748494A4B4C4D4E4F"
+		"505152535455565758595A5B5C5D5E5F"
+		"606162636465666768696A6B6C6D6E6F"
+		"707172737475767778797A7B7C7D7E7F"
+		"808182838485868788898A8B8C8D8E8F"
+		"909192939495969798999A9B9C9D9E9F"
+		"A0A1A2A3A4A5A6A7A8A9AAABACADAEAF"
+		"B0B1B2B3B4B5B6B7B8B9BABBBCBDBEBF"
+		"C0C1C2C3C4C5C6C7C8C9CACBCCCDCECF"
+		"D0D1D2D3D4D5D6D7D8D9DADBDCDDDEDF"
+		"E0E1E2E3E4E5E6E7E8E9EAEBECEDEEEF"
+		"F0F1F2F3F4F5F6F7F8F9FAFBFCFDFEFF";
+
 	if (osize != 2 * isize)
 		return -1;
 
-	const unsigned char ascii[] = {
-		'0', '1', '2', '3', '4', '5', '6', '7',
-		'8', '9', 'A', 'B', 'C', 'D', 'E', 'F'};
-
 	for (unsigned int i = 0; i < isize; ++i) {
-		// Set the most-significant nibble.
-		unsigned char msn = (input[i] >> 4) & 0x0F;
-		output[i * 2 + 0] = ascii[msn];
-
-		// Set the least-significant nibble.
-		unsigned char lsn = input[i] & 0x0F;
-		output[i * 2 + 1] = ascii[lsn];
+		output[i * 2 + 0] = ascii[input[i] * 2 + 0];
+		output[i * 2 + 1] = ascii[input[i] * 2 + 1];
 	}
 
 	return 0;
@@ -120,27 +155,37 @@ array_convert_bin2hex (const unsigned char input[], unsigned int isize, unsigned
 int
 array_convert_hex2bin (const unsigned char input[], unsigned int isize, unsigned char output[], unsigned int osize)
 {
+	// The value of each hexadecimal digit, or -1 for all other
+	// characters, so a digit is converted and validated with a
+	// single lookup.
+	static const signed char ascii[] = {
+		-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+		-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+		-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+		 0,  1,  2,  3,  4,  5,  6,  7,  8,  9, -1, -1, -1, -1, -1, -1,
+		-1, 10, 11, 12, 13, 14, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+		-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+		-1, 10, 11, 12, 13, 14, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+		-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+		-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+		-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+		-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+		-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+		-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+		-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+		-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+		-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	};
+
 	if (isize != 2 * osize)
 		return -1;
 
 	for (unsigned int i = 0; i < osize; ++i) {
-		unsigned char value = 0;
-		for (unsigned int j = 0; j < 2; ++j) {
-			unsigned char number = 0;
-			unsigned char ascii = input[i * 2 + j];
-			if (ascii >= '0' && ascii <= '9')
-				number = ascii - '0';
-			else if (ascii >= 'A' && ascii <= 'F')
-				number = 10 + ascii - 'A';
-			else if (ascii >= 'a' && ascii <= 'f')
-				number = 10 + ascii - 'a';
-			else
-				return -1; /* Invalid character */
-
-			value <<= 4;
-			value += number;
-		}
-		output[i] = value;
+		int msn = ascii[input[i * 2 + 0]];
+		int lsn = ascii[input[i * 2 + 1]];
+		if ((msn | lsn) < 0)
+			return -1; /* Invalid character */
+		output[i] = (msn << 4) | lsn;
 	}
 
 	return 0;
@@ -243,6 +288,56 @@ array_uint16_le (const unsigned char data[])
 	return data[0] + (data[1] << 8);
 }
 
+void
+array_uint16_le_array (const unsigned char data[], unsigned int count, unsigned int stride, unsigned int values[])
+{
+	// Convert an array of 16 bit values in a single pass. The loop
+	// contains no function calls or conditions, so the compiler is
+	// free to unroll and vectorize it.
+	for (unsigned int i = 0; i < count; ++i) {
+		values[i] = data[0] + (data[1] << 8);
+		data += stride;
+	}
+}
+
+unsigned int
+array_scan_uint16_le (const unsigned char data[], unsigned int count, unsigned int stride, unsigned int mask, unsigned int threshold, unsigned int terminator, unsigned int *nscanned, unsigned int *nabove)
+{
+	// Scan a column of 16 bit values, each 'stride' bytes apart, in a
+	// single fused pass: the maximum of the masked values at or above
+	// 'threshold', the number of such values, and the number of values
+	// scanned. The scan stops early when the raw (unmasked) value
+	// equals 'terminator', for columns delimited by an end marker; a
+	// terminator above 0xFFFF never matches.
+	// The comparisons are kept as plain branches on purpose: a
+	// branchless compare-select chain serializes on its loop carried
+	// dependency, while these branches are almost perfectly predicted
+	// on profile data, where the maximum only advances during the
+	// descent.
+	unsigned int maximum = 0;
+	unsigned int n = 0;
+	unsigned int i = 0;
+	for (; i < count; ++i) {
+		unsigned int raw = data[0] + (data[1] << 8);
+		if (raw == terminator)
+			break;
+		unsigned int value = raw & mask;
+		if (value >= threshold) {
+			if (value > maximum)
+				maximum = value;
+			n++;
+		}
+		data += stride;
+	}
+
+	if (nscanned)
+		*nscanned = i;
+	if (nabove)
+		*nabove = n;
+
+	return maximum;
+}
+
 unsigned char
 bcd2dec (unsigned char value)
 {
@@ -26,6 +26,18 @@
 extern "C" {
 #endif /* __cplusplus */
 
+/*
+ * Scale a raw sample value by a conversion factor, given as a
+ * quotient. In the sample loops both sides of the quotient are
+ * compile time constants, so the compiler evaluates the reciprocal
+ * once, and the per sample division becomes a single multiplication.
+ * A floating point division is an order of magnitude slower than a
+ * multiplication on small in-order cores, and keeps the loops from
+ * vectorizing.
+ */
+#define array_scale(value, numerator, denominator) \
+	((value) * ((double) (numerator) / (denominator)))
+
 void
 array_reverse_bytes (unsigned char data[], unsigned int size);
 
@@ -82,6 +94,12 @@ array_uint16_be (const unsigned char data[]);
 unsigned short
 array_uint16_le (const unsigned char data[]);
 
+void
+array_uint16_le_array (const unsigned char data[], unsigned int count, unsigned int stride, unsigned int values[]);
+
+unsigned int
+array_scan_uint16_le (const unsigned char data[], unsigned int count, unsigned int stride, unsigned int mask, unsigned int threshold, unsigned int terminator, unsigned int *nscanned, unsigned int *nabove);
+
 unsigned char
 bcd2dec (unsigned char value);
 
@@ -52,6 +52,7 @@
 
 #define SZ_MEMORY (29 * 64 * 1024)
 #define SZ_VERSION 14
+#define SZ_PACKET (32 * 1024)
 
 typedef struct atomics_cobalt_device_t {
 	dc_device_t base;
@@ -68,7 +69,7 @@ static dc_status_t atomics_cobalt_device_set_fingerprint (dc_device_t *abstract,
 static dc_status_t atomics_cobalt_device_foreach (dc_device_t *abstract, dc_dive_callback_t callback, void *userdata);
 static dc_status_t atomics_cobalt_device_close (dc_device_t *abstract);
 
-static const dc_device_vtable_t atomics_cobalt_device_vtable = {
+DC_VTABLE_STORAGE const dc_device_vtable_t atomics_cobalt_device_vtable = {
 	sizeof(atomics_cobalt_device_t),
 	DC_FAMILY_ATOMICS_COBALT,
 	atomics_cobalt_device_set_fingerprint, /* set_fingerprint */
@@ -249,20 +250,11 @@ atomics_cobalt_device_version (dc_device_t *abstract, unsigned char data[], unsi
 
 
 static dc_status_t
-atomics_cobalt_read_dive (dc_device_t *abstract, dc_buffer_t *buffer, int init, dc_event_progress_t *progress)
+atomics_cobalt_send_request (dc_device_t *abstract, int init)
 {
 #ifdef HAVE_LIBUSB
 	atomics_cobalt_device_t *device = (atomics_cobalt_device_t *) abstract;
 
-	if (device_is_cancelled (abstract))
-		return DC_STATUS_CANCELLED;
-
-	// Erase the current contents of the buffer.
-	if (!dc_buffer_clear (buffer)) {
-		ERROR (abstract->context, "Insufficient buffer space available.");
-		return DC_STATUS_NOMEMORY;
-	}
-
 	// Send the command to the dive computer.
 	uint8_t bRequest = 0;
 	if (device->simulation)
@@ -279,13 +271,60 @@ atomics_cobalt_read_dive (dc_device_t *abstract, dc_buffer_t *buffer, int init,
 
 	HEXDUMP (abstract->context, DC_LOGLEVEL_INFO, "Write", &bRequest, 1);
 
+	return DC_STATUS_SUCCESS;
+#else
+	return DC_STATUS_UNSUPPORTED;
+#endif
+}
+
+
+#ifdef HAVE_LIBUSB
+static dc_status_t
+atomics_cobalt_drain (dc_device_t *abstract, unsigned char packet[], unsigned int psize)
+{
+	atomics_cobalt_device_t *device = (atomics_cobalt_device_t *) abstract;
+
+	// Receive and discard the answer of a request whose data is no
+	// longer needed, to leave the dive computer in a clean state.
+	while (1) {
+		int length = 0;
+		int rc = libusb_bulk_transfer (device->handle, 0x82,
+			packet, psize, &length, TIMEOUT);
+		if (rc != LIBUSB_SUCCESS && rc != LIBUSB_ERROR_TIMEOUT) {
+			ERROR (abstract->context, "Failed to receive the answer.");
+			return EXITCODE(rc);
+		}
+
+		if ((unsigned int) length < psize)
+			break;
+	}
+
+	return DC_STATUS_SUCCESS;
+}
+#endif
+
+
+static dc_status_t
+atomics_cobalt_receive_dive (dc_device_t *abstract, dc_buffer_t *buffer, unsigned char packet[], unsigned int psize, dc_event_progress_t *progress)
+{
+#ifdef HAVE_LIBUSB
+	atomics_cobalt_device_t *device = (atomics_cobalt_device_t *) abstract;
+
+	if (device_is_cancelled (abstract))
+		return DC_STATUS_CANCELLED;
+
+	// Erase the current contents of the buffer.
+	if (!dc_buffer_clear (buffer)) {
+		ERROR (abstract->context, "Insufficient buffer space available.");
+		return DC_STATUS_NOMEMORY;
+	}
+
 	unsigned int nbytes = 0;
 	while (1) {
 		// Receive the answer from the dive computer.
 		int length = 0;
-		unsigned char packet[8 * 1024] = {0};
-		rc = libusb_bulk_transfer (device->handle, 0x82,
-			packet, sizeof (packet), &length, TIMEOUT);
+		int rc = libusb_bulk_transfer (device->handle, 0x82,
+			packet, psize, &length, TIMEOUT);
 		if (rc != LIBUSB_SUCCESS && rc != LIBUSB_ERROR_TIMEOUT) {
 			ERROR (abstract->context, "Failed to receive the answer.");
 			return EXITCODE(rc);
@@ -304,7 +343,7 @@ atomics_cobalt_read_dive (dc_device_t *abstract, dc_buffer_t *buffer, int init,
 		nbytes += length;
 
 		// If we received fewer bytes than requested, the transfer is finished.
-		if (length < sizeof (packet))
+		if ((unsigned int) length < psize)
 			break;
 	}
 
@@ -378,36 +417,67 @@ atomics_cobalt_device_foreach (dc_device_t *abstract, dc_dive_callback_t callbac
 	if (buffer == NULL)
 		return DC_STATUS_NOMEMORY;
 
-	unsigned int ndives = 0;
-	dc_status_t rc = DC_STATUS_SUCCESS;
-	while ((rc = atomics_cobalt_read_dive (abstract, buffer, (ndives == 0), &progress)) == DC_STATUS_SUCCESS) {
+	// Allocate the staging buffer for the bulk transfers. A single
+	// large buffer is reused for all dives, and keeps the individual
+	// transfers large enough to saturate the bulk pipe.
+	unsigned char *packet = (unsigned char *) malloc (SZ_PACKET);
+	if (packet == NULL) {
+		ERROR (abstract->context, "Failed to allocate memory.");
+		dc_buffer_free (buffer);
+		return DC_STATUS_NOMEMORY;
+	}
+
+	// Request the first dive.
+	dc_status_t rc = atomics_cobalt_send_request (abstract, 1);
+	if (rc != DC_STATUS_SUCCESS) {
+		free (packet);
+		dc_buffer_free (buffer);
+		return rc;
+	}
+
+	unsigned int pending = 1;
+	while ((rc = atomics_cobalt_receive_dive (abstract, buffer, packet, SZ_PACKET, &progress)) == DC_STATUS_SUCCESS) {
+		pending = 0;
+
 		unsigned char *data = dc_buffer_get_data (buffer);
 		unsigned int size = dc_buffer_get_size (buffer);
 
-		if (size == 0) {
-			dc_buffer_free (buffer);
-			return DC_STATUS_SUCCESS;
-		}
+		if (size == 0)
+			break;
 
-		if (memcmp (data + FP_OFFSET, device->fingerprint, sizeof (device->fingerprint)) == 0) {
-			dc_buffer_free (buffer);
-			return DC_STATUS_SUCCESS;
-		}
+		// Request the next dive immediately, so the dive computer
+		// prepares and starts transferring it while the current dive
+		// is still being processed by the application.
+		rc = atomics_cobalt_send_request (abstract, 0);
+		if (rc != DC_STATUS_SUCCESS)
+			break;
+		pending = 1;
 
-		if (callback && !callback (data, size, data + FP_OFFSET, sizeof (device->fingerprint), userdata)) {
-			dc_buffer_free (buffer);
-			return DC_STATUS_SUCCESS;
-		}
+		if (memcmp (data + FP_OFFSET, device->fingerprint, sizeof (device->fingerprint)) == 0)
+			break;
+
+		if (callback && !callback (data, size, data + FP_OFFSET, sizeof (device->fingerprint), userdata))
+			break;
 
 		// Adjust the maximum value to take into account the two checksum bytes
 		// for the next dive. Since we don't know the total number of dives in
 		// advance, we can't calculate the total number of checksum bytes and
 		// adjust the maximum on the fly.
 		progress.maximum += 2;
+	}
 
-		ndives++;
+#ifdef HAVE_LIBUSB
+	// If the download ended with the answer of the prefetched request
+	// still outstanding, drain it, so the dive computer is left in a
+	// clean state.
+	if (rc == DC_STATUS_SUCCESS && pending) {
+		atomics_cobalt_drain (abstract, packet, SZ_PACKET);
 	}
+#else
+	(void) pending;
+#endif
 
+	free (packet);
 	dc_buffer_free (buffer);
 
 	return rc;
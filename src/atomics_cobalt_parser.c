@@ -49,7 +49,7 @@ static dc_status_t atomics_cobalt_parser_get_datetime (dc_parser_t *abstract, dc
 static dc_status_t atomics_cobalt_parser_get_field (dc_parser_t *abstract, dc_field_type_t type, unsigned int flags, void *value);
 static dc_status_t atomics_cobalt_parser_samples_foreach (dc_parser_t *abstract, dc_sample_callback_t callback, void *userdata);
 
-static const dc_parser_vtable_t atomics_cobalt_parser_vtable = {
+DC_VTABLE_STORAGE const dc_parser_vtable_t atomics_cobalt_parser_vtable = {
 	sizeof(atomics_cobalt_parser_t),
 	DC_FAMILY_ATOMICS_COBALT,
 	atomics_cobalt_parser_set_data, /* set_data */
@@ -167,7 +167,7 @@ atomics_cobalt_parser_get_field (dc_parser_t *abstract, dc_field_type_t type, un
 			gasmix->nitrogen = 1.0 - gasmix->oxygen - gasmix->helium;
 			break;
 		case DC_FIELD_TEMPERATURE_SURFACE:
-			*((double *) value) = (p[0x1B] - 32.0) * (5.0 / 9.0);
+			*((double *) value) = FAHRENHEIT_TO_CELSIUS (p[0x1B]);
 			break;
 		case DC_FIELD_TANK:
 			p += SZ_HEADER + SZ_GASMIX * flags;
@@ -273,13 +273,13 @@ atomics_cobalt_parser_samples_foreach (dc_parser_t *abstract, dc_sample_callback
 
 		// Depth (1/1000 bar).
 		unsigned int depth = array_uint16_le (data + offset + 0);
-		sample.depth = (depth * BAR / 1000.0 - atmospheric) / parser->hydrostatic;
+		sample.depth = (array_scale (depth, BAR, 1000) - atmospheric) / parser->hydrostatic;
 		if (callback) callback (DC_SAMPLE_DEPTH, sample, userdata);
 
 		// Pressure (1 psi).
 		unsigned int pressure = array_uint16_le (data + offset + 2);
 		sample.pressure.tank = tank;
-		sample.pressure.value = pressure * PSI / BAR;
+		sample.pressure.value = array_scale (pressure, PSI, BAR);
 		if (callback) callback (DC_SAMPLE_PRESSURE, sample, userdata);
 
 		// Current gas mix
@@ -302,7 +302,7 @@ atomics_cobalt_parser_samples_foreach (dc_parser_t *abstract, dc_sample_callback
 
 		// Temperature (1 °F).
 		unsigned int temperature = data[offset + 8];
-		sample.temperature = (temperature - 32.0) * (5.0 / 9.0);
+		sample.temperature = FAHRENHEIT_TO_CELSIUS (temperature);
 		if (callback) callback (DC_SAMPLE_TEMPERATURE, sample, userdata);
 
 		// violation status
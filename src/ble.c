@@ -0,0 +1,817 @@
+/*
+ * libdivecomputer
+ *
+ * Copyright (C) 2014 Jef Driesen
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA
+ */
+
+#include <stdlib.h> // malloc, free
+#include <string.h> // memcpy, memset
+#include <errno.h>  // errno
+#include <unistd.h> // close
+#include <time.h>   // nanosleep
+#include <sys/types.h>  // socket
+#include <sys/socket.h> // socket, connect
+#include <bluetooth/bluetooth.h> // bdaddr_t
+#include <bluetooth/l2cap.h>     // sockaddr_l2
+#include <sys/select.h> // select
+#include <sys/time.h>
+
+#include "ble.h"
+#include "common-private.h"
+#include "context-private.h"
+#include "array.h"
+
+// The fixed L2CAP channel of the Attribute protocol (Bluetooth Core
+// specification, Vol 3, Part F). All GATT traffic is exchanged as ATT
+// protocol data units over this channel.
+#define ATT_CID 4
+
+// ATT protocol opcodes.
+#define ATT_ERROR_RSP        0x01
+#define ATT_EXCHANGE_MTU_REQ 0x02
+#define ATT_EXCHANGE_MTU_RSP 0x03
+#define ATT_FIND_INFO_REQ    0x04
+#define ATT_FIND_INFO_RSP    0x05
+#define ATT_READ_BY_TYPE_REQ 0x08
+#define ATT_READ_BY_TYPE_RSP 0x09
+#define ATT_WRITE_REQ        0x12
+#define ATT_WRITE_RSP        0x13
+#define ATT_HANDLE_VALUE_NTF 0x1B
+#define ATT_WRITE_CMD        0x52
+
+// ATT error codes.
+#define ATT_ECODE_ATTR_NOT_FOUND 0x0A
+
+// GATT attribute types.
+#define GATT_CHARACTERISTIC 0x2803
+#define GATT_CLIENT_CONFIG  0x2902
+
+// GATT characteristic properties.
+#define GATT_PROP_WRITE_CMD 0x04
+#define GATT_PROP_WRITE_REQ 0x08
+#define GATT_PROP_NOTIFY    0x10
+
+// The ATT MTU. The default is the bare minimum, and the maximum is the
+// largest value allowed by the specification. The actual value is
+// negotiated with the device.
+#define ATT_DEFAULT_MTU 23
+#define ATT_MAX_MTU     517
+
+// The timeout for the GATT setup requests (milliseconds).
+#define REQUEST_TIMEOUT 5000
+
+// The size of the receive cache. A notification carries up to MTU
+// minus 3 bytes of payload, and several of them are kept in flight by
+// the device. The payload is buffered here, and the byte sized reads
+// of the protocol layers are served from memory.
+#define RECEIVE_BUFSIZE 4096
+
+struct dc_ble_t {
+	dc_context_t *context;
+	int fd;
+	int timeout;
+	/* Negotiated ATT MTU */
+	unsigned int mtu;
+	/* GATT characteristic handles */
+	unsigned int txhandle;
+	unsigned int rxhandle;
+	/* Write without response supported */
+	unsigned int txcommand;
+	/* Transfer statistics */
+	dc_event_metrics_t metrics;
+	/* Receive cache */
+	unsigned char cache[RECEIVE_BUFSIZE];
+	size_t offset;
+	size_t available;
+};
+
+static dc_status_t
+syserror(int errcode)
+{
+	switch (errcode) {
+	case EINVAL:
+		return DC_STATUS_INVALIDARGS;
+	case ENOMEM:
+		return DC_STATUS_NOMEMORY;
+	case EACCES:
+		return DC_STATUS_NOACCESS;
+	case EAFNOSUPPORT:
+		return DC_STATUS_UNSUPPORTED;
+	default:
+		return DC_STATUS_IO;
+	}
+}
+
+static int
+dc_ble_str2ba (const char *address, bdaddr_t *ba)
+{
+	unsigned int i = 0, nbytes = 0;
+	unsigned int value = 0, ndigits = 0;
+
+	if (address == NULL)
+		return -1;
+
+	while (address[i] != '\0') {
+		unsigned char c = address[i];
+		if (c == ':') {
+			if (ndigits == 0 || nbytes >= 5)
+				return -1;
+			// The binary address is stored in reverse order.
+			ba->b[5 - nbytes++] = value;
+			value = 0;
+			ndigits = 0;
+		} else {
+			unsigned int digit = 0;
+			if (c >= '0' && c <= '9')
+				digit = c - '0';
+			else if (c >= 'A' && c <= 'F')
+				digit = c - 'A' + 10;
+			else if (c >= 'a' && c <= 'f')
+				digit = c - 'a' + 10;
+			else
+				return -1;
+			if (ndigits >= 2)
+				return -1;
+			value = (value << 4) | digit;
+			ndigits++;
+		}
+		i++;
+	}
+
+	if (ndigits == 0 || nbytes != 5)
+		return -1;
+	ba->b[0] = value;
+
+	return 0;
+}
+
+// Append the payload of a notification to the receive cache. If the
+// cache overflows, the remaining bytes are dropped, and the protocol
+// layer will detect the gap as a timeout or protocol error.
+static void
+dc_ble_cache_append (dc_ble_t *device, const unsigned char data[], size_t size)
+{
+	if (device->available == 0)
+		device->offset = 0;
+
+	if (device->offset + device->available + size > sizeof (device->cache)) {
+		// Move the remaining bytes to the front of the cache.
+		memmove (device->cache, device->cache + device->offset, device->available);
+		device->offset = 0;
+	}
+
+	size_t length = size;
+	if (device->offset + device->available + length > sizeof (device->cache)) {
+		WARNING (device->context, "Receive cache overflow, dropping bytes.");
+		length = sizeof (device->cache) - device->offset - device->available;
+	}
+
+	memcpy (device->cache + device->offset + device->available, data, length);
+	device->available += length;
+}
+
+// Receive a single ATT protocol data unit. Returns DC_STATUS_TIMEOUT
+// if nothing arrives within the given timeout.
+static dc_status_t
+dc_ble_recv_pdu (dc_ble_t *device, unsigned char pdu[], size_t size, size_t *actual, int timeout)
+{
+	while (1) {
+		fd_set fds;
+		FD_ZERO (&fds);
+		FD_SET (device->fd, &fds);
+
+		struct timeval tvt;
+		if (timeout > 0) {
+			tvt.tv_sec  = (timeout / 1000);
+			tvt.tv_usec = (timeout % 1000) * 1000;
+		} else if (timeout == 0) {
+			timerclear (&tvt);
+		}
+
+		int rc = select (device->fd + 1, &fds, NULL, NULL, timeout >= 0 ? &tvt : NULL);
+		if (rc < 0) {
+			int errcode = errno;
+			if (errcode == EINTR)
+				continue; // Retry.
+			SYSERROR (device->context, errcode);
+			return syserror(errcode);
+		} else if (rc == 0) {
+			return DC_STATUS_TIMEOUT;
+		}
+
+		ssize_t n = recv (device->fd, pdu, size, 0);
+		if (n < 0) {
+			int errcode = errno;
+			if (errcode == EINTR || errcode == EAGAIN)
+				continue; // Retry.
+			SYSERROR (device->context, errcode);
+			return syserror(errcode);
+		} else if (n == 0) {
+			ERROR (device->context, "Connection closed by the device.");
+			return DC_STATUS_IO;
+		}
+
+		if (actual)
+			*actual = n;
+
+		return DC_STATUS_SUCCESS;
+	}
+}
+
+// Process an unsolicited PDU. Notifications are buffered in the
+// receive cache, everything else is ignored.
+static void
+dc_ble_process_pdu (dc_ble_t *device, const unsigned char pdu[], size_t size)
+{
+	if (size >= 3 && pdu[0] == ATT_HANDLE_VALUE_NTF) {
+		device->metrics.rbytes += size - 3;
+		dc_ble_cache_append (device, pdu + 3, size - 3);
+	}
+}
+
+// Send a request PDU and wait for the matching response. Notifications
+// arriving in between are buffered. An error response for the request
+// is delivered to the caller for inspection.
+static dc_status_t
+dc_ble_request (dc_ble_t *device, const unsigned char request[], size_t reqsize, unsigned char response[], size_t size, size_t *actual)
+{
+	dc_status_t status = DC_STATUS_SUCCESS;
+
+	ssize_t n = send (device->fd, request, reqsize, 0);
+	if (n < 0 || (size_t) n != reqsize) {
+		int errcode = errno;
+		SYSERROR (device->context, errcode);
+		return syserror(errcode);
+	}
+
+	unsigned char expected = request[0] + 1;
+	while (1) {
+		size_t length = 0;
+		status = dc_ble_recv_pdu (device, response, size, &length, REQUEST_TIMEOUT);
+		if (status != DC_STATUS_SUCCESS)
+			return status;
+
+		if (length >= 1 && response[0] == expected) {
+			if (actual)
+				*actual = length;
+			return DC_STATUS_SUCCESS;
+		}
+
+		if (length >= 5 && response[0] == ATT_ERROR_RSP && response[1] == request[0]) {
+			if (actual)
+				*actual = length;
+			return DC_STATUS_SUCCESS;
+		}
+
+		dc_ble_process_pdu (device, response, length);
+	}
+}
+
+dc_status_t
+dc_ble_open (dc_ble_t **out, dc_context_t *context)
+{
+	dc_ble_t *device = NULL;
+
+	if (out == NULL)
+		return DC_STATUS_INVALIDARGS;
+
+	// Allocate memory.
+	device = (dc_ble_t *) malloc (sizeof (dc_ble_t));
+	if (device == NULL) {
+		SYSERROR (context, ENOMEM);
+		return DC_STATUS_NOMEMORY;
+	}
+
+	// Library context.
+	device->context = context;
+
+	memset (&device->metrics, 0, sizeof (device->metrics));
+
+	// Default to blocking reads.
+	device->timeout = -1;
+
+	// Not connected yet.
+	device->fd = -1;
+	device->mtu = ATT_DEFAULT_MTU;
+	device->txhandle = 0;
+	device->rxhandle = 0;
+	device->txcommand = 0;
+
+	// The receive cache is empty.
+	device->offset = 0;
+	device->available = 0;
+
+	*out = device;
+
+	return DC_STATUS_SUCCESS;
+}
+
+dc_status_t
+dc_ble_close (dc_ble_t *device)
+{
+	dc_status_t status = DC_STATUS_SUCCESS;
+
+	if (device == NULL)
+		return DC_STATUS_SUCCESS;
+
+	if (device->fd != -1) {
+		// Terminate all send and receive operations.
+		shutdown (device->fd, 0);
+
+		// Close the socket.
+		if (close (device->fd) != 0) {
+			int errcode = errno;
+			SYSERROR (device->context, errcode);
+			dc_status_set_error(&status, syserror(errcode));
+		}
+	}
+
+	// Free memory.
+	free (device);
+
+	return status;
+}
+
+dc_status_t
+dc_ble_set_timeout (dc_ble_t *device, int timeout)
+{
+	if (device == NULL)
+		return DC_STATUS_INVALIDARGS;
+
+	INFO (device->context, "Timeout: value=%i", timeout);
+
+	device->timeout = timeout;
+
+	return DC_STATUS_SUCCESS;
+}
+
+static dc_status_t
+dc_ble_socket_connect (dc_ble_t *device, const bdaddr_t *ba, unsigned char type)
+{
+	// Open the L2CAP socket.
+	int fd = socket (AF_BLUETOOTH, SOCK_SEQPACKET, BTPROTO_L2CAP);
+	if (fd == -1) {
+		int errcode = errno;
+		SYSERROR (device->context, errcode);
+		return syserror(errcode);
+	}
+
+	// Request a security level that triggers the pairing, if the
+	// device requires it. Failures are ignored, because the kernel
+	// may still raise the level on demand.
+	struct bt_security sec;
+	memset (&sec, 0, sizeof (sec));
+	sec.level = BT_SECURITY_MEDIUM;
+	if (setsockopt (fd, SOL_BLUETOOTH, BT_SECURITY, &sec, sizeof (sec)) != 0) {
+		INFO (device->context, "Failed to set the security level.");
+	}
+
+	// Bind to the LE transport of the local adapter.
+	struct sockaddr_l2 local;
+	memset (&local, 0, sizeof (local));
+	local.l2_family = AF_BLUETOOTH;
+	local.l2_cid = htobs (ATT_CID);
+	local.l2_bdaddr_type = BDADDR_LE_PUBLIC;
+	if (bind (fd, (struct sockaddr *) &local, sizeof (local)) != 0) {
+		int errcode = errno;
+		SYSERROR (device->context, errcode);
+		close (fd);
+		return syserror(errcode);
+	}
+
+	// Connect to the ATT channel of the device.
+	struct sockaddr_l2 peer;
+	memset (&peer, 0, sizeof (peer));
+	peer.l2_family = AF_BLUETOOTH;
+	peer.l2_cid = htobs (ATT_CID);
+	peer.l2_bdaddr = *ba;
+	peer.l2_bdaddr_type = type;
+	if (connect (fd, (struct sockaddr *) &peer, sizeof (peer)) != 0) {
+		int errcode = errno;
+		SYSERROR (device->context, errcode);
+		close (fd);
+		return syserror(errcode);
+	}
+
+	device->fd = fd;
+
+	return DC_STATUS_SUCCESS;
+}
+
+static dc_status_t
+dc_ble_exchange_mtu (dc_ble_t *device)
+{
+	unsigned char request[3] = {
+		ATT_EXCHANGE_MTU_REQ,
+		(ATT_MAX_MTU     ) & 0xFF,
+		(ATT_MAX_MTU >> 8) & 0xFF};
+	unsigned char response[ATT_MAX_MTU];
+	size_t length = 0;
+
+	dc_status_t status = dc_ble_request (device, request, sizeof (request), response, sizeof (response), &length);
+	if (status != DC_STATUS_SUCCESS)
+		return status;
+
+	if (length >= 3 && response[0] == ATT_EXCHANGE_MTU_RSP) {
+		unsigned int mtu = array_uint16_le (response + 1);
+		if (mtu < ATT_DEFAULT_MTU)
+			mtu = ATT_DEFAULT_MTU;
+		if (mtu > ATT_MAX_MTU)
+			mtu = ATT_MAX_MTU;
+		device->mtu = mtu;
+	}
+
+	// An error response means the device only supports the default
+	// MTU, which is not an error.
+
+	return DC_STATUS_SUCCESS;
+}
+
+static dc_status_t
+dc_ble_discover (dc_ble_t *device)
+{
+	unsigned char response[ATT_MAX_MTU];
+	unsigned int start = 0x0001;
+
+	// Enumerate the characteristic declarations, and pick the first
+	// writable characteristic for the outgoing data, and the first
+	// notifying characteristic for the incoming data.
+	while (start != 0 && (device->txhandle == 0 || device->rxhandle == 0)) {
+		unsigned char request[7] = {
+			ATT_READ_BY_TYPE_REQ,
+			(start     ) & 0xFF,
+			(start >> 8) & 0xFF,
+			0xFF, 0xFF,
+			(GATT_CHARACTERISTIC     ) & 0xFF,
+			(GATT_CHARACTERISTIC >> 8) & 0xFF};
+		size_t length = 0;
+
+		dc_status_t status = dc_ble_request (device, request, sizeof (request), response, sizeof (response), &length);
+		if (status != DC_STATUS_SUCCESS)
+			return status;
+
+		if (response[0] == ATT_ERROR_RSP) {
+			if (length >= 5 && response[4] == ATT_ECODE_ATTR_NOT_FOUND)
+				break; // End of the attribute table.
+			ERROR (device->context, "GATT discovery failed (error %02x).",
+				length >= 5 ? response[4] : 0);
+			return DC_STATUS_IO;
+		}
+
+		if (length < 2)
+			return DC_STATUS_PROTOCOL;
+
+		// Each entry holds the declaration handle (2 bytes), the
+		// properties (1 byte), the value handle (2 bytes), and the
+		// characteristic UUID (2 or 16 bytes).
+		unsigned int esize = response[1];
+		if (esize < 7 || length - 2 < esize)
+			return DC_STATUS_PROTOCOL;
+
+		unsigned int next = 0;
+		for (size_t offset = 2; offset + esize <= length; offset += esize) {
+			unsigned int handle = array_uint16_le (response + offset);
+			unsigned int properties = response[offset + 2];
+			unsigned int value = array_uint16_le (response + offset + 3);
+
+			if (device->txhandle == 0 &&
+				(properties & (GATT_PROP_WRITE_CMD | GATT_PROP_WRITE_REQ))) {
+				device->txhandle = value;
+				device->txcommand = (properties & GATT_PROP_WRITE_CMD) != 0;
+			}
+			if (device->rxhandle == 0 && (properties & GATT_PROP_NOTIFY)) {
+				device->rxhandle = value;
+			}
+
+			next = handle + 1;
+		}
+
+		if (next <= start || next > 0xFFFF)
+			break;
+		start = next;
+	}
+
+	if (device->txhandle == 0 || device->rxhandle == 0) {
+		ERROR (device->context, "No suitable GATT characteristics found.");
+		return DC_STATUS_UNSUPPORTED;
+	}
+
+	return DC_STATUS_SUCCESS;
+}
+
+static dc_status_t
+dc_ble_enable_notifications (dc_ble_t *device)
+{
+	unsigned char response[ATT_MAX_MTU];
+	unsigned int ccc = 0;
+	unsigned int start = device->rxhandle + 1;
+
+	// Locate the client characteristic configuration descriptor of
+	// the notifying characteristic.
+	while (ccc == 0 && start != 0 && start <= 0xFFFF) {
+		unsigned char request[5] = {
+			ATT_FIND_INFO_REQ,
+			(start     ) & 0xFF,
+			(start >> 8) & 0xFF,
+			0xFF, 0xFF};
+		size_t length = 0;
+
+		dc_status_t status = dc_ble_request (device, request, sizeof (request), response, sizeof (response), &length);
+		if (status != DC_STATUS_SUCCESS)
+			return status;
+
+		if (response[0] == ATT_ERROR_RSP)
+			break;
+
+		// Only the 16 bit UUID format can contain the descriptor.
+		if (length < 2 || response[1] != 0x01)
+			break;
+
+		unsigned int next = 0;
+		for (size_t offset = 2; offset + 4 <= length; offset += 4) {
+			unsigned int handle = array_uint16_le (response + offset);
+			unsigned int uuid = array_uint16_le (response + offset + 2);
+			if (uuid == GATT_CLIENT_CONFIG) {
+				ccc = handle;
+				break;
+			}
+			next = handle + 1;
+		}
+
+		if (ccc == 0 && next <= start)
+			break;
+		start = next;
+	}
+
+	if (ccc == 0) {
+		ERROR (device->context, "No client configuration descriptor found.");
+		return DC_STATUS_UNSUPPORTED;
+	}
+
+	// Enable the notifications.
+	unsigned char request[5] = {
+		ATT_WRITE_REQ,
+		(ccc     ) & 0xFF,
+		(ccc >> 8) & 0xFF,
+		0x01, 0x00};
+	size_t length = 0;
+
+	dc_status_t status = dc_ble_request (device, request, sizeof (request), response, sizeof (response), &length);
+	if (status != DC_STATUS_SUCCESS)
+		return status;
+
+	if (response[0] != ATT_WRITE_RSP) {
+		ERROR (device->context, "Failed to enable the notifications.");
+		return DC_STATUS_IO;
+	}
+
+	return DC_STATUS_SUCCESS;
+}
+
+dc_status_t
+dc_ble_connect (dc_ble_t *device, const char *address)
+{
+	dc_status_t status = DC_STATUS_SUCCESS;
+
+	if (device == NULL)
+		return DC_STATUS_INVALIDARGS;
+
+	INFO (device->context, "Connect: address=%s", address ? address : "");
+
+	// Parse the address string.
+	bdaddr_t ba;
+	memset (&ba, 0, sizeof (ba));
+	if (dc_ble_str2ba (address, &ba) != 0) {
+		ERROR (device->context, "Invalid Bluetooth address.");
+		return DC_STATUS_INVALIDARGS;
+	}
+
+	// Connect with a public address first, and fall back to a random
+	// address, because the address type is not known in advance.
+	status = dc_ble_socket_connect (device, &ba, BDADDR_LE_PUBLIC);
+	if (status != DC_STATUS_SUCCESS) {
+		status = dc_ble_socket_connect (device, &ba, BDADDR_LE_RANDOM);
+		if (status != DC_STATUS_SUCCESS) {
+			ERROR (device->context, "Failed to connect to the device.");
+			return status;
+		}
+	}
+
+	// Negotiate the ATT MTU.
+	status = dc_ble_exchange_mtu (device);
+	if (status != DC_STATUS_SUCCESS)
+		goto error_close;
+
+	// Locate the data characteristics.
+	status = dc_ble_discover (device);
+	if (status != DC_STATUS_SUCCESS)
+		goto error_close;
+
+	// Enable the notifications.
+	status = dc_ble_enable_notifications (device);
+	if (status != DC_STATUS_SUCCESS)
+		goto error_close;
+
+	INFO (device->context, "Connect: mtu=%u, tx=%04x (%s), rx=%04x",
+		device->mtu, device->txhandle,
+		device->txcommand ? "command" : "request",
+		device->rxhandle);
+
+	return DC_STATUS_SUCCESS;
+
+error_close:
+	shutdown (device->fd, 0);
+	close (device->fd);
+	device->fd = -1;
+	return status;
+}
+
+dc_status_t
+dc_ble_get_available (dc_ble_t *device, size_t *value)
+{
+	if (device == NULL)
+		return DC_STATUS_INVALIDARGS;
+
+	if (value)
+		*value = device->available;
+
+	return DC_STATUS_SUCCESS;
+}
+
+dc_status_t
+dc_ble_read (dc_ble_t *device, void *data, size_t size, size_t *actual)
+{
+	dc_status_t status = DC_STATUS_SUCCESS;
+	size_t nbytes = 0;
+
+	if (device == NULL) {
+		status = DC_STATUS_INVALIDARGS;
+		goto out_invalidargs;
+	}
+
+	while (nbytes < size) {
+		// Serve data from the receive cache first.
+		if (device->available) {
+			size_t length = device->available;
+			if (length > size - nbytes)
+				length = size - nbytes;
+			memcpy ((char*) data + nbytes, device->cache + device->offset, length);
+			device->offset += length;
+			device->available -= length;
+			nbytes += length;
+			continue;
+		}
+
+		// Wait for the next notification.
+		unsigned char pdu[ATT_MAX_MTU];
+		size_t length = 0;
+		dc_status_t rc = dc_ble_recv_pdu (device, pdu, sizeof (pdu), &length, device->timeout);
+		if (rc == DC_STATUS_TIMEOUT) {
+			// The select has waited out the full timeout.
+			device->metrics.timeouts++;
+			if (device->timeout > 0)
+				device->metrics.stalltime += device->timeout;
+			break; // Timeout.
+		} else if (rc != DC_STATUS_SUCCESS) {
+			status = rc;
+			goto out;
+		}
+
+		dc_ble_process_pdu (device, pdu, length);
+	}
+
+	if (nbytes != size) {
+		status = DC_STATUS_TIMEOUT;
+	}
+
+out:
+	HEXDUMP (device->context, DC_LOGLEVEL_INFO, "Read", (unsigned char *) data, nbytes);
+
+out_invalidargs:
+	if (actual)
+		*actual = nbytes;
+
+	return status;
+}
+
+dc_status_t
+dc_ble_write (dc_ble_t *device, const void *data, size_t size, size_t *actual)
+{
+	dc_status_t status = DC_STATUS_SUCCESS;
+	size_t nbytes = 0;
+
+	if (device == NULL) {
+		status = DC_STATUS_INVALIDARGS;
+		goto out_invalidargs;
+	}
+
+	// The payload is split into chunks of MTU minus 3 bytes, the
+	// maximum a single ATT write can carry. With write-without-response
+	// the chunks are pipelined: they are handed to the kernel back to
+	// back, without waiting a round trip per chunk, and the radio
+	// packs them into consecutive connection events. Devices without
+	// write-without-response fall back to acknowledged writes.
+	while (nbytes < size) {
+		size_t length = device->mtu - 3;
+		if (length > size - nbytes)
+			length = size - nbytes;
+
+		unsigned char pdu[ATT_MAX_MTU];
+		pdu[0] = device->txcommand ? ATT_WRITE_CMD : ATT_WRITE_REQ;
+		pdu[1] = (device->txhandle     ) & 0xFF;
+		pdu[2] = (device->txhandle >> 8) & 0xFF;
+		memcpy (pdu + 3, (const char*) data + nbytes, length);
+
+		ssize_t n = send (device->fd, pdu, length + 3, 0);
+		if (n < 0) {
+			int errcode = errno;
+			if (errcode == EINTR || errcode == EAGAIN)
+				continue; // Retry.
+			SYSERROR (device->context, errcode);
+			status = syserror(errcode);
+			goto out;
+		}
+
+		if (!device->txcommand) {
+			// Wait for the acknowledgement.
+			unsigned char response[ATT_MAX_MTU];
+			size_t rsplen = 0;
+			while (1) {
+				dc_status_t rc = dc_ble_recv_pdu (device, response, sizeof (response), &rsplen, REQUEST_TIMEOUT);
+				if (rc != DC_STATUS_SUCCESS) {
+					status = rc;
+					goto out;
+				}
+				if (rsplen >= 1 && (response[0] == ATT_WRITE_RSP || response[0] == ATT_ERROR_RSP))
+					break;
+				dc_ble_process_pdu (device, response, rsplen);
+			}
+			if (response[0] == ATT_ERROR_RSP) {
+				ERROR (device->context, "Write rejected by the device.");
+				status = DC_STATUS_IO;
+				goto out;
+			}
+		}
+
+		nbytes += length;
+		device->metrics.wbytes += length;
+	}
+
+out:
+	HEXDUMP (device->context, DC_LOGLEVEL_INFO, "Write", (unsigned char *) data, nbytes);
+
+out_invalidargs:
+	if (actual)
+		*actual = nbytes;
+
+	return status;
+}
+
+dc_status_t
+dc_ble_sleep (dc_ble_t *device, unsigned int timeout)
+{
+	if (device == NULL)
+		return DC_STATUS_INVALIDARGS;
+
+	INFO (device->context, "Sleep: value=%u", timeout);
+
+	struct timespec ts;
+	ts.tv_sec  = (timeout / 1000);
+	ts.tv_nsec = (timeout % 1000) * 1000000;
+
+	while (nanosleep (&ts, &ts) != 0) {
+		int errcode = errno;
+		if (errcode != EINTR ) {
+			SYSERROR (device->context, errcode);
+			return syserror (errcode);
+		}
+	}
+
+	return DC_STATUS_SUCCESS;
+}
+
+dc_status_t
+dc_ble_get_metrics (dc_ble_t *device, dc_event_metrics_t *metrics)
+{
+	if (device == NULL || metrics == NULL)
+		return DC_STATUS_INVALIDARGS;
+
+	*metrics = device->metrics;
+
+	return DC_STATUS_SUCCESS;
+}
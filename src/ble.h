@@ -0,0 +1,179 @@
+/*
+ * libdivecomputer
+ *
+ * Copyright (C) 2014 Jef Driesen
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA
+ */
+
+#ifndef DC_BLE_H
+#define DC_BLE_H
+
+#include <libdivecomputer/common.h>
+#include <libdivecomputer/context.h>
+#include <libdivecomputer/device.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/**
+ * Opaque object representing a Bluetooth Low Energy (GATT) connection.
+ */
+typedef struct dc_ble_t dc_ble_t;
+
+/**
+ * Open a Bluetooth Low Energy connection.
+ *
+ * @param[out]  ble      A location to store the BLE connection.
+ * @param[in]   context  A valid context object.
+ * @returns #DC_STATUS_SUCCESS on success, or another #dc_status_t code
+ * on failure.
+ */
+dc_status_t
+dc_ble_open (dc_ble_t **ble, dc_context_t *context);
+
+/**
+ * Close the BLE connection and free all resources.
+ *
+ * @param[in]  ble  A valid BLE connection.
+ * @returns #DC_STATUS_SUCCESS on success, or another #dc_status_t code
+ * on failure.
+ */
+dc_status_t
+dc_ble_close (dc_ble_t *ble);
+
+/**
+ * Set the read timeout.
+ *
+ * There are three distinct modes available:
+ *
+ *  1. Blocking (timeout < 0):
+ *
+ *     The read operation is blocked until all the requested bytes have
+ *     been received. If the requested number of bytes does not arrive,
+ *     the operation will block forever.
+ *
+ *  2. Non-blocking (timeout == 0):
+ *
+ *     The read operation returns immediately with the bytes that have
+ *     already been received, even if no bytes have been received.
+ *
+ *  3. Timeout (timeout > 0):
+ *
+ *     The read operation is blocked until all the requested bytes have
+ *     been received. If the requested number of bytes does not arrive
+ *     within the specified amount of time, the operation will return
+ *     with the bytes that have already been received.
+ *
+ * @param[in]  ble      A valid BLE connection.
+ * @param[in]  timeout  The timeout in milliseconds.
+ * @returns #DC_STATUS_SUCCESS on success, or another #dc_status_t code
+ * on failure.
+ */
+dc_status_t
+dc_ble_set_timeout (dc_ble_t *ble, int timeout);
+
+/**
+ * Connect to a BLE device.
+ *
+ * The connection negotiates the ATT MTU, locates a writable and a
+ * notifying GATT characteristic, and enables the notifications. The
+ * pair of characteristics forms a bidirectional byte stream for the
+ * protocol code, comparable to a serial port.
+ *
+ * @param[in]  ble      A valid BLE connection.
+ * @param[in]  address  The Bluetooth device address, formatted as six
+ *                      hexadecimal octets separated by colons
+ *                      (e.g. "00:11:22:33:44:55").
+ * @returns #DC_STATUS_SUCCESS on success, or another #dc_status_t code
+ * on failure.
+ */
+dc_status_t
+dc_ble_connect (dc_ble_t *ble, const char *address);
+
+/**
+ * Query the number of available bytes in the input buffer.
+ *
+ * Only the bytes that have already been received and buffered are
+ * counted, not the notifications still queued inside the socket.
+ *
+ * @param[in]   ble    A valid BLE connection.
+ * @param[out]  value  A location to store the number of bytes in the
+ *                     input buffer.
+ * @returns #DC_STATUS_SUCCESS on success, or another #dc_status_t code
+ * on failure.
+ */
+dc_status_t
+dc_ble_get_available (dc_ble_t *ble, size_t *value);
+
+/**
+ * Read data from the BLE connection.
+ *
+ * @param[in]  ble     A valid BLE connection.
+ * @param[out] data    The memory buffer to read the data into.
+ * @param[in]  size    The number of bytes to read.
+ * @param[out] actual  An (optional) location to store the actual
+ *                     number of bytes transferred.
+ * @returns #DC_STATUS_SUCCESS on success, or another #dc_status_t code
+ * on failure.
+ */
+dc_status_t
+dc_ble_read (dc_ble_t *ble, void *data, size_t size, size_t *actual);
+
+/**
+ * Write data to the BLE connection.
+ *
+ * @param[in]  ble     A valid BLE connection.
+ * @param[in]  data    The memory buffer to write the data from.
+ * @param[in]  size    The number of bytes to write.
+ * @param[out] actual  An (optional) location to store the actual
+ *                     number of bytes transferred.
+ * @returns #DC_STATUS_SUCCESS on success, or another #dc_status_t code
+ * on failure.
+ */
+dc_status_t
+dc_ble_write (dc_ble_t *ble, const void *data, size_t size, size_t *actual);
+
+/**
+ * Suspend execution for the given amount of time.
+ *
+ * @param[in]  ble      A valid BLE connection.
+ * @param[in]  timeout  The number of milliseconds to sleep.
+ * @returns #DC_STATUS_SUCCESS on success, or another #dc_status_t code
+ * on failure.
+ */
+dc_status_t
+dc_ble_sleep (dc_ble_t *ble, unsigned int timeout);
+
+/**
+ * Query the transfer statistics of the connection.
+ *
+ * The retries field is not known to the transport layer, and is left
+ * zero.
+ *
+ * @param[in]   ble      A valid BLE connection.
+ * @param[out]  metrics  A location to store the transfer statistics.
+ * @returns #DC_STATUS_SUCCESS on success, or another #dc_status_t code
+ * on failure.
+ */
+dc_status_t
+dc_ble_get_metrics (dc_ble_t *ble, dc_event_metrics_t *metrics);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+#endif /* DC_BLE_H */
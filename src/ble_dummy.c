@@ -0,0 +1,78 @@
+/*
+ * libdivecomputer
+ *
+ * Copyright (C) 2014 Jef Driesen
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA
+ */
+
+#include <stddef.h>
+
+#include "ble.h"
+
+dc_status_t
+dc_ble_open (dc_ble_t **out, dc_context_t *context)
+{
+	return DC_STATUS_UNSUPPORTED;
+}
+
+dc_status_t
+dc_ble_close (dc_ble_t *device)
+{
+	return DC_STATUS_UNSUPPORTED;
+}
+
+dc_status_t
+dc_ble_set_timeout (dc_ble_t *device, int timeout)
+{
+	return DC_STATUS_UNSUPPORTED;
+}
+
+dc_status_t
+dc_ble_connect (dc_ble_t *device, const char *address)
+{
+	return DC_STATUS_UNSUPPORTED;
+}
+
+dc_status_t
+dc_ble_get_available (dc_ble_t *device, size_t *value)
+{
+	return DC_STATUS_UNSUPPORTED;
+}
+
+dc_status_t
+dc_ble_read (dc_ble_t *device, void *data, size_t size, size_t *actual)
+{
+	return DC_STATUS_UNSUPPORTED;
+}
+
+dc_status_t
+dc_ble_write (dc_ble_t *device, const void *data, size_t size, size_t *actual)
+{
+	return DC_STATUS_UNSUPPORTED;
+}
+
+dc_status_t
+dc_ble_sleep (dc_ble_t *device, unsigned int timeout)
+{
+	return DC_STATUS_UNSUPPORTED;
+}
+
+dc_status_t
+dc_ble_get_metrics (dc_ble_t *device, dc_event_metrics_t *metrics)
+{
+	return DC_STATUS_UNSUPPORTED;
+}
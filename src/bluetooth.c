@@ -0,0 +1,519 @@
+/*
+ * libdivecomputer
+ *
+ * Copyright (C) 2014 Jef Driesen
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA
+ */
+
+#include <stdlib.h> // malloc, free
+#include <string.h> // memcpy, memset
+#ifdef _WIN32
+	#define NOGDI
+	#include <winsock2.h>
+	#include <windows.h>
+	#include <ws2bth.h>
+#else
+	#include <errno.h>      // errno
+	#include <unistd.h>     // close
+	#include <sys/types.h>  // socket
+	#include <sys/socket.h> // socket, connect
+	#include <bluetooth/bluetooth.h> // bdaddr_t
+	#include <bluetooth/rfcomm.h>    // sockaddr_rc
+	#include <sys/select.h> // select
+	#include <sys/ioctl.h>  // ioctl
+	#include <sys/time.h>
+#endif
+
+#include "bluetooth.h"
+#include "common-private.h"
+#include "context-private.h"
+
+#ifdef _WIN32
+typedef int s_ssize_t;
+typedef DWORD s_errcode_t;
+#define S_ERRNO WSAGetLastError ()
+#define S_EINTR WSAEINTR
+#define S_EAGAIN WSAEWOULDBLOCK
+#define S_ENOMEM WSA_NOT_ENOUGH_MEMORY
+#define S_EINVAL WSAEINVAL
+#define S_EACCES WSAEACCES
+#define S_EAFNOSUPPORT WSAEAFNOSUPPORT
+#define S_INVALID INVALID_SOCKET
+#define S_IOCTL ioctlsocket
+#define S_CLOSE closesocket
+#else
+typedef ssize_t s_ssize_t;
+typedef int s_errcode_t;
+#define S_ERRNO errno
+#define S_EINTR EINTR
+#define S_EAGAIN EAGAIN
+#define S_ENOMEM ENOMEM
+#define S_EINVAL EINVAL
+#define S_EACCES EACCES
+#define S_EAFNOSUPPORT EAFNOSUPPORT
+#define S_INVALID -1
+#define S_IOCTL ioctl
+#define S_CLOSE close
+#endif
+
+// The size of the receive cache. An RFCOMM link delivers data in
+// frames of up to the negotiated MTU (typically around 1000 bytes),
+// while the SLIP based protocols on top of it read a single byte at a
+// time. The cache drains several complete frames per recv() call, and
+// the byte sized reads are served from memory, instead of paying a
+// syscall per protocol byte.
+#define RECEIVE_BUFSIZE 4096
+
+struct dc_bluetooth_t {
+	dc_context_t *context;
+#ifdef _WIN32
+	SOCKET fd;
+#else
+	int fd;
+#endif
+	int timeout;
+	/* Transfer statistics */
+	dc_event_metrics_t metrics;
+	/* Receive cache */
+	unsigned char cache[RECEIVE_BUFSIZE];
+	size_t offset;
+	size_t available;
+};
+
+static dc_status_t
+syserror(s_errcode_t errcode)
+{
+	switch (errcode) {
+	case S_EINVAL:
+		return DC_STATUS_INVALIDARGS;
+	case S_ENOMEM:
+		return DC_STATUS_NOMEMORY;
+	case S_EACCES:
+		return DC_STATUS_NOACCESS;
+	case S_EAFNOSUPPORT:
+		return DC_STATUS_UNSUPPORTED;
+	default:
+		return DC_STATUS_IO;
+	}
+}
+
+static int
+dc_bluetooth_str2ba (const char *address, unsigned char ba[6])
+{
+	unsigned int i = 0, nbytes = 0;
+	unsigned int value = 0, ndigits = 0;
+
+	if (address == NULL)
+		return -1;
+
+	while (address[i] != '\0') {
+		unsigned char c = address[i];
+		if (c == ':') {
+			if (ndigits == 0 || nbytes >= 5)
+				return -1;
+			ba[nbytes++] = value;
+			value = 0;
+			ndigits = 0;
+		} else {
+			unsigned int digit = 0;
+			if (c >= '0' && c <= '9')
+				digit = c - '0';
+			else if (c >= 'A' && c <= 'F')
+				digit = c - 'A' + 10;
+			else if (c >= 'a' && c <= 'f')
+				digit = c - 'a' + 10;
+			else
+				return -1;
+			if (ndigits >= 2)
+				return -1;
+			value = (value << 4) | digit;
+			ndigits++;
+		}
+		i++;
+	}
+
+	if (ndigits == 0 || nbytes != 5)
+		return -1;
+	ba[nbytes] = value;
+
+	return 0;
+}
+
+dc_status_t
+dc_bluetooth_open (dc_bluetooth_t **out, dc_context_t *context)
+{
+	dc_status_t status = DC_STATUS_SUCCESS;
+	dc_bluetooth_t *device = NULL;
+
+	if (out == NULL)
+		return DC_STATUS_INVALIDARGS;
+
+	// Allocate memory.
+	device = (dc_bluetooth_t *) malloc (sizeof (dc_bluetooth_t));
+	if (device == NULL) {
+		SYSERROR (context, S_ENOMEM);
+		return DC_STATUS_NOMEMORY;
+	}
+
+	// Library context.
+	device->context = context;
+
+	memset (&device->metrics, 0, sizeof (device->metrics));
+
+	// Default to blocking reads.
+	device->timeout = -1;
+
+	// The receive cache is empty.
+	device->offset = 0;
+	device->available = 0;
+
+#ifdef _WIN32
+	// Initialize the winsock dll.
+	WSADATA wsaData;
+	WORD wVersionRequested = MAKEWORD (2, 2);
+	int rc = WSAStartup (wVersionRequested, &wsaData);
+	if (rc != 0) {
+		SYSERROR (context, rc);
+		status = DC_STATUS_UNSUPPORTED;
+		goto error_free;
+	}
+
+	// Confirm that the winsock dll supports version 2.2.
+	// Note that if the dll supports versions greater than 2.2 in addition to
+	// 2.2, it will still return 2.2 since that is the version we requested.
+	if (LOBYTE (wsaData.wVersion) != 2 ||
+		HIBYTE (wsaData.wVersion) != 2) {
+		ERROR (context, "Incorrect winsock version.");
+		status = DC_STATUS_UNSUPPORTED;
+		goto error_wsacleanup;
+	}
+#endif
+
+	// Open the socket.
+#ifdef _WIN32
+	device->fd = socket (AF_BTH, SOCK_STREAM, BTHPROTO_RFCOMM);
+#else
+	device->fd = socket (AF_BLUETOOTH, SOCK_STREAM, BTPROTO_RFCOMM);
+#endif
+	if (device->fd == S_INVALID) {
+		s_errcode_t errcode = S_ERRNO;
+		SYSERROR (context, errcode);
+		status = syserror(errcode);
+		goto error_wsacleanup;
+	}
+
+	*out = device;
+
+	return DC_STATUS_SUCCESS;
+
+error_wsacleanup:
+#ifdef _WIN32
+	WSACleanup ();
+error_free:
+#endif
+	free (device);
+	return status;
+}
+
+dc_status_t
+dc_bluetooth_close (dc_bluetooth_t *device)
+{
+	dc_status_t status = DC_STATUS_SUCCESS;
+
+	if (device == NULL)
+		return DC_STATUS_SUCCESS;
+
+	// Terminate all send and receive operations.
+	shutdown (device->fd, 0);
+
+	// Close the socket.
+	if (S_CLOSE (device->fd) != 0) {
+		s_errcode_t errcode = S_ERRNO;
+		SYSERROR (device->context, errcode);
+		dc_status_set_error(&status, syserror(errcode));
+	}
+
+#ifdef _WIN32
+	// Terminate the winsock dll.
+	if (WSACleanup () != 0) {
+		s_errcode_t errcode = S_ERRNO;
+		SYSERROR (device->context, errcode);
+		dc_status_set_error(&status, syserror(errcode));
+	}
+#endif
+
+	// Free memory.
+	free (device);
+
+	return status;
+}
+
+dc_status_t
+dc_bluetooth_set_timeout (dc_bluetooth_t *device, int timeout)
+{
+	if (device == NULL)
+		return DC_STATUS_INVALIDARGS;
+
+	INFO (device->context, "Timeout: value=%i", timeout);
+
+	device->timeout = timeout;
+
+	return DC_STATUS_SUCCESS;
+}
+
+dc_status_t
+dc_bluetooth_connect (dc_bluetooth_t *device, const char *address, unsigned int channel)
+{
+	if (device == NULL)
+		return DC_STATUS_INVALIDARGS;
+
+	INFO (device->context, "Connect: address=%s, channel=%u", address ? address : "", channel);
+
+	// Parse the address string.
+	unsigned char ba[6] = {0};
+	if (dc_bluetooth_str2ba (address, ba) != 0) {
+		ERROR (device->context, "Invalid Bluetooth address.");
+		return DC_STATUS_INVALIDARGS;
+	}
+
+#ifdef _WIN32
+	SOCKADDR_BTH peer;
+	memset (&peer, 0, sizeof (peer));
+	peer.addressFamily = AF_BTH;
+	peer.btAddr = ((ULONGLONG) ba[0] << 40) |
+	              ((ULONGLONG) ba[1] << 32) |
+	              ((ULONGLONG) ba[2] << 24) |
+	              ((ULONGLONG) ba[3] << 16) |
+	              ((ULONGLONG) ba[4] <<  8) |
+	              ((ULONGLONG) ba[5]      );
+	peer.port = channel;
+#else
+	struct sockaddr_rc peer;
+	memset (&peer, 0, sizeof (peer));
+	peer.rc_family = AF_BLUETOOTH;
+	// The binary address is stored in reverse order.
+	for (unsigned int i = 0; i < 6; ++i) {
+		peer.rc_bdaddr.b[i] = ba[5 - i];
+	}
+	peer.rc_channel = channel;
+#endif
+
+	if (connect (device->fd, (struct sockaddr *) &peer, sizeof (peer)) != 0) {
+		s_errcode_t errcode = S_ERRNO;
+		SYSERROR (device->context, errcode);
+		return syserror(errcode);
+	}
+
+	return DC_STATUS_SUCCESS;
+}
+
+dc_status_t
+dc_bluetooth_get_available (dc_bluetooth_t *device, size_t *value)
+{
+	if (device == NULL)
+		return DC_STATUS_INVALIDARGS;
+
+#ifdef _WIN32
+	unsigned long bytes = 0;
+#else
+	int bytes = 0;
+#endif
+
+	if (S_IOCTL (device->fd, FIONREAD, &bytes) != 0) {
+		s_errcode_t errcode = S_ERRNO;
+		SYSERROR (device->context, errcode);
+		return syserror(errcode);
+	}
+
+	if (value)
+		*value = bytes + device->available;
+
+	return DC_STATUS_SUCCESS;
+}
+
+dc_status_t
+dc_bluetooth_read (dc_bluetooth_t *device, void *data, size_t size, size_t *actual)
+{
+	dc_status_t status = DC_STATUS_SUCCESS;
+	size_t nbytes = 0;
+
+	if (device == NULL) {
+		status = DC_STATUS_INVALIDARGS;
+		goto out_invalidargs;
+	}
+
+	// Serve data from the receive cache first.
+	if (device->available) {
+		size_t length = device->available;
+		if (length > size)
+			length = size;
+		memcpy (data, device->cache + device->offset, length);
+		device->offset += length;
+		device->available -= length;
+		nbytes += length;
+	}
+
+	while (nbytes < size) {
+		fd_set fds;
+		FD_ZERO (&fds);
+		FD_SET (device->fd, &fds);
+
+		struct timeval tvt;
+		if (device->timeout > 0) {
+			tvt.tv_sec  = (device->timeout / 1000);
+			tvt.tv_usec = (device->timeout % 1000) * 1000;
+		} else if (device->timeout == 0) {
+			timerclear (&tvt);
+		}
+
+		int rc = select (device->fd + 1, &fds, NULL, NULL, device->timeout >= 0 ? &tvt : NULL);
+		if (rc < 0) {
+			s_errcode_t errcode = S_ERRNO;
+			if (errcode == S_EINTR)
+				continue; // Retry.
+			SYSERROR (device->context, errcode);
+			status = syserror(errcode);
+			goto out;
+		} else if (rc == 0) {
+			// The select has waited out the full timeout.
+			device->metrics.timeouts++;
+			if (device->timeout > 0)
+				device->metrics.stalltime += device->timeout;
+			break; // Timeout.
+		}
+
+		// Large requests are received directly into the caller's
+		// buffer. Smaller ones drain the socket into the cache, and
+		// the remaining bytes are served from memory by subsequent
+		// reads. The recv() call only returns the bytes that are
+		// already available, so it never blocks for more data than
+		// the caller asked for.
+		s_ssize_t n;
+		int direct = (size - nbytes >= sizeof (device->cache));
+		if (direct) {
+			n = recv (device->fd, (char*) data + nbytes, size - nbytes, 0);
+		} else {
+			n = recv (device->fd, (char*) device->cache, sizeof (device->cache), 0);
+		}
+		if (n < 0) {
+			s_errcode_t errcode = S_ERRNO;
+			if (errcode == S_EINTR || errcode == S_EAGAIN)
+				continue; // Retry.
+			SYSERROR (device->context, errcode);
+			status = syserror(errcode);
+			goto out;
+		} else if (n == 0) {
+			break; // EOF reached.
+		}
+
+		device->metrics.rbytes += n;
+
+		if (direct) {
+			nbytes += n;
+		} else {
+			size_t length = (size_t) n;
+			if (length > size - nbytes)
+				length = size - nbytes;
+			memcpy ((char*) data + nbytes, device->cache, length);
+			device->offset = length;
+			device->available = n - length;
+			nbytes += length;
+		}
+	}
+
+	if (nbytes != size) {
+		status = DC_STATUS_TIMEOUT;
+	}
+
+out:
+	HEXDUMP (device->context, DC_LOGLEVEL_INFO, "Read", (unsigned char *) data, nbytes);
+
+out_invalidargs:
+	if (actual)
+		*actual = nbytes;
+
+	return status;
+}
+
+dc_status_t
+dc_bluetooth_write (dc_bluetooth_t *device, const void *data, size_t size, size_t *actual)
+{
+	dc_status_t status = DC_STATUS_SUCCESS;
+	size_t nbytes = 0;
+
+	if (device == NULL) {
+		status = DC_STATUS_INVALIDARGS;
+		goto out_invalidargs;
+	}
+
+	while (nbytes < size) {
+		fd_set fds;
+		FD_ZERO (&fds);
+		FD_SET (device->fd, &fds);
+
+		int rc = select (device->fd + 1, NULL, &fds, NULL, NULL);
+		if (rc < 0) {
+			s_errcode_t errcode = S_ERRNO;
+			if (errcode == S_EINTR)
+				continue; // Retry.
+			SYSERROR (device->context, errcode);
+			status = syserror(errcode);
+			goto out;
+		} else if (rc == 0) {
+			break; // Timeout.
+		}
+
+		s_ssize_t n = send (device->fd, (char*) data + nbytes, size - nbytes, 0);
+		if (n < 0) {
+			s_errcode_t errcode = S_ERRNO;
+			if (errcode == S_EINTR || errcode == S_EAGAIN)
+				continue; // Retry.
+			SYSERROR (device->context, errcode);
+			status = syserror(errcode);
+			goto out;
+		} else if (n == 0) {
+			break; // EOF.
+		}
+
+		nbytes += n;
+		device->metrics.wbytes += n;
+	}
+
+	if (nbytes != size) {
+		status = DC_STATUS_TIMEOUT;
+	}
+
+out:
+	HEXDUMP (device->context, DC_LOGLEVEL_INFO, "Write", (unsigned char *) data, nbytes);
+
+out_invalidargs:
+	if (actual)
+		*actual = nbytes;
+
+	return status;
+}
+
+dc_status_t
+dc_bluetooth_get_metrics (dc_bluetooth_t *device, dc_event_metrics_t *metrics)
+{
+	if (device == NULL || metrics == NULL)
+		return DC_STATUS_INVALIDARGS;
+
+	*metrics = device->metrics;
+
+	return DC_STATUS_SUCCESS;
+}
@@ -0,0 +1,161 @@
+/*
+ * libdivecomputer
+ *
+ * Copyright (C) 2014 Jef Driesen
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA
+ */
+
+#ifndef DC_BLUETOOTH_H
+#define DC_BLUETOOTH_H
+
+#include <libdivecomputer/common.h>
+#include <libdivecomputer/context.h>
+#include <libdivecomputer/device.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/**
+ * Opaque object representing a Bluetooth RFCOMM connection.
+ */
+typedef struct dc_bluetooth_t dc_bluetooth_t;
+
+/**
+ * Open a Bluetooth RFCOMM connection.
+ *
+ * @param[out]  bluetooth  A location to store the Bluetooth connection.
+ * @param[in]   context    A valid context object.
+ * @returns #DC_STATUS_SUCCESS on success, or another #dc_status_t code
+ * on failure.
+ */
+dc_status_t
+dc_bluetooth_open (dc_bluetooth_t **bluetooth, dc_context_t *context);
+
+/**
+ * Close the Bluetooth connection and free all resources.
+ *
+ * @param[in]  bluetooth  A valid Bluetooth connection.
+ * @returns #DC_STATUS_SUCCESS on success, or another #dc_status_t code
+ * on failure.
+ */
+dc_status_t
+dc_bluetooth_close (dc_bluetooth_t *bluetooth);
+
+/**
+ * Set the read timeout.
+ *
+ * There are three distinct modes available:
+ *
+ *  1. Blocking (timeout < 0):
+ *
+ *     The read operation is blocked until all the requested bytes have
+ *     been received. If the requested number of bytes does not arrive,
+ *     the operation will block forever.
+ *
+ *  2. Non-blocking (timeout == 0):
+ *
+ *     The read operation returns immediately with the bytes that have
+ *     already been received, even if no bytes have been received.
+ *
+ *  3. Timeout (timeout > 0):
+ *
+ *     The read operation is blocked until all the requested bytes have
+ *     been received. If the requested number of bytes does not arrive
+ *     within the specified amount of time, the operation will return
+ *     with the bytes that have already been received.
+ *
+ * @param[in]  bluetooth  A valid Bluetooth connection.
+ * @param[in]  timeout    The timeout in milliseconds.
+ * @returns #DC_STATUS_SUCCESS on success, or another #dc_status_t code
+ * on failure.
+ */
+dc_status_t
+dc_bluetooth_set_timeout (dc_bluetooth_t *bluetooth, int timeout);
+
+/**
+ * Connect to a Bluetooth device.
+ *
+ * @param[in]  bluetooth  A valid Bluetooth connection.
+ * @param[in]  address    The Bluetooth device address, formatted as six
+ *                        hexadecimal octets separated by colons
+ *                        (e.g. "00:11:22:33:44:55").
+ * @param[in]  channel    The RFCOMM channel number.
+ * @returns #DC_STATUS_SUCCESS on success, or another #dc_status_t code
+ * on failure.
+ */
+dc_status_t
+dc_bluetooth_connect (dc_bluetooth_t *bluetooth, const char *address, unsigned int channel);
+
+/**
+ * Query the number of available bytes in the input buffer.
+ *
+ * @param[in]   bluetooth  A valid Bluetooth connection.
+ * @param[out]  value      A location to store the number of bytes in
+ *                         the input buffer.
+ * @returns #DC_STATUS_SUCCESS on success, or another #dc_status_t code
+ * on failure.
+ */
+dc_status_t
+dc_bluetooth_get_available (dc_bluetooth_t *bluetooth, size_t *value);
+
+/**
+ * Read data from the Bluetooth connection.
+ *
+ * @param[in]  bluetooth  A valid Bluetooth connection.
+ * @param[out] data       The memory buffer to read the data into.
+ * @param[in]  size       The number of bytes to read.
+ * @param[out] actual     An (optional) location to store the actual
+ *                        number of bytes transferred.
+ * @returns #DC_STATUS_SUCCESS on success, or another #dc_status_t code
+ * on failure.
+ */
+dc_status_t
+dc_bluetooth_read (dc_bluetooth_t *bluetooth, void *data, size_t size, size_t *actual);
+
+/**
+ * Write data to the Bluetooth connection.
+ *
+ * @param[in]  bluetooth  A valid Bluetooth connection.
+ * @param[in]  data       The memory buffer to write the data from.
+ * @param[in]  size       The number of bytes to write.
+ * @param[out] actual     An (optional) location to store the actual
+ *                        number of bytes transferred.
+ * @returns #DC_STATUS_SUCCESS on success, or another #dc_status_t code
+ * on failure.
+ */
+dc_status_t
+dc_bluetooth_write (dc_bluetooth_t *bluetooth, const void *data, size_t size, size_t *actual);
+
+/**
+ * Query the transfer statistics of the connection.
+ *
+ * The retries field is not known to the transport layer, and is left
+ * zero.
+ *
+ * @param[in]   bluetooth  A valid Bluetooth connection.
+ * @param[out]  metrics    A location to store the transfer statistics.
+ * @returns #DC_STATUS_SUCCESS on success, or another #dc_status_t code
+ * on failure.
+ */
+dc_status_t
+dc_bluetooth_get_metrics (dc_bluetooth_t *bluetooth, dc_event_metrics_t *metrics);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+#endif /* DC_BLUETOOTH_H */
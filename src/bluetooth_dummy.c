@@ -0,0 +1,72 @@
+/*
+ * libdivecomputer
+ *
+ * Copyright (C) 2014 Jef Driesen
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA
+ */
+
+#include <stddef.h>
+
+#include "bluetooth.h"
+
+dc_status_t
+dc_bluetooth_open (dc_bluetooth_t **out, dc_context_t *context)
+{
+	return DC_STATUS_UNSUPPORTED;
+}
+
+dc_status_t
+dc_bluetooth_close (dc_bluetooth_t *device)
+{
+	return DC_STATUS_UNSUPPORTED;
+}
+
+dc_status_t
+dc_bluetooth_set_timeout (dc_bluetooth_t *device, int timeout)
+{
+	return DC_STATUS_UNSUPPORTED;
+}
+
+dc_status_t
+dc_bluetooth_connect (dc_bluetooth_t *device, const char *address, unsigned int channel)
+{
+	return DC_STATUS_UNSUPPORTED;
+}
+
+dc_status_t
+dc_bluetooth_get_available (dc_bluetooth_t *device, size_t *value)
+{
+	return DC_STATUS_UNSUPPORTED;
+}
+
+dc_status_t
+dc_bluetooth_read (dc_bluetooth_t *device, void *data, size_t size, size_t *actual)
+{
+	return DC_STATUS_UNSUPPORTED;
+}
+
+dc_status_t
+dc_bluetooth_write (dc_bluetooth_t *device, const void *data, size_t size, size_t *actual)
+{
+	return DC_STATUS_UNSUPPORTED;
+}
+
+dc_status_t
+dc_bluetooth_get_metrics (dc_bluetooth_t *device, dc_event_metrics_t *metrics)
+{
+	return DC_STATUS_UNSUPPORTED;
+}
@@ -24,9 +24,27 @@
 
 #include <libdivecomputer/buffer.h>
 
+// The size of the inline storage. Buffers up to this size don't
+// require a second heap allocation, which covers the typical packet
+// sized buffers on the download path.
+#define INLINESIZE 64
+
 struct dc_buffer_t {
 	unsigned char *data;
 	size_t capacity, offset, size;
+	/*
+	 * View support. A view shares the allocation of its parent buffer,
+	 * holds a reference on the parent, and is detached with a copy as
+	 * soon as it is modified. The destruction of a parent with
+	 * outstanding views is deferred until the last view is released.
+	 */
+	dc_buffer_t *parent;
+	size_t refcount;
+	int shared;
+	int dead;
+	dc_buffer_growth_t growth;
+	size_t chunksize;
+	unsigned char storage[INLINESIZE];
 };
 
 dc_buffer_t *
@@ -36,31 +54,86 @@ dc_buffer_new (size_t capacity)
 	if (buffer == NULL)
 		return NULL;
 
-	if (capacity) {
+	if (capacity > sizeof (buffer->storage)) {
 		buffer->data = (unsigned char *) malloc (capacity);
 		if (buffer->data == NULL) {
 			free (buffer);
 			return NULL;
 		}
 	} else {
-		buffer->data = NULL;
+		buffer->data = buffer->storage;
+		capacity = sizeof (buffer->storage);
 	}
 
 	buffer->capacity = capacity;
 	buffer->offset = 0;
 	buffer->size = 0;
+	buffer->parent = NULL;
+	buffer->refcount = 0;
+	buffer->shared = 0;
+	buffer->dead = 0;
+	buffer->growth = DC_BUFFER_GROWTH_DOUBLE;
+	buffer->chunksize = 0;
 
 	return buffer;
 }
 
 
+dc_buffer_t *
+dc_buffer_view (dc_buffer_t *buffer, size_t offset, size_t size)
+{
+	if (buffer == NULL)
+		return NULL;
+
+	// Checked in this order to avoid overflowing the addition.
+	if (size > buffer->size || offset > buffer->size - size)
+		return NULL;
+
+	// A view of a view references the root buffer directly, so the
+	// chains stay flat.
+	dc_buffer_t *parent = buffer->parent ? buffer->parent : buffer;
+
+	dc_buffer_t *view = (dc_buffer_t *) malloc (sizeof (dc_buffer_t));
+	if (view == NULL)
+		return NULL;
+
+	view->data = buffer->data + buffer->offset + offset;
+	view->capacity = size;
+	view->offset = 0;
+	view->size = size;
+	view->parent = parent;
+	view->refcount = 0;
+	view->shared = 1;
+	view->dead = 0;
+	view->growth = buffer->growth;
+	view->chunksize = buffer->chunksize;
+
+	parent->refcount++;
+
+	return view;
+}
+
+
 void
 dc_buffer_free (dc_buffer_t *buffer)
 {
 	if (buffer == NULL)
 		return;
 
-	if (buffer->data)
+	// Defer the destruction until the last view is released.
+	if (buffer->refcount) {
+		buffer->dead = 1;
+		return;
+	}
+
+	if (buffer->parent) {
+		dc_buffer_t *parent = buffer->parent;
+		parent->refcount--;
+		if (parent->refcount == 0 && parent->dead)
+			dc_buffer_free (parent);
+	}
+
+	if (!buffer->shared && buffer->data != buffer->storage)
 		free (buffer->data);
 
 	free (buffer);
@@ -83,6 +156,12 @@ dc_buffer_clear (dc_buffer_t *buffer)
 static size_t
 dc_buffer_expand_calc (dc_buffer_t *buffer, size_t n)
 {
+	if (buffer->growth == DC_BUFFER_GROWTH_EXACT)
+		return n;
+
+	if (buffer->growth == DC_BUFFER_GROWTH_CHUNKED)
+		return ((n + buffer->chunksize - 1) / buffer->chunksize) * buffer->chunksize;
+
 	size_t oldsize = buffer->capacity;
 	size_t newsize = (oldsize ? oldsize : n);
 	while (newsize < n)
@@ -95,8 +174,14 @@ dc_buffer_expand_calc (dc_buffer_t *buffer, size_t n)
 static int
 dc_buffer_expand_append (dc_buffer_t *buffer, size_t n)
 {
-	if (n > buffer->capacity - buffer->offset) {
-		if (n > buffer->capacity) {
+	if ((buffer->shared && n > buffer->size) ||
+		n > buffer->capacity - buffer->offset) {
+		// Moving or reallocating the data would invalidate the
+		// outstanding views.
+		if (buffer->refcount)
+			return 0;
+
+		if (buffer->shared || n > buffer->capacity) {
 			size_t capacity = dc_buffer_expand_calc (buffer, n);
 
 			unsigned char *data = (unsigned char *) malloc (capacity);
@@ -106,11 +191,13 @@ dc_buffer_expand_append (dc_buffer_t *buffer, size_t n)
 			if (buffer->size)
 				memcpy (data, buffer->data + buffer->offset, buffer->size);
 
-			free (buffer->data);
+			if (!buffer->shared && buffer->data != buffer->storage)
+				free (buffer->data);
 
 			buffer->data = data;
 			buffer->capacity = capacity;
 			buffer->offset = 0;
+			buffer->shared = 0;
 		} else {
 			if (buffer->size)
 				memmove (buffer->data, buffer->data + buffer->offset, buffer->size);
@@ -128,8 +215,14 @@ dc_buffer_expand_prepend (dc_buffer_t *buffer, size_t n)
 {
 	size_t available = buffer->capacity - buffer->size;
 
-	if (n > buffer->offset + buffer->size) {
-		if (n > buffer->capacity) {
+	if ((buffer->shared && n > buffer->size) ||
+		n > buffer->offset + buffer->size) {
+		// Moving or reallocating the data would invalidate the
+		// outstanding views.
+		if (buffer->refcount)
+			return 0;
+
+		if (buffer->shared || n > buffer->capacity) {
 			size_t capacity = dc_buffer_expand_calc (buffer, n);
 
 			unsigned char *data = (unsigned char *) malloc (capacity);
@@ -139,11 +232,13 @@ dc_buffer_expand_prepend (dc_buffer_t *buffer, size_t n)
 			if (buffer->size)
 				memcpy (data + capacity - buffer->size, buffer->data + buffer->offset, buffer->size);
 
-			free (buffer->data);
+			if (!buffer->shared && buffer->data != buffer->storage)
+				free (buffer->data);
 
 			buffer->data = data;
 			buffer->capacity = capacity;
 			buffer->offset = capacity - buffer->size;
+			buffer->shared = 0;
 		} else {
 			if (buffer->size)
 				memmove (buffer->data + available, buffer->data + buffer->offset, buffer->size);
@@ -156,6 +251,28 @@ dc_buffer_expand_prepend (dc_buffer_t *buffer, size_t n)
 }
 
 
+int
+dc_buffer_set_growth (dc_buffer_t *buffer, dc_buffer_growth_t growth, size_t chunksize)
+{
+	if (buffer == NULL)
+		return 0;
+
+	if (growth != DC_BUFFER_GROWTH_DOUBLE &&
+		growth != DC_BUFFER_GROWTH_EXACT &&
+		growth != DC_BUFFER_GROWTH_CHUNKED)
+		return 0;
+
+	// The chunked policy needs a non-zero chunk size.
+	if (growth == DC_BUFFER_GROWTH_CHUNKED && chunksize == 0)
+		return 0;
+
+	buffer->growth = growth;
+	buffer->chunksize = chunksize;
+
+	return 1;
+}
+
+
 int
 dc_buffer_reserve (dc_buffer_t *buffer, size_t capacity)
 {
@@ -165,10 +282,30 @@ dc_buffer_reserve (dc_buffer_t *buffer, size_t capacity)
 	if (capacity <= buffer->capacity)
 		return 1;
 
-	unsigned char *data = (unsigned char *) realloc (buffer->data, capacity);
-	if (data == NULL)
+	// Reallocating the data would invalidate the outstanding views.
+	if (buffer->refcount)
 		return 0;
 
+	unsigned char *data = NULL;
+	if (buffer->shared) {
+		data = (unsigned char *) malloc (capacity);
+		if (data == NULL)
+			return 0;
+		if (buffer->size)
+			memcpy (data, buffer->data + buffer->offset, buffer->size);
+		buffer->offset = 0;
+		buffer->shared = 0;
+	} else if (buffer->data == buffer->storage) {
+		data = (unsigned char *) malloc (capacity);
+		if (data == NULL)
+			return 0;
+		memcpy (data, buffer->storage, buffer->capacity);
+	} else {
+		data = (unsigned char *) realloc (buffer->data, capacity);
+		if (data == NULL)
+			return 0;
+	}
+
 	buffer->data = data;
 	buffer->capacity = capacity;
 
@@ -194,6 +331,23 @@ dc_buffer_resize (dc_buffer_t *buffer, size_t size)
 }
 
 
+int
+dc_buffer_extend (dc_buffer_t *buffer, size_t size)
+{
+	if (buffer == NULL)
+		return 0;
+
+	if (!dc_buffer_expand_append (buffer, size))
+		return 0;
+
+	// Unlike dc_buffer_resize, a grown region is left uninitialized,
+	// because the caller is expected to overwrite it anyway.
+	buffer->size = size;
+
+	return 1;
+}
+
+
 int
 dc_buffer_append (dc_buffer_t *buffer, const unsigned char data[], size_t size)
 {
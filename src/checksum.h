@@ -41,6 +41,60 @@ checksum_xor_uint8 (const unsigned char data[], unsigned int size, unsigned char
 unsigned short
 checksum_crc_ccitt_uint16 (const unsigned char data[], unsigned int size);
 
+/*
+ * Incremental interface for the CRC-CCITT checksum. Initialize the
+ * running value with checksum_crc_ccitt_uint16_init, and update it
+ * with each chunk of data as it arrives. The running value is the
+ * checksum; no finalization step is required. This allows device code
+ * to fold the verification into the receive loop, while the data is
+ * still in the cache.
+ * The additive and xor checksums are already incremental through
+ * their init parameter.
+ */
+
+/*
+ * Generate the CRC lookup tables ahead of the first checksum, so the
+ * one-time cost is not paid inside a download. Called from
+ * dc_context_warmup; using the checksums without it is fine, the
+ * tables are also generated on first use.
+ */
+void
+checksum_warmup (void);
+
+unsigned short
+checksum_crc_ccitt_uint16_init (void);
+
+unsigned short
+checksum_crc_ccitt_uint16_update (unsigned short crc, const unsigned char data[], unsigned int size);
+
+/*
+ * Incremental 64 bit hash (the XXH64 algorithm), for identifying and
+ * deduplicating downloaded data. Unlike the protocol checksums above,
+ * the hash is not dictated by any device protocol, so it can use a
+ * modern construction that processes the data at close to memory
+ * bandwidth. Initialize the state with checksum_hash64_init, feed the
+ * data in arbitrarily sized chunks with checksum_hash64_update, and
+ * obtain the digest with checksum_hash64_final. The update function
+ * can be called from a receive loop, while the data is still in the
+ * cache.
+ */
+
+typedef struct checksum_hash64_t {
+	unsigned long long v[4];
+	unsigned long long total;
+	unsigned char mem[32];
+	unsigned int memsize;
+} checksum_hash64_t;
+
+void
+checksum_hash64_init (checksum_hash64_t *state);
+
+void
+checksum_hash64_update (checksum_hash64_t *state, const unsigned char data[], unsigned int size);
+
+unsigned long long
+checksum_hash64_final (const checksum_hash64_t *state);
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
@@ -44,7 +44,7 @@ static dc_status_t citizen_aqualand_device_dump (dc_device_t *abstract, dc_buffe
 static dc_status_t citizen_aqualand_device_foreach (dc_device_t *abstract, dc_dive_callback_t callback, void *userdata);
 static dc_status_t citizen_aqualand_device_close (dc_device_t *abstract);
 
-static const dc_device_vtable_t citizen_aqualand_device_vtable = {
+DC_VTABLE_STORAGE const dc_device_vtable_t citizen_aqualand_device_vtable = {
 	sizeof(citizen_aqualand_device_t),
 	DC_FAMILY_CITIZEN_AQUALAND,
 	citizen_aqualand_device_set_fingerprint, /* set_fingerprint */
@@ -83,6 +83,9 @@ citizen_aqualand_device_open (dc_device_t **out, dc_context_t *context, const ch
 		goto error_free;
 	}
 
+	// Forward cancellation requests to the serial layer.
+	dc_serial_set_cancel (device->port, device_cancel_cb, device);
+
 	// Set the serial communication protocol (4800 8N1).
 	status = dc_serial_configure (device->port, 4800, 8, DC_PARITY_NONE, DC_STOPBITS_ONE, DC_FLOWCONTROL_NONE);
 	if (status != DC_STATUS_SUCCESS) {
@@ -154,13 +157,17 @@ citizen_aqualand_device_dump (dc_device_t *abstract, dc_buffer_t *buffer)
 
 	// Erase the current contents of the buffer and
 	// pre-allocate the required amount of memory.
-	if (!dc_buffer_clear (buffer)) {
+	if (!dc_buffer_clear (buffer) || !dc_buffer_reserve (buffer, 4096)) {
 		ERROR (abstract->context, "Insufficient buffer space available.");
 		return DC_STATUS_NOMEMORY;
 	}
 
 	dc_serial_set_dtr (device->port, 1);
 
+	// The first packet includes the wakeup time of the device, so it
+	// gets the full timeout.
+	dc_serial_set_timeout (device->port, 1000);
+
 	// Send the init byte.
 	const unsigned char init[] = {0x7F};
 	status = dc_serial_write (device->port, init, sizeof (init), NULL);
@@ -179,6 +186,7 @@ citizen_aqualand_device_dump (dc_device_t *abstract, dc_buffer_t *buffer)
 		return status;
 	}
 
+	unsigned int first = 1;
 	while (1) {
 		// Receive the response packet.
 		unsigned char answer[32] = {0};
@@ -188,17 +196,36 @@ citizen_aqualand_device_dump (dc_device_t *abstract, dc_buffer_t *buffer)
 			return status;
 		}
 
-		dc_buffer_append(buffer, answer, sizeof (answer));
+		// The last packet is marked in its final byte. Check before
+		// requesting the next packet, so the download doesn't leave a
+		// stray command behind and doesn't wait for a packet that will
+		// never arrive.
+		unsigned int last = answer[sizeof(answer) - 1] == 0xFF;
+
+		if (!last) {
+			// Request the next packet before processing the current
+			// one, so the device transmits while the host appends.
+			status = dc_serial_write (device->port, command, sizeof (command), NULL);
+			if (status != DC_STATUS_SUCCESS) {
+				ERROR (abstract->context, "Failed to send the command.");
+				return status;
+			}
+		}
 
-		// Send the command.
-		status = dc_serial_write (device->port, command, sizeof (command), NULL);
-		if (status != DC_STATUS_SUCCESS) {
-			ERROR (abstract->context, "Failed to send the command.");
-			return status;
+		if (!dc_buffer_append(buffer, answer, sizeof (answer))) {
+			ERROR (abstract->context, "Insufficient buffer space available.");
+			return DC_STATUS_NOMEMORY;
 		}
 
-		if (answer[sizeof(answer) - 1] == 0xFF)
+		if (last)
 			break;
+
+		if (first) {
+			// Once streaming, the packets arrive back to back, so a
+			// shorter timeout detects a stalled download quickly.
+			dc_serial_set_timeout (device->port, 500);
+			first = 0;
+		}
 	}
 
 	dc_serial_set_dtr (device->port, 0);
@@ -224,6 +251,9 @@ citizen_aqualand_device_foreach (dc_device_t *abstract, dc_dive_callback_t callb
 	unsigned char *data = dc_buffer_get_data (buffer);
 	unsigned int   size = dc_buffer_get_size (buffer);
 
+	// The watch transmits a single dive (the most recent one) per
+	// session, so the dump is the dive: it is delivered as-is, without
+	// scanning for dive boundaries.
 	if (callback && memcmp (data + 0x05, device->fingerprint, sizeof (device->fingerprint)) != 0) {
 		callback (data, size, data + 0x05, sizeof (device->fingerprint), userdata);
 	}
@@ -41,7 +41,7 @@ static dc_status_t citizen_aqualand_parser_get_datetime (dc_parser_t *abstract,
 static dc_status_t citizen_aqualand_parser_get_field (dc_parser_t *abstract, dc_field_type_t type, unsigned int flags, void *value);
 static dc_status_t citizen_aqualand_parser_samples_foreach (dc_parser_t *abstract, dc_sample_callback_t callback, void *userdata);
 
-static const dc_parser_vtable_t citizen_aqualand_parser_vtable = {
+DC_VTABLE_STORAGE const dc_parser_vtable_t citizen_aqualand_parser_vtable = {
 	sizeof(citizen_aqualand_parser_t),
 	DC_FAMILY_CITIZEN_AQUALAND,
 	citizen_aqualand_parser_set_data, /* set_data */
@@ -242,7 +242,7 @@ citizen_aqualand_parser_samples_foreach (dc_parser_t *abstract, dc_sample_callba
 
 		// Depth
 		if (metric)
-			sample.depth = depth / 10.0;
+			sample.depth = array_scale (depth, 1, 10);
 		else
 			sample.depth = depth * FEET;
 		if (callback) callback (DC_SAMPLE_DEPTH, sample, userdata);
@@ -253,9 +253,9 @@ citizen_aqualand_parser_samples_foreach (dc_parser_t *abstract, dc_sample_callba
 			if (idx < nsamples) {
 				unsigned int temperature = samples[idx];
 				if (metric)
-					sample.temperature = temperature / 10.0;
+					sample.temperature = array_scale (temperature, 1, 10);
 				else
-					sample.temperature = (temperature - 32.0) * (5.0 / 9.0);
+					sample.temperature = FAHRENHEIT_TO_CELSIUS (temperature);
 				if (callback) callback (DC_SAMPLE_TEMPERATURE, sample, userdata);
 			}
 		}
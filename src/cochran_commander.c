@@ -96,10 +96,11 @@ typedef struct cochran_commander_device_t {
 static dc_status_t cochran_commander_device_set_fingerprint (dc_device_t *device, const unsigned char data[], unsigned int size);
 static dc_status_t cochran_commander_device_read (dc_device_t *device, unsigned int address, unsigned char data[], unsigned int size);
 static dc_status_t cochran_commander_device_dump (dc_device_t *device, dc_buffer_t *data);
+static dc_status_t cochran_commander_device_dump_stream (dc_device_t *device, dc_dump_callback_t callback, void *userdata);
 static dc_status_t cochran_commander_device_foreach (dc_device_t *device, dc_dive_callback_t callback, void *userdata);
 static dc_status_t cochran_commander_device_close (dc_device_t *device);
 
-static const dc_device_vtable_t cochran_commander_device_vtable = {
+DC_VTABLE_STORAGE const dc_device_vtable_t cochran_commander_device_vtable = {
 	sizeof (cochran_commander_device_t),
 	DC_FAMILY_COCHRAN_COMMANDER,
 	cochran_commander_device_set_fingerprint,/* set_fingerprint */
@@ -107,7 +108,11 @@ static const dc_device_vtable_t cochran_commander_device_vtable = {
 	NULL, /* write */
 	cochran_commander_device_dump, /* dump */
 	cochran_commander_device_foreach, /* foreach */
-	cochran_commander_device_close /* close */
+	cochran_commander_device_close, /* close */
+	NULL, /* foreach_buffer */
+	NULL, /* dump_delta */
+	NULL, /* read_multiple */
+	cochran_commander_device_dump_stream /* dump_stream */
 };
 
 // Cochran Commander Nitrox
@@ -325,6 +330,73 @@ cochran_commander_packet (cochran_commander_device_t *device, dc_event_progress_
 }
 
 
+// Variant of cochran_commander_packet that hands the answer to a
+// callback in packet sized chunks, instead of assembling it in one
+// buffer, so the resident size stays bounded by the packet size.
+static dc_status_t
+cochran_commander_packet_stream (cochran_commander_device_t *device, dc_event_progress_t *progress,
+	const unsigned char command[], unsigned int csize,
+	unsigned int asize, dc_dump_callback_t callback, void *userdata)
+{
+	dc_device_t *abstract = (dc_device_t *) device;
+	dc_status_t status = DC_STATUS_SUCCESS;
+	unsigned char packet[1024];
+
+	if (device_is_cancelled (abstract))
+		return DC_STATUS_CANCELLED;
+
+	// Send the command to the device, one byte at a time
+	// If sent all at once the command is ignored. It's like the DC
+	// has no buffering.
+	for (unsigned int i = 0; i < csize; i++) {
+		// Give the DC time to read the character.
+		if (i) dc_serial_sleep(device->port, 16); // 16 ms
+
+		status = dc_serial_write(device->port, command + i, 1, NULL);
+		if (status != DC_STATUS_SUCCESS) {
+			ERROR (abstract->context, "Failed to send the command.");
+			return status;
+		}
+	}
+
+	// Give the DC time to process the command.
+	dc_serial_sleep(device->port, 45);
+
+	// Rates are odd, like 806400 for the EMC, 115200 for commander
+	status = dc_serial_configure(device->port, device->layout->baudrate, 8, DC_PARITY_NONE, DC_STOPBITS_TWO, DC_FLOWCONTROL_NONE);
+	if (status != DC_STATUS_SUCCESS) {
+		ERROR (abstract->context, "Failed to set the high baud rate.");
+		return status;
+	}
+
+	// Receive the answer from the device, and deliver each packet.
+	unsigned int nbytes = 0;
+	while (nbytes < asize) {
+		unsigned int len = asize - nbytes;
+		if (len > sizeof(packet))
+			len = sizeof(packet);
+
+		status = dc_serial_read (device->port, packet, len, NULL);
+		if (status != DC_STATUS_SUCCESS) {
+			ERROR (abstract->context, "Failed to receive data.");
+			return status;
+		}
+
+		nbytes += len;
+
+		if (progress) {
+			progress->current += len;
+			device_event_emit (abstract, DC_EVENT_PROGRESS, progress);
+		}
+
+		if (!callback (packet, len, userdata))
+			return DC_STATUS_CANCELLED;
+	}
+
+	return DC_STATUS_SUCCESS;
+}
+
+
 static dc_status_t
 cochran_commander_read_id (cochran_commander_device_t *device, unsigned char id[], unsigned int size)
 {
@@ -376,14 +448,8 @@ cochran_commander_read_config (cochran_commander_device_t *device, dc_event_prog
 
 
 static dc_status_t
-cochran_commander_read (cochran_commander_device_t *device, dc_event_progress_t *progress, unsigned int address, unsigned char data[], unsigned int size)
+cochran_commander_read_command (cochran_commander_device_t *device, unsigned int address, unsigned int size, unsigned char command[], unsigned int *csize)
 {
-	dc_status_t rc = DC_STATUS_SUCCESS;
-
-	// Build the command
-	unsigned char command[10];
-	unsigned char command_size;
-
 	switch (device->layout->address_bits) {
 	case 32:
 		// EMC uses 32 bit addressing
@@ -397,7 +463,7 @@ cochran_commander_read (cochran_commander_device_t *device, dc_event_progress_t
 		command[7] = (size >> 16   ) & 0xff;
 		command[8] = (size >> 24   ) & 0xff;
 		command[9] = 0x05;
-		command_size = 10;
+		*csize = 10;
 		break;
 	case 24:
 		// Commander uses 24 byte addressing
@@ -409,12 +475,28 @@ cochran_commander_read (cochran_commander_device_t *device, dc_event_progress_t
 		command[5] = (size >>  8   ) & 0xff;
 		command[6] = (size >> 16   ) & 0xff;
 		command[7] = 0x04;
-		command_size = 8;
+		*csize = 8;
 		break;
 	default:
 		return DC_STATUS_UNSUPPORTED;
 	}
 
+	return DC_STATUS_SUCCESS;
+}
+
+static dc_status_t
+cochran_commander_read (cochran_commander_device_t *device, dc_event_progress_t *progress, unsigned int address, unsigned char data[], unsigned int size)
+{
+	dc_status_t rc = DC_STATUS_SUCCESS;
+
+	// Build the command
+	unsigned char command[10];
+	unsigned int command_size = 0;
+
+	rc = cochran_commander_read_command (device, address, size, command, &command_size);
+	if (rc != DC_STATUS_SUCCESS)
+		return rc;
+
 	dc_serial_sleep(device->port, 800);
 
 	// set back to 9600 baud
@@ -634,6 +716,9 @@ cochran_commander_device_open (dc_device_t **out, dc_context_t *context, const c
 		goto error_free;
 	}
 
+	// Forward cancellation requests to the serial layer.
+	dc_serial_set_cancel (device->port, device_cancel_cb, device);
+
 	status = cochran_commander_serial_setup(device);
 	if (status != DC_STATUS_SUCCESS) {
 		goto error_close;
@@ -764,6 +849,55 @@ cochran_commander_device_dump (dc_device_t *abstract, dc_buffer_t *buffer)
 }
 
 
+static dc_status_t
+cochran_commander_device_dump_stream (dc_device_t *abstract, dc_dump_callback_t callback, void *userdata)
+{
+	cochran_commander_device_t *device = (cochran_commander_device_t *) abstract;
+	dc_status_t rc = DC_STATUS_SUCCESS;
+	unsigned char config[1024];
+
+	// Determine size for progress
+	dc_event_progress_t progress = EVENT_PROGRESS_INITIALIZER;
+	progress.maximum = sizeof(config) + device->layout->rb_profile_end;
+	device_event_emit (abstract, DC_EVENT_PROGRESS, &progress);
+
+	// Emit ID block
+	dc_event_vendor_t vendor;
+	vendor.data = device->id;
+	vendor.size = sizeof (device->id);
+	device_event_emit (abstract, DC_EVENT_VENDOR, &vendor);
+
+	rc = cochran_commander_read_config (device, &progress, config, sizeof(config));
+	if (rc != DC_STATUS_SUCCESS)
+		return rc;
+
+	// Build the command to read the entire sample memory, and stream
+	// the answer to the callback, packet by packet, without assembling
+	// the memory image in one buffer.
+	unsigned char command[10];
+	unsigned int command_size = 0;
+	rc = cochran_commander_read_command (device, 0, device->layout->rb_profile_end, command, &command_size);
+	if (rc != DC_STATUS_SUCCESS)
+		return rc;
+
+	dc_serial_sleep(device->port, 800);
+
+	// set back to 9600 baud
+	rc = cochran_commander_serial_setup(device);
+	if (rc != DC_STATUS_SUCCESS)
+		return rc;
+
+	rc = cochran_commander_packet_stream (device, &progress, command, command_size,
+		device->layout->rb_profile_end, callback, userdata);
+	if (rc != DC_STATUS_SUCCESS) {
+		ERROR (abstract->context, "Failed to read the sample data.");
+		return rc;
+	}
+
+	return DC_STATUS_SUCCESS;
+}
+
+
 static dc_status_t
 cochran_commander_device_foreach (dc_device_t *abstract, dc_dive_callback_t callback, void *userdata)
 {
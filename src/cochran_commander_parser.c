@@ -20,6 +20,7 @@
  */
 
 #include <stdlib.h>
+#include <string.h> // memset
 #include <math.h>
 
 #include <libdivecomputer/units.h>
@@ -78,12 +79,23 @@ typedef struct event_size_t {
 	unsigned int size;
 } event_size_t;
 
+// Precomputed dispatch entry for one event code (0x80..0xFF), built at
+// parser creation. Indexing this table replaces the linear search over
+// the event list in the sample loop, which runs once per event byte.
+typedef struct cochran_event_entry_t {
+	unsigned char known;
+	unsigned char size; // Total size in bytes.
+	unsigned char type; // parser_sample_event_t
+	unsigned char flag; // parser_sample_flags_t
+} cochran_event_entry_t;
+
 typedef struct cochran_commander_parser_t {
 	dc_parser_t base;
 	unsigned int model;
 	const cochran_parser_layout_t *layout;
 	const event_size_t *events;
 	unsigned int nevents;
+	cochran_event_entry_t event_table[128];
 } cochran_commander_parser_t ;
 
 static dc_status_t cochran_commander_parser_set_data (dc_parser_t *parser, const unsigned char *data, unsigned int size);
@@ -91,7 +103,7 @@ static dc_status_t cochran_commander_parser_get_datetime (dc_parser_t *parser, d
 static dc_status_t cochran_commander_parser_get_field (dc_parser_t *parser, dc_field_type_t type, unsigned int flags, void *value);
 static dc_status_t cochran_commander_parser_samples_foreach (dc_parser_t *parser, dc_sample_callback_t callback, void *userdata);
 
-static const dc_parser_vtable_t cochran_commander_parser_vtable = {
+DC_VTABLE_STORAGE const dc_parser_vtable_t cochran_commander_parser_vtable = {
 	sizeof(cochran_commander_parser_t),
 	DC_FAMILY_COCHRAN_COMMANDER,
 	cochran_commander_parser_set_data, /* set_data */
@@ -199,15 +211,9 @@ cochran_commander_handle_event (cochran_commander_parser_t *parser, unsigned cha
 {
 	dc_parser_t *abstract = (dc_parser_t *) parser;
 
-	const cochran_events_t *event = NULL;
-	for (unsigned int i = 0; i < C_ARRAY_SIZE(cochran_events); ++i) {
-		if (cochran_events[i].code == code) {
-			event = cochran_events + i;
-			break;
-		}
-	}
+	const cochran_event_entry_t *event = parser->event_table + (code - 0x80);
 
-	if (event == NULL) {
+	if (!event->known) {
 		// Unknown event, send warning so we know we missed something
 		WARNING(abstract->context, "Unknown event 0x%02x", code);
 		return 1;
@@ -245,7 +251,7 @@ cochran_commander_handle_event (cochran_commander_parser_t *parser, unsigned cha
 		}
 	}
 
-	return event->data_bytes;
+	return event->size;
 }
 
 
@@ -313,6 +319,16 @@ cochran_commander_parser_create (dc_parser_t **out, dc_context_t *context, unsig
 		goto error_free;
 	}
 
+	// Compile the event list into the dispatch table.
+	memset (parser->event_table, 0, sizeof (parser->event_table));
+	for (unsigned int i = 0; i < C_ARRAY_SIZE(cochran_events); ++i) {
+		cochran_event_entry_t *entry = parser->event_table + (cochran_events[i].code - 0x80);
+		entry->known = 1;
+		entry->size = cochran_events[i].data_bytes;
+		entry->type = cochran_events[i].type;
+		entry->flag = cochran_events[i].flag;
+	}
+
 	*out = (dc_parser_t *) parser;
 
 	return DC_STATUS_SUCCESS;
@@ -370,17 +386,17 @@ cochran_commander_parser_get_field (dc_parser_t *abstract, dc_field_type_t type,
 	if (value) {
 		switch (type) {
 		case DC_FIELD_TEMPERATURE_SURFACE:
-			*((unsigned int*) value) = (data[layout->start_temp] - 32.0) / 1.8;
+			*((unsigned int*) value) = FAHRENHEIT_TO_CELSIUS (data[layout->start_temp]);
 			break;
 		case DC_FIELD_TEMPERATURE_MINIMUM:
 			if (data[layout->min_temp] == 0xFF)
 				return DC_STATUS_UNSUPPORTED;
-			*((unsigned int*) value) = (data[layout->min_temp] / 2.0 + 20 - 32) / 1.8;
+			*((unsigned int*) value) = FAHRENHEIT_TO_CELSIUS (data[layout->min_temp] / 2.0 + 20);
 			break;
 		case DC_FIELD_TEMPERATURE_MAXIMUM:
 			if (data[layout->max_temp] == 0xFF)
 				return DC_STATUS_UNSUPPORTED;
-			*((unsigned int*) value) = (data[layout->max_temp] / 2.0 + 20 - 32) / 1.8;
+			*((unsigned int*) value) = FAHRENHEIT_TO_CELSIUS (data[layout->max_temp] / 2.0 + 20);
 			break;
 		case DC_FIELD_DIVETIME:
 			minutes = array_uint16_le(data + layout->divetime);
@@ -498,12 +514,16 @@ cochran_commander_parser_samples_foreach (dc_parser_t *abstract, dc_sample_callb
 	sample.depth = start_depth * FEET;
 	if (callback) callback (DC_SAMPLE_DEPTH, sample, userdata);
 
-	sample.temperature = (data[layout->start_temp] - 32.0) / 1.8;
+	sample.temperature = FAHRENHEIT_TO_CELSIUS (data[layout->start_temp]);
 	if (callback) callback (DC_SAMPLE_TEMPERATURE, sample, userdata);
 
 	sample.gasmix = 0;
 	if (callback) callback(DC_SAMPLE_GASMIX, sample, userdata);
 
+	// Hoist the per-model configuration out of the loop.
+	const unsigned int samplesize = layout->samplesize;
+	const unsigned int emc = layout->format == SAMPLE_EMC;
+
 	while (offset < size) {
 		const unsigned char *s = samples + offset;
 
@@ -514,30 +534,31 @@ cochran_commander_parser_samples_foreach (dc_parser_t *abstract, dc_sample_callb
 			if (callback) callback (DC_SAMPLE_TIME, sample, userdata);
 		}
 
-		// If corrupt_dive end before offset
-		if (corrupt_dive) {
-			// When we aren't sure where the sample data ends we can
-			// look for events that shouldn't be in the sample data.
-			// 0xFF is unwritten memory
-			// 0xA8 indicates start of post-dive interval
-			// 0xE3 (switch to FO2 mode) and 0xF3 (switch to blend 1) occur
-			// at dive start so when we see them after the first second we
-			// found the beginning of the next dive.
-			if (s[0] == 0xFF || s[0] == 0xA8) {
-				DEBUG(abstract->context, "Used corrupt dive breakout 1 on event %02x", s[0]);
-				break;
-			}
-			if (time > 1 && (s[0] == 0xE3 || s[0] == 0xF3)) {
-				DEBUG(abstract->context, "Used corrupt dive breakout 2 on event %02x", s[0]);
-				break;
+		// Check for event. The corrupt dive markers below all have the
+		// high bit set too, so plain samples never need those checks.
+		if (s[0] & 0x80) {
+			// If corrupt_dive end before offset
+			if (corrupt_dive) {
+				// When we aren't sure where the sample data ends we can
+				// look for events that shouldn't be in the sample data.
+				// 0xFF is unwritten memory
+				// 0xA8 indicates start of post-dive interval
+				// 0xE3 (switch to FO2 mode) and 0xF3 (switch to blend 1) occur
+				// at dive start so when we see them after the first second we
+				// found the beginning of the next dive.
+				if (s[0] == 0xFF || s[0] == 0xA8) {
+					DEBUG(abstract->context, "Used corrupt dive breakout 1 on event %02x", s[0]);
+					break;
+				}
+				if (time > 1 && (s[0] == 0xE3 || s[0] == 0xF3)) {
+					DEBUG(abstract->context, "Used corrupt dive breakout 2 on event %02x", s[0]);
+					break;
+				}
 			}
-		}
 
-		// Check for event
-		if (s[0] & 0x80) {
 			offset += cochran_commander_handle_event(parser, s[0], callback, userdata);
 
-			if (layout->format == SAMPLE_EMC) {
+			if (emc) {
 				// EMC models have events indicating change in deco status
 				// Commander may have them but I don't have example data
 				switch (s[0]) {
@@ -582,72 +603,88 @@ cochran_commander_parser_samples_foreach (dc_parser_t *abstract, dc_sample_callb
 		}
 
 		// Make sure we have a full sample
-		if (offset + layout->samplesize > size)
+		if (offset + samplesize > size)
 			break;
 
-		// Depth is logged as change in feet, bit 0x40 means negative depth
-		if (s[0] & 0x40)
-			depth -= (s[0] & 0x3f);
-		else
-			depth += (s[0] & 0x3f);
-
-		sample.depth = (start_depth + depth / 4.0) * FEET;
-		if (callback) callback (DC_SAMPLE_DEPTH, sample, userdata);
-
-		// Ascent rate is logged in the 0th sample, temp in the 1st, repeat.
-		if (time % 2 == 0) {
-			// Ascent rate
-			double ascent_rate = 0.0;
-			if (s[1] & 0x80)
-				ascent_rate = (s[1] & 0x7f);
+		// Process the whole run of plain samples up to the next event
+		// byte in one go, without re-entering the event dispatch.
+		while (1) {
+			// Depth is logged as change in feet, bit 0x40 means negative depth
+			if (s[0] & 0x40)
+				depth -= (s[0] & 0x3f);
 			else
-				ascent_rate = -(s[1] & 0x7f);
-			ascent_rate *= FEET / 4.0;
-		} else {
-			// Temperature logged in half degrees F above 20
-			double temperature = s[1] / 2.0 + 20.0;
-			sample.temperature = (temperature - 32.0) / 1.8;
-
-			if (callback) callback (DC_SAMPLE_TEMPERATURE, sample, userdata);
-		}
+				depth += (s[0] & 0x3f);
+
+			sample.depth = (start_depth + array_scale (depth, 1, 4)) * FEET;
+			if (callback) callback (DC_SAMPLE_DEPTH, sample, userdata);
+
+			// Ascent rate is logged in the 0th sample, temp in the 1st, repeat.
+			if (time % 2 == 0) {
+				// Ascent rate
+				double ascent_rate = 0.0;
+				if (s[1] & 0x80)
+					ascent_rate = (s[1] & 0x7f);
+				else
+					ascent_rate = -(s[1] & 0x7f);
+				ascent_rate *= FEET / 4.0;
+			} else {
+				// Temperature logged in half degrees F above 20
+				double temperature = s[1] / 2.0 + 20.0;
+				sample.temperature = FAHRENHEIT_TO_CELSIUS (temperature);
 
-		// Cochran EMC models store NDL and deco stop time
-		// in the 20th to 23rd sample
-		if (layout->format == SAMPLE_EMC) {
-			// Tissue load is recorded across 20 samples, we ignore them
-			// NDL and deco stop time is recorded across the next 4 samples
-			// The first 2 are either NDL or stop time at deepest stop (if in deco)
-			// The next 2 are total deco stop time.
-			unsigned int deco_time = 0;
-			switch (time % 24) {
-			case 21:
-				deco_time = last_sample[2] + s[2] * 256 + 1;
-				if (deco_obligation) {
-					/* Deco time for deepest stop, unused */
-				} else {
-					/* Send deco NDL sample */
-					sample.deco.type = DC_DECO_NDL;
-					sample.deco.time = deco_time * 60;
-					sample.deco.depth = 0;
-					if (callback) callback (DC_SAMPLE_DECO, sample, userdata);
-				}
-				break;
-			case 23:
-				/* Deco time, total obligation */
-				deco_time = last_sample[2] + s[2] * 256 + 1;
-				if (deco_obligation) {
-					sample.deco.type = DC_DECO_DECOSTOP;
-					sample.deco.depth = deco_ceiling * FEET;
-					sample.deco.time = deco_time * 60;
-					if (callback) callback (DC_SAMPLE_DECO, sample, userdata);
+				if (callback) callback (DC_SAMPLE_TEMPERATURE, sample, userdata);
+			}
+
+			// Cochran EMC models store NDL and deco stop time
+			// in the 20th to 23rd sample
+			if (emc) {
+				// Tissue load is recorded across 20 samples, we ignore them
+				// NDL and deco stop time is recorded across the next 4 samples
+				// The first 2 are either NDL or stop time at deepest stop (if in deco)
+				// The next 2 are total deco stop time.
+				unsigned int deco_time = 0;
+				switch (time % 24) {
+				case 21:
+					deco_time = last_sample[2] + s[2] * 256 + 1;
+					if (deco_obligation) {
+						/* Deco time for deepest stop, unused */
+					} else {
+						/* Send deco NDL sample */
+						sample.deco.type = DC_DECO_NDL;
+						sample.deco.time = deco_time * 60;
+						sample.deco.depth = 0;
+						if (callback) callback (DC_SAMPLE_DECO, sample, userdata);
+					}
+					break;
+				case 23:
+					/* Deco time, total obligation */
+					deco_time = last_sample[2] + s[2] * 256 + 1;
+					if (deco_obligation) {
+						sample.deco.type = DC_DECO_DECOSTOP;
+						sample.deco.depth = deco_ceiling * FEET;
+						sample.deco.time = deco_time * 60;
+						if (callback) callback (DC_SAMPLE_DECO, sample, userdata);
+					}
+					break;
 				}
-				break;
+				last_sample = s;
 			}
-			last_sample = s;
-		}
 
-		time++;
-		offset += layout->samplesize;
+			time++;
+			offset += samplesize;
+
+			// Continue the run if the next record is another full plain
+			// sample.
+			if (offset + samplesize > size || (samples[offset] & 0x80))
+				break;
+
+			// Time advances once per sample.
+			sample.time = time;
+			last_sample_time = time;
+			if (callback) callback (DC_SAMPLE_TIME, sample, userdata);
+
+			s = samples + offset;
+		}
 	}
 
 	return DC_STATUS_SUCCESS;
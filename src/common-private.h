@@ -28,9 +28,40 @@
 extern "C" {
 #endif /* __cplusplus */
 
+/*
+ * Storage class for the backend vtables. Normally the vtables are
+ * private to their translation unit, and every generic entry point
+ * dispatches through the vtable pointer stored in the object. A build
+ * that links exactly one backend can define DC_STATIC_DISPATCH_DEVICE
+ * and/or DC_STATIC_DISPATCH_PARSER to the name of that backend's
+ * vtable (e.g. uwatec_smart_device_vtable). The vtables then get
+ * external linkage, and the generic entry points resolve the dispatch
+ * at compile time, so the compiler can inline the backend functions
+ * into the transfer loops. Only meaningful when all other backends are
+ * disabled at configure time: with multiple backends linked, every
+ * object would be dispatched to the selected backend.
+ */
+#if defined(DC_STATIC_DISPATCH_DEVICE) || defined(DC_STATIC_DISPATCH_PARSER)
+#define DC_VTABLE_STORAGE
+#else
+#define DC_VTABLE_STORAGE static
+#endif
+
 void
 dc_status_set_error (dc_status_t *status, dc_status_t error);
 
+/*
+ * The current value of a monotonic clock, in nanoseconds. The clock
+ * has no defined epoch, so only differences between two readings are
+ * meaningful, but it is not affected by wall clock adjustments, which
+ * makes it the clock of choice for timeouts and instrumentation. A
+ * reading costs a vDSO call on Linux and a QueryPerformanceCounter
+ * call on Windows, both of which resolve to a TSC read on modern
+ * hardware. Returns zero if no monotonic clock is available.
+ */
+unsigned long long
+dc_common_now_ns (void);
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
@@ -22,6 +22,13 @@
 #include <stdlib.h>
 #include <assert.h>
 
+#ifdef _WIN32
+#define NOGDI
+#include <windows.h>
+#else
+#include <time.h> // clock_gettime
+#endif
+
 #include "common-private.h"
 
 void
@@ -32,3 +39,33 @@ dc_status_set_error (dc_status_t *status, dc_status_t error)
 	if (*status == DC_STATUS_SUCCESS)
 		*status = error;
 }
+
+unsigned long long
+dc_common_now_ns (void)
+{
+#ifdef _WIN32
+	// The frequency is fixed at boot time, so it only needs to be
+	// queried once. The stray initializations from concurrent first
+	// calls all store the same value, and are harmless.
+	static LARGE_INTEGER frequency = {0};
+	if (frequency.QuadPart == 0) {
+		if (!QueryPerformanceFrequency (&frequency))
+			return 0;
+	}
+
+	LARGE_INTEGER now;
+	if (!QueryPerformanceCounter (&now))
+		return 0;
+
+	// Split the conversion to avoid the 64 bit overflow of the naive
+	// multiplication after a few minutes of uptime.
+	return (unsigned long long) (now.QuadPart / frequency.QuadPart) * 1000000000 +
+		(unsigned long long) (now.QuadPart % frequency.QuadPart) * 1000000000 / frequency.QuadPart;
+#else
+	struct timespec ts;
+	if (clock_gettime (CLOCK_MONOTONIC, &ts) != 0)
+		return 0;
+
+	return (unsigned long long) ts.tv_sec * 1000000000 + ts.tv_nsec;
+#endif
+}
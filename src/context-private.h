@@ -28,6 +28,8 @@
 
 #include <libdivecomputer/context.h>
 
+#include "threads.h"
+
 #ifdef __cplusplus
 extern "C" {
 #endif /* __cplusplus */
@@ -46,14 +48,45 @@ extern "C" {
 #define ATTR_FORMAT_PRINTF(a,b)
 #endif
 
+/*
+ * The maximum log level that is compiled in. Calls above this level are
+ * removed at compile time, so their formatting doesn't cost anything on
+ * the hot paths. The numeric values correspond to the dc_loglevel_t
+ * enumeration.
+ */
+#ifndef MAXLOGLEVEL
+#define MAXLOGLEVEL 5
+#endif
+
 #ifdef ENABLE_LOGGING
+#if MAXLOGLEVEL >= 3
 #define HEXDUMP(context, loglevel, prefix, data, size) dc_context_hexdump (context, loglevel, __FILE__, __LINE__, FUNCTION, prefix, data, size)
+#else
+#define HEXDUMP(context, loglevel, prefix, data, size) UNUSED(context)
+#endif
+#if MAXLOGLEVEL >= 1
 #define SYSERROR(context, errcode) dc_context_syserror (context, DC_LOGLEVEL_ERROR, __FILE__, __LINE__, FUNCTION, errcode)
 #define ERROR(context, ...) dc_context_log (context, DC_LOGLEVEL_ERROR, __FILE__, __LINE__, FUNCTION, __VA_ARGS__)
+#else
+#define SYSERROR(context, errcode) UNUSED(context)
+#define ERROR(context, ...) UNUSED(context)
+#endif
+#if MAXLOGLEVEL >= 2
 #define WARNING(context, ...) dc_context_log (context, DC_LOGLEVEL_WARNING, __FILE__, __LINE__, FUNCTION, __VA_ARGS__)
+#else
+#define WARNING(context, ...) UNUSED(context)
+#endif
+#if MAXLOGLEVEL >= 3
 #define INFO(context, ...) dc_context_log (context, DC_LOGLEVEL_INFO, __FILE__, __LINE__, FUNCTION, __VA_ARGS__)
+#else
+#define INFO(context, ...) UNUSED(context)
+#endif
+#if MAXLOGLEVEL >= 4
 #define DEBUG(context, ...) dc_context_log (context, DC_LOGLEVEL_DEBUG, __FILE__, __LINE__, FUNCTION, __VA_ARGS__)
 #else
+#define DEBUG(context, ...) UNUSED(context)
+#endif
+#else
 #define HEXDUMP(context, loglevel, prefix, data, size) UNUSED(context)
 #define SYSERROR(context, errcode) UNUSED(context)
 #define ERROR(context, ...) UNUSED(context)
@@ -62,6 +95,46 @@ extern "C" {
 #define DEBUG(context, ...) UNUSED(context)
 #endif
 
+/*
+ * Return the shared worker pool of the context, creating it on first
+ * use. The pool is sized to the number of cores and released together
+ * with the context. Returns NULL if the pool cannot be created; the
+ * caller is expected to fall back to running its work inline.
+ */
+dc_taskpool_t *
+dc_context_taskpool (dc_context_t *context);
+
+/*
+ * Report whether connection keepalive has been enabled on the context
+ * with dc_context_set_keepalive. Accepts NULL and returns zero.
+ */
+unsigned int
+dc_context_get_keepalive (dc_context_t *context);
+
+/*
+ * Retrieve the transfer scheduler registered on the context with
+ * dc_context_set_scheduler, for a transport connection to inherit at
+ * open time. Accepts NULL and reports no scheduler.
+ */
+void
+dc_context_get_scheduler (dc_context_t *context, dc_scheduler_callback_t *callback, void **userdata, size_t *threshold);
+
+/*
+ * Allocate and release memory through the allocator installed with
+ * dc_context_set_allocator, falling back to the system allocator when
+ * none is installed (or the context is NULL). All allocations for
+ * objects owned by a context go through these functions, so the
+ * counters reported by dc_context_allocation_stats stay accurate.
+ */
+void *
+dc_context_malloc (dc_context_t *context, size_t size);
+
+void *
+dc_context_realloc (dc_context_t *context, void *ptr, size_t size);
+
+void
+dc_context_mfree (dc_context_t *context, void *ptr);
+
 dc_status_t
 dc_context_log (dc_context_t *context, dc_loglevel_t loglevel, const char *file, unsigned int line, const char *function, const char *format, ...) ATTR_FORMAT_PRINTF(6, 7);
 
@@ -22,6 +22,7 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <stdarg.h>
+#include <stdint.h>
 #include <string.h>
 
 #ifdef _WIN32
@@ -31,12 +32,58 @@
 #include <sys/time.h>
 #endif
 
+#include <libdivecomputer/descriptor.h>
+
 #include "context-private.h"
+#include "checksum.h"
+#include "threads.h"
+
+// The number of buffers retained in the pool.
+#define NPOOL 4
 
 struct dc_context_t {
 	dc_loglevel_t loglevel;
 	dc_logfunc_t logfunc;
 	void *userdata;
+	// Protects the buffer pool and the log message buffer, so a
+	// context can be shared between threads.
+	dc_mutex_t mutex;
+	// Pool of released buffers, reused by dc_context_buffer_acquire.
+	dc_buffer_t *pool[NPOOL];
+	// Shared worker pool, created on first use.
+	dc_taskpool_t *taskpool;
+	// Custom allocator and allocation counters.
+	dc_malloc_func_t malloc_func;
+	dc_realloc_func_t realloc_func;
+	dc_free_func_t free_func;
+	void *alloc_userdata;
+	unsigned long long alloc_bytes;
+	unsigned long long alloc_count;
+	unsigned long long alloc_live;
+	unsigned long long alloc_peak;
+	// Sizes of the live allocations, for the peak statistics. Open
+	// addressing on the pointer value, with tombstones for removal.
+	void **track_ptrs;
+	size_t *track_sizes;
+	unsigned int track_capacity;
+	unsigned int track_count;
+	// Occupied slots, including the tombstones. Keeping this below the
+	// capacity guarantees the probe loops terminate.
+	unsigned int track_used;
+	// Keep the transport connection alive across device sessions.
+	unsigned int keepalive;
+	// Transfer scheduler, see dc_context_set_scheduler. Inherited by
+	// the transport connections opened under this context.
+	dc_scheduler_callback_t scheduler_callback;
+	void *scheduler_userdata;
+	size_t scheduler_threshold;
+	// Worker placement hint, see dc_context_set_affinity.
+	unsigned int *affinity;
+	unsigned int naffinity;
+	// Binary log ring, see dc_context_set_logring.
+	dc_logrecord_t *logring;
+	unsigned int logring_count;
+	unsigned int logring_sequence;
 #ifdef ENABLE_LOGGING
 	char msg[8192 + 32];
 #ifdef _WIN32
@@ -47,7 +94,6 @@ struct dc_context_t {
 #endif
 };
 
-#ifdef ENABLE_LOGGING
 /*
  * A wrapper for the vsnprintf function, which will always null terminate the
  * string and returns a negative value if the destination buffer is too small.
@@ -129,28 +175,34 @@ l_hexdump (char *str, size_t size, const unsigned char data[], size_t n)
 	return (n > maxlength ? -1 : length * 2);
 }
 
-static void
-logfunc (dc_context_t *context, dc_loglevel_t loglevel, const char *file, unsigned int line, const char *function, const char *msg, void *userdata)
+#ifdef ENABLE_LOGGING
+// The time since the context was created, in microseconds.
+static unsigned long long
+dc_context_elapsed (dc_context_t *context)
 {
-	const char *loglevels[] = {"NONE", "ERROR", "WARNING", "INFO", "DEBUG", "ALL"};
-
-	unsigned long seconds = 0, microseconds = 0;
-
 #ifdef _WIN32
 	LARGE_INTEGER now, delta;
 	QueryPerformanceCounter(&now);
 	delta.QuadPart = now.QuadPart - context->timestamp.QuadPart;
 	delta.QuadPart *= 1000000;
 	delta.QuadPart /= context->frequency.QuadPart;
-	seconds = delta.QuadPart / 1000000;
-	microseconds = delta.QuadPart % 1000000;
+	return delta.QuadPart;
 #else
 	struct timeval now, delta;
 	gettimeofday (&now, NULL);
 	timersub (&now, &context->timestamp, &delta);
-	seconds = delta.tv_sec;
-	microseconds = delta.tv_usec;
+	return (unsigned long long) delta.tv_sec * 1000000 + delta.tv_usec;
 #endif
+}
+
+static void
+logfunc (dc_context_t *context, dc_loglevel_t loglevel, const char *file, unsigned int line, const char *function, const char *msg, void *userdata)
+{
+	const char *loglevels[] = {"NONE", "ERROR", "WARNING", "INFO", "DEBUG", "ALL"};
+
+	unsigned long long elapsed = dc_context_elapsed (context);
+	unsigned long seconds = elapsed / 1000000;
+	unsigned long microseconds = elapsed % 1000000;
 
 	if (loglevel == DC_LOGLEVEL_ERROR || loglevel == DC_LOGLEVEL_WARNING) {
 		fprintf (stderr, "[%li.%06li] %s: %s [in %s:%d (%s)]\n",
@@ -162,6 +214,175 @@ logfunc (dc_context_t *context, dc_loglevel_t loglevel, const char *file, unsign
 			loglevels[loglevel], msg);
 	}
 }
+
+// Claim the next slot of the log ring. Called with the context lock
+// held. The sequence number is stored last on the formatting side, but
+// here the whole record is written under the lock, so it is simply
+// initialized along with the header fields.
+static dc_logrecord_t *
+dc_context_logring_claim (dc_context_t *context, unsigned int type, dc_loglevel_t loglevel, const char *file, unsigned int line, const char *function, const char *format)
+{
+	dc_logrecord_t *record = context->logring + (context->logring_sequence % context->logring_count);
+
+	context->logring_sequence++;
+
+	record->sequence = context->logring_sequence;
+	record->type = type;
+	record->loglevel = loglevel;
+	record->line = line;
+	record->timestamp = dc_context_elapsed (context);
+	record->file = file;
+	record->function = function;
+	record->format = format;
+	record->nargs = 0;
+	record->nstrings = 0;
+
+	return record;
+}
+
+// Capture a log message as a binary record: the format string pointer
+// plus the decoded arguments, without any printf formatting. The
+// format string is parsed just far enough to pull the arguments off
+// the va_list with the correct types. Arguments that don't fit in the
+// record are dropped; the formatter detects this and marks the
+// truncation.
+static void
+dc_context_logring_message (dc_context_t *context, dc_loglevel_t loglevel, const char *file, unsigned int line, const char *function, const char *format, va_list ap)
+{
+	dc_mutex_lock (&context->mutex);
+
+	dc_logrecord_t *record = dc_context_logring_claim (context,
+		DC_LOGRECORD_MESSAGE, loglevel, file, line, function, format);
+
+	const char *p = format;
+	while (*p) {
+		if (*p++ != '%')
+			continue;
+		if (*p == '%') {
+			p++;
+			continue;
+		}
+
+		if (record->nargs >= DC_LOGRECORD_MAXARGS)
+			break;
+
+		// Flags, width and precision. A '*' consumes an (ignored)
+		// integer argument.
+		while (*p == '-' || *p == '+' || *p == ' ' || *p == '#' || *p == '0')
+			p++;
+		while ((*p >= '0' && *p <= '9') || *p == '.' || *p == '*') {
+			if (*p == '*')
+				(void) va_arg (ap, int);
+			p++;
+		}
+
+		// Length modifiers.
+		unsigned int longs = 0, sizes = 0;
+		while (*p == 'h' || *p == 'l' || *p == 'z' || *p == 't' || *p == 'j' || *p == 'L') {
+			if (*p == 'l')
+				longs++;
+			else if (*p == 'z' || *p == 't' || *p == 'j')
+				sizes++;
+			p++;
+		}
+
+		unsigned long long value = 0;
+		double number = 0.0;
+		const char *string = NULL;
+		unsigned int length = 0;
+
+		switch (*p) {
+		case 'd':
+		case 'i':
+			if (longs >= 2)
+				value = (unsigned long long) va_arg (ap, long long);
+			else if (longs == 1)
+				value = (unsigned long long) va_arg (ap, long);
+			else if (sizes)
+				value = (unsigned long long) va_arg (ap, size_t);
+			else
+				value = (unsigned long long) (long long) va_arg (ap, int);
+			record->args[record->nargs++] = value;
+			break;
+		case 'u':
+		case 'o':
+		case 'x':
+		case 'X':
+			if (longs >= 2)
+				value = va_arg (ap, unsigned long long);
+			else if (longs == 1)
+				value = va_arg (ap, unsigned long);
+			else if (sizes)
+				value = va_arg (ap, size_t);
+			else
+				value = va_arg (ap, unsigned int);
+			record->args[record->nargs++] = value;
+			break;
+		case 'c':
+			record->args[record->nargs++] = (unsigned long long) va_arg (ap, int);
+			break;
+		case 'p':
+			record->args[record->nargs++] = (unsigned long long) (uintptr_t) va_arg (ap, void *);
+			break;
+		case 'f':
+		case 'F':
+		case 'e':
+		case 'E':
+		case 'g':
+		case 'G':
+			number = va_arg (ap, double);
+			memcpy (record->args + record->nargs++, &number, sizeof (number));
+			break;
+		case 's':
+			// Copy the string into the record, so transient buffers
+			// (e.g. strerror output) remain available at format time.
+			string = va_arg (ap, const char *);
+			if (string == NULL)
+				string = "(null)";
+			if (record->nstrings >= DC_LOGRECORD_MAXSTRINGS)
+				goto done;
+			length = strlen (string);
+			if (length >= DC_LOGRECORD_MAXSTRINGS - record->nstrings)
+				length = DC_LOGRECORD_MAXSTRINGS - record->nstrings - 1;
+			record->args[record->nargs++] = record->nstrings;
+			memcpy (record->strings + record->nstrings, string, length);
+			record->strings[record->nstrings + length] = 0;
+			record->nstrings += length + 1;
+			break;
+		default:
+			// Unknown conversion; stop capturing.
+			goto done;
+		}
+
+		if (*p == 0)
+			break;
+		p++;
+	}
+
+done:
+	dc_mutex_unlock (&context->mutex);
+}
+
+// Capture a hexdump as a binary record: the raw data bytes, without
+// the two characters per byte text expansion.
+static void
+dc_context_logring_hexdump (dc_context_t *context, dc_loglevel_t loglevel, const char *file, unsigned int line, const char *function, const char *prefix, const unsigned char data[], unsigned int size)
+{
+	dc_mutex_lock (&context->mutex);
+
+	dc_logrecord_t *record = dc_context_logring_claim (context,
+		DC_LOGRECORD_HEXDUMP, loglevel, file, line, function, prefix);
+
+	unsigned int length = size;
+	if (length > DC_LOGRECORD_MAXSTRINGS)
+		length = DC_LOGRECORD_MAXSTRINGS;
+
+	record->args[record->nargs++] = size;
+	memcpy (record->strings, data, length);
+	record->nstrings = length;
+
+	dc_mutex_unlock (&context->mutex);
+}
 #endif
 
 dc_status_t
@@ -185,6 +406,42 @@ dc_context_new (dc_context_t **out)
 #endif
 	context->userdata = NULL;
 
+	if (dc_mutex_init (&context->mutex) != 0) {
+		free (context);
+		return DC_STATUS_NOMEMORY;
+	}
+
+	memset (context->pool, 0, sizeof (context->pool));
+
+	context->taskpool = NULL;
+
+	context->malloc_func = NULL;
+	context->realloc_func = NULL;
+	context->free_func = NULL;
+	context->alloc_userdata = NULL;
+	context->alloc_bytes = 0;
+	context->alloc_count = 0;
+	context->alloc_live = 0;
+	context->alloc_peak = 0;
+	context->track_ptrs = NULL;
+	context->track_sizes = NULL;
+	context->track_capacity = 0;
+	context->track_count = 0;
+	context->track_used = 0;
+
+	context->keepalive = 0;
+
+	context->scheduler_callback = NULL;
+	context->scheduler_userdata = NULL;
+	context->scheduler_threshold = 0;
+
+	context->affinity = NULL;
+	context->naffinity = 0;
+
+	context->logring = NULL;
+	context->logring_count = 0;
+	context->logring_sequence = 0;
+
 #ifdef ENABLE_LOGGING
 	memset (context->msg, 0, sizeof (context->msg));
 #ifdef _WIN32
@@ -203,11 +460,358 @@ dc_context_new (dc_context_t **out)
 dc_status_t
 dc_context_free (dc_context_t *context)
 {
+	if (context) {
+		dc_taskpool_destroy (context->taskpool);
+
+		for (unsigned int i = 0; i < NPOOL; ++i) {
+			dc_buffer_free (context->pool[i]);
+		}
+
+		dc_mutex_destroy (&context->mutex);
+
+		free (context->track_ptrs);
+		free (context->track_sizes);
+		free (context->affinity);
+	}
+
 	free (context);
 
 	return DC_STATUS_SUCCESS;
 }
 
+dc_status_t
+dc_context_warmup (dc_context_t *context)
+{
+	if (context == NULL)
+		return DC_STATUS_INVALIDARGS;
+
+	// Build the descriptor lookup index. The lookup itself is expected
+	// to fail (DC_FAMILY_NULL matches no descriptor), but the index is
+	// built as a side effect before the first real lookup.
+	dc_descriptor_t *descriptor = NULL;
+	dc_descriptor_lookup (&descriptor, DC_FAMILY_NULL, 0);
+
+	// Generate the CRC lookup tables, so the first download doesn't
+	// pay the one-time cost.
+	checksum_warmup ();
+
+	// Create the shared worker pool.
+	if (dc_context_taskpool (context) == NULL)
+		return DC_STATUS_NOMEMORY;
+
+	return DC_STATUS_SUCCESS;
+}
+
+dc_buffer_t *
+dc_context_buffer_acquire (dc_context_t *context, size_t capacity)
+{
+	if (context == NULL)
+		return dc_buffer_new (capacity);
+
+	dc_buffer_t *buffer = NULL;
+
+	dc_mutex_lock (&context->mutex);
+	for (unsigned int i = 0; i < NPOOL; ++i) {
+		if (context->pool[i] == NULL)
+			continue;
+
+		buffer = context->pool[i];
+		context->pool[i] = NULL;
+		break;
+	}
+	dc_mutex_unlock (&context->mutex);
+
+	if (buffer) {
+		if (!dc_buffer_reserve (buffer, capacity)) {
+			dc_buffer_free (buffer);
+			return NULL;
+		}
+
+		return buffer;
+	}
+
+	return dc_buffer_new (capacity);
+}
+
+void
+dc_context_buffer_release (dc_context_t *context, dc_buffer_t *buffer)
+{
+	if (buffer == NULL)
+		return;
+
+	if (context) {
+		dc_buffer_clear (buffer);
+
+		dc_mutex_lock (&context->mutex);
+		for (unsigned int i = 0; i < NPOOL; ++i) {
+			if (context->pool[i] == NULL) {
+				context->pool[i] = buffer;
+				dc_mutex_unlock (&context->mutex);
+				return;
+			}
+		}
+		dc_mutex_unlock (&context->mutex);
+	}
+
+	dc_buffer_free (buffer);
+}
+
+dc_status_t
+dc_context_set_allocator (dc_context_t *context, dc_malloc_func_t malloc_func, dc_realloc_func_t realloc_func, dc_free_func_t free_func, void *userdata)
+{
+	if (context == NULL)
+		return DC_STATUS_INVALIDARGS;
+
+	// All three functions, or none.
+	if ((malloc_func == NULL) != (free_func == NULL) ||
+		(malloc_func == NULL) != (realloc_func == NULL))
+		return DC_STATUS_INVALIDARGS;
+
+	context->malloc_func = malloc_func;
+	context->realloc_func = realloc_func;
+	context->free_func = free_func;
+	context->alloc_userdata = userdata;
+
+	return DC_STATUS_SUCCESS;
+}
+
+dc_status_t
+dc_context_allocation_stats (dc_context_t *context, unsigned long long *nbytes, unsigned long long *nallocs)
+{
+	if (context == NULL)
+		return DC_STATUS_INVALIDARGS;
+
+	dc_mutex_lock (&context->mutex);
+	if (nbytes)
+		*nbytes = context->alloc_bytes;
+	if (nallocs)
+		*nallocs = context->alloc_count;
+	dc_mutex_unlock (&context->mutex);
+
+	return DC_STATUS_SUCCESS;
+}
+
+dc_status_t
+dc_context_allocation_peak (dc_context_t *context, unsigned long long *live, unsigned long long *peak)
+{
+	if (context == NULL)
+		return DC_STATUS_INVALIDARGS;
+
+	dc_mutex_lock (&context->mutex);
+	if (live)
+		*live = context->alloc_live;
+	if (peak)
+		*peak = context->alloc_peak;
+	dc_mutex_unlock (&context->mutex);
+
+	return DC_STATUS_SUCCESS;
+}
+
+dc_status_t
+dc_context_allocation_peak_reset (dc_context_t *context)
+{
+	if (context == NULL)
+		return DC_STATUS_INVALIDARGS;
+
+	dc_mutex_lock (&context->mutex);
+	context->alloc_peak = context->alloc_live;
+	dc_mutex_unlock (&context->mutex);
+
+	return DC_STATUS_SUCCESS;
+}
+
+// Marker for a removed slot in the tracking table.
+#define TRACK_TOMBSTONE ((void *) (uintptr_t) -1)
+
+static unsigned int
+dc_context_track_slot (const void *ptr, unsigned int capacity)
+{
+	// The low bits of a heap pointer are mostly alignment zeros, so
+	// shift them out before hashing.
+	uintptr_t value = (uintptr_t) ptr >> 4;
+
+	return (value * 2654435761u) & (capacity - 1);
+}
+
+static int
+dc_context_track_insert (dc_context_t *context, void *ptr, size_t size)
+{
+	// Grow the table at 3/4 load, rehashing drops the tombstones.
+	if ((context->track_used + 1) * 4 > context->track_capacity * 3) {
+		unsigned int capacity = context->track_capacity ? context->track_capacity * 2 : 64;
+		void **ptrs = (void **) calloc (capacity, sizeof (void *));
+		size_t *sizes = (size_t *) calloc (capacity, sizeof (size_t));
+		if (ptrs == NULL || sizes == NULL) {
+			free (ptrs);
+			free (sizes);
+			return 0;
+		}
+
+		unsigned int count = 0;
+		for (unsigned int i = 0; i < context->track_capacity; ++i) {
+			void *entry = context->track_ptrs[i];
+			if (entry == NULL || entry == TRACK_TOMBSTONE)
+				continue;
+			unsigned int slot = dc_context_track_slot (entry, capacity);
+			while (ptrs[slot] != NULL)
+				slot = (slot + 1) & (capacity - 1);
+			ptrs[slot] = entry;
+			sizes[slot] = context->track_sizes[i];
+			count++;
+		}
+
+		free (context->track_ptrs);
+		free (context->track_sizes);
+		context->track_ptrs = ptrs;
+		context->track_sizes = sizes;
+		context->track_capacity = capacity;
+		context->track_count = count;
+		context->track_used = count;
+	}
+
+	unsigned int slot = dc_context_track_slot (ptr, context->track_capacity);
+	while (context->track_ptrs[slot] != NULL &&
+		context->track_ptrs[slot] != TRACK_TOMBSTONE)
+		slot = (slot + 1) & (context->track_capacity - 1);
+	if (context->track_ptrs[slot] == NULL)
+		context->track_used++;
+	context->track_ptrs[slot] = ptr;
+	context->track_sizes[slot] = size;
+	context->track_count++;
+
+	return 1;
+}
+
+static size_t
+dc_context_track_remove (dc_context_t *context, void *ptr)
+{
+	if (context->track_capacity == 0)
+		return 0;
+
+	unsigned int slot = dc_context_track_slot (ptr, context->track_capacity);
+	while (context->track_ptrs[slot] != NULL) {
+		if (context->track_ptrs[slot] == ptr) {
+			size_t size = context->track_sizes[slot];
+			context->track_ptrs[slot] = TRACK_TOMBSTONE;
+			context->track_sizes[slot] = 0;
+			context->track_count--;
+			return size;
+		}
+		slot = (slot + 1) & (context->track_capacity - 1);
+	}
+
+	return 0;
+}
+
+void *
+dc_context_malloc (dc_context_t *context, size_t size)
+{
+	void *ptr = NULL;
+
+	if (context == NULL)
+		return malloc (size);
+
+	if (context->malloc_func)
+		ptr = context->malloc_func (size, context->alloc_userdata);
+	else
+		ptr = malloc (size);
+
+	if (ptr) {
+		dc_mutex_lock (&context->mutex);
+		context->alloc_bytes += size;
+		context->alloc_count++;
+		if (dc_context_track_insert (context, ptr, size)) {
+			context->alloc_live += size;
+			if (context->alloc_live > context->alloc_peak)
+				context->alloc_peak = context->alloc_live;
+		}
+		dc_mutex_unlock (&context->mutex);
+	}
+
+	return ptr;
+}
+
+void *
+dc_context_realloc (dc_context_t *context, void *ptr, size_t size)
+{
+	void *result = NULL;
+
+	if (context == NULL)
+		return realloc (ptr, size);
+
+	if (context->realloc_func)
+		result = context->realloc_func (ptr, size, context->alloc_userdata);
+	else
+		result = realloc (ptr, size);
+
+	if (result) {
+		dc_mutex_lock (&context->mutex);
+		context->alloc_bytes += size;
+		context->alloc_count++;
+		size_t oldsize = ptr ? dc_context_track_remove (context, ptr) : 0;
+		if (dc_context_track_insert (context, result, size)) {
+			context->alloc_live += size;
+			context->alloc_live -= oldsize;
+			if (context->alloc_live > context->alloc_peak)
+				context->alloc_peak = context->alloc_live;
+		} else {
+			context->alloc_live -= oldsize;
+		}
+		dc_mutex_unlock (&context->mutex);
+	}
+
+	return result;
+}
+
+void
+dc_context_mfree (dc_context_t *context, void *ptr)
+{
+	if (context == NULL) {
+		free (ptr);
+		return;
+	}
+
+	if (ptr) {
+		dc_mutex_lock (&context->mutex);
+		context->alloc_live -= dc_context_track_remove (context, ptr);
+		dc_mutex_unlock (&context->mutex);
+	}
+
+	if (context->free_func == NULL) {
+		free (ptr);
+		return;
+	}
+
+	context->free_func (ptr, context->alloc_userdata);
+}
+
+dc_taskpool_t *
+dc_context_taskpool (dc_context_t *context)
+{
+	if (context == NULL)
+		return NULL;
+
+	dc_mutex_lock (&context->mutex);
+	if (context->taskpool == NULL) {
+		// Sized to the number of cores, so concurrent features sharing
+		// the pool don't oversubscribe the machine.
+		context->taskpool = dc_taskpool_create (dc_thread_ncores ());
+		// Apply the placement hint to the new workers.
+		if (context->taskpool && context->naffinity) {
+			dc_taskpool_set_affinity (context->taskpool,
+				context->affinity, context->naffinity);
+		}
+	}
+	dc_taskpool_t *taskpool = context->taskpool;
+	dc_mutex_unlock (&context->mutex);
+
+	if (taskpool == NULL) {
+		ERROR (context, "Failed to create the task pool.");
+	}
+
+	return taskpool;
+}
+
 dc_status_t
 dc_context_set_loglevel (dc_context_t *context, dc_loglevel_t loglevel)
 {
@@ -215,12 +819,101 @@ dc_context_set_loglevel (dc_context_t *context, dc_loglevel_t loglevel)
 		return DC_STATUS_INVALIDARGS;
 
 #ifdef ENABLE_LOGGING
+	// Clamp to the maximum log level compiled in, so messages above
+	// that level are also filtered when logged directly.
+	if (loglevel > MAXLOGLEVEL)
+		loglevel = (dc_loglevel_t) MAXLOGLEVEL;
 	context->loglevel = loglevel;
 #endif
 
 	return DC_STATUS_SUCCESS;
 }
 
+dc_status_t
+dc_context_set_keepalive (dc_context_t *context, unsigned int value)
+{
+	if (context == NULL)
+		return DC_STATUS_INVALIDARGS;
+
+	context->keepalive = value;
+
+	return DC_STATUS_SUCCESS;
+}
+
+unsigned int
+dc_context_get_keepalive (dc_context_t *context)
+{
+	if (context == NULL)
+		return 0;
+
+	return context->keepalive;
+}
+
+dc_status_t
+dc_context_set_scheduler (dc_context_t *context, dc_scheduler_callback_t callback, void *userdata, size_t threshold)
+{
+	if (context == NULL)
+		return DC_STATUS_INVALIDARGS;
+
+	context->scheduler_callback = callback;
+	context->scheduler_userdata = userdata;
+	context->scheduler_threshold = threshold;
+
+	return DC_STATUS_SUCCESS;
+}
+
+void
+dc_context_get_scheduler (dc_context_t *context, dc_scheduler_callback_t *callback, void **userdata, size_t *threshold)
+{
+	if (context == NULL) {
+		*callback = NULL;
+		*userdata = NULL;
+		*threshold = 0;
+		return;
+	}
+
+	*callback = context->scheduler_callback;
+	*userdata = context->scheduler_userdata;
+	*threshold = context->scheduler_threshold;
+}
+
+dc_status_t
+dc_context_set_affinity (dc_context_t *context, const unsigned int cores[], unsigned int ncores)
+{
+	if (context == NULL || (cores == NULL && ncores != 0))
+		return DC_STATUS_INVALIDARGS;
+
+	// Copy the core list, so the caller's array doesn't need to stay
+	// alive until the worker pool is created.
+	unsigned int *copy = NULL;
+	if (ncores) {
+		copy = (unsigned int *) malloc (ncores * sizeof (unsigned int));
+		if (copy == NULL) {
+			ERROR (context, "Failed to allocate memory.");
+			return DC_STATUS_NOMEMORY;
+		}
+		memcpy (copy, cores, ncores * sizeof (unsigned int));
+	}
+
+	int result = 0;
+	dc_mutex_lock (&context->mutex);
+	free (context->affinity);
+	context->affinity = copy;
+	context->naffinity = ncores;
+	// Re-pin the workers, if the pool was already created.
+	if (context->taskpool) {
+		result = dc_taskpool_set_affinity (context->taskpool, copy, ncores);
+	}
+	dc_mutex_unlock (&context->mutex);
+
+	if (result != 0) {
+		WARNING (context, "Failed to apply the processor affinity.");
+		return DC_STATUS_UNSUPPORTED;
+	}
+
+	return DC_STATUS_SUCCESS;
+}
+
 dc_status_t
 dc_context_set_logfunc (dc_context_t *context, dc_logfunc_t logfunc, void *userdata)
 {
@@ -235,6 +928,162 @@ dc_context_set_logfunc (dc_context_t *context, dc_logfunc_t logfunc, void *userd
 	return DC_STATUS_SUCCESS;
 }
 
+dc_status_t
+dc_context_set_logring (dc_context_t *context, dc_logrecord_t records[], unsigned int count)
+{
+	if (context == NULL || (records == NULL) != (count == 0))
+		return DC_STATUS_INVALIDARGS;
+
+#ifdef ENABLE_LOGGING
+	dc_mutex_lock (&context->mutex);
+	// Clear the array, so a zero sequence number marks a slot that was
+	// never written.
+	if (records)
+		memset (records, 0, count * sizeof (dc_logrecord_t));
+	context->logring = records;
+	context->logring_count = count;
+	context->logring_sequence = 0;
+	dc_mutex_unlock (&context->mutex);
+#endif
+
+	return DC_STATUS_SUCCESS;
+}
+
+// Append formatted text, tracking the write position. Once the buffer
+// is full, all further appends are ignored.
+static void
+dc_logrecord_append (char *str, size_t size, size_t *offset, const char *format, ...)
+{
+	va_list ap;
+	int n;
+
+	if (*offset >= size)
+		return;
+
+	va_start (ap, format);
+	n = l_vsnprintf (str + *offset, size - *offset, format, ap);
+	va_end (ap);
+
+	if (n < 0)
+		*offset = size;
+	else
+		*offset += n;
+}
+
+dc_status_t
+dc_logrecord_format (const dc_logrecord_t *record, char *str, size_t size)
+{
+	if (record == NULL || str == NULL || size == 0)
+		return DC_STATUS_INVALIDARGS;
+
+	// A sequence number of zero marks a slot that was never written.
+	if (record->sequence == 0 || record->format == NULL)
+		return DC_STATUS_INVALIDARGS;
+
+	size_t offset = 0;
+	str[0] = 0;
+
+	if (record->type == DC_LOGRECORD_HEXDUMP) {
+		// Mirror the text produced by dc_context_hexdump.
+		dc_logrecord_append (str, size, &offset, "%s: size=%llu, data=",
+			record->format, record->args[0]);
+		if (offset < size) {
+			int n = l_hexdump (str + offset, size - offset,
+				(const unsigned char *) record->strings, record->nstrings);
+			offset = (n < 0) ? size : offset + n;
+		}
+		// Mark the bytes that didn't fit in the record.
+		if (record->nstrings < record->args[0])
+			dc_logrecord_append (str, size, &offset, "...");
+		return DC_STATUS_SUCCESS;
+	}
+
+	// Replay the format string with the captured arguments. The width,
+	// precision and flags are not preserved, so the output is
+	// equivalent, but not always byte identical, to the original.
+	const char *p = record->format;
+	unsigned int arg = 0;
+	while (*p) {
+		if (*p != '%') {
+			dc_logrecord_append (str, size, &offset, "%c", *p++);
+			continue;
+		}
+		p++;
+		if (*p == '%') {
+			dc_logrecord_append (str, size, &offset, "%%");
+			p++;
+			continue;
+		}
+
+		// Skip the flags, width, precision and length modifiers.
+		while (*p == '-' || *p == '+' || *p == ' ' || *p == '#' || *p == '0')
+			p++;
+		while ((*p >= '0' && *p <= '9') || *p == '.' || *p == '*')
+			p++;
+		while (*p == 'h' || *p == 'l' || *p == 'z' || *p == 't' || *p == 'j' || *p == 'L')
+			p++;
+
+		// A conversion beyond the captured arguments marks the spot
+		// where the capture was truncated.
+		if (arg >= record->nargs) {
+			dc_logrecord_append (str, size, &offset, "...");
+			break;
+		}
+
+		double number = 0.0;
+		char spec[3] = {'%', *p, 0};
+
+		switch (*p) {
+		case 'd':
+		case 'i':
+			dc_logrecord_append (str, size, &offset, "%lld", (long long) record->args[arg++]);
+			break;
+		case 'u':
+			dc_logrecord_append (str, size, &offset, "%llu", record->args[arg++]);
+			break;
+		case 'o':
+			dc_logrecord_append (str, size, &offset, "%llo", record->args[arg++]);
+			break;
+		case 'x':
+			dc_logrecord_append (str, size, &offset, "%llx", record->args[arg++]);
+			break;
+		case 'X':
+			dc_logrecord_append (str, size, &offset, "%llX", record->args[arg++]);
+			break;
+		case 'c':
+			dc_logrecord_append (str, size, &offset, "%c", (int) record->args[arg++]);
+			break;
+		case 'p':
+			dc_logrecord_append (str, size, &offset, "%p", (void *) (uintptr_t) record->args[arg++]);
+			break;
+		case 'f':
+		case 'F':
+		case 'e':
+		case 'E':
+		case 'g':
+		case 'G':
+			memcpy (&number, record->args + arg++, sizeof (number));
+			dc_logrecord_append (str, size, &offset, spec, number);
+			break;
+		case 's':
+			if (record->args[arg] < record->nstrings)
+				dc_logrecord_append (str, size, &offset, "%s", record->strings + record->args[arg]);
+			arg++;
+			break;
+		default:
+			// The capture stopped at this conversion.
+			dc_logrecord_append (str, size, &offset, "...");
+			return DC_STATUS_SUCCESS;
+		}
+
+		if (*p == 0)
+			break;
+		p++;
+	}
+
+	return DC_STATUS_SUCCESS;
+}
+
 dc_status_t
 dc_context_log (dc_context_t *context, dc_loglevel_t loglevel, const char *file, unsigned int line, const char *function, const char *format, ...)
 {
@@ -249,14 +1098,41 @@ dc_context_log (dc_context_t *context, dc_loglevel_t loglevel, const char *file,
 	if (loglevel > context->loglevel)
 		return DC_STATUS_SUCCESS;
 
+	// Capture a binary record instead of formatting text, see
+	// dc_context_set_logring.
+	if (context->logring) {
+		va_start (ap, format);
+		dc_context_logring_message (context, loglevel, file, line, function, format, ap);
+		va_end (ap);
+		return DC_STATUS_SUCCESS;
+	}
+
 	if (context->logfunc == NULL)
 		return DC_STATUS_SUCCESS;
 
+	// Format into a stack buffer, so concurrent threads only contend
+	// for the lock around the callback itself, not the formatting.
+	char buffer[1024];
 	va_start (ap, format);
-	l_vsnprintf (context->msg, sizeof (context->msg), format, ap);
+	int n = l_vsnprintf (buffer, sizeof (buffer), format, ap);
 	va_end (ap);
 
-	context->logfunc (context, loglevel, file, line, function, context->msg, context->userdata);
+	if (n >= 0) {
+		// The callback remains serialized, so the messages of
+		// concurrent threads are delivered in a well defined order and
+		// the built-in log function never interleaves its output.
+		dc_mutex_lock (&context->mutex);
+		context->logfunc (context, loglevel, file, line, function, buffer, context->userdata);
+		dc_mutex_unlock (&context->mutex);
+	} else {
+		// Too large for the stack; fall back to the shared buffer.
+		dc_mutex_lock (&context->mutex);
+		va_start (ap, format);
+		l_vsnprintf (context->msg, sizeof (context->msg), format, ap);
+		va_end (ap);
+		context->logfunc (context, loglevel, file, line, function, context->msg, context->userdata);
+		dc_mutex_unlock (&context->mutex);
+	}
 #endif
 
 	return DC_STATUS_SUCCESS;
@@ -316,9 +1192,18 @@ dc_context_hexdump (dc_context_t *context, dc_loglevel_t loglevel, const char *f
 	if (loglevel > context->loglevel)
 		return DC_STATUS_SUCCESS;
 
+	// Capture the raw bytes instead of the hexadecimal text, see
+	// dc_context_set_logring.
+	if (context->logring) {
+		dc_context_logring_hexdump (context, loglevel, file, line, function, prefix, data, size);
+		return DC_STATUS_SUCCESS;
+	}
+
 	if (context->logfunc == NULL)
 		return DC_STATUS_SUCCESS;
 
+	dc_mutex_lock (&context->mutex);
+
 	n = l_snprintf (context->msg, sizeof (context->msg), "%s: size=%u, data=", prefix, size);
 
 	if (n >= 0) {
@@ -326,6 +1211,8 @@ dc_context_hexdump (dc_context_t *context, dc_loglevel_t loglevel, const char *f
 	}
 
 	context->logfunc (context, loglevel, file, line, function, context->msg, context->userdata);
+
+	dc_mutex_unlock (&context->mutex);
 #endif
 
 	return DC_STATUS_SUCCESS;
@@ -68,7 +68,7 @@ static dc_status_t cressi_edy_device_dump (dc_device_t *abstract, dc_buffer_t *b
 static dc_status_t cressi_edy_device_foreach (dc_device_t *abstract, dc_dive_callback_t callback, void *userdata);
 static dc_status_t cressi_edy_device_close (dc_device_t *abstract);
 
-static const dc_device_vtable_t cressi_edy_device_vtable = {
+DC_VTABLE_STORAGE const dc_device_vtable_t cressi_edy_device_vtable = {
 	sizeof(cressi_edy_device_t),
 	DC_FAMILY_CRESSI_EDY,
 	cressi_edy_device_set_fingerprint, /* set_fingerprint */
@@ -161,7 +161,7 @@ cressi_edy_transfer (cressi_edy_device_t *device, const unsigned char command[],
 			return rc;
 
 		// Abort if the maximum number of retries is reached.
-		if (nretries++ >= MAXRETRIES)
+		if (nretries++ >= device_retry_limit ((dc_device_t *) device, MAXRETRIES))
 			return rc;
 
 		// Delay the next attempt.
@@ -246,6 +246,9 @@ cressi_edy_device_open (dc_device_t **out, dc_context_t *context, const char *na
 		goto error_free;
 	}
 
+	// Forward cancellation requests to the serial layer.
+	dc_serial_set_cancel (device->port, device_cancel_cb, device);
+
 	// Set the serial communication protocol (1200 8N1).
 	status = dc_serial_configure (device->port, 1200, 8, DC_PARITY_NONE, DC_STOPBITS_ONE, DC_FLOWCONTROL_NONE);
 	if (status != DC_STATUS_SUCCESS) {
@@ -274,8 +277,13 @@ cressi_edy_device_open (dc_device_t **out, dc_context_t *context, const char *na
 		goto error_close;
 	}
 
-	// Make sure everything is in a sane state.
-	dc_serial_sleep(device->port, 300);
+	// Make sure everything is in a sane state. A port revived from
+	// the keepalive cache is already settled, so the delays before
+	// and after the init commands are skipped.
+	unsigned int warm = 0;
+	dc_serial_get_warm (device->port, &warm);
+	if (!warm)
+		dc_serial_sleep(device->port, 300);
 	dc_serial_purge(device->port, DC_DIRECTION_ALL);
 
 	// Send the init commands.
@@ -297,7 +305,8 @@ cressi_edy_device_open (dc_device_t **out, dc_context_t *context, const char *na
 	}
 
 	// Make sure everything is in a sane state.
-	dc_serial_sleep(device->port, 300);
+	if (!warm)
+		dc_serial_sleep(device->port, 300);
 	dc_serial_purge(device->port, DC_DIRECTION_ALL);
 
 	*out = (dc_device_t*) device;
@@ -44,7 +44,7 @@ static dc_status_t cressi_edy_parser_get_datetime (dc_parser_t *abstract, dc_dat
 static dc_status_t cressi_edy_parser_get_field (dc_parser_t *abstract, dc_field_type_t type, unsigned int flags, void *value);
 static dc_status_t cressi_edy_parser_samples_foreach (dc_parser_t *abstract, dc_sample_callback_t callback, void *userdata);
 
-static const dc_parser_vtable_t cressi_edy_parser_vtable = {
+DC_VTABLE_STORAGE const dc_parser_vtable_t cressi_edy_parser_vtable = {
 	sizeof(cressi_edy_parser_t),
 	DC_FAMILY_CRESSI_EDY,
 	cressi_edy_parser_set_data, /* set_data */
@@ -203,7 +203,7 @@ cressi_edy_parser_samples_foreach (dc_parser_t *abstract, dc_sample_callback_t c
 
 		// Depth (1/10 m).
 		unsigned int depth = bcd2dec (data[offset + 0] & 0x0F) * 100 + bcd2dec (data[offset + 1]);
-		sample.depth = depth / 10.0;
+		sample.depth = array_scale (depth, 1, 10);
 		if (callback) callback (DC_SAMPLE_DEPTH, sample, userdata);
 
 		// Current gasmix
@@ -60,7 +60,7 @@ static dc_status_t cressi_leonardo_device_dump (dc_device_t *abstract, dc_buffer
 static dc_status_t cressi_leonardo_device_foreach (dc_device_t *abstract, dc_dive_callback_t callback, void *userdata);
 static dc_status_t cressi_leonardo_device_close (dc_device_t *abstract);
 
-static const dc_device_vtable_t cressi_leonardo_device_vtable = {
+DC_VTABLE_STORAGE const dc_device_vtable_t cressi_leonardo_device_vtable = {
 	sizeof(cressi_leonardo_device_t),
 	DC_FAMILY_CRESSI_LEONARDO,
 	cressi_leonardo_device_set_fingerprint, /* set_fingerprint */
@@ -149,7 +149,7 @@ cressi_leonardo_transfer (cressi_leonardo_device_t *device, const unsigned char
 			return rc;
 
 		// Abort if the maximum number of retries is reached.
-		if (nretries++ >= MAXRETRIES)
+		if (nretries++ >= device_retry_limit ((dc_device_t *) device, MAXRETRIES))
 			return rc;
 
 		// Discard any garbage bytes.
@@ -187,6 +187,9 @@ cressi_leonardo_device_open (dc_device_t **out, dc_context_t *context, const cha
 		goto error_free;
 	}
 
+	// Forward cancellation requests to the serial layer.
+	dc_serial_set_cancel (device->port, device_cancel_cb, device);
+
 	// Set the serial communication protocol (115200 8N1).
 	status = dc_serial_configure (device->port, 115200, 8, DC_PARITY_NONE, DC_STOPBITS_ONE, DC_FLOWCONTROL_NONE);
 	if (status != DC_STATUS_SUCCESS) {
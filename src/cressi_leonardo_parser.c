@@ -45,7 +45,7 @@ static dc_status_t cressi_leonardo_parser_get_datetime (dc_parser_t *abstract, d
 static dc_status_t cressi_leonardo_parser_get_field (dc_parser_t *abstract, dc_field_type_t type, unsigned int flags, void *value);
 static dc_status_t cressi_leonardo_parser_samples_foreach (dc_parser_t *abstract, dc_sample_callback_t callback, void *userdata);
 
-static const dc_parser_vtable_t cressi_leonardo_parser_vtable = {
+DC_VTABLE_STORAGE const dc_parser_vtable_t cressi_leonardo_parser_vtable = {
 	sizeof(cressi_leonardo_parser_t),
 	DC_FAMILY_CRESSI_EDY,
 	cressi_leonardo_parser_set_data, /* set_data */
@@ -216,7 +216,7 @@ cressi_leonardo_parser_samples_foreach (dc_parser_t *abstract, dc_sample_callbac
 			if (callback) callback (DC_SAMPLE_TIME, sample, userdata);
 
 			// Depth (1/10 m).
-			sample.depth = depth / 10.0;
+			sample.depth = array_scale (depth, 1, 10);
 			if (callback) callback (DC_SAMPLE_DEPTH, sample, userdata);
 
 			// Gas change.
@@ -111,6 +111,81 @@ dc_datetime_gmtime (dc_datetime_t *result,
 	return result;
 }
 
+/*
+ * Batch conversion with a cached fast path. A libc conversion is
+ * performed once per cache window, and all ticks inside the window are
+ * derived from the cached broken-down time with integer arithmetic
+ * only. For UTC the window extends to the next midnight. For local time
+ * it is capped at the next quarter hour, because the UTC offset can
+ * change in between (DST and zone transitions take effect on at least
+ * quarter hour boundaries); that still reduces the number of libc calls
+ * by two orders of magnitude for typical one second sample rates.
+ * Out-of-order ticks are handled correctly by falling back to the slow
+ * path, so only monotonic input benefits from the cache.
+ */
+static dc_datetime_t *
+dc_datetime_convert_batch (dc_datetime_t result[], const dc_ticks_t ticks[], size_t count, int local)
+{
+	dc_datetime_t base = {0};
+	dc_ticks_t start = 0, end = 0;
+
+	if (result == NULL || ticks == NULL)
+		return NULL;
+
+	for (size_t i = 0; i < count; ++i) {
+		if (i == 0 || ticks[i] < start || ticks[i] >= end) {
+			// Slow path: full libc conversion, and a new cache window.
+			if (local) {
+				if (dc_datetime_localtime (&base, ticks[i]) == NULL)
+					return NULL;
+			} else {
+				if (dc_datetime_gmtime (&base, ticks[i]) == NULL)
+					return NULL;
+			}
+
+			dc_ticks_t sod = base.hour * 3600 + base.minute * 60 + base.second;
+			dc_ticks_t window = 86400 - sod;
+			if (local) {
+				dc_ticks_t quarter = 900 - sod % 900;
+				if (quarter < window)
+					window = quarter;
+			}
+
+			start = ticks[i];
+			end = ticks[i] + window;
+
+			result[i] = base;
+		} else {
+			// Fast path: integer addition within the cache window.
+			dc_ticks_t sod = base.hour * 3600 + base.minute * 60 + base.second +
+				(ticks[i] - start);
+
+			result[i] = base;
+			result[i].hour = sod / 3600;
+			result[i].minute = (sod / 60) % 60;
+			result[i].second = sod % 60;
+		}
+	}
+
+	return result;
+}
+
+dc_datetime_t *
+dc_datetime_localtime_batch (dc_datetime_t result[],
+                             const dc_ticks_t ticks[],
+                             size_t count)
+{
+	return dc_datetime_convert_batch (result, ticks, count, 1);
+}
+
+dc_datetime_t *
+dc_datetime_gmtime_batch (dc_datetime_t result[],
+                          const dc_ticks_t ticks[],
+                          size_t count)
+{
+	return dc_datetime_convert_batch (result, ticks, count, 0);
+}
+
 dc_ticks_t
 dc_datetime_mktime (const dc_datetime_t *dt)
 {
@@ -35,12 +35,14 @@
 #include <libdivecomputer/descriptor.h>
 
 #include "iterator-private.h"
+#include "threads.h"
 
 #define C_ARRAY_SIZE(array) (sizeof (array) / sizeof *(array))
 
 struct dc_descriptor_t {
-	const char *vendor;
-	const char *product;
+	/* Offsets into the string table. */
+	unsigned short vendor;
+	unsigned short product;
 	dc_family_t type;
 	unsigned int model;
 };
@@ -52,265 +54,491 @@ struct dc_descriptor_t {
  * actually used to identify individual models, identical values are assigned.
  */
 
-static const dc_descriptor_t g_descriptors[] = {
-	/* Suunto Solution */
-	{"Suunto", "Solution", DC_FAMILY_SUUNTO_SOLUTION, 0},
-	/* Suunto Eon */
-	{"Suunto", "Eon",             DC_FAMILY_SUUNTO_EON, 0},
-	{"Suunto", "Solution Alpha",  DC_FAMILY_SUUNTO_EON, 0},
-	{"Suunto", "Solution Nitrox", DC_FAMILY_SUUNTO_EON, 0},
-	/* Suunto Vyper */
-	{"Suunto", "Spyder",   DC_FAMILY_SUUNTO_VYPER, 0x01},
-	{"Suunto", "Stinger",  DC_FAMILY_SUUNTO_VYPER, 0x03},
-	{"Suunto", "Mosquito", DC_FAMILY_SUUNTO_VYPER, 0x04},
-	{"Suunto", "D3",       DC_FAMILY_SUUNTO_VYPER, 0x05},
-	{"Suunto", "Vyper",    DC_FAMILY_SUUNTO_VYPER, 0x0A},
-	{"Suunto", "Vytec",    DC_FAMILY_SUUNTO_VYPER, 0X0B},
-	{"Suunto", "Cobra",    DC_FAMILY_SUUNTO_VYPER, 0X0C},
-	{"Suunto", "Gekko",    DC_FAMILY_SUUNTO_VYPER, 0X0D},
-	{"Suunto", "Zoop",     DC_FAMILY_SUUNTO_VYPER, 0x16},
-	/* Suunto Vyper 2 */
-	{"Suunto", "Vyper 2",   DC_FAMILY_SUUNTO_VYPER2, 0x10},
-	{"Suunto", "Cobra 2",   DC_FAMILY_SUUNTO_VYPER2, 0x11},
-	{"Suunto", "Vyper Air", DC_FAMILY_SUUNTO_VYPER2, 0x13},
-	{"Suunto", "Cobra 3",   DC_FAMILY_SUUNTO_VYPER2, 0x14},
-	{"Suunto", "HelO2",     DC_FAMILY_SUUNTO_VYPER2, 0x15},
-	/* Suunto D9 */
-	{"Suunto", "D9",   DC_FAMILY_SUUNTO_D9, 0x0E},
-	{"Suunto", "D6",   DC_FAMILY_SUUNTO_D9, 0x0F},
-	{"Suunto", "D4",   DC_FAMILY_SUUNTO_D9, 0x12},
-	{"Suunto", "D4i",  DC_FAMILY_SUUNTO_D9, 0x19},
-	{"Suunto", "D6i",  DC_FAMILY_SUUNTO_D9, 0x1A},
-	{"Suunto", "D9tx", DC_FAMILY_SUUNTO_D9, 0x1B},
-	{"Suunto", "DX",   DC_FAMILY_SUUNTO_D9, 0x1C},
-	{"Suunto", "Vyper Novo", DC_FAMILY_SUUNTO_D9, 0x1D},
-	{"Suunto", "Zoop Novo",  DC_FAMILY_SUUNTO_D9, 0x1E},
+/*
+ * The descriptor table is defined as an X-macro list, which is expanded
+ * twice: once to generate a single contiguous string table holding all
+ * the vendor and product names, and once to generate the descriptor
+ * entries themselves. The entries store offsets into the string table
+ * instead of pointers, which keeps the table free of relocations, so
+ * the dynamic loader can map it directly from the read-only data
+ * segment without patching it at load time.
+ */
+
+#ifdef ENABLE_SUUNTO
+#define DC_DESCRIPTORS_SUUNTO(ENTRY) \
+	/* Suunto Solution */ \
+	ENTRY (suunto_solution_0, "Suunto", "Solution", DC_FAMILY_SUUNTO_SOLUTION, 0) \
+	/* Suunto Eon */ \
+	ENTRY (suunto_eon_0, "Suunto", "Eon", DC_FAMILY_SUUNTO_EON, 0) \
+	ENTRY (suunto_solution_alpha_0, "Suunto", "Solution Alpha", DC_FAMILY_SUUNTO_EON, 0) \
+	ENTRY (suunto_solution_nitrox_0, "Suunto", "Solution Nitrox", DC_FAMILY_SUUNTO_EON, 0) \
+	/* Suunto Vyper */ \
+	ENTRY (suunto_spyder_0x01, "Suunto", "Spyder", DC_FAMILY_SUUNTO_VYPER, 0x01) \
+	ENTRY (suunto_stinger_0x03, "Suunto", "Stinger", DC_FAMILY_SUUNTO_VYPER, 0x03) \
+	ENTRY (suunto_mosquito_0x04, "Suunto", "Mosquito", DC_FAMILY_SUUNTO_VYPER, 0x04) \
+	ENTRY (suunto_d3_0x05, "Suunto", "D3", DC_FAMILY_SUUNTO_VYPER, 0x05) \
+	ENTRY (suunto_vyper_0x0a, "Suunto", "Vyper", DC_FAMILY_SUUNTO_VYPER, 0x0A) \
+	ENTRY (suunto_vytec_0x0b, "Suunto", "Vytec", DC_FAMILY_SUUNTO_VYPER, 0X0B) \
+	ENTRY (suunto_cobra_0x0c, "Suunto", "Cobra", DC_FAMILY_SUUNTO_VYPER, 0X0C) \
+	ENTRY (suunto_gekko_0x0d, "Suunto", "Gekko", DC_FAMILY_SUUNTO_VYPER, 0X0D) \
+	ENTRY (suunto_zoop_0x16, "Suunto", "Zoop", DC_FAMILY_SUUNTO_VYPER, 0x16) \
+	/* Suunto Vyper 2 */ \
+	ENTRY (suunto_vyper_2_0x10, "Suunto", "Vyper 2", DC_FAMILY_SUUNTO_VYPER2, 0x10) \
+	ENTRY (suunto_cobra_2_0x11, "Suunto", "Cobra 2", DC_FAMILY_SUUNTO_VYPER2, 0x11) \
+	ENTRY (suunto_vyper_air_0x13, "Suunto", "Vyper Air", DC_FAMILY_SUUNTO_VYPER2, 0x13) \
+	ENTRY (suunto_cobra_3_0x14, "Suunto", "Cobra 3", DC_FAMILY_SUUNTO_VYPER2, 0x14) \
+	ENTRY (suunto_helo2_0x15, "Suunto", "HelO2", DC_FAMILY_SUUNTO_VYPER2, 0x15) \
+	/* Suunto D9 */ \
+	ENTRY (suunto_d9_0x0e, "Suunto", "D9", DC_FAMILY_SUUNTO_D9, 0x0E) \
+	ENTRY (suunto_d6_0x0f, "Suunto", "D6", DC_FAMILY_SUUNTO_D9, 0x0F) \
+	ENTRY (suunto_d4_0x12, "Suunto", "D4", DC_FAMILY_SUUNTO_D9, 0x12) \
+	ENTRY (suunto_d4i_0x19, "Suunto", "D4i", DC_FAMILY_SUUNTO_D9, 0x19) \
+	ENTRY (suunto_d6i_0x1a, "Suunto", "D6i", DC_FAMILY_SUUNTO_D9, 0x1A) \
+	ENTRY (suunto_d9tx_0x1b, "Suunto", "D9tx", DC_FAMILY_SUUNTO_D9, 0x1B) \
+	ENTRY (suunto_dx_0x1c, "Suunto", "DX", DC_FAMILY_SUUNTO_D9, 0x1C) \
+	ENTRY (suunto_vyper_novo_0x1d, "Suunto", "Vyper Novo", DC_FAMILY_SUUNTO_D9, 0x1D) \
+	ENTRY (suunto_zoop_novo_0x1e, "Suunto", "Zoop Novo", DC_FAMILY_SUUNTO_D9, 0x1E) \
 	/* Suunto EON Steel */
-#ifdef USBHID
-	{"Suunto", "EON Steel", DC_FAMILY_SUUNTO_EONSTEEL, 0},
+#else
+#define DC_DESCRIPTORS_SUUNTO(ENTRY)
+#endif
+
+#if defined(ENABLE_SUUNTO) && defined(USBHID)
+#define DC_DESCRIPTORS_SUUNTO_USBHID(ENTRY) \
+	ENTRY (suunto_eon_steel_0, "Suunto", "EON Steel", DC_FAMILY_SUUNTO_EONSTEEL, 0)
+#else
+#define DC_DESCRIPTORS_SUUNTO_USBHID(ENTRY)
 #endif
-	/* Uwatec Aladin */
-	{"Uwatec", "Aladin Air Twin",     DC_FAMILY_UWATEC_ALADIN, 0x1C},
-	{"Uwatec", "Aladin Sport Plus",   DC_FAMILY_UWATEC_ALADIN, 0x3E},
-	{"Uwatec", "Aladin Pro",          DC_FAMILY_UWATEC_ALADIN, 0x3F},
-	{"Uwatec", "Aladin Air Z",        DC_FAMILY_UWATEC_ALADIN, 0x44},
-	{"Uwatec", "Aladin Air Z O2",     DC_FAMILY_UWATEC_ALADIN, 0xA4},
-	{"Uwatec", "Aladin Air Z Nitrox", DC_FAMILY_UWATEC_ALADIN, 0xF4},
-	{"Uwatec", "Aladin Pro Ultra",    DC_FAMILY_UWATEC_ALADIN, 0xFF},
-	/* Uwatec Memomouse */
-	{"Uwatec", "Memomouse", DC_FAMILY_UWATEC_MEMOMOUSE, 0},
+
+#ifdef ENABLE_UWATEC
+#define DC_DESCRIPTORS_UWATEC(ENTRY) \
+	/* Uwatec Aladin */ \
+	ENTRY (uwatec_aladin_air_twin_0x1c, "Uwatec", "Aladin Air Twin", DC_FAMILY_UWATEC_ALADIN, 0x1C) \
+	ENTRY (uwatec_aladin_sport_plus_0x3e, "Uwatec", "Aladin Sport Plus", DC_FAMILY_UWATEC_ALADIN, 0x3E) \
+	ENTRY (uwatec_aladin_pro_0x3f, "Uwatec", "Aladin Pro", DC_FAMILY_UWATEC_ALADIN, 0x3F) \
+	ENTRY (uwatec_aladin_air_z_0x44, "Uwatec", "Aladin Air Z", DC_FAMILY_UWATEC_ALADIN, 0x44) \
+	ENTRY (uwatec_aladin_air_z_o2_0xa4, "Uwatec", "Aladin Air Z O2", DC_FAMILY_UWATEC_ALADIN, 0xA4) \
+	ENTRY (uwatec_aladin_air_z_nitrox_0xf4, "Uwatec", "Aladin Air Z Nitrox", DC_FAMILY_UWATEC_ALADIN, 0xF4) \
+	ENTRY (uwatec_aladin_pro_ultra_0xff, "Uwatec", "Aladin Pro Ultra", DC_FAMILY_UWATEC_ALADIN, 0xFF) \
+	/* Uwatec Memomouse */ \
+	ENTRY (uwatec_memomouse_0, "Uwatec", "Memomouse", DC_FAMILY_UWATEC_MEMOMOUSE, 0) \
 	/* Uwatec Smart */
-#ifdef HAVE_IRDA
-	{"Uwatec", "Smart Pro",     DC_FAMILY_UWATEC_SMART, 0x10},
-	{"Uwatec", "Galileo Sol",   DC_FAMILY_UWATEC_SMART, 0x11},
-	{"Uwatec", "Galileo Luna",  DC_FAMILY_UWATEC_SMART, 0x11},
-	{"Uwatec", "Galileo Terra", DC_FAMILY_UWATEC_SMART, 0x11},
-	{"Uwatec", "Aladin Tec",    DC_FAMILY_UWATEC_SMART, 0x12},
-	{"Uwatec", "Aladin Prime",  DC_FAMILY_UWATEC_SMART, 0x12},
-	{"Uwatec", "Aladin Tec 2G", DC_FAMILY_UWATEC_SMART, 0x13},
-	{"Uwatec", "Aladin 2G",     DC_FAMILY_UWATEC_SMART, 0x13},
-	{"Subgear","XP-10",         DC_FAMILY_UWATEC_SMART, 0x13},
-	{"Uwatec", "Smart Com",     DC_FAMILY_UWATEC_SMART, 0x14},
-	{"Uwatec", "Aladin 2G",     DC_FAMILY_UWATEC_SMART, 0x15},
-	{"Uwatec", "Aladin Sport",  DC_FAMILY_UWATEC_SMART, 0x15},
-	{"Subgear","XP-3G",         DC_FAMILY_UWATEC_SMART, 0x15},
-	{"Uwatec", "Smart Tec",     DC_FAMILY_UWATEC_SMART, 0x18},
-	{"Uwatec", "Galileo Trimix",DC_FAMILY_UWATEC_SMART, 0x19},
-	{"Uwatec", "Smart Z",       DC_FAMILY_UWATEC_SMART, 0x1C},
-	{"Subgear","XP Air",        DC_FAMILY_UWATEC_SMART, 0x1C},
+#else
+#define DC_DESCRIPTORS_UWATEC(ENTRY)
+#endif
+
+#if defined(ENABLE_UWATEC) && defined(HAVE_IRDA)
+#define DC_DESCRIPTORS_UWATEC_IRDA(ENTRY) \
+	ENTRY (uwatec_smart_pro_0x10, "Uwatec", "Smart Pro", DC_FAMILY_UWATEC_SMART, 0x10) \
+	ENTRY (uwatec_galileo_sol_0x11, "Uwatec", "Galileo Sol", DC_FAMILY_UWATEC_SMART, 0x11) \
+	ENTRY (uwatec_galileo_luna_0x11, "Uwatec", "Galileo Luna", DC_FAMILY_UWATEC_SMART, 0x11) \
+	ENTRY (uwatec_galileo_terra_0x11, "Uwatec", "Galileo Terra", DC_FAMILY_UWATEC_SMART, 0x11) \
+	ENTRY (uwatec_aladin_tec_0x12, "Uwatec", "Aladin Tec", DC_FAMILY_UWATEC_SMART, 0x12) \
+	ENTRY (uwatec_aladin_prime_0x12, "Uwatec", "Aladin Prime", DC_FAMILY_UWATEC_SMART, 0x12) \
+	ENTRY (uwatec_aladin_tec_2g_0x13, "Uwatec", "Aladin Tec 2G", DC_FAMILY_UWATEC_SMART, 0x13) \
+	ENTRY (uwatec_aladin_2g_0x13, "Uwatec", "Aladin 2G", DC_FAMILY_UWATEC_SMART, 0x13) \
+	ENTRY (subgear_xp_10_0x13, "Subgear", "XP-10", DC_FAMILY_UWATEC_SMART, 0x13) \
+	ENTRY (uwatec_smart_com_0x14, "Uwatec", "Smart Com", DC_FAMILY_UWATEC_SMART, 0x14) \
+	ENTRY (uwatec_aladin_2g_0x15, "Uwatec", "Aladin 2G", DC_FAMILY_UWATEC_SMART, 0x15) \
+	ENTRY (uwatec_aladin_sport_0x15, "Uwatec", "Aladin Sport", DC_FAMILY_UWATEC_SMART, 0x15) \
+	ENTRY (subgear_xp_3g_0x15, "Subgear", "XP-3G", DC_FAMILY_UWATEC_SMART, 0x15) \
+	ENTRY (uwatec_smart_tec_0x18, "Uwatec", "Smart Tec", DC_FAMILY_UWATEC_SMART, 0x18) \
+	ENTRY (uwatec_galileo_trimix_0x19, "Uwatec", "Galileo Trimix", DC_FAMILY_UWATEC_SMART, 0x19) \
+	ENTRY (uwatec_smart_z_0x1c, "Uwatec", "Smart Z", DC_FAMILY_UWATEC_SMART, 0x1C) \
+	ENTRY (subgear_xp_air_0x1c, "Subgear", "XP Air", DC_FAMILY_UWATEC_SMART, 0x1C)
+#else
+#define DC_DESCRIPTORS_UWATEC_IRDA(ENTRY)
+#endif
+
+#ifdef ENABLE_UWATEC
+#define DC_DESCRIPTORS_UWATEC_2(ENTRY) \
+	/* Scubapro/Uwatec Meridian */ \
+	ENTRY (scubapro_meridian_0x20, "Scubapro", "Meridian", DC_FAMILY_UWATEC_MERIDIAN, 0x20) \
+	ENTRY (scubapro_mantis_0x20, "Scubapro", "Mantis", DC_FAMILY_UWATEC_MERIDIAN, 0x20) \
+	ENTRY (scubapro_chromis_0x24, "Scubapro", "Chromis", DC_FAMILY_UWATEC_MERIDIAN, 0x24) \
+	ENTRY (scubapro_mantis_2_0x26, "Scubapro", "Mantis 2", DC_FAMILY_UWATEC_MERIDIAN, 0x26)
+#else
+#define DC_DESCRIPTORS_UWATEC_2(ENTRY)
+#endif
+
+#ifdef ENABLE_REEFNET
+#define DC_DESCRIPTORS_REEFNET(ENTRY) \
+	/* Reefnet */ \
+	ENTRY (reefnet_sensus_1, "Reefnet", "Sensus", DC_FAMILY_REEFNET_SENSUS, 1) \
+	ENTRY (reefnet_sensus_pro_2, "Reefnet", "Sensus Pro", DC_FAMILY_REEFNET_SENSUSPRO, 2) \
+	ENTRY (reefnet_sensus_ultra_3, "Reefnet", "Sensus Ultra", DC_FAMILY_REEFNET_SENSUSULTRA, 3)
+#else
+#define DC_DESCRIPTORS_REEFNET(ENTRY)
+#endif
+
+#ifdef ENABLE_OCEANIC
+#define DC_DESCRIPTORS_OCEANIC(ENTRY) \
+	/* Oceanic VT Pro */ \
+	ENTRY (aeris_500_ai_0x4151, "Aeris", "500 AI", DC_FAMILY_OCEANIC_VTPRO, 0x4151) \
+	ENTRY (oceanic_versa_pro_0x4155, "Oceanic", "Versa Pro", DC_FAMILY_OCEANIC_VTPRO, 0x4155) \
+	ENTRY (aeris_atmos_2_0x4158, "Aeris", "Atmos 2", DC_FAMILY_OCEANIC_VTPRO, 0x4158) \
+	ENTRY (oceanic_pro_plus_2_0x4159, "Oceanic", "Pro Plus 2", DC_FAMILY_OCEANIC_VTPRO, 0x4159) \
+	ENTRY (aeris_atmos_ai_0x4244, "Aeris", "Atmos AI", DC_FAMILY_OCEANIC_VTPRO, 0x4244) \
+	ENTRY (oceanic_vt_pro_0x4245, "Oceanic", "VT Pro", DC_FAMILY_OCEANIC_VTPRO, 0x4245) \
+	ENTRY (sherwood_wisdom_0x4246, "Sherwood", "Wisdom", DC_FAMILY_OCEANIC_VTPRO, 0x4246) \
+	ENTRY (aeris_elite_0x424f, "Aeris", "Elite", DC_FAMILY_OCEANIC_VTPRO, 0x424F) \
+	/* Oceanic Veo 250 */ \
+	ENTRY (genesis_react_pro_0x4247, "Genesis", "React Pro", DC_FAMILY_OCEANIC_VEO250, 0x4247) \
+	ENTRY (oceanic_veo_200_0x424b, "Oceanic", "Veo 200", DC_FAMILY_OCEANIC_VEO250, 0x424B) \
+	ENTRY (oceanic_veo_250_0x424c, "Oceanic", "Veo 250", DC_FAMILY_OCEANIC_VEO250, 0x424C) \
+	ENTRY (seemann_xp5_0x4251, "Seemann", "XP5", DC_FAMILY_OCEANIC_VEO250, 0x4251) \
+	ENTRY (oceanic_veo_180_0x4252, "Oceanic", "Veo 180", DC_FAMILY_OCEANIC_VEO250, 0x4252) \
+	ENTRY (aeris_xr_2_0x4255, "Aeris", "XR-2", DC_FAMILY_OCEANIC_VEO250, 0x4255) \
+	ENTRY (sherwood_insight_0x425a, "Sherwood", "Insight", DC_FAMILY_OCEANIC_VEO250, 0x425A) \
+	ENTRY (hollis_dg02_0x4352, "Hollis", "DG02", DC_FAMILY_OCEANIC_VEO250, 0x4352) \
+	/* Oceanic Atom 2.0 */ \
+	ENTRY (oceanic_atom_1_0_0x4250, "Oceanic", "Atom 1.0", DC_FAMILY_OCEANIC_ATOM2, 0x4250) \
+	ENTRY (aeris_epic_0x4257, "Aeris", "Epic", DC_FAMILY_OCEANIC_ATOM2, 0x4257) \
+	ENTRY (oceanic_vt3_0x4258, "Oceanic", "VT3", DC_FAMILY_OCEANIC_ATOM2, 0x4258) \
+	ENTRY (aeris_elite_t3_0x4259, "Aeris", "Elite T3", DC_FAMILY_OCEANIC_ATOM2, 0x4259) \
+	ENTRY (oceanic_atom_2_0_0x4342, "Oceanic", "Atom 2.0", DC_FAMILY_OCEANIC_ATOM2, 0x4342) \
+	ENTRY (oceanic_geo_0x4344, "Oceanic", "Geo", DC_FAMILY_OCEANIC_ATOM2, 0x4344) \
+	ENTRY (aeris_manta_0x4345, "Aeris", "Manta", DC_FAMILY_OCEANIC_ATOM2, 0x4345) \
+	ENTRY (aeris_xr_1_nx_0x4346, "Aeris", "XR-1 NX", DC_FAMILY_OCEANIC_ATOM2, 0x4346) \
+	ENTRY (oceanic_datamask_0x4347, "Oceanic", "Datamask", DC_FAMILY_OCEANIC_ATOM2, 0x4347) \
+	ENTRY (aeris_compumask_0x4348, "Aeris", "Compumask", DC_FAMILY_OCEANIC_ATOM2, 0x4348) \
+	ENTRY (aeris_f10_0x434d, "Aeris", "F10", DC_FAMILY_OCEANIC_ATOM2, 0x434D) \
+	ENTRY (oceanic_oc1_0x434e, "Oceanic", "OC1", DC_FAMILY_OCEANIC_ATOM2, 0x434E) \
+	ENTRY (sherwood_wisdom_2_0x4350, "Sherwood", "Wisdom 2", DC_FAMILY_OCEANIC_ATOM2, 0x4350) \
+	ENTRY (sherwood_insight_2_0x4353, "Sherwood", "Insight 2", DC_FAMILY_OCEANIC_ATOM2, 0x4353) \
+	ENTRY (genesis_react_pro_white_0x4354, "Genesis", "React Pro White", DC_FAMILY_OCEANIC_ATOM2, 0x4354) \
+	ENTRY (tusa_element_ii_iq_750_0x4357, "Tusa", "Element II (IQ-750)", DC_FAMILY_OCEANIC_ATOM2, 0x4357) \
+	ENTRY (oceanic_veo_1_0_0x4358, "Oceanic", "Veo 1.0", DC_FAMILY_OCEANIC_ATOM2, 0x4358) \
+	ENTRY (oceanic_veo_2_0_0x4359, "Oceanic", "Veo 2.0", DC_FAMILY_OCEANIC_ATOM2, 0x4359) \
+	ENTRY (oceanic_veo_3_0_0x435a, "Oceanic", "Veo 3.0", DC_FAMILY_OCEANIC_ATOM2, 0x435A) \
+	ENTRY (tusa_zen_iq_900_0x4441, "Tusa", "Zen (IQ-900)", DC_FAMILY_OCEANIC_ATOM2, 0x4441) \
+	ENTRY (tusa_zen_air_iq_950_0x4442, "Tusa", "Zen Air (IQ-950)", DC_FAMILY_OCEANIC_ATOM2, 0x4442) \
+	ENTRY (aeris_atmos_ai_2_0x4443, "Aeris", "Atmos AI 2", DC_FAMILY_OCEANIC_ATOM2, 0x4443) \
+	ENTRY (oceanic_pro_plus_2_1_0x4444, "Oceanic", "Pro Plus 2.1", DC_FAMILY_OCEANIC_ATOM2, 0x4444) \
+	ENTRY (oceanic_geo_2_0_0x4446, "Oceanic", "Geo 2.0", DC_FAMILY_OCEANIC_ATOM2, 0x4446) \
+	ENTRY (oceanic_vt4_0x4447, "Oceanic", "VT4", DC_FAMILY_OCEANIC_ATOM2, 0x4447) \
+	ENTRY (oceanic_oc1_0x4449, "Oceanic", "OC1", DC_FAMILY_OCEANIC_ATOM2, 0x4449) \
+	ENTRY (beuchat_voyager_2g_0x444b, "Beuchat", "Voyager 2G", DC_FAMILY_OCEANIC_ATOM2, 0x444B) \
+	ENTRY (oceanic_atom_3_0_0x444c, "Oceanic", "Atom 3.0", DC_FAMILY_OCEANIC_ATOM2, 0x444C) \
+	ENTRY (hollis_dg03_0x444d, "Hollis", "DG03", DC_FAMILY_OCEANIC_ATOM2, 0x444D) \
+	ENTRY (oceanic_ocs_0x4450, "Oceanic", "OCS", DC_FAMILY_OCEANIC_ATOM2, 0x4450) \
+	ENTRY (oceanic_oc1_0x4451, "Oceanic", "OC1", DC_FAMILY_OCEANIC_ATOM2, 0x4451) \
+	ENTRY (oceanic_vt_4_1_0x4452, "Oceanic", "VT 4.1", DC_FAMILY_OCEANIC_ATOM2, 0x4452) \
+	ENTRY (aeris_epic_0x4453, "Aeris", "Epic", DC_FAMILY_OCEANIC_ATOM2, 0x4453) \
+	ENTRY (aeris_elite_t3_0x4455, "Aeris", "Elite T3", DC_FAMILY_OCEANIC_ATOM2, 0x4455) \
+	ENTRY (oceanic_atom_3_1_0x4456, "Oceanic", "Atom 3.1", DC_FAMILY_OCEANIC_ATOM2, 0x4456) \
+	ENTRY (aeris_a300_ai_0x4457, "Aeris", "A300 AI", DC_FAMILY_OCEANIC_ATOM2, 0x4457) \
+	ENTRY (sherwood_wisdom_3_0x4458, "Sherwood", "Wisdom 3", DC_FAMILY_OCEANIC_ATOM2, 0x4458) \
+	ENTRY (aeris_a300_0x445a, "Aeris", "A300", DC_FAMILY_OCEANIC_ATOM2, 0x445A) \
+	ENTRY (hollis_tx1_0x4542, "Hollis", "TX1", DC_FAMILY_OCEANIC_ATOM2, 0x4542) \
+	ENTRY (beuchat_mundial_2_0x4543, "Beuchat", "Mundial 2", DC_FAMILY_OCEANIC_ATOM2, 0x4543) \
+	ENTRY (sherwood_amphos_0x4545, "Sherwood", "Amphos", DC_FAMILY_OCEANIC_ATOM2, 0x4545) \
+	ENTRY (sherwood_amphos_air_0x4546, "Sherwood", "Amphos Air", DC_FAMILY_OCEANIC_ATOM2, 0x4546) \
+	ENTRY (oceanic_pro_plus_3_0x4548, "Oceanic", "Pro Plus 3", DC_FAMILY_OCEANIC_ATOM2, 0x4548) \
+	ENTRY (aeris_f11_0x4549, "Aeris", "F11", DC_FAMILY_OCEANIC_ATOM2, 0x4549) \
+	ENTRY (oceanic_oci_0x454b, "Oceanic", "OCi", DC_FAMILY_OCEANIC_ATOM2, 0x454B) \
+	ENTRY (aeris_a300cs_0x454c, "Aeris", "A300CS", DC_FAMILY_OCEANIC_ATOM2, 0x454C) \
+	ENTRY (beuchat_mundial_3_0x4550, "Beuchat", "Mundial 3", DC_FAMILY_OCEANIC_ATOM2, 0x4550) \
+	ENTRY (oceanic_f10_0x4553, "Oceanic", "F10", DC_FAMILY_OCEANIC_ATOM2, 0x4553) \
+	ENTRY (oceanic_f11_0x4554, "Oceanic", "F11", DC_FAMILY_OCEANIC_ATOM2, 0x4554) \
+	ENTRY (subgear_xp_air_0x4555, "Subgear", "XP-Air", DC_FAMILY_OCEANIC_ATOM2, 0x4555) \
+	ENTRY (sherwood_vision_0x4556, "Sherwood", "Vision", DC_FAMILY_OCEANIC_ATOM2, 0x4556) \
+	ENTRY (oceanic_vtx_0x4557, "Oceanic", "VTX", DC_FAMILY_OCEANIC_ATOM2, 0x4557) \
+	ENTRY (aqualung_i300_0x4559, "Aqualung", "i300", DC_FAMILY_OCEANIC_ATOM2, 0x4559) \
+	ENTRY (aqualung_i750tc_0x455a, "Aqualung", "i750TC", DC_FAMILY_OCEANIC_ATOM2, 0x455A) \
+	ENTRY (aqualung_i450t_0x4641, "Aqualung", "i450T", DC_FAMILY_OCEANIC_ATOM2, 0x4641) \
+	ENTRY (aqualung_i550_0x4642, "Aqualung", "i550", DC_FAMILY_OCEANIC_ATOM2, 0x4642)
+#else
+#define DC_DESCRIPTORS_OCEANIC(ENTRY)
+#endif
+
+#ifdef ENABLE_MARES
+#define DC_DESCRIPTORS_MARES(ENTRY) \
+	/* Mares Nemo */ \
+	ENTRY (mares_nemo_0, "Mares", "Nemo", DC_FAMILY_MARES_NEMO, 0) \
+	ENTRY (mares_nemo_steel_0, "Mares", "Nemo Steel", DC_FAMILY_MARES_NEMO, 0) \
+	ENTRY (mares_nemo_titanium_0, "Mares", "Nemo Titanium", DC_FAMILY_MARES_NEMO, 0) \
+	ENTRY (mares_nemo_excel_17, "Mares", "Nemo Excel", DC_FAMILY_MARES_NEMO, 17) \
+	ENTRY (mares_nemo_apneist_18, "Mares", "Nemo Apneist", DC_FAMILY_MARES_NEMO, 18) \
+	/* Mares Puck */ \
+	ENTRY (mares_puck_7, "Mares", "Puck", DC_FAMILY_MARES_PUCK, 7) \
+	ENTRY (mares_puck_air_19, "Mares", "Puck Air", DC_FAMILY_MARES_PUCK, 19) \
+	ENTRY (mares_nemo_air_4, "Mares", "Nemo Air", DC_FAMILY_MARES_PUCK, 4) \
+	ENTRY (mares_nemo_wide_1, "Mares", "Nemo Wide", DC_FAMILY_MARES_PUCK, 1) \
+	/* Mares Darwin */ \
+	ENTRY (mares_darwin_0, "Mares", "Darwin", DC_FAMILY_MARES_DARWIN, 0) \
+	ENTRY (mares_m1_0, "Mares", "M1", DC_FAMILY_MARES_DARWIN, 0) \
+	ENTRY (mares_m2_0, "Mares", "M2", DC_FAMILY_MARES_DARWIN, 0) \
+	ENTRY (mares_darwin_air_1, "Mares", "Darwin Air", DC_FAMILY_MARES_DARWIN, 1) \
+	ENTRY (mares_airlab_1, "Mares", "Airlab", DC_FAMILY_MARES_DARWIN, 1) \
+	/* Mares Icon HD */ \
+	ENTRY (mares_matrix_0x0f, "Mares", "Matrix", DC_FAMILY_MARES_ICONHD, 0x0F) \
+	ENTRY (mares_smart_0x000010, "Mares", "Smart", DC_FAMILY_MARES_ICONHD, 0x000010) \
+	ENTRY (mares_smart_apnea_0x010010, "Mares", "Smart Apnea", DC_FAMILY_MARES_ICONHD, 0x010010) \
+	ENTRY (mares_icon_hd_0x14, "Mares", "Icon HD", DC_FAMILY_MARES_ICONHD, 0x14) \
+	ENTRY (mares_icon_hd_net_ready_0x15, "Mares", "Icon HD Net Ready", DC_FAMILY_MARES_ICONHD, 0x15) \
+	ENTRY (mares_puck_pro_0x18, "Mares", "Puck Pro", DC_FAMILY_MARES_ICONHD, 0x18) \
+	ENTRY (mares_nemo_wide_2_0x19, "Mares", "Nemo Wide 2", DC_FAMILY_MARES_ICONHD, 0x19) \
+	ENTRY (mares_puck_2_0x1f, "Mares", "Puck 2", DC_FAMILY_MARES_ICONHD, 0x1F)
+#else
+#define DC_DESCRIPTORS_MARES(ENTRY)
+#endif
+
+#ifdef ENABLE_HW
+#define DC_DESCRIPTORS_HW(ENTRY) \
+	/* Heinrichs Weikamp */ \
+	ENTRY (heinrichs_weikamp_ostc_0, "Heinrichs Weikamp", "OSTC", DC_FAMILY_HW_OSTC, 0) \
+	ENTRY (heinrichs_weikamp_ostc_mk2_1, "Heinrichs Weikamp", "OSTC Mk2", DC_FAMILY_HW_OSTC, 1) \
+	ENTRY (heinrichs_weikamp_ostc_2n_2, "Heinrichs Weikamp", "OSTC 2N", DC_FAMILY_HW_OSTC, 2) \
+	ENTRY (heinrichs_weikamp_ostc_2c_3, "Heinrichs Weikamp", "OSTC 2C", DC_FAMILY_HW_OSTC, 3) \
+	ENTRY (heinrichs_weikamp_frog_0, "Heinrichs Weikamp", "Frog", DC_FAMILY_HW_FROG, 0) \
+	ENTRY (heinrichs_weikamp_ostc_2_0x11, "Heinrichs Weikamp", "OSTC 2", DC_FAMILY_HW_OSTC3, 0x11) \
+	ENTRY (heinrichs_weikamp_ostc_2_0x13, "Heinrichs Weikamp", "OSTC 2", DC_FAMILY_HW_OSTC3, 0x13) \
+	ENTRY (heinrichs_weikamp_ostc_2_0x1b, "Heinrichs Weikamp", "OSTC 2", DC_FAMILY_HW_OSTC3, 0x1B) \
+	ENTRY (heinrichs_weikamp_ostc_3_0x0a, "Heinrichs Weikamp", "OSTC 3", DC_FAMILY_HW_OSTC3, 0x0A) \
+	ENTRY (heinrichs_weikamp_ostc_3_0x13, "Heinrichs Weikamp", "OSTC 3+", DC_FAMILY_HW_OSTC3, 0x13) \
+	ENTRY (heinrichs_weikamp_ostc_3_0x1a, "Heinrichs Weikamp", "OSTC 3+", DC_FAMILY_HW_OSTC3, 0x1A) \
+	ENTRY (heinrichs_weikamp_ostc_4_0x3b, "Heinrichs Weikamp", "OSTC 4", DC_FAMILY_HW_OSTC3, 0x3B) \
+	ENTRY (heinrichs_weikamp_ostc_cr_0x05, "Heinrichs Weikamp", "OSTC cR", DC_FAMILY_HW_OSTC3, 0x05) \
+	ENTRY (heinrichs_weikamp_ostc_cr_0x07, "Heinrichs Weikamp", "OSTC cR", DC_FAMILY_HW_OSTC3, 0x07) \
+	ENTRY (heinrichs_weikamp_ostc_sport_0x12, "Heinrichs Weikamp", "OSTC Sport", DC_FAMILY_HW_OSTC3, 0x12) \
+	ENTRY (heinrichs_weikamp_ostc_sport_0x13, "Heinrichs Weikamp", "OSTC Sport", DC_FAMILY_HW_OSTC3, 0x13)
+#else
+#define DC_DESCRIPTORS_HW(ENTRY)
+#endif
+
+#ifdef ENABLE_CRESSI
+#define DC_DESCRIPTORS_CRESSI(ENTRY) \
+	/* Cressi Edy */ \
+	ENTRY (tusa_iq_700_0x05, "Tusa", "IQ-700", DC_FAMILY_CRESSI_EDY, 0x05) \
+	ENTRY (cressi_edy_0x08, "Cressi", "Edy", DC_FAMILY_CRESSI_EDY, 0x08) \
+	/* Cressi Leonardo */ \
+	ENTRY (cressi_leonardo_1, "Cressi", "Leonardo", DC_FAMILY_CRESSI_LEONARDO, 1) \
+	ENTRY (cressi_giotto_4, "Cressi", "Giotto", DC_FAMILY_CRESSI_LEONARDO, 4) \
+	ENTRY (cressi_newton_5, "Cressi", "Newton", DC_FAMILY_CRESSI_LEONARDO, 5) \
+	ENTRY (cressi_drake_6, "Cressi", "Drake", DC_FAMILY_CRESSI_LEONARDO, 6)
+#else
+#define DC_DESCRIPTORS_CRESSI(ENTRY)
+#endif
+
+#ifdef ENABLE_ZEAGLE
+#define DC_DESCRIPTORS_ZEAGLE(ENTRY) \
+	/* Zeagle N2iTiON3 */ \
+	ENTRY (zeagle_n2ition3_0, "Zeagle", "N2iTiON3", DC_FAMILY_ZEAGLE_N2ITION3, 0) \
+	ENTRY (apeks_quantum_x_0, "Apeks", "Quantum X", DC_FAMILY_ZEAGLE_N2ITION3, 0) \
+	ENTRY (dive_rite_nitek_trio_0, "Dive Rite", "NiTek Trio", DC_FAMILY_ZEAGLE_N2ITION3, 0) \
+	ENTRY (scubapro_xtender_5_0, "Scubapro", "XTender 5", DC_FAMILY_ZEAGLE_N2ITION3, 0)
+#else
+#define DC_DESCRIPTORS_ZEAGLE(ENTRY)
 #endif
-	/* Scubapro/Uwatec Meridian */
-	{"Scubapro", "Meridian",    DC_FAMILY_UWATEC_MERIDIAN, 0x20},
-	{"Scubapro", "Mantis",      DC_FAMILY_UWATEC_MERIDIAN, 0x20},
-	{"Scubapro", "Chromis",     DC_FAMILY_UWATEC_MERIDIAN, 0x24},
-	{"Scubapro", "Mantis 2",    DC_FAMILY_UWATEC_MERIDIAN, 0x26},
-	/* Reefnet */
-	{"Reefnet", "Sensus",       DC_FAMILY_REEFNET_SENSUS, 1},
-	{"Reefnet", "Sensus Pro",   DC_FAMILY_REEFNET_SENSUSPRO, 2},
-	{"Reefnet", "Sensus Ultra", DC_FAMILY_REEFNET_SENSUSULTRA, 3},
-	/* Oceanic VT Pro */
-	{"Aeris",    "500 AI",     DC_FAMILY_OCEANIC_VTPRO, 0x4151},
-	{"Oceanic",  "Versa Pro",  DC_FAMILY_OCEANIC_VTPRO, 0x4155},
-	{"Aeris",    "Atmos 2",    DC_FAMILY_OCEANIC_VTPRO, 0x4158},
-	{"Oceanic",  "Pro Plus 2", DC_FAMILY_OCEANIC_VTPRO, 0x4159},
-	{"Aeris",    "Atmos AI",   DC_FAMILY_OCEANIC_VTPRO, 0x4244},
-	{"Oceanic",  "VT Pro",     DC_FAMILY_OCEANIC_VTPRO, 0x4245},
-	{"Sherwood", "Wisdom",     DC_FAMILY_OCEANIC_VTPRO, 0x4246},
-	{"Aeris",    "Elite",      DC_FAMILY_OCEANIC_VTPRO, 0x424F},
-	/* Oceanic Veo 250 */
-	{"Genesis", "React Pro", DC_FAMILY_OCEANIC_VEO250, 0x4247},
-	{"Oceanic", "Veo 200",   DC_FAMILY_OCEANIC_VEO250, 0x424B},
-	{"Oceanic", "Veo 250",   DC_FAMILY_OCEANIC_VEO250, 0x424C},
-	{"Seemann", "XP5",       DC_FAMILY_OCEANIC_VEO250, 0x4251},
-	{"Oceanic", "Veo 180",   DC_FAMILY_OCEANIC_VEO250, 0x4252},
-	{"Aeris",   "XR-2",      DC_FAMILY_OCEANIC_VEO250, 0x4255},
-	{"Sherwood", "Insight",  DC_FAMILY_OCEANIC_VEO250, 0x425A},
-	{"Hollis",  "DG02",      DC_FAMILY_OCEANIC_VEO250, 0x4352},
-	/* Oceanic Atom 2.0 */
-	{"Oceanic",  "Atom 1.0",            DC_FAMILY_OCEANIC_ATOM2, 0x4250},
-	{"Aeris",    "Epic",                DC_FAMILY_OCEANIC_ATOM2, 0x4257},
-	{"Oceanic",  "VT3",                 DC_FAMILY_OCEANIC_ATOM2, 0x4258},
-	{"Aeris",    "Elite T3",            DC_FAMILY_OCEANIC_ATOM2, 0x4259},
-	{"Oceanic",  "Atom 2.0",            DC_FAMILY_OCEANIC_ATOM2, 0x4342},
-	{"Oceanic",  "Geo",                 DC_FAMILY_OCEANIC_ATOM2, 0x4344},
-	{"Aeris",    "Manta",               DC_FAMILY_OCEANIC_ATOM2, 0x4345},
-	{"Aeris",    "XR-1 NX",             DC_FAMILY_OCEANIC_ATOM2, 0x4346},
-	{"Oceanic",  "Datamask",            DC_FAMILY_OCEANIC_ATOM2, 0x4347},
-	{"Aeris",    "Compumask",           DC_FAMILY_OCEANIC_ATOM2, 0x4348},
-	{"Aeris",    "F10",                 DC_FAMILY_OCEANIC_ATOM2, 0x434D},
-	{"Oceanic",  "OC1",                 DC_FAMILY_OCEANIC_ATOM2, 0x434E},
-	{"Sherwood", "Wisdom 2",            DC_FAMILY_OCEANIC_ATOM2, 0x4350},
-	{"Sherwood", "Insight 2",           DC_FAMILY_OCEANIC_ATOM2, 0x4353},
-	{"Genesis",  "React Pro White",     DC_FAMILY_OCEANIC_ATOM2, 0x4354},
-	{"Tusa",     "Element II (IQ-750)", DC_FAMILY_OCEANIC_ATOM2, 0x4357},
-	{"Oceanic",  "Veo 1.0",             DC_FAMILY_OCEANIC_ATOM2, 0x4358},
-	{"Oceanic",  "Veo 2.0",             DC_FAMILY_OCEANIC_ATOM2, 0x4359},
-	{"Oceanic",  "Veo 3.0",             DC_FAMILY_OCEANIC_ATOM2, 0x435A},
-	{"Tusa",     "Zen (IQ-900)",        DC_FAMILY_OCEANIC_ATOM2, 0x4441},
-	{"Tusa",     "Zen Air (IQ-950)",    DC_FAMILY_OCEANIC_ATOM2, 0x4442},
-	{"Aeris",    "Atmos AI 2",          DC_FAMILY_OCEANIC_ATOM2, 0x4443},
-	{"Oceanic",  "Pro Plus 2.1",        DC_FAMILY_OCEANIC_ATOM2, 0x4444},
-	{"Oceanic",  "Geo 2.0",             DC_FAMILY_OCEANIC_ATOM2, 0x4446},
-	{"Oceanic",  "VT4",                 DC_FAMILY_OCEANIC_ATOM2, 0x4447},
-	{"Oceanic",  "OC1",                 DC_FAMILY_OCEANIC_ATOM2, 0x4449},
-	{"Beuchat",  "Voyager 2G",          DC_FAMILY_OCEANIC_ATOM2, 0x444B},
-	{"Oceanic",  "Atom 3.0",            DC_FAMILY_OCEANIC_ATOM2, 0x444C},
-	{"Hollis",   "DG03",                DC_FAMILY_OCEANIC_ATOM2, 0x444D},
-	{"Oceanic",  "OCS",                 DC_FAMILY_OCEANIC_ATOM2, 0x4450},
-	{"Oceanic",  "OC1",                 DC_FAMILY_OCEANIC_ATOM2, 0x4451},
-	{"Oceanic",  "VT 4.1",              DC_FAMILY_OCEANIC_ATOM2, 0x4452},
-	{"Aeris",    "Epic",                DC_FAMILY_OCEANIC_ATOM2, 0x4453},
-	{"Aeris",    "Elite T3",            DC_FAMILY_OCEANIC_ATOM2, 0x4455},
-	{"Oceanic",  "Atom 3.1",            DC_FAMILY_OCEANIC_ATOM2, 0x4456},
-	{"Aeris",    "A300 AI",             DC_FAMILY_OCEANIC_ATOM2, 0x4457},
-	{"Sherwood", "Wisdom 3",            DC_FAMILY_OCEANIC_ATOM2, 0x4458},
-	{"Aeris",    "A300",                DC_FAMILY_OCEANIC_ATOM2, 0x445A},
-	{"Hollis",   "TX1",                 DC_FAMILY_OCEANIC_ATOM2, 0x4542},
-	{"Beuchat",  "Mundial 2",           DC_FAMILY_OCEANIC_ATOM2, 0x4543},
-	{"Sherwood", "Amphos",              DC_FAMILY_OCEANIC_ATOM2, 0x4545},
-	{"Sherwood", "Amphos Air",          DC_FAMILY_OCEANIC_ATOM2, 0x4546},
-	{"Oceanic",  "Pro Plus 3",          DC_FAMILY_OCEANIC_ATOM2, 0x4548},
-	{"Aeris",    "F11",                 DC_FAMILY_OCEANIC_ATOM2, 0x4549},
-	{"Oceanic",  "OCi",                 DC_FAMILY_OCEANIC_ATOM2, 0x454B},
-	{"Aeris",    "A300CS",              DC_FAMILY_OCEANIC_ATOM2, 0x454C},
-	{"Beuchat",  "Mundial 3",           DC_FAMILY_OCEANIC_ATOM2, 0x4550},
-	{"Oceanic",  "F10",                 DC_FAMILY_OCEANIC_ATOM2, 0x4553},
-	{"Oceanic",  "F11",                 DC_FAMILY_OCEANIC_ATOM2, 0x4554},
-	{"Subgear",  "XP-Air",              DC_FAMILY_OCEANIC_ATOM2, 0x4555},
-	{"Sherwood", "Vision",              DC_FAMILY_OCEANIC_ATOM2, 0x4556},
-	{"Oceanic",  "VTX",                 DC_FAMILY_OCEANIC_ATOM2, 0x4557},
-	{"Aqualung", "i300",                DC_FAMILY_OCEANIC_ATOM2, 0x4559},
-	{"Aqualung", "i750TC",              DC_FAMILY_OCEANIC_ATOM2, 0x455A},
-	{"Aqualung", "i450T",               DC_FAMILY_OCEANIC_ATOM2, 0x4641},
-	{"Aqualung", "i550",                DC_FAMILY_OCEANIC_ATOM2, 0x4642},
-	/* Mares Nemo */
-	{"Mares", "Nemo",         DC_FAMILY_MARES_NEMO, 0},
-	{"Mares", "Nemo Steel",   DC_FAMILY_MARES_NEMO, 0},
-	{"Mares", "Nemo Titanium",DC_FAMILY_MARES_NEMO, 0},
-	{"Mares", "Nemo Excel",   DC_FAMILY_MARES_NEMO, 17},
-	{"Mares", "Nemo Apneist", DC_FAMILY_MARES_NEMO, 18},
-	/* Mares Puck */
-	{"Mares", "Puck",      DC_FAMILY_MARES_PUCK, 7},
-	{"Mares", "Puck Air",  DC_FAMILY_MARES_PUCK, 19},
-	{"Mares", "Nemo Air",  DC_FAMILY_MARES_PUCK, 4},
-	{"Mares", "Nemo Wide", DC_FAMILY_MARES_PUCK, 1},
-	/* Mares Darwin */
-	{"Mares", "Darwin",     DC_FAMILY_MARES_DARWIN , 0},
-	{"Mares", "M1",         DC_FAMILY_MARES_DARWIN , 0},
-	{"Mares", "M2",         DC_FAMILY_MARES_DARWIN , 0},
-	{"Mares", "Darwin Air", DC_FAMILY_MARES_DARWIN , 1},
-	{"Mares", "Airlab",     DC_FAMILY_MARES_DARWIN , 1},
-	/* Mares Icon HD */
-	{"Mares", "Matrix",            DC_FAMILY_MARES_ICONHD , 0x0F},
-	{"Mares", "Smart",             DC_FAMILY_MARES_ICONHD , 0x000010},
-	{"Mares", "Smart Apnea",       DC_FAMILY_MARES_ICONHD , 0x010010},
-	{"Mares", "Icon HD",           DC_FAMILY_MARES_ICONHD , 0x14},
-	{"Mares", "Icon HD Net Ready", DC_FAMILY_MARES_ICONHD , 0x15},
-	{"Mares", "Puck Pro",          DC_FAMILY_MARES_ICONHD , 0x18},
-	{"Mares", "Nemo Wide 2",       DC_FAMILY_MARES_ICONHD , 0x19},
-	{"Mares", "Puck 2",            DC_FAMILY_MARES_ICONHD , 0x1F},
-	/* Heinrichs Weikamp */
-	{"Heinrichs Weikamp", "OSTC",     DC_FAMILY_HW_OSTC, 0},
-	{"Heinrichs Weikamp", "OSTC Mk2", DC_FAMILY_HW_OSTC, 1},
-	{"Heinrichs Weikamp", "OSTC 2N",  DC_FAMILY_HW_OSTC, 2},
-	{"Heinrichs Weikamp", "OSTC 2C",  DC_FAMILY_HW_OSTC, 3},
-	{"Heinrichs Weikamp", "Frog",     DC_FAMILY_HW_FROG, 0},
-	{"Heinrichs Weikamp", "OSTC 2",     DC_FAMILY_HW_OSTC3, 0x11},
-	{"Heinrichs Weikamp", "OSTC 2",     DC_FAMILY_HW_OSTC3, 0x13},
-	{"Heinrichs Weikamp", "OSTC 2",     DC_FAMILY_HW_OSTC3, 0x1B},
-	{"Heinrichs Weikamp", "OSTC 3",     DC_FAMILY_HW_OSTC3, 0x0A},
-	{"Heinrichs Weikamp", "OSTC 3+",    DC_FAMILY_HW_OSTC3, 0x13},
-	{"Heinrichs Weikamp", "OSTC 3+",    DC_FAMILY_HW_OSTC3, 0x1A},
-	{"Heinrichs Weikamp", "OSTC 4",     DC_FAMILY_HW_OSTC3, 0x3B},
-	{"Heinrichs Weikamp", "OSTC cR",    DC_FAMILY_HW_OSTC3, 0x05},
-	{"Heinrichs Weikamp", "OSTC cR",    DC_FAMILY_HW_OSTC3, 0x07},
-	{"Heinrichs Weikamp", "OSTC Sport", DC_FAMILY_HW_OSTC3, 0x12},
-	{"Heinrichs Weikamp", "OSTC Sport", DC_FAMILY_HW_OSTC3, 0x13},
-	/* Cressi Edy */
-	{"Tusa",   "IQ-700", DC_FAMILY_CRESSI_EDY, 0x05},
-	{"Cressi", "Edy",    DC_FAMILY_CRESSI_EDY, 0x08},
-	/* Cressi Leonardo */
-	{"Cressi", "Leonardo", DC_FAMILY_CRESSI_LEONARDO, 1},
-	{"Cressi", "Giotto",   DC_FAMILY_CRESSI_LEONARDO, 4},
-	{"Cressi", "Newton",   DC_FAMILY_CRESSI_LEONARDO, 5},
-	{"Cressi", "Drake",    DC_FAMILY_CRESSI_LEONARDO, 6},
-	/* Zeagle N2iTiON3 */
-	{"Zeagle",   "N2iTiON3",   DC_FAMILY_ZEAGLE_N2ITION3, 0},
-	{"Apeks",    "Quantum X",  DC_FAMILY_ZEAGLE_N2ITION3, 0},
-	{"Dive Rite", "NiTek Trio", DC_FAMILY_ZEAGLE_N2ITION3, 0},
-	{"Scubapro", "XTender 5",  DC_FAMILY_ZEAGLE_N2ITION3, 0},
+
+#ifdef ENABLE_ATOMICS
+#define DC_DESCRIPTORS_ATOMICS(ENTRY) \
 	/* Atomic Aquatics Cobalt */
-#ifdef HAVE_LIBUSB
-	{"Atomic Aquatics", "Cobalt", DC_FAMILY_ATOMICS_COBALT, 0},
-	{"Atomic Aquatics", "Cobalt 2", DC_FAMILY_ATOMICS_COBALT, 2},
+#else
+#define DC_DESCRIPTORS_ATOMICS(ENTRY)
+#endif
+
+#if defined(ENABLE_ATOMICS) && defined(HAVE_LIBUSB)
+#define DC_DESCRIPTORS_ATOMICS_LIBUSB(ENTRY) \
+	ENTRY (atomic_aquatics_cobalt_0, "Atomic Aquatics", "Cobalt", DC_FAMILY_ATOMICS_COBALT, 0) \
+	ENTRY (atomic_aquatics_cobalt_2_2, "Atomic Aquatics", "Cobalt 2", DC_FAMILY_ATOMICS_COBALT, 2)
+#else
+#define DC_DESCRIPTORS_ATOMICS_LIBUSB(ENTRY)
+#endif
+
+#ifdef ENABLE_SHEARWATER
+#define DC_DESCRIPTORS_SHEARWATER(ENTRY) \
+	/* Shearwater Predator */ \
+	ENTRY (shearwater_predator_2, "Shearwater", "Predator", DC_FAMILY_SHEARWATER_PREDATOR, 2) \
+	/* Shearwater Petrel */ \
+	ENTRY (shearwater_petrel_3, "Shearwater", "Petrel", DC_FAMILY_SHEARWATER_PETREL, 3) \
+	ENTRY (shearwater_petrel_2_3, "Shearwater", "Petrel 2", DC_FAMILY_SHEARWATER_PETREL, 3) \
+	ENTRY (shearwater_nerd_3, "Shearwater", "Nerd", DC_FAMILY_SHEARWATER_PETREL, 3) \
+	ENTRY (shearwater_perdix_3, "Shearwater", "Perdix", DC_FAMILY_SHEARWATER_PETREL, 3)
+#else
+#define DC_DESCRIPTORS_SHEARWATER(ENTRY)
+#endif
+
+#ifdef ENABLE_DIVERITE
+#define DC_DESCRIPTORS_DIVERITE(ENTRY) \
+	/* Dive Rite NiTek Q */ \
+	ENTRY (dive_rite_nitek_q_0, "Dive Rite", "NiTek Q", DC_FAMILY_DIVERITE_NITEKQ, 0)
+#else
+#define DC_DESCRIPTORS_DIVERITE(ENTRY)
+#endif
+
+#ifdef ENABLE_CITIZEN
+#define DC_DESCRIPTORS_CITIZEN(ENTRY) \
+	/* Citizen Hyper Aqualand */ \
+	ENTRY (citizen_hyper_aqualand_0, "Citizen", "Hyper Aqualand", DC_FAMILY_CITIZEN_AQUALAND, 0)
+#else
+#define DC_DESCRIPTORS_CITIZEN(ENTRY)
 #endif
-	/* Shearwater Predator */
-	{"Shearwater", "Predator", DC_FAMILY_SHEARWATER_PREDATOR, 2},
-	/* Shearwater Petrel */
-	{"Shearwater", "Petrel",   DC_FAMILY_SHEARWATER_PETREL, 3},
-	{"Shearwater", "Petrel 2", DC_FAMILY_SHEARWATER_PETREL, 3},
-	{"Shearwater", "Nerd",     DC_FAMILY_SHEARWATER_PETREL, 3},
-	{"Shearwater", "Perdix",   DC_FAMILY_SHEARWATER_PETREL, 3},
-	/* Dive Rite NiTek Q */
-	{"Dive Rite", "NiTek Q",   DC_FAMILY_DIVERITE_NITEKQ, 0},
-	/* Citizen Hyper Aqualand */
-	{"Citizen", "Hyper Aqualand", DC_FAMILY_CITIZEN_AQUALAND, 0},
-	/* DiveSystem iDive */
-	{"DiveSystem", "Orca",          DC_FAMILY_DIVESYSTEM_IDIVE, 0x02},
-	{"DiveSystem", "iDive Pro",     DC_FAMILY_DIVESYSTEM_IDIVE, 0x03},
-	{"DiveSystem", "iDive DAN",     DC_FAMILY_DIVESYSTEM_IDIVE, 0x04},
-	{"DiveSystem", "iDive Tech",    DC_FAMILY_DIVESYSTEM_IDIVE, 0x05},
-	{"DiveSystem", "iDive Reb",     DC_FAMILY_DIVESYSTEM_IDIVE, 0x06},
-	{"DiveSystem", "iDive Stealth", DC_FAMILY_DIVESYSTEM_IDIVE, 0x07},
-	{"DiveSystem", "iDive Free",    DC_FAMILY_DIVESYSTEM_IDIVE, 0x08},
-	{"DiveSystem", "iDive Easy",    DC_FAMILY_DIVESYSTEM_IDIVE, 0x09},
-	{"DiveSystem", "iDive X3M",     DC_FAMILY_DIVESYSTEM_IDIVE, 0x0A},
-	{"DiveSystem", "iDive Deep",    DC_FAMILY_DIVESYSTEM_IDIVE, 0x0B},
-	{"DiveSystem", "iX3M Easy",     DC_FAMILY_DIVESYSTEM_IDIVE, 0x22},
-	{"DiveSystem", "iX3M Deep",     DC_FAMILY_DIVESYSTEM_IDIVE, 0x23},
-	{"DiveSystem", "iX3M Tec",      DC_FAMILY_DIVESYSTEM_IDIVE, 0x24},
-	{"DiveSystem", "iX3M Reb",      DC_FAMILY_DIVESYSTEM_IDIVE, 0x25},
-	{"Cochran", "Commander",	DC_FAMILY_COCHRAN_COMMANDER, 0},
-	{"Cochran", "EMC-14",		DC_FAMILY_COCHRAN_COMMANDER, 1},
-	{"Cochran", "EMC-16",		DC_FAMILY_COCHRAN_COMMANDER, 2},
-	{"Cochran", "EMC-20H",		DC_FAMILY_COCHRAN_COMMANDER, 3},
+
+#ifdef ENABLE_DIVESYSTEM
+#define DC_DESCRIPTORS_DIVESYSTEM(ENTRY) \
+	/* DiveSystem iDive */ \
+	ENTRY (divesystem_orca_0x02, "DiveSystem", "Orca", DC_FAMILY_DIVESYSTEM_IDIVE, 0x02) \
+	ENTRY (divesystem_idive_pro_0x03, "DiveSystem", "iDive Pro", DC_FAMILY_DIVESYSTEM_IDIVE, 0x03) \
+	ENTRY (divesystem_idive_dan_0x04, "DiveSystem", "iDive DAN", DC_FAMILY_DIVESYSTEM_IDIVE, 0x04) \
+	ENTRY (divesystem_idive_tech_0x05, "DiveSystem", "iDive Tech", DC_FAMILY_DIVESYSTEM_IDIVE, 0x05) \
+	ENTRY (divesystem_idive_reb_0x06, "DiveSystem", "iDive Reb", DC_FAMILY_DIVESYSTEM_IDIVE, 0x06) \
+	ENTRY (divesystem_idive_stealth_0x07, "DiveSystem", "iDive Stealth", DC_FAMILY_DIVESYSTEM_IDIVE, 0x07) \
+	ENTRY (divesystem_idive_free_0x08, "DiveSystem", "iDive Free", DC_FAMILY_DIVESYSTEM_IDIVE, 0x08) \
+	ENTRY (divesystem_idive_easy_0x09, "DiveSystem", "iDive Easy", DC_FAMILY_DIVESYSTEM_IDIVE, 0x09) \
+	ENTRY (divesystem_idive_x3m_0x0a, "DiveSystem", "iDive X3M", DC_FAMILY_DIVESYSTEM_IDIVE, 0x0A) \
+	ENTRY (divesystem_idive_deep_0x0b, "DiveSystem", "iDive Deep", DC_FAMILY_DIVESYSTEM_IDIVE, 0x0B) \
+	ENTRY (divesystem_ix3m_easy_0x22, "DiveSystem", "iX3M Easy", DC_FAMILY_DIVESYSTEM_IDIVE, 0x22) \
+	ENTRY (divesystem_ix3m_deep_0x23, "DiveSystem", "iX3M Deep", DC_FAMILY_DIVESYSTEM_IDIVE, 0x23) \
+	ENTRY (divesystem_ix3m_tec_0x24, "DiveSystem", "iX3M Tec", DC_FAMILY_DIVESYSTEM_IDIVE, 0x24) \
+	ENTRY (divesystem_ix3m_reb_0x25, "DiveSystem", "iX3M Reb", DC_FAMILY_DIVESYSTEM_IDIVE, 0x25)
+#else
+#define DC_DESCRIPTORS_DIVESYSTEM(ENTRY)
+#endif
+
+#ifdef ENABLE_COCHRAN
+#define DC_DESCRIPTORS_COCHRAN(ENTRY) \
+	ENTRY (cochran_commander_0, "Cochran", "Commander", DC_FAMILY_COCHRAN_COMMANDER, 0) \
+	ENTRY (cochran_emc_14_1, "Cochran", "EMC-14", DC_FAMILY_COCHRAN_COMMANDER, 1) \
+	ENTRY (cochran_emc_16_2, "Cochran", "EMC-16", DC_FAMILY_COCHRAN_COMMANDER, 2) \
+	ENTRY (cochran_emc_20h_3, "Cochran", "EMC-20H", DC_FAMILY_COCHRAN_COMMANDER, 3)
+#else
+#define DC_DESCRIPTORS_COCHRAN(ENTRY)
+#endif
+
+#define DC_DESCRIPTORS(ENTRY) \
+	DC_DESCRIPTORS_SUUNTO(ENTRY) \
+	DC_DESCRIPTORS_SUUNTO_USBHID(ENTRY) \
+	DC_DESCRIPTORS_UWATEC(ENTRY) \
+	DC_DESCRIPTORS_UWATEC_IRDA(ENTRY) \
+	DC_DESCRIPTORS_UWATEC_2(ENTRY) \
+	DC_DESCRIPTORS_REEFNET(ENTRY) \
+	DC_DESCRIPTORS_OCEANIC(ENTRY) \
+	DC_DESCRIPTORS_MARES(ENTRY) \
+	DC_DESCRIPTORS_HW(ENTRY) \
+	DC_DESCRIPTORS_CRESSI(ENTRY) \
+	DC_DESCRIPTORS_ZEAGLE(ENTRY) \
+	DC_DESCRIPTORS_ATOMICS(ENTRY) \
+	DC_DESCRIPTORS_ATOMICS_LIBUSB(ENTRY) \
+	DC_DESCRIPTORS_SHEARWATER(ENTRY) \
+	DC_DESCRIPTORS_DIVERITE(ENTRY) \
+	DC_DESCRIPTORS_CITIZEN(ENTRY) \
+	DC_DESCRIPTORS_DIVESYSTEM(ENTRY) \
+	DC_DESCRIPTORS_COCHRAN(ENTRY)
+
+/*
+ * The string table. The struct layout assigns each name a unique
+ * member, so the offsets can be obtained at compile time with the
+ * offsetof operator.
+ */
+
+#define STRINGS(id, vendor, product, type, model) \
+	char id ## _vendor [sizeof (vendor)]; \
+	char id ## _product [sizeof (product)];
+
+typedef struct dc_descriptor_strings_t {
+	DC_DESCRIPTORS (STRINGS)
+} dc_descriptor_strings_t;
+
+#define INIT(id, vendor, product, type, model) \
+	vendor, product,
+
+static const dc_descriptor_strings_t g_descriptor_strings = {
+	DC_DESCRIPTORS (INIT)
 };
 
+#define ENTRY(id, vendor, product, type, model) \
+	{offsetof (dc_descriptor_strings_t, id ## _vendor), \
+	 offsetof (dc_descriptor_strings_t, id ## _product), \
+	 type, model},
+
+static const dc_descriptor_t g_descriptors[] = {
+	DC_DESCRIPTORS (ENTRY)
+};
+
+/*
+ * Hash index on the (family, model) pair, built exactly once on the
+ * first lookup (thread-safe via dc_once, and read-only afterwards). The
+ * table stores the index of the first matching descriptor, offset by
+ * one, with zero marking an empty slot. Open addressing with linear
+ * probing is used, and the size is a power of two well above twice the
+ * number of descriptors, to keep the probe sequences short.
+ */
+#define HASHSIZE 1024
+
+static unsigned short g_descriptor_hashmap[HASHSIZE];
+static dc_once_t g_descriptor_hashmap_once = DC_ONCE_INIT;
+
+static unsigned int
+dc_descriptor_hash (dc_family_t type, unsigned int model)
+{
+	unsigned int key = ((unsigned int) type) * 2654435761u + model;
+
+	return (key ^ (key >> 16)) & (HASHSIZE - 1);
+}
+
+static void
+dc_descriptor_hashmap_build (void)
+{
+	for (size_t i = 0; i < C_ARRAY_SIZE (g_descriptors); ++i) {
+		unsigned int slot = dc_descriptor_hash (g_descriptors[i].type, g_descriptors[i].model);
+		while (g_descriptor_hashmap[slot]) {
+			const dc_descriptor_t *other = &g_descriptors[g_descriptor_hashmap[slot] - 1];
+			if (other->type == g_descriptors[i].type &&
+				other->model == g_descriptors[i].model)
+				break; // Keep the first entry for duplicate model numbers.
+			slot = (slot + 1) & (HASHSIZE - 1);
+		}
+		if (g_descriptor_hashmap[slot] == 0)
+			g_descriptor_hashmap[slot] = i + 1;
+	}
+}
+
+dc_status_t
+dc_descriptor_lookup (dc_descriptor_t **out, dc_family_t family, unsigned int model)
+{
+	if (out == NULL)
+		return DC_STATUS_INVALIDARGS;
+
+	dc_once (&g_descriptor_hashmap_once, dc_descriptor_hashmap_build);
+
+	unsigned int slot = dc_descriptor_hash (family, model);
+	while (g_descriptor_hashmap[slot]) {
+		const dc_descriptor_t *descriptor = &g_descriptors[g_descriptor_hashmap[slot] - 1];
+		if (descriptor->type == family && descriptor->model == model) {
+			// The cast is safe, see dc_descriptor_iterator_next.
+			*out = (dc_descriptor_t *) descriptor;
+			return DC_STATUS_SUCCESS;
+		}
+		slot = (slot + 1) & (HASHSIZE - 1);
+	}
+
+	*out = NULL;
+
+	return DC_STATUS_UNSUPPORTED;
+}
+
 typedef struct dc_descriptor_iterator_t {
 	dc_iterator_t base;
 	size_t current;
+	dc_family_t family;
+	dc_transport_t transport;
+	int matched;
 } dc_descriptor_iterator_t;
 
 static dc_status_t dc_descriptor_iterator_next (dc_iterator_t *iterator, void *item);
+static dc_status_t dc_descriptor_iterator_next_n (dc_iterator_t *iterator, void *items, size_t size, unsigned int count, unsigned int *actual);
 static dc_status_t dc_descriptor_iterator_free (dc_iterator_t *iterator);
 
 static const dc_iterator_vtable_t dc_descriptor_iterator_vtable = {
 	dc_descriptor_iterator_free,
-	dc_descriptor_iterator_next
+	dc_descriptor_iterator_next,
+	dc_descriptor_iterator_next_n
 };
 
 dc_status_t
-dc_descriptor_iterator (dc_iterator_t **out)
+dc_descriptor_iterator_filter (dc_iterator_t **out, dc_family_t family, dc_transport_t transport)
 {
 	dc_descriptor_iterator_t *iterator = NULL;
 
@@ -323,12 +551,21 @@ dc_descriptor_iterator (dc_iterator_t **out)
 
 	iterator->base.vtable = &dc_descriptor_iterator_vtable;
 	iterator->current = 0;
+	iterator->family = family;
+	iterator->transport = transport;
+	iterator->matched = 0;
 
 	*out = (dc_iterator_t *) iterator;
 
 	return DC_STATUS_SUCCESS;
 }
 
+dc_status_t
+dc_descriptor_iterator (dc_iterator_t **out)
+{
+	return dc_descriptor_iterator_filter (out, DC_FAMILY_NULL, DC_TRANSPORT_NONE);
+}
+
 static dc_status_t
 dc_descriptor_iterator_free (dc_iterator_t *iterator)
 {
@@ -339,21 +576,80 @@ dc_descriptor_iterator_free (dc_iterator_t *iterator)
 
 static dc_status_t
 dc_descriptor_iterator_next (dc_iterator_t *abstract, void *out)
+{
+	unsigned int actual = 0;
+
+	return dc_descriptor_iterator_next_n (abstract, out, sizeof (dc_descriptor_t *), 1, &actual);
+}
+
+static dc_status_t
+dc_descriptor_iterator_next_n (dc_iterator_t *abstract, void *items, size_t size, unsigned int count, unsigned int *actual)
 {
 	dc_descriptor_iterator_t *iterator = (dc_descriptor_iterator_t *) abstract;
-	dc_descriptor_t **item = (dc_descriptor_t **) out;
+	unsigned char *out = (unsigned char *) items;
+	unsigned int n = 0;
 
-	if (iterator->current >= C_ARRAY_SIZE (g_descriptors))
+	if (size != sizeof (dc_descriptor_t *))
+		return DC_STATUS_INVALIDARGS;
+
+	while (n < count && iterator->current < C_ARRAY_SIZE (g_descriptors)) {
+		const dc_descriptor_t *descriptor = &g_descriptors[iterator->current++];
+
+		if (iterator->family != DC_FAMILY_NULL) {
+			if (descriptor->type != iterator->family) {
+				// The table is grouped by family, so once the end of a
+				// matching group is reached, no further entries can match.
+				if (iterator->matched) {
+					iterator->current = C_ARRAY_SIZE (g_descriptors);
+					break;
+				}
+				continue;
+			}
+			iterator->matched = 1;
+		}
+
+		if (iterator->transport != DC_TRANSPORT_NONE &&
+			dc_descriptor_get_transport ((dc_descriptor_t *) descriptor) != iterator->transport)
+			continue;
+
+		/*
+		 * The explicit cast from a const to a non-const pointer is safe here. The
+		 * public interface doesn't support write access, and therefore descriptor
+		 * objects are always read-only. However, the cast allows to return a direct
+		 * reference to the entries in the table, avoiding the overhead of
+		 * allocating (and freeing) memory for a deep copy.
+		 */
+		*(dc_descriptor_t **) (out + n * size) = (dc_descriptor_t *) descriptor;
+		n++;
+	}
+
+	*actual = n;
+
+	if (n == 0 && count != 0)
 		return DC_STATUS_DONE;
 
-	/*
-	 * The explicit cast from a const to a non-const pointer is safe here. The
-	 * public interface doesn't support write access, and therefore descriptor
-	 * objects are always read-only. However, the cast allows to return a direct
-	 * reference to the entries in the table, avoiding the overhead of
-	 * allocating (and freeing) memory for a deep copy.
-	 */
-	*item = (dc_descriptor_t *) &g_descriptors[iterator->current++];
+	return DC_STATUS_SUCCESS;
+}
+
+dc_status_t
+dc_descriptor_snapshot (dc_descriptor_t *descriptors[], unsigned int size, unsigned int *count)
+{
+	unsigned int total = (unsigned int) C_ARRAY_SIZE (g_descriptors);
+
+	if (count == NULL || (descriptors == NULL && size != 0))
+		return DC_STATUS_INVALIDARGS;
+
+	// The descriptor table is static and immutable, so the snapshot is
+	// just a walk over the table, copying out pointers. No locking or
+	// allocation is needed, and the function is safe to call
+	// concurrently from multiple threads.
+	unsigned int n = size < total ? size : total;
+	for (unsigned int i = 0; i < n; ++i) {
+		// The cast is safe, see dc_descriptor_iterator_next.
+		descriptors[i] = (dc_descriptor_t *) &g_descriptors[i];
+	}
+
+	*count = total;
 
 	return DC_STATUS_SUCCESS;
 }
@@ -370,7 +666,7 @@ dc_descriptor_get_vendor (dc_descriptor_t *descriptor)
 	if (descriptor == NULL)
 		return NULL;
 
-	return descriptor->vendor;
+	return (const char *) &g_descriptor_strings + descriptor->vendor;
 }
 
 const char *
@@ -379,7 +675,7 @@ dc_descriptor_get_product (dc_descriptor_t *descriptor)
 	if (descriptor == NULL)
 		return NULL;
 
-	return descriptor->product;
+	return (const char *) &g_descriptor_strings + descriptor->product;
 }
 
 dc_family_t
@@ -28,6 +28,7 @@
 #include <libdivecomputer/device.h>
 
 #include "common-private.h"
+#include "threads.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -35,10 +36,14 @@ extern "C" {
 
 #define EVENT_PROGRESS_INITIALIZER {0, UINT_MAX}
 
+// The number of hash buckets in the fingerprint set.
+#define FPSET_HASHSIZE 16
+
 struct dc_device_t;
 struct dc_device_vtable_t;
 
 typedef struct dc_device_vtable_t dc_device_vtable_t;
+typedef struct dc_fingerprint_t dc_fingerprint_t;
 
 struct dc_device_t {
 	const dc_device_vtable_t *vtable;
@@ -48,12 +53,81 @@ struct dc_device_t {
 	unsigned int event_mask;
 	dc_event_callback_t event_callback;
 	void *event_userdata;
+	// Progress event coalescing.
+	unsigned int progress_interval;
+	unsigned int progress_delta;
+	unsigned int progress_time;
+	unsigned int progress_value;
+	// Transfer estimate, see DC_EVENT_ESTIMATE. The anchor is the
+	// timestamp and byte count at the start of the current phase.
+	unsigned int phase;
+	unsigned int nphases;
+	unsigned int phase_time;
+	unsigned int phase_value;
+	unsigned int phase_valid;
 	// Cancellation support.
 	dc_cancel_callback_t cancel_callback;
 	void *cancel_userdata;
-	// Cached events for the parsers.
+	volatile int cancelled;
+	// Wake support for the waiting loops, see dc_device_wake.
+	dc_mutex_t wake_mutex;
+	dc_cond_t wake_cond;
+	int wake;
+	// Retry policy, see dc_device_set_retry.
+	int maxretries;
+	unsigned int budget;
+	// Per-operation deadline, see dc_device_set_deadline.
+	unsigned int deadline;
+	unsigned int op_start;
+	unsigned int op_depth;
+	// Foreach budget, see dc_device_set_foreach_limit.
+	unsigned int foreach_skip;
+	unsigned int foreach_maxdives;
+	unsigned int foreach_timeout;
+	// Keepalive service, see dc_device_set_keepalive. The mutex
+	// serializes the keepalive pings against the regular operations:
+	// the worker thread only pings while the idle flag is set, and
+	// holds the mutex for the duration of the ping, so closing the
+	// idle window waits for a ping in progress to complete.
+	dc_thread_t keepalive_thread;
+	dc_mutex_t keepalive_mutex;
+	dc_cond_t keepalive_cond;
+	unsigned int keepalive_interval;
+	unsigned int keepalive_last;
+	int keepalive_idle;
+	int keepalive_running;
+	// Scratch region, see device_scratch_push.
+	unsigned char *scratch;
+	unsigned int scratch_size;
+	unsigned int scratch_top;
+	// Hash of the most recently delivered dive or memory dump, see
+	// dc_device_get_hash.
+	unsigned long long hash;
+	unsigned int hash_valid;
+	// Cached events for the parsers, and for replaying to an event
+	// handler registered after the events were emitted.
 	dc_event_devinfo_t devinfo;
 	dc_event_clock_t clock;
+	unsigned int devinfo_valid;
+	unsigned int clock_valid;
+	// Known dive fingerprints, see dc_device_add_fingerprint.
+	dc_fingerprint_t *fingerprints[FPSET_HASHSIZE];
+	unsigned int nfingerprints;
+	// Optional read cache, see dc_device_set_read_cache.
+	unsigned int cache_pagesize;
+	unsigned int cache_npages;
+	unsigned int *cache_address;
+	unsigned char *cache_valid;
+	unsigned char *cache_data;
+	// Resume state for interrupted dumps, see dc_device_dump_resume.
+	const unsigned char *resume_data;
+	unsigned int resume_size;
+	unsigned int dump_position;
+	// Session statistics, see DC_EVENT_SESSION.
+	unsigned int opened;
+	unsigned int ndives;
+	unsigned int divebytes;
+	dc_event_metrics_t metrics;
 };
 
 struct dc_device_vtable_t {
@@ -69,11 +143,72 @@ struct dc_device_vtable_t {
 
 	dc_status_t (*dump) (dc_device_t *device, dc_buffer_t *buffer);
 
+	/* The dives must be delivered newest first, and the enumeration
+	 * must stop before the first dive matching the fingerprint (or for
+	 * the timestamp based backends, at the first dive that is not newer
+	 * than the timestamp). Applications rely on this ordering contract
+	 * to sync in time proportional to the number of new dives. */
 	dc_status_t (*foreach) (dc_device_t *device, dc_dive_callback_t callback, void *userdata);
 
 	dc_status_t (*close) (dc_device_t *device);
+
+	/* Optional. Backends that can hand over each dive in its own
+	 * dc_buffer_t, without assembling it in a shared memory area
+	 * first, can implement this entry. If absent, the buffer based
+	 * enumeration falls back to the foreach entry. The entry is
+	 * located after the mandatory ones, to remain compatible with
+	 * backends using a positional initializer. */
+	dc_status_t (*foreach_buffer) (dc_device_t *device, dc_dive_buffer_callback_t callback, void *userdata);
+
+	/* Optional. Backends that can re-use the dump from a previous
+	 * session to skip unchanged memory regions can implement this
+	 * entry. If absent, the delta dump falls back to the dump entry. */
+	dc_status_t (*dump_delta) (dc_device_t *device, dc_buffer_t *buffer, dc_buffer_t *previous);
+
+	/* Optional. Backends that can coalesce or pipeline multiple read
+	 * requests on the protocol side can implement this entry. If
+	 * absent, the multi-range read falls back to the read entry, with
+	 * adjacent ranges merged. The ranges are validated against the
+	 * output buffer before this entry is called. */
+	dc_status_t (*read_multiple) (dc_device_t *device, const dc_device_range_t ranges[], unsigned int nranges, unsigned char data[], unsigned int size);
+
+	/* Optional. Backends that can hand out the memory dump in chunks,
+	 * as the data arrives from the device, can implement this entry to
+	 * bound the resident size. If absent, the streaming dump falls
+	 * back to a full in-memory dump. */
+	dc_status_t (*dump_stream) (dc_device_t *device, dc_dump_callback_t callback, void *userdata);
+
+	/* Optional. Backends with a cheap logbook or manifest phase,
+	 * separate from the profile download, can implement this entry to
+	 * enumerate the dive identities without transferring the profiles.
+	 * There is no fallback when the entry is absent: enumerating
+	 * through the foreach entry would download exactly the data the
+	 * caller is trying to avoid. */
+	dc_status_t (*enumerate) (dc_device_t *device, dc_dive_summary_callback_t callback, void *userdata);
+
+	/* Optional. Backends whose devices drop the session after a period
+	 * of host inactivity can implement this entry with a protocol
+	 * no-op exchange, used by the keepalive service (see
+	 * dc_device_set_keepalive) to keep the session alive during
+	 * caller-induced idle periods. The entry is only invoked while no
+	 * other operation is in progress. */
+	dc_status_t (*keepalive) (dc_device_t *device);
 };
 
+/*
+ * Dispatch through the device vtable. See the DC_VTABLE_STORAGE
+ * comment in common-private.h for the static dispatch build. Only
+ * backends with a plain dc_device_vtable_t can be selected here; the
+ * backends with a derived vtable (the Oceanic and Suunto common2
+ * families) keep the dynamic dispatch on the device side.
+ */
+#ifdef DC_STATIC_DISPATCH_DEVICE
+extern const dc_device_vtable_t DC_STATIC_DISPATCH_DEVICE;
+#define DC_DEVICE_VTABLE(device) (&DC_STATIC_DISPATCH_DEVICE)
+#else
+#define DC_DEVICE_VTABLE(device) ((device)->vtable)
+#endif
+
 int
 dc_device_isinstance (dc_device_t *device, const dc_device_vtable_t *vtable);
 
@@ -89,9 +224,91 @@ device_event_emit (dc_device_t *device, dc_event_type_t event, const void *data)
 int
 device_is_cancelled (dc_device_t *device);
 
+/*
+ * Mark the start of a phase of a multi-phase operation, for the
+ * transfer estimate (see DC_EVENT_ESTIMATE). The rate measurement
+ * restarts at the phase boundary. Backends with a single download
+ * phase don't need to call this; every operation starts as phase 1 of
+ * 1.
+ */
+void
+device_progress_phase (dc_device_t *device, unsigned int phase, unsigned int nphases);
+
+/*
+ * Sleep between two polls of a waiting loop (the loops that emit
+ * DC_EVENT_WAITING). Returns non-zero when the sleep was cut short by
+ * dc_device_wake, so the caller can re-probe immediately and restart
+ * its backoff from the shortest interval.
+ */
+int
+device_sleep_while_waiting (dc_device_t *device, unsigned int milliseconds);
+
+/*
+ * The effective retry limit for a transfer loop: the limit configured
+ * with dc_device_set_retry, or the backend specific default passed in
+ * by the caller.
+ */
+unsigned int
+device_retry_limit (dc_device_t *device, unsigned int maxretries);
+
+/*
+ * Adapter around device_is_cancelled with the dc_cancel_callback_t
+ * signature, for registration with the transport layer (e.g.
+ * dc_serial_set_cancel). The userdata is the device itself.
+ */
+int
+device_cancel_cb (void *userdata);
+
+/*
+ * Open and close the idle window of the keepalive service (see
+ * dc_device_set_keepalive). The generic layer brackets the public
+ * operations and the application callbacks automatically; backends
+ * that block on the application for a long time in other places (e.g.
+ * an interactive firmware update) can bracket those too. Closing the
+ * window waits for a ping in progress to complete, so the transport is
+ * quiescent when the call returns. Both are no-ops while the service
+ * is not running.
+ */
+void
+device_keepalive_allow (dc_device_t *device);
+
+void
+device_keepalive_forbid (dc_device_t *device);
+
+/*
+ * Test whether a fingerprint is in the set registered with
+ * dc_device_add_fingerprint. The generic enumeration already filters
+ * the delivered dives, but backends can call this earlier, to avoid
+ * downloading the profile of a dive whose fingerprint is known.
+ */
+int
+device_fingerprint_known (dc_device_t *device, const unsigned char data[], unsigned int size);
+
 dc_status_t
 device_dump_read (dc_device_t *device, unsigned char data[], unsigned int size, unsigned int blocksize);
 
+/*
+ * Per-device scratch region for protocol frame assembly, with a stack
+ * discipline: a transfer loop pushes its frame buffers once, reuses
+ * them for every packet, and pops them (in reverse order, with the
+ * same sizes) before returning, including on the error paths. The
+ * region is allocated once and reused for the whole session, so the
+ * frames live on warm cache lines instead of fresh stack frames or
+ * per-packet heap allocations.
+ *
+ * device_scratch_reserve sizes the region up front (typically at
+ * open); pushing beyond the reserved capacity grows the region only
+ * while no frames are outstanding, and fails otherwise.
+ */
+dc_status_t
+device_scratch_reserve (dc_device_t *device, unsigned int size);
+
+unsigned char *
+device_scratch_push (dc_device_t *device, unsigned int size);
+
+void
+device_scratch_pop (dc_device_t *device, unsigned int size);
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
@@ -23,6 +23,13 @@
 #include <stdlib.h>
 #include <string.h>
 
+#ifdef _WIN32
+#define NOGDI
+#include <windows.h>
+#else
+#include <sys/time.h>
+#endif
+
 #include <libdivecomputer/suunto.h>
 #include <libdivecomputer/reefnet.h>
 #include <libdivecomputer/uwatec.h>
@@ -40,6 +47,29 @@
 
 #include "device-private.h"
 #include "context-private.h"
+#include "checksum.h"
+#include "threads.h"
+
+struct dc_fingerprint_t {
+	dc_fingerprint_t *next;
+	unsigned int size;
+	unsigned char data[];
+};
+
+static unsigned int
+dc_device_fingerprint_hash (const unsigned char data[], unsigned int size)
+{
+	// FNV-1a
+	unsigned int hash = 2166136261u;
+	for (unsigned int i = 0; i < size; ++i) {
+		hash ^= data[i];
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+static unsigned int
+device_timestamp (void);
 
 dc_device_t *
 dc_device_allocate (dc_context_t *context, const dc_device_vtable_t *vtable)
@@ -50,7 +80,7 @@ dc_device_allocate (dc_context_t *context, const dc_device_vtable_t *vtable)
 	assert(vtable->size >= sizeof(dc_device_t));
 
 	// Allocate memory.
-	device = (dc_device_t *) malloc (vtable->size);
+	device = (dc_device_t *) dc_context_malloc (context, vtable->size);
 	if (device == NULL) {
 		ERROR (context, "Failed to allocate memory.");
 		return device;
@@ -64,11 +94,72 @@ dc_device_allocate (dc_context_t *context, const dc_device_vtable_t *vtable)
 	device->event_callback = NULL;
 	device->event_userdata = NULL;
 
+	device->progress_interval = 0;
+	device->progress_delta = 0;
+	device->progress_time = 0;
+	device->progress_value = 0;
+
+	device->phase = 1;
+	device->nphases = 1;
+	device->phase_time = 0;
+	device->phase_value = 0;
+	device->phase_valid = 0;
+
 	device->cancel_callback = NULL;
 	device->cancel_userdata = NULL;
+	device->cancelled = 0;
+
+	dc_mutex_init (&device->wake_mutex);
+	dc_cond_init (&device->wake_cond);
+	device->wake = 0;
+
+	device->maxretries = -1;
+	device->budget = 0;
+
+	device->deadline = 0;
+	device->op_start = 0;
+	device->op_depth = 0;
+
+	device->foreach_skip = 0;
+	device->foreach_maxdives = 0;
+	device->foreach_timeout = 0;
+
+	dc_mutex_init (&device->keepalive_mutex);
+	dc_cond_init (&device->keepalive_cond);
+	device->keepalive_interval = 0;
+	device->keepalive_last = 0;
+	device->keepalive_idle = 0;
+	device->keepalive_running = 0;
+
+	device->scratch = NULL;
+	device->scratch_size = 0;
+	device->scratch_top = 0;
+
+	device->hash = 0;
+	device->hash_valid = 0;
 
 	memset (&device->devinfo, 0, sizeof (device->devinfo));
 	memset (&device->clock, 0, sizeof (device->clock));
+	device->devinfo_valid = 0;
+	device->clock_valid = 0;
+
+	memset (device->fingerprints, 0, sizeof (device->fingerprints));
+	device->nfingerprints = 0;
+
+	device->cache_pagesize = 0;
+	device->cache_npages = 0;
+	device->cache_address = NULL;
+	device->cache_valid = NULL;
+	device->cache_data = NULL;
+
+	device->resume_data = NULL;
+	device->resume_size = 0;
+	device->dump_position = 0;
+
+	device->opened = device_timestamp ();
+	device->ndives = 0;
+	device->divebytes = 0;
+	memset (&device->metrics, 0, sizeof (device->metrics));
 
 	return device;
 }
@@ -76,7 +167,24 @@ dc_device_allocate (dc_context_t *context, const dc_device_vtable_t *vtable)
 void
 dc_device_deallocate (dc_device_t *device)
 {
-	free (device);
+	if (device == NULL)
+		return;
+
+	dc_device_clear_fingerprints (device);
+
+	dc_cond_destroy (&device->wake_cond);
+	dc_mutex_destroy (&device->wake_mutex);
+
+	dc_cond_destroy (&device->keepalive_cond);
+	dc_mutex_destroy (&device->keepalive_mutex);
+
+	dc_context_mfree (device->context, device->cache_address);
+	dc_context_mfree (device->context, device->cache_valid);
+	dc_context_mfree (device->context, device->cache_data);
+
+	dc_context_mfree (device->context, device->scratch);
+
+	dc_context_mfree (device->context, device);
 }
 
 dc_status_t
@@ -89,6 +197,7 @@ dc_device_open (dc_device_t **out, dc_context_t *context, dc_descriptor_t *descr
 		return DC_STATUS_INVALIDARGS;
 
 	switch (dc_descriptor_get_type (descriptor)) {
+#ifdef ENABLE_SUUNTO
 	case DC_FAMILY_SUUNTO_SOLUTION:
 		rc = suunto_solution_device_open (&device, context, name);
 		break;
@@ -107,6 +216,8 @@ dc_device_open (dc_device_t **out, dc_context_t *context, dc_descriptor_t *descr
 	case DC_FAMILY_SUUNTO_EONSTEEL:
 		rc = suunto_eonsteel_device_open (&device, context, name, dc_descriptor_get_model (descriptor));
 		break;
+#endif
+#ifdef ENABLE_UWATEC
 	case DC_FAMILY_UWATEC_ALADIN:
 		rc = uwatec_aladin_device_open (&device, context, name);
 		break;
@@ -119,6 +230,8 @@ dc_device_open (dc_device_t **out, dc_context_t *context, dc_descriptor_t *descr
 	case DC_FAMILY_UWATEC_MERIDIAN:
 		rc = uwatec_meridian_device_open (&device, context, name);
 		break;
+#endif
+#ifdef ENABLE_REEFNET
 	case DC_FAMILY_REEFNET_SENSUS:
 		rc = reefnet_sensus_device_open (&device, context, name);
 		break;
@@ -128,6 +241,8 @@ dc_device_open (dc_device_t **out, dc_context_t *context, dc_descriptor_t *descr
 	case DC_FAMILY_REEFNET_SENSUSULTRA:
 		rc = reefnet_sensusultra_device_open (&device, context, name);
 		break;
+#endif
+#ifdef ENABLE_OCEANIC
 	case DC_FAMILY_OCEANIC_VTPRO:
 		rc = oceanic_vtpro_device_open2 (&device, context, name, dc_descriptor_get_model (descriptor));
 		break;
@@ -137,6 +252,8 @@ dc_device_open (dc_device_t **out, dc_context_t *context, dc_descriptor_t *descr
 	case DC_FAMILY_OCEANIC_ATOM2:
 		rc = oceanic_atom2_device_open2 (&device, context, name, dc_descriptor_get_model (descriptor));
 		break;
+#endif
+#ifdef ENABLE_MARES
 	case DC_FAMILY_MARES_NEMO:
 		rc = mares_nemo_device_open (&device, context, name);
 		break;
@@ -149,6 +266,8 @@ dc_device_open (dc_device_t **out, dc_context_t *context, dc_descriptor_t *descr
 	case DC_FAMILY_MARES_ICONHD:
 		rc = mares_iconhd_device_open (&device, context, name, dc_descriptor_get_model (descriptor));
 		break;
+#endif
+#ifdef ENABLE_HW
 	case DC_FAMILY_HW_OSTC:
 		rc = hw_ostc_device_open (&device, context, name);
 		break;
@@ -158,36 +277,53 @@ dc_device_open (dc_device_t **out, dc_context_t *context, dc_descriptor_t *descr
 	case DC_FAMILY_HW_OSTC3:
 		rc = hw_ostc3_device_open (&device, context, name);
 		break;
+#endif
+#ifdef ENABLE_CRESSI
 	case DC_FAMILY_CRESSI_EDY:
 		rc = cressi_edy_device_open (&device, context, name);
 		break;
 	case DC_FAMILY_CRESSI_LEONARDO:
 		rc = cressi_leonardo_device_open (&device, context, name);
 		break;
+#endif
+#ifdef ENABLE_ZEAGLE
 	case DC_FAMILY_ZEAGLE_N2ITION3:
 		rc = zeagle_n2ition3_device_open (&device, context, name);
 		break;
+#endif
+#ifdef ENABLE_ATOMICS
 	case DC_FAMILY_ATOMICS_COBALT:
 		rc = atomics_cobalt_device_open (&device, context);
 		break;
+#endif
+#ifdef ENABLE_SHEARWATER
 	case DC_FAMILY_SHEARWATER_PREDATOR:
 		rc = shearwater_predator_device_open (&device, context, name);
 		break;
 	case DC_FAMILY_SHEARWATER_PETREL:
 		rc = shearwater_petrel_device_open (&device, context, name);
 		break;
+#endif
+#ifdef ENABLE_DIVERITE
 	case DC_FAMILY_DIVERITE_NITEKQ:
 		rc = diverite_nitekq_device_open (&device, context, name);
 		break;
+#endif
+#ifdef ENABLE_CITIZEN
 	case DC_FAMILY_CITIZEN_AQUALAND:
 		rc = citizen_aqualand_device_open (&device, context, name);
 		break;
+#endif
+#ifdef ENABLE_DIVESYSTEM
 	case DC_FAMILY_DIVESYSTEM_IDIVE:
 		rc = divesystem_idive_device_open2 (&device, context, name, dc_descriptor_get_model (descriptor));
 		break;
+#endif
+#ifdef ENABLE_COCHRAN
 	case DC_FAMILY_COCHRAN_COMMANDER:
 		rc = cochran_commander_device_open (&device, context, name);
 		break;
+#endif
 	default:
 		return DC_STATUS_INVALIDARGS;
 	}
@@ -214,7 +350,7 @@ dc_device_get_type (dc_device_t *device)
 	if (device == NULL)
 		return DC_FAMILY_NULL;
 
-	return device->vtable->type;
+	return DC_DEVICE_VTABLE(device)->type;
 }
 
 
@@ -232,203 +368,1531 @@ dc_device_set_cancel (dc_device_t *device, dc_cancel_callback_t callback, void *
 
 
 dc_status_t
-dc_device_set_events (dc_device_t *device, unsigned int events, dc_event_callback_t callback, void *userdata)
+dc_device_cancel (dc_device_t *device)
 {
 	if (device == NULL)
 		return DC_STATUS_UNSUPPORTED;
 
-	device->event_mask = events;
-	device->event_callback = callback;
-	device->event_userdata = userdata;
+	device->cancelled = 1;
+
+	// Wake a backend sleeping between two polls, so the cancellation
+	// is noticed without waiting out the poll interval.
+	dc_device_wake (device);
+
+	return DC_STATUS_SUCCESS;
+}
+
+dc_status_t
+dc_device_wake (dc_device_t *device)
+{
+	if (device == NULL)
+		return DC_STATUS_INVALIDARGS;
+
+	dc_mutex_lock (&device->wake_mutex);
+	device->wake = 1;
+	dc_cond_signal (&device->wake_cond);
+	dc_mutex_unlock (&device->wake_mutex);
 
 	return DC_STATUS_SUCCESS;
 }
 
 
 dc_status_t
-dc_device_set_fingerprint (dc_device_t *device, const unsigned char data[], unsigned int size)
+dc_device_set_retry (dc_device_t *device, int maxretries, unsigned int budget)
 {
 	if (device == NULL)
 		return DC_STATUS_UNSUPPORTED;
 
-	if (device->vtable->set_fingerprint == NULL)
+	INFO (device->context, "Retry: maxretries=%i, budget=%u", maxretries, budget);
+
+	device->maxretries = maxretries;
+	device->budget = budget;
+
+	return DC_STATUS_SUCCESS;
+}
+
+
+dc_status_t
+dc_device_set_deadline (dc_device_t *device, unsigned int milliseconds)
+{
+	if (device == NULL)
 		return DC_STATUS_UNSUPPORTED;
 
-	return device->vtable->set_fingerprint (device, data, size);
+	INFO (device->context, "Deadline: milliseconds=%u", milliseconds);
+
+	device->deadline = milliseconds;
+
+	return DC_STATUS_SUCCESS;
+}
+
+
+// Mark the begin and end of a public device operation, for the
+// per-operation deadline. The clock starts at the outermost entry
+// point; nested calls (e.g. dc_device_dump_stream falling back to
+// dc_device_dump) run under the deadline of their caller. The end
+// helper passes the status code through, so a tail call wraps an
+// existing return statement without restructuring the function.
+
+static void
+device_operation_begin (dc_device_t *device)
+{
+	if (device->op_depth++ == 0) {
+		device->op_start = device_timestamp ();
+		device->phase = 1;
+		device->nphases = 1;
+		device->phase_valid = 0;
+		device_keepalive_forbid (device);
+	}
+}
+
+static dc_status_t
+device_operation_end (dc_device_t *device, dc_status_t rc)
+{
+	if (--device->op_depth == 0)
+		device_keepalive_allow (device);
+
+	return rc;
+}
+
+
+// Keepalive service, see dc_device_set_keepalive. The worker thread
+// pings the device with the backend's no-op exchange whenever the link
+// has been idle for the configured interval. Pings are only sent while
+// the idle flag is set, and the worker holds the mutex for the
+// duration of a ping, so device_keepalive_forbid blocks until a ping
+// in progress has completed before the next operation touches the
+// transport.
+
+static void *
+dc_device_keepalive_worker (void *arg)
+{
+	dc_device_t *device = (dc_device_t *) arg;
+
+	dc_mutex_lock (&device->keepalive_mutex);
+
+	while (device->keepalive_running) {
+		if (!device->keepalive_idle) {
+			dc_cond_wait (&device->keepalive_cond, &device->keepalive_mutex);
+			continue;
+		}
+
+		unsigned int elapsed = device_timestamp () - device->keepalive_last;
+		if (elapsed < device->keepalive_interval) {
+			dc_cond_timedwait (&device->keepalive_cond, &device->keepalive_mutex,
+				device->keepalive_interval - elapsed);
+			continue;
+		}
+
+		dc_status_t rc = DC_DEVICE_VTABLE(device)->keepalive (device);
+		if (rc != DC_STATUS_SUCCESS) {
+			WARNING (device->context, "Keepalive ping failed.");
+		}
+
+		device->keepalive_last = device_timestamp ();
+	}
+
+	dc_mutex_unlock (&device->keepalive_mutex);
+
+	return NULL;
+}
+
+// Open the idle window: the link is unused until the next operation,
+// so the worker may ping. The idle clock restarts here, because the
+// operation that just finished has already exercised the link.
+void
+device_keepalive_allow (dc_device_t *device)
+{
+	if (!device->keepalive_running)
+		return;
+
+	dc_mutex_lock (&device->keepalive_mutex);
+	device->keepalive_idle = 1;
+	device->keepalive_last = device_timestamp ();
+	dc_cond_signal (&device->keepalive_cond);
+	dc_mutex_unlock (&device->keepalive_mutex);
+}
+
+// Close the idle window before an operation touches the transport.
+// Taking the mutex waits for a ping in progress to complete.
+void
+device_keepalive_forbid (dc_device_t *device)
+{
+	if (!device->keepalive_running)
+		return;
+
+	dc_mutex_lock (&device->keepalive_mutex);
+	device->keepalive_idle = 0;
+	dc_mutex_unlock (&device->keepalive_mutex);
 }
 
+static void
+device_keepalive_stop (dc_device_t *device)
+{
+	dc_mutex_lock (&device->keepalive_mutex);
+	if (!device->keepalive_running) {
+		dc_mutex_unlock (&device->keepalive_mutex);
+		return;
+	}
+	device->keepalive_running = 0;
+	dc_cond_signal (&device->keepalive_cond);
+	dc_mutex_unlock (&device->keepalive_mutex);
+
+	dc_thread_join (&device->keepalive_thread);
+}
 
 dc_status_t
-dc_device_read (dc_device_t *device, unsigned int address, unsigned char data[], unsigned int size)
+dc_device_set_keepalive (dc_device_t *device, unsigned int interval)
 {
 	if (device == NULL)
 		return DC_STATUS_UNSUPPORTED;
 
-	if (device->vtable->read == NULL)
+	if (DC_DEVICE_VTABLE(device)->keepalive == NULL)
 		return DC_STATUS_UNSUPPORTED;
 
-	return device->vtable->read (device, address, data, size);
+	INFO (device->context, "Keepalive: interval=%u", interval);
+
+	if (interval == 0) {
+		device_keepalive_stop (device);
+		return DC_STATUS_SUCCESS;
+	}
+
+	dc_mutex_lock (&device->keepalive_mutex);
+
+	device->keepalive_interval = interval;
+	device->keepalive_last = device_timestamp ();
+
+	if (!device->keepalive_running) {
+		// Start in the idle state: the caller is configuring the
+		// service between operations, so the link is unused until the
+		// next operation begins.
+		device->keepalive_idle = 1;
+		device->keepalive_running = 1;
+		if (dc_thread_create (&device->keepalive_thread, dc_device_keepalive_worker, device) != 0) {
+			ERROR (device->context, "Failed to create the keepalive thread.");
+			device->keepalive_running = 0;
+			dc_mutex_unlock (&device->keepalive_mutex);
+			return DC_STATUS_NOMEMORY;
+		}
+	} else {
+		dc_cond_signal (&device->keepalive_cond);
+	}
+
+	dc_mutex_unlock (&device->keepalive_mutex);
+
+	return DC_STATUS_SUCCESS;
 }
 
 
 dc_status_t
-dc_device_write (dc_device_t *device, unsigned int address, const unsigned char data[], unsigned int size)
+dc_device_set_foreach_limit (dc_device_t *device, unsigned int skip, unsigned int maxdives, unsigned int timeout)
 {
 	if (device == NULL)
 		return DC_STATUS_UNSUPPORTED;
 
-	if (device->vtable->write == NULL)
-		return DC_STATUS_UNSUPPORTED;
+	INFO (device->context, "Foreach limit: skip=%u, maxdives=%u, timeout=%u", skip, maxdives, timeout);
+
+	device->foreach_skip = skip;
+	device->foreach_maxdives = maxdives;
+	device->foreach_timeout = timeout;
 
-	return device->vtable->write (device, address, data, size);
+	return DC_STATUS_SUCCESS;
 }
 
 
 dc_status_t
-dc_device_dump (dc_device_t *device, dc_buffer_t *buffer)
+dc_device_set_events (dc_device_t *device, unsigned int events, dc_event_callback_t callback, void *userdata)
 {
 	if (device == NULL)
 		return DC_STATUS_UNSUPPORTED;
 
-	if (device->vtable->dump == NULL)
+	device->event_mask = events;
+	device->event_callback = callback;
+	device->event_userdata = userdata;
+
+	// Replay the cached device information and clock events to the new
+	// handler. Backends that learn the device identity during the device
+	// open emit these events before the application has a chance to
+	// register a handler; replaying the cached values here delivers
+	// them immediately, instead of after the next download re-emits
+	// them.
+	if (device->devinfo_valid)
+		device_event_emit (device, DC_EVENT_DEVINFO, &device->devinfo);
+	if (device->clock_valid)
+		device_event_emit (device, DC_EVENT_CLOCK, &device->clock);
+
+	return DC_STATUS_SUCCESS;
+}
+
+
+dc_status_t
+dc_device_set_progress_interval (dc_device_t *device, unsigned int interval, unsigned int delta)
+{
+	if (device == NULL)
 		return DC_STATUS_UNSUPPORTED;
 
-	return device->vtable->dump (device, buffer);
+	device->progress_interval = interval;
+	device->progress_delta = delta;
+	device->progress_time = 0;
+	device->progress_value = 0;
+
+	return DC_STATUS_SUCCESS;
 }
 
 
 dc_status_t
-device_dump_read (dc_device_t *device, unsigned char data[], unsigned int size, unsigned int blocksize)
+dc_device_set_fingerprint (dc_device_t *device, const unsigned char data[], unsigned int size)
 {
 	if (device == NULL)
 		return DC_STATUS_UNSUPPORTED;
 
-	if (device->vtable->read == NULL)
+	if (DC_DEVICE_VTABLE(device)->set_fingerprint == NULL)
 		return DC_STATUS_UNSUPPORTED;
 
-	// Enable progress notifications.
-	dc_event_progress_t progress = EVENT_PROGRESS_INITIALIZER;
-	progress.maximum = size;
-	device_event_emit (device, DC_EVENT_PROGRESS, &progress);
+	return DC_DEVICE_VTABLE(device)->set_fingerprint (device, data, size);
+}
 
-	unsigned int nbytes = 0;
-	while (nbytes < size) {
-		// Calculate the packet size.
-		unsigned int len = size - nbytes;
-		if (len > blocksize)
-			len = blocksize;
 
-		// Read the packet.
-		dc_status_t rc = device->vtable->read (device, nbytes, data + nbytes, len);
-		if (rc != DC_STATUS_SUCCESS)
-			return rc;
+dc_status_t
+dc_device_add_fingerprint (dc_device_t *device, const unsigned char data[], unsigned int size)
+{
+	if (device == NULL)
+		return DC_STATUS_UNSUPPORTED;
 
-		// Update and emit a progress event.
-		progress.current += len;
-		device_event_emit (device, DC_EVENT_PROGRESS, &progress);
+	if (data == NULL || size == 0)
+		return DC_STATUS_INVALIDARGS;
 
-		nbytes += len;
+	// Ignore duplicates.
+	if (device_fingerprint_known (device, data, size))
+		return DC_STATUS_SUCCESS;
+
+	dc_fingerprint_t *entry = (dc_fingerprint_t *) dc_context_malloc (device->context, sizeof (dc_fingerprint_t) + size);
+	if (entry == NULL) {
+		ERROR (device->context, "Failed to allocate memory.");
+		return DC_STATUS_NOMEMORY;
 	}
 
+	entry->size = size;
+	memcpy (entry->data, data, size);
+
+	unsigned int bucket = dc_device_fingerprint_hash (data, size) % FPSET_HASHSIZE;
+	entry->next = device->fingerprints[bucket];
+	device->fingerprints[bucket] = entry;
+	device->nfingerprints++;
+
 	return DC_STATUS_SUCCESS;
 }
 
 
 dc_status_t
-dc_device_foreach (dc_device_t *device, dc_dive_callback_t callback, void *userdata)
+dc_device_clear_fingerprints (dc_device_t *device)
 {
 	if (device == NULL)
 		return DC_STATUS_UNSUPPORTED;
 
-	if (device->vtable->foreach == NULL)
-		return DC_STATUS_UNSUPPORTED;
+	for (unsigned int i = 0; i < FPSET_HASHSIZE; ++i) {
+		dc_fingerprint_t *entry = device->fingerprints[i];
+		while (entry) {
+			dc_fingerprint_t *next = entry->next;
+			dc_context_mfree (device->context, entry);
+			entry = next;
+		}
+		device->fingerprints[i] = NULL;
+	}
+	device->nfingerprints = 0;
 
-	return device->vtable->foreach (device, callback, userdata);
+	return DC_STATUS_SUCCESS;
 }
 
 
-dc_status_t
-dc_device_close (dc_device_t *device)
+int
+device_fingerprint_known (dc_device_t *device, const unsigned char data[], unsigned int size)
 {
-	dc_status_t status = DC_STATUS_SUCCESS;
+	if (device == NULL || data == NULL || size == 0)
+		return 0;
+
+	if (device->nfingerprints == 0)
+		return 0;
+
+	unsigned int bucket = dc_device_fingerprint_hash (data, size) % FPSET_HASHSIZE;
+	for (dc_fingerprint_t *entry = device->fingerprints[bucket]; entry; entry = entry->next) {
+		if (entry->size == size && memcmp (entry->data, data, size) == 0)
+			return 1;
+	}
+
+	return 0;
+}
+
 
+dc_status_t
+dc_device_set_read_cache (dc_device_t *device, unsigned int pagesize, unsigned int npages)
+{
 	if (device == NULL)
-		return DC_STATUS_SUCCESS;
+		return DC_STATUS_UNSUPPORTED;
 
-	// Disable the cancellation callback.
-	device->cancel_callback = NULL;
-	device->cancel_userdata = NULL;
+	if ((pagesize == 0) != (npages == 0))
+		return DC_STATUS_INVALIDARGS;
+
+	// Release the previous cache.
+	dc_context_mfree (device->context, device->cache_address);
+	dc_context_mfree (device->context, device->cache_valid);
+	dc_context_mfree (device->context, device->cache_data);
+	device->cache_pagesize = 0;
+	device->cache_npages = 0;
+	device->cache_address = NULL;
+	device->cache_valid = NULL;
+	device->cache_data = NULL;
+
+	if (npages == 0)
+		return DC_STATUS_SUCCESS;
 
-	if (device->vtable->close) {
-		status = device->vtable->close (device);
+	device->cache_address = (unsigned int *) dc_context_malloc (device->context, npages * sizeof (unsigned int));
+	device->cache_valid = (unsigned char *) dc_context_malloc (device->context, npages);
+	device->cache_data = (unsigned char *) dc_context_malloc (device->context, (size_t) npages * pagesize);
+	if (device->cache_address == NULL || device->cache_valid == NULL ||
+		device->cache_data == NULL) {
+		ERROR (device->context, "Failed to allocate memory.");
+		dc_context_mfree (device->context, device->cache_address);
+		dc_context_mfree (device->context, device->cache_valid);
+		dc_context_mfree (device->context, device->cache_data);
+		device->cache_address = NULL;
+		device->cache_valid = NULL;
+		device->cache_data = NULL;
+		return DC_STATUS_NOMEMORY;
 	}
 
-	dc_device_deallocate (device);
+	memset (device->cache_valid, 0, npages);
+	device->cache_pagesize = pagesize;
+	device->cache_npages = npages;
 
-	return status;
+	return DC_STATUS_SUCCESS;
 }
 
 
-void
-device_event_emit (dc_device_t *device, dc_event_type_t event, const void *data)
+dc_status_t
+dc_device_invalidate_read_cache (dc_device_t *device)
 {
-	dc_event_progress_t *progress = (dc_event_progress_t *) data;
+	if (device == NULL)
+		return DC_STATUS_UNSUPPORTED;
 
-	// Check the event data for errors.
-	switch (event) {
-	case DC_EVENT_WAITING:
-		assert (data == NULL);
-		break;
-	case DC_EVENT_PROGRESS:
-		assert (progress != NULL);
-		assert (progress->maximum != 0);
-		assert (progress->maximum >= progress->current);
-		break;
-	case DC_EVENT_DEVINFO:
-		assert (data != NULL);
-		break;
-	case DC_EVENT_CLOCK:
-		assert (data != NULL);
-		break;
-	default:
-		break;
-	}
+	if (device->cache_npages)
+		memset (device->cache_valid, 0, device->cache_npages);
 
+	return DC_STATUS_SUCCESS;
+}
+
+
+dc_status_t
+dc_device_read (dc_device_t *device, unsigned int address, unsigned char data[], unsigned int size)
+{
 	if (device == NULL)
-		return;
+		return DC_STATUS_UNSUPPORTED;
 
-	// Cache the event data.
-	switch (event) {
-	case DC_EVENT_DEVINFO:
-		device->devinfo = *(dc_event_devinfo_t *) data;
-		break;
-	case DC_EVENT_CLOCK:
-		device->clock = *(dc_event_clock_t *) data;
-		break;
-	default:
-		break;
-	}
+	if (DC_DEVICE_VTABLE(device)->read == NULL)
+		return DC_STATUS_UNSUPPORTED;
 
-	// Check if there is a callback function registered.
-	if (device->event_callback == NULL)
-		return;
+	device_operation_begin (device);
 
-	// Check the event mask.
-	if ((event & device->event_mask) == 0)
-		return;
+	// Only page aligned requests go through the cache. Unaligned
+	// requests are passed through unmodified, so the cache never issues
+	// a larger read than the caller asked for, which could run past the
+	// end of the device memory.
+	unsigned int pagesize = device->cache_pagesize;
+	if (pagesize == 0 || (address % pagesize) != 0 || (size % pagesize) != 0)
+		return device_operation_end (device,
+			DC_DEVICE_VTABLE(device)->read (device, address, data, size));
+
+	unsigned int nbytes = 0;
+	while (nbytes < size) {
+		unsigned int addr = address + nbytes;
+		unsigned int slot = (addr / pagesize) % device->cache_npages;
+
+		// Serve the page from the cache.
+		if (device->cache_valid[slot] && device->cache_address[slot] == addr) {
+			memcpy (data + nbytes, device->cache_data + (size_t) slot * pagesize, pagesize);
+			nbytes += pagesize;
+			continue;
+		}
+
+		// Extend the miss to the entire run of uncached pages, so a
+		// cold multi-page request remains a single backend read.
+		unsigned int len = pagesize;
+		while (nbytes + len < size) {
+			unsigned int next = address + nbytes + len;
+			unsigned int nslot = (next / pagesize) % device->cache_npages;
+			if (device->cache_valid[nslot] && device->cache_address[nslot] == next)
+				break;
+			len += pagesize;
+		}
+
+		dc_status_t rc = DC_DEVICE_VTABLE(device)->read (device, addr, data + nbytes, len);
+		if (rc != DC_STATUS_SUCCESS)
+			return device_operation_end (device, rc);
+
+		// Store the pages in the cache.
+		for (unsigned int i = 0; i < len; i += pagesize) {
+			unsigned int page = addr + i;
+			unsigned int pslot = (page / pagesize) % device->cache_npages;
+			memcpy (device->cache_data + (size_t) pslot * pagesize, data + nbytes + i, pagesize);
+			device->cache_address[pslot] = page;
+			device->cache_valid[pslot] = 1;
+		}
+
+		nbytes += len;
+	}
 
-	device->event_callback (device, event, data, device->event_userdata);
+	return device_operation_end (device, DC_STATUS_SUCCESS);
 }
 
 
-int
-device_is_cancelled (dc_device_t *device)
+dc_status_t
+dc_device_read_multiple (dc_device_t *device, const dc_device_range_t ranges[], unsigned int nranges, unsigned char data[], unsigned int size)
 {
 	if (device == NULL)
-		return 0;
+		return DC_STATUS_UNSUPPORTED;
 
-	if (device->cancel_callback == NULL)
-		return 0;
+	if (ranges == NULL && nranges != 0)
+		return DC_STATUS_INVALIDARGS;
 
-	return device->cancel_callback (device->cancel_userdata);
+	// The output buffer must match the total size of the ranges.
+	unsigned int total = 0;
+	for (unsigned int i = 0; i < nranges; ++i) {
+		if (ranges[i].size > size - total)
+			return DC_STATUS_INVALIDARGS;
+		total += ranges[i].size;
+	}
+	if (total != size)
+		return DC_STATUS_INVALIDARGS;
+
+	if (DC_DEVICE_VTABLE(device)->read_multiple) {
+		device_operation_begin (device);
+		return device_operation_end (device,
+			DC_DEVICE_VTABLE(device)->read_multiple (device, ranges, nranges, data, size));
+	}
+
+	if (DC_DEVICE_VTABLE(device)->read == NULL)
+		return DC_STATUS_UNSUPPORTED;
+
+	device_operation_begin (device);
+
+	// Merge adjacent ranges into a single read, so a region split by a
+	// ringbuffer wraparound is fetched with at most two transfers, and
+	// serve each run with dc_device_read, through the read cache when
+	// one is enabled.
+	unsigned int offset = 0;
+	unsigned int i = 0;
+	while (i < nranges) {
+		unsigned int address = ranges[i].address;
+		unsigned int len = ranges[i].size;
+		unsigned int n = i + 1;
+		while (n < nranges && ranges[n].address == address + len) {
+			len += ranges[n].size;
+			n++;
+		}
+
+		dc_status_t rc = dc_device_read (device, address, data + offset, len);
+		if (rc != DC_STATUS_SUCCESS)
+			return device_operation_end (device, rc);
+
+		offset += len;
+		i = n;
+	}
+
+	return device_operation_end (device, DC_STATUS_SUCCESS);
+}
+
+
+dc_status_t
+dc_device_write (dc_device_t *device, unsigned int address, const unsigned char data[], unsigned int size)
+{
+	dc_status_t rc = DC_STATUS_SUCCESS;
+
+	if (device == NULL)
+		return DC_STATUS_UNSUPPORTED;
+
+	if (DC_DEVICE_VTABLE(device)->write == NULL)
+		return DC_STATUS_UNSUPPORTED;
+
+	device_operation_begin (device);
+
+	rc = DC_DEVICE_VTABLE(device)->write (device, address, data, size);
+
+	// Invalidate the cached pages overlapping the written region.
+	for (unsigned int i = 0; i < device->cache_npages; ++i) {
+		if (device->cache_valid[i] &&
+			device->cache_address[i] + device->cache_pagesize > address &&
+			device->cache_address[i] < address + size)
+			device->cache_valid[i] = 0;
+	}
+
+	return device_operation_end (device, rc);
+}
+
+
+dc_status_t
+dc_device_write_multiple (dc_device_t *device, const dc_device_range_t ranges[], unsigned int nranges, const unsigned char data[], unsigned int size)
+{
+	if (device == NULL)
+		return DC_STATUS_UNSUPPORTED;
+
+	if (ranges == NULL && nranges != 0)
+		return DC_STATUS_INVALIDARGS;
+
+	// The input buffer must match the total size of the ranges.
+	unsigned int total = 0;
+	for (unsigned int i = 0; i < nranges; ++i) {
+		if (ranges[i].size > size - total)
+			return DC_STATUS_INVALIDARGS;
+		total += ranges[i].size;
+	}
+	if (total != size)
+		return DC_STATUS_INVALIDARGS;
+
+	if (DC_DEVICE_VTABLE(device)->write == NULL)
+		return DC_STATUS_UNSUPPORTED;
+
+	device_operation_begin (device);
+
+	// Merge adjacent ranges into a single write, so many small settings
+	// updates become a few larger transfers, which the backends can
+	// split along their native block size.
+	unsigned int offset = 0;
+	unsigned int i = 0;
+	while (i < nranges) {
+		unsigned int address = ranges[i].address;
+		unsigned int len = ranges[i].size;
+		unsigned int n = i + 1;
+		while (n < nranges && ranges[n].address == address + len) {
+			len += ranges[n].size;
+			n++;
+		}
+
+		dc_status_t rc = dc_device_write (device, address, data + offset, len);
+		if (rc != DC_STATUS_SUCCESS)
+			return device_operation_end (device, rc);
+
+		offset += len;
+		i = n;
+	}
+
+	// Verify all the written regions with a single bulk read, instead
+	// of a readback after every write. Backends that cannot read their
+	// memory back skip the verification.
+	if (DC_DEVICE_VTABLE(device)->read != NULL && size != 0) {
+		dc_buffer_t *readback = dc_context_buffer_acquire (device->context, size);
+		if (readback == NULL || !dc_buffer_resize (readback, size)) {
+			dc_context_buffer_release (device->context, readback);
+			return device_operation_end (device, DC_STATUS_NOMEMORY);
+		}
+
+		dc_status_t rc = dc_device_read_multiple (device, ranges, nranges, dc_buffer_get_data (readback), size);
+		if (rc == DC_STATUS_SUCCESS &&
+			memcmp (dc_buffer_get_data (readback), data, size) != 0) {
+			ERROR (device->context, "Failed to verify the written data.");
+			rc = DC_STATUS_PROTOCOL;
+		}
+
+		dc_context_buffer_release (device->context, readback);
+
+		if (rc != DC_STATUS_SUCCESS)
+			return device_operation_end (device, rc);
+	}
+
+	return device_operation_end (device, DC_STATUS_SUCCESS);
+}
+
+
+static void
+device_hash_store (dc_device_t *device, const unsigned char data[], unsigned int size)
+{
+	// Hash the data while it is still warm in the cache, right before
+	// it is handed to the application, so consumers don't need an
+	// extra pass over every byte for deduplication or integrity
+	// checks.
+	checksum_hash64_t hash;
+	checksum_hash64_init (&hash);
+	checksum_hash64_update (&hash, data, size);
+	device->hash = checksum_hash64_final (&hash);
+	device->hash_valid = 1;
+}
+
+dc_status_t
+dc_device_dump (dc_device_t *device, dc_buffer_t *buffer)
+{
+	// The dump is always the complete raw memory image. Consumers
+	// (the extract_dives functions and external applications) address
+	// the image with absolute offsets, so constant-fill regions can't
+	// be skipped or compressed here. The streaming protocols (e.g.
+	// reefnet_sensus, uwatec_aladin) transmit the full memory in a
+	// single transaction anyway, without any means to seek past the
+	// empty areas.
+	if (device == NULL)
+		return DC_STATUS_UNSUPPORTED;
+
+	if (DC_DEVICE_VTABLE(device)->dump == NULL)
+		return DC_STATUS_UNSUPPORTED;
+
+	device_operation_begin (device);
+
+	dc_status_t rc = DC_DEVICE_VTABLE(device)->dump (device, buffer);
+
+	if (rc == DC_STATUS_SUCCESS)
+		device_hash_store (device, dc_buffer_get_data (buffer), dc_buffer_get_size (buffer));
+
+	return device_operation_end (device, rc);
+}
+
+
+typedef struct dc_dump_hash_t {
+	dc_dump_callback_t callback;
+	void *userdata;
+	checksum_hash64_t hash;
+} dc_dump_hash_t;
+
+static int
+dc_device_dump_hash_cb (const unsigned char *data, unsigned int size, void *userdata)
+{
+	dc_dump_hash_t *dump = (dc_dump_hash_t *) userdata;
+
+	checksum_hash64_update (&dump->hash, data, size);
+
+	return dump->callback (data, size, dump->userdata);
+}
+
+dc_status_t
+dc_device_dump_stream (dc_device_t *device, dc_dump_callback_t callback, void *userdata)
+{
+	if (device == NULL)
+		return DC_STATUS_UNSUPPORTED;
+
+	if (callback == NULL)
+		return DC_STATUS_INVALIDARGS;
+
+	if (DC_DEVICE_VTABLE(device)->dump_stream) {
+		// Fold the hash into the streaming path, one chunk at a time,
+		// while each chunk is still in the cache.
+		dc_dump_hash_t dump = {callback, userdata};
+		checksum_hash64_init (&dump.hash);
+		device_operation_begin (device);
+		dc_status_t rc = DC_DEVICE_VTABLE(device)->dump_stream (device, dc_device_dump_hash_cb, &dump);
+		if (rc == DC_STATUS_SUCCESS) {
+			device->hash = checksum_hash64_final (&dump.hash);
+			device->hash_valid = 1;
+		}
+		return device_operation_end (device, rc);
+	}
+
+	// Fall back to a full in-memory dump, delivered in chunks
+	// afterwards. This keeps the callback contract, but not the memory
+	// bound.
+	dc_buffer_t *buffer = dc_buffer_new (0);
+	if (buffer == NULL)
+		return DC_STATUS_NOMEMORY;
+
+	device_operation_begin (device);
+
+	dc_status_t rc = dc_device_dump (device, buffer);
+	if (rc == DC_STATUS_SUCCESS) {
+		const unsigned char *data = dc_buffer_get_data (buffer);
+		size_t size = dc_buffer_get_size (buffer);
+		size_t offset = 0;
+		while (offset < size) {
+			size_t len = size - offset;
+			if (len > 4096)
+				len = 4096;
+			if (!callback (data + offset, len, userdata)) {
+				rc = DC_STATUS_CANCELLED;
+				break;
+			}
+			offset += len;
+		}
+	}
+
+	dc_buffer_free (buffer);
+
+	return device_operation_end (device, rc);
+}
+
+
+dc_status_t
+device_dump_read (dc_device_t *device, unsigned char data[], unsigned int size, unsigned int blocksize)
+{
+	if (device == NULL)
+		return DC_STATUS_UNSUPPORTED;
+
+	if (DC_DEVICE_VTABLE(device)->read == NULL)
+		return DC_STATUS_UNSUPPORTED;
+
+	device->dump_position = 0;
+
+	// Resume an interrupted dump from the partial data of a previous
+	// attempt, see dc_device_dump_resume. The resume position is the
+	// largest whole number of blocks covered by the partial data. The
+	// last block before that position is read back from the device and
+	// compared against the partial data, to detect whether the device
+	// contents changed since the previous attempt.
+	unsigned int skip = 0;
+	if (device->resume_data && device->resume_size >= blocksize) {
+		skip = device->resume_size;
+		if (skip > size)
+			skip = size;
+		skip -= skip % blocksize;
+	}
+	if (skip) {
+		unsigned char *block = (unsigned char *) dc_context_malloc (device->context, blocksize);
+		if (block == NULL) {
+			ERROR (device->context, "Failed to allocate memory.");
+			return DC_STATUS_NOMEMORY;
+		}
+
+		dc_status_t rc = DC_DEVICE_VTABLE(device)->read (device, skip - blocksize, block, blocksize);
+		if (rc != DC_STATUS_SUCCESS) {
+			dc_context_mfree (device->context, block);
+			return rc;
+		}
+
+		if (memcmp (block, device->resume_data + skip - blocksize, blocksize) == 0) {
+			memcpy (data, device->resume_data, skip);
+		} else {
+			WARNING (device->context, "Device contents changed, restarting from the beginning.");
+			skip = 0;
+		}
+
+		dc_context_mfree (device->context, block);
+	}
+
+	// Enable progress notifications.
+	dc_event_progress_t progress = EVENT_PROGRESS_INITIALIZER;
+	progress.maximum = size;
+	progress.current = skip;
+	device_event_emit (device, DC_EVENT_PROGRESS, &progress);
+
+	unsigned int nbytes = skip;
+	device->dump_position = nbytes;
+	while (nbytes < size) {
+		// Calculate the packet size.
+		unsigned int len = size - nbytes;
+		if (len > blocksize)
+			len = blocksize;
+
+		// Read the packet.
+		dc_status_t rc = DC_DEVICE_VTABLE(device)->read (device, nbytes, data + nbytes, len);
+		if (rc != DC_STATUS_SUCCESS)
+			return rc;
+
+		// Update and emit a progress event.
+		progress.current += len;
+		device_event_emit (device, DC_EVENT_PROGRESS, &progress);
+
+		nbytes += len;
+		device->dump_position = nbytes;
+	}
+
+	return DC_STATUS_SUCCESS;
+}
+
+
+dc_status_t
+dc_device_get_hash (dc_device_t *device, unsigned long long *hash)
+{
+	if (device == NULL)
+		return DC_STATUS_UNSUPPORTED;
+
+	if (hash == NULL)
+		return DC_STATUS_INVALIDARGS;
+
+	if (!device->hash_valid)
+		return DC_STATUS_UNSUPPORTED;
+
+	*hash = device->hash;
+
+	return DC_STATUS_SUCCESS;
+}
+
+typedef struct dc_foreach_filter_t {
+	dc_device_t *device;
+	dc_dive_callback_t callback;
+	void *userdata;
+	// Foreach budget, see dc_device_set_foreach_limit.
+	unsigned int started;
+	unsigned int skipped;
+	unsigned int delivered;
+} dc_foreach_filter_t;
+
+static int
+dc_device_foreach_filter_cb (const unsigned char *data, unsigned int size, const unsigned char *fingerprint, unsigned int fsize, void *userdata)
+{
+	dc_foreach_filter_t *filter = (dc_foreach_filter_t *) userdata;
+	dc_device_t *device = filter->device;
+
+	// Skip dives that are already known, but keep enumerating. The set
+	// contains individual dives, not just the newest prefix, so later
+	// dives may still be new.
+	if (device_fingerprint_known (device, fingerprint, fsize))
+		return 1;
+
+	// Stop once the time budget is exceeded. The dives delivered so
+	// far remain valid partial results.
+	if (device->foreach_timeout &&
+		device_timestamp () - filter->started >= device->foreach_timeout)
+		return 0;
+
+	// Skip the dives that were already delivered by a previous,
+	// interrupted enumeration.
+	if (filter->skipped < device->foreach_skip) {
+		filter->skipped++;
+		return 1;
+	}
+
+	device->ndives++;
+	device->divebytes += size;
+
+	filter->delivered++;
+
+	device_hash_store (device, data, size);
+
+	// The application callback is a safe idle window for the keepalive
+	// service: the backend is blocked here, with no protocol exchange
+	// outstanding, and the callback can take arbitrarily long (parsing,
+	// database writes, user interaction).
+	device_keepalive_allow (device);
+	int result = filter->callback (data, size, fingerprint, fsize, filter->userdata);
+	device_keepalive_forbid (device);
+
+	// Stop once the requested number of dives has been delivered.
+	if (device->foreach_maxdives &&
+		filter->delivered >= device->foreach_maxdives)
+		return 0;
+
+	return result;
+}
+
+dc_status_t
+dc_device_foreach (dc_device_t *device, dc_dive_callback_t callback, void *userdata)
+{
+	if (device == NULL)
+		return DC_STATUS_UNSUPPORTED;
+
+	if (DC_DEVICE_VTABLE(device)->foreach == NULL)
+		return DC_STATUS_UNSUPPORTED;
+
+	device_operation_begin (device);
+
+	// Filter out the known dives, apply the foreach budget, and count
+	// the delivered dives.
+	if (callback) {
+		dc_foreach_filter_t filter = {device, callback, userdata, device_timestamp (), 0, 0};
+		return device_operation_end (device,
+			DC_DEVICE_VTABLE(device)->foreach (device, dc_device_foreach_filter_cb, &filter));
+	}
+
+	return device_operation_end (device,
+		DC_DEVICE_VTABLE(device)->foreach (device, callback, userdata));
+}
+
+
+dc_status_t
+dc_device_dump_delta (dc_device_t *device, dc_buffer_t *buffer, dc_buffer_t *previous)
+{
+	if (device == NULL)
+		return DC_STATUS_UNSUPPORTED;
+
+	if (buffer == NULL)
+		return DC_STATUS_INVALIDARGS;
+
+	if (DC_DEVICE_VTABLE(device)->dump_delta) {
+		device_operation_begin (device);
+		return device_operation_end (device,
+			DC_DEVICE_VTABLE(device)->dump_delta (device, buffer, previous));
+	}
+
+	return dc_device_dump (device, buffer);
+}
+
+
+dc_status_t
+dc_dump_diff (dc_buffer_t *current, dc_buffer_t *previous, unsigned int rb_begin, unsigned int rb_end, dc_device_range_t extents[], unsigned int nextents, unsigned int *actual)
+{
+	if (current == NULL || previous == NULL || actual == NULL ||
+		extents == NULL || nextents == 0)
+		return DC_STATUS_INVALIDARGS;
+
+	const unsigned char *cdata = dc_buffer_get_data (current);
+	const unsigned char *pdata = dc_buffer_get_data (previous);
+	unsigned int size = dc_buffer_get_size (current);
+
+	*actual = 0;
+
+	// Dumps with a different size can't be compared. Report the entire
+	// current dump as new data.
+	if (dc_buffer_get_size (previous) != size) {
+		if (size) {
+			extents[0].address = 0;
+			extents[0].size = size;
+			*actual = 1;
+		}
+		return DC_STATUS_SUCCESS;
+	}
+
+	// Clamp the ringbuffer boundaries to the dump.
+	if (rb_end > size)
+		rb_end = size;
+	if (rb_begin > rb_end)
+		rb_begin = rb_end;
+
+	unsigned int count = 0;
+	unsigned int offset = 0;
+	while (offset < size) {
+		// Skip the unchanged data.
+		if (cdata[offset] == pdata[offset]) {
+			offset++;
+			continue;
+		}
+
+		// Bound the run at the next ringbuffer boundary, so no extent
+		// straddles it and the caller can reason in ringbuffer order.
+		unsigned int begin = offset;
+		unsigned int limit = size;
+		if (begin < rb_begin)
+			limit = rb_begin;
+		else if (begin < rb_end)
+			limit = rb_end;
+		while (offset < limit && cdata[offset] != pdata[offset])
+			offset++;
+
+		if (count < nextents) {
+			extents[count].address = begin;
+			extents[count].size = offset - begin;
+			count++;
+		} else {
+			// Out of extents. Extend the last one to keep covering all
+			// differences, at the cost of including unchanged data.
+			extents[count - 1].size = offset - extents[count - 1].address;
+		}
+	}
+
+	*actual = count;
+
+	return DC_STATUS_SUCCESS;
+}
+
+
+dc_status_t
+dc_device_dump_resume (dc_device_t *device, dc_buffer_t *buffer, dc_buffer_t *previous)
+{
+	dc_status_t rc = DC_STATUS_SUCCESS;
+
+	if (device == NULL)
+		return DC_STATUS_UNSUPPORTED;
+
+	if (buffer == NULL || buffer == previous)
+		return DC_STATUS_INVALIDARGS;
+
+	if (DC_DEVICE_VTABLE(device)->dump == NULL)
+		return DC_STATUS_UNSUPPORTED;
+
+	// Install the partial data for the duration of the dump. Backends
+	// that transfer through device_dump_read pick it up there; the
+	// others simply perform a full dump.
+	device->resume_data = previous ? dc_buffer_get_data (previous) : NULL;
+	device->resume_size = previous ? dc_buffer_get_size (previous) : 0;
+
+	device_operation_begin (device);
+
+	rc = DC_DEVICE_VTABLE(device)->dump (device, buffer);
+
+	device_operation_end (device, rc);
+
+	device->resume_data = NULL;
+	device->resume_size = 0;
+
+	return rc;
+}
+
+
+dc_status_t
+dc_device_dump_position (dc_device_t *device, unsigned int *position)
+{
+	if (device == NULL)
+		return DC_STATUS_UNSUPPORTED;
+
+	if (position == NULL)
+		return DC_STATUS_INVALIDARGS;
+
+	*position = device->dump_position;
+
+	return DC_STATUS_SUCCESS;
+}
+
+
+typedef struct dc_foreach_buffer_t {
+	dc_device_t *device;
+	dc_dive_buffer_callback_t callback;
+	void *userdata;
+} dc_foreach_buffer_t;
+
+static int
+dc_device_foreach_buffer_cb (const unsigned char *data, unsigned int size, const unsigned char *fingerprint, unsigned int fsize, void *userdata)
+{
+	dc_foreach_buffer_t *foreach = (dc_foreach_buffer_t *) userdata;
+
+	// Skip the known dives before copying the data.
+	if (device_fingerprint_known (foreach->device, fingerprint, fsize))
+		return 1;
+
+	foreach->device->ndives++;
+	foreach->device->divebytes += size;
+
+	dc_buffer_t *buffer = dc_buffer_new (size);
+	if (buffer == NULL)
+		return 0;
+
+	if (!dc_buffer_append (buffer, data, size)) {
+		dc_buffer_free (buffer);
+		return 0;
+	}
+
+	device_hash_store (foreach->device, data, size);
+
+	// The callback takes ownership of the buffer. It's a safe idle
+	// window for the keepalive service, see dc_device_foreach_filter_cb.
+	device_keepalive_allow (foreach->device);
+	int result = foreach->callback (buffer, fingerprint, fsize, foreach->userdata);
+	device_keepalive_forbid (foreach->device);
+
+	return result;
+}
+
+static int
+dc_device_foreach_buffer_filter_cb (dc_buffer_t *buffer, const unsigned char *fingerprint, unsigned int fsize, void *userdata)
+{
+	dc_foreach_buffer_t *foreach = (dc_foreach_buffer_t *) userdata;
+
+	// Skip the known dives. The buffer is owned here, so it has to be
+	// released instead of handed over.
+	if (device_fingerprint_known (foreach->device, fingerprint, fsize)) {
+		dc_buffer_free (buffer);
+		return 1;
+	}
+
+	foreach->device->ndives++;
+	foreach->device->divebytes += dc_buffer_get_size (buffer);
+
+	device_hash_store (foreach->device, dc_buffer_get_data (buffer), dc_buffer_get_size (buffer));
+
+	// Safe idle window, see dc_device_foreach_filter_cb.
+	device_keepalive_allow (foreach->device);
+	int result = foreach->callback (buffer, fingerprint, fsize, foreach->userdata);
+	device_keepalive_forbid (foreach->device);
+
+	return result;
+}
+
+dc_status_t
+dc_device_foreach_buffer (dc_device_t *device, dc_dive_buffer_callback_t callback, void *userdata)
+{
+	dc_foreach_buffer_t foreach = {device, callback, userdata};
+
+	if (device == NULL)
+		return DC_STATUS_UNSUPPORTED;
+
+	if (callback == NULL)
+		return DC_STATUS_INVALIDARGS;
+
+	if (DC_DEVICE_VTABLE(device)->foreach_buffer) {
+		device_operation_begin (device);
+		return device_operation_end (device,
+			DC_DEVICE_VTABLE(device)->foreach_buffer (device, dc_device_foreach_buffer_filter_cb, &foreach));
+	}
+
+	if (DC_DEVICE_VTABLE(device)->foreach == NULL)
+		return DC_STATUS_UNSUPPORTED;
+
+	device_operation_begin (device);
+
+	return device_operation_end (device,
+		DC_DEVICE_VTABLE(device)->foreach (device, dc_device_foreach_buffer_cb, &foreach));
+}
+
+
+dc_status_t
+dc_device_enumerate (dc_device_t *device, dc_dive_summary_callback_t callback, void *userdata)
+{
+	if (device == NULL)
+		return DC_STATUS_UNSUPPORTED;
+
+	if (callback == NULL)
+		return DC_STATUS_INVALIDARGS;
+
+	if (DC_DEVICE_VTABLE(device)->enumerate == NULL)
+		return DC_STATUS_UNSUPPORTED;
+
+	device_operation_begin (device);
+
+	return device_operation_end (device,
+		DC_DEVICE_VTABLE(device)->enumerate (device, callback, userdata));
+}
+
+
+dc_status_t
+dc_device_close (dc_device_t *device)
+{
+	dc_status_t status = DC_STATUS_SUCCESS;
+
+	if (device == NULL)
+		return DC_STATUS_SUCCESS;
+
+	// Stop the keepalive service before closing the transport.
+	device_keepalive_stop (device);
+
+	// Disable the cancellation callback.
+	device->cancel_callback = NULL;
+	device->cancel_userdata = NULL;
+
+	if (DC_DEVICE_VTABLE(device)->close) {
+		status = DC_DEVICE_VTABLE(device)->close (device);
+	}
+
+	// Emit the session summary. The transfer statistics have been
+	// cached when the backend emitted them from its close entry, so
+	// the summary covers the entire connection.
+	dc_event_session_t session;
+	session.elapsed = device_timestamp () - device->opened;
+	session.rbytes = device->metrics.rbytes;
+	session.wbytes = device->metrics.wbytes;
+	session.retries = device->metrics.retries;
+	session.ndives = device->ndives;
+	session.divebytes = device->divebytes;
+	device_event_emit (device, DC_EVENT_SESSION, &session);
+
+	unsigned int throughput = 0;
+	if (session.elapsed)
+		throughput = (unsigned long long) (session.rbytes + session.wbytes) * 1000 / session.elapsed;
+	INFO (device->context, "Session: %u ms, %u dives (%u bytes), %u bytes in, %u bytes out, %u retries, %u bytes/s.",
+		session.elapsed, session.ndives, session.divebytes,
+		session.rbytes, session.wbytes, session.retries, throughput);
+
+	dc_device_deallocate (device);
+
+	return status;
+}
+
+
+typedef struct dc_device_close_t {
+	dc_device_t *device;
+	dc_device_close_callback_t callback;
+	void *userdata;
+} dc_device_close_t;
+
+static void *
+dc_device_close_worker (void *arg)
+{
+	dc_device_close_t *closure = (dc_device_close_t *) arg;
+
+	dc_status_t status = dc_device_close (closure->device);
+
+	if (closure->callback)
+		closure->callback (status, closure->userdata);
+
+	free (closure);
+
+	return NULL;
+}
+
+dc_status_t
+dc_device_close_async (dc_device_t *device, dc_device_close_callback_t callback, void *userdata)
+{
+	dc_device_close_t *closure = NULL;
+	dc_thread_t thread;
+
+	closure = (dc_device_close_t *) malloc (sizeof (dc_device_close_t));
+	if (closure != NULL) {
+		closure->device = device;
+		closure->callback = callback;
+		closure->userdata = userdata;
+
+		if (dc_thread_create (&thread, dc_device_close_worker, closure) == 0) {
+			dc_thread_detach (&thread);
+			return DC_STATUS_SUCCESS;
+		}
+
+		free (closure);
+	}
+
+	// Without a background thread, close synchronously and deliver the
+	// completion from the calling thread, so the callback contract
+	// remains the same.
+	dc_status_t status = dc_device_close (device);
+
+	if (callback)
+		callback (status, userdata);
+
+	return status;
+}
+
+
+static unsigned int
+device_timestamp (void)
+{
+#ifdef _WIN32
+	return GetTickCount ();
+#else
+	struct timeval now;
+	if (gettimeofday (&now, NULL) != 0)
+		return 0;
+	return now.tv_sec * 1000 + now.tv_usec / 1000;
+#endif
+}
+
+
+void
+device_event_emit (dc_device_t *device, dc_event_type_t event, const void *data)
+{
+	dc_event_progress_t *progress = (dc_event_progress_t *) data;
+
+	// Check the event data for errors.
+	switch (event) {
+	case DC_EVENT_WAITING:
+		assert (data == NULL);
+		break;
+	case DC_EVENT_PROGRESS:
+		assert (progress != NULL);
+		assert (progress->maximum != 0);
+		assert (progress->maximum >= progress->current);
+		break;
+	case DC_EVENT_DEVINFO:
+		assert (data != NULL);
+		break;
+	case DC_EVENT_CLOCK:
+		assert (data != NULL);
+		break;
+	default:
+		break;
+	}
+
+	if (device == NULL)
+		return;
+
+	// Cache the event data.
+	switch (event) {
+	case DC_EVENT_DEVINFO:
+		device->devinfo = *(dc_event_devinfo_t *) data;
+		device->devinfo_valid = 1;
+		break;
+	case DC_EVENT_CLOCK:
+		device->clock = *(dc_event_clock_t *) data;
+		device->clock_valid = 1;
+		break;
+	case DC_EVENT_METRICS:
+		device->metrics = *(dc_event_metrics_t *) data;
+		break;
+	default:
+		break;
+	}
+
+	// Check if there is a callback function registered.
+	if (device->event_callback == NULL)
+		return;
+
+	// Check the event mask. Progress events are still processed when
+	// only the estimate is subscribed, because the estimates are
+	// derived from them.
+	if ((event & device->event_mask) == 0 &&
+		!(event == DC_EVENT_PROGRESS && (device->event_mask & DC_EVENT_ESTIMATE)))
+		return;
+
+	// Coalesce the progress events. The first and last event are
+	// always delivered, so the callback sees the start and the
+	// completion of the operation.
+	if (event == DC_EVENT_PROGRESS &&
+		(device->progress_interval || device->progress_delta) &&
+		progress->current != 0 && progress->current != progress->maximum) {
+		unsigned int now = device_timestamp ();
+		unsigned int elapsed = now - device->progress_time;
+		unsigned int advanced = progress->current - device->progress_value;
+		if (!(device->progress_interval && elapsed >= device->progress_interval) &&
+			!(device->progress_delta && advanced >= device->progress_delta))
+			return;
+		device->progress_time = now;
+		device->progress_value = progress->current;
+	}
+
+	if (event & device->event_mask)
+		device->event_callback (device, event, data, device->event_userdata);
+
+	// Follow each delivered progress event with a transfer estimate.
+	// The rate is measured against the anchor at the start of the
+	// current phase, so a slow logbook phase doesn't distort the
+	// estimate of a fast profile phase (or vice versa).
+	if (event == DC_EVENT_PROGRESS && (device->event_mask & DC_EVENT_ESTIMATE)) {
+		unsigned int now = device_timestamp ();
+		if (!device->phase_valid || progress->current < device->phase_value) {
+			device->phase_time = now;
+			device->phase_value = progress->current;
+			device->phase_valid = 1;
+		}
+		unsigned int elapsed = now - device->phase_time;
+		unsigned int advanced = progress->current - device->phase_value;
+
+		dc_event_estimate_t estimate;
+		estimate.phase = device->phase;
+		estimate.nphases = device->nphases;
+		estimate.current = progress->current;
+		estimate.maximum = progress->maximum;
+		estimate.rate = 0;
+		estimate.remaining = 0;
+		if (elapsed && advanced) {
+			estimate.rate = (unsigned long long) advanced * 1000 / elapsed;
+			estimate.remaining = (unsigned long long) (progress->maximum - progress->current) * elapsed / advanced;
+		}
+
+		device->event_callback (device, DC_EVENT_ESTIMATE, &estimate, device->event_userdata);
+	}
+}
+
+
+void
+device_progress_phase (dc_device_t *device, unsigned int phase, unsigned int nphases)
+{
+	if (device == NULL)
+		return;
+
+	device->phase = phase;
+	device->nphases = nphases;
+
+	// Re-anchor the rate measurement at the next progress event.
+	device->phase_valid = 0;
+}
+
+
+int
+device_is_cancelled (dc_device_t *device)
+{
+	if (device == NULL)
+		return 0;
+
+	// The flag is a single aligned read, so checking it costs nothing
+	// on the hot path, and it doesn't call back into application code.
+	if (device->cancelled)
+		return 1;
+
+	// A session that exceeded its time budget behaves like a
+	// cancellation, so the abort propagates through the transfer
+	// loops and the transport layer alike.
+	if (device->budget &&
+		device_timestamp () - device->opened >= device->budget)
+		return 1;
+
+	// The same holds for an operation that exceeded its per-operation
+	// deadline. The transport layer polls this check every timeslice
+	// while waiting for data, so a hung read is abandoned within one
+	// slice of the deadline, instead of running every retry out to its
+	// full timeout.
+	if (device->deadline && device->op_depth &&
+		device_timestamp () - device->op_start >= device->deadline)
+		return 1;
+
+	if (device->cancel_callback == NULL)
+		return 0;
+
+	return device->cancel_callback (device->cancel_userdata);
+}
+
+
+unsigned int
+device_retry_limit (dc_device_t *device, unsigned int maxretries)
+{
+	if (device == NULL || device->maxretries < 0)
+		return maxretries;
+
+	return (unsigned int) device->maxretries;
+}
+
+
+int
+device_cancel_cb (void *userdata)
+{
+	return device_is_cancelled ((dc_device_t *) userdata);
+}
+
+
+int
+device_sleep_while_waiting (dc_device_t *device, unsigned int milliseconds)
+{
+	int woken = 0;
+
+	dc_mutex_lock (&device->wake_mutex);
+	while (!device->wake) {
+		if (dc_cond_timedwait (&device->wake_cond, &device->wake_mutex, milliseconds) != 0)
+			break; // Timeout or error.
+	}
+	if (device->wake) {
+		device->wake = 0;
+		woken = 1;
+	}
+	dc_mutex_unlock (&device->wake_mutex);
+
+	return woken;
+}
+
+
+dc_status_t
+device_scratch_reserve (dc_device_t *device, unsigned int size)
+{
+	if (device == NULL)
+		return DC_STATUS_INVALIDARGS;
+
+	if (size <= device->scratch_size)
+		return DC_STATUS_SUCCESS;
+
+	// Growing would invalidate the outstanding frames.
+	if (device->scratch_top) {
+		ERROR (device->context, "Scratch region in use.");
+		return DC_STATUS_INVALIDARGS;
+	}
+
+	unsigned char *scratch = (unsigned char *) dc_context_malloc (device->context, size);
+	if (scratch == NULL) {
+		ERROR (device->context, "Failed to allocate memory.");
+		return DC_STATUS_NOMEMORY;
+	}
+
+	dc_context_mfree (device->context, device->scratch);
+	device->scratch = scratch;
+	device->scratch_size = size;
+
+	return DC_STATUS_SUCCESS;
+}
+
+
+unsigned char *
+device_scratch_push (dc_device_t *device, unsigned int size)
+{
+	if (device == NULL)
+		return NULL;
+
+	if (size > device->scratch_size - device->scratch_top) {
+		// Grow the region, but only while no frames are outstanding.
+		if (device->scratch_top)
+			return NULL;
+
+		if (device_scratch_reserve (device, size) != DC_STATUS_SUCCESS)
+			return NULL;
+	}
+
+	unsigned char *frame = device->scratch + device->scratch_top;
+	device->scratch_top += size;
+
+	return frame;
+}
+
+
+void
+device_scratch_pop (dc_device_t *device, unsigned int size)
+{
+	if (device == NULL)
+		return;
+
+	assert (size <= device->scratch_top);
+
+	device->scratch_top -= size;
 }
@@ -50,6 +50,9 @@
 #define RB_PROFILE_BEGIN 0x03E8
 #define RB_PROFILE_END   SZ_MEMORY
 
+#define NBLOCKS        (SZ_MEMORY / SZ_PACKET)
+#define NBLOCKS_HEADER ((RB_PROFILE_BEGIN + SZ_PACKET - 1) / SZ_PACKET)
+
 typedef struct diverite_nitekq_device_t {
 	dc_device_t base;
 	dc_serial_t *port;
@@ -62,7 +65,7 @@ static dc_status_t diverite_nitekq_device_dump (dc_device_t *abstract, dc_buffer
 static dc_status_t diverite_nitekq_device_foreach (dc_device_t *abstract, dc_dive_callback_t callback, void *userdata);
 static dc_status_t diverite_nitekq_device_close (dc_device_t *abstract);
 
-static const dc_device_vtable_t diverite_nitekq_device_vtable = {
+DC_VTABLE_STORAGE const dc_device_vtable_t diverite_nitekq_device_vtable = {
 	sizeof(diverite_nitekq_device_t),
 	DC_FAMILY_DIVERITE_NITEKQ,
 	diverite_nitekq_device_set_fingerprint, /* set_fingerprint */
@@ -120,6 +123,49 @@ diverite_nitekq_receive (diverite_nitekq_device_t *device, unsigned char data[],
 }
 
 
+static dc_status_t
+diverite_nitekq_read_blocks (diverite_nitekq_device_t *device, unsigned char data[], unsigned int begin, unsigned int end, unsigned int *nrequested, dc_event_progress_t *progress)
+{
+	dc_device_t *abstract = (dc_device_t *) device;
+	dc_status_t rc = DC_STATUS_SUCCESS;
+
+	for (unsigned int i = begin; i < end; ++i) {
+		// Request the block, unless it was already requested ahead of
+		// time during the previous iteration.
+		if (*nrequested <= i) {
+			rc = diverite_nitekq_send (device, BLOCK);
+			if (rc != DC_STATUS_SUCCESS) {
+				return rc;
+			}
+			(*nrequested)++;
+		}
+
+		// Request the next block ahead of time, so the device prepares
+		// it while the answer of the current block is still being
+		// received, instead of afterwards.
+		if (*nrequested == i + 1 && *nrequested < end) {
+			rc = diverite_nitekq_send (device, BLOCK);
+			if (rc != DC_STATUS_SUCCESS) {
+				return rc;
+			}
+			(*nrequested)++;
+		}
+
+		// Receive the memory block.
+		rc = diverite_nitekq_receive (device, data + i * SZ_PACKET, SZ_PACKET);
+		if (rc != DC_STATUS_SUCCESS) {
+			return rc;
+		}
+
+		// Update and emit a progress event.
+		progress->current += SZ_PACKET;
+		device_event_emit (abstract, DC_EVENT_PROGRESS, progress);
+	}
+
+	return DC_STATUS_SUCCESS;
+}
+
+
 static dc_status_t
 diverite_nitekq_handshake (diverite_nitekq_device_t *device)
 {
@@ -172,6 +218,9 @@ diverite_nitekq_device_open (dc_device_t **out, dc_context_t *context, const cha
 		goto error_free;
 	}
 
+	// Forward cancellation requests to the serial layer.
+	dc_serial_set_cancel (device->port, device_cancel_cb, device);
+
 	// Set the serial communication protocol (9600 8N1).
 	status = dc_serial_configure (device->port, 9600, 8, DC_PARITY_NONE, DC_STOPBITS_ONE, DC_FLOWCONTROL_NONE);
 	if (status != DC_STATUS_SUCCESS) {
@@ -304,45 +353,158 @@ diverite_nitekq_device_dump (dc_device_t *abstract, dc_buffer_t *buffer)
 		return rc;
 	}
 
-	for (unsigned int i = 0; i < 128; ++i) {
-		// Request the next memory block.
-		rc = diverite_nitekq_send (device, BLOCK);
-		if (rc != DC_STATUS_SUCCESS) {
-			return rc;
-		}
+	// Download all the memory blocks, with the block requests pipelined.
+	if (!dc_buffer_resize (buffer, SZ_PACKET + SZ_MEMORY)) {
+		ERROR (abstract->context, "Insufficient buffer space available.");
+		return DC_STATUS_NOMEMORY;
+	}
 
-		// Receive the memory block.
-		rc = diverite_nitekq_receive (device, packet, sizeof (packet));
-		if (rc != DC_STATUS_SUCCESS) {
-			return rc;
-		}
+	unsigned int nrequested = 0;
+	return diverite_nitekq_read_blocks (device,
+		dc_buffer_get_data (buffer) + SZ_PACKET, 0, NBLOCKS, &nrequested, &progress);
+}
 
-		dc_buffer_append (buffer, packet, sizeof (packet));
 
-		// Update and emit a progress event.
-		progress.current += SZ_PACKET;
-		device_event_emit (abstract, DC_EVENT_PROGRESS, &progress);
+// Determine how far into the profile ringbuffer the dives newer than
+// the fingerprint extend, from the logbook and address entries in the
+// header blocks. The data pointer refers to the start of the memory
+// (excluding the artificial first packet). Returns RB_PROFILE_END when
+// everything is needed: with no (matching) fingerprint, with a dive
+// that wraps around the end of the ringbuffer, or with pointers that
+// are invalid, so the extraction can report them on complete data.
+static unsigned int
+diverite_nitekq_profile_end (diverite_nitekq_device_t *device, const unsigned char data[])
+{
+	// Get the end of profile pointer.
+	unsigned int eop = array_uint16_be (data + EOP);
+	if (eop < RB_PROFILE_BEGIN || eop >= RB_PROFILE_END)
+		return RB_PROFILE_END;
+
+	unsigned int end = RB_PROFILE_BEGIN;
+	unsigned int previous = eop;
+	for (unsigned int i = 0; i < 10; ++i) {
+		// Get the pointer to the logbook entry.
+		const unsigned char *p = data + LOGBOOK + i * SZ_LOGBOOK;
+
+		// Abort if an empty logbook is found.
+		if (array_isequal (p, SZ_LOGBOOK, 0x00))
+			break;
+
+		// Get the address of the profile data.
+		unsigned int address = array_uint16_be (data + ADDRESS + i * 2);
+		if (address < RB_PROFILE_BEGIN || address >= RB_PROFILE_END)
+			return RB_PROFILE_END;
+
+		// Check the fingerprint data.
+		if (memcmp (p, device->fingerprint, sizeof (device->fingerprint)) == 0)
+			break;
+
+		// A dive that wraps around the end of the ringbuffer needs the
+		// data all the way up to the end.
+		if (address > previous)
+			return RB_PROFILE_END;
+
+		if (previous > end)
+			end = previous;
+		previous = address;
 	}
 
-	return DC_STATUS_SUCCESS;
+	return end;
 }
 
 
 static dc_status_t
 diverite_nitekq_device_foreach (dc_device_t *abstract, dc_dive_callback_t callback, void *userdata)
 {
-	dc_buffer_t *buffer = dc_buffer_new (0);
+	diverite_nitekq_device_t *device = (diverite_nitekq_device_t *) abstract;
+	dc_status_t rc = DC_STATUS_SUCCESS;
+
+	// Allocate the full size memory image. The blocks that are not
+	// downloaded remain zero, and are never touched by the extraction,
+	// because they hold only dives older than the fingerprint.
+	dc_buffer_t *buffer = dc_buffer_new (SZ_PACKET + SZ_MEMORY);
 	if (buffer == NULL)
 		return DC_STATUS_NOMEMORY;
 
-	dc_status_t rc = diverite_nitekq_device_dump (abstract, buffer);
+	if (!dc_buffer_resize (buffer, SZ_PACKET + SZ_MEMORY)) {
+		dc_buffer_free (buffer);
+		return DC_STATUS_NOMEMORY;
+	}
+
+	unsigned char *data = dc_buffer_get_data (buffer);
+	memset (data, 0, SZ_PACKET + SZ_MEMORY);
+
+	// Enable progress notifications.
+	dc_event_progress_t progress = EVENT_PROGRESS_INITIALIZER;
+	progress.maximum = SZ_PACKET + SZ_MEMORY;
+	device_event_emit (abstract, DC_EVENT_PROGRESS, &progress);
+
+	// Emit a vendor event.
+	dc_event_vendor_t vendor;
+	vendor.data = device->version;
+	vendor.size = sizeof (device->version);
+	device_event_emit (abstract, DC_EVENT_VENDOR, &vendor);
+
+	// Emit a device info event.
+	dc_event_devinfo_t devinfo;
+	devinfo.model = 0;
+	devinfo.firmware = 0;
+	devinfo.serial = array_uint32_be (device->version + 0x0A);
+	device_event_emit (abstract, DC_EVENT_DEVINFO, &devinfo);
+
+	// Send the upload request. It's not clear whether this request is
+	// actually needed, but let's send it anyway.
+	rc = diverite_nitekq_send (device, UPLOAD);
+	if (rc != DC_STATUS_SUCCESS) {
+		dc_buffer_free (buffer);
+		return rc;
+	}
+
+	// Receive the response packet.
+	rc = diverite_nitekq_receive (device, data, SZ_PACKET);
+	if (rc != DC_STATUS_SUCCESS) {
+		dc_buffer_free (buffer);
+		return rc;
+	}
+
+	// Update and emit a progress event.
+	progress.current += SZ_PACKET;
+	device_event_emit (abstract, DC_EVENT_PROGRESS, &progress);
+
+	// Send the request to initiate downloading memory blocks.
+	rc = diverite_nitekq_send (device, RESET);
+	if (rc != DC_STATUS_SUCCESS) {
+		dc_buffer_free (buffer);
+		return rc;
+	}
+
+	// Download the header blocks, containing the logbook and address
+	// entries and the end of profile pointer.
+	unsigned int nrequested = 0;
+	rc = diverite_nitekq_read_blocks (device, data + SZ_PACKET, 0, NBLOCKS_HEADER, &nrequested, &progress);
+	if (rc != DC_STATUS_SUCCESS) {
+		dc_buffer_free (buffer);
+		return rc;
+	}
+
+	// Determine how far into the profile ringbuffer the new dives
+	// extend, and correct the progress maximum accordingly. The blocks
+	// can only be read in sequence, but the download stops once all the
+	// new dives are covered.
+	unsigned int end = diverite_nitekq_profile_end (device, data + SZ_PACKET);
+	unsigned int nblocks = (end + SZ_PACKET - 1) / SZ_PACKET;
+
+	progress.maximum = SZ_PACKET + nblocks * SZ_PACKET;
+	device_event_emit (abstract, DC_EVENT_PROGRESS, &progress);
+
+	// Download the remaining blocks.
+	rc = diverite_nitekq_read_blocks (device, data + SZ_PACKET, NBLOCKS_HEADER, nblocks, &nrequested, &progress);
 	if (rc != DC_STATUS_SUCCESS) {
 		dc_buffer_free (buffer);
 		return rc;
 	}
 
-	rc = diverite_nitekq_extract_dives (abstract,
-		dc_buffer_get_data (buffer), dc_buffer_get_size (buffer), callback, userdata);
+	rc = diverite_nitekq_extract_dives (abstract, data, SZ_PACKET + SZ_MEMORY, callback, userdata);
 
 	dc_buffer_free (buffer);
 
@@ -53,7 +53,7 @@ static dc_status_t diverite_nitekq_parser_get_datetime (dc_parser_t *abstract, d
 static dc_status_t diverite_nitekq_parser_get_field (dc_parser_t *abstract, dc_field_type_t type, unsigned int flags, void *value);
 static dc_status_t diverite_nitekq_parser_samples_foreach (dc_parser_t *abstract, dc_sample_callback_t callback, void *userdata);
 
-static const dc_parser_vtable_t diverite_nitekq_parser_vtable = {
+DC_VTABLE_STORAGE const dc_parser_vtable_t diverite_nitekq_parser_vtable = {
 	sizeof(diverite_nitekq_parser_t),
 	DC_FAMILY_DIVERITE_NITEKQ,
 	diverite_nitekq_parser_set_data, /* set_data */
@@ -269,9 +269,9 @@ diverite_nitekq_parser_samples_foreach (dc_parser_t *abstract, dc_sample_callbac
 			if (maxdepth < depth)
 				maxdepth = depth;
 			if (metric)
-				sample.depth = depth / 10.0;
+				sample.depth = array_scale (depth, 1, 10);
 			else
-				sample.depth = depth * FEET / 10.0;
+				sample.depth = array_scale (depth, FEET, 10);
 			if (callback) callback (DC_SAMPLE_DEPTH, sample, userdata);
 			offset += 2;
 
@@ -280,7 +280,7 @@ diverite_nitekq_parser_samples_foreach (dc_parser_t *abstract, dc_sample_callbac
 				if (offset + 1 > size)
 					return DC_STATUS_DATAFORMAT;
 				unsigned int ppo2 = data[offset];
-				sample.ppo2 = ppo2 / 100.0;
+				sample.ppo2 = array_scale (ppo2, 1, 100);
 				if (callback) callback (DC_SAMPLE_PPO2, sample, userdata);
 				offset++;
 			}
@@ -71,7 +71,7 @@ static dc_status_t divesystem_idive_device_set_fingerprint (dc_device_t *abstrac
 static dc_status_t divesystem_idive_device_foreach (dc_device_t *abstract, dc_dive_callback_t callback, void *userdata);
 static dc_status_t divesystem_idive_device_close (dc_device_t *abstract);
 
-static const dc_device_vtable_t divesystem_idive_device_vtable = {
+DC_VTABLE_STORAGE const dc_device_vtable_t divesystem_idive_device_vtable = {
 	sizeof(divesystem_idive_device_t),
 	DC_FAMILY_DIVESYSTEM_IDIVE,
 	divesystem_idive_device_set_fingerprint, /* set_fingerprint */
@@ -131,6 +131,9 @@ divesystem_idive_device_open2 (dc_device_t **out, dc_context_t *context, const c
 		goto error_free;
 	}
 
+	// Forward cancellation requests to the serial layer.
+	dc_serial_set_cancel (device->port, device_cancel_cb, device);
+
 	// Set the serial communication protocol (115200 8N1).
 	status = dc_serial_configure (device->port, 115200, 8, DC_PARITY_NONE, DC_STOPBITS_ONE, DC_FLOWCONTROL_NONE);
 	if (status != DC_STATUS_SUCCESS) {
@@ -338,7 +341,7 @@ divesystem_idive_transfer (divesystem_idive_device_t *device, const unsigned cha
 		}
 
 		// Abort if the maximum number of retries is reached.
-		if (nretries++ >= MAXRETRIES)
+		if (nretries++ >= device_retry_limit ((dc_device_t *) device, MAXRETRIES))
 			return DC_STATUS_PROTOCOL;
 
 		// Delay the next attempt.
@@ -410,11 +413,26 @@ divesystem_idive_device_foreach (dc_device_t *abstract, dc_dive_callback_t callb
 	progress.maximum = ndives * NSTEPS;
 	device_event_emit (abstract, DC_EVENT_PROGRESS, &progress);
 
+	dc_buffer_t *headers = dc_buffer_new(0);
 	dc_buffer_t *buffer = dc_buffer_new(0);
-	if (buffer == NULL) {
-		return DC_STATUS_NOMEMORY;
+	if (headers == NULL || buffer == NULL) {
+		rc = DC_STATUS_NOMEMORY;
+		goto out;
+	}
+
+	// Pre-allocate the header storage. The number of dives on the
+	// device is an upper bound for the number of new dives.
+	if (!dc_buffer_reserve(headers, ndives * commands->header.size)) {
+		rc = DC_STATUS_NOMEMORY;
+		goto out;
 	}
 
+	// Fetch the headers of all new dives first. The header requests are
+	// tiny and uniform, so batching them avoids alternating between the
+	// small header and large sample transfers for every dive, and the
+	// number of new dives (and thus the exact download size) is known
+	// before the bulk of the transfer starts.
+	unsigned int nnew = 0;
 	for (unsigned int i = 0; i < ndives; ++i) {
 		unsigned int number = last - i;
 		unsigned char cmd_header[] = {commands->header.cmd,
@@ -422,12 +440,47 @@ divesystem_idive_device_foreach (dc_device_t *abstract, dc_dive_callback_t callb
 			(number >> 8) & 0xFF};
 		rc = divesystem_idive_transfer (device, cmd_header, sizeof(cmd_header), packet, commands->header.size);
 		if (rc != DC_STATUS_SUCCESS)
-			return rc;
+			goto out;
 
 		if (memcmp(packet + 7, device->fingerprint, sizeof(device->fingerprint)) == 0)
 			break;
 
-		unsigned int nsamples = array_uint16_le (packet + 1);
+		if (!dc_buffer_append(headers, packet, commands->header.size)) {
+			rc = DC_STATUS_NOMEMORY;
+			goto out;
+		}
+
+		// Emit an early dive summary event, so the application can
+		// show the dive while its samples still have to be downloaded.
+		dc_event_divesummary_t summary;
+		summary.number = ++nnew;
+		summary.data = packet;
+		summary.size = commands->header.size;
+		summary.fingerprint = packet + 7;
+		summary.fsize = sizeof(device->fingerprint);
+		device_event_emit (abstract, DC_EVENT_DIVESUMMARY, &summary);
+	}
+
+	// Correct the progress maximum, now that the number of new dives
+	// is known.
+	if (nnew) {
+		progress.maximum = nnew * NSTEPS;
+		device_event_emit (abstract, DC_EVENT_PROGRESS, &progress);
+	}
+
+	for (unsigned int i = 0; i < nnew; ++i) {
+		const unsigned char *header = dc_buffer_get_data(headers) + i * commands->header.size;
+		unsigned int number = last - i;
+		unsigned int nsamples = array_uint16_le (header + 1);
+
+		// Request the header again, to make sure the sample requests
+		// refer to this dive, regardless of any device side state.
+		unsigned char cmd_header[] = {commands->header.cmd,
+			(number     ) & 0xFF,
+			(number >> 8) & 0xFF};
+		rc = divesystem_idive_transfer (device, cmd_header, sizeof(cmd_header), packet, commands->header.size);
+		if (rc != DC_STATUS_SUCCESS)
+			goto out;
 
 		// Update and emit a progress event.
 		progress.current = i * NSTEPS + STEP(1, nsamples + 1);
@@ -435,7 +488,7 @@ divesystem_idive_device_foreach (dc_device_t *abstract, dc_dive_callback_t callb
 
 		dc_buffer_clear(buffer);
 		dc_buffer_reserve(buffer, commands->header.size + commands->sample.size * nsamples);
-		dc_buffer_append(buffer, packet, commands->header.size);
+		dc_buffer_append(buffer, header, commands->header.size);
 
 		for (unsigned int j = 0; j < nsamples; ++j) {
 			unsigned int idx = j + 1;
@@ -444,7 +497,7 @@ divesystem_idive_device_foreach (dc_device_t *abstract, dc_dive_callback_t callb
 				(idx >> 8) & 0xFF};
 			rc = divesystem_idive_transfer (device, cmd_sample, sizeof(cmd_sample), packet, commands->sample.size);
 			if (rc != DC_STATUS_SUCCESS)
-				return rc;
+				goto out;
 
 			// Update and emit a progress event.
 			progress.current = i * NSTEPS + STEP(j + 2, nsamples + 1);
@@ -456,12 +509,16 @@ divesystem_idive_device_foreach (dc_device_t *abstract, dc_dive_callback_t callb
 		unsigned char *data = dc_buffer_get_data(buffer);
 		unsigned int   size = dc_buffer_get_size(buffer);
 		if (callback && !callback (data, size, data + 7, sizeof(device->fingerprint), userdata)) {
-			dc_buffer_free (buffer);
-			return DC_STATUS_SUCCESS;
+			rc = DC_STATUS_SUCCESS;
+			goto out;
 		}
 	}
 
+	rc = DC_STATUS_SUCCESS;
+
+out:
 	dc_buffer_free(buffer);
+	dc_buffer_free(headers);
 
-	return DC_STATUS_SUCCESS;
+	return rc;
 }
@@ -71,7 +71,7 @@ static dc_status_t divesystem_idive_parser_get_datetime (dc_parser_t *abstract,
 static dc_status_t divesystem_idive_parser_get_field (dc_parser_t *abstract, dc_field_type_t type, unsigned int flags, void *value);
 static dc_status_t divesystem_idive_parser_samples_foreach (dc_parser_t *abstract, dc_sample_callback_t callback, void *userdata);
 
-static const dc_parser_vtable_t divesystem_idive_parser_vtable = {
+DC_VTABLE_STORAGE const dc_parser_vtable_t divesystem_idive_parser_vtable = {
 	sizeof(divesystem_idive_parser_t),
 	DC_FAMILY_DIVESYSTEM_IDIVE,
 	divesystem_idive_parser_set_data, /* set_data */
@@ -267,12 +267,12 @@ divesystem_idive_parser_samples_foreach (dc_parser_t *abstract, dc_sample_callba
 		unsigned int depth = array_uint16_le (data + offset + 6);
 		if (maxdepth < depth)
 			maxdepth = depth;
-		sample.depth = depth / 10.0;
+		sample.depth = array_scale (depth, 1, 10);
 		if (callback) callback (DC_SAMPLE_DEPTH, sample, userdata);
 
 		// Temperature (Celsius).
 		signed int temperature = (signed short) array_uint16_le (data + offset + 8);
-		sample.temperature = temperature / 10.0;
+		sample.temperature = array_scale (temperature, 1, 10);
 		if (callback) callback (DC_SAMPLE_TEMPERATURE, sample, userdata);
 
 		// Dive mode
@@ -333,7 +333,7 @@ divesystem_idive_parser_samples_foreach (dc_parser_t *abstract, dc_sample_callba
 
 		// CNS
 		unsigned int cns = array_uint16_le (data + offset + 29);
-		sample.cns = cns / 100.0;
+		sample.cns = array_scale (cns, 1, 100);
 		if (callback) callback (DC_SAMPLE_CNS, sample, userdata);
 
 		offset += parser->samplesize;
@@ -0,0 +1,298 @@
+/*
+ * libdivecomputer
+ *
+ * Copyright (C) 2016 Jef Driesen
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <libdivecomputer/download.h>
+
+#include "context-private.h"
+#include "device-private.h"
+#include "threads.h"
+
+#define MAXFINGERPRINT 64
+
+typedef struct dc_download_job_t {
+	dc_descriptor_t *descriptor;
+	char *name;
+	unsigned int events;
+	dc_event_callback_t event_callback;
+	dc_dive_callback_t dive_callback;
+	dc_download_finished_t finished_callback;
+	unsigned char fingerprint[MAXFINGERPRINT];
+	unsigned int fsize;
+	void *userdata;
+	dc_status_t status;
+	struct dc_download_job_t *next;
+} dc_download_job_t;
+
+struct dc_download_t {
+	dc_context_t *context;
+	dc_download_job_t *jobs;
+	dc_download_job_t *tail;
+	dc_download_job_t *pending;
+	dc_mutex_t mutex;
+	volatile int cancelled;
+	int running;
+};
+
+dc_status_t
+dc_download_new (dc_download_t **out, dc_context_t *context)
+{
+	dc_download_t *download = NULL;
+
+	if (out == NULL)
+		return DC_STATUS_INVALIDARGS;
+
+	download = (dc_download_t *) malloc (sizeof (dc_download_t));
+	if (download == NULL) {
+		ERROR (context, "Failed to allocate memory.");
+		return DC_STATUS_NOMEMORY;
+	}
+
+	download->context = context;
+	download->jobs = NULL;
+	download->tail = NULL;
+	download->pending = NULL;
+	download->cancelled = 0;
+	download->running = 0;
+
+	if (dc_mutex_init (&download->mutex) != 0) {
+		free (download);
+		return DC_STATUS_NOMEMORY;
+	}
+
+	*out = download;
+
+	return DC_STATUS_SUCCESS;
+}
+
+dc_status_t
+dc_download_add (dc_download_t *download, dc_descriptor_t *descriptor, const char *name,
+	unsigned int events, dc_event_callback_t event_callback,
+	dc_dive_callback_t dive_callback,
+	dc_download_finished_t finished_callback,
+	const unsigned char fingerprint[], unsigned int fsize,
+	void *userdata)
+{
+	dc_download_job_t *job = NULL;
+
+	if (download == NULL || descriptor == NULL || name == NULL)
+		return DC_STATUS_INVALIDARGS;
+
+	if (fsize > MAXFINGERPRINT || (fsize != 0 && fingerprint == NULL))
+		return DC_STATUS_INVALIDARGS;
+
+	if (download->running)
+		return DC_STATUS_INVALIDARGS;
+
+	job = (dc_download_job_t *) malloc (sizeof (dc_download_job_t));
+	if (job == NULL) {
+		ERROR (download->context, "Failed to allocate memory.");
+		return DC_STATUS_NOMEMORY;
+	}
+
+	job->name = strdup (name);
+	if (job->name == NULL) {
+		free (job);
+		ERROR (download->context, "Failed to allocate memory.");
+		return DC_STATUS_NOMEMORY;
+	}
+
+	job->descriptor = descriptor;
+	job->events = events;
+	job->event_callback = event_callback;
+	job->dive_callback = dive_callback;
+	job->finished_callback = finished_callback;
+	if (fsize)
+		memcpy (job->fingerprint, fingerprint, fsize);
+	job->fsize = fsize;
+	job->userdata = userdata;
+	job->status = DC_STATUS_SUCCESS;
+	job->next = NULL;
+
+	// Append to the job list.
+	if (download->tail)
+		download->tail->next = job;
+	else
+		download->jobs = job;
+	download->tail = job;
+
+	return DC_STATUS_SUCCESS;
+}
+
+static int
+dc_download_cancel_cb (void *userdata)
+{
+	dc_download_t *download = (dc_download_t *) userdata;
+
+	return download->cancelled;
+}
+
+static dc_status_t
+dc_download_execute (dc_download_t *download, dc_download_job_t *job)
+{
+	dc_status_t rc = DC_STATUS_SUCCESS;
+	dc_device_t *device = NULL;
+
+	rc = dc_device_open (&device, download->context, job->descriptor, job->name);
+	if (rc != DC_STATUS_SUCCESS)
+		return rc;
+
+	// Cancellation is routed through the manager, so one call to
+	// dc_download_cancel reaches every running device.
+	dc_device_set_cancel (device, dc_download_cancel_cb, download);
+
+	if (job->event_callback)
+		dc_device_set_events (device, job->events, job->event_callback, job->userdata);
+
+	if (job->fsize)
+		dc_device_set_fingerprint (device, job->fingerprint, job->fsize);
+
+	rc = dc_device_foreach (device, job->dive_callback, job->userdata);
+
+	dc_device_close (device);
+
+	return rc;
+}
+
+static void *
+dc_download_worker (void *arg)
+{
+	dc_download_t *download = (dc_download_t *) arg;
+
+	while (1) {
+		// Take the next pending job.
+		dc_mutex_lock (&download->mutex);
+		dc_download_job_t *job = download->pending;
+		if (job)
+			download->pending = job->next;
+		dc_mutex_unlock (&download->mutex);
+
+		if (job == NULL)
+			break;
+
+		if (download->cancelled)
+			job->status = DC_STATUS_CANCELLED;
+		else
+			job->status = dc_download_execute (download, job);
+
+		if (job->finished_callback)
+			job->finished_callback (job->status, job->userdata);
+	}
+
+	return NULL;
+}
+
+dc_status_t
+dc_download_run (dc_download_t *download, unsigned int nthreads)
+{
+	dc_status_t rc = DC_STATUS_SUCCESS;
+
+	if (download == NULL)
+		return DC_STATUS_INVALIDARGS;
+
+	if (download->running)
+		return DC_STATUS_INVALIDARGS;
+
+	if (download->jobs == NULL)
+		return DC_STATUS_SUCCESS;
+
+	if (nthreads == 0)
+		nthreads = 1;
+
+	// Count the jobs. There is no point in more workers than jobs.
+	unsigned int njobs = 0;
+	for (dc_download_job_t *job = download->jobs; job; job = job->next)
+		njobs++;
+	if (nthreads > njobs)
+		nthreads = njobs;
+
+	dc_thread_t *threads = (dc_thread_t *) malloc (nthreads * sizeof (dc_thread_t));
+	if (threads == NULL) {
+		ERROR (download->context, "Failed to allocate memory.");
+		return DC_STATUS_NOMEMORY;
+	}
+
+	download->running = 1;
+	download->pending = download->jobs;
+
+	unsigned int started = 0;
+	for (unsigned int i = 0; i < nthreads; ++i) {
+		if (dc_thread_create (&threads[i], dc_download_worker, download) != 0)
+			break;
+		started++;
+	}
+
+	if (started == 0) {
+		// Fall back to executing the jobs on the calling thread.
+		dc_download_worker (download);
+	} else {
+		for (unsigned int i = 0; i < started; ++i)
+			dc_thread_join (&threads[i]);
+	}
+
+	free (threads);
+
+	download->running = 0;
+
+	// Report the status of the first failing job.
+	for (dc_download_job_t *job = download->jobs; job; job = job->next) {
+		if (job->status != DC_STATUS_SUCCESS) {
+			rc = job->status;
+			break;
+		}
+	}
+
+	return rc;
+}
+
+dc_status_t
+dc_download_cancel (dc_download_t *download)
+{
+	if (download == NULL)
+		return DC_STATUS_INVALIDARGS;
+
+	download->cancelled = 1;
+
+	return DC_STATUS_SUCCESS;
+}
+
+dc_status_t
+dc_download_free (dc_download_t *download)
+{
+	if (download == NULL)
+		return DC_STATUS_SUCCESS;
+
+	dc_download_job_t *job = download->jobs;
+	while (job) {
+		dc_download_job_t *next = job->next;
+		free (job->name);
+		free (job);
+		job = next;
+	}
+
+	dc_mutex_destroy (&download->mutex);
+
+	free (download);
+
+	return DC_STATUS_SUCCESS;
+}
@@ -0,0 +1,178 @@
+/*
+ * libdivecomputer
+ *
+ * Copyright (C) 2013 Jef Driesen
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA
+ */
+
+#include <string.h> // memcmp
+
+#include "context-private.h"
+#include "hw_common.h"
+
+/*
+ * Perform a single command exchange of the Heinrichs Weikamp protocol:
+ * a one byte command, optionally echoed back by the device, followed by
+ * an optional input packet, an optional streamed answer, and a trailing
+ * ready byte. The input packet is written in chunks of ichunk bytes
+ * (or in one piece when ichunk is zero), and the answer is read in
+ * chunks sized to the data already available on the transport, so a
+ * large answer streams continuously without per-block round trips.
+ * A non-zero delay polls the transport (in steps of 100 ms) until data
+ * arrives, before reading the ready byte, for commands with a long
+ * device side processing time.
+ */
+dc_status_t
+hw_common_transfer (dc_device_t *abstract,
+	const hw_common_io_t *io,
+	dc_event_progress_t *progress,
+	unsigned char cmd,
+	const unsigned char input[],
+	unsigned int isize,
+	unsigned int ichunk,
+	unsigned char output[],
+	unsigned int osize,
+	unsigned char ready,
+	unsigned int flags,
+	unsigned int delay)
+{
+	dc_status_t status = DC_STATUS_SUCCESS;
+
+	if (device_is_cancelled (abstract))
+		return DC_STATUS_CANCELLED;
+
+	// Send the command.
+	unsigned char command[1] = {cmd};
+	status = io->write (abstract, command, sizeof (command));
+	if (status != DC_STATUS_SUCCESS) {
+		ERROR (abstract->context, "Failed to send the command.");
+		return status;
+	}
+
+	if (flags & HW_COMMON_ECHO) {
+		// Read the echo.
+		unsigned char echo[1] = {0};
+		status = io->read (abstract, echo, sizeof (echo));
+		if (status != DC_STATUS_SUCCESS) {
+			ERROR (abstract->context, "Failed to receive the echo.");
+			return status;
+		}
+
+		// Verify the echo. A ready byte instead of the echo means the
+		// device does not know the command.
+		if (memcmp (echo, command, sizeof (command)) != 0) {
+			if (echo[0] == ready) {
+				ERROR (abstract->context, "Unsupported command.");
+				return DC_STATUS_UNSUPPORTED;
+			} else {
+				ERROR (abstract->context, "Unexpected echo.");
+				return DC_STATUS_PROTOCOL;
+			}
+		}
+	}
+
+	if (input) {
+		// Send the input data packet.
+		unsigned int nbytes = 0;
+		while (nbytes < isize) {
+			// Set the packet size.
+			unsigned int len = (ichunk ? ichunk : isize);
+
+			// Limit the packet size to the total size.
+			if (nbytes + len > isize)
+				len = isize - nbytes;
+
+			// Write the packet.
+			status = io->write (abstract, input + nbytes, len);
+			if (status != DC_STATUS_SUCCESS) {
+				ERROR (abstract->context, "Failed to send the data packet.");
+				return status;
+			}
+
+			// Update and emit a progress event.
+			if (progress) {
+				progress->current += len;
+				device_event_emit (abstract, DC_EVENT_PROGRESS, progress);
+			}
+
+			nbytes += len;
+		}
+	}
+
+	if (output) {
+		unsigned int nbytes = 0;
+		while (nbytes < osize) {
+			// Set the minimum packet size.
+			unsigned int len = 1024;
+
+			// Increase the packet size if more data is immediately available.
+			size_t available = 0;
+			status = io->available (abstract, &available);
+			if (status == DC_STATUS_SUCCESS && available > len)
+				len = available;
+
+			// Limit the packet size to the total size.
+			if (nbytes + len > osize)
+				len = osize - nbytes;
+
+			// Read the packet.
+			status = io->read (abstract, output + nbytes, len);
+			if (status != DC_STATUS_SUCCESS) {
+				ERROR (abstract->context, "Failed to receive the answer.");
+				return status;
+			}
+
+			// Update and emit a progress event.
+			if (progress) {
+				progress->current += len;
+				device_event_emit (abstract, DC_EVENT_PROGRESS, progress);
+			}
+
+			nbytes += len;
+		}
+	}
+
+	if (delay) {
+		unsigned int count = delay / 100;
+		for (unsigned int i = 0; i < count; ++i) {
+			size_t available = 0;
+			status = io->available (abstract, &available);
+			if (status == DC_STATUS_SUCCESS && available > 0)
+				break;
+
+			io->sleep (abstract, 100);
+		}
+	}
+
+	if (flags & HW_COMMON_READY) {
+		// Read the ready byte.
+		unsigned char answer[1] = {0};
+		status = io->read (abstract, answer, sizeof (answer));
+		if (status != DC_STATUS_SUCCESS) {
+			ERROR (abstract->context, "Failed to receive the ready byte.");
+			return status;
+		}
+
+		// Verify the ready byte.
+		if (answer[0] != ready) {
+			ERROR (abstract->context, "Unexpected ready byte.");
+			return DC_STATUS_PROTOCOL;
+		}
+	}
+
+	return DC_STATUS_SUCCESS;
+}
@@ -0,0 +1,63 @@
+/*
+ * libdivecomputer
+ *
+ * Copyright (C) 2013 Jef Driesen
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA
+ */
+
+#ifndef HW_COMMON_H
+#define HW_COMMON_H
+
+#include "device-private.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/*
+ * The transport operations of a Heinrichs Weikamp backend. The
+ * callbacks receive the abstract device, so a backend can route them
+ * to a serial port or a BLE connection as appropriate.
+ */
+typedef struct hw_common_io_t {
+	dc_status_t (*write) (dc_device_t *abstract, const void *data, size_t size);
+	dc_status_t (*read) (dc_device_t *abstract, void *data, size_t size);
+	dc_status_t (*available) (dc_device_t *abstract, size_t *value);
+	dc_status_t (*sleep) (dc_device_t *abstract, unsigned int timeout);
+} hw_common_io_t;
+
+#define HW_COMMON_ECHO  0x01 // The command byte is echoed back.
+#define HW_COMMON_READY 0x02 // The exchange ends with a ready byte.
+
+dc_status_t
+hw_common_transfer (dc_device_t *abstract,
+	const hw_common_io_t *io,
+	dc_event_progress_t *progress,
+	unsigned char cmd,
+	const unsigned char input[],
+	unsigned int isize,
+	unsigned int ichunk,
+	unsigned char output[],
+	unsigned int osize,
+	unsigned char ready,
+	unsigned int flags,
+	unsigned int delay);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+#endif /* HW_COMMON_H */
@@ -30,6 +30,7 @@
 #include "checksum.h"
 #include "ringbuffer.h"
 #include "array.h"
+#include "hw_common.h"
 
 #define ISINSTANCE(device) dc_device_isinstance((device), &hw_frog_device_vtable)
 
@@ -64,7 +65,7 @@ static dc_status_t hw_frog_device_set_fingerprint (dc_device_t *abstract, const
 static dc_status_t hw_frog_device_foreach (dc_device_t *abstract, dc_dive_callback_t callback, void *userdata);
 static dc_status_t hw_frog_device_close (dc_device_t *abstract);
 
-static const dc_device_vtable_t hw_frog_device_vtable = {
+DC_VTABLE_STORAGE const dc_device_vtable_t hw_frog_device_vtable = {
 	sizeof(hw_frog_device_t),
 	DC_FAMILY_HW_FROG,
 	hw_frog_device_set_fingerprint, /* set_fingerprint */
@@ -97,103 +98,68 @@ hw_frog_strncpy (unsigned char *data, unsigned int size, const char *text)
 
 
 static dc_status_t
-hw_frog_transfer (hw_frog_device_t *device,
-                  dc_event_progress_t *progress,
-                  unsigned char cmd,
-                  const unsigned char input[],
-                  unsigned int isize,
-                  unsigned char output[],
-                  unsigned int osize)
+hw_frog_io_write (dc_device_t *abstract, const void *data, size_t size)
 {
-	dc_status_t status = DC_STATUS_SUCCESS;
-	dc_device_t *abstract = (dc_device_t *) device;
+	hw_frog_device_t *device = (hw_frog_device_t *) abstract;
 
-	if (device_is_cancelled (abstract))
-		return DC_STATUS_CANCELLED;
+	return dc_serial_write (device->port, data, size, NULL);
+}
 
-	// Send the command.
-	unsigned char command[1] = {cmd};
-	status = dc_serial_write (device->port, command, sizeof (command), NULL);
-	if (status != DC_STATUS_SUCCESS) {
-		ERROR (abstract->context, "Failed to send the command.");
-		return status;
-	}
 
-	if (cmd != INIT && cmd != HEADER) {
-		// Read the echo.
-		unsigned char answer[1] = {0};
-		status = dc_serial_read (device->port, answer, sizeof (answer), NULL);
-		if (status != DC_STATUS_SUCCESS) {
-			ERROR (abstract->context, "Failed to receive the echo.");
-			return status;
-		}
+static dc_status_t
+hw_frog_io_read (dc_device_t *abstract, void *data, size_t size)
+{
+	hw_frog_device_t *device = (hw_frog_device_t *) abstract;
 
-		// Verify the echo.
-		if (memcmp (answer, command, sizeof (command)) != 0) {
-			ERROR (abstract->context, "Unexpected echo.");
-			return DC_STATUS_PROTOCOL;
-		}
-	}
+	return dc_serial_read (device->port, data, size, NULL);
+}
 
-	if (input) {
-		// Send the input data packet.
-		status = dc_serial_write (device->port, input, isize, NULL);
-		if (status != DC_STATUS_SUCCESS) {
-			ERROR (abstract->context, "Failed to send the data packet.");
-			return status;
-		}
-	}
 
-	if (output) {
-		unsigned int nbytes = 0;
-		while (nbytes < osize) {
-			// Set the minimum packet size.
-			unsigned int len = 1024;
-
-			// Increase the packet size if more data is immediately available.
-			size_t available = 0;
-			status = dc_serial_get_available (device->port, &available);
-			if (status == DC_STATUS_SUCCESS && available > len)
-				len = available;
-
-			// Limit the packet size to the total size.
-			if (nbytes + len > osize)
-				len = osize - nbytes;
-
-			// Read the packet.
-			status = dc_serial_read (device->port, output + nbytes, len, NULL);
-			if (status != DC_STATUS_SUCCESS) {
-				ERROR (abstract->context, "Failed to receive the answer.");
-				return status;
-			}
-
-			// Update and emit a progress event.
-			if (progress) {
-				progress->current += len;
-				device_event_emit ((dc_device_t *) device, DC_EVENT_PROGRESS, progress);
-			}
-
-			nbytes += len;
-		}
-	}
+static dc_status_t
+hw_frog_io_available (dc_device_t *abstract, size_t *value)
+{
+	hw_frog_device_t *device = (hw_frog_device_t *) abstract;
 
-	if (cmd != EXIT) {
-		// Read the ready byte.
-		unsigned char answer[1] = {0};
-		status = dc_serial_read (device->port, answer, sizeof (answer), NULL);
-		if (status != sizeof (answer)) {
-			ERROR (abstract->context, "Failed to receive the ready byte.");
-			return status;
-		}
+	return dc_serial_get_available (device->port, value);
+}
 
-		// Verify the ready byte.
-		if (answer[0] != READY) {
-			ERROR (abstract->context, "Unexpected ready byte.");
-			return DC_STATUS_PROTOCOL;
-		}
-	}
 
-	return DC_STATUS_SUCCESS;
+static dc_status_t
+hw_frog_io_sleep (dc_device_t *abstract, unsigned int timeout)
+{
+	hw_frog_device_t *device = (hw_frog_device_t *) abstract;
+
+	return dc_serial_sleep (device->port, timeout);
+}
+
+
+static const hw_common_io_t hw_frog_io = {
+	hw_frog_io_write, /* write */
+	hw_frog_io_read, /* read */
+	hw_frog_io_available, /* available */
+	hw_frog_io_sleep /* sleep */
+};
+
+
+static dc_status_t
+hw_frog_transfer (hw_frog_device_t *device,
+                  dc_event_progress_t *progress,
+                  unsigned char cmd,
+                  const unsigned char input[],
+                  unsigned int isize,
+                  unsigned char output[],
+                  unsigned int osize)
+{
+	// The INIT and HEADER commands are not echoed, and the EXIT
+	// command has no trailing ready byte.
+	unsigned int flags = 0;
+	if (cmd != INIT && cmd != HEADER)
+		flags |= HW_COMMON_ECHO;
+	if (cmd != EXIT)
+		flags |= HW_COMMON_READY;
+
+	return hw_common_transfer ((dc_device_t *) device, &hw_frog_io,
+		progress, cmd, input, isize, 0, output, osize, READY, flags, 0);
 }
 
 
@@ -224,6 +190,9 @@ hw_frog_device_open (dc_device_t **out, dc_context_t *context, const char *name)
 		goto error_free;
 	}
 
+	// Forward cancellation requests to the serial layer.
+	dc_serial_set_cancel (device->port, device_cancel_cb, device);
+
 	// Set the serial communication protocol (115200 8N1).
 	status = dc_serial_configure (device->port, 115200, 8, DC_PARITY_NONE, DC_STOPBITS_ONE, DC_FLOWCONTROL_NONE);
 	if (status != DC_STATUS_SUCCESS) {
@@ -73,7 +73,7 @@ static dc_status_t hw_ostc_device_dump (dc_device_t *abstract, dc_buffer_t *buff
 static dc_status_t hw_ostc_device_foreach (dc_device_t *abstract, dc_dive_callback_t callback, void *userdata);
 static dc_status_t hw_ostc_device_close (dc_device_t *abstract);
 
-static const dc_device_vtable_t hw_ostc_device_vtable = {
+DC_VTABLE_STORAGE const dc_device_vtable_t hw_ostc_device_vtable = {
 	sizeof(hw_ostc_device_t),
 	DC_FAMILY_HW_OSTC,
 	hw_ostc_device_set_fingerprint, /* set_fingerprint */
@@ -146,6 +146,9 @@ hw_ostc_device_open (dc_device_t **out, dc_context_t *context, const char *name)
 		goto error_free;
 	}
 
+	// Forward cancellation requests to the serial layer.
+	dc_serial_set_cancel (device->port, device_cancel_cb, device);
+
 	// Set the serial communication protocol (115200 8N1).
 	status = dc_serial_configure (device->port, 115200, 8, DC_PARITY_NONE, DC_STOPBITS_ONE, DC_FLOWCONTROL_NONE);
 	if (status != DC_STATUS_SUCCESS) {
@@ -312,6 +315,11 @@ hw_ostc_device_dump (dc_device_t *abstract, dc_buffer_t *buffer)
 static dc_status_t
 hw_ostc_device_foreach (dc_device_t *abstract, dc_dive_callback_t callback, void *userdata)
 {
+	// A full memory dump is unavoidable here: the only bulk transfer in
+	// this protocol is the 'a' command, which streams the entire header
+	// and profile memory in one go. There is no command to read an
+	// arbitrary address range, so the transfer cannot be limited to the
+	// dives that are actually new.
 	dc_buffer_t *buffer = dc_buffer_new (0);
 	if (buffer == NULL)
 		return DC_STATUS_NOMEMORY;
@@ -29,8 +29,10 @@
 #include "context-private.h"
 #include "device-private.h"
 #include "serial.h"
+#include "ble.h"
 #include "array.h"
 #include "aes.h"
+#include "hw_common.h"
 
 #ifdef _MSC_VER
 #define snprintf _snprintf
@@ -96,6 +98,7 @@ typedef enum hw_ostc3_state_t {
 typedef struct hw_ostc3_device_t {
 	dc_device_t base;
 	dc_serial_t *port;
+	dc_ble_t *ble;
 	unsigned int hardware;
 	unsigned int feature;
 	unsigned int model;
@@ -130,7 +133,7 @@ static dc_status_t hw_ostc3_device_dump (dc_device_t *abstract, dc_buffer_t *buf
 static dc_status_t hw_ostc3_device_foreach (dc_device_t *abstract, dc_dive_callback_t callback, void *userdata);
 static dc_status_t hw_ostc3_device_close (dc_device_t *abstract);
 
-static const dc_device_vtable_t hw_ostc3_device_vtable = {
+DC_VTABLE_STORAGE const dc_device_vtable_t hw_ostc3_device_vtable = {
 	sizeof(hw_ostc3_device_t),
 	DC_FAMILY_HW_OSTC3,
 	hw_ostc3_device_set_fingerprint, /* set_fingerprint */
@@ -177,141 +180,101 @@ hw_ostc3_strncpy (unsigned char *data, unsigned int size, const char *text)
 
 
 static dc_status_t
-hw_ostc3_transfer (hw_ostc3_device_t *device,
-                  dc_event_progress_t *progress,
-                  unsigned char cmd,
-                  const unsigned char input[],
-                  unsigned int isize,
-                  unsigned char output[],
-                  unsigned int osize,
-                  unsigned int delay)
+hw_ostc3_read (hw_ostc3_device_t *device, void *data, size_t size)
 {
-	dc_device_t *abstract = (dc_device_t *) device;
-	dc_status_t status = DC_STATUS_SUCCESS;
-
-	if (device_is_cancelled (abstract))
-		return DC_STATUS_CANCELLED;
+	if (device->ble)
+		return dc_ble_read (device->ble, data, size, NULL);
+	else
+		return dc_serial_read (device->port, data, size, NULL);
+}
 
-	// Get the correct ready byte for the current state.
-	const unsigned char ready = (device->state == SERVICE ? S_READY : READY);
 
-	// Send the command.
-	unsigned char command[1] = {cmd};
-	status = dc_serial_write (device->port, command, sizeof (command), NULL);
-	if (status != DC_STATUS_SUCCESS) {
-		ERROR (abstract->context, "Failed to send the command.");
-		return status;
-	}
+static dc_status_t
+hw_ostc3_write (hw_ostc3_device_t *device, const void *data, size_t size)
+{
+	if (device->ble)
+		return dc_ble_write (device->ble, data, size, NULL);
+	else
+		return dc_serial_write (device->port, data, size, NULL);
+}
 
-	// Read the echo.
-	unsigned char echo[1] = {0};
-	status = dc_serial_read (device->port, echo, sizeof (echo), NULL);
-	if (status != DC_STATUS_SUCCESS) {
-		ERROR (abstract->context, "Failed to receive the echo.");
-		return status;
-	}
 
-	// Verify the echo.
-	if (memcmp (echo, command, sizeof (command)) != 0) {
-		if (echo[0] == ready) {
-			ERROR (abstract->context, "Unsupported command.");
-			return DC_STATUS_UNSUPPORTED;
-		} else {
-			ERROR (abstract->context, "Unexpected echo.");
-			return DC_STATUS_PROTOCOL;
-		}
-	}
+static dc_status_t
+hw_ostc3_get_available (hw_ostc3_device_t *device, size_t *value)
+{
+	if (device->ble)
+		return dc_ble_get_available (device->ble, value);
+	else
+		return dc_serial_get_available (device->port, value);
+}
 
-	if (input) {
-		// Send the input data packet.
-		unsigned int nbytes = 0;
-		while (nbytes < isize) {
-			// Set the minimum packet size.
-			unsigned int len = 64;
 
-			// Limit the packet size to the total size.
-			if (nbytes + len > isize)
-				len = isize - nbytes;
+static dc_status_t
+hw_ostc3_sleep (hw_ostc3_device_t *device, unsigned int timeout)
+{
+	if (device->ble)
+		return dc_ble_sleep (device->ble, timeout);
+	else
+		return dc_serial_sleep (device->port, timeout);
+}
 
-			// Write the packet.
-			status = dc_serial_write (device->port, input + nbytes, len, NULL);
-			if (status != DC_STATUS_SUCCESS) {
-				ERROR (abstract->context, "Failed to send the data packet.");
-				return status;
-			}
 
-			// Update and emit a progress event.
-			if (progress) {
-				progress->current += len;
-				device_event_emit ((dc_device_t *) device, DC_EVENT_PROGRESS, progress);
-			}
+static dc_status_t
+hw_ostc3_io_write (dc_device_t *abstract, const void *data, size_t size)
+{
+	return hw_ostc3_write ((hw_ostc3_device_t *) abstract, data, size);
+}
 
-			nbytes += len;
-		}
-	}
 
-	if (output) {
-		unsigned int nbytes = 0;
-		while (nbytes < osize) {
-			// Set the minimum packet size.
-			unsigned int len = 1024;
+static dc_status_t
+hw_ostc3_io_read (dc_device_t *abstract, void *data, size_t size)
+{
+	return hw_ostc3_read ((hw_ostc3_device_t *) abstract, data, size);
+}
 
-			// Increase the packet size if more data is immediately available.
-			size_t available = 0;
-			status = dc_serial_get_available (device->port, &available);
-			if (status == DC_STATUS_SUCCESS && available > len)
-				len = available;
 
-			// Limit the packet size to the total size.
-			if (nbytes + len > osize)
-				len = osize - nbytes;
+static dc_status_t
+hw_ostc3_io_available (dc_device_t *abstract, size_t *value)
+{
+	return hw_ostc3_get_available ((hw_ostc3_device_t *) abstract, value);
+}
 
-			// Read the packet.
-			status = dc_serial_read (device->port, output + nbytes, len, NULL);
-			if (status != DC_STATUS_SUCCESS) {
-				ERROR (abstract->context, "Failed to receive the answer.");
-				return status;
-			}
 
-			// Update and emit a progress event.
-			if (progress) {
-				progress->current += len;
-				device_event_emit ((dc_device_t *) device, DC_EVENT_PROGRESS, progress);
-			}
+static dc_status_t
+hw_ostc3_io_sleep (dc_device_t *abstract, unsigned int timeout)
+{
+	return hw_ostc3_sleep ((hw_ostc3_device_t *) abstract, timeout);
+}
 
-			nbytes += len;
-		}
-	}
 
-	if (delay) {
-		unsigned int count = delay / 100;
-		for (unsigned int i = 0; i < count; ++i) {
-			size_t available = 0;
-			status = dc_serial_get_available (device->port, &available);
-			if (status == DC_STATUS_SUCCESS && available > 0)
-				break;
+static const hw_common_io_t hw_ostc3_io = {
+	hw_ostc3_io_write, /* write */
+	hw_ostc3_io_read, /* read */
+	hw_ostc3_io_available, /* available */
+	hw_ostc3_io_sleep /* sleep */
+};
 
-			dc_serial_sleep (device->port, 100);
-		}
-	}
 
-	if (cmd != EXIT) {
-		// Read the ready byte.
-		unsigned char answer[1] = {0};
-		status = dc_serial_read (device->port, answer, sizeof (answer), NULL);
-		if (status != DC_STATUS_SUCCESS) {
-			ERROR (abstract->context, "Failed to receive the ready byte.");
-			return status;
-		}
+static dc_status_t
+hw_ostc3_transfer (hw_ostc3_device_t *device,
+                  dc_event_progress_t *progress,
+                  unsigned char cmd,
+                  const unsigned char input[],
+                  unsigned int isize,
+                  unsigned char output[],
+                  unsigned int osize,
+                  unsigned int delay)
+{
+	// Get the correct ready byte for the current state.
+	const unsigned char ready = (device->state == SERVICE ? S_READY : READY);
 
-		// Verify the ready byte.
-		if (answer[0] != ready) {
-			ERROR (abstract->context, "Unexpected ready byte.");
-			return DC_STATUS_PROTOCOL;
-		}
-	}
+	// The EXIT command has no trailing ready byte.
+	unsigned int flags = HW_COMMON_ECHO;
+	if (cmd != EXIT)
+		flags |= HW_COMMON_READY;
 
-	return DC_STATUS_SUCCESS;
+	return hw_common_transfer ((dc_device_t *) device, &hw_ostc3_io,
+		progress, cmd, input, isize, 64, output, osize, ready, flags, delay);
 }
 
 
@@ -333,11 +296,40 @@ hw_ostc3_device_open (dc_device_t **out, dc_context_t *context, const char *name
 
 	// Set the default values.
 	device->port = NULL;
+	device->ble = NULL;
 	device->hardware = INVALID;
 	device->feature = 0;
 	device->model = 0;
 	memset (device->fingerprint, 0, sizeof (device->fingerprint));
 
+	// Connect over BLE GATT if the name is prefixed with "LE:".
+	if (name && strncmp (name, "LE:", 3) == 0) {
+		status = dc_ble_open (&device->ble, context);
+		if (status != DC_STATUS_SUCCESS) {
+			ERROR (context, "Failed to open the BLE connection.");
+			goto error_free;
+		}
+
+		status = dc_ble_connect (device->ble, name + 3);
+		if (status != DC_STATUS_SUCCESS) {
+			ERROR (context, "Failed to connect to the BLE device.");
+			goto error_close;
+		}
+
+		// Set the timeout for receiving data (3000ms).
+		status = dc_ble_set_timeout (device->ble, 3000);
+		if (status != DC_STATUS_SUCCESS) {
+			ERROR (context, "Failed to set the timeout.");
+			goto error_close;
+		}
+
+		device->state = OPEN;
+
+		*out = (dc_device_t *) device;
+
+		return DC_STATUS_SUCCESS;
+	}
+
 	// Open the device.
 	status = dc_serial_open (&device->port, context, name);
 	if (status != DC_STATUS_SUCCESS) {
@@ -345,6 +337,9 @@ hw_ostc3_device_open (dc_device_t **out, dc_context_t *context, const char *name
 		goto error_free;
 	}
 
+	// Forward cancellation requests to the serial layer.
+	dc_serial_set_cancel (device->port, device_cancel_cb, device);
+
 	// Set the serial communication protocol (115200 8N1).
 	status = dc_serial_configure (device->port, 115200, 8, DC_PARITY_NONE, DC_STOPBITS_ONE, DC_FLOWCONTROL_NONE);
 	if (status != DC_STATUS_SUCCESS) {
@@ -370,7 +365,10 @@ hw_ostc3_device_open (dc_device_t **out, dc_context_t *context, const char *name
 	return DC_STATUS_SUCCESS;
 
 error_close:
-	dc_serial_close (device->port);
+	if (device->ble)
+		dc_ble_close (device->ble);
+	else
+		dc_serial_close (device->port);
 error_free:
 	dc_device_deallocate ((dc_device_t *) device);
 	return status;
@@ -434,17 +432,17 @@ hw_ostc3_device_init_service (hw_ostc3_device_t *device)
 	unsigned char output[5];
 
 	// We cant use hw_ostc3_transfer here, due to the different echos
-	status = dc_serial_write (device->port, command, sizeof (command), NULL);
+	status = hw_ostc3_write (device, command, sizeof (command));
 	if (status != DC_STATUS_SUCCESS) {
 		ERROR (context, "Failed to send the command.");
 		return status;
 	}
 
 	// Give the device some time to enter service mode
-	dc_serial_sleep (device->port, 100);
+	hw_ostc3_sleep (device, 100);
 
 	// Read the response
-	status = dc_serial_read (device->port, output, sizeof (output), NULL);
+	status = hw_ostc3_read (device, output, sizeof (output));
 	if (status != DC_STATUS_SUCCESS) {
 		ERROR (context, "Failed to receive the echo.");
 		return status;
@@ -532,7 +530,10 @@ hw_ostc3_device_close (dc_device_t *abstract)
 	}
 
 	// Close the device.
-	rc = dc_serial_close (device->port);
+	if (device->ble)
+		rc = dc_ble_close (device->ble);
+	else
+		rc = dc_serial_close (device->port);
 	if (rc != DC_STATUS_SUCCESS) {
 		dc_status_set_error(&status, rc);
 	}
@@ -1124,6 +1125,15 @@ hw_ostc3_firmware_readfile4 (dc_buffer_t *buffer, dc_context_t *context, const c
 		return DC_STATUS_IO;
 	}
 
+	// Determine the file size, and pre-allocate the buffer, so it
+	// doesn't have to grow while reading.
+	if (fseek (fp, 0, SEEK_END) == 0) {
+		long fsize = ftell (fp);
+		if (fsize > 0)
+			dc_buffer_reserve (buffer, fsize);
+		fseek (fp, 0, SEEK_SET);
+	}
+
 	// Read the entire file into the buffer.
 	size_t n = 0;
 	unsigned char block[1024] = {0};
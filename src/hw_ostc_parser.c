@@ -105,7 +105,7 @@ static dc_status_t hw_ostc_parser_get_datetime (dc_parser_t *abstract, dc_dateti
 static dc_status_t hw_ostc_parser_get_field (dc_parser_t *abstract, dc_field_type_t type, unsigned int flags, void *value);
 static dc_status_t hw_ostc_parser_samples_foreach (dc_parser_t *abstract, dc_sample_callback_t callback, void *userdata);
 
-static const dc_parser_vtable_t hw_ostc_parser_vtable = {
+DC_VTABLE_STORAGE const dc_parser_vtable_t hw_ostc_parser_vtable = {
 	sizeof(hw_ostc_parser_t),
 	DC_FAMILY_HW_OSTC,
 	hw_ostc_parser_set_data, /* set_data */
@@ -642,7 +642,7 @@ hw_ostc_parser_samples_foreach (dc_parser_t *abstract, dc_sample_callback_t call
 
 		// Depth (mbar).
 		unsigned int depth = array_uint16_le (data + offset);
-		sample.depth = (depth * BAR / 1000.0) / hydrostatic;
+		sample.depth = array_scale (depth, BAR, 1000) / hydrostatic;
 		if (callback) callback (DC_SAMPLE_DEPTH, sample, userdata);
 		offset += 2;
 
@@ -754,7 +754,7 @@ hw_ostc_parser_samples_foreach (dc_parser_t *abstract, dc_sample_callback_t call
 					ERROR (abstract->context, "Buffer overflow detected!");
 					return DC_STATUS_DATAFORMAT;
 				}
-				sample.setpoint = data[offset] / 100.0;
+				sample.setpoint = array_scale (data[offset], 1, 100);
 				if (callback) callback (DC_SAMPLE_SETPOINT, sample, userdata);
 				offset++;
 				length--;
@@ -801,7 +801,7 @@ hw_ostc_parser_samples_foreach (dc_parser_t *abstract, dc_sample_callback_t call
 				switch (info[i].type) {
 				case 0: // Temperature (0.1 °C).
 					value = array_uint16_le (data + offset);
-					sample.temperature = value / 10.0;
+					sample.temperature = array_scale (value, 1, 10);
 					if (callback) callback (DC_SAMPLE_TEMPERATURE, sample, userdata);
 					break;
 				case 1: // Deco / NDL
@@ -831,16 +831,16 @@ hw_ostc_parser_samples_foreach (dc_parser_t *abstract, dc_sample_callback_t call
 					}
 					if (count) {
 						for (unsigned int j = 0; j < 3; ++j) {
-							sample.ppo2 = ppo2[j] / 100.0;
+							sample.ppo2 = array_scale (ppo2[j], 1, 100);
 							if (callback) callback (DC_SAMPLE_PPO2, sample, userdata);
 						}
 					}
 					break;
 				case 5: // CNS
 					if (info[i].size == 2)
-						sample.cns = array_uint16_le (data + offset) / 100.0;
+						sample.cns = array_scale (array_uint16_le (data + offset), 1, 100);
 					else
-						sample.cns = data[offset] / 100.0;
+						sample.cns = array_scale (data[offset], 1, 100);
 					if (callback) callback (DC_SAMPLE_CNS, sample, userdata);
 					break;
 				default: // Not yet used.
@@ -859,7 +859,7 @@ hw_ostc_parser_samples_foreach (dc_parser_t *abstract, dc_sample_callback_t call
 					ERROR (abstract->context, "Buffer overflow detected!");
 					return DC_STATUS_DATAFORMAT;
 				}
-				sample.setpoint = data[offset] / 100.0;
+				sample.setpoint = array_scale (data[offset], 1, 100);
 				if (callback) callback (DC_SAMPLE_SETPOINT, sample, userdata);
 				offset++;
 				length--;
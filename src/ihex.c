@@ -31,13 +31,19 @@
 
 struct dc_ihex_file_t {
 	dc_context_t *context;
-	FILE *fp;
+	// The entire file, loaded into memory with a single read, so the
+	// records are parsed without any I/O.
+	unsigned char *data;
+	size_t size;
+	size_t offset;
 };
 
 dc_status_t
 dc_ihex_file_open (dc_ihex_file_t **result, dc_context_t *context, const char *filename)
 {
 	dc_ihex_file_t *file = NULL;
+	FILE *fp = NULL;
+	long fsize = 0;
 
 	if (result == NULL || filename == NULL) {
 		ERROR (context, "Invalid arguments.");
@@ -52,13 +58,44 @@ dc_ihex_file_open (dc_ihex_file_t **result, dc_context_t *context, const char *f
 
 	file->context = context;
 
-	file->fp = fopen (filename, "rb");
-	if (file->fp == NULL) {
+	fp = fopen (filename, "rb");
+	if (fp == NULL) {
 		ERROR (context, "Failed to open the file.");
 		free (file);
 		return DC_STATUS_IO;
 	}
 
+	// Get the file size.
+	if (fseek (fp, 0, SEEK_END) != 0 ||
+		(fsize = ftell (fp)) < 0 ||
+		fseek (fp, 0, SEEK_SET) != 0) {
+		ERROR (context, "Failed to get the file size.");
+		fclose (fp);
+		free (file);
+		return DC_STATUS_IO;
+	}
+
+	file->data = (unsigned char *) malloc (fsize);
+	if (file->data == NULL && fsize != 0) {
+		ERROR (context, "Failed to allocate memory.");
+		fclose (fp);
+		free (file);
+		return DC_STATUS_NOMEMORY;
+	}
+
+	if (fread (file->data, 1, fsize, fp) != (size_t) fsize) {
+		ERROR (context, "Failed to read the file.");
+		fclose (fp);
+		free (file->data);
+		free (file);
+		return DC_STATUS_IO;
+	}
+
+	fclose (fp);
+
+	file->size = fsize;
+	file->offset = 0;
+
 	*result = file;
 
 	return DC_STATUS_SUCCESS;
@@ -67,11 +104,10 @@ dc_ihex_file_open (dc_ihex_file_t **result, dc_context_t *context, const char *f
 dc_status_t
 dc_ihex_file_read (dc_ihex_file_t *file, dc_ihex_entry_t *entry)
 {
-	unsigned char ascii[9 + 2 * 255 + 2] = {0};
 	unsigned char data[4 + 255 + 1] = {0};
+	const unsigned char *ascii = NULL;
 	unsigned int type, length, address;
 	unsigned char csum_a, csum_b;
-	size_t n;
 
 	if (file == NULL || entry == NULL) {
 		ERROR (file ? file->context : NULL, "Invalid arguments.");
@@ -80,35 +116,29 @@ dc_ihex_file_read (dc_ihex_file_t *file, dc_ihex_entry_t *entry)
 
 	/* Read the start code. */
 	while (1) {
-		n = fread (ascii, 1, 1, file->fp);
-		if (n != 1) {
-			if (feof (file->fp)) {
-				return DC_STATUS_DONE;
-			} else {
-				ERROR (file->context, "Failed to read the start code.");
-				return DC_STATUS_IO;
-			}
-		}
+		if (file->offset >= file->size)
+			return DC_STATUS_DONE;
 
-		if (ascii[0] == ':')
+		unsigned char c = file->data[file->offset++];
+		if (c == ':')
 			break;
 
 		/* Ignore CR and LF characters. */
-		if (ascii[0] != '\n' && ascii[0] != '\r') {
-			ERROR (file->context, "Unexpected character (0x%02x).", ascii[0]);
+		if (c != '\n' && c != '\r') {
+			ERROR (file->context, "Unexpected character (0x%02x).", c);
 			return DC_STATUS_DATAFORMAT;
 		}
 	}
 
 	/* Read the record length, address and type. */
-	n = fread (ascii + 1, 1, 8, file->fp);
-	if (n != 8) {
+	if (file->size - file->offset < 8) {
 		ERROR (file->context, "Failed to read the header.");
 		return DC_STATUS_IO;
 	}
+	ascii = file->data + file->offset;
 
 	/* Convert to binary representation. */
-	if (array_convert_hex2bin (ascii + 1, 8, data, 4) != 0) {
+	if (array_convert_hex2bin (ascii, 8, data, 4) != 0) {
 		ERROR (file->context, "Invalid hexadecimal character.");
 		return DC_STATUS_DATAFORMAT;
 	}
@@ -117,18 +147,19 @@ dc_ihex_file_read (dc_ihex_file_t *file, dc_ihex_entry_t *entry)
 	length = data[0];
 
 	/* Read the record payload. */
-	n = fread (ascii + 9, 1, 2 * length + 2, file->fp);
-	if (n != 2 * length + 2) {
+	if (file->size - file->offset < 8 + 2 * length + 2) {
 		ERROR (file->context, "Failed to read the data.");
 		return DC_STATUS_IO;
 	}
 
 	/* Convert to binary representation. */
-	if (array_convert_hex2bin (ascii + 9, 2 * length + 2, data + 4, length + 1) != 0) {
+	if (array_convert_hex2bin (ascii + 8, 2 * length + 2, data + 4, length + 1) != 0) {
 		ERROR (file->context, "Invalid hexadecimal character.");
 		return DC_STATUS_DATAFORMAT;
 	}
 
+	file->offset += 8 + 2 * length + 2;
+
 	/* Verify the checksum. */
 	csum_a = data[4 + length];
 	csum_b = ~checksum_add_uint8 (data, 4 + length, 0x00) + 1;
@@ -189,7 +220,7 @@ dc_ihex_file_reset (dc_ihex_file_t *file)
 		return DC_STATUS_INVALIDARGS;
 	}
 
-	rewind (file->fp);
+	file->offset = 0;
 
 	return DC_STATUS_SUCCESS;
 }
@@ -198,7 +229,7 @@ dc_status_t
 dc_ihex_file_close (dc_ihex_file_t *file)
 {
 	if (file) {
-		fclose (file->fp);
+		free (file->data);
 		free (file);
 	}
 
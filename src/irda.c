@@ -37,6 +37,7 @@
 	#include <sys/select.h>		// select
 	#include <sys/ioctl.h>		// ioctl
 	#include <sys/time.h>
+	#include <time.h>			// nanosleep
 #endif
 
 #include "irda.h"
@@ -76,6 +77,11 @@ typedef int s_errcode_t;
 #define snprintf _snprintf
 #endif
 
+// The size of the receive cache. The socket is drained with large
+// recv() calls, and the small reads of the backends are served from
+// memory, instead of paying a syscall per protocol packet.
+#define RECEIVE_BUFSIZE 4096
+
 struct dc_irda_t {
 	dc_context_t *context;
 #ifdef _WIN32
@@ -84,6 +90,12 @@ struct dc_irda_t {
 	int fd;
 #endif
 	int timeout;
+	/* Transfer statistics */
+	dc_event_metrics_t metrics;
+	/* Receive cache */
+	unsigned char cache[RECEIVE_BUFSIZE];
+	size_t offset;
+	size_t available;
 };
 
 static dc_status_t
@@ -122,9 +134,15 @@ dc_irda_open (dc_irda_t **out, dc_context_t *context)
 	// Library context.
 	device->context = context;
 
+	memset (&device->metrics, 0, sizeof (device->metrics));
+
 	// Default to blocking reads.
 	device->timeout = -1;
 
+	// The receive cache is empty.
+	device->offset = 0;
+	device->available = 0;
+
 #ifdef _WIN32
 	// Initialize the winsock dll.
 	WSADATA wsaData;
@@ -217,7 +235,9 @@ dc_irda_set_timeout (dc_irda_t *device, int timeout)
 
 
 #define DISCOVER_MAX_DEVICES 16	// Maximum number of devices.
-#define DISCOVER_MAX_RETRIES 4	// Maximum number of retries.
+#define DISCOVER_MAX_RETRIES 6	// Maximum number of retries.
+#define DISCOVER_INTERVAL_MIN 100	// Initial poll interval (ms).
+#define DISCOVER_INTERVAL_MAX 1600	// Maximum poll interval (ms).
 
 #ifdef _WIN32
 #define DISCOVER_BUFSIZE sizeof (DEVICELIST) + \
@@ -244,6 +264,7 @@ dc_irda_discover (dc_irda_t *device, dc_irda_callback_t callback, void *userdata
 
 	int rc = 0;
 	unsigned int nretries = 0;
+	unsigned int interval = DISCOVER_INTERVAL_MIN;
 	while ((rc = getsockopt (device->fd, SOL_IRLMP, IRLMP_ENUMDEVICES, (char*) data, &size)) != 0 ||
 #ifdef _WIN32
 		list->numDevice == 0)
@@ -271,11 +292,21 @@ dc_irda_discover (dc_irda_t *device, dc_irda_callback_t callback, void *userdata
 		// modified by the previous getsockopt call.
 		size = sizeof (data);
 
+		// Poll fast at first, because the discovery usually succeeds
+		// within a fraction of a second once the device is in range,
+		// and back off exponentially while nothing appears, to save
+		// power on the long waits for user action.
 #ifdef _WIN32
-		Sleep (1000);
+		Sleep (interval);
 #else
-		sleep (1);
+		struct timespec ts;
+		ts.tv_sec  = (interval / 1000);
+		ts.tv_nsec = (interval % 1000) * 1000000;
+		while (nanosleep (&ts, &ts) != 0 && errno == EINTR)
+			; // Restart the sleep.
 #endif
+		if (interval < DISCOVER_INTERVAL_MAX)
+			interval *= 2;
 	}
 
 	if (callback) {
@@ -395,7 +426,7 @@ dc_irda_get_available (dc_irda_t *device, size_t *value)
 	}
 
 	if (value)
-		*value = bytes;
+		*value = bytes + device->available;
 
 	return DC_STATUS_SUCCESS;
 }
@@ -411,6 +442,17 @@ dc_irda_read (dc_irda_t *device, void *data, size_t size, size_t *actual)
 		goto out_invalidargs;
 	}
 
+	// Serve data from the receive cache first.
+	if (device->available) {
+		size_t length = device->available;
+		if (length > size)
+			length = size;
+		memcpy (data, device->cache + device->offset, length);
+		device->offset += length;
+		device->available -= length;
+		nbytes += length;
+	}
+
 	while (nbytes < size) {
 		fd_set fds;
 		FD_ZERO (&fds);
@@ -433,10 +475,26 @@ dc_irda_read (dc_irda_t *device, void *data, size_t size, size_t *actual)
 			status = syserror(errcode);
 			goto out;
 		} else if (rc == 0) {
+			// The select has waited out the full timeout.
+			device->metrics.timeouts++;
+			if (device->timeout > 0)
+				device->metrics.stalltime += device->timeout;
 			break; // Timeout.
 		}
 
-		s_ssize_t n = recv (device->fd, (char*) data + nbytes, size - nbytes, 0);
+		// Large requests are received directly into the caller's
+		// buffer. Smaller ones drain the socket into the cache, and
+		// the remaining bytes are served from memory by subsequent
+		// reads. The recv() call only returns the bytes that are
+		// already available, so it never blocks for more data than
+		// the caller asked for.
+		s_ssize_t n;
+		int direct = (size - nbytes >= sizeof (device->cache));
+		if (direct) {
+			n = recv (device->fd, (char*) data + nbytes, size - nbytes, 0);
+		} else {
+			n = recv (device->fd, (char*) device->cache, sizeof (device->cache), 0);
+		}
 		if (n < 0) {
 			s_errcode_t errcode = S_ERRNO;
 			if (errcode == S_EINTR || errcode == S_EAGAIN)
@@ -448,7 +506,19 @@ dc_irda_read (dc_irda_t *device, void *data, size_t size, size_t *actual)
 			break; // EOF reached.
 		}
 
-		nbytes += n;
+		device->metrics.rbytes += n;
+
+		if (direct) {
+			nbytes += n;
+		} else {
+			size_t length = (size_t) n;
+			if (length > size - nbytes)
+				length = size - nbytes;
+			memcpy ((char*) data + nbytes, device->cache, length);
+			device->offset = length;
+			device->available = n - length;
+			nbytes += length;
+		}
 	}
 
 	if (nbytes != size) {
@@ -506,6 +576,7 @@ dc_irda_write (dc_irda_t *device, const void *data, size_t size, size_t *actual)
 		}
 
 		nbytes += n;
+		device->metrics.wbytes += n;
 	}
 
 	if (nbytes != size) {
@@ -521,3 +592,14 @@ out_invalidargs:
 
 	return status;
 }
+
+dc_status_t
+dc_irda_get_metrics (dc_irda_t *device, dc_event_metrics_t *metrics)
+{
+	if (device == NULL || metrics == NULL)
+		return DC_STATUS_INVALIDARGS;
+
+	*metrics = device->metrics;
+
+	return DC_STATUS_SUCCESS;
+}
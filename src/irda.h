@@ -24,6 +24,7 @@
 
 #include <libdivecomputer/common.h>
 #include <libdivecomputer/context.h>
+#include <libdivecomputer/device.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -173,6 +174,20 @@ dc_irda_read (dc_irda_t *irda, void *data, size_t size, size_t *actual);
 dc_status_t
 dc_irda_write (dc_irda_t *irda, const void *data, size_t size, size_t *actual);
 
+/**
+ * Query the transfer statistics of the connection.
+ *
+ * The retries field is not known to the transport layer, and is left
+ * zero.
+ *
+ * @param[in]   irda     A valid IrDA connection.
+ * @param[out]  metrics  A location to store the transfer statistics.
+ * @returns #DC_STATUS_SUCCESS on success, or another #dc_status_t code
+ * on failure.
+ */
+dc_status_t
+dc_irda_get_metrics (dc_irda_t *irda, dc_event_metrics_t *metrics);
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
@@ -76,3 +76,9 @@ dc_irda_write (dc_irda_t *device, const void *data, size_t size, size_t *actual)
 {
 	return DC_STATUS_UNSUPPORTED;
 }
+
+dc_status_t
+dc_irda_get_metrics (dc_irda_t *device, dc_event_metrics_t *metrics)
+{
+	return DC_STATUS_UNSUPPORTED;
+}
@@ -37,6 +37,9 @@ struct dc_iterator_t {
 struct dc_iterator_vtable_t {
 	dc_status_t (*free) (dc_iterator_t *iterator);
 	dc_status_t (*next) (dc_iterator_t *iterator, void *item);
+	// Optional. When absent, dc_iterator_next_n falls back to calling
+	// the next function once per item.
+	dc_status_t (*next_n) (dc_iterator_t *iterator, void *items, size_t size, unsigned int count, unsigned int *actual);
 };
 
 #ifdef __cplusplus
@@ -39,6 +39,39 @@ dc_iterator_next (dc_iterator_t *iterator, void *item)
 	return iterator->vtable->next (iterator, item);
 }
 
+dc_status_t
+dc_iterator_next_n (dc_iterator_t *iterator, void *items, size_t size, unsigned int count, unsigned int *actual)
+{
+	if (iterator == NULL)
+		return DC_STATUS_UNSUPPORTED;
+
+	if (iterator->vtable->next == NULL && iterator->vtable->next_n == NULL)
+		return DC_STATUS_UNSUPPORTED;
+
+	if (items == NULL || size == 0 || actual == NULL)
+		return DC_STATUS_INVALIDARGS;
+
+	if (iterator->vtable->next_n)
+		return iterator->vtable->next_n (iterator, items, size, count, actual);
+
+	// Fall back to retrieving the items one at a time.
+	unsigned int n = 0;
+	dc_status_t status = DC_STATUS_SUCCESS;
+	while (n < count) {
+		status = iterator->vtable->next (iterator, (unsigned char *) items + n * size);
+		if (status != DC_STATUS_SUCCESS)
+			break;
+		n++;
+	}
+
+	*actual = n;
+
+	if (n > 0 && status == DC_STATUS_DONE)
+		status = DC_STATUS_SUCCESS;
+
+	return status;
+}
+
 dc_status_t
 dc_iterator_free (dc_iterator_t *iterator)
 {
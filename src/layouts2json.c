@@ -0,0 +1,62 @@
+/*
+ * libdivecomputer
+ *
+ * Copyright (C) 2026 Jef Driesen
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA
+ */
+
+/*
+ * Developer tool (not installed): emits the memory layout and sample
+ * format tables as machine readable JSON. The data is printed by small
+ * emitters located next to the tables themselves, so the output is
+ * generated from the same tables the shipping decoders use, and cannot
+ * drift from them.
+ *
+ * Usage: layouts2json > layouts.json
+ */
+
+#include <stdio.h>
+
+#include <libdivecomputer/version.h>
+
+#include "oceanic_common.h"
+
+int
+main (void)
+{
+	printf ("{\n\"version\": \"%s\",\n", dc_version (NULL));
+
+	printf ("\"oceanic_atom2\": {\n\"device\": [\n");
+	oceanic_atom2_device_layouts_json (stdout);
+	printf ("\n],\n\"parser\": [\n");
+	oceanic_atom2_parser_layouts_json (stdout);
+	printf ("\n]\n},\n");
+
+	printf ("\"oceanic_veo250\": {\n\"device\": [\n");
+	oceanic_veo250_device_layouts_json (stdout);
+	printf ("\n],\n\"parser\": [\n");
+	oceanic_veo250_parser_layouts_json (stdout);
+	printf ("\n]\n},\n");
+
+	printf ("\"oceanic_vtpro\": {\n\"device\": [\n");
+	oceanic_vtpro_device_layouts_json (stdout);
+	printf ("\n],\n\"parser\": [\n");
+	oceanic_vtpro_parser_layouts_json (stdout);
+	printf ("\n]\n}\n}\n");
+
+	return 0;
+}
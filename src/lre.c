@@ -0,0 +1,122 @@
+/*
+ * libdivecomputer
+ *
+ * Copyright (C) 2016 Jef Driesen
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA
+ */
+
+#include <string.h> // memset
+
+#include "lre.h"
+
+// The maximum number of literal bytes batched into a single append.
+#define CHUNKSIZE 64
+
+void
+dc_lre_init (dc_lre_t *lre, dc_buffer_t *buffer, unsigned int xorblock)
+{
+	memset (lre, 0, sizeof (dc_lre_t));
+
+	lre->buffer = buffer;
+	lre->xorblock = xorblock;
+	// The first XOR block is passed through unchanged.
+	lre->decoded = xorblock;
+}
+
+int
+dc_lre_feed (dc_lre_t *lre, const unsigned char data[], unsigned int size)
+{
+	if (lre->buffer == NULL)
+		return -1;
+
+	// Literal bytes are collected into a chunk, and appended to the
+	// output buffer in batches, instead of one byte at a time.
+	unsigned char chunk[CHUNKSIZE];
+	unsigned int nchunk = 0;
+
+	for (unsigned int i = 0; i < size && !lre->finished; ++i) {
+		// Add the byte to the bit accumulator.
+		lre->accum = (lre->accum << 8) | data[i];
+		lre->nbits += 8;
+
+		// Extract the complete 9 bit values.
+		while (lre->nbits >= 9) {
+			unsigned int value = (lre->accum >> (lre->nbits - 9)) & 0x1FF;
+			lre->nbits -= 9;
+
+			// The 9th bit indicates whether the remaining 8 bits
+			// represent a run of zero bytes or not. If the bit is set,
+			// the value is not a run and doesn’t need expansion. If
+			// the bit is not set, the value contains the number of
+			// zero bytes in the run. A zero-length run indicates the
+			// end of the compressed stream.
+			if (value & 0x100) {
+				chunk[nchunk++] = value & 0xFF;
+				if (nchunk == CHUNKSIZE) {
+					if (!dc_buffer_append (lre->buffer, chunk, nchunk))
+						return -1;
+					nchunk = 0;
+				}
+			} else if (value == 0) {
+				// Reached the end of the compressed stream.
+				lre->finished = 1;
+				break;
+			} else {
+				// Expand the run with zero bytes.
+				if (nchunk) {
+					if (!dc_buffer_append (lre->buffer, chunk, nchunk))
+						return -1;
+					nchunk = 0;
+				}
+				if (!dc_buffer_resize (lre->buffer, dc_buffer_get_size (lre->buffer) + value))
+					return -1;
+			}
+		}
+	}
+
+	// Append the remaining literal bytes.
+	if (nchunk) {
+		if (!dc_buffer_append (lre->buffer, chunk, nchunk))
+			return -1;
+	}
+
+	// Apply the XOR phase to the new bytes, so the decoding overlaps
+	// with the I/O instead of requiring a pass over the entire buffer
+	// afterwards.
+	if (lre->xorblock) {
+		unsigned char *out = dc_buffer_get_data (lre->buffer);
+		unsigned int avail = dc_buffer_get_size (lre->buffer);
+		while (lre->decoded < avail) {
+			out[lre->decoded] ^= out[lre->decoded - lre->xorblock];
+			lre->decoded++;
+		}
+	}
+
+	return 0;
+}
+
+int
+dc_lre_isfinished (const dc_lre_t *lre)
+{
+	return lre->finished;
+}
+
+int
+dc_lre_finish (dc_lre_t *lre)
+{
+	return lre->finished ? 0 : -1;
+}
@@ -0,0 +1,91 @@
+/*
+ * libdivecomputer
+ *
+ * Copyright (C) 2016 Jef Driesen
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA
+ */
+
+#ifndef DC_LRE_H
+#define DC_LRE_H
+
+#include <libdivecomputer/buffer.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/**
+ * A streaming decompressor for the LRE compression scheme used by the
+ * Shearwater dive computers: a stream of 9 bit values, where a value
+ * with the 9th bit set carries a literal byte, a non-zero value with
+ * the 9th bit clear encodes a run of that many zero bytes, and a zero
+ * value marks the end of the stream. The decompressed bytes are
+ * optionally post-processed with an XOR phase, where each block is
+ * XOR'ed in place with the previous, already decoded, block.
+ */
+typedef struct dc_lre_t {
+	dc_buffer_t *buffer;
+	unsigned int accum;
+	unsigned int nbits;
+	unsigned int xorblock;
+	unsigned int decoded;
+	unsigned int finished;
+} dc_lre_t;
+
+/**
+ * Initialize a streaming decompressor.
+ *
+ * @param[in]  lre       A decompressor state object.
+ * @param[in]  buffer    The output buffer. The decompressed data is
+ *                       appended to the current contents. The buffer
+ *                       is borrowed, and must remain valid for the
+ *                       lifetime of the decompressor.
+ * @param[in]  xorblock  The block size of the XOR phase in bytes, or
+ *                       zero to disable the XOR phase.
+ */
+void
+dc_lre_init (dc_lre_t *lre, dc_buffer_t *buffer, unsigned int xorblock);
+
+/**
+ * Feed a chunk of compressed data to the decompressor. The chunks can
+ * have any size; partial 9 bit values are carried over to the next
+ * call. Data after the end of stream marker is ignored.
+ *
+ * @returns Zero on success, or -1 on failure.
+ */
+int
+dc_lre_feed (dc_lre_t *lre, const unsigned char data[], unsigned int size);
+
+/**
+ * Check whether the end of stream marker has been seen.
+ */
+int
+dc_lre_isfinished (const dc_lre_t *lre);
+
+/**
+ * Finish the decompression.
+ *
+ * @returns Zero if the stream was terminated with an end of stream
+ * marker, or -1 otherwise.
+ */
+int
+dc_lre_finish (dc_lre_t *lre);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+#endif /* DC_LRE_H */
@@ -78,6 +78,44 @@ mares_common_make_ascii (const unsigned char raw[], unsigned int rsize, unsigned
 }
 
 
+static dc_status_t
+mares_common_verify (mares_common_device_t *device, const unsigned char answer[], unsigned int asize)
+{
+	dc_device_t *abstract = (dc_device_t *) device;
+
+	// Verify the header and trailer of the packet.
+	if (answer[0] != '<' || answer[asize - 1] != '>') {
+		ERROR (abstract->context, "Unexpected answer header/trailer byte.");
+		return DC_STATUS_PROTOCOL;
+	}
+
+	// Verify the checksum of the packet.
+	unsigned char crc = 0;
+	unsigned char ccrc = checksum_add_uint8 (answer + 1, asize - 4, 0x00);
+	array_convert_hex2bin (answer + asize - 3, 2, &crc, 1);
+	if (crc != ccrc) {
+		ERROR (abstract->context, "Unexpected answer checksum.");
+		return DC_STATUS_PROTOCOL;
+	}
+
+	return DC_STATUS_SUCCESS;
+}
+
+
+static void
+mares_common_make_read (unsigned char command[], unsigned int csize, unsigned int address, unsigned int len)
+{
+	// Build the raw command.
+	unsigned char raw[] = {0x51,
+		(address     ) & 0xFF, // Low
+		(address >> 8) & 0xFF, // High
+		len}; // Count
+
+	// Build the ascii command.
+	mares_common_make_ascii (raw, sizeof (raw), command, csize);
+}
+
+
 static dc_status_t
 mares_common_packet (mares_common_device_t *device, const unsigned char command[], unsigned int csize, unsigned char answer[], unsigned int asize)
 {
@@ -120,22 +158,7 @@ mares_common_packet (mares_common_device_t *device, const unsigned char command[
 		return status;
 	}
 
-	// Verify the header and trailer of the packet.
-	if (answer[0] != '<' || answer[asize - 1] != '>') {
-		ERROR (abstract->context, "Unexpected answer header/trailer byte.");
-		return DC_STATUS_PROTOCOL;
-	}
-
-	// Verify the checksum of the packet.
-	unsigned char crc = 0;
-	unsigned char ccrc = checksum_add_uint8 (answer + 1, asize - 4, 0x00);
-	array_convert_hex2bin (answer + asize - 3, 2, &crc, 1);
-	if (crc != ccrc) {
-		ERROR (abstract->context, "Unexpected answer checksum.");
-		return DC_STATUS_PROTOCOL;
-	}
-
-	return DC_STATUS_SUCCESS;
+	return mares_common_verify (device, answer, asize);
 }
 
 
@@ -151,7 +174,7 @@ mares_common_transfer (mares_common_device_t *device, const unsigned char comman
 			return rc;
 
 		// Abort if the maximum number of retries is reached.
-		if (nretries++ >= MAXRETRIES)
+		if (nretries++ >= device_retry_limit ((dc_device_t *) device, MAXRETRIES))
 			return rc;
 
 		// Discard any garbage bytes.
@@ -169,21 +192,76 @@ mares_common_device_read (dc_device_t *abstract, unsigned int address, unsigned
 	mares_common_device_t *device = (mares_common_device_t*) abstract;
 
 	unsigned int nbytes = 0;
+
+	// Keep two read commands in flight when the device doesn't echo
+	// the command and doesn't need an inter-command delay. The next
+	// request then travels to the device while the previous answer is
+	// still being transmitted, instead of paying a full round trip per
+	// packet. On a corrupted or missing answer, the remaining in-flight
+	// data is discarded and the transfer continues below, one packet at
+	// a time with retries.
+	if (device->echo == 0 && device->delay == 0) {
+		unsigned int requested = 0;
+		while (nbytes < size) {
+			if (device_is_cancelled (abstract))
+				return DC_STATUS_CANCELLED;
+
+			// Top up the number of outstanding commands.
+			dc_status_t rc = DC_STATUS_SUCCESS;
+			while (requested < size && requested - nbytes < 2 * PACKETSIZE) {
+				unsigned int len = size - requested;
+				if (len > PACKETSIZE)
+					len = PACKETSIZE;
+
+				unsigned char command[2 * (4 + 2)] = {0};
+				mares_common_make_read (command, sizeof (command), address + requested, len);
+
+				rc = dc_serial_write (device->port, command, sizeof (command), NULL);
+				if (rc != DC_STATUS_SUCCESS) {
+					ERROR (abstract->context, "Failed to send the command.");
+					return rc;
+				}
+
+				requested += len;
+			}
+
+			// Receive and verify the oldest outstanding answer.
+			unsigned int len = size - nbytes;
+			if (len > PACKETSIZE)
+				len = PACKETSIZE;
+
+			unsigned char answer[2 * (PACKETSIZE + 2)] = {0};
+			rc = dc_serial_read (device->port, answer, 2 * (len + 2), NULL);
+			if (rc == DC_STATUS_SUCCESS)
+				rc = mares_common_verify (device, answer, 2 * (len + 2));
+			if (rc != DC_STATUS_SUCCESS) {
+				if (rc != DC_STATUS_PROTOCOL && rc != DC_STATUS_TIMEOUT)
+					return rc;
+
+				// Discard the remaining in-flight data, and fall back
+				// to the packet at a time transfer.
+				WARNING (abstract->context, "Restarting the pipelined transfer.");
+				dc_serial_sleep (device->port, 100);
+				dc_serial_purge (device->port, DC_DIRECTION_INPUT);
+				break;
+			}
+
+			// Extract the raw data from the packet.
+			array_convert_hex2bin (answer + 1, 2 * len, data + nbytes, len);
+
+			nbytes += len;
+		}
+	}
+
 	while (nbytes < size) {
 		// Calculate the packet size.
 		unsigned int len = size - nbytes;
 		if (len > PACKETSIZE)
 			len = PACKETSIZE;
 
-		// Build the raw command.
-		unsigned char raw[] = {0x51,
-			(address     ) & 0xFF, // Low
-			(address >> 8) & 0xFF, // High
-			len}; // Count
-
 		// Build the ascii command.
-		unsigned char command[2 * (sizeof (raw) + 2)] = {0};
-		mares_common_make_ascii (raw, sizeof (raw), command, sizeof (command));
+		unsigned char command[2 * (4 + 2)] = {0};
+		mares_common_make_read (command, sizeof (command), address + nbytes, len);
 
 		// Send the command and receive the answer.
 		unsigned char answer[2 * (PACKETSIZE + 2)] = {0};
@@ -192,11 +270,9 @@ mares_common_device_read (dc_device_t *abstract, unsigned int address, unsigned
 			return rc;
 
 		// Extract the raw data from the packet.
-		array_convert_hex2bin (answer + 1, 2 * len, data, len);
+		array_convert_hex2bin (answer + 1, 2 * len, data + nbytes, len);
 
 		nbytes += len;
-		address += len;
-		data += len;
 	}
 
 	return DC_STATUS_SUCCESS;
@@ -52,7 +52,7 @@ static dc_status_t mares_darwin_parser_get_datetime (dc_parser_t *abstract, dc_d
 static dc_status_t mares_darwin_parser_get_field (dc_parser_t *abstract, dc_field_type_t type, unsigned int flags, void *value);
 static dc_status_t mares_darwin_parser_samples_foreach (dc_parser_t *abstract, dc_sample_callback_t callback, void *userdata);
 
-static const dc_parser_vtable_t mares_darwin_parser_vtable = {
+DC_VTABLE_STORAGE const dc_parser_vtable_t mares_darwin_parser_vtable = {
 	sizeof(mares_darwin_parser_t),
 	DC_FAMILY_MARES_DARWIN,
 	mares_darwin_parser_set_data, /* set_data */
@@ -216,6 +216,7 @@ mares_darwin_parser_samples_foreach (dc_parser_t *abstract, dc_sample_callback_t
 		return DC_STATUS_DATAFORMAT;
 
 	unsigned int time = 0;
+	unsigned int phase = 2;
 
 	unsigned int mode = abstract->data[0x0C] & 0x03;
 	unsigned int pressure = array_uint16_be (abstract->data + 0x17);
@@ -238,11 +239,13 @@ mares_darwin_parser_samples_foreach (dc_parser_t *abstract, dc_sample_callback_t
 
 			// Surface Time (seconds).
 			time += 20;
+			if (++phase == 3)
+				phase = 0;
 			sample.time = time;
 			if (callback) callback (DC_SAMPLE_TIME, sample, userdata);
 
 			// Depth (1/10 m).
-			sample.depth = depth / 10.0;
+			sample.depth = array_scale (depth, 1, 10);
 			if (callback) callback (DC_SAMPLE_DEPTH, sample, userdata);
 
 			// Gas change.
@@ -280,8 +283,10 @@ mares_darwin_parser_samples_foreach (dc_parser_t *abstract, dc_sample_callback_t
 			}
 
 			if (parser->samplesize == 3) {
-				unsigned int type = (time / 20 + 2) % 3;
-				if (type == 0) {
+				// The pressure slot cycles every three samples. The
+				// phase counter tracks the cycle incrementally, to
+				// avoid dividing the timestamp for every sample.
+				if (phase == 0) {
 					// Tank Pressure (bar)
 					pressure -= abstract->data[offset + 2];
 					sample.pressure.tank = 0;
@@ -78,8 +78,9 @@ static dc_status_t mares_iconhd_device_read (dc_device_t *abstract, unsigned int
 static dc_status_t mares_iconhd_device_dump (dc_device_t *abstract, dc_buffer_t *buffer);
 static dc_status_t mares_iconhd_device_foreach (dc_device_t *abstract, dc_dive_callback_t callback, void *userdata);
 static dc_status_t mares_iconhd_device_close (dc_device_t *abstract);
+static dc_status_t mares_iconhd_device_keepalive (dc_device_t *abstract);
 
-static const dc_device_vtable_t mares_iconhd_device_vtable = {
+DC_VTABLE_STORAGE const dc_device_vtable_t mares_iconhd_device_vtable = {
 	sizeof(mares_iconhd_device_t),
 	DC_FAMILY_MARES_ICONHD,
 	mares_iconhd_device_set_fingerprint, /* set_fingerprint */
@@ -87,7 +88,13 @@ static const dc_device_vtable_t mares_iconhd_device_vtable = {
 	NULL, /* write */
 	mares_iconhd_device_dump, /* dump */
 	mares_iconhd_device_foreach, /* foreach */
-	mares_iconhd_device_close /* close */
+	mares_iconhd_device_close, /* close */
+	NULL, /* foreach_buffer */
+	NULL, /* dump_delta */
+	NULL, /* read_multiple */
+	NULL, /* dump_stream */
+	NULL, /* enumerate */
+	mares_iconhd_device_keepalive /* keepalive */
 };
 
 static const mares_iconhd_layout_t mares_iconhd_layout = {
@@ -240,6 +247,9 @@ mares_iconhd_device_open (dc_device_t **out, dc_context_t *context, const char *
 		goto error_free;
 	}
 
+	// Forward cancellation requests to the serial layer.
+	dc_serial_set_cancel (device->port, device_cancel_cb, device);
+
 	// Set the serial communication protocol (115200 8E1).
 	status = dc_serial_configure (device->port, 115200, 8, DC_PARITY_EVEN, DC_STOPBITS_ONE, DC_FLOWCONTROL_NONE);
 	if (status != DC_STATUS_SUCCESS) {
@@ -336,6 +346,20 @@ mares_iconhd_device_close (dc_device_t *abstract)
 }
 
 
+static dc_status_t
+mares_iconhd_device_keepalive (dc_device_t *abstract)
+{
+	mares_iconhd_device_t *device = (mares_iconhd_device_t *) abstract;
+
+	// Re-issue the version command. The exchange has no side effects,
+	// and resets the inactivity timer that would otherwise drop the
+	// session and force a renegotiation.
+	unsigned char command[] = {0xC2, 0x67};
+	return mares_iconhd_transfer (device, command, sizeof (command),
+		device->version, sizeof (device->version));
+}
+
+
 static dc_status_t
 mares_iconhd_device_set_fingerprint (dc_device_t *abstract, const unsigned char data[], unsigned int size)
 {
@@ -569,6 +593,16 @@ mares_iconhd_device_foreach (dc_device_t *abstract, dc_dive_callback_t callback,
 			return rc;
 		}
 
+		// Check the fingerprint data, before downloading the profile
+		// data. The fingerprint is stored in the dive header, so in
+		// the common case where no new dives are available, the sync
+		// stops after reading just the header of the newest dive,
+		// instead of downloading its entire profile first.
+		unsigned char *fp = buffer + offset - headersize + fingerprint;
+		if (device && memcmp (fp, device->fingerprint, sizeof (device->fingerprint)) == 0) {
+			break;
+		}
+
 		// Calculate the total number of bytes for this dive.
 		// If the buffer does not contain that much bytes, we reached the
 		// end of the ringbuffer. The current dive is incomplete (partially
@@ -605,11 +639,6 @@ mares_iconhd_device_foreach (dc_device_t *abstract, dc_dive_callback_t callback,
 		if (length != nbytes)
 			break;
 
-		unsigned char *fp = buffer + offset + length - headersize + fingerprint;
-		if (device && memcmp (fp, device->fingerprint, sizeof (device->fingerprint)) == 0) {
-			break;
-		}
-
 		if (callback && !callback (buffer + offset, length, fp, sizeof (device->fingerprint), userdata)) {
 			break;
 		}
@@ -30,6 +30,8 @@
 
 #define ISINSTANCE(parser) dc_parser_isinstance((parser), &mares_iconhd_parser_vtable)
 
+#define C_ARRAY_SIZE(array) (sizeof (array) / sizeof *(array))
+
 #define SMART      0x000010
 #define SMARTAPNEA 0x010010
 #define ICONHD    0x14
@@ -67,7 +69,7 @@ static dc_status_t mares_iconhd_parser_get_datetime (dc_parser_t *abstract, dc_d
 static dc_status_t mares_iconhd_parser_get_field (dc_parser_t *abstract, dc_field_type_t type, unsigned int flags, void *value);
 static dc_status_t mares_iconhd_parser_samples_foreach (dc_parser_t *abstract, dc_sample_callback_t callback, void *userdata);
 
-static const dc_parser_vtable_t mares_iconhd_parser_vtable = {
+DC_VTABLE_STORAGE const dc_parser_vtable_t mares_iconhd_parser_vtable = {
 	sizeof(mares_iconhd_parser_t),
 	DC_FAMILY_MARES_ICONHD,
 	mares_iconhd_parser_set_data, /* set_data */
@@ -529,18 +531,30 @@ mares_iconhd_parser_samples_foreach (dc_parser_t *abstract, dc_sample_callback_t
 			offset += parser->samplesize;
 			nsamples++;
 
-			for (unsigned int i = 0; i < divetime; ++i) {
-				// Time (seconds).
-				time += parser->interval;
-				sample.time = time;
-				if (callback) callback (DC_SAMPLE_TIME, sample, userdata);
-
-				// Depth (1/10 m).
-				unsigned int depth = array_uint16_le (data + offset);
-				sample.depth = depth / 10.0;
-				if (callback) callback (DC_SAMPLE_DEPTH, sample, userdata);
+			unsigned int i = 0;
+			while (i < divetime) {
+				// Convert a chunk of depth values in one pass, so the
+				// byte order conversion runs as a tight loop, instead
+				// of being interleaved with the callbacks.
+				unsigned int depths[64];
+				unsigned int n = divetime - i;
+				if (n > C_ARRAY_SIZE (depths))
+					n = C_ARRAY_SIZE (depths);
+				array_uint16_le_array (data + offset, n, 2 * parser->samplerate, depths);
+
+				for (unsigned int j = 0; j < n; ++j) {
+					// Time (seconds).
+					time += parser->interval;
+					sample.time = time;
+					if (callback) callback (DC_SAMPLE_TIME, sample, userdata);
+
+					// Depth (1/10 m).
+					sample.depth = array_scale (depths[j], 1, 10);
+					if (callback) callback (DC_SAMPLE_DEPTH, sample, userdata);
+				}
 
-				offset += 2 * parser->samplerate;
+				offset += n * 2 * parser->samplerate;
+				i += n;
 			}
 		} else if (parser->mode == FREEDIVE) {
 			unsigned int maxdepth = array_uint16_le (data + offset + 0);
@@ -562,7 +576,7 @@ mares_iconhd_parser_samples_foreach (dc_parser_t *abstract, dc_sample_callback_t
 			if (callback) callback (DC_SAMPLE_TIME, sample, userdata);
 
 			// Maximum Depth (1/10 m).
-			sample.depth = maxdepth / 10.0;
+			sample.depth = array_scale (maxdepth, 1, 10);
 			if (callback) callback (DC_SAMPLE_DEPTH, sample, userdata);
 
 			offset += parser->samplesize;
@@ -575,12 +589,12 @@ mares_iconhd_parser_samples_foreach (dc_parser_t *abstract, dc_sample_callback_t
 
 			// Depth (1/10 m).
 			unsigned int depth = array_uint16_le (data + offset + 0);
-			sample.depth = depth / 10.0;
+			sample.depth = array_scale (depth, 1, 10);
 			if (callback) callback (DC_SAMPLE_DEPTH, sample, userdata);
 
 			// Temperature (1/10 °C).
 			unsigned int temperature = array_uint16_le (data + offset + 2) & 0x0FFF;
-			sample.temperature = temperature / 10.0;
+			sample.temperature = array_scale (temperature, 1, 10);
 			if (callback) callback (DC_SAMPLE_TEMPERATURE, sample, userdata);
 
 			// Current gas mix
@@ -610,7 +624,7 @@ mares_iconhd_parser_samples_foreach (dc_parser_t *abstract, dc_sample_callback_t
 						return DC_STATUS_DATAFORMAT;
 					}
 					sample.pressure.tank = gasmix;
-					sample.pressure.value = pressure / 100.0;
+					sample.pressure.value = array_scale (pressure, 1, 100);
 					if (callback) callback (DC_SAMPLE_PRESSURE, sample, userdata);
 				}
 
@@ -55,7 +55,7 @@ static dc_status_t mares_nemo_device_dump (dc_device_t *abstract, dc_buffer_t *b
 static dc_status_t mares_nemo_device_foreach (dc_device_t *abstract, dc_dive_callback_t callback, void *userdata);
 static dc_status_t mares_nemo_device_close (dc_device_t *abstract);
 
-static const dc_device_vtable_t mares_nemo_device_vtable = {
+DC_VTABLE_STORAGE const dc_device_vtable_t mares_nemo_device_vtable = {
 	sizeof(mares_nemo_device_t),
 	DC_FAMILY_MARES_NEMO,
 	mares_nemo_device_set_fingerprint, /* set_fingerprint */
@@ -110,6 +110,9 @@ mares_nemo_device_open (dc_device_t **out, dc_context_t *context, const char *na
 		goto error_free;
 	}
 
+	// Forward cancellation requests to the serial layer.
+	dc_serial_set_cancel (device->port, device_cancel_cb, device);
+
 	// Set the serial communication protocol (9600 8N1).
 	status = dc_serial_configure (device->port, 9600, 8, DC_PARITY_NONE, DC_STOPBITS_ONE, DC_FLOWCONTROL_NONE);
 	if (status != DC_STATUS_SUCCESS) {
@@ -124,6 +127,12 @@ mares_nemo_device_open (dc_device_t **out, dc_context_t *context, const char *na
 		goto error_close;
 	}
 
+	// Request the lowest possible receive latency. The data packets
+	// are small, and the default buffering of usb-serial adapters
+	// adds up to 16 ms to every round trip. This is a best effort
+	// tuning, so a failure is not fatal.
+	dc_serial_set_latency (device->port, 0);
+
 	// Set the DTR line.
 	status = dc_serial_set_dtr (device->port, 1);
 	if (status != DC_STATUS_SUCCESS) {
@@ -205,14 +214,20 @@ mares_nemo_device_dump (dc_device_t *abstract, dc_buffer_t *buffer)
 	progress.maximum = MEMORYSIZE + 20;
 	device_event_emit (abstract, DC_EVENT_PROGRESS, &progress);
 
-	// Wait until some data arrives.
+	// Wait until some data arrives. Back off exponentially while
+	// nothing arrives, to save power on the long waits for user
+	// action; a dc_device_wake restarts the fast polling immediately.
 	size_t available = 0;
+	unsigned int interval = 100;
 	while (dc_serial_get_available (device->port, &available) == DC_STATUS_SUCCESS && available == 0) {
 		if (device_is_cancelled (abstract))
 			return DC_STATUS_CANCELLED;
 
 		device_event_emit (abstract, DC_EVENT_WAITING, NULL);
-		dc_serial_sleep (device->port, 100);
+		if (device_sleep_while_waiting (abstract, interval))
+			interval = 100;
+		else if (interval < 1600)
+			interval *= 2;
 	}
 
 	// Receive the header of the package.
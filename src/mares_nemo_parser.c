@@ -64,7 +64,7 @@ static dc_status_t mares_nemo_parser_get_datetime (dc_parser_t *abstract, dc_dat
 static dc_status_t mares_nemo_parser_get_field (dc_parser_t *abstract, dc_field_type_t type, unsigned int flags, void *value);
 static dc_status_t mares_nemo_parser_samples_foreach (dc_parser_t *abstract, dc_sample_callback_t callback, void *userdata);
 
-static const dc_parser_vtable_t mares_nemo_parser_vtable = {
+DC_VTABLE_STORAGE const dc_parser_vtable_t mares_nemo_parser_vtable = {
 	sizeof(mares_nemo_parser_t),
 	DC_FAMILY_MARES_NEMO,
 	mares_nemo_parser_set_data, /* set_data */
@@ -366,6 +366,7 @@ mares_nemo_parser_samples_foreach (dc_parser_t *abstract, dc_sample_callback_t c
 		}
 
 		unsigned int time = 0;
+		unsigned int phase = 0;
 		for (unsigned int i = 0; i < parser->sample_count; ++i) {
 			dc_sample_value_t sample = {0};
 
@@ -378,11 +379,13 @@ mares_nemo_parser_samples_foreach (dc_parser_t *abstract, dc_sample_callback_t c
 
 			// Time (seconds).
 			time += 20;
+			if (++phase == 3)
+				phase = 0;
 			sample.time = time;
 			if (callback) callback (DC_SAMPLE_TIME, sample, userdata);
 
 			// Depth (1/10 m).
-			sample.depth = depth / 10.0;
+			sample.depth = array_scale (depth, 1, 10);
 			if (callback) callback (DC_SAMPLE_DEPTH, sample, userdata);
 
 			// Gas change.
@@ -425,11 +428,13 @@ mares_nemo_parser_samples_foreach (dc_parser_t *abstract, dc_sample_callback_t c
 				sample.pressure.value = data[idx + 2];
 				if (callback) callback (DC_SAMPLE_PRESSURE, sample, userdata);
 			} else if (parser->sample_size == 5) {
-				unsigned int type = (time / 20) % 3;
-				if (type == 0) {
+				// The pressure slot cycles every three samples. The
+				// phase counter tracks the cycle incrementally, to
+				// avoid dividing the timestamp for every sample.
+				if (phase == 0) {
 					pressure -= data[idx + 2] * 100;
 					sample.pressure.tank = 0;
-					sample.pressure.value = pressure / 100.0;
+					sample.pressure.value = array_scale (pressure, 1, 100);
 					if (callback) callback (DC_SAMPLE_PRESSURE, sample, userdata);
 				}
 			}
@@ -499,7 +504,7 @@ mares_nemo_parser_samples_foreach (dc_parser_t *abstract, dc_sample_callback_t c
 					if (callback) callback (DC_SAMPLE_TIME, sample, userdata);
 
 					// Depth (1/10 m).
-					sample.depth = depth / 10.0;
+					sample.depth = array_scale (depth, 1, 10);
 					if (callback) callback (DC_SAMPLE_DEPTH, sample, userdata);
 				}
 
@@ -518,7 +523,7 @@ mares_nemo_parser_samples_foreach (dc_parser_t *abstract, dc_sample_callback_t c
 				if (callback) callback (DC_SAMPLE_TIME, sample, userdata);
 
 				// Maximum Depth (1/10 m).
-				sample.depth = maxdepth / 10.0;
+				sample.depth = array_scale (maxdepth, 1, 10);
 				if (callback) callback (DC_SAMPLE_DEPTH, sample, userdata);
 			}
 		}
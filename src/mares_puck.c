@@ -50,7 +50,7 @@ static dc_status_t mares_puck_device_dump (dc_device_t *abstract, dc_buffer_t *b
 static dc_status_t mares_puck_device_foreach (dc_device_t *abstract, dc_dive_callback_t callback, void *userdata);
 static dc_status_t mares_puck_device_close (dc_device_t *abstract);
 
-static const dc_device_vtable_t mares_puck_device_vtable = {
+DC_VTABLE_STORAGE const dc_device_vtable_t mares_puck_device_vtable = {
 	sizeof(mares_puck_device_t),
 	DC_FAMILY_MARES_PUCK,
 	mares_puck_device_set_fingerprint, /* set_fingerprint */
@@ -116,6 +116,9 @@ mares_puck_device_open (dc_device_t **out, dc_context_t *context, const char *na
 		goto error_free;
 	}
 
+	// Forward cancellation requests to the serial layer.
+	dc_serial_set_cancel (device->base.port, device_cancel_cb, device);
+
 	// Set the serial communication protocol (38400 8N1).
 	status = dc_serial_configure (device->base.port, 38400, 8, DC_PARITY_NONE, DC_STOPBITS_ONE, DC_FLOWCONTROL_NONE);
 	if (status != DC_STATUS_SUCCESS) {
@@ -34,6 +34,8 @@
 
 #define ISINSTANCE(device) dc_device_isinstance((device), &oceanic_atom2_device_vtable.base)
 
+#define C_ARRAY_SIZE(array) (sizeof (array) / sizeof *(array))
+
 #define VTX        0x4557
 #define I750TC     0x455A
 
@@ -75,7 +77,13 @@ static const oceanic_common_device_vtable_t oceanic_atom2_device_vtable = {
 		oceanic_atom2_device_write, /* write */
 		oceanic_common_device_dump, /* dump */
 		oceanic_common_device_foreach, /* foreach */
-		oceanic_atom2_device_close /* close */
+		oceanic_atom2_device_close, /* close */
+		NULL, /* foreach_buffer */
+		oceanic_common_device_dump_delta, /* dump_delta */
+		NULL, /* read_multiple */
+		NULL, /* dump_stream */
+		oceanic_common_device_enumerate, /* enumerate */
+		oceanic_atom2_device_keepalive, /* keepalive */
 	},
 	oceanic_common_device_logbook,
 	oceanic_common_device_profile,
@@ -491,7 +499,12 @@ oceanic_atom2_packet (oceanic_atom2_device_t *device, const unsigned char comman
 			return status;
 		}
 
-		// Verify the checksum of the answer.
+		// Verify the checksum of the answer. The verification stays on
+		// the I/O path on purpose: the protocol requires a corrupted
+		// packet to be retried immediately (with an increased inter
+		// packet delay), and the additive checksum costs a few hundred
+		// cycles against tens of milliseconds of transfer time per
+		// packet, so deferring it to the consumer side buys nothing.
 		unsigned short crc, ccrc;
 		if (crc_size == 2) {
 			crc = array_uint16_le (answer + asize - 2);
@@ -526,7 +539,7 @@ oceanic_atom2_transfer (oceanic_atom2_device_t *device, const unsigned char comm
 			return rc;
 
 		// Abort if the maximum number of retries is reached.
-		if (nretries++ >= MAXRETRIES)
+		if (nretries++ >= device_retry_limit ((dc_device_t *) device, MAXRETRIES))
 			return rc;
 
 		// Increase the inter packet delay.
@@ -595,6 +608,9 @@ oceanic_atom2_device_open2 (dc_device_t **out, dc_context_t *context, const char
 		goto error_free;
 	}
 
+	// Forward cancellation requests to the serial layer.
+	dc_serial_set_cancel (device->port, device_cancel_cb, device);
+
 	// Get the correct baudrate.
 	unsigned int baudrate = 38400;
 	if (model == VTX || model == I750TC) {
@@ -694,6 +710,11 @@ oceanic_atom2_device_open2 (dc_device_t **out, dc_context_t *context, const char
 		}
 	}
 
+	// Let the ringbuffer stream and the dump request entire big pages,
+	// so every dc_device_read maps onto a single read command, instead
+	// of per-page requests served from the cache.
+	device->base.multipage = device->bigpage;
+
 	*out = (dc_device_t*) device;
 
 	return DC_STATUS_SUCCESS;
@@ -874,3 +895,38 @@ oceanic_atom2_device_write (dc_device_t *abstract, unsigned int address, const u
 
 	return DC_STATUS_SUCCESS;
 }
+
+
+void
+oceanic_atom2_device_layouts_json (FILE *stream)
+{
+	static const struct {
+		const char *name;
+		const oceanic_common_layout_t *layout;
+	} layouts[] = {
+		{"aeris_f10", &aeris_f10_layout},
+		{"aeris_f11", &aeris_f11_layout},
+		{"oceanic_default", &oceanic_default_layout},
+		{"oceanic_atom1", &oceanic_atom1_layout},
+		{"oceanic_atom2a", &oceanic_atom2a_layout},
+		{"oceanic_atom2b", &oceanic_atom2b_layout},
+		{"oceanic_atom2c", &oceanic_atom2c_layout},
+		{"oceanic_proplus3", &oceanic_proplus3_layout},
+		{"tusa_zenair", &tusa_zenair_layout},
+		{"oceanic_oc1", &oceanic_oc1_layout},
+		{"oceanic_oci", &oceanic_oci_layout},
+		{"oceanic_atom3", &oceanic_atom3_layout},
+		{"oceanic_vt4", &oceanic_vt4_layout},
+		{"hollis_tx1", &hollis_tx1_layout},
+		{"oceanic_veo1", &oceanic_veo1_layout},
+		{"oceanic_reactpro", &oceanic_reactpro_layout},
+		{"aeris_a300cs", &aeris_a300cs_layout},
+		{"aqualung_i450t", &aqualung_i450t_layout},
+	};
+
+	for (unsigned int i = 0; i < C_ARRAY_SIZE (layouts); ++i) {
+		if (i)
+			fprintf (stream, ",\n");
+		oceanic_common_layout_json (stream, layouts[i].name, layouts[i].layout);
+	}
+}
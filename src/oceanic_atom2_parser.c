@@ -31,6 +31,10 @@
 
 #define ISINSTANCE(parser) dc_parser_isinstance((parser), &oceanic_atom2_parser_vtable)
 
+#define C_ARRAY_SIZE(array) (sizeof (array) / sizeof *(array))
+
+#define INVALID 0xFFFFFFFF
+
 #define ATOM1       0x4250
 #define EPICA       0x4257
 #define VT3         0x4258
@@ -94,13 +98,116 @@
 #define HEADER  1
 #define PROFILE 2
 
+// Date/time encodings.
+#define DT_STANDARD 0
+#define DT_OC1      1
+#define DT_VT3      2
+#define DT_ZENAIR   3
+#define DT_FREEDIVE 4
+#define DT_TX1      5
+#define DT_A300CS   6
+
+// Dive mode sources.
+#define MODE_NORMAL_ONLY   0
+#define MODE_FREEDIVE_ONLY 1
+#define MODE_BYTE2         2
+#define MODE_BYTE1         3
+
+// The number of gas mixes is stored in the header.
+#define NGASMIXES_HEADER 0xFFFFFFFF
+
+// Temperature encodings.
+#define TEMP_DIRECT     0
+#define TEMP_PACKED     1
+#define TEMP_DELTA_INV5 2
+#define TEMP_DELTA_BIT5 3
+#define TEMP_DELTA_BIT0 4
+#define TEMP_DELTA_INV0 5
+
+// Tank pressure encodings.
+#define PRESSURE_NONE    0
+#define PRESSURE_DELTA   1
+#define PRESSURE_12BIT10 2
+#define PRESSURE_5PSI    3
+#define PRESSURE_UINT16  4
+
+// Depth encodings.
+#define DEPTH_12BIT2 0
+#define DEPTH_12BIT4 1
+#define DEPTH_BYTE16 2
+
+// Tank switch sample encodings.
+#define TANK_DEFAULT  0
+#define TANK_DATAMASK 1
+#define TANK_CS       2
+#define TANK_ATOM2    3
+
+// Deco/NDL encodings.
+#define DECO_NONE   0
+#define DECO_CS     1
+#define DECO_ZEN    2
+#define DECO_TX1    3
+#define DECO_ATOM31 4
+
+// Remaining bottom time encodings.
+#define RBT_NONE   0
+#define RBT_ATOM31 1
+#define RBT_I450T  2
+#define RBT_VISION 3
+
+/*
+ * Per-model data layout, resolved once at parser creation (similar to
+ * the oceanic_common_layout_t used on the device side). The sample loop
+ * dispatches on these small constants instead of re-deciding the format
+ * from the model number for every sample.
+ */
+typedef struct oceanic_atom2_layout_t {
+	// Size of the header and footer surrounding the profile data.
+	unsigned int headersize;
+	unsigned int footersize;
+	// Offset of the header sample.
+	unsigned int header;
+	// Date/time encoding.
+	unsigned int datetime;
+	// Dive mode source.
+	unsigned int mode;
+	// Gas mixes.
+	unsigned int ngasmixes;
+	unsigned int o2_offset;
+	unsigned int he_offset;
+	unsigned int sample_gasmix;
+	// Offset of the sample interval bits.
+	unsigned int interval;
+	unsigned int interval_freedive;
+	// Sample size (normal and freedive mode).
+	unsigned int samplesize;
+	unsigned int samplesize_freedive;
+	// Temperature encoding.
+	unsigned int temperature;
+	unsigned int temperature_offset;
+	// Tank pressure encoding.
+	unsigned int pressure;
+	unsigned int pressure_offset;
+	// Depth encoding.
+	unsigned int depth;
+	// Tank switch sample encoding.
+	unsigned int tank;
+	// Deco/NDL encoding.
+	unsigned int deco;
+	// Remaining bottom time encoding.
+	unsigned int rbt;
+	// Salinity stored in the header.
+	unsigned int salinity;
+	// Absolute timestamps in the samples.
+	unsigned int timestamp;
+} oceanic_atom2_layout_t;
+
 typedef struct oceanic_atom2_parser_t oceanic_atom2_parser_t;
 
 struct oceanic_atom2_parser_t {
 	dc_parser_t base;
 	unsigned int model;
-	unsigned int headersize;
-	unsigned int footersize;
+	oceanic_atom2_layout_t layout;
 	// Cached fields.
 	unsigned int cached;
 	unsigned int header;
@@ -118,7 +225,7 @@ static dc_status_t oceanic_atom2_parser_get_datetime (dc_parser_t *abstract, dc_
 static dc_status_t oceanic_atom2_parser_get_field (dc_parser_t *abstract, dc_field_type_t type, unsigned int flags, void *value);
 static dc_status_t oceanic_atom2_parser_samples_foreach (dc_parser_t *abstract, dc_sample_callback_t callback, void *userdata);
 
-static const dc_parser_vtable_t oceanic_atom2_parser_vtable = {
+DC_VTABLE_STORAGE const dc_parser_vtable_t oceanic_atom2_parser_vtable = {
 	sizeof(oceanic_atom2_parser_t),
 	DC_FAMILY_OCEANIC_ATOM2,
 	oceanic_atom2_parser_set_data, /* set_data */
@@ -129,6 +236,97 @@ static const dc_parser_vtable_t oceanic_atom2_parser_vtable = {
 };
 
 
+/*
+ * Capability registry: one row per model. Rebranded and OEM models are
+ * added as a single table row; models that share a layout simply repeat
+ * the same row with a different model number.
+ *
+ * The columns are the oceanic_atom2_layout_t fields, in declaration
+ * order: headersize, footersize, header, datetime, mode, ngasmixes,
+ * o2_offset, he_offset, sample_gasmix, interval, interval_freedive,
+ * samplesize, samplesize_freedive, temperature, temperature_offset,
+ * pressure, pressure_offset, depth, tank, deco, rbt, salinity and
+ * timestamp.
+ */
+typedef struct oceanic_atom2_layout_info_t {
+	unsigned int model;
+	oceanic_atom2_layout_t layout;
+} oceanic_atom2_layout_info_t;
+
+static const oceanic_atom2_layout_info_t oceanic_atom2_layouts[] = {
+	{ ATOM1,    {0x28, 0x10, 0x20, DT_STANDARD, MODE_NORMAL_ONLY, 3, 0x24, 0x00, 0, 0x17, 0x00, 0x08, 0x04, TEMP_DIRECT, 6, PRESSURE_DELTA, 2, DEPTH_BYTE16, TANK_DEFAULT, DECO_NONE, RBT_NONE, 0, 0} },
+	{ EPICA,    {0x48, 0x10, 0x40, DT_STANDARD, MODE_NORMAL_ONLY, 3, 0x44, 0x00, 0, 0x17, 0x00, 0x08, 0x04, TEMP_DELTA_BIT0, 0, PRESSURE_DELTA, 2, DEPTH_12BIT2, TANK_ATOM2, DECO_NONE, RBT_NONE, 0, 0} },
+	{ VT3,      {0x48, 0x10, 0x40, DT_VT3, MODE_BYTE2, 3, 0x44, 0x00, 0, 0x17, 0x00, 0x08, 0x04, TEMP_DELTA_INV0, 0, PRESSURE_DELTA, 2, DEPTH_12BIT2, TANK_DEFAULT, DECO_NONE, RBT_NONE, 0, 0} },
+	{ T3A,      {0x48, 0x10, 0x40, DT_VT3, MODE_NORMAL_ONLY, 3, 0x44, 0x00, 0, 0x17, 0x00, 0x08, 0x04, TEMP_DELTA_INV0, 0, PRESSURE_DELTA, 2, DEPTH_12BIT2, TANK_DEFAULT, DECO_NONE, RBT_NONE, 0, 0} },
+	{ ATOM2,    {0x48, 0x10, 0x40, DT_STANDARD, MODE_NORMAL_ONLY, 3, 0x44, 0x00, 0, 0x17, 0x00, 0x08, 0x04, TEMP_DELTA_BIT0, 0, PRESSURE_DELTA, 2, DEPTH_12BIT2, TANK_ATOM2, DECO_NONE, RBT_NONE, 0, 0} },
+	{ GEO,      {0x38, 0x10, 0x30, DT_STANDARD, MODE_NORMAL_ONLY, 3, 0x34, 0x00, 0, 0x17, 0x00, 0x08, 0x04, TEMP_DIRECT, 6, PRESSURE_NONE, 2, DEPTH_12BIT2, TANK_DEFAULT, DECO_NONE, RBT_NONE, 0, 0} },
+	{ MANTA,    {0x38, 0x10, 0x30, DT_STANDARD, MODE_NORMAL_ONLY, 3, 0x34, 0x00, 0, 0x17, 0x00, 0x08, 0x04, TEMP_DIRECT, 6, PRESSURE_NONE, 2, DEPTH_12BIT2, TANK_DEFAULT, DECO_NONE, RBT_NONE, 0, 0} },
+	{ DATAMASK, {0x38, 0x10, 0x30, DT_VT3, MODE_NORMAL_ONLY, 1, 0x33, 0x00, 0, 0x17, 0x00, 0x08, 0x04, TEMP_DELTA_INV0, 0, PRESSURE_DELTA, 2, DEPTH_12BIT2, TANK_DATAMASK, DECO_NONE, RBT_NONE, 0, 0} },
+	{ COMPUMASK, {0x38, 0x10, 0x30, DT_VT3, MODE_NORMAL_ONLY, 1, 0x33, 0x00, 0, 0x17, 0x00, 0x08, 0x04, TEMP_DELTA_INV0, 0, PRESSURE_DELTA, 2, DEPTH_12BIT2, TANK_DATAMASK, DECO_NONE, RBT_NONE, 0, 0} },
+	{ OC1A,     {0x48, 0x10, 0x40, DT_OC1, MODE_NORMAL_ONLY, 3, 0x44, 0x00, 0, 0x17, 0x00, 0x10, 0x04, TEMP_DIRECT, 3, PRESSURE_12BIT10, 2, DEPTH_12BIT4, TANK_DEFAULT, DECO_NONE, RBT_NONE, 0, 0} },
+	{ F10A,     {0x30, 0x00, 0x28, DT_FREEDIVE, MODE_FREEDIVE_ONLY, 3, 0x2C, 0x00, 0, 0x17, 0x00, 0x08, 0x02, TEMP_DELTA_INV0, 0, PRESSURE_DELTA, 2, DEPTH_12BIT2, TANK_DEFAULT, DECO_NONE, RBT_NONE, 0, 0} },
+	{ WISDOM2,  {0x48, 0x10, 0x40, DT_STANDARD, MODE_NORMAL_ONLY, 3, 0x44, 0x00, 0, 0x17, 0x00, 0x08, 0x04, TEMP_DELTA_BIT0, 0, PRESSURE_DELTA, 2, DEPTH_12BIT2, TANK_DEFAULT, DECO_NONE, RBT_NONE, 0, 0} },
+	{ INSIGHT2, {0x38, 0x10, 0x30, DT_VT3, MODE_NORMAL_ONLY, 3, 0x34, 0x00, 0, 0x17, 0x00, 0x08, 0x04, TEMP_DELTA_INV0, 0, PRESSURE_DELTA, 2, DEPTH_12BIT2, TANK_DEFAULT, DECO_NONE, RBT_NONE, 0, 0} },
+	{ ELEMENT2, {0x48, 0x10, 0x40, DT_STANDARD, MODE_NORMAL_ONLY, 3, 0x44, 0x00, 0, 0x17, 0x00, 0x08, 0x04, TEMP_DIRECT, 6, PRESSURE_NONE, 2, DEPTH_12BIT2, TANK_DEFAULT, DECO_NONE, RBT_NONE, 0, 0} },
+	{ VEO20,    {0x38, 0x10, 0x30, DT_VT3, MODE_BYTE1, 3, 0x34, 0x00, 0, 0x17, 0x00, 0x08, 0x04, TEMP_DIRECT, 3, PRESSURE_NONE, 2, DEPTH_12BIT4, TANK_DEFAULT, DECO_NONE, RBT_NONE, 0, 0} },
+	{ VEO30,    {0x38, 0x10, 0x30, DT_VT3, MODE_BYTE1, 3, 0x34, 0x00, 0, 0x17, 0x00, 0x08, 0x04, TEMP_DIRECT, 3, PRESSURE_NONE, 2, DEPTH_12BIT4, TANK_DEFAULT, DECO_NONE, RBT_NONE, 0, 0} },
+	{ ZEN,      {0x38, 0x10, 0x30, DT_STANDARD, MODE_NORMAL_ONLY, 2, 0x34, 0x00, 0, 0x17, 0x00, 0x08, 0x04, TEMP_DIRECT, 6, PRESSURE_NONE, 2, DEPTH_12BIT2, TANK_DEFAULT, DECO_ZEN, RBT_NONE, 0, 0} },
+	{ ZENAIR,   {0x48, 0x10, 0x40, DT_ZENAIR, MODE_NORMAL_ONLY, 3, 0x44, 0x00, 0, 0x17, 0x00, 0x08, 0x04, TEMP_DELTA_BIT5, 0, PRESSURE_5PSI, 2, DEPTH_12BIT2, TANK_DEFAULT, DECO_NONE, RBT_NONE, 0, 0} },
+	{ ATMOSAI2, {0x48, 0x10, 0x40, DT_STANDARD, MODE_NORMAL_ONLY, 3, 0x44, 0x00, 0, 0x17, 0x00, 0x08, 0x04, TEMP_DELTA_BIT0, 0, PRESSURE_DELTA, 2, DEPTH_12BIT2, TANK_DEFAULT, DECO_NONE, RBT_NONE, 0, 0} },
+	{ PROPLUS21, {0x48, 0x10, 0x40, DT_STANDARD, MODE_NORMAL_ONLY, 3, 0x44, 0x00, 0, 0x17, 0x00, 0x08, 0x04, TEMP_DELTA_BIT0, 0, PRESSURE_DELTA, 2, DEPTH_12BIT2, TANK_DEFAULT, DECO_NONE, RBT_NONE, 0, 0} },
+	{ GEO20,    {0x38, 0x10, 0x30, DT_VT3, MODE_NORMAL_ONLY, 3, 0x34, 0x00, 0, 0x17, 0x00, 0x08, 0x04, TEMP_DIRECT, 3, PRESSURE_NONE, 2, DEPTH_12BIT4, TANK_DEFAULT, DECO_NONE, RBT_NONE, 0, 0} },
+	{ VT4,      {0x58, 0x10, 0x30, DT_OC1, MODE_NORMAL_ONLY, 4, 0x34, 0x00, 0, 0x17, 0x00, 0x08, 0x04, TEMP_PACKED, 0, PRESSURE_5PSI, 2, DEPTH_12BIT2, TANK_DEFAULT, DECO_NONE, RBT_NONE, 0, 0} },
+	{ OC1B,     {0x48, 0x10, 0x40, DT_OC1, MODE_NORMAL_ONLY, 3, 0x44, 0x00, 0, 0x17, 0x00, 0x10, 0x04, TEMP_DIRECT, 3, PRESSURE_12BIT10, 2, DEPTH_12BIT4, TANK_DEFAULT, DECO_NONE, RBT_NONE, 0, 0} },
+	{ VOYAGER2G, {0x48, 0x10, 0x40, DT_ZENAIR, MODE_NORMAL_ONLY, 3, 0x44, 0x00, 0, 0x17, 0x00, 0x08, 0x04, TEMP_DELTA_BIT5, 0, PRESSURE_DELTA, 2, DEPTH_12BIT2, TANK_DEFAULT, DECO_NONE, RBT_NONE, 0, 0} },
+	{ ATOM3,    {0x48, 0x10, 0x40, DT_OC1, MODE_NORMAL_ONLY, 3, 0x44, 0x00, 0, 0x17, 0x00, 0x08, 0x04, TEMP_PACKED, 0, PRESSURE_5PSI, 2, DEPTH_12BIT2, TANK_DEFAULT, DECO_NONE, RBT_NONE, 0, 0} },
+	{ DG03,     {0x48, 0x10, 0x40, DT_VT3, MODE_BYTE2, 3, 0x44, 0x00, 0, 0x17, 0x00, 0x08, 0x04, TEMP_DELTA_INV5, 0, PRESSURE_5PSI, 2, DEPTH_12BIT2, TANK_DEFAULT, DECO_ZEN, RBT_NONE, 0, 0} },
+	{ OCS,      {0x38, 0x10, 0x30, DT_OC1, MODE_NORMAL_ONLY, 3, 0x34, 0x00, 0, 0x17, 0x00, 0x08, 0x04, TEMP_DIRECT, 1, PRESSURE_NONE, 2, DEPTH_12BIT2, TANK_DEFAULT, DECO_NONE, RBT_NONE, 0, 0} },
+	{ OC1C,     {0x48, 0x10, 0x40, DT_OC1, MODE_NORMAL_ONLY, 3, 0x44, 0x00, 0, 0x17, 0x00, 0x10, 0x04, TEMP_DIRECT, 3, PRESSURE_12BIT10, 2, DEPTH_12BIT4, TANK_DEFAULT, DECO_NONE, RBT_NONE, 0, 0} },
+	{ VT41,     {0x58, 0x10, 0x30, DT_OC1, MODE_NORMAL_ONLY, 4, 0x34, 0x00, 0, 0x17, 0x00, 0x08, 0x04, TEMP_PACKED, 0, PRESSURE_5PSI, 2, DEPTH_12BIT2, TANK_DEFAULT, DECO_NONE, RBT_NONE, 0, 0} },
+	{ EPICB,    {0x48, 0x10, 0x40, DT_STANDARD, MODE_NORMAL_ONLY, 3, 0x44, 0x00, 0, 0x17, 0x00, 0x08, 0x04, TEMP_DELTA_BIT0, 0, PRESSURE_DELTA, 2, DEPTH_12BIT2, TANK_ATOM2, DECO_NONE, RBT_NONE, 0, 0} },
+	{ T3B,      {0x48, 0x10, 0x40, DT_VT3, MODE_BYTE2, 3, 0x44, 0x00, 0, 0x17, 0x00, 0x08, 0x04, TEMP_DELTA_INV0, 0, PRESSURE_DELTA, 2, DEPTH_12BIT2, TANK_DEFAULT, DECO_NONE, RBT_NONE, 0, 0} },
+	{ ATOM31,   {0x48, 0x10, 0x40, DT_OC1, MODE_NORMAL_ONLY, 3, 0x44, 0x00, 0, 0x17, 0x00, 0x08, 0x04, TEMP_PACKED, 0, PRESSURE_5PSI, 2, DEPTH_12BIT2, TANK_DEFAULT, DECO_ATOM31, RBT_ATOM31, 0, 0} },
+	{ A300AI,   {0x48, 0x10, 0x30, DT_OC1, MODE_NORMAL_ONLY, 4, 0x34, 0x00, 0, 0x17, 0x00, 0x08, 0x04, TEMP_PACKED, 0, PRESSURE_5PSI, 2, DEPTH_12BIT2, TANK_DEFAULT, DECO_NONE, RBT_NONE, 0, 0} },
+	{ WISDOM3,  {0x48, 0x10, 0x40, DT_STANDARD, MODE_NORMAL_ONLY, 3, 0x44, 0x00, 0, 0x17, 0x00, 0x08, 0x04, TEMP_DELTA_BIT0, 0, PRESSURE_DELTA, 2, DEPTH_12BIT2, TANK_DEFAULT, DECO_NONE, RBT_NONE, 0, 0} },
+	{ A300,     {0x38, 0x10, 0x30, DT_STANDARD, MODE_NORMAL_ONLY, 3, 0x34, 0x00, 0, 0x17, 0x00, 0x08, 0x04, TEMP_DIRECT, 3, PRESSURE_NONE, 2, DEPTH_12BIT4, TANK_DEFAULT, DECO_NONE, RBT_NONE, 0, 0} },
+	{ TX1,      {0x68, 0x10, 0x60, DT_TX1, MODE_NORMAL_ONLY, 6, 0x3E, 0x48, 1, 0x17, 0x00, 0x10, 0x04, TEMP_DIRECT, 1, PRESSURE_UINT16, 2, DEPTH_12BIT2, TANK_DEFAULT, DECO_TX1, RBT_NONE, 0, 0} },
+	{ MUNDIAL2, {0x30, 0x00, 0x28, DT_FREEDIVE, MODE_FREEDIVE_ONLY, 3, 0x2C, 0x00, 0, 0x17, 0x00, 0x08, 0x02, TEMP_DELTA_INV0, 0, PRESSURE_DELTA, 2, DEPTH_12BIT2, TANK_DEFAULT, DECO_NONE, RBT_NONE, 0, 0} },
+	{ AMPHOS,   {0x48, 0x10, 0x40, DT_ZENAIR, MODE_NORMAL_ONLY, 3, 0x44, 0x00, 0, 0x17, 0x00, 0x08, 0x04, TEMP_DELTA_BIT5, 0, PRESSURE_DELTA, 2, DEPTH_12BIT2, TANK_DEFAULT, DECO_NONE, RBT_NONE, 0, 0} },
+	{ AMPHOSAIR, {0x48, 0x10, 0x40, DT_ZENAIR, MODE_NORMAL_ONLY, 3, 0x44, 0x00, 0, 0x17, 0x00, 0x08, 0x04, TEMP_DELTA_BIT5, 0, PRESSURE_5PSI, 2, DEPTH_12BIT2, TANK_DEFAULT, DECO_NONE, RBT_NONE, 0, 0} },
+	{ PROPLUS3, {0x38, 0x10, 0x30, DT_VT3, MODE_NORMAL_ONLY, 3, 0x34, 0x00, 0, 0x17, 0x00, 0x08, 0x04, TEMP_DELTA_INV5, 0, PRESSURE_5PSI, 2, DEPTH_12BIT2, TANK_DEFAULT, DECO_NONE, RBT_NONE, 0, 0} },
+	{ F11A,     {0x50, 0x00, 0x48, DT_FREEDIVE, MODE_FREEDIVE_ONLY, 3, 0x4C, 0x00, 0, 0x17, 0x29, 0x08, 0x02, TEMP_DELTA_INV0, 0, PRESSURE_DELTA, 2, DEPTH_12BIT2, TANK_DEFAULT, DECO_NONE, RBT_NONE, 0, 0} },
+	{ OCI,      {0x48, 0x10, 0x40, DT_OC1, MODE_NORMAL_ONLY, 4, 0x28, 0x00, 0, 0x17, 0x00, 0x10, 0x04, TEMP_DIRECT, 3, PRESSURE_12BIT10, 2, DEPTH_12BIT4, TANK_DEFAULT, DECO_NONE, RBT_NONE, 0, 0} },
+	{ A300CS,   {0x50, 0x10, 0x48, DT_A300CS, MODE_NORMAL_ONLY, 4294967295, 0x2A, 0x00, 0, 0x1F, 0x00, 0x10, 0x04, TEMP_DIRECT, 11, PRESSURE_UINT16, 16, DEPTH_12BIT2, TANK_CS, DECO_CS, RBT_NONE, 1, 0} },
+	{ MUNDIAL3, {0x30, 0x00, 0x28, DT_FREEDIVE, MODE_FREEDIVE_ONLY, 3, 0x2C, 0x00, 0, 0x17, 0x00, 0x08, 0x02, TEMP_DELTA_INV0, 0, PRESSURE_DELTA, 2, DEPTH_12BIT2, TANK_DEFAULT, DECO_NONE, RBT_NONE, 0, 0} },
+	{ F10B,     {0x30, 0x00, 0x28, DT_FREEDIVE, MODE_FREEDIVE_ONLY, 3, 0x2C, 0x00, 0, 0x17, 0x00, 0x08, 0x02, TEMP_DELTA_INV0, 0, PRESSURE_DELTA, 2, DEPTH_12BIT2, TANK_DEFAULT, DECO_NONE, RBT_NONE, 0, 0} },
+	{ F11B,     {0x50, 0x00, 0x48, DT_FREEDIVE, MODE_FREEDIVE_ONLY, 3, 0x4C, 0x00, 0, 0x17, 0x29, 0x08, 0x02, TEMP_DELTA_INV0, 0, PRESSURE_DELTA, 2, DEPTH_12BIT2, TANK_DEFAULT, DECO_NONE, RBT_NONE, 0, 0} },
+	{ XPAIR,    {0x48, 0x10, 0x30, DT_OC1, MODE_NORMAL_ONLY, 4, 0x34, 0x00, 0, 0x17, 0x00, 0x08, 0x04, TEMP_PACKED, 0, PRESSURE_5PSI, 2, DEPTH_12BIT2, TANK_DEFAULT, DECO_ATOM31, RBT_VISION, 0, 0} },
+	{ VISION,   {0x48, 0x10, 0x30, DT_OC1, MODE_NORMAL_ONLY, 4, 0x34, 0x00, 0, 0x17, 0x00, 0x08, 0x04, TEMP_PACKED, 0, PRESSURE_5PSI, 2, DEPTH_12BIT2, TANK_DEFAULT, DECO_ATOM31, RBT_VISION, 0, 0} },
+	{ VTX,      {0x50, 0x10, 0x48, DT_A300CS, MODE_NORMAL_ONLY, 4294967295, 0x2A, 0x00, 0, 0x1F, 0x00, 0x10, 0x04, TEMP_DIRECT, 11, PRESSURE_UINT16, 16, DEPTH_12BIT2, TANK_CS, DECO_CS, RBT_NONE, 1, 0} },
+	{ I300,     {0x38, 0x10, 0x30, DT_VT3, MODE_NORMAL_ONLY, 3, 0x34, 0x00, 0, 0x17, 0x00, 0x08, 0x04, TEMP_DIRECT, 3, PRESSURE_NONE, 2, DEPTH_12BIT4, TANK_DEFAULT, DECO_NONE, RBT_NONE, 0, 0} },
+	{ I750TC,   {0x50, 0x10, 0x48, DT_A300CS, MODE_NORMAL_ONLY, 4294967295, 0x2A, 0x00, 0, 0x1F, 0x00, 0x10, 0x04, TEMP_DIRECT, 11, PRESSURE_UINT16, 16, DEPTH_12BIT2, TANK_CS, DECO_CS, RBT_NONE, 1, 0} },
+	{ I450T,    {0x50, 0x10, 0x48, DT_A300CS, MODE_NORMAL_ONLY, 3, 0x30, 0x00, 0, 0x1F, 0x00, 0x10, 0x04, TEMP_DIRECT, 3, PRESSURE_12BIT10, 2, DEPTH_12BIT4, TANK_DEFAULT, DECO_CS, RBT_I450T, 0, 1} },
+	{ I550,     {0x38, 0x10, 0x30, DT_OC1, MODE_NORMAL_ONLY, 3, 0x34, 0x00, 0, 0x17, 0x00, 0x08, 0x04, TEMP_DELTA_INV5, 0, PRESSURE_5PSI, 2, DEPTH_12BIT2, TANK_DEFAULT, DECO_ATOM31, RBT_VISION, 0, 0} },
+};
+
+// The layout for a model that is not in the registry.
+static const oceanic_atom2_layout_t oceanic_atom2_layout_default =
+	{0x48, 0x10, 0x40, DT_STANDARD, MODE_NORMAL_ONLY, 3, 0x44, 0x00, 0, 0x17, 0x00, 0x08, 0x04, TEMP_DELTA_INV0, 0, PRESSURE_DELTA, 2, DEPTH_12BIT2, TANK_DEFAULT, DECO_NONE, RBT_NONE, 0, 0};
+
+static void
+oceanic_atom2_layout_init (oceanic_atom2_layout_t *layout, unsigned int model)
+{
+	for (unsigned int i = 0; i < C_ARRAY_SIZE (oceanic_atom2_layouts); ++i) {
+		if (oceanic_atom2_layouts[i].model == model) {
+			*layout = oceanic_atom2_layouts[i].layout;
+			return;
+		}
+	}
+
+	*layout = oceanic_atom2_layout_default;
+}
+
+
 dc_status_t
 oceanic_atom2_parser_create (dc_parser_t **out, dc_context_t *context, unsigned int model)
 {
@@ -146,33 +344,7 @@ oceanic_atom2_parser_create (dc_parser_t **out, dc_context_t *context, unsigned
 
 	// Set the default values.
 	parser->model = model;
-	parser->headersize = 9 * PAGESIZE / 2;
-	parser->footersize = 2 * PAGESIZE / 2;
-	if (model == DATAMASK || model == COMPUMASK ||
-		model == GEO || model == GEO20 ||
-		model == VEO20 || model == VEO30 ||
-		model == OCS || model == PROPLUS3 ||
-		model == A300 || model == MANTA ||
-		model == INSIGHT2 || model == ZEN ||
-		model == I300 || model == I550) {
-		parser->headersize -= PAGESIZE;
-	} else if (model == VT4 || model == VT41) {
-		parser->headersize += PAGESIZE;
-	} else if (model == TX1) {
-		parser->headersize += 2 * PAGESIZE;
-	} else if (model == ATOM1) {
-		parser->headersize -= 2 * PAGESIZE;
-	} else if (model == F10A || model == F10B ||
-		model == MUNDIAL2 || model == MUNDIAL3) {
-		parser->headersize = 3 * PAGESIZE;
-		parser->footersize = 0;
-	} else if (model == F11A || model == F11B) {
-		parser->headersize = 5 * PAGESIZE;
-		parser->footersize = 0;
-	} else if (model == A300CS || model == VTX ||
-		model == I450T || model == I750TC) {
-		parser->headersize = 5 * PAGESIZE;
-	}
+	oceanic_atom2_layout_init (&parser->layout, model);
 
 	parser->cached = 0;
 	parser->header = 0;
@@ -218,11 +390,10 @@ static dc_status_t
 oceanic_atom2_parser_get_datetime (dc_parser_t *abstract, dc_datetime_t *datetime)
 {
 	oceanic_atom2_parser_t *parser = (oceanic_atom2_parser_t *) abstract;
+	const oceanic_atom2_layout_t *layout = &parser->layout;
 
 	unsigned int header = 8;
-	if (parser->model == F10A || parser->model == F10B ||
-		parser->model == F11A || parser->model == F11B ||
-		parser->model == MUNDIAL2 || parser->model == MUNDIAL3)
+	if (layout->datetime == DT_FREEDIVE)
 		header = 32;
 
 	if (abstract->size < header)
@@ -234,60 +405,29 @@ oceanic_atom2_parser_get_datetime (dc_parser_t *abstract, dc_datetime_t *datetim
 		// AM/PM bit of the 12-hour clock.
 		unsigned int pm = p[1] & 0x80;
 
-		switch (parser->model) {
-		case OC1A:
-		case OC1B:
-		case OC1C:
-		case OCS:
-		case VT4:
-		case VT41:
-		case ATOM3:
-		case ATOM31:
-		case A300AI:
-		case OCI:
-		case I550:
-		case VISION:
-		case XPAIR:
+		switch (layout->datetime) {
+		case DT_OC1:
 			datetime->year   = ((p[5] & 0xE0) >> 5) + ((p[7] & 0xE0) >> 2) + 2000;
 			datetime->month  = (p[3] & 0x0F);
 			datetime->day    = ((p[0] & 0x80) >> 3) + ((p[3] & 0xF0) >> 4);
 			datetime->hour   = bcd2dec (p[1] & 0x1F);
 			datetime->minute = bcd2dec (p[0] & 0x7F);
 			break;
-		case VT3:
-		case VEO20:
-		case VEO30:
-		case DG03:
-		case T3A:
-		case T3B:
-		case GEO20:
-		case PROPLUS3:
-		case DATAMASK:
-		case COMPUMASK:
-		case INSIGHT2:
-		case I300:
+		case DT_VT3:
 			datetime->year   = ((p[3] & 0xE0) >> 1) + (p[4] & 0x0F) + 2000;
 			datetime->month  = (p[4] & 0xF0) >> 4;
 			datetime->day    = p[3] & 0x1F;
 			datetime->hour   = bcd2dec (p[1] & 0x1F);
 			datetime->minute = bcd2dec (p[0]);
 			break;
-		case ZENAIR:
-		case AMPHOS:
-		case AMPHOSAIR:
-		case VOYAGER2G:
+		case DT_ZENAIR:
 			datetime->year   = (p[3] & 0x1F) + 2000;
 			datetime->month  = (p[7] & 0xF0) >> 4;
 			datetime->day    = ((p[3] & 0x80) >> 3) + ((p[5] & 0xF0) >> 4);
 			datetime->hour   = bcd2dec (p[1] & 0x1F);
 			datetime->minute = bcd2dec (p[0]);
 			break;
-		case F10A:
-		case F10B:
-		case F11A:
-		case F11B:
-		case MUNDIAL2:
-		case MUNDIAL3:
+		case DT_FREEDIVE:
 			datetime->year   = bcd2dec (p[6]) + 2000;
 			datetime->month  = bcd2dec (p[7]);
 			datetime->day    = bcd2dec (p[8]);
@@ -295,17 +435,14 @@ oceanic_atom2_parser_get_datetime (dc_parser_t *abstract, dc_datetime_t *datetim
 			datetime->minute = bcd2dec (p[12]);
 			pm = p[13] & 0x80;
 			break;
-		case TX1:
+		case DT_TX1:
 			datetime->year   = bcd2dec (p[13]) + 2000;
 			datetime->month  = bcd2dec (p[14]);
 			datetime->day    = bcd2dec (p[15]);
 			datetime->hour   = p[11];
 			datetime->minute = p[10];
 			break;
-		case A300CS:
-		case VTX:
-		case I450T:
-		case I750TC:
+		case DT_A300CS:
 			datetime->year   = (p[10]) + 2000;
 			datetime->month  = (p[8]);
 			datetime->day    = (p[9]);
@@ -366,6 +503,7 @@ oceanic_atom2_parser_get_datetime (dc_parser_t *abstract, dc_datetime_t *datetim
 static dc_status_t
 oceanic_atom2_parser_cache (oceanic_atom2_parser_t *parser)
 {
+	const oceanic_atom2_layout_t *layout = &parser->layout;
 	const unsigned char *data = parser->base.data;
 	unsigned int size = parser->base.size;
 
@@ -374,57 +512,38 @@ oceanic_atom2_parser_cache (oceanic_atom2_parser_t *parser)
 	}
 
 	// Get the total amount of bytes before and after the profile data.
-	unsigned int headersize = parser->headersize;
-	unsigned int footersize = parser->footersize;
+	unsigned int headersize = layout->headersize;
+	unsigned int footersize = layout->footersize;
 	if (size < headersize + footersize)
 		return DC_STATUS_DATAFORMAT;
 
 	// Get the offset to the header and footer sample.
-	unsigned int header = headersize - PAGESIZE / 2;
+	unsigned int header = layout->header;
 	unsigned int footer = size - footersize;
-	if (parser->model == VT4 || parser->model == VT41 ||
-		parser->model == A300AI || parser->model == VISION ||
-		parser->model == XPAIR) {
-		header = 3 * PAGESIZE;
-	}
 
 	// Get the dive mode.
 	unsigned int mode = NORMAL;
-	if (parser->model == F10A || parser->model == F10B ||
-		parser->model == F11A || parser->model == F11B ||
-		parser->model == MUNDIAL2 || parser->model == MUNDIAL3) {
+	switch (layout->mode) {
+	case MODE_FREEDIVE_ONLY:
 		mode = FREEDIVE;
-	} else if (parser->model == T3B || parser->model == VT3 ||
-		parser->model == DG03) {
+		break;
+	case MODE_BYTE2:
 		mode = (data[2] & 0xC0) >> 6;
-	} else if (parser->model == VEO20 || parser->model == VEO30) {
+		break;
+	case MODE_BYTE1:
 		mode = (data[1] & 0x60) >> 5;
+		break;
+	default:
+		break;
 	}
 
 	// Get the gas mixes.
 	unsigned int ngasmixes = 0;
-	unsigned int o2_offset = 0;
-	unsigned int he_offset = 0;
+	unsigned int o2_offset = layout->o2_offset;
+	unsigned int he_offset = layout->he_offset;
 	if (mode == FREEDIVE) {
 		ngasmixes = 0;
-	} else if (parser->model == DATAMASK || parser->model == COMPUMASK) {
-		ngasmixes = 1;
-		o2_offset = header + 3;
-	} else if (parser->model == VT4 || parser->model == VT41 ||
-		parser->model == A300AI || parser->model == VISION ||
-		parser->model == XPAIR) {
-		o2_offset = header + 4;
-		ngasmixes = 4;
-	} else if (parser->model == OCI) {
-		o2_offset = 0x28;
-		ngasmixes = 4;
-	} else if (parser->model == TX1) {
-		o2_offset = 0x3E;
-		he_offset = 0x48;
-		ngasmixes = 6;
-	} else if (parser->model == A300CS || parser->model == VTX ||
-		parser->model == I750TC) {
-		o2_offset = 0x2A;
+	} else if (layout->ngasmixes == NGASMIXES_HEADER) {
 		if (data[0x39] & 0x04) {
 			ngasmixes = 1;
 		} else if (data[0x39] & 0x08) {
@@ -434,15 +553,8 @@ oceanic_atom2_parser_cache (oceanic_atom2_parser_t *parser)
 		} else {
 			ngasmixes = 4;
 		}
-	} else if (parser->model == I450T) {
-		o2_offset = 0x30;
-		ngasmixes = 3;
-	} else if (parser->model == ZEN) {
-		o2_offset = header + 4;
-		ngasmixes = 2;
 	} else {
-		o2_offset = header + 4;
-		ngasmixes = 3;
+		ngasmixes = layout->ngasmixes;
 	}
 
 	// Cache the data for later use.
@@ -482,8 +594,12 @@ oceanic_atom2_parser_get_field (dc_parser_t *abstract, dc_field_type_t type, uns
 	if (status != DC_STATUS_SUCCESS)
 		return status;
 
-	// Cache the profile data.
-	if (parser->cached < PROFILE) {
+	// Cache the profile data. Only the dive time and maximum depth are
+	// derived from the profile (and only for the non freedive models,
+	// which store them in the header), so the other fields are served
+	// from the header cache without decoding the entire profile.
+	if (parser->cached < PROFILE && parser->mode != FREEDIVE &&
+		(type == DC_FIELD_DIVETIME || type == DC_FIELD_MAXDEPTH)) {
 		sample_statistics_t statistics = SAMPLE_STATISTICS_INITIALIZER;
 		status = oceanic_atom2_parser_samples_foreach (
 			abstract, sample_statistics_cb, &statistics);
@@ -501,17 +617,13 @@ oceanic_atom2_parser_get_field (dc_parser_t *abstract, dc_field_type_t type, uns
 	if (value) {
 		switch (type) {
 		case DC_FIELD_DIVETIME:
-			if (parser->model == F10A || parser->model == F10B ||
-				parser->model == F11A || parser->model == F11B ||
-				parser->model == MUNDIAL2 || parser->model == MUNDIAL3)
+			if (parser->layout.mode == MODE_FREEDIVE_ONLY)
 				*((unsigned int *) value) = bcd2dec (data[2]) + bcd2dec (data[3]) * 60;
 			else
 				*((unsigned int *) value) = parser->divetime;
 			break;
 		case DC_FIELD_MAXDEPTH:
-			if (parser->model == F10A || parser->model == F10B ||
-				parser->model == F11A || parser->model == F11B ||
-				parser->model == MUNDIAL2 || parser->model == MUNDIAL3)
+			if (parser->layout.mode == MODE_FREEDIVE_ONLY)
 				*((double *) value) = array_uint16_le (data + 4) / 16.0 * FEET;
 			else
 				*((double *) value) = (array_uint16_le (data + parser->footer + 4) & 0x0FFF) / 16.0 * FEET;
@@ -520,13 +632,14 @@ oceanic_atom2_parser_get_field (dc_parser_t *abstract, dc_field_type_t type, uns
 			*((unsigned int *) value) = parser->ngasmixes;
 			break;
 		case DC_FIELD_GASMIX:
+			if (flags >= parser->ngasmixes)
+				return DC_STATUS_INVALIDARGS;
 			gasmix->oxygen = parser->oxygen[flags] / 100.0;
 			gasmix->helium = parser->helium[flags] / 100.0;
 			gasmix->nitrogen = 1.0 - gasmix->oxygen - gasmix->helium;
 			break;
 		case DC_FIELD_SALINITY:
-			if (parser->model == A300CS || parser->model == VTX ||
-				parser->model == I750TC) {
+			if (parser->layout.salinity) {
 				if (data[0x18] & 0x80) {
 					water->type = DC_WATER_FRESH;
 				} else {
@@ -596,11 +709,25 @@ oceanic_atom2_parser_vendor (oceanic_atom2_parser_t *parser, const unsigned char
 	}
 }
 
+// Report a region of corrupt sample data that was skipped in recovery
+// mode, see dc_parser_set_recovery.
+static void
+oceanic_atom2_parser_gap (unsigned int nbytes, dc_sample_callback_t callback, void *userdata)
+{
+	dc_sample_value_t sample = {0};
+	sample.event.type = SAMPLE_EVENT_GAP;
+	sample.event.time = 0;
+	sample.event.flags = 0;
+	sample.event.value = nbytes;
+	if (callback) callback (DC_SAMPLE_EVENT, sample, userdata);
+}
+
 static dc_status_t
 oceanic_atom2_parser_samples_foreach (dc_parser_t *abstract, dc_sample_callback_t callback, void *userdata)
 {
 	dc_status_t status = DC_STATUS_SUCCESS;
 	oceanic_atom2_parser_t *parser = (oceanic_atom2_parser_t *) abstract;
+	const oceanic_atom2_layout_t *layout = &parser->layout;
 
 	const unsigned char *data = abstract->data;
 	unsigned int size = abstract->size;
@@ -615,11 +742,7 @@ oceanic_atom2_parser_samples_foreach (dc_parser_t *abstract, dc_sample_callback_
 	unsigned int interval = 1;
 	unsigned int samplerate = 1;
 	if (parser->mode != FREEDIVE) {
-		unsigned int idx = 0x17;
-		if (parser->model == A300CS || parser->model == VTX ||
-			parser->model == I450T || parser->model == I750TC)
-			idx = 0x1f;
-		switch (data[idx] & 0x03) {
+		switch (data[layout->interval] & 0x03) {
 		case 0:
 			interval = 2;
 			break;
@@ -633,9 +756,8 @@ oceanic_atom2_parser_samples_foreach (dc_parser_t *abstract, dc_sample_callback_
 			interval = 60;
 			break;
 		}
-	} else if (parser->model == F11A || parser->model == F11B) {
-		unsigned int idx = 0x29;
-		switch (data[idx] & 0x03) {
+	} else if (layout->interval_freedive) {
+		switch (data[layout->interval_freedive] & 0x03) {
 		case 0:
 			interval = 1;
 			samplerate = 4;
@@ -659,32 +781,18 @@ oceanic_atom2_parser_samples_foreach (dc_parser_t *abstract, dc_sample_callback_
 		}
 	}
 
-	unsigned int samplesize = PAGESIZE / 2;
+	unsigned int samplesize;
 	if (parser->mode == FREEDIVE) {
-		if (parser->model == F10A || parser->model == F10B ||
-			parser->model == F11A || parser->model == F11B ||
-			parser->model == MUNDIAL2 || parser->model == MUNDIAL3) {
-			samplesize = 2;
-		} else {
-			samplesize = 4;
-		}
-	} else if (parser->model == OC1A || parser->model == OC1B ||
-		parser->model == OC1C || parser->model == OCI ||
-		parser->model == TX1 || parser->model == A300CS ||
-		parser->model == VTX || parser->model == I450T ||
-		parser->model == I750TC) {
-		samplesize = PAGESIZE;
+		samplesize = layout->samplesize_freedive;
+	} else {
+		samplesize = layout->samplesize;
 	}
 
 	unsigned int have_temperature = 1, have_pressure = 1;
 	if (parser->mode == FREEDIVE) {
 		have_temperature = 0;
 		have_pressure = 0;
-	} else if (parser->model == VEO30 || parser->model == OCS ||
-		parser->model == ELEMENT2 || parser->model == VEO20 ||
-		parser->model == A300 || parser->model == ZEN ||
-		parser->model == GEO || parser->model == GEO20 ||
-		parser->model == MANTA || parser->model == I300) {
+	} else if (layout->pressure == PRESSURE_NONE) {
 		have_pressure = 0;
 	}
 
@@ -698,11 +806,7 @@ oceanic_atom2_parser_samples_foreach (dc_parser_t *abstract, dc_sample_callback_
 	unsigned int tank = 0;
 	unsigned int pressure = 0;
 	if (have_pressure) {
-		unsigned int idx = 2;
-		if (parser->model == A300CS || parser->model == VTX ||
-			parser->model == I750TC)
-			idx = 16;
-		pressure = array_uint16_le(data + parser->header + idx);
+		pressure = array_uint16_le(data + parser->header + layout->pressure_offset);
 		if (pressure == 10000)
 			have_pressure = 0;
 	}
@@ -713,8 +817,8 @@ oceanic_atom2_parser_samples_foreach (dc_parser_t *abstract, dc_sample_callback_
 	unsigned int count = 0;
 	unsigned int complete = 1;
 	unsigned int previous = 0;
-	unsigned int offset = parser->headersize;
-	while (offset + samplesize <= size - parser->footersize) {
+	unsigned int offset = layout->headersize;
+	while (offset + samplesize <= size - layout->footersize) {
 		dc_sample_value_t sample = {0};
 
 		// Ignore empty samples.
@@ -740,30 +844,41 @@ oceanic_atom2_parser_samples_foreach (dc_parser_t *abstract, dc_sample_callback_
 		unsigned int length = samplesize;
 		if (sampletype == 0xBB) {
 			length = PAGESIZE;
-			if (offset + length > size - parser->footersize) {
+			if (offset + length > size - layout->footersize) {
 				ERROR (abstract->context, "Buffer overflow detected!");
-				return DC_STATUS_DATAFORMAT;
+				if (!abstract->recovery)
+					return DC_STATUS_DATAFORMAT;
+				// The truncated record extends to the end of the
+				// profile, so there is no next record boundary left
+				// to resynchronize at. Report the remainder as a gap.
+				oceanic_atom2_parser_gap ((size - layout->footersize) - offset, callback, userdata);
+				break;
 			}
 		}
 
 		// Check for a tank switch sample.
 		if (sampletype == 0xAA) {
-			if (parser->model == DATAMASK || parser->model == COMPUMASK) {
+			switch (layout->tank) {
+			case TANK_DATAMASK:
 				// Tank pressure (1 psi) and number
 				tank = 0;
 				pressure = (((data[offset + 7] << 8) + data[offset + 6]) & 0x0FFF);
-			} else if (parser->model == A300CS || parser->model == VTX ||
-				parser->model == I750TC) {
+				break;
+			case TANK_CS:
 				// Tank pressure (1 psi) and number (one based index)
 				tank = (data[offset + 1] & 0x03) - 1;
 				pressure = ((data[offset + 7] << 8) + data[offset + 6]) & 0x0FFF;
-			} else {
+				break;
+			case TANK_ATOM2:
+				// Tank pressure (2 psi) and number (one based index)
+				tank = (data[offset + 1] & 0x03) - 1;
+				pressure = (((data[offset + 3] << 8) + data[offset + 4]) & 0x0FFF) * 2;
+				break;
+			default:
 				// Tank pressure (2 psi) and number (one based index)
 				tank = (data[offset + 1] & 0x03) - 1;
-				if (parser->model == ATOM2 || parser->model == EPICA || parser->model == EPICB)
-					pressure = (((data[offset + 3] << 8) + data[offset + 4]) & 0x0FFF) * 2;
-				else
-					pressure = (((data[offset + 4] << 8) + data[offset + 5]) & 0x0FFF) * 2;
+				pressure = (((data[offset + 4] << 8) + data[offset + 5]) & 0x0FFF) * 2;
+				break;
 			}
 		} else if (sampletype == 0xBB) {
 			// The surface time is not always a nice multiple of the samplerate.
@@ -802,14 +917,22 @@ oceanic_atom2_parser_samples_foreach (dc_parser_t *abstract, dc_sample_callback_
 			}
 
 			// Time.
-			if (parser->model == I450T) {
+			if (layout->timestamp) {
 				unsigned int minute = bcd2dec(data[offset + 0]);
 				unsigned int hour   = bcd2dec(data[offset + 1] & 0x0F);
 				unsigned int second = bcd2dec(data[offset + 2]);
 				unsigned int timestamp = (hour * 3600) + (minute * 60 ) + second + extratime;
 				if (timestamp < time) {
 					ERROR (abstract->context, "Timestamp moved backwards.");
-					return DC_STATUS_DATAFORMAT;
+					if (!abstract->recovery)
+						return DC_STATUS_DATAFORMAT;
+					// Resynchronize at the next record boundary. The
+					// fresh record group also keeps the corrupt bytes
+					// out of the vendor samples.
+					oceanic_atom2_parser_gap (length, callback, userdata);
+					offset += length;
+					complete = 1;
+					continue;
 				} else 	if (timestamp == time) {
 					WARNING (abstract->context, "Unexpected sample with the same timestamp ignored.");
 					offset += length;
@@ -830,38 +953,20 @@ oceanic_atom2_parser_samples_foreach (dc_parser_t *abstract, dc_sample_callback_
 
 			// Temperature (°F)
 			if (have_temperature) {
-				if (parser->model == GEO || parser->model == ATOM1 ||
-					parser->model == ELEMENT2 || parser->model == MANTA ||
-					parser->model == ZEN) {
-					temperature = data[offset + 6];
-				} else if (parser->model == GEO20 || parser->model == VEO20 ||
-					parser->model == VEO30 || parser->model == OC1A ||
-					parser->model == OC1B || parser->model == OC1C ||
-					parser->model == OCI || parser->model == A300 ||
-					parser->model == I450T || parser->model == I300) {
-					temperature = data[offset + 3];
-				} else if (parser->model == OCS || parser->model == TX1) {
-					temperature = data[offset + 1];
-				} else if (parser->model == VT4 || parser->model == VT41 ||
-					parser->model == ATOM3 || parser->model == ATOM31 ||
-					parser->model == A300AI || parser->model == VISION ||
-					parser->model == XPAIR) {
+				unsigned int sign;
+				switch (layout->temperature) {
+				case TEMP_DIRECT:
+					temperature = data[offset + layout->temperature_offset];
+					break;
+				case TEMP_PACKED:
 					temperature = ((data[offset + 7] & 0xF0) >> 4) | ((data[offset + 7] & 0x0C) << 2) | ((data[offset + 5] & 0x0C) << 4);
-				} else if (parser->model == A300CS || parser->model == VTX ||
-					parser->model == I750TC) {
-					temperature = data[offset + 11];
-				} else {
-					unsigned int sign;
-					if (parser->model == DG03 || parser->model == PROPLUS3 ||
-						parser->model == I550)
+					break;
+				default:
+					if (layout->temperature == TEMP_DELTA_INV5)
 						sign = (~data[offset + 5] & 0x04) >> 2;
-					else if (parser->model == VOYAGER2G || parser->model == AMPHOS ||
-						parser->model == AMPHOSAIR || parser->model == ZENAIR)
+					else if (layout->temperature == TEMP_DELTA_BIT5)
 						sign = (data[offset + 5] & 0x04) >> 2;
-					else if (parser->model == ATOM2 || parser->model == PROPLUS21 ||
-						parser->model == EPICA || parser->model == EPICB ||
-						parser->model == ATMOSAI2 ||
-						parser->model == WISDOM2 || parser->model == WISDOM3)
+					else if (layout->temperature == TEMP_DELTA_BIT0)
 						sign = (data[offset + 0] & 0x80) >> 7;
 					else
 						sign = (~data[offset + 0] & 0x80) >> 7;
@@ -869,31 +974,30 @@ oceanic_atom2_parser_samples_foreach (dc_parser_t *abstract, dc_sample_callback_
 						temperature -= (data[offset + 7] & 0x0C) >> 2;
 					else
 						temperature += (data[offset + 7] & 0x0C) >> 2;
+					break;
 				}
-				sample.temperature = (temperature - 32.0) * (5.0 / 9.0);
+				sample.temperature = FAHRENHEIT_TO_CELSIUS (temperature);
 				if (callback) callback (DC_SAMPLE_TEMPERATURE, sample, userdata);
 			}
 
 			// Tank Pressure (psi)
 			if (have_pressure) {
-				if (parser->model == OC1A || parser->model == OC1B ||
-					parser->model == OC1C || parser->model == OCI ||
-					parser->model == I450T)
+				switch (layout->pressure) {
+				case PRESSURE_12BIT10:
 					pressure = (data[offset + 10] + (data[offset + 11] << 8)) & 0x0FFF;
-				else if (parser->model == VT4 || parser->model == VT41||
-					parser->model == ATOM3 || parser->model == ATOM31 ||
-					parser->model == ZENAIR ||parser->model == A300AI ||
-					parser->model == DG03 || parser->model == PROPLUS3 ||
-					parser->model == AMPHOSAIR || parser->model == I550 ||
-					parser->model == VISION || parser->model == XPAIR)
+					break;
+				case PRESSURE_5PSI:
 					pressure = (((data[offset + 0] & 0x03) << 8) + data[offset + 1]) * 5;
-				else if (parser->model == TX1 || parser->model == A300CS ||
-					parser->model == VTX || parser->model == I750TC)
+					break;
+				case PRESSURE_UINT16:
 					pressure = array_uint16_le (data + offset + 4);
-				else
+					break;
+				default:
 					pressure -= data[offset + 1];
+					break;
+				}
 				sample.pressure.tank = tank;
-				sample.pressure.value = pressure * PSI / BAR;
+				sample.pressure.value = array_scale (pressure, PSI, BAR);
 				if (callback) callback (DC_SAMPLE_PRESSURE, sample, userdata);
 			}
 
@@ -901,30 +1005,33 @@ oceanic_atom2_parser_samples_foreach (dc_parser_t *abstract, dc_sample_callback_
 			unsigned int depth;
 			if (parser->mode == FREEDIVE)
 				depth = array_uint16_le (data + offset);
-			else if (parser->model == GEO20 || parser->model == VEO20 ||
-				parser->model == VEO30 || parser->model == OC1A ||
-				parser->model == OC1B || parser->model == OC1C ||
-				parser->model == OCI || parser->model == A300 ||
-				parser->model == I450T || parser->model == I300)
+			else if (layout->depth == DEPTH_12BIT4)
 				depth = (data[offset + 4] + (data[offset + 5] << 8)) & 0x0FFF;
-			else if (parser->model == ATOM1)
+			else if (layout->depth == DEPTH_BYTE16)
 				depth = data[offset + 3] * 16;
 			else
 				depth = (data[offset + 2] + (data[offset + 3] << 8)) & 0x0FFF;
-			sample.depth = depth / 16.0 * FEET;
+			sample.depth = array_scale (depth, FEET, 16);
 			if (callback) callback (DC_SAMPLE_DEPTH, sample, userdata);
 
 			// Gas mix
 			unsigned int have_gasmix = 0;
 			unsigned int gasmix = 0;
-			if (parser->model == TX1) {
+			if (layout->sample_gasmix) {
 				gasmix = data[offset] & 0x07;
 				have_gasmix = 1;
 			}
 			if (have_gasmix && gasmix != gasmix_previous) {
 				if (gasmix < 1 || gasmix > parser->ngasmixes) {
 					ERROR (abstract->context, "Invalid gas mix index (%u).", gasmix);
-					return DC_STATUS_DATAFORMAT;
+					if (!abstract->recovery)
+						return DC_STATUS_DATAFORMAT;
+					// Skip the rest of the record, and resynchronize
+					// at the next record boundary.
+					oceanic_atom2_parser_gap (length, callback, userdata);
+					offset += length;
+					complete = 1;
+					continue;
 				}
 				sample.gasmix = gasmix - 1;
 				if (callback) callback (DC_SAMPLE_GASMIX, sample, userdata);
@@ -932,26 +1039,28 @@ oceanic_atom2_parser_samples_foreach (dc_parser_t *abstract, dc_sample_callback_
 			}
 
 			// NDL / Deco
-			unsigned int have_deco = 0;
+			unsigned int have_deco = 1;
 			unsigned int decostop = 0, decotime = 0;
-			if (parser->model == A300CS || parser->model == VTX ||
-				parser->model == I450T || parser->model == I750TC) {
+			switch (layout->deco) {
+			case DECO_CS:
 				decostop = (data[offset + 15] & 0x70) >> 4;
 				decotime = array_uint16_le(data + offset + 6) & 0x03FF;
-				have_deco = 1;
-			} else if (parser->model == ZEN || parser->model == DG03) {
+				break;
+			case DECO_ZEN:
 				decostop = (data[offset + 5] & 0xF0) >> 4;
 				decotime = array_uint16_le(data + offset + 4) & 0x0FFF;
-				have_deco = 1;
-			} else if (parser->model == TX1) {
+				break;
+			case DECO_TX1:
 				decostop = data[offset + 10];
 				decotime = array_uint16_le(data + offset + 6);
-				have_deco = 1;
-			} else if (parser->model == ATOM31 || parser->model == VISION ||
-				parser->model == XPAIR || parser->model == I550) {
+				break;
+			case DECO_ATOM31:
 				decostop = (data[offset + 5] & 0xF0) >> 4;
 				decotime = array_uint16_le(data + offset + 4) & 0x03FF;
-				have_deco = 1;
+				break;
+			default:
+				have_deco = 0;
+				break;
 			}
 			if (have_deco) {
 				if (decostop) {
@@ -965,18 +1074,21 @@ oceanic_atom2_parser_samples_foreach (dc_parser_t *abstract, dc_sample_callback_
 				if (callback) callback (DC_SAMPLE_DECO, sample, userdata);
 			}
 
-			unsigned int have_rbt = 0;
+			unsigned int have_rbt = 1;
 			unsigned int rbt = 0;
-			if (parser->model == ATOM31) {
+			switch (layout->rbt) {
+			case RBT_ATOM31:
 				rbt = array_uint16_le(data + offset + 6) & 0x01FF;
-				have_rbt = 1;
-			} else if (parser->model == I450T) {
+				break;
+			case RBT_I450T:
 				rbt = array_uint16_le(data + offset + 8) & 0x01FF;
-				have_rbt = 1;
-			} else if (parser->model == VISION || parser->model == XPAIR ||
-				parser->model == I550) {
+				break;
+			case RBT_VISION:
 				rbt = array_uint16_le(data + offset + 6) & 0x03FF;
-				have_rbt = 1;
+				break;
+			default:
+				have_rbt = 0;
+				break;
 			}
 			if (have_rbt) {
 				sample.rbt = rbt;
@@ -992,3 +1104,71 @@ oceanic_atom2_parser_samples_foreach (dc_parser_t *abstract, dc_sample_callback_
 
 	return DC_STATUS_SUCCESS;
 }
+
+
+static void
+oceanic_atom2_layout_json (FILE *stream, unsigned int model, const oceanic_atom2_layout_t *layout)
+{
+	if (model != INVALID)
+		fprintf (stream, "{\"model\": %u, ", model);
+	else
+		fprintf (stream, "{\"model\": null, ");
+	fprintf (stream,
+		"\"headersize\": %u, "
+		"\"footersize\": %u, "
+		"\"header\": %u, "
+		"\"datetime\": %u, "
+		"\"mode\": %u, "
+		"\"ngasmixes\": %u, "
+		"\"o2_offset\": %u, "
+		"\"he_offset\": %u, "
+		"\"sample_gasmix\": %u, "
+		"\"interval\": %u, "
+		"\"interval_freedive\": %u, "
+		"\"samplesize\": %u, "
+		"\"samplesize_freedive\": %u, "
+		"\"temperature\": %u, "
+		"\"temperature_offset\": %u, "
+		"\"pressure\": %u, "
+		"\"pressure_offset\": %u, "
+		"\"depth\": %u, "
+		"\"tank\": %u, "
+		"\"deco\": %u, "
+		"\"rbt\": %u, "
+		"\"salinity\": %u, "
+		"\"timestamp\": %u}",
+		layout->headersize,
+		layout->footersize,
+		layout->header,
+		layout->datetime,
+		layout->mode,
+		layout->ngasmixes,
+		layout->o2_offset,
+		layout->he_offset,
+		layout->sample_gasmix,
+		layout->interval,
+		layout->interval_freedive,
+		layout->samplesize,
+		layout->samplesize_freedive,
+		layout->temperature,
+		layout->temperature_offset,
+		layout->pressure,
+		layout->pressure_offset,
+		layout->depth,
+		layout->tank,
+		layout->deco,
+		layout->rbt,
+		layout->salinity,
+		layout->timestamp);
+}
+
+void
+oceanic_atom2_parser_layouts_json (FILE *stream)
+{
+	for (unsigned int i = 0; i < C_ARRAY_SIZE (oceanic_atom2_layouts); ++i) {
+		oceanic_atom2_layout_json (stream, oceanic_atom2_layouts[i].model, &oceanic_atom2_layouts[i].layout);
+		fprintf (stream, ",\n");
+	}
+
+	oceanic_atom2_layout_json (stream, INVALID, &oceanic_atom2_layout_default);
+}
@@ -40,6 +40,12 @@
 
 #define INVALID 0
 
+// The number of pages in the read cache enabled during the dive
+// enumeration. The logbook and profile passes re-read overlapping
+// regions around the ringbuffer extents of each dive, so serving those
+// pages from memory avoids the duplicate traffic (4 KB of cache).
+#define CACHESIZE 256
+
 static unsigned int
 get_profile_first (const unsigned char data[], const oceanic_common_layout_t *layout)
 {
@@ -157,8 +163,9 @@ oceanic_common_device_dump (dc_device_t *abstract, dc_buffer_t *buffer)
 	assert (device->layout != NULL);
 
 	// Erase the current contents of the buffer and
-	// allocate the required amount of memory.
-	if (!dc_buffer_clear (buffer) || !dc_buffer_resize (buffer, device->layout->memsize)) {
+	// allocate the required amount of memory. The entire buffer is
+	// overwritten with the memory dump, so zeroing it isn't needed.
+	if (!dc_buffer_clear (buffer) || !dc_buffer_extend (buffer, device->layout->memsize)) {
 		ERROR (abstract->context, "Insufficient buffer space available.");
 		return DC_STATUS_NOMEMORY;
 	}
@@ -174,6 +181,185 @@ oceanic_common_device_dump (dc_device_t *abstract, dc_buffer_t *buffer)
 }
 
 
+static dc_status_t
+oceanic_common_read_region (dc_device_t *abstract, dc_event_progress_t *progress, unsigned char data[], unsigned int begin, unsigned int end)
+{
+	oceanic_common_device_t *device = (oceanic_common_device_t *) abstract;
+
+	unsigned int blocksize = PAGESIZE * device->multipage;
+
+	unsigned int address = begin;
+	while (address < end) {
+		// Calculate the block size.
+		unsigned int len = end - address;
+		if (len > blocksize)
+			len = blocksize;
+
+		// Read the block.
+		dc_status_t rc = dc_device_read (abstract, address, data + address, len);
+		if (rc != DC_STATUS_SUCCESS) {
+			ERROR (abstract->context, "Failed to read the memory.");
+			return rc;
+		}
+
+		// Update and emit a progress event.
+		if (progress) {
+			progress->current += len;
+			device_event_emit (abstract, DC_EVENT_PROGRESS, progress);
+		}
+
+		address += len;
+	}
+
+	return DC_STATUS_SUCCESS;
+}
+
+
+static dc_status_t
+oceanic_common_get_profile_end (const unsigned char data[], const oceanic_common_layout_t *layout, unsigned int *result)
+{
+	const unsigned char *pointers = data + layout->cf_pointers;
+
+	// Get the logbook pointers.
+	unsigned int rb_logbook_first = array_uint16_le (pointers + 4);
+	unsigned int rb_logbook_last  = array_uint16_le (pointers + 6);
+	if (rb_logbook_first < layout->rb_logbook_begin ||
+		rb_logbook_first >= layout->rb_logbook_end ||
+		rb_logbook_last < layout->rb_logbook_begin ||
+		rb_logbook_last >= layout->rb_logbook_end)
+		return DC_STATUS_DATAFORMAT;
+
+	// Locate the newest logbook entry.
+	unsigned int entry;
+	if (layout->pt_mode_global == 0)
+		entry = rb_logbook_last;
+	else
+		entry = ringbuffer_decrement (rb_logbook_last, layout->rb_logbook_entry_size, layout->rb_logbook_begin, layout->rb_logbook_end);
+
+	// Get the end of profile pointer of the newest entry.
+	unsigned int rb_entry_last = get_profile_last (data + entry, layout);
+	if (rb_entry_last < layout->rb_profile_begin ||
+		rb_entry_last >= layout->rb_profile_end)
+		return DC_STATUS_DATAFORMAT;
+
+	*result = RB_PROFILE_INCR (rb_entry_last, PAGESIZE, layout);
+
+	return DC_STATUS_SUCCESS;
+}
+
+
+dc_status_t
+oceanic_common_device_dump_delta (dc_device_t *abstract, dc_buffer_t *buffer, dc_buffer_t *previous)
+{
+	oceanic_common_device_t *device = (oceanic_common_device_t *) abstract;
+	dc_status_t rc = DC_STATUS_SUCCESS;
+
+	assert (device != NULL);
+	assert (device->layout != NULL);
+
+	const oceanic_common_layout_t *layout = device->layout;
+
+	// Without a usable previous dump, or without the two ringbuffers,
+	// a delta download is not possible.
+	if (previous == NULL ||
+		dc_buffer_get_size (previous) != layout->memsize ||
+		layout->rb_logbook_begin == layout->rb_logbook_end ||
+		layout->rb_profile_begin == layout->rb_profile_end)
+		return oceanic_common_device_dump (abstract, buffer);
+
+	const unsigned char *old = dc_buffer_get_data (previous);
+
+	// The profile end pointer of the previous dump is needed to locate
+	// the start of the newly written profile data.
+	unsigned int rb_profile_old = 0;
+	if (oceanic_common_get_profile_end (old, layout, &rb_profile_old) != DC_STATUS_SUCCESS)
+		return oceanic_common_device_dump (abstract, buffer);
+
+	// Erase the current contents of the buffer, allocate the required
+	// amount of memory, and start from a copy of the previous dump.
+	if (!dc_buffer_clear (buffer) || !dc_buffer_extend (buffer, layout->memsize)) {
+		ERROR (abstract->context, "Insufficient buffer space available.");
+		return DC_STATUS_NOMEMORY;
+	}
+
+	unsigned char *data = dc_buffer_get_data (buffer);
+	memcpy (data, old, layout->memsize);
+
+	// Emit a vendor event.
+	dc_event_vendor_t vendor;
+	vendor.data = device->version;
+	vendor.size = sizeof (device->version);
+	device_event_emit (abstract, DC_EVENT_VENDOR, &vendor);
+
+	// Enable progress notifications. The maximum is a worst case
+	// estimate, and corrected once the profile window is known.
+	dc_event_progress_t progress = EVENT_PROGRESS_INITIALIZER;
+	progress.maximum = layout->memsize;
+	device_event_emit (abstract, DC_EVENT_PROGRESS, &progress);
+
+	// Re-read everything outside the profile ringbuffer. This covers
+	// the configuration pages, the pointer data and the (small)
+	// logbook ringbuffer, where changes cannot be detected reliably.
+	rc = oceanic_common_read_region (abstract, &progress, data, 0, layout->rb_profile_begin);
+	if (rc != DC_STATUS_SUCCESS)
+		return rc;
+	rc = oceanic_common_read_region (abstract, &progress, data, layout->rb_profile_end, layout->memsize);
+	if (rc != DC_STATUS_SUCCESS)
+		return rc;
+
+	// Get the new profile end pointer.
+	unsigned int rb_profile_new = 0;
+	if (oceanic_common_get_profile_end (data, layout, &rb_profile_new) != DC_STATUS_SUCCESS) {
+		WARNING (abstract->context, "Invalid profile pointers, falling back to a full download.");
+		return oceanic_common_device_dump (abstract, buffer);
+	}
+
+	// Calculate the newly written profile window.
+	unsigned int window = RB_PROFILE_DISTANCE (rb_profile_old, rb_profile_new, layout);
+
+	// Correct the progress maximum, now that the amount of changed
+	// profile data is known.
+	unsigned int rb_profile_size = layout->rb_profile_end - layout->rb_profile_begin;
+	progress.maximum -= rb_profile_size - window - (window ? PAGESIZE : 0);
+	device_event_emit (abstract, DC_EVENT_PROGRESS, &progress);
+
+	if (window == 0)
+		return DC_STATUS_SUCCESS;
+
+	// Verify that the last page of the previously downloaded profile
+	// data is still intact. If the ringbuffer has wrapped around
+	// completely since the previous dump, this page has been
+	// overwritten, and the delta window is no longer reliable.
+	unsigned int guard = ringbuffer_decrement (rb_profile_old, PAGESIZE, layout->rb_profile_begin, layout->rb_profile_end);
+	unsigned char page[PAGESIZE] = {0};
+	rc = dc_device_read (abstract, guard, page, sizeof (page));
+	if (rc != DC_STATUS_SUCCESS) {
+		ERROR (abstract->context, "Failed to read the memory page.");
+		return rc;
+	}
+	progress.current += PAGESIZE;
+	device_event_emit (abstract, DC_EVENT_PROGRESS, &progress);
+
+	if (memcmp (page, old + guard, PAGESIZE) != 0) {
+		WARNING (abstract->context, "Profile ringbuffer wrapped around, falling back to a full download.");
+		return oceanic_common_device_dump (abstract, buffer);
+	}
+
+	// Read the newly written profile data, taking care of the
+	// ringbuffer wrap point.
+	if (rb_profile_old + window > layout->rb_profile_end) {
+		rc = oceanic_common_read_region (abstract, &progress, data, rb_profile_old, layout->rb_profile_end);
+		if (rc != DC_STATUS_SUCCESS)
+			return rc;
+		rc = oceanic_common_read_region (abstract, &progress, data, layout->rb_profile_begin, rb_profile_new);
+	} else {
+		rc = oceanic_common_read_region (abstract, &progress, data, rb_profile_old, rb_profile_old + window);
+	}
+
+	return rc;
+}
+
+
 dc_status_t
 oceanic_common_device_logbook (dc_device_t *abstract, dc_event_progress_t *progress, dc_buffer_t *logbook)
 {
@@ -341,6 +527,7 @@ oceanic_common_device_profile (dc_device_t *abstract, dc_event_progress_t *progr
 	// of the memory buffer.
 	unsigned int remaining = layout->rb_profile_end - layout->rb_profile_begin;
 	unsigned int previous = rb_profile_end;
+	unsigned int ndives = 0;
 	unsigned int entry = rb_logbook_size;
 	while (entry) {
 		// Move to the start of the current entry.
@@ -387,6 +574,17 @@ oceanic_common_device_profile (dc_device_t *abstract, dc_event_progress_t *progr
 
 		remaining -= rb_entry_size + gap;
 		previous = rb_entry_first;
+
+		// Emit an early dive summary event. The logbook entry already
+		// contains the dive date, while the profile download has not
+		// started yet. The entry doubles as the fingerprint.
+		dc_event_divesummary_t summary;
+		summary.number = ++ndives;
+		summary.data = logbooks + entry;
+		summary.size = layout->rb_logbook_entry_size;
+		summary.fingerprint = logbooks + entry;
+		summary.fsize = layout->rb_logbook_entry_size;
+		device_event_emit (abstract, DC_EVENT_DIVESUMMARY, &summary);
 	}
 
 	// At this point, we know the exact amount of data
@@ -396,7 +594,9 @@ oceanic_common_device_profile (dc_device_t *abstract, dc_event_progress_t *progr
 
 	// Create the ringbuffer stream.
 	dc_rbstream_t *rbstream = NULL;
-	rc = dc_rbstream_new (&rbstream, abstract, PAGESIZE, PAGESIZE * device->multipage, layout->rb_profile_begin, layout->rb_profile_end, rb_profile_end);
+	// The exact amount of profile data is known at this point, so the
+	// stream can safely request several packets ahead.
+	rc = dc_rbstream_new2 (&rbstream, abstract, PAGESIZE, PAGESIZE * device->multipage, 4, layout->rb_profile_begin, layout->rb_profile_end, rb_profile_end);
 	if (rc != DC_STATUS_SUCCESS) {
 		ERROR (abstract->context, "Failed to create the ringbuffer stream.");
 		return rc;
@@ -489,6 +689,112 @@ oceanic_common_device_profile (dc_device_t *abstract, dc_event_progress_t *progr
 }
 
 
+dc_status_t
+oceanic_common_device_enumerate (dc_device_t *abstract, dc_dive_summary_callback_t callback, void *userdata)
+{
+	oceanic_common_device_t *device = (oceanic_common_device_t *) abstract;
+
+	assert (device != NULL);
+	assert (device->layout != NULL);
+
+	const oceanic_common_layout_t *layout = device->layout;
+
+	// Enable progress notifications. Only the pointer page and the
+	// logbook ringbuffer are transferred; the profiles are not.
+	dc_event_progress_t progress = EVENT_PROGRESS_INITIALIZER;
+	progress.maximum = PAGESIZE +
+		(layout->rb_logbook_end - layout->rb_logbook_begin);
+	device_event_emit (abstract, DC_EVENT_PROGRESS, &progress);
+
+	// Memory buffer for the logbook data.
+	dc_buffer_t *logbook = dc_context_buffer_acquire (abstract->context, 0);
+	if (logbook == NULL) {
+		return DC_STATUS_NOMEMORY;
+	}
+
+	// Download the logbook ringbuffer. With a fingerprint installed,
+	// the download already stops at the newest known entry.
+	dc_status_t rc = VTABLE(abstract)->logbook (abstract, &progress, logbook);
+	if (rc != DC_STATUS_SUCCESS) {
+		dc_context_buffer_release (abstract->context, logbook);
+		return rc;
+	}
+
+	// Cache the logbook pointer and size.
+	const unsigned char *logbooks = dc_buffer_get_data (logbook);
+	unsigned int rb_logbook_size = dc_buffer_get_size (logbook);
+
+	// Traverse the logbook ringbuffer backwards to deliver the most
+	// recent dives first. The profile pointers in each entry give the
+	// size of the dive, without downloading the profile ringbuffer.
+	unsigned int remaining = layout->rb_profile_end - layout->rb_profile_begin;
+	unsigned int previous = INVALID;
+	unsigned int ndives = 0;
+	unsigned int entry = rb_logbook_size;
+	while (entry) {
+		// Move to the start of the current entry.
+		entry -= layout->rb_logbook_entry_size;
+
+		// Get the profile pointers.
+		unsigned int rb_entry_first = get_profile_first (logbooks + entry, layout);
+		unsigned int rb_entry_last  = get_profile_last (logbooks + entry, layout);
+		if (rb_entry_first < layout->rb_profile_begin ||
+			rb_entry_first >= layout->rb_profile_end ||
+			rb_entry_last < layout->rb_profile_begin ||
+			rb_entry_last >= layout->rb_profile_end)
+		{
+			ERROR (abstract->context, "Invalid ringbuffer pointer detected (0x%06x 0x%06x).",
+				rb_entry_first, rb_entry_last);
+			break;
+		}
+
+		// Calculate the end pointer and the number of bytes.
+		unsigned int rb_entry_end   = RB_PROFILE_INCR (rb_entry_last, PAGESIZE, layout);
+		unsigned int rb_entry_size  = RB_PROFILE_DISTANCE (rb_entry_first, rb_entry_last, layout) + PAGESIZE;
+
+		// Take the end pointer of the most recent logbook entry as the
+		// end of profile pointer.
+		if (previous == INVALID) {
+			previous = rb_entry_end;
+		}
+
+		// Skip gaps between the profiles.
+		unsigned int gap = 0;
+		if (rb_entry_end != previous) {
+			WARNING (abstract->context, "Profiles are not continuous.");
+			gap = RB_PROFILE_DISTANCE (rb_entry_end, previous, layout);
+		}
+
+		// Make sure the profile size is valid.
+		if (rb_entry_size + gap > remaining) {
+			WARNING (abstract->context, "Unexpected profile size.");
+			break;
+		}
+
+		remaining -= rb_entry_size + gap;
+		previous = rb_entry_first;
+
+		// Deliver the dive identity. The logbook entry doubles as the
+		// fingerprint, and the dive data of a download consists of the
+		// entry followed by the profile.
+		dc_dive_summary_t summary;
+		summary.number = ++ndives;
+		summary.fingerprint = logbooks + entry;
+		summary.fsize = layout->rb_logbook_entry_size;
+		summary.data = logbooks + entry;
+		summary.size = layout->rb_logbook_entry_size;
+		summary.datasize = rb_entry_size + layout->rb_logbook_entry_size;
+		if (callback && !callback (&summary, userdata)) {
+			break;
+		}
+	}
+
+	dc_context_buffer_release (abstract->context, logbook);
+
+	return DC_STATUS_SUCCESS;
+}
+
+
 dc_status_t
 oceanic_common_device_foreach (dc_device_t *abstract, dc_dive_callback_t callback, void *userdata)
 {
@@ -539,33 +845,80 @@ oceanic_common_device_foreach (dc_device_t *abstract, dc_dive_callback_t callbac
 			(id[13] & 0x0F) * 10     + ((id[13] & 0xF0) >> 4) * 1;
 	device_event_emit (abstract, DC_EVENT_DEVINFO, &devinfo);
 
-	// Memory buffer for the logbook data.
-	dc_buffer_t *logbook = dc_buffer_new (0);
+	// Enable a small read cache for the duration of the enumeration, so
+	// the pages that are fetched by both the logbook and the profile
+	// pass, or by the overlapping extents of adjacent dives, are served
+	// from memory. A cache configured by the application is left
+	// untouched, and a failure to enable one only costs the
+	// deduplication.
+	int cached = 0;
+	if (abstract->cache_npages == 0) {
+		cached = dc_device_set_read_cache (abstract, PAGESIZE, CACHESIZE) == DC_STATUS_SUCCESS;
+	}
+
+	// Memory buffer for the logbook data, reused across downloads.
+	dc_buffer_t *logbook = dc_context_buffer_acquire (abstract->context, 0);
 	if (logbook == NULL) {
-		return DC_STATUS_NOMEMORY;
+		rc = DC_STATUS_NOMEMORY;
+		goto out;
 	}
 
 	// Download the logbook ringbuffer.
+	device_progress_phase (abstract, 1, 2);
 	rc = VTABLE(abstract)->logbook (abstract, &progress, logbook);
 	if (rc != DC_STATUS_SUCCESS) {
-		dc_buffer_free (logbook);
-		return rc;
+		goto out_release;
 	}
 
 	// Exit if there are no (new) dives.
 	if (dc_buffer_get_size (logbook) == 0) {
-		dc_buffer_free (logbook);
-		return DC_STATUS_SUCCESS;
+		rc = DC_STATUS_SUCCESS;
+		goto out_release;
 	}
 
-	// Download the profile ringbuffer.
+	// Download the profile ringbuffer. The profiles transfer at a
+	// different effective rate than the page sized logbook reads, so
+	// the transfer estimate restarts here.
+	device_progress_phase (abstract, 2, 2);
 	rc = VTABLE(abstract)->profile (abstract, &progress, logbook, callback, userdata);
-	if (rc != DC_STATUS_SUCCESS) {
-		dc_buffer_free (logbook);
-		return rc;
-	}
 
-	dc_buffer_free (logbook);
+out_release:
+	dc_context_buffer_release (abstract->context, logbook);
+out:
+	// Disable the cache again, so a later read returns fresh data.
+	if (cached)
+		dc_device_set_read_cache (abstract, 0, 0);
 
-	return DC_STATUS_SUCCESS;
+	return rc;
+}
+
+
+void
+oceanic_common_layout_json (FILE *stream, const char *name, const oceanic_common_layout_t *layout)
+{
+	fprintf (stream,
+		"{\"name\": \"%s\", "
+		"\"memsize\": %u, "
+		"\"cf_devinfo\": %u, "
+		"\"cf_pointers\": %u, "
+		"\"rb_logbook_begin\": %u, "
+		"\"rb_logbook_end\": %u, "
+		"\"rb_logbook_entry_size\": %u, "
+		"\"rb_profile_begin\": %u, "
+		"\"rb_profile_end\": %u, "
+		"\"pt_mode_global\": %u, "
+		"\"pt_mode_logbook\": %u, "
+		"\"pt_mode_serial\": %u}",
+		name,
+		layout->memsize,
+		layout->cf_devinfo,
+		layout->cf_pointers,
+		layout->rb_logbook_begin,
+		layout->rb_logbook_end,
+		layout->rb_logbook_entry_size,
+		layout->rb_profile_begin,
+		layout->rb_profile_end,
+		layout->pt_mode_global,
+		layout->pt_mode_logbook,
+		layout->pt_mode_serial);
 }
@@ -22,6 +22,8 @@
 #ifndef OCEANIC_COMMON_H
 #define OCEANIC_COMMON_H
 
+#include <stdio.h>
+
 #include "device-private.h"
 
 #ifdef __cplusplus
@@ -92,9 +94,43 @@ oceanic_common_device_set_fingerprint (dc_device_t *device, const unsigned char
 dc_status_t
 oceanic_common_device_dump (dc_device_t *abstract, dc_buffer_t *buffer);
 
+dc_status_t
+oceanic_common_device_dump_delta (dc_device_t *abstract, dc_buffer_t *buffer, dc_buffer_t *previous);
+
 dc_status_t
 oceanic_common_device_foreach (dc_device_t *device, dc_dive_callback_t callback, void *userdata);
 
+dc_status_t
+oceanic_common_device_enumerate (dc_device_t *device, dc_dive_summary_callback_t callback, void *userdata);
+
+/*
+ * Emit the layout tables as JSON, for the layouts2json tool. Each
+ * function writes a comma separated sequence of JSON objects (without
+ * the surrounding array brackets). The emitters live next to the tables
+ * they describe, so the generated output cannot drift from the shipping
+ * decode tables.
+ */
+void
+oceanic_common_layout_json (FILE *stream, const char *name, const oceanic_common_layout_t *layout);
+
+void
+oceanic_atom2_device_layouts_json (FILE *stream);
+
+void
+oceanic_veo250_device_layouts_json (FILE *stream);
+
+void
+oceanic_vtpro_device_layouts_json (FILE *stream);
+
+void
+oceanic_atom2_parser_layouts_json (FILE *stream);
+
+void
+oceanic_veo250_parser_layouts_json (FILE *stream);
+
+void
+oceanic_vtpro_parser_layouts_json (FILE *stream);
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
@@ -57,7 +57,13 @@ static const oceanic_common_device_vtable_t oceanic_veo250_device_vtable = {
 		NULL, /* write */
 		oceanic_common_device_dump, /* dump */
 		oceanic_common_device_foreach, /* foreach */
-		oceanic_veo250_device_close /* close */
+		oceanic_veo250_device_close, /* close */
+		NULL, /* foreach_buffer */
+		oceanic_common_device_dump_delta, /* dump_delta */
+		NULL, /* read_multiple */
+		NULL, /* dump_stream */
+		oceanic_common_device_enumerate, /* enumerate */
+		oceanic_veo250_device_keepalive, /* keepalive */
 	},
 	oceanic_common_device_logbook,
 	oceanic_common_device_profile,
@@ -145,7 +151,7 @@ oceanic_veo250_transfer (oceanic_veo250_device_t *device, const unsigned char co
 			return rc;
 
 		// Abort if the maximum number of retries is reached.
-		if (nretries++ >= MAXRETRIES)
+		if (nretries++ >= device_retry_limit ((dc_device_t *) device, MAXRETRIES))
 			return rc;
 
 		// Delay the next attempt.
@@ -258,6 +264,9 @@ oceanic_veo250_device_open (dc_device_t **out, dc_context_t *context, const char
 		goto error_free;
 	}
 
+	// Forward cancellation requests to the serial layer.
+	dc_serial_set_cancel (device->port, device_cancel_cb, device);
+
 	// Set the serial communication protocol (9600 8N1).
 	status = dc_serial_configure (device->port, 9600, 8, DC_PARITY_NONE, DC_STOPBITS_ONE, DC_FLOWCONTROL_NONE);
 	if (status != DC_STATUS_SUCCESS) {
@@ -460,3 +469,10 @@ oceanic_veo250_device_read (dc_device_t *abstract, unsigned int address, unsigne
 
 	return DC_STATUS_SUCCESS;
 }
+
+
+void
+oceanic_veo250_device_layouts_json (FILE *stream)
+{
+	oceanic_common_layout_json (stream, "oceanic_veo250", &oceanic_veo250_layout);
+}
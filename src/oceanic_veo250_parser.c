@@ -36,11 +36,26 @@
 #define VEO250   0x424C
 #define REACTPROWHITE 0x4354
 
+/*
+ * Per-model data layout, resolved once at parser creation (similar to
+ * the oceanic_common_layout_t used on the device side), so the sample
+ * loop no longer re-decides the format from the model number.
+ */
+typedef struct oceanic_veo250_layout_t {
+	// Bias added to the decoded year.
+	unsigned int year;
+	// The sample interval bits are rotated by one position.
+	unsigned int interval_rotate;
+	// Offset of the temperature in the samples.
+	unsigned int temperature;
+} oceanic_veo250_layout_t;
+
 typedef struct oceanic_veo250_parser_t oceanic_veo250_parser_t;
 
 struct oceanic_veo250_parser_t {
 	dc_parser_t base;
 	unsigned int model;
+	oceanic_veo250_layout_t layout;
 	// Cached fields.
 	unsigned int cached;
 	unsigned int divetime;
@@ -51,18 +66,41 @@ static dc_status_t oceanic_veo250_parser_set_data (dc_parser_t *abstract, const
 static dc_status_t oceanic_veo250_parser_get_datetime (dc_parser_t *abstract, dc_datetime_t *datetime);
 static dc_status_t oceanic_veo250_parser_get_field (dc_parser_t *abstract, dc_field_type_t type, unsigned int flags, void *value);
 static dc_status_t oceanic_veo250_parser_samples_foreach (dc_parser_t *abstract, dc_sample_callback_t callback, void *userdata);
+static dc_status_t oceanic_veo250_parser_vendor_decode (dc_parser_t *abstract, unsigned int type, const unsigned char data[], unsigned int size, dc_sample_callback_t callback, void *userdata);
 
-static const dc_parser_vtable_t oceanic_veo250_parser_vtable = {
+DC_VTABLE_STORAGE const dc_parser_vtable_t oceanic_veo250_parser_vtable = {
 	sizeof(oceanic_veo250_parser_t),
 	DC_FAMILY_OCEANIC_VEO250,
 	oceanic_veo250_parser_set_data, /* set_data */
 	oceanic_veo250_parser_get_datetime, /* datetime */
 	oceanic_veo250_parser_get_field, /* fields */
 	oceanic_veo250_parser_samples_foreach, /* samples_foreach */
-	NULL /* destroy */
+	NULL, /* destroy */
+	NULL, /* samples_batch */
+	oceanic_veo250_parser_vendor_decode, /* vendor_decode */
 };
 
 
+static void
+oceanic_veo250_layout_init (oceanic_veo250_layout_t *layout, unsigned int model)
+{
+	if (model == VEO200 || model == VEO250) {
+		layout->year = 3;
+	} else if (model == REACTPRO) {
+		layout->year = 2;
+	} else {
+		layout->year = 0;
+	}
+	if (model == REACTPRO || model == REACTPROWHITE) {
+		layout->interval_rotate = 1;
+		layout->temperature = 6;
+	} else {
+		layout->interval_rotate = 0;
+		layout->temperature = 7;
+	}
+}
+
+
 dc_status_t
 oceanic_veo250_parser_create (dc_parser_t **out, dc_context_t *context, unsigned int model)
 {
@@ -80,6 +118,7 @@ oceanic_veo250_parser_create (dc_parser_t **out, dc_context_t *context, unsigned
 
 	// Set the default values.
 	parser->model = model;
+	oceanic_veo250_layout_init (&parser->layout, model);
 	parser->cached = 0;
 	parser->divetime = 0;
 	parser->maxdepth = 0.0;
@@ -122,10 +161,7 @@ oceanic_veo250_parser_get_datetime (dc_parser_t *abstract, dc_datetime_t *dateti
 		datetime->minute = p[2];
 		datetime->second = 0;
 
-		if (parser->model == VEO200 || parser->model == VEO250)
-			datetime->year += 3;
-		else if (parser->model == REACTPRO)
-			datetime->year += 2;
+		datetime->year += parser->layout.year;
 	}
 
 	return DC_STATUS_SUCCESS;
@@ -200,7 +236,7 @@ oceanic_veo250_parser_samples_foreach (dc_parser_t *abstract, dc_sample_callback
 	unsigned int time = 0;
 	unsigned int interval = 0;
 	unsigned int interval_idx = data[0x27] & 0x03;
-	if (parser->model == REACTPRO || parser->model == REACTPROWHITE) {
+	if (parser->layout.interval_rotate) {
 		interval_idx += 1;
 		interval_idx %= 4;
 	}
@@ -246,13 +282,8 @@ oceanic_veo250_parser_samples_foreach (dc_parser_t *abstract, dc_sample_callback
 		if (callback) callback (DC_SAMPLE_DEPTH, sample, userdata);
 
 		// Temperature (°F)
-		unsigned int temperature;
-		if (parser->model == REACTPRO || parser->model == REACTPROWHITE) {
-			temperature = data[offset + 6];
-		} else {
-			temperature = data[offset + 7];
-		}
-		sample.temperature = (temperature - 32.0) * (5.0 / 9.0);
+		unsigned int temperature = data[offset + parser->layout.temperature];
+		sample.temperature = FAHRENHEIT_TO_CELSIUS (temperature);
 		if (callback) callback (DC_SAMPLE_TEMPERATURE, sample, userdata);
 
 		offset += PAGESIZE / 2;
@@ -260,3 +291,58 @@ oceanic_veo250_parser_samples_foreach (dc_parser_t *abstract, dc_sample_callback
 
 	return DC_STATUS_SUCCESS;
 }
+
+
+static dc_status_t
+oceanic_veo250_parser_vendor_decode (dc_parser_t *abstract, unsigned int type, const unsigned char data[], unsigned int size, dc_sample_callback_t callback, void *userdata)
+{
+	oceanic_veo250_parser_t *parser = (oceanic_veo250_parser_t *) abstract;
+
+	if (type != SAMPLE_VENDOR_OCEANIC_VEO250)
+		return DC_STATUS_UNSUPPORTED;
+
+	if (size != PAGESIZE / 2)
+		return DC_STATUS_DATAFORMAT;
+
+	dc_sample_value_t sample = {0};
+
+	// Depth (ft)
+	unsigned int depth = data[2];
+	sample.depth = depth * FEET;
+	if (callback) callback (DC_SAMPLE_DEPTH, sample, userdata);
+
+	// Temperature (°F)
+	unsigned int temperature = data[parser->layout.temperature];
+	sample.temperature = FAHRENHEIT_TO_CELSIUS (temperature);
+	if (callback) callback (DC_SAMPLE_TEMPERATURE, sample, userdata);
+
+	return DC_STATUS_SUCCESS;
+}
+
+
+void
+oceanic_veo250_parser_layouts_json (FILE *stream)
+{
+	// The default (zero) model stands in for all models without a
+	// dedicated layout.
+	static const unsigned int models[] = {REACTPRO, VEO200, VEO250, REACTPROWHITE, 0};
+
+	for (unsigned int i = 0; i < sizeof (models) / sizeof *models; ++i) {
+		oceanic_veo250_layout_t layout = {0};
+		oceanic_veo250_layout_init (&layout, models[i]);
+
+		if (i)
+			fprintf (stream, ",\n");
+		if (models[i])
+			fprintf (stream, "{\"model\": %u, ", models[i]);
+		else
+			fprintf (stream, "{\"model\": null, ");
+		fprintf (stream,
+			"\"year\": %u, "
+			"\"interval_rotate\": %u, "
+			"\"temperature\": %u}",
+			layout.year,
+			layout.interval_rotate,
+			layout.temperature);
+	}
+}
@@ -33,11 +33,55 @@
 
 #define AERIS500AI 0x4151
 
+// Datetime and footer encoding variants.
+#define VTPRO_DEFAULT    0
+#define VTPRO_AERIS500AI 1
+
+/*
+ * Per-model data layout, resolved once at parser creation (similar to
+ * the layout descriptors in the veo250 and atom2 parsers), so the
+ * sample loop no longer re-decides the format from the model number.
+ */
+typedef struct oceanic_vtpro_layout_t {
+	// Datetime and footer encoding variant.
+	unsigned int variant;
+	// Sample interval table, indexed by the decoded samplerate bits.
+	const unsigned int *intervals;
+	unsigned int firstrate;
+	unsigned int nintervals;
+	unsigned int ratemask;
+	// Depth and temperature encoding in the samples: the byte offset,
+	// and whether the value is stored as the upper 8 bits of a 12 bit
+	// field instead of a plain byte.
+	unsigned int depth;
+	unsigned int depth_12bit;
+	unsigned int temperature;
+	unsigned int temperature_12bit;
+} oceanic_vtpro_layout_t;
+
+static const unsigned int oceanic_vtpro_intervals[] = {2, 15, 30, 60};
+static const unsigned int oceanic_aeris500ai_intervals[] = {2, 5, 10, 15, 20, 25, 30};
+
+static const oceanic_vtpro_layout_t oceanic_vtpro_layout = {
+	VTPRO_DEFAULT, /* variant */
+	oceanic_vtpro_intervals, 0, 4, 0x07, /* intervals */
+	3, 0, /* depth */
+	6, 0, /* temperature */
+};
+
+static const oceanic_vtpro_layout_t oceanic_aeris500ai_layout = {
+	VTPRO_AERIS500AI, /* variant */
+	oceanic_aeris500ai_intervals, 3, 7, 0x0F, /* intervals */
+	2, 1, /* depth */
+	6, 1, /* temperature */
+};
+
 typedef struct oceanic_vtpro_parser_t oceanic_vtpro_parser_t;
 
 struct oceanic_vtpro_parser_t {
 	dc_parser_t base;
 	unsigned int model;
+	const oceanic_vtpro_layout_t *layout;
 	// Cached fields.
 	unsigned int cached;
 	unsigned int divetime;
@@ -48,15 +92,18 @@ static dc_status_t oceanic_vtpro_parser_set_data (dc_parser_t *abstract, const u
 static dc_status_t oceanic_vtpro_parser_get_datetime (dc_parser_t *abstract, dc_datetime_t *datetime);
 static dc_status_t oceanic_vtpro_parser_get_field (dc_parser_t *abstract, dc_field_type_t type, unsigned int flags, void *value);
 static dc_status_t oceanic_vtpro_parser_samples_foreach (dc_parser_t *abstract, dc_sample_callback_t callback, void *userdata);
+static dc_status_t oceanic_vtpro_parser_vendor_decode (dc_parser_t *abstract, unsigned int type, const unsigned char data[], unsigned int size, dc_sample_callback_t callback, void *userdata);
 
-static const dc_parser_vtable_t oceanic_vtpro_parser_vtable = {
+DC_VTABLE_STORAGE const dc_parser_vtable_t oceanic_vtpro_parser_vtable = {
 	sizeof(oceanic_vtpro_parser_t),
 	DC_FAMILY_OCEANIC_VTPRO,
 	oceanic_vtpro_parser_set_data, /* set_data */
 	oceanic_vtpro_parser_get_datetime, /* datetime */
 	oceanic_vtpro_parser_get_field, /* fields */
 	oceanic_vtpro_parser_samples_foreach, /* samples_foreach */
-	NULL /* destroy */
+	NULL, /* destroy */
+	NULL, /* samples_batch */
+	oceanic_vtpro_parser_vendor_decode, /* vendor_decode */
 };
 
 
@@ -84,6 +131,11 @@ oceanic_vtpro_parser_create2 (dc_parser_t **out, dc_context_t *context, unsigned
 
 	// Set the default values.
 	parser->model = model;
+	if (model == AERIS500AI) {
+		parser->layout = &oceanic_aeris500ai_layout;
+	} else {
+		parser->layout = &oceanic_vtpro_layout;
+	}
 	parser->cached = 0;
 	parser->divetime = 0;
 	parser->maxdepth = 0.0;
@@ -122,7 +174,7 @@ oceanic_vtpro_parser_get_datetime (dc_parser_t *abstract, dc_datetime_t *datetim
 		// AM/PM bit of the 12-hour clock.
 		unsigned int pm = 0;
 
-		if (parser->model == AERIS500AI) {
+		if (parser->layout->variant == VTPRO_AERIS500AI) {
 			datetime->year   = (p[2] & 0x0F) + 1999;
 			datetime->month  = (p[3] & 0xF0) >> 4;
 			datetime->day    = ((p[2] & 0xF0) >> 4) | ((p[3] & 0x02) << 3);
@@ -182,7 +234,7 @@ oceanic_vtpro_parser_get_field (dc_parser_t *abstract, dc_field_type_t type, uns
 	unsigned int maxdepth = 0;
 	unsigned int beginpressure = array_uint16_le(data + 0x26) & 0x0FFF;
 	unsigned int endpressure = array_uint16_le(data + footer + 0x05) & 0x0FFF;
-	if (parser->model == AERIS500AI) {
+	if (parser->layout->variant == VTPRO_AERIS500AI) {
 		oxygen = (array_uint16_le(data + footer + 2) & 0x0FF0) >> 4;
 		maxdepth = data[footer + 1];
 	} else {
@@ -246,20 +298,14 @@ oceanic_vtpro_parser_samples_foreach (dc_parser_t *abstract, dc_sample_callback_
 	if (size < 7 * PAGESIZE / 2)
 		return DC_STATUS_DATAFORMAT;
 
+	const oceanic_vtpro_layout_t *layout = parser->layout;
+
 	unsigned int time = 0;
 	unsigned int interval = 0;
-	if (parser->model == AERIS500AI) {
-		const unsigned int intervals[] = {2, 5, 10, 15, 20, 25, 30};
-		unsigned int samplerate = (data[0x27] >> 4);
-		if (samplerate >= 3 && samplerate <= 9) {
-			interval = intervals[samplerate - 3];
-		}
-	} else {
-		const unsigned int intervals[] = {2, 15, 30, 60};
-		unsigned int samplerate = (data[0x27] >> 4) & 0x07;
-		if (samplerate <= 3) {
-			interval = intervals[samplerate];
-		}
+	unsigned int samplerate = (data[0x27] >> 4) & layout->ratemask;
+	if (samplerate >= layout->firstrate &&
+		samplerate < layout->firstrate + layout->nintervals) {
+		interval = layout->intervals[samplerate - layout->firstrate];
 	}
 
 	// Initialize the state for the timestamp processing.
@@ -347,22 +393,22 @@ oceanic_vtpro_parser_samples_foreach (dc_parser_t *abstract, dc_sample_callback_
 
 		// Depth (ft)
 		unsigned int depth = 0;
-		if (parser->model == AERIS500AI) {
-			depth = (array_uint16_le(data + offset + 2) & 0x0FF0) >> 4;
+		if (layout->depth_12bit) {
+			depth = (array_uint16_le(data + offset + layout->depth) & 0x0FF0) >> 4;
 		} else {
-			depth = data[offset + 3];
+			depth = data[offset + layout->depth];
 		}
 		sample.depth = depth * FEET;
 		if (callback) callback (DC_SAMPLE_DEPTH, sample, userdata);
 
 		// Temperature (°F)
 		unsigned int temperature = 0;
-		if (parser->model == AERIS500AI) {
-			temperature = (array_uint16_le(data + offset + 6) & 0x0FF0) >> 4;
+		if (layout->temperature_12bit) {
+			temperature = (array_uint16_le(data + offset + layout->temperature) & 0x0FF0) >> 4;
 		} else {
-			temperature = data[offset + 6];
+			temperature = data[offset + layout->temperature];
 		}
-		sample.temperature = (temperature - 32.0) * (5.0 / 9.0);
+		sample.temperature = FAHRENHEIT_TO_CELSIUS (temperature);
 		if (callback) callback (DC_SAMPLE_TEMPERATURE, sample, userdata);
 
 		offset += PAGESIZE / 2;
@@ -370,3 +416,81 @@ oceanic_vtpro_parser_samples_foreach (dc_parser_t *abstract, dc_sample_callback_
 
 	return DC_STATUS_SUCCESS;
 }
+
+
+static dc_status_t
+oceanic_vtpro_parser_vendor_decode (dc_parser_t *abstract, unsigned int type, const unsigned char data[], unsigned int size, dc_sample_callback_t callback, void *userdata)
+{
+	oceanic_vtpro_parser_t *parser = (oceanic_vtpro_parser_t *) abstract;
+
+	const oceanic_vtpro_layout_t *layout = parser->layout;
+
+	if (type != SAMPLE_VENDOR_OCEANIC_VTPRO)
+		return DC_STATUS_UNSUPPORTED;
+
+	if (size != PAGESIZE / 2)
+		return DC_STATUS_DATAFORMAT;
+
+	dc_sample_value_t sample = {0};
+
+	// Depth (ft)
+	unsigned int depth = 0;
+	if (layout->depth_12bit) {
+		depth = (array_uint16_le(data + layout->depth) & 0x0FF0) >> 4;
+	} else {
+		depth = data[layout->depth];
+	}
+	sample.depth = depth * FEET;
+	if (callback) callback (DC_SAMPLE_DEPTH, sample, userdata);
+
+	// Temperature (°F)
+	unsigned int temperature = 0;
+	if (layout->temperature_12bit) {
+		temperature = (array_uint16_le(data + layout->temperature) & 0x0FF0) >> 4;
+	} else {
+		temperature = data[layout->temperature];
+	}
+	sample.temperature = FAHRENHEIT_TO_CELSIUS (temperature);
+	if (callback) callback (DC_SAMPLE_TEMPERATURE, sample, userdata);
+
+	return DC_STATUS_SUCCESS;
+}
+
+
+static void
+oceanic_vtpro_layout_json (FILE *stream, const char *name, const oceanic_vtpro_layout_t *layout)
+{
+	fprintf (stream,
+		"{\"name\": \"%s\", "
+		"\"variant\": %u, "
+		"\"intervals\": [",
+		name,
+		layout->variant);
+	for (unsigned int i = 0; i < layout->nintervals; ++i) {
+		fprintf (stream, "%s%u", i ? ", " : "", layout->intervals[i]);
+	}
+	fprintf (stream,
+		"], "
+		"\"firstrate\": %u, "
+		"\"nintervals\": %u, "
+		"\"ratemask\": %u, "
+		"\"depth\": %u, "
+		"\"depth_12bit\": %u, "
+		"\"temperature\": %u, "
+		"\"temperature_12bit\": %u}",
+		layout->firstrate,
+		layout->nintervals,
+		layout->ratemask,
+		layout->depth,
+		layout->depth_12bit,
+		layout->temperature,
+		layout->temperature_12bit);
+}
+
+void
+oceanic_vtpro_parser_layouts_json (FILE *stream)
+{
+	oceanic_vtpro_layout_json (stream, "oceanic_vtpro", &oceanic_vtpro_layout);
+	fprintf (stream, ",\n");
+	oceanic_vtpro_layout_json (stream, "aeris_500ai", &oceanic_aeris500ai_layout);
+}
@@ -25,6 +25,8 @@
 #include <libdivecomputer/context.h>
 #include <libdivecomputer/parser.h>
 
+#include "common-private.h"
+
 #ifdef __cplusplus
 extern "C" {
 #endif /* __cplusplus */
@@ -34,11 +36,62 @@ struct dc_parser_vtable_t;
 
 typedef struct dc_parser_vtable_t dc_parser_vtable_t;
 
+// The maximum number of gas mixes and tanks in the field cache.
+#define MAXFIELDS 16
+
+typedef struct dc_field_cache_t {
+	unsigned int divetime;
+	double maxdepth;
+	double avgdepth;
+	unsigned int gasmix_count;
+	unsigned int tank_count;
+	dc_gasmix_t gasmix[MAXFIELDS];
+	dc_tank_t tank[MAXFIELDS];
+	dc_salinity_t salinity;
+	double atmospheric;
+	double temperature_surface;
+	double temperature_minimum;
+	double temperature_maximum;
+	dc_divemode_t divemode;
+} dc_field_cache_t;
+
+typedef struct dc_parser_chunk_t dc_parser_chunk_t;
+
 struct dc_parser_t {
 	const dc_parser_vtable_t *vtable;
 	dc_context_t *context;
 	const unsigned char *data;
 	unsigned int size;
+	/*
+	 * Arena for the per-dive allocations, see dc_parser_arena_alloc.
+	 */
+	dc_parser_chunk_t *arena;
+	/*
+	 * Cache for the field queries. Repeated queries are served from
+	 * the cache without entering the backend. The bitmaps contain one
+	 * bit per field type, and one bit per gas mix or tank index.
+	 */
+	unsigned int cached;
+	unsigned int cached_gasmix;
+	unsigned int cached_tank;
+	dc_field_cache_t cache;
+	/*
+	 * Sample type filter, see dc_parser_set_sample_mask. The mask
+	 * holds the configured value. The filter holds the active mask for
+	 * the duration of a dc_parser_samples_foreach call, for backends
+	 * that can skip the decoding of the unselected types; the internal
+	 * full decode paths (field statistics, presence scans) leave it at
+	 * zero.
+	 */
+	unsigned int sample_mask;
+	unsigned int sample_filter;
+	/*
+	 * Error recovery mode, see dc_parser_set_recovery. Backends with a
+	 * fixed sample record size check the flag at their data validation
+	 * points: when set, they skip to the next record boundary and emit
+	 * a SAMPLE_EVENT_GAP event instead of aborting the iteration.
+	 */
+	unsigned int recovery;
 };
 
 struct dc_parser_vtable_t {
@@ -55,14 +108,58 @@ struct dc_parser_vtable_t {
 	dc_status_t (*samples_foreach) (dc_parser_t *parser, dc_sample_callback_t callback, void *userdata);
 
 	dc_status_t (*destroy) (dc_parser_t *parser);
+
+	/* Optional. Backends that can decode straight into a contiguous
+	 * array can implement this entry. If absent, the batch interface
+	 * falls back to the samples_foreach entry. The entry is located
+	 * after the mandatory ones, to remain compatible with backends
+	 * using a positional initializer. */
+	dc_status_t (*samples_batch) (dc_parser_t *parser, dc_sample_t *samples, unsigned int size, unsigned int *actual);
+
+	/* Optional. Backends whose DC_SAMPLE_VENDOR blobs contain fields
+	 * that can be decoded without the surrounding profile state can
+	 * implement this entry, to decode a single stored blob back into
+	 * typed samples. If absent, the decoding is unsupported. */
+	dc_status_t (*vendor_decode) (dc_parser_t *parser, unsigned int type, const unsigned char data[], unsigned int size, dc_sample_callback_t callback, void *userdata);
 };
 
+/*
+ * Dispatch through the parser vtable. See the DC_VTABLE_STORAGE
+ * comment in common-private.h for the static dispatch build.
+ */
+#ifdef DC_STATIC_DISPATCH_PARSER
+extern const dc_parser_vtable_t DC_STATIC_DISPATCH_PARSER;
+#define DC_PARSER_VTABLE(parser) (&DC_STATIC_DISPATCH_PARSER)
+#else
+#define DC_PARSER_VTABLE(parser) ((parser)->vtable)
+#endif
+
 dc_parser_t *
 dc_parser_allocate (dc_context_t *context, const dc_parser_vtable_t *vtable);
 
+/*
+ * Store a field value in the cache. Backends that derive several
+ * fields from a single pass over the profile can store the siblings
+ * of the requested field, so the subsequent queries don't enter the
+ * backend again. The cache is invalidated when new data is set.
+ */
+void
+dc_parser_cache_store (dc_parser_t *parser, dc_field_type_t type, unsigned int flags, const void *value);
+
 void
 dc_parser_deallocate (dc_parser_t *parser);
 
+/*
+ * Allocate memory that lives as long as the current dive data. The
+ * memory is released all at once when new data is installed with
+ * dc_parser_set_data (or dc_parser_reset), and when the parser is
+ * destroyed. Backends must not free it individually. Intended for the
+ * small per-dive allocations (strings, lookup entries) that would
+ * otherwise require matching free calls on every path.
+ */
+void *
+dc_parser_arena_alloc (dc_parser_t *parser, size_t size);
+
 int
 dc_parser_isinstance (dc_parser_t *parser, const dc_parser_vtable_t *vtable);
 
@@ -20,6 +20,7 @@
  */
 
 #include <stdlib.h>
+#include <string.h>
 #include <assert.h>
 
 #include <libdivecomputer/suunto.h>
@@ -37,9 +38,13 @@
 #include <libdivecomputer/divesystem.h>
 #include <libdivecomputer/cochran.h>
 
+#include "common-private.h"
 #include "context-private.h"
 #include "parser-private.h"
 #include "device-private.h"
+#include "threads.h"
+
+#define C_ARRAY_SIZE(array) (sizeof (array) / sizeof *(array))
 
 #define REACTPROWHITE 0x4354
 
@@ -53,6 +58,7 @@ dc_parser_new_internal (dc_parser_t **out, dc_context_t *context, dc_family_t fa
 		return DC_STATUS_INVALIDARGS;
 
 	switch (family) {
+#ifdef ENABLE_SUUNTO
 	case DC_FAMILY_SUUNTO_SOLUTION:
 		rc = suunto_solution_parser_create (&parser, context);
 		break;
@@ -72,6 +78,8 @@ dc_parser_new_internal (dc_parser_t **out, dc_context_t *context, dc_family_t fa
 	case DC_FAMILY_SUUNTO_EONSTEEL:
 		rc = suunto_eonsteel_parser_create(&parser, context, model);
 		break;
+#endif
+#ifdef ENABLE_UWATEC
 	case DC_FAMILY_UWATEC_ALADIN:
 	case DC_FAMILY_UWATEC_MEMOMOUSE:
 		rc = uwatec_memomouse_parser_create (&parser, context, devtime, systime);
@@ -80,6 +88,8 @@ dc_parser_new_internal (dc_parser_t **out, dc_context_t *context, dc_family_t fa
 	case DC_FAMILY_UWATEC_MERIDIAN:
 		rc = uwatec_smart_parser_create (&parser, context, model, devtime, systime);
 		break;
+#endif
+#ifdef ENABLE_REEFNET
 	case DC_FAMILY_REEFNET_SENSUS:
 		rc = reefnet_sensus_parser_create (&parser, context, devtime, systime);
 		break;
@@ -89,6 +99,8 @@ dc_parser_new_internal (dc_parser_t **out, dc_context_t *context, dc_family_t fa
 	case DC_FAMILY_REEFNET_SENSUSULTRA:
 		rc = reefnet_sensusultra_parser_create (&parser, context, devtime, systime);
 		break;
+#endif
+#ifdef ENABLE_OCEANIC
 	case DC_FAMILY_OCEANIC_VTPRO:
 		rc = oceanic_vtpro_parser_create2 (&parser, context, model);
 		break;
@@ -101,6 +113,8 @@ dc_parser_new_internal (dc_parser_t **out, dc_context_t *context, dc_family_t fa
 		else
 			rc = oceanic_atom2_parser_create (&parser, context, model);
 		break;
+#endif
+#ifdef ENABLE_MARES
 	case DC_FAMILY_MARES_NEMO:
 	case DC_FAMILY_MARES_PUCK:
 		rc = mares_nemo_parser_create (&parser, context, model);
@@ -111,6 +125,8 @@ dc_parser_new_internal (dc_parser_t **out, dc_context_t *context, dc_family_t fa
 	case DC_FAMILY_MARES_ICONHD:
 		rc = mares_iconhd_parser_create (&parser, context, model);
 		break;
+#endif
+#ifdef ENABLE_HW
 	case DC_FAMILY_HW_OSTC:
 		rc = hw_ostc_parser_create (&parser, context, 0);
 		break;
@@ -118,34 +134,51 @@ dc_parser_new_internal (dc_parser_t **out, dc_context_t *context, dc_family_t fa
 	case DC_FAMILY_HW_OSTC3:
 		rc = hw_ostc3_parser_create (&parser, context, model);
 		break;
+#endif
+#ifdef ENABLE_CRESSI
 	case DC_FAMILY_CRESSI_EDY:
+#ifdef ENABLE_ZEAGLE
 	case DC_FAMILY_ZEAGLE_N2ITION3:
+#endif
 		rc = cressi_edy_parser_create (&parser, context, model);
 		break;
 	case DC_FAMILY_CRESSI_LEONARDO:
 		rc = cressi_leonardo_parser_create2 (&parser, context, model);
 		break;
+#endif
+#ifdef ENABLE_ATOMICS
 	case DC_FAMILY_ATOMICS_COBALT:
 		rc = atomics_cobalt_parser_create (&parser, context);
 		break;
+#endif
+#ifdef ENABLE_SHEARWATER
 	case DC_FAMILY_SHEARWATER_PREDATOR:
 		rc = shearwater_predator_parser_create (&parser, context);
 		break;
 	case DC_FAMILY_SHEARWATER_PETREL:
 		rc = shearwater_petrel_parser_create (&parser, context);
 		break;
+#endif
+#ifdef ENABLE_DIVERITE
 	case DC_FAMILY_DIVERITE_NITEKQ:
 		rc = diverite_nitekq_parser_create (&parser, context);
 		break;
+#endif
+#ifdef ENABLE_CITIZEN
 	case DC_FAMILY_CITIZEN_AQUALAND:
 		rc = citizen_aqualand_parser_create (&parser, context);
 		break;
+#endif
+#ifdef ENABLE_DIVESYSTEM
 	case DC_FAMILY_DIVESYSTEM_IDIVE:
 		rc = divesystem_idive_parser_create2 (&parser, context, model);
 		break;
+#endif
+#ifdef ENABLE_COCHRAN
 	case DC_FAMILY_COCHRAN_COMMANDER:
 		rc = cochran_commander_parser_create (&parser, context, model);
 		break;
+#endif
 	default:
 		return DC_STATUS_INVALIDARGS;
 	}
@@ -174,6 +207,80 @@ dc_parser_new2 (dc_parser_t **out, dc_context_t *context, dc_descriptor_t *descr
 		devtime, systime);
 }
 
+// The default capacity of an arena chunk.
+#define CHUNKSIZE 4096
+
+struct dc_parser_chunk_t {
+	dc_parser_chunk_t *next;
+	size_t capacity;
+	size_t offset;
+	unsigned char data[];
+};
+
+void *
+dc_parser_arena_alloc (dc_parser_t *parser, size_t size)
+{
+	if (parser == NULL || size == 0)
+		return NULL;
+
+	// Keep every allocation suitably aligned.
+	size = (size + 7) & ~(size_t) 7;
+
+	dc_parser_chunk_t *chunk = parser->arena;
+	if (chunk == NULL || chunk->capacity - chunk->offset < size) {
+		size_t capacity = CHUNKSIZE;
+		if (capacity < size)
+			capacity = size;
+
+		chunk = (dc_parser_chunk_t *) dc_context_malloc (parser->context, sizeof (dc_parser_chunk_t) + capacity);
+		if (chunk == NULL) {
+			ERROR (parser->context, "Failed to allocate memory.");
+			return NULL;
+		}
+
+		chunk->capacity = capacity;
+		chunk->offset = 0;
+		chunk->next = parser->arena;
+		parser->arena = chunk;
+	}
+
+	void *ptr = chunk->data + chunk->offset;
+	chunk->offset += size;
+
+	return ptr;
+}
+
+static void
+dc_parser_arena_reset (dc_parser_t *parser)
+{
+	dc_parser_chunk_t *chunk = parser->arena;
+	if (chunk == NULL)
+		return;
+
+	// Keep the most recent chunk for reuse, and release the rest.
+	dc_parser_chunk_t *next = chunk->next;
+	chunk->offset = 0;
+	chunk->next = NULL;
+
+	while (next) {
+		dc_parser_chunk_t *current = next;
+		next = current->next;
+		dc_context_mfree (parser->context, current);
+	}
+}
+
+static void
+dc_parser_arena_free (dc_parser_t *parser)
+{
+	dc_parser_chunk_t *chunk = parser->arena;
+	while (chunk) {
+		dc_parser_chunk_t *next = chunk->next;
+		dc_context_mfree (parser->context, chunk);
+		chunk = next;
+	}
+	parser->arena = NULL;
+}
+
 dc_parser_t *
 dc_parser_allocate (dc_context_t *context, const dc_parser_vtable_t *vtable)
 {
@@ -183,7 +290,7 @@ dc_parser_allocate (dc_context_t *context, const dc_parser_vtable_t *vtable)
 	assert(vtable->size >= sizeof(dc_parser_t));
 
 	// Allocate memory.
-	parser = (dc_parser_t *) malloc (vtable->size);
+	parser = (dc_parser_t *) dc_context_malloc (context, vtable->size);
 	if (parser == NULL) {
 		ERROR (context, "Failed to allocate memory.");
 		return parser;
@@ -194,6 +301,14 @@ dc_parser_allocate (dc_context_t *context, const dc_parser_vtable_t *vtable)
 	parser->context = context;
 	parser->data = NULL;
 	parser->size = 0;
+	parser->arena = NULL;
+	parser->cached = 0;
+	parser->cached_gasmix = 0;
+	parser->cached_tank = 0;
+	memset (&parser->cache, 0, sizeof (parser->cache));
+	parser->sample_mask = 0;
+	parser->sample_filter = 0;
+	parser->recovery = 0;
 
 	return parser;
 }
@@ -201,7 +316,10 @@ dc_parser_allocate (dc_context_t *context, const dc_parser_vtable_t *vtable)
 void
 dc_parser_deallocate (dc_parser_t *parser)
 {
-	free (parser);
+	if (parser) {
+		dc_parser_arena_free (parser);
+		dc_context_mfree (parser->context, parser);
+	}
 }
 
 int
@@ -220,7 +338,7 @@ dc_parser_get_type (dc_parser_t *parser)
 	if (parser == NULL)
 		return DC_FAMILY_NULL;
 
-	return parser->vtable->type;
+	return DC_PARSER_VTABLE(parser)->type;
 }
 
 
@@ -230,13 +348,45 @@ dc_parser_set_data (dc_parser_t *parser, const unsigned char *data, unsigned int
 	if (parser == NULL)
 		return DC_STATUS_UNSUPPORTED;
 
-	if (parser->vtable->set_data == NULL)
+	if (DC_PARSER_VTABLE(parser)->set_data == NULL)
 		return DC_STATUS_UNSUPPORTED;
 
 	parser->data = data;
 	parser->size = size;
 
-	return parser->vtable->set_data (parser, data, size);
+	// Release the per-dive allocations of the previous dive.
+	dc_parser_arena_reset (parser);
+
+	// Invalidate the field cache.
+	parser->cached = 0;
+	parser->cached_gasmix = 0;
+	parser->cached_tank = 0;
+
+	return DC_PARSER_VTABLE(parser)->set_data (parser, data, size);
+}
+
+
+dc_status_t
+dc_parser_reset (dc_parser_t *parser)
+{
+	if (parser == NULL)
+		return DC_STATUS_UNSUPPORTED;
+
+	if (DC_PARSER_VTABLE(parser)->set_data == NULL)
+		return DC_STATUS_UNSUPPORTED;
+
+	parser->data = NULL;
+	parser->size = 0;
+
+	// Release the per-dive allocations.
+	dc_parser_arena_reset (parser);
+
+	// Invalidate the field cache.
+	parser->cached = 0;
+	parser->cached_gasmix = 0;
+	parser->cached_tank = 0;
+
+	return DC_PARSER_VTABLE(parser)->set_data (parser, NULL, 0);
 }
 
 
@@ -246,35 +396,1012 @@ dc_parser_get_datetime (dc_parser_t *parser, dc_datetime_t *datetime)
 	if (parser == NULL)
 		return DC_STATUS_UNSUPPORTED;
 
-	if (parser->vtable->datetime == NULL)
+	if (DC_PARSER_VTABLE(parser)->datetime == NULL)
 		return DC_STATUS_UNSUPPORTED;
 
-	return parser->vtable->datetime (parser, datetime);
+	return DC_PARSER_VTABLE(parser)->datetime (parser, datetime);
+}
+
+void
+dc_parser_cache_store (dc_parser_t *parser, dc_field_type_t type, unsigned int flags, const void *value)
+{
+	if (parser == NULL || value == NULL)
+		return;
+
+	switch (type) {
+	case DC_FIELD_DIVETIME:
+		parser->cache.divetime = *(const unsigned int *) value;
+		break;
+	case DC_FIELD_MAXDEPTH:
+		parser->cache.maxdepth = *(const double *) value;
+		break;
+	case DC_FIELD_AVGDEPTH:
+		parser->cache.avgdepth = *(const double *) value;
+		break;
+	case DC_FIELD_GASMIX_COUNT:
+		parser->cache.gasmix_count = *(const unsigned int *) value;
+		break;
+	case DC_FIELD_GASMIX:
+		if (flags >= MAXFIELDS)
+			return;
+		parser->cache.gasmix[flags] = *(const dc_gasmix_t *) value;
+		parser->cached_gasmix |= 1u << flags;
+		return;
+	case DC_FIELD_SALINITY:
+		parser->cache.salinity = *(const dc_salinity_t *) value;
+		break;
+	case DC_FIELD_ATMOSPHERIC:
+		parser->cache.atmospheric = *(const double *) value;
+		break;
+	case DC_FIELD_TEMPERATURE_SURFACE:
+		parser->cache.temperature_surface = *(const double *) value;
+		break;
+	case DC_FIELD_TEMPERATURE_MINIMUM:
+		parser->cache.temperature_minimum = *(const double *) value;
+		break;
+	case DC_FIELD_TEMPERATURE_MAXIMUM:
+		parser->cache.temperature_maximum = *(const double *) value;
+		break;
+	case DC_FIELD_TANK_COUNT:
+		parser->cache.tank_count = *(const unsigned int *) value;
+		break;
+	case DC_FIELD_TANK:
+		if (flags >= MAXFIELDS)
+			return;
+		parser->cache.tank[flags] = *(const dc_tank_t *) value;
+		parser->cached_tank |= 1u << flags;
+		return;
+	case DC_FIELD_DIVEMODE:
+		parser->cache.divemode = *(const dc_divemode_t *) value;
+		break;
+	default:
+		return;
+	}
+
+	parser->cached |= 1u << type;
 }
 
+
+static int
+dc_parser_cache_load (dc_parser_t *parser, dc_field_type_t type, unsigned int flags, void *value)
+{
+	switch (type) {
+	case DC_FIELD_GASMIX:
+		if (flags >= MAXFIELDS || (parser->cached_gasmix & (1u << flags)) == 0)
+			return 0;
+		*(dc_gasmix_t *) value = parser->cache.gasmix[flags];
+		return 1;
+	case DC_FIELD_TANK:
+		if (flags >= MAXFIELDS || (parser->cached_tank & (1u << flags)) == 0)
+			return 0;
+		*(dc_tank_t *) value = parser->cache.tank[flags];
+		return 1;
+	default:
+		break;
+	}
+
+	if ((parser->cached & (1u << type)) == 0)
+		return 0;
+
+	switch (type) {
+	case DC_FIELD_DIVETIME:
+		*(unsigned int *) value = parser->cache.divetime;
+		break;
+	case DC_FIELD_MAXDEPTH:
+		*(double *) value = parser->cache.maxdepth;
+		break;
+	case DC_FIELD_AVGDEPTH:
+		*(double *) value = parser->cache.avgdepth;
+		break;
+	case DC_FIELD_GASMIX_COUNT:
+		*(unsigned int *) value = parser->cache.gasmix_count;
+		break;
+	case DC_FIELD_SALINITY:
+		*(dc_salinity_t *) value = parser->cache.salinity;
+		break;
+	case DC_FIELD_ATMOSPHERIC:
+		*(double *) value = parser->cache.atmospheric;
+		break;
+	case DC_FIELD_TEMPERATURE_SURFACE:
+		*(double *) value = parser->cache.temperature_surface;
+		break;
+	case DC_FIELD_TEMPERATURE_MINIMUM:
+		*(double *) value = parser->cache.temperature_minimum;
+		break;
+	case DC_FIELD_TEMPERATURE_MAXIMUM:
+		*(double *) value = parser->cache.temperature_maximum;
+		break;
+	case DC_FIELD_TANK_COUNT:
+		*(unsigned int *) value = parser->cache.tank_count;
+		break;
+	case DC_FIELD_DIVEMODE:
+		*(dc_divemode_t *) value = parser->cache.divemode;
+		break;
+	default:
+		return 0;
+	}
+
+	return 1;
+}
+
+
 dc_status_t
 dc_parser_get_field (dc_parser_t *parser, dc_field_type_t type, unsigned int flags, void *value)
 {
+	dc_status_t rc = DC_STATUS_SUCCESS;
+
+	if (parser == NULL)
+		return DC_STATUS_UNSUPPORTED;
+
+	if (DC_PARSER_VTABLE(parser)->field == NULL)
+		return DC_STATUS_UNSUPPORTED;
+
+	// Serve repeated queries from the field cache.
+	if (value && dc_parser_cache_load (parser, type, flags, value))
+		return DC_STATUS_SUCCESS;
+
+	rc = DC_PARSER_VTABLE(parser)->field (parser, type, flags, value);
+	if (rc == DC_STATUS_SUCCESS && value)
+		dc_parser_cache_store (parser, type, flags, value);
+
+	return rc;
+}
+
+
+dc_status_t
+dc_parser_get_fields (dc_parser_t *parser, dc_fieldset_t *fields)
+{
+	const struct {
+		dc_field_type_t type;
+		void *value;
+	} scalars[] = {
+		{DC_FIELD_DIVETIME,            fields ? &fields->divetime : NULL},
+		{DC_FIELD_MAXDEPTH,            fields ? &fields->maxdepth : NULL},
+		{DC_FIELD_AVGDEPTH,            fields ? &fields->avgdepth : NULL},
+		{DC_FIELD_GASMIX_COUNT,        fields ? &fields->gasmix_count : NULL},
+		{DC_FIELD_SALINITY,            fields ? &fields->salinity : NULL},
+		{DC_FIELD_ATMOSPHERIC,         fields ? &fields->atmospheric : NULL},
+		{DC_FIELD_TEMPERATURE_SURFACE, fields ? &fields->temperature_surface : NULL},
+		{DC_FIELD_TEMPERATURE_MINIMUM, fields ? &fields->temperature_minimum : NULL},
+		{DC_FIELD_TEMPERATURE_MAXIMUM, fields ? &fields->temperature_maximum : NULL},
+		{DC_FIELD_TANK_COUNT,          fields ? &fields->tank_count : NULL},
+		{DC_FIELD_DIVEMODE,            fields ? &fields->divemode : NULL},
+	};
+
 	if (parser == NULL)
 		return DC_STATUS_UNSUPPORTED;
 
-	if (parser->vtable->field == NULL)
+	if (fields == NULL)
+		return DC_STATUS_INVALIDARGS;
+
+	memset (fields, 0, sizeof (*fields));
+
+	// Query the scalar fields. Fields the backend doesn't support are
+	// left zeroed, with their bit cleared in the supported bitmap.
+	for (unsigned int i = 0; i < C_ARRAY_SIZE (scalars); ++i) {
+		dc_status_t rc = dc_parser_get_field (parser, scalars[i].type, 0, scalars[i].value);
+		if (rc == DC_STATUS_SUCCESS)
+			fields->supported |= (1u << scalars[i].type);
+	}
+
+	// Query the individual gas mixes and tanks.
+	if (fields->supported & (1u << DC_FIELD_GASMIX_COUNT)) {
+		unsigned int n = fields->gasmix_count;
+		if (n > DC_FIELDSET_MAXGASMIXES)
+			n = DC_FIELDSET_MAXGASMIXES;
+		unsigned int i = 0;
+		while (i < n && dc_parser_get_field (parser, DC_FIELD_GASMIX, i, fields->gasmix + i) == DC_STATUS_SUCCESS)
+			i++;
+		if (i && i == n)
+			fields->supported |= (1u << DC_FIELD_GASMIX);
+		else
+			fields->gasmix_count = i;
+	}
+
+	if (fields->supported & (1u << DC_FIELD_TANK_COUNT)) {
+		unsigned int n = fields->tank_count;
+		if (n > DC_FIELDSET_MAXTANKS)
+			n = DC_FIELDSET_MAXTANKS;
+		unsigned int i = 0;
+		while (i < n && dc_parser_get_field (parser, DC_FIELD_TANK, i, fields->tank + i) == DC_STATUS_SUCCESS)
+			i++;
+		if (i && i == n)
+			fields->supported |= (1u << DC_FIELD_TANK);
+		else
+			fields->tank_count = i;
+	}
+
+	return DC_STATUS_SUCCESS;
+}
+
+
+typedef struct dc_sample_filter_t {
+	dc_sample_callback_t callback;
+	void *userdata;
+	unsigned int mask;
+} dc_sample_filter_t;
+
+static void
+dc_parser_samples_filter_cb (dc_sample_type_t type, dc_sample_value_t value, void *userdata)
+{
+	dc_sample_filter_t *filter = (dc_sample_filter_t *) userdata;
+
+	if (filter->mask & (1u << type))
+		filter->callback (type, value, filter->userdata);
+}
+
+dc_status_t
+dc_parser_set_sample_mask (dc_parser_t *parser, unsigned int mask)
+{
+	if (parser == NULL)
 		return DC_STATUS_UNSUPPORTED;
 
-	return parser->vtable->field (parser, type, flags, value);
+	parser->sample_mask = mask;
+
+	return DC_STATUS_SUCCESS;
 }
 
+dc_status_t
+dc_parser_set_recovery (dc_parser_t *parser, unsigned int enable)
+{
+	if (parser == NULL)
+		return DC_STATUS_UNSUPPORTED;
+
+	parser->recovery = enable;
+
+	return DC_STATUS_SUCCESS;
+}
 
 dc_status_t
 dc_parser_samples_foreach (dc_parser_t *parser, dc_sample_callback_t callback, void *userdata)
+{
+	dc_status_t rc = DC_STATUS_SUCCESS;
+
+	if (parser == NULL)
+		return DC_STATUS_UNSUPPORTED;
+
+	if (DC_PARSER_VTABLE(parser)->samples_foreach == NULL)
+		return DC_STATUS_UNSUPPORTED;
+
+	// Apply the sample type filter, see dc_parser_set_sample_mask. The
+	// active mask is published to the backend for the duration of the
+	// call, so it can skip the decoding of the unselected types. The
+	// filter callback guarantees that no unselected samples are
+	// delivered, also for backends that ignore the mask.
+	if (parser->sample_mask && callback) {
+		dc_sample_filter_t filter = {callback, userdata, parser->sample_mask};
+		parser->sample_filter = parser->sample_mask;
+		rc = DC_PARSER_VTABLE(parser)->samples_foreach (parser, dc_parser_samples_filter_cb, &filter);
+		parser->sample_filter = 0;
+		return rc;
+	}
+
+	return DC_PARSER_VTABLE(parser)->samples_foreach (parser, callback, userdata);
+}
+
+
+typedef struct dc_sample_tee_t {
+	const dc_sample_sink_t *sinks;
+	unsigned int nsinks;
+} dc_sample_tee_t;
+
+static void
+dc_parser_samples_tee_cb (dc_sample_type_t type, dc_sample_value_t value, void *userdata)
+{
+	dc_sample_tee_t *tee = (dc_sample_tee_t *) userdata;
+
+	for (unsigned int i = 0; i < tee->nsinks; ++i) {
+		tee->sinks[i].callback (type, value, tee->sinks[i].userdata);
+	}
+}
+
+dc_status_t
+dc_parser_samples_foreach_multi (dc_parser_t *parser, const dc_sample_sink_t sinks[], unsigned int nsinks)
+{
+	if (parser == NULL)
+		return DC_STATUS_UNSUPPORTED;
+
+	if (sinks == NULL && nsinks != 0)
+		return DC_STATUS_INVALIDARGS;
+
+	for (unsigned int i = 0; i < nsinks; ++i) {
+		if (sinks[i].callback == NULL)
+			return DC_STATUS_INVALIDARGS;
+	}
+
+	// Without any consumers, there is nothing to decode.
+	if (nsinks == 0)
+		return DC_STATUS_SUCCESS;
+
+	// A single consumer needs no fan-out.
+	if (nsinks == 1)
+		return dc_parser_samples_foreach (parser, sinks[0].callback, sinks[0].userdata);
+
+	dc_sample_tee_t tee = {sinks, nsinks};
+
+	return dc_parser_samples_foreach (parser, dc_parser_samples_tee_cb, &tee);
+}
+
+
+typedef struct dc_sample_batch_t {
+	dc_sample_t *samples;
+	unsigned int size;
+	unsigned int count;
+} dc_sample_batch_t;
+
+static void
+dc_parser_samples_batch_cb (dc_sample_type_t type, dc_sample_value_t value, void *userdata)
+{
+	dc_sample_batch_t *batch = (dc_sample_batch_t *) userdata;
+
+	if (batch->count < batch->size) {
+		batch->samples[batch->count].type = type;
+		batch->samples[batch->count].value = value;
+	}
+
+	batch->count++;
+}
+
+dc_status_t
+dc_parser_samples_batch (dc_parser_t *parser, dc_sample_t *samples, unsigned int size, unsigned int *actual)
+{
+	dc_status_t rc = DC_STATUS_SUCCESS;
+	dc_sample_batch_t batch = {samples, size, 0};
+
+	if (parser == NULL)
+		return DC_STATUS_UNSUPPORTED;
+
+	if (samples == NULL && size != 0)
+		return DC_STATUS_INVALIDARGS;
+
+	if (DC_PARSER_VTABLE(parser)->samples_batch) {
+		rc = DC_PARSER_VTABLE(parser)->samples_batch (parser, samples, size, &batch.count);
+	} else {
+		if (DC_PARSER_VTABLE(parser)->samples_foreach == NULL)
+			return DC_STATUS_UNSUPPORTED;
+
+		rc = DC_PARSER_VTABLE(parser)->samples_foreach (parser, dc_parser_samples_batch_cb, &batch);
+		if (rc == DC_STATUS_SUCCESS && batch.count > size)
+			rc = DC_STATUS_NOMEMORY;
+	}
+
+	if (actual)
+		*actual = batch.count;
+
+	return rc;
+}
+
+
+dc_status_t
+dc_parser_vendor_decode (dc_parser_t *parser, unsigned int type, const void *data, unsigned int size, dc_sample_callback_t callback, void *userdata)
 {
 	if (parser == NULL)
 		return DC_STATUS_UNSUPPORTED;
 
-	if (parser->vtable->samples_foreach == NULL)
+	if (data == NULL && size != 0)
+		return DC_STATUS_INVALIDARGS;
+
+	if (DC_PARSER_VTABLE(parser)->vendor_decode == NULL)
+		return DC_STATUS_UNSUPPORTED;
+
+	return DC_PARSER_VTABLE(parser)->vendor_decode (parser, type, (const unsigned char *) data, size, callback, userdata);
+}
+
+
+typedef struct dc_sample_column_t {
+	dc_sample_type_t type;
+	unsigned int channel;
+	dc_sample_value_t *values;
+	unsigned int size;
+	// The current record and the occurrence of the requested type
+	// within it.
+	unsigned int count;
+	unsigned int index;
+} dc_sample_column_t;
+
+static void
+dc_parser_samples_column_cb (dc_sample_type_t type, dc_sample_value_t value, void *userdata)
+{
+	dc_sample_column_t *column = (dc_sample_column_t *) userdata;
+
+	if (type == DC_SAMPLE_TIME) {
+		// A time sample starts a new record.
+		if (column->count < column->size)
+			memset (column->values + column->count, 0, sizeof (dc_sample_value_t));
+		column->count++;
+		column->index = 0;
+	}
+
+	if (type != column->type || column->count == 0)
+		return;
+
+	if (column->index == column->channel && column->count <= column->size)
+		column->values[column->count - 1] = value;
+
+	column->index++;
+}
+
+dc_status_t
+dc_parser_samples_column (dc_parser_t *parser, dc_sample_type_t type, unsigned int channel, dc_sample_value_t values[], unsigned int size, unsigned int *actual)
+{
+	dc_status_t rc = DC_STATUS_SUCCESS;
+	dc_sample_column_t column = {type, channel, values, size, 0, 0};
+
+	if (parser == NULL)
+		return DC_STATUS_UNSUPPORTED;
+
+	if (values == NULL && size != 0)
+		return DC_STATUS_INVALIDARGS;
+
+	if (DC_PARSER_VTABLE(parser)->samples_foreach == NULL)
+		return DC_STATUS_UNSUPPORTED;
+
+	rc = DC_PARSER_VTABLE(parser)->samples_foreach (parser, dc_parser_samples_column_cb, &column);
+	if (rc == DC_STATUS_SUCCESS && column.count > size)
+		rc = DC_STATUS_NOMEMORY;
+
+	if (actual)
+		*actual = column.count;
+
+	return rc;
+}
+
+
+// The number of distinct sample types that can be tracked per record.
+#define COLUMNS_MAXTYPES 32
+
+typedef struct dc_sample_columns_entry_t {
+	struct dc_sample_columns_entry_t *next;
+	dc_sample_type_t type;
+	unsigned int channel;
+	dc_sample_value_t *values;
+	unsigned int capacity;
+	// The number of records written so far; entries for records that
+	// skipped this column are zero filled on the next write.
+	unsigned int filled;
+} dc_sample_columns_entry_t;
+
+struct dc_sample_columns_t {
+	dc_sample_columns_entry_t *entries;
+	// The number of sample records.
+	unsigned int count;
+	// The occurrence of each type within the current record.
+	unsigned int index[COLUMNS_MAXTYPES];
+	// An allocation failure inside the callback is remembered here,
+	// because the callback itself cannot report errors.
+	dc_status_t status;
+};
+
+static void
+dc_parser_samples_columns_cb (dc_sample_type_t type, dc_sample_value_t value, void *userdata)
+{
+	dc_sample_columns_t *columns = (dc_sample_columns_t *) userdata;
+
+	if (columns->status != DC_STATUS_SUCCESS)
+		return;
+
+	if (type == DC_SAMPLE_TIME) {
+		// A time sample starts a new record.
+		columns->count++;
+		memset (columns->index, 0, sizeof (columns->index));
+	}
+
+	if (columns->count == 0 || (unsigned int) type >= COLUMNS_MAXTYPES)
+		return;
+
+	unsigned int channel = columns->index[type]++;
+
+	// Find the column, or create it on first occurrence.
+	dc_sample_columns_entry_t *entry = columns->entries;
+	while (entry != NULL) {
+		if (entry->type == type && entry->channel == channel)
+			break;
+		entry = entry->next;
+	}
+
+	if (entry == NULL) {
+		entry = (dc_sample_columns_entry_t *) malloc (sizeof (dc_sample_columns_entry_t));
+		if (entry == NULL) {
+			columns->status = DC_STATUS_NOMEMORY;
+			return;
+		}
+		entry->type = type;
+		entry->channel = channel;
+		entry->values = NULL;
+		entry->capacity = 0;
+		entry->filled = 0;
+		entry->next = columns->entries;
+		columns->entries = entry;
+	}
+
+	// Grow the column geometrically.
+	if (columns->count > entry->capacity) {
+		unsigned int capacity = entry->capacity ? entry->capacity * 2 : 64;
+		if (capacity < columns->count)
+			capacity = columns->count;
+		dc_sample_value_t *values = (dc_sample_value_t *) realloc (entry->values, capacity * sizeof (dc_sample_value_t));
+		if (values == NULL) {
+			columns->status = DC_STATUS_NOMEMORY;
+			return;
+		}
+		entry->values = values;
+		entry->capacity = capacity;
+	}
+
+	// Zero the entries for the records that skipped this column.
+	if (entry->filled < columns->count - 1)
+		memset (entry->values + entry->filled, 0,
+			(columns->count - 1 - entry->filled) * sizeof (dc_sample_value_t));
+
+	entry->values[columns->count - 1] = value;
+	entry->filled = columns->count;
+}
+
+dc_status_t
+dc_parser_samples_columns (dc_parser_t *parser, dc_sample_columns_t **out)
+{
+	dc_status_t rc = DC_STATUS_SUCCESS;
+	dc_sample_columns_t *columns = NULL;
+
+	if (parser == NULL || out == NULL)
+		return DC_STATUS_INVALIDARGS;
+
+	if (DC_PARSER_VTABLE(parser)->samples_foreach == NULL)
+		return DC_STATUS_UNSUPPORTED;
+
+	columns = (dc_sample_columns_t *) calloc (1, sizeof (dc_sample_columns_t));
+	if (columns == NULL) {
+		ERROR (parser->context, "Failed to allocate memory.");
+		return DC_STATUS_NOMEMORY;
+	}
+
+	rc = DC_PARSER_VTABLE(parser)->samples_foreach (parser, dc_parser_samples_columns_cb, columns);
+	if (rc == DC_STATUS_SUCCESS)
+		rc = columns->status;
+	if (rc != DC_STATUS_SUCCESS) {
+		dc_sample_columns_free (columns);
+		return rc;
+	}
+
+	// Zero the tail of the columns that were not written by the last
+	// records. A column that stopped occurring before the end of the
+	// dive may still need to grow to the final record count.
+	dc_sample_columns_entry_t *entry = columns->entries;
+	while (entry != NULL) {
+		if (entry->capacity < columns->count) {
+			dc_sample_value_t *values = (dc_sample_value_t *) realloc (entry->values, columns->count * sizeof (dc_sample_value_t));
+			if (values == NULL) {
+				ERROR (parser->context, "Failed to allocate memory.");
+				dc_sample_columns_free (columns);
+				return DC_STATUS_NOMEMORY;
+			}
+			entry->values = values;
+			entry->capacity = columns->count;
+		}
+		if (entry->filled < columns->count)
+			memset (entry->values + entry->filled, 0,
+				(columns->count - entry->filled) * sizeof (dc_sample_value_t));
+		entry->filled = columns->count;
+		entry = entry->next;
+	}
+
+	*out = columns;
+
+	return DC_STATUS_SUCCESS;
+}
+
+unsigned int
+dc_sample_columns_count (const dc_sample_columns_t *columns)
+{
+	if (columns == NULL)
+		return 0;
+
+	return columns->count;
+}
+
+const dc_sample_value_t *
+dc_sample_columns_get (const dc_sample_columns_t *columns, dc_sample_type_t type, unsigned int channel)
+{
+	if (columns == NULL)
+		return NULL;
+
+	const dc_sample_columns_entry_t *entry = columns->entries;
+	while (entry != NULL) {
+		if (entry->type == type && entry->channel == channel)
+			return entry->values;
+		entry = entry->next;
+	}
+
+	return NULL;
+}
+
+dc_status_t
+dc_sample_columns_free (dc_sample_columns_t *columns)
+{
+	if (columns == NULL)
+		return DC_STATUS_SUCCESS;
+
+	dc_sample_columns_entry_t *entry = columns->entries;
+	while (entry != NULL) {
+		dc_sample_columns_entry_t *next = entry->next;
+		free (entry->values);
+		free (entry);
+		entry = next;
+	}
+
+	free (columns);
+
+	return DC_STATUS_SUCCESS;
+}
+
+
+typedef struct dc_sample_present_t {
+	unsigned int samples;
+	unsigned int events;
+} dc_sample_present_t;
+
+static void
+dc_parser_samples_present_cb (dc_sample_type_t type, dc_sample_value_t value, void *userdata)
+{
+	dc_sample_present_t *present = (dc_sample_present_t *) userdata;
+
+	if ((unsigned int) type < 32)
+		present->samples |= 1u << type;
+
+	if (type == DC_SAMPLE_EVENT && value.event.type < 32)
+		present->events |= 1u << value.event.type;
+}
+
+dc_status_t
+dc_parser_samples_present (dc_parser_t *parser, unsigned int *samples, unsigned int *events)
+{
+	dc_status_t rc = DC_STATUS_SUCCESS;
+	dc_sample_present_t present = {0, 0};
+
+	if (parser == NULL)
+		return DC_STATUS_UNSUPPORTED;
+
+	if (DC_PARSER_VTABLE(parser)->samples_foreach == NULL)
+		return DC_STATUS_UNSUPPORTED;
+
+	rc = DC_PARSER_VTABLE(parser)->samples_foreach (parser, dc_parser_samples_present_cb, &present);
+
+	if (samples)
+		*samples = present.samples;
+	if (events)
+		*events = present.events;
+
+	return rc;
+}
+
+
+// The maximum number of values buffered per sample record.
+#define DECIMATE_MAXSAMPLES 64
+
+typedef struct dc_sample_decimate_t {
+	dc_sample_callback_t callback;
+	void *userdata;
+	unsigned int interval;
+	// The current sample record, started by a time sample.
+	dc_sample_t record[DECIMATE_MAXSAMPLES];
+	unsigned int count;
+	unsigned int overflow;
+	unsigned int time;
+	unsigned int keep;
+	unsigned int have_depth;
+	double depth;
+	// The current bucket.
+	unsigned int bucket;
+	unsigned int have_bucket;
+	unsigned int emitted;
+	// Depth extremes of the records dropped from the current bucket.
+	unsigned int have_min, have_max;
+	unsigned int tmin, tmax;
+	double dmin, dmax;
+} dc_sample_decimate_t;
+
+static void
+dc_parser_decimate_record_emit (dc_sample_decimate_t *decimate)
+{
+	for (unsigned int i = 0; i < decimate->count; ++i) {
+		decimate->callback (decimate->record[i].type,
+			decimate->record[i].value, decimate->userdata);
+	}
+	decimate->count = 0;
+}
+
+static void
+dc_parser_decimate_extreme_emit (dc_sample_decimate_t *decimate, unsigned int time, double depth)
+{
+	dc_sample_value_t value = {0};
+
+	value.time = time;
+	decimate->callback (DC_SAMPLE_TIME, value, decimate->userdata);
+	value.depth = depth;
+	decimate->callback (DC_SAMPLE_DEPTH, value, decimate->userdata);
+}
+
+static void
+dc_parser_decimate_bucket_flush (dc_sample_decimate_t *decimate)
+{
+	// Preserve the depth extremes of the dropped records, as synthetic
+	// records with only a time and a depth sample, in time order.
+	if (decimate->have_min && decimate->have_max &&
+		decimate->tmax < decimate->tmin) {
+		dc_parser_decimate_extreme_emit (decimate, decimate->tmax, decimate->dmax);
+		dc_parser_decimate_extreme_emit (decimate, decimate->tmin, decimate->dmin);
+	} else {
+		if (decimate->have_min)
+			dc_parser_decimate_extreme_emit (decimate, decimate->tmin, decimate->dmin);
+		if (decimate->have_max && decimate->tmax != decimate->tmin)
+			dc_parser_decimate_extreme_emit (decimate, decimate->tmax, decimate->dmax);
+	}
+
+	decimate->have_min = 0;
+	decimate->have_max = 0;
+	decimate->emitted = 0;
+}
+
+static void
+dc_parser_decimate_record_finish (dc_sample_decimate_t *decimate)
+{
+	if (decimate->count == 0 && !decimate->overflow)
+		return;
+
+	// Close the previous bucket when this record starts a new one.
+	unsigned int bucket = decimate->time / decimate->interval;
+	if (!decimate->have_bucket || bucket != decimate->bucket) {
+		if (decimate->have_bucket)
+			dc_parser_decimate_bucket_flush (decimate);
+		decimate->bucket = bucket;
+		decimate->have_bucket = 1;
+	}
+
+	if (decimate->overflow) {
+		// The record was already forwarded.
+		decimate->emitted = 1;
+	} else if (!decimate->emitted || decimate->keep) {
+		// Emit the first record of a bucket, and every record that
+		// carries samples which cannot be dropped.
+		dc_parser_decimate_record_emit (decimate);
+		decimate->emitted = 1;
+	} else {
+		// Drop the record, but remember its depth extremes.
+		if (decimate->have_depth) {
+			if (!decimate->have_min || decimate->depth < decimate->dmin) {
+				decimate->dmin = decimate->depth;
+				decimate->tmin = decimate->time;
+				decimate->have_min = 1;
+			}
+			if (!decimate->have_max || decimate->depth > decimate->dmax) {
+				decimate->dmax = decimate->depth;
+				decimate->tmax = decimate->time;
+				decimate->have_max = 1;
+			}
+		}
+	}
+
+	decimate->count = 0;
+	decimate->overflow = 0;
+	decimate->keep = 0;
+	decimate->have_depth = 0;
+}
+
+static void
+dc_parser_samples_decimate_cb (dc_sample_type_t type, dc_sample_value_t value, void *userdata)
+{
+	dc_sample_decimate_t *decimate = (dc_sample_decimate_t *) userdata;
+
+	if (type == DC_SAMPLE_TIME) {
+		dc_parser_decimate_record_finish (decimate);
+		decimate->time = value.time;
+	} else if (type == DC_SAMPLE_DEPTH) {
+		decimate->depth = value.depth;
+		decimate->have_depth = 1;
+	} else if (type == DC_SAMPLE_EVENT || type == DC_SAMPLE_GASMIX ||
+		type == DC_SAMPLE_VENDOR) {
+		// Discrete samples are never dropped.
+		decimate->keep = 1;
+	}
+
+	if (decimate->overflow) {
+		// The rest of an oversized record is forwarded directly.
+		decimate->callback (type, value, decimate->userdata);
+		return;
+	}
+
+	if (decimate->count >= DECIMATE_MAXSAMPLES) {
+		// The record does not fit in the buffer. Forward what was
+		// buffered so far, and pass the remainder through.
+		decimate->overflow = 1;
+		dc_parser_decimate_record_emit (decimate);
+		decimate->callback (type, value, decimate->userdata);
+		return;
+	}
+
+	decimate->record[decimate->count].type = type;
+	decimate->record[decimate->count].value = value;
+	decimate->count++;
+}
+
+dc_status_t
+dc_parser_samples_decimate (dc_parser_t *parser, unsigned int interval, dc_sample_callback_t callback, void *userdata)
+{
+	dc_status_t rc = DC_STATUS_SUCCESS;
+
+	if (parser == NULL)
 		return DC_STATUS_UNSUPPORTED;
 
-	return parser->vtable->samples_foreach (parser, callback, userdata);
+	if (callback == NULL)
+		return DC_STATUS_INVALIDARGS;
+
+	// Without an interval there is nothing to decimate.
+	if (interval <= 1)
+		return dc_parser_samples_foreach (parser, callback, userdata);
+
+	dc_sample_decimate_t decimate = {callback, userdata, interval};
+
+	rc = dc_parser_samples_foreach (parser, dc_parser_samples_decimate_cb, &decimate);
+	if (rc != DC_STATUS_SUCCESS)
+		return rc;
+
+	// Flush the last record and bucket.
+	dc_parser_decimate_record_finish (&decimate);
+	if (decimate.have_bucket)
+		dc_parser_decimate_bucket_flush (&decimate);
+
+	return DC_STATUS_SUCCESS;
+}
+
+
+typedef struct dc_parser_work_t {
+	dc_context_t *context;
+	dc_descriptor_t *descriptor;
+	unsigned int devtime;
+	dc_ticks_t systime;
+	const dc_dive_data_t *dives;
+	unsigned int ndives;
+	dc_parser_parse_callback_t callback;
+	void *userdata;
+	dc_mutex_t mutex;
+	dc_cond_t cond;
+	unsigned int next;
+	unsigned int pending;
+	dc_status_t status;
+} dc_parser_work_t;
+
+static void *
+dc_parser_parse_worker (void *arg)
+{
+	dc_parser_work_t *work = (dc_parser_work_t *) arg;
+	dc_parser_t *parser = NULL;
+
+	// Create a private parser instance for this worker thread, so the
+	// backend state and the field cache are never shared.
+	dc_status_t rc = dc_parser_new2 (&parser, work->context,
+		work->descriptor, work->devtime, work->systime);
+	if (rc != DC_STATUS_SUCCESS) {
+		ERROR (work->context, "Failed to create the parser.");
+		dc_mutex_lock (&work->mutex);
+		dc_status_set_error (&work->status, rc);
+		dc_mutex_unlock (&work->mutex);
+		return NULL;
+	}
+
+	for (;;) {
+		// Grab the next unparsed dive.
+		dc_mutex_lock (&work->mutex);
+		unsigned int idx = work->next;
+		if (idx < work->ndives)
+			work->next++;
+		dc_mutex_unlock (&work->mutex);
+
+		if (idx >= work->ndives)
+			break;
+
+		rc = dc_parser_set_data (parser,
+			work->dives[idx].data, work->dives[idx].size);
+
+		work->callback (idx, parser, rc, work->userdata);
+
+		dc_parser_reset (parser);
+	}
+
+	dc_parser_destroy (parser);
+
+	return NULL;
+}
+
+static void
+dc_parser_parse_task (void *arg)
+{
+	dc_parser_work_t *work = (dc_parser_work_t *) arg;
+
+	dc_parser_parse_worker (work);
+
+	dc_mutex_lock (&work->mutex);
+	work->pending--;
+	if (work->pending == 0)
+		dc_cond_signal (&work->cond);
+	dc_mutex_unlock (&work->mutex);
+}
+
+dc_status_t
+dc_parser_parse_many (dc_context_t *context, dc_descriptor_t *descriptor, unsigned int devtime, dc_ticks_t systime, const dc_dive_data_t dives[], unsigned int ndives, unsigned int nthreads, dc_parser_parse_callback_t callback, void *userdata)
+{
+	if (callback == NULL || (dives == NULL && ndives != 0))
+		return DC_STATUS_INVALIDARGS;
+
+	if (ndives == 0)
+		return DC_STATUS_SUCCESS;
+
+	// There is no point in more workers than dives.
+	if (nthreads > ndives)
+		nthreads = ndives;
+
+	dc_parser_work_t work;
+	work.context = context;
+	work.descriptor = descriptor;
+	work.devtime = devtime;
+	work.systime = systime;
+	work.dives = dives;
+	work.ndives = ndives;
+	work.callback = callback;
+	work.userdata = userdata;
+	work.next = 0;
+	work.pending = 0;
+	work.status = DC_STATUS_SUCCESS;
+
+	if (dc_mutex_init (&work.mutex) != 0) {
+		ERROR (context, "Failed to initialize the mutex.");
+		return DC_STATUS_NOMEMORY;
+	}
+
+	unsigned int ntasks = 0;
+	if (nthreads >= 2) {
+		// Run the workers on the shared pool of the context, so
+		// concurrent operations don't oversubscribe the machine. The
+		// requested thread count is an upper bound; the effective
+		// concurrency never exceeds the pool size.
+		dc_taskpool_t *taskpool = dc_context_taskpool (context);
+		if (taskpool && dc_cond_init (&work.cond) == 0) {
+			if (nthreads > dc_taskpool_nthreads (taskpool))
+				nthreads = dc_taskpool_nthreads (taskpool);
+
+			for (unsigned int i = 0; i < nthreads; ++i) {
+				dc_mutex_lock (&work.mutex);
+				work.pending++;
+				dc_mutex_unlock (&work.mutex);
+				if (dc_taskpool_submit (taskpool, dc_parser_parse_task, &work) != 0) {
+					WARNING (context, "Failed to submit a worker task.");
+					dc_mutex_lock (&work.mutex);
+					work.pending--;
+					dc_mutex_unlock (&work.mutex);
+					break;
+				}
+				ntasks++;
+			}
+
+			if (ntasks) {
+				// Wait for all the tasks to finish.
+				dc_mutex_lock (&work.mutex);
+				while (work.pending)
+					dc_cond_wait (&work.cond, &work.mutex);
+				dc_mutex_unlock (&work.mutex);
+			}
+
+			dc_cond_destroy (&work.cond);
+		}
+	}
+
+	if (ntasks == 0) {
+		// Parse everything on the calling thread.
+		dc_parser_parse_worker (&work);
+	}
+
+	dc_mutex_destroy (&work.mutex);
+
+	return work.status;
 }
 
 
@@ -286,8 +1413,8 @@ dc_parser_destroy (dc_parser_t *parser)
 	if (parser == NULL)
 		return DC_STATUS_SUCCESS;
 
-	if (parser->vtable->destroy) {
-		status = parser->vtable->destroy (parser);
+	if (DC_PARSER_VTABLE(parser)->destroy) {
+		status = DC_PARSER_VTABLE(parser)->destroy (parser);
 	}
 
 	dc_parser_deallocate (parser);
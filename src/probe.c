@@ -0,0 +1,173 @@
+/*
+ * libdivecomputer
+ *
+ * Copyright (C) 2016 Jef Driesen
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA
+ */
+
+#include <stdlib.h>
+
+#include <libdivecomputer/probe.h>
+
+#include "context-private.h"
+
+#define MAXCANDIDATES 64
+
+/*
+ * Per family probe success counters, used to order the candidates of
+ * the next probe. The counters are a heuristic: they are updated
+ * without locking, and an increment lost to a concurrent probe only
+ * perturbs the ordering, never the result.
+ */
+typedef struct dc_probe_stat_t {
+	dc_family_t family;
+	unsigned int successes;
+} dc_probe_stat_t;
+
+static dc_probe_stat_t g_probe_stats[MAXCANDIDATES];
+static unsigned int g_probe_nstats = 0;
+
+static unsigned int
+dc_probe_successes (dc_family_t family)
+{
+	for (unsigned int i = 0; i < g_probe_nstats; ++i) {
+		if (g_probe_stats[i].family == family)
+			return g_probe_stats[i].successes;
+	}
+
+	return 0;
+}
+
+static void
+dc_probe_record (dc_family_t family)
+{
+	for (unsigned int i = 0; i < g_probe_nstats; ++i) {
+		if (g_probe_stats[i].family == family) {
+			g_probe_stats[i].successes++;
+			return;
+		}
+	}
+
+	if (g_probe_nstats < MAXCANDIDATES) {
+		g_probe_stats[g_probe_nstats].family = family;
+		g_probe_stats[g_probe_nstats].successes = 1;
+		g_probe_nstats++;
+	}
+}
+
+dc_status_t
+dc_probe (dc_device_t **device, dc_descriptor_t **descriptor, dc_context_t *context, const char *name)
+{
+	dc_status_t rc = DC_STATUS_SUCCESS;
+	dc_descriptor_t *candidates[MAXCANDIDATES];
+	unsigned int ncandidates = 0;
+
+	if (descriptor == NULL || name == NULL)
+		return DC_STATUS_INVALIDARGS;
+
+	// Collect one candidate descriptor per serial protocol family. The
+	// handshake performed by dc_device_open is identical for all models
+	// of a family, so probing more than one of them is wasted time.
+	dc_iterator_t *iterator = NULL;
+	rc = dc_descriptor_iterator_filter (&iterator, DC_FAMILY_NULL, DC_TRANSPORT_SERIAL);
+	if (rc != DC_STATUS_SUCCESS)
+		return rc;
+
+	dc_descriptor_t *current = NULL;
+	while (dc_iterator_next (iterator, &current) == DC_STATUS_SUCCESS) {
+		dc_family_t family = dc_descriptor_get_type (current);
+
+		unsigned int duplicate = 0;
+		for (unsigned int i = 0; i < ncandidates; ++i) {
+			if (dc_descriptor_get_type (candidates[i]) == family) {
+				duplicate = 1;
+				break;
+			}
+		}
+
+		if (duplicate || ncandidates >= MAXCANDIDATES) {
+			dc_descriptor_free (current);
+			continue;
+		}
+
+		candidates[ncandidates++] = current;
+	}
+
+	dc_iterator_free (iterator);
+
+	// Sort the candidates on their probe success count (insertion sort,
+	// stable), so previously seen devices are probed first.
+	for (unsigned int i = 1; i < ncandidates; ++i) {
+		dc_descriptor_t *key = candidates[i];
+		unsigned int successes = dc_probe_successes (dc_descriptor_get_type (key));
+		unsigned int j = i;
+		while (j > 0 && dc_probe_successes (dc_descriptor_get_type (candidates[j - 1])) < successes) {
+			candidates[j] = candidates[j - 1];
+			j--;
+		}
+		candidates[j] = key;
+	}
+
+	// Probe the candidates in order, and stop at the first family whose
+	// handshake succeeds.
+	dc_descriptor_t *detected = NULL;
+	dc_device_t *probed = NULL;
+	rc = DC_STATUS_UNSUPPORTED;
+	for (unsigned int i = 0; i < ncandidates; ++i) {
+		dc_status_t status = dc_device_open (&probed, context, candidates[i], name);
+		if (status == DC_STATUS_SUCCESS) {
+			INFO (context, "Probe: detected %s %s on %s.",
+				dc_descriptor_get_vendor (candidates[i]),
+				dc_descriptor_get_product (candidates[i]),
+				name);
+			dc_probe_record (dc_descriptor_get_type (candidates[i]));
+			detected = candidates[i];
+			candidates[i] = NULL;
+			rc = DC_STATUS_SUCCESS;
+			break;
+		}
+
+		if (status == DC_STATUS_NODEVICE || status == DC_STATUS_NOACCESS) {
+			// The port itself is not usable. No other candidate can
+			// succeed, so don't burn their handshake timeouts.
+			ERROR (context, "Probe: port %s is not usable.", name);
+			rc = status;
+			break;
+		}
+
+		INFO (context, "Probe: no %s %s on %s (%i).",
+			dc_descriptor_get_vendor (candidates[i]),
+			dc_descriptor_get_product (candidates[i]),
+			name, status);
+	}
+
+	for (unsigned int i = 0; i < ncandidates; ++i)
+		dc_descriptor_free (candidates[i]);
+
+	if (rc != DC_STATUS_SUCCESS)
+		return rc;
+
+	if (device) {
+		*device = probed;
+	} else {
+		dc_device_close (probed);
+	}
+
+	*descriptor = detected;
+
+	return DC_STATUS_SUCCESS;
+}
@@ -30,6 +30,7 @@ struct dc_rbstream_t {
 	dc_device_t *device;
 	unsigned int pagesize;
 	unsigned int packetsize;
+	unsigned int cachesize;
 	unsigned int begin;
 	unsigned int end;
 	unsigned int address;
@@ -53,13 +54,17 @@ iceil (unsigned int x, unsigned int n)
 }
 
 dc_status_t
-dc_rbstream_new (dc_rbstream_t **out, dc_device_t *device, unsigned int pagesize, unsigned int packetsize, unsigned int begin, unsigned int end, unsigned int address)
+dc_rbstream_new2 (dc_rbstream_t **out, dc_device_t *device, unsigned int pagesize, unsigned int packetsize, unsigned int npackets, unsigned int begin, unsigned int end, unsigned int address)
 {
 	dc_rbstream_t *rbstream = NULL;
 
 	if (out == NULL || device == NULL)
 		return DC_STATUS_INVALIDARGS;
 
+	// A zero packet count selects the single packet cache.
+	if (npackets == 0)
+		npackets = 1;
+
 	// Page and packet size should be non-zero.
 	if (pagesize == 0 || packetsize == 0) {
 		ERROR (device->context, "Zero length page or packet size!");
@@ -85,7 +90,7 @@ dc_rbstream_new (dc_rbstream_t **out, dc_device_t *device, unsigned int pagesize
 	}
 
 	// Allocate memory.
-	rbstream = (dc_rbstream_t *) malloc (sizeof(*rbstream) + packetsize);
+	rbstream = (dc_rbstream_t *) malloc (sizeof(*rbstream) + packetsize * npackets);
 	if (rbstream == NULL) {
 		ERROR (device->context, "Failed to allocate memory.");
 		return DC_STATUS_NOMEMORY;
@@ -94,6 +99,7 @@ dc_rbstream_new (dc_rbstream_t **out, dc_device_t *device, unsigned int pagesize
 	rbstream->device = device;
 	rbstream->pagesize = pagesize;
 	rbstream->packetsize = packetsize;
+	rbstream->cachesize = packetsize * npackets;
 	rbstream->begin = begin;
 	rbstream->end = end;
 	rbstream->address = iceil(address, pagesize);
@@ -105,6 +111,12 @@ dc_rbstream_new (dc_rbstream_t **out, dc_device_t *device, unsigned int pagesize
 	return DC_STATUS_SUCCESS;
 }
 
+dc_status_t
+dc_rbstream_new (dc_rbstream_t **out, dc_device_t *device, unsigned int pagesize, unsigned int packetsize, unsigned int begin, unsigned int end, unsigned int address)
+{
+	return dc_rbstream_new2 (out, device, pagesize, packetsize, 1, begin, end, address);
+}
+
 dc_status_t
 dc_rbstream_read (dc_rbstream_t *rbstream, dc_event_progress_t *progress, unsigned char data[], unsigned int size)
 {
@@ -125,16 +137,18 @@ dc_rbstream_read (dc_rbstream_t *rbstream, dc_event_progress_t *progress, unsign
 			if (address == rbstream->begin)
 				address = rbstream->end;
 
-			// Calculate the packet size.
-			unsigned int len = rbstream->packetsize;
+			// Calculate the cache refill size. With a multi packet
+			// cache, several packets are requested ahead in a single
+			// transfer, to amortize the protocol round trip latency.
+			unsigned int len = rbstream->cachesize;
 			if (rbstream->begin + len > address)
 				len = address - rbstream->begin;
 
 			// Move to the begin of the current packet.
 			address -= len;
 
-			// Read the packet into the cache.
-			rc = dc_device_read (rbstream->device, address, rbstream->cache, rbstream->packetsize);
+			// Read the packets into the cache.
+			rc = dc_device_read (rbstream->device, address, rbstream->cache, iceil(len, rbstream->packetsize));
 			if (rc != DC_STATUS_SUCCESS)
 				return rc;
 
@@ -49,6 +49,27 @@ typedef struct dc_rbstream_t dc_rbstream_t;
 dc_status_t
 dc_rbstream_new (dc_rbstream_t **rbstream, dc_device_t *device, unsigned int pagesize, unsigned int packetsize, unsigned int begin, unsigned int end, unsigned int address);
 
+/**
+ * Create a new ringbuffer stream with a multi packet read-ahead cache.
+ *
+ * With a packet count larger than one, the stream requests several
+ * packets ahead in a single transfer, to amortize the protocol round
+ * trip latency over more data.
+ *
+ * @param[out]  rbstream    A location to store the ringbuffer stream.
+ * @param[in]   device      A valid device object.
+ * @param[in]   pagesize    The page size in bytes.
+ * @param[in]   packetsize  The packet size in bytes.
+ * @param[in]   npackets    The cache size in packets (zero for one).
+ * @param[in]   begin       The ringbuffer begin address.
+ * @param[in]   end         The ringbuffer end address.
+ * @param[in]   address     The stream start address.
+ * @returns #DC_STATUS_SUCCESS on success, or another #dc_status_t code
+ * on failure.
+ */
+dc_status_t
+dc_rbstream_new2 (dc_rbstream_t **rbstream, dc_device_t *device, unsigned int pagesize, unsigned int packetsize, unsigned int npackets, unsigned int begin, unsigned int end, unsigned int address);
+
 /**
  * Read data from the ringbuffer stream.
  *
@@ -50,7 +50,7 @@ static dc_status_t reefnet_sensus_device_dump (dc_device_t *abstract, dc_buffer_
 static dc_status_t reefnet_sensus_device_foreach (dc_device_t *abstract, dc_dive_callback_t callback, void *userdata);
 static dc_status_t reefnet_sensus_device_close (dc_device_t *abstract);
 
-static const dc_device_vtable_t reefnet_sensus_device_vtable = {
+DC_VTABLE_STORAGE const dc_device_vtable_t reefnet_sensus_device_vtable = {
 	sizeof(reefnet_sensus_device_t),
 	DC_FAMILY_REEFNET_SENSUS,
 	reefnet_sensus_device_set_fingerprint, /* set_fingerprint */
@@ -114,6 +114,9 @@ reefnet_sensus_device_open (dc_device_t **out, dc_context_t *context, const char
 		goto error_free;
 	}
 
+	// Forward cancellation requests to the serial layer.
+	dc_serial_set_cancel (device->port, device_cancel_cb, device);
+
 	// Set the serial communication protocol (19200 8N1).
 	status = dc_serial_configure (device->port, 19200, 8, DC_PARITY_NONE, DC_STOPBITS_ONE, DC_FLOWCONTROL_NONE);
 	if (status != DC_STATUS_SUCCESS) {
@@ -53,7 +53,7 @@ static dc_status_t reefnet_sensus_parser_get_datetime (dc_parser_t *abstract, dc
 static dc_status_t reefnet_sensus_parser_get_field (dc_parser_t *abstract, dc_field_type_t type, unsigned int flags, void *value);
 static dc_status_t reefnet_sensus_parser_samples_foreach (dc_parser_t *abstract, dc_sample_callback_t callback, void *userdata);
 
-static const dc_parser_vtable_t reefnet_sensus_parser_vtable = {
+DC_VTABLE_STORAGE const dc_parser_vtable_t reefnet_sensus_parser_vtable = {
 	sizeof(reefnet_sensus_parser_t),
 	DC_FAMILY_REEFNET_SENSUS,
 	reefnet_sensus_parser_set_data, /* set_data */
@@ -247,7 +247,7 @@ reefnet_sensus_parser_samples_foreach (dc_parser_t *abstract, dc_sample_callback
 					if (offset + 1 > size)
 						return DC_STATUS_DATAFORMAT;
 					unsigned int temperature = data[offset++];
-					sample.temperature = (temperature - 32.0) * (5.0 / 9.0);
+					sample.temperature = FAHRENHEIT_TO_CELSIUS (temperature);
 					if (callback) callback (DC_SAMPLE_TEMPERATURE, sample, userdata);
 				}
 
@@ -49,7 +49,7 @@ static dc_status_t reefnet_sensuspro_device_dump (dc_device_t *abstract, dc_buff
 static dc_status_t reefnet_sensuspro_device_foreach (dc_device_t *abstract, dc_dive_callback_t callback, void *userdata);
 static dc_status_t reefnet_sensuspro_device_close (dc_device_t *abstract);
 
-static const dc_device_vtable_t reefnet_sensuspro_device_vtable = {
+DC_VTABLE_STORAGE const dc_device_vtable_t reefnet_sensuspro_device_vtable = {
 	sizeof(reefnet_sensuspro_device_t),
 	DC_FAMILY_REEFNET_SENSUSPRO,
 	reefnet_sensuspro_device_set_fingerprint, /* set_fingerprint */
@@ -91,6 +91,9 @@ reefnet_sensuspro_device_open (dc_device_t **out, dc_context_t *context, const c
 		goto error_free;
 	}
 
+	// Forward cancellation requests to the serial layer.
+	dc_serial_set_cancel (device->port, device_cancel_cb, device);
+
 	// Set the serial communication protocol (19200 8N1).
 	status = dc_serial_configure (device->port, 19200, 8, DC_PARITY_NONE, DC_STOPBITS_ONE, DC_FLOWCONTROL_NONE);
 	if (status != DC_STATUS_SUCCESS) {
@@ -280,6 +283,7 @@ reefnet_sensuspro_device_dump (dc_device_t *abstract, dc_buffer_t *buffer)
 
 	unsigned int nbytes = 0;
 	unsigned char answer[SZ_MEMORY + 2] = {0};
+	unsigned short ccrc = checksum_crc_ccitt_uint16_init ();
 	while (nbytes < sizeof (answer)) {
 		unsigned int len = sizeof (answer) - nbytes;
 		if (len > 256)
@@ -291,6 +295,13 @@ reefnet_sensuspro_device_dump (dc_device_t *abstract, dc_buffer_t *buffer)
 			return status;
 		}
 
+		// Update the checksum, while the data is still in the cache.
+		// The trailing crc bytes are not included.
+		unsigned int n = len;
+		if (nbytes + n > SZ_MEMORY)
+			n = nbytes < SZ_MEMORY ? SZ_MEMORY - nbytes : 0;
+		ccrc = checksum_crc_ccitt_uint16_update (ccrc, answer + nbytes, n);
+
 		// Update and emit a progress event.
 		progress.current += len;
 		device_event_emit (abstract, DC_EVENT_PROGRESS, &progress);
@@ -299,7 +310,6 @@ reefnet_sensuspro_device_dump (dc_device_t *abstract, dc_buffer_t *buffer)
 	}
 
 	unsigned short crc = array_uint16_le (answer + SZ_MEMORY);
-	unsigned short ccrc = checksum_crc_ccitt_uint16 (answer, SZ_MEMORY);
 	if (crc != ccrc) {
 		ERROR (abstract->context, "Unexpected answer checksum.");
 		return DC_STATUS_PROTOCOL;
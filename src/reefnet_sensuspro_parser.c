@@ -52,7 +52,7 @@ static dc_status_t reefnet_sensuspro_parser_get_datetime (dc_parser_t *abstract,
 static dc_status_t reefnet_sensuspro_parser_get_field (dc_parser_t *abstract, dc_field_type_t type, unsigned int flags, void *value);
 static dc_status_t reefnet_sensuspro_parser_samples_foreach (dc_parser_t *abstract, dc_sample_callback_t callback, void *userdata);
 
-static const dc_parser_vtable_t reefnet_sensuspro_parser_vtable = {
+DC_VTABLE_STORAGE const dc_parser_vtable_t reefnet_sensuspro_parser_vtable = {
 	sizeof(reefnet_sensuspro_parser_t),
 	DC_FAMILY_REEFNET_SENSUSPRO,
 	reefnet_sensuspro_parser_set_data, /* set_data */
@@ -157,21 +157,12 @@ reefnet_sensuspro_parser_get_field (dc_parser_t *abstract, dc_field_type_t type,
 
 		unsigned int interval = array_uint16_le (data + 4);
 
-		unsigned int maxdepth = 0;
+		// Scan the depth column of the samples, up to the footer, with
+		// the shared column scan.
 		unsigned int nsamples = 0;
-		unsigned int offset = 10;
-		while (offset + sizeof (footer) <= size &&
-			memcmp (data + offset, footer, sizeof (footer)) != 0)
-		{
-			unsigned int value = array_uint16_le (data + offset);
-			unsigned int depth = (value & 0x01FF);
-			if (depth > maxdepth)
-				maxdepth = depth;
-
-			nsamples++;
-
-			offset += 2;
-		}
+		unsigned int maxdepth = array_scan_uint16_le (data + 10,
+			(size - 10) / 2, 2, 0x01FF, 0, array_uint16_le (footer),
+			&nsamples, NULL);
 
 		parser->cached = 1;
 		parser->divetime = nsamples * interval;
@@ -237,7 +228,7 @@ reefnet_sensuspro_parser_samples_foreach (dc_parser_t *abstract, dc_sample_callb
 				if (callback) callback (DC_SAMPLE_TIME, sample, userdata);
 
 				// Temperature (°F)
-				sample.temperature = (temperature - 32.0) * (5.0 / 9.0);
+				sample.temperature = FAHRENHEIT_TO_CELSIUS (temperature);
 				if (callback) callback (DC_SAMPLE_TEMPERATURE, sample, userdata);
 
 				// Depth (absolute pressure in fsw)
@@ -52,7 +52,7 @@ static dc_status_t reefnet_sensusultra_parser_get_datetime (dc_parser_t *abstrac
 static dc_status_t reefnet_sensusultra_parser_get_field (dc_parser_t *abstract, dc_field_type_t type, unsigned int flags, void *value);
 static dc_status_t reefnet_sensusultra_parser_samples_foreach (dc_parser_t *abstract, dc_sample_callback_t callback, void *userdata);
 
-static const dc_parser_vtable_t reefnet_sensusultra_parser_vtable = {
+DC_VTABLE_STORAGE const dc_parser_vtable_t reefnet_sensusultra_parser_vtable = {
 	sizeof(reefnet_sensusultra_parser_t),
 	DC_FAMILY_REEFNET_SENSUSULTRA,
 	reefnet_sensusultra_parser_set_data, /* set_data */
@@ -235,12 +235,12 @@ reefnet_sensusultra_parser_samples_foreach (dc_parser_t *abstract, dc_sample_cal
 
 				// Temperature (0.01 °K)
 				unsigned int temperature = array_uint16_le (data + offset);
-				sample.temperature = temperature / 100.0 - 273.15;
+				sample.temperature = array_scale (temperature, 1, 100) - 273.15;
 				if (callback) callback (DC_SAMPLE_TEMPERATURE, sample, userdata);
 
 				// Depth (absolute pressure in millibar)
 				unsigned int depth = array_uint16_le (data + offset + 2);
-				sample.depth = (depth * BAR / 1000.0 - parser->atmospheric) / parser->hydrostatic;
+				sample.depth = (array_scale (depth, BAR, 1000) - parser->atmospheric) / parser->hydrostatic;
 				if (callback) callback (DC_SAMPLE_DEPTH, sample, userdata);
 
 				offset += 4;
@@ -27,6 +27,11 @@
 static unsigned int
 normalize (unsigned int a, unsigned int size)
 {
+	// Most ringbuffer layouts have a power of two size, for which the
+	// modulo operation reduces to a bitwise mask.
+	if ((size & (size - 1)) == 0)
+		return a & (size - 1);
+
 	return a % size;
 }
 
@@ -35,9 +40,9 @@ static unsigned int
 distance (unsigned int a, unsigned int b, int mode, unsigned int size)
 {
 	if (a < b) {
-		return (b - a) % size;
+		return normalize (b - a, size);
 	} else if (a > b) {
-		return size - (a - b) % size;
+		return size - normalize (a - b, size);
 	} else {
 		return (mode == 0 ? 0 : size);
 	}
@@ -47,7 +52,7 @@ distance (unsigned int a, unsigned int b, int mode, unsigned int size)
 static unsigned int
 increment (unsigned int a, unsigned int delta, unsigned int size)
 {
-	return (a + delta) % size;
+	return normalize (a + delta, size);
 }
 
 
@@ -55,9 +60,9 @@ static unsigned int
 decrement (unsigned int a, unsigned int delta, unsigned int size)
 {
 	if (delta <= a) {
-		return (a - delta) % size;
+		return normalize (a - delta, size);
 	} else {
-		return size - (delta - a) % size;
+		return size - normalize (delta - a, size);
 	}
 }
 
@@ -68,7 +73,11 @@ ringbuffer_normalize (unsigned int a, unsigned int begin, unsigned int end)
 	assert (end >= begin);
 	assert (a >= begin);
 
-	return normalize (a, end - begin);
+	// An empty ringbuffer contains no addresses.
+	if (end == begin)
+		return begin;
+
+	return normalize (a - begin, end - begin) + begin;
 }
 
 
@@ -78,6 +87,10 @@ ringbuffer_distance (unsigned int a, unsigned int b, int mode, unsigned int begi
 	assert (end >= begin);
 	assert (a >= begin);
 
+	// An empty ringbuffer contains no addresses.
+	if (end == begin)
+		return 0;
+
 	return distance (a, b, mode, end - begin);
 }
 
@@ -88,6 +101,10 @@ ringbuffer_increment (unsigned int a, unsigned int delta, unsigned int begin, un
 	assert (end >= begin);
 	assert (a >= begin);
 
+	// An empty ringbuffer contains no addresses.
+	if (end == begin)
+		return begin;
+
 	return increment (a - begin, delta, end - begin) + begin;
 }
 
@@ -98,5 +115,9 @@ ringbuffer_decrement (unsigned int a, unsigned int delta, unsigned int begin, un
 	assert (end >= begin);
 	assert (a >= begin);
 
+	// An empty ringbuffer contains no addresses.
+	if (end == begin)
+		return begin;
+
 	return decrement (a - begin, delta, end - begin) + begin;
 }
@@ -24,6 +24,7 @@
 
 #include <libdivecomputer/common.h>
 #include <libdivecomputer/context.h>
+#include <libdivecomputer/device.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -101,6 +102,23 @@ typedef void (*dc_serial_callback_t) (const char *name, void *userdata);
 dc_status_t
 dc_serial_enumerate (dc_serial_callback_t callback, void *userdata);
 
+/**
+ * Enumerate the serial ports, using a cached result when available.
+ *
+ * The result of the previous enumeration is cached, and invalidated
+ * through a filesystem change notification, so polling for new ports
+ * does not cost a directory scan per call. On platforms without a
+ * change notification mechanism, every call re-scans, exactly like
+ * dc_serial_enumerate.
+ *
+ * @param[in]  callback  The callback function to call.
+ * @param[in]  userdata  User data to pass to the callback function.
+ * @returns #DC_STATUS_SUCCESS on success, or another #dc_status_t code
+ * on failure.
+ */
+dc_status_t
+dc_serial_enumerate_cached (dc_serial_callback_t callback, void *userdata);
+
 /**
  * Open a serial connection.
  *
@@ -169,6 +187,27 @@ dc_serial_configure (dc_serial_t *serial, unsigned int baudrate, unsigned int da
 dc_status_t
 dc_serial_set_timeout (dc_serial_t *serial, int timeout);
 
+/**
+ * Set the state of the adaptive timeout mode.
+ *
+ * In adaptive mode, the read operation keeps track of the observed
+ * inter-byte latency of the connection. Once the first byte of a
+ * transfer has arrived, the remaining bytes are waited for with a
+ * multiple of that estimate, instead of the full timeout. The timeout
+ * configured with dc_serial_set_timeout() remains the hard upper
+ * bound. This can reduce the time spent waiting on short reads
+ * considerably, but should only be enabled for protocols where a
+ * partial packet is recoverable (e.g. protected by a checksum and
+ * retried).
+ *
+ * @param[in]  serial  A valid serial connection.
+ * @param[in]  value   The adaptive timeout state.
+ * @returns #DC_STATUS_SUCCESS on success, or another #dc_status_t code
+ * on failure.
+ */
+dc_status_t
+dc_serial_set_timeout_adaptive (dc_serial_t *serial, unsigned int value);
+
 /**
  * Set the state of the half duplex emulation.
  *
@@ -177,6 +216,47 @@ dc_serial_set_timeout (dc_serial_t *serial, int timeout);
  * @returns #DC_STATUS_SUCCESS on success, or another #dc_status_t code
  * on failure.
  */
+/**
+ * Register a cancellation callback.
+ *
+ * While a read operation is waiting for incoming data, the callback is
+ * polled at least every 50 milliseconds. When the callback returns a
+ * non-zero value, the read is abandoned and returns
+ * #DC_STATUS_CANCELLED, regardless of the configured timeout. This
+ * bounds the cancellation latency of a blocked transfer, instead of
+ * having to wait for the full timeout to expire.
+ *
+ * @param[in]  serial    A valid serial connection.
+ * @param[in]  callback  The cancellation callback, or NULL to remove a
+ *                       previously registered callback.
+ * @param[in]  userdata  User data passed to the callback.
+ * @returns #DC_STATUS_SUCCESS on success, or another #dc_status_t code
+ * on failure.
+ */
+dc_status_t
+dc_serial_set_cancel (dc_serial_t *serial, dc_cancel_callback_t callback, void *userdata);
+
+/**
+ * Register a transfer scheduler callback.
+ *
+ * The callback is invoked before every read and write operation, with
+ * the transfer classified as a control exchange or a bulk transfer by
+ * comparing its size against the threshold (see
+ * dc_context_set_scheduler). A newly opened connection inherits the
+ * scheduler registered on the context; this function overrides it for
+ * an individual connection.
+ *
+ * @param[in]  serial     A valid serial connection.
+ * @param[in]  callback   The scheduler callback, or NULL to remove a
+ *                        previously registered callback.
+ * @param[in]  userdata   User data passed to the callback.
+ * @param[in]  threshold  The classification threshold in bytes.
+ * @returns #DC_STATUS_SUCCESS on success, or another #dc_status_t code
+ * on failure.
+ */
+dc_status_t
+dc_serial_set_scheduler (dc_serial_t *serial, dc_scheduler_callback_t callback, void *userdata, size_t threshold);
+
 dc_status_t
 dc_serial_set_halfduplex (dc_serial_t *serial, unsigned int value);
 
@@ -303,6 +383,20 @@ dc_serial_get_available (dc_serial_t *serial, size_t *value);
 dc_status_t
 dc_serial_get_lines (dc_serial_t *serial, unsigned int *value);
 
+/**
+ * Query whether the connection was revived from the keepalive cache
+ * (see dc_context_set_keepalive), instead of opened from scratch. A
+ * warm connection is already configured and powered, so backends can
+ * skip their settle delays.
+ *
+ * @param[in]   serial  A valid serial connection.
+ * @param[out]  value   A location to store the warm state.
+ * @returns #DC_STATUS_SUCCESS on success, or another #dc_status_t code
+ * on failure.
+ */
+dc_status_t
+dc_serial_get_warm (dc_serial_t *serial, unsigned int *value);
+
 /**
  * Suspend execution of the current thread for the specified amount of
  * time.
@@ -315,6 +409,21 @@ dc_serial_get_lines (dc_serial_t *serial, unsigned int *value);
 dc_status_t
 dc_serial_sleep (dc_serial_t *serial, unsigned int milliseconds);
 
+/**
+ * Query the transfer statistics of the connection.
+ *
+ * The retries field is not known to the transport layer, and is left
+ * zero. Backends that count their retransmissions can fill it in
+ * before emitting the #DC_EVENT_METRICS event.
+ *
+ * @param[in]   serial   A valid serial connection.
+ * @param[out]  metrics  A location to store the transfer statistics.
+ * @returns #DC_STATUS_SUCCESS on success, or another #dc_status_t code
+ * on failure.
+ */
+dc_status_t
+dc_serial_get_metrics (dc_serial_t *serial, dc_event_metrics_t *metrics);
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
@@ -30,6 +30,7 @@
 #include <fcntl.h>	// fcntl
 #include <termios.h>	// tcgetattr, tcsetattr, cfsetispeed, cfsetospeed, tcflush, tcsendbreak
 #include <sys/ioctl.h>	// ioctl
+#include <limits.h>	// PATH_MAX
 #include <sys/time.h>	// gettimeofday
 #include <time.h>	// nanosleep
 #ifdef HAVE_LINUX_SERIAL_H
@@ -42,6 +43,13 @@
 #include <sys/types.h>
 #include <dirent.h>
 #include <fnmatch.h>
+#include <pthread.h>
+#ifdef HAVE_SYS_INOTIFY_H
+#include <sys/inotify.h>
+#endif
+#ifdef HAVE_LIBUSB
+#include <libusb-1.0/libusb.h>
+#endif
 
 #ifndef TIOCINQ
 #define TIOCINQ FIONREAD
@@ -53,6 +61,18 @@
 #define NOPTY 1
 #endif
 
+// The safety margin applied to the estimated inter-byte latency, and
+// the lower bound (in microseconds) for the resulting timeout. The
+// lower bound absorbs the batching of usb-serial adapters, which
+// deliver data in chunks of up to 16 milliseconds.
+#define ADAPTIVE_FACTOR 4
+#define ADAPTIVE_MINIMUM 20000
+
+// The polling interval (in milliseconds) for the cancellation
+// callback while a read is waiting for incoming data. This bounds the
+// cancellation latency of a blocked transfer.
+#define CANCEL_TIMESLICE 50
+
 #include "serial.h"
 #include "common-private.h"
 #include "context-private.h"
@@ -65,6 +85,31 @@ struct dc_serial_t {
 	 */
 	int fd;
 	int timeout;
+	/*
+	 * Adaptive timeout mode. When enabled, the read operation keeps
+	 * track of the observed inter-byte latency (as an exponentially
+	 * weighted moving average in microseconds), and uses a multiple
+	 * of that estimate, instead of the full timeout, to wait for the
+	 * remaining bytes once the first byte of a transfer has arrived.
+	 */
+	int adaptive;
+	unsigned long latency;
+	/*
+	 * Cancellation support. While a read is waiting for data, the
+	 * callback is polled every CANCEL_TIMESLICE milliseconds, so a
+	 * cancellation request interrupts the read long before the
+	 * configured timeout expires.
+	 */
+	dc_cancel_callback_t cancel_callback;
+	void *cancel_userdata;
+	/*
+	 * Transfer scheduler support, see dc_serial_set_scheduler. The
+	 * callback is invoked before every transfer, classified as a
+	 * control exchange or a bulk transfer by its size.
+	 */
+	dc_scheduler_callback_t scheduler_callback;
+	void *scheduler_userdata;
+	size_t scheduler_threshold;
 	/*
 	 * Serial port settings are saved into this variable immediately
 	 * after the port is opened. These settings are restored when the
@@ -75,6 +120,62 @@ struct dc_serial_t {
 	int halfduplex;
 	unsigned int baudrate;
 	unsigned int nbits;
+	/*
+	 * Keepalive support. The device name is remembered so a closed
+	 * port can be parked and matched on a subsequent open. The warm
+	 * flag marks a port that was revived from the parking slot.
+	 */
+	char *name;
+	int warm;
+	/* Transfer statistics */
+	dc_event_metrics_t metrics;
+#ifdef HAVE_LIBUSB
+	/*
+	 * FTDI bypass. When the port is opened with the "ftdi:" prefix,
+	 * the usb-serial chip is driven directly over usb, instead of
+	 * through the kernel tty layer. This allows reducing the latency
+	 * timer of the chip to its minimum, and sizing the usb transfers
+	 * to the protocol packets.
+	 */
+	struct dc_serial_ftdi_t *ftdi;
+#endif
+#ifdef ENABLE_TRACE
+	/*
+	 * Trace support. In record mode, all traffic is appended to a
+	 * compact binary trace, with the time elapsed since the previous
+	 * record. In replay mode, the input records of an earlier trace
+	 * are served back to the backend, and the output records are
+	 * skipped, so a download can be reproduced without the device
+	 * attached.
+	 */
+	FILE *trace;
+	int replay;
+	int timing;
+	struct timeval tlast;
+	/* The current replay record. */
+	unsigned int rdir;
+	unsigned int rdelay;
+	size_t rsize;
+	/*
+	 * Replay speed (as a percentage of the recorded timing) and
+	 * error injection rate (one corrupted byte per 'fuzz' replayed
+	 * input bytes, on average).
+	 */
+	unsigned int speed;
+	unsigned int fuzz;
+	unsigned int seed;
+	/*
+	 * I/O timeline. When enabled, the submission and completion time
+	 * of every read and write is captured with a monotonic clock into
+	 * a preallocated ring buffer, and logged when the port is closed.
+	 * Unlike the trace file, which only records the completed
+	 * transfers, the timeline separates the time spent waiting for
+	 * the device from the time spent in the host between transfers.
+	 */
+	struct dc_serial_iostat_t *iostats;
+	unsigned int iostats_size;
+	unsigned int iostats_count;
+#endif
 };
 
 static dc_status_t
@@ -95,6 +196,844 @@ syserror(int errcode)
 	}
 }
 
+/*
+ * Parking slot for the keepalive mode (see dc_context_set_keepalive).
+ * Closing a port parks it here, still open and configured, and a
+ * subsequent open of the same name revives it. Holding a single port
+ * is sufficient, because the keepalive mode targets repeated sessions
+ * on the same physical device.
+ */
+static struct {
+	pthread_mutex_t mutex;
+	dc_serial_t *device;
+} g_serial_park = {PTHREAD_MUTEX_INITIALIZER, NULL};
+
+static void
+dc_serial_destroy (dc_serial_t *device)
+{
+	// Close the port for real, restoring the terminal attributes.
+	tcsetattr (device->fd, TCSANOW, &device->tty);
+#ifndef ENABLE_PTY
+	ioctl (device->fd, TIOCNXCL, NULL);
+#endif
+	close (device->fd);
+	free (device->name);
+	free (device);
+}
+
+static void
+dc_serial_park_put (dc_serial_t *device)
+{
+	pthread_mutex_lock (&g_serial_park.mutex);
+	dc_serial_t *previous = g_serial_park.device;
+	g_serial_park.device = device;
+	pthread_mutex_unlock (&g_serial_park.mutex);
+
+	// Evict the previously parked port.
+	if (previous)
+		dc_serial_destroy (previous);
+}
+
+static dc_serial_t *
+dc_serial_park_take (const char *name)
+{
+	dc_serial_t *device = NULL;
+
+	pthread_mutex_lock (&g_serial_park.mutex);
+	if (g_serial_park.device &&
+		strcmp (g_serial_park.device->name, name) == 0) {
+		device = g_serial_park.device;
+		g_serial_park.device = NULL;
+	}
+	pthread_mutex_unlock (&g_serial_park.mutex);
+
+	return device;
+}
+
+static int
+dc_serial_transmitter_empty (dc_serial_t *device)
+{
+	// Report whether the transmitter is physically empty: 1 if all
+	// data has left the wire, 0 if a transmission is still pending,
+	// and -1 if the driver cannot report the transmitter state.
+#if defined(TIOCSERGETLSR) && defined(TIOCSER_TEMT)
+#ifdef TIOCOUTQ
+	// Bytes still queued in the output buffer of the driver?
+	int pending = 0;
+	if (ioctl (device->fd, TIOCOUTQ, &pending) == 0 && pending > 0)
+		return 0;
+#endif
+	// The TEMT bit of the line status register is set once both the
+	// transmit holding and shift register of the uart are empty.
+	int lsr = 0;
+	if (ioctl (device->fd, TIOCSERGETLSR, &lsr) == 0)
+		return (lsr & TIOCSER_TEMT) != 0;
+#endif
+	return -1;
+}
+
+#ifdef ENABLE_TRACE
+
+#define TRACE_MAGIC   "DCTR"
+#define TRACE_VERSION 1
+
+#define TRACE_INPUT  0
+#define TRACE_OUTPUT 1
+
+static void
+dc_serial_trace_record (dc_serial_t *device, unsigned int direction, const unsigned char data[], size_t size)
+{
+	if (device->trace == NULL || device->replay || size == 0)
+		return;
+
+	struct timeval now, tvd;
+	timerclear (&tvd);
+	if (gettimeofday (&now, NULL) == 0) {
+		timersub (&now, &device->tlast, &tvd);
+		device->tlast = now;
+	}
+	unsigned long delta = tvd.tv_sec * 1000000 + tvd.tv_usec;
+
+	unsigned char header[9];
+	header[0] = direction;
+	header[1] = (delta      ) & 0xFF;
+	header[2] = (delta >>  8) & 0xFF;
+	header[3] = (delta >> 16) & 0xFF;
+	header[4] = (delta >> 24) & 0xFF;
+	header[5] = (size       ) & 0xFF;
+	header[6] = (size  >>  8) & 0xFF;
+	header[7] = (size  >> 16) & 0xFF;
+	header[8] = (size  >> 24) & 0xFF;
+
+	if (fwrite (header, 1, sizeof (header), device->trace) != sizeof (header) ||
+		fwrite (data, 1, size, device->trace) != size) {
+		WARNING (device->context, "Failed to write the trace record.");
+	}
+}
+
+// The default capacity of the I/O timeline ring buffer.
+#define IOSTATS_SIZE 4096
+
+typedef struct dc_serial_iostat_t {
+	unsigned char direction;
+	size_t size;
+	/* Submission and completion time (nanoseconds, monotonic). */
+	unsigned long long begin;
+	unsigned long long end;
+} dc_serial_iostat_t;
+
+static void
+dc_serial_iostat_record (dc_serial_t *device, unsigned int direction, size_t size, unsigned long long begin, unsigned long long end)
+{
+	dc_serial_iostat_t *entry = device->iostats +
+		(device->iostats_count % device->iostats_size);
+
+	entry->direction = direction;
+	entry->size = size;
+	entry->begin = begin;
+	entry->end = end;
+
+	device->iostats_count++;
+}
+
+static void
+dc_serial_iostat_dump (dc_serial_t *device)
+{
+	if (device->iostats == NULL || device->iostats_count == 0)
+		return;
+
+	// When the ring buffer has wrapped around, the oldest records
+	// have been overwritten and only the most recent ones remain.
+	unsigned int count = device->iostats_count;
+	if (count > device->iostats_size) {
+		WARNING (device->context, "I/O timeline dropped %u records.",
+			count - device->iostats_size);
+		count = device->iostats_size;
+	}
+	unsigned int first = device->iostats_count - count;
+
+	unsigned long long origin = device->iostats[first % device->iostats_size].begin;
+	unsigned long long last = origin;
+	unsigned long long busy[2] = {0, 0}, bytes[2] = {0, 0};
+	unsigned int ncalls[2] = {0, 0};
+
+	for (unsigned int i = 0; i < count; ++i) {
+		const dc_serial_iostat_t *entry = device->iostats +
+			((first + i) % device->iostats_size);
+		unsigned int dir = entry->direction != TRACE_INPUT;
+
+		busy[dir] += entry->end - entry->begin;
+		bytes[dir] += entry->size;
+		ncalls[dir]++;
+		last = entry->end;
+
+		INFO (device->context, "I/O timeline: %s at %llu us, duration %llu us, %lu bytes",
+			dir ? "write" : "read",
+			(entry->begin - origin) / 1000,
+			(entry->end - entry->begin) / 1000,
+			(unsigned long) entry->size);
+	}
+
+	unsigned long long elapsed = last - origin;
+	INFO (device->context, "I/O timeline: %u reads, %llu bytes, busy %llu us",
+		ncalls[0], bytes[0], busy[0] / 1000);
+	INFO (device->context, "I/O timeline: %u writes, %llu bytes, busy %llu us",
+		ncalls[1], bytes[1], busy[1] / 1000);
+	INFO (device->context, "I/O timeline: %llu us elapsed, %llu us outside I/O",
+		elapsed / 1000, (elapsed - busy[0] - busy[1]) / 1000);
+}
+
+static dc_status_t
+dc_serial_replay_read (dc_serial_t *device, unsigned char *data, size_t size, size_t *actual)
+{
+	dc_status_t status = DC_STATUS_SUCCESS;
+	size_t nbytes = 0;
+
+	while (nbytes < size) {
+		// Advance to the next input record.
+		while (device->rsize == 0 || device->rdir != TRACE_INPUT) {
+			if (device->rsize) {
+				// Skip the payload of an output record.
+				if (fseek (device->trace, device->rsize, SEEK_CUR) != 0) {
+					status = DC_STATUS_IO;
+					goto out;
+				}
+				device->rsize = 0;
+			}
+
+			unsigned char header[9];
+			if (fread (header, 1, sizeof (header), device->trace) != sizeof (header)) {
+				goto done; // End of the trace.
+			}
+
+			device->rdir = header[0];
+			device->rdelay = header[1] | (header[2] << 8) | (header[3] << 16) | ((unsigned int) header[4] << 24);
+			device->rsize = header[5] | (header[6] << 8) | (header[7] << 16) | ((size_t) header[8] << 24);
+
+			// Reproduce the recorded timing, scaled by the replay
+			// speed.
+			if (device->timing && device->rdir == TRACE_INPUT && device->rdelay) {
+				unsigned long long delay = (unsigned long long) device->rdelay * device->speed / 100;
+				struct timespec ts;
+				ts.tv_sec  = delay / 1000000;
+				ts.tv_nsec = (delay % 1000000) * 1000;
+				while (nanosleep (&ts, &ts) != 0 && errno == EINTR)
+					; // Retry.
+			}
+		}
+
+		size_t length = device->rsize;
+		if (length > size - nbytes)
+			length = size - nbytes;
+
+		if (fread (data + nbytes, 1, length, device->trace) != length) {
+			status = DC_STATUS_IO;
+			goto out;
+		}
+
+		// Inject transmission errors.
+		if (device->fuzz) {
+			for (size_t i = 0; i < length; ++i) {
+				if (rand_r (&device->seed) % device->fuzz == 0)
+					data[nbytes + i] ^= 1 << (rand_r (&device->seed) % 8);
+			}
+		}
+
+		device->rsize -= length;
+		nbytes += length;
+	}
+
+done:
+	if (nbytes != size) {
+		status = DC_STATUS_TIMEOUT;
+	}
+
+out:
+	HEXDUMP (device->context, DC_LOGLEVEL_INFO, "Read", data, nbytes);
+
+	if (actual)
+		*actual = nbytes;
+
+	return status;
+}
+
+#endif /* ENABLE_TRACE */
+
+#ifdef HAVE_LIBUSB
+
+#define C_ARRAY_SIZE(array) (sizeof (array) / sizeof *(array))
+
+// The vendor specific requests of the FTDI usb-serial chips. The
+// requests are directed to the device, with the channel number (one
+// based) in the index field.
+#define SIO_RESET		0x00
+#define SIO_SET_MODEM_CTRL	0x01
+#define SIO_SET_FLOW_CTRL	0x02
+#define SIO_SET_BAUDRATE	0x03
+#define SIO_SET_DATA		0x04
+#define SIO_GET_MODEM_STATUS	0x05
+#define SIO_SET_LATENCY_TIMER	0x09
+
+#define SIO_RESET_SIO		0
+#define SIO_RESET_PURGE_RX	1
+#define SIO_RESET_PURGE_TX	2
+
+#define SIO_SET_DTR_HIGH	0x0101
+#define SIO_SET_DTR_LOW		0x0100
+#define SIO_SET_RTS_HIGH	0x0202
+#define SIO_SET_RTS_LOW		0x0200
+
+#define SIO_DISABLE_FLOW_CTRL	0x0000
+#define SIO_RTS_CTS_HS		0x0100
+#define SIO_XON_XOFF_HS		0x0400
+
+#define SIO_BREAK_ON		0x4000
+
+// The modem status bits in the header of the incoming bulk packets.
+#define FTDI_STATUS_CTS		0x10
+#define FTDI_STATUS_DSR		0x20
+#define FTDI_STATUS_RI		0x40
+#define FTDI_STATUS_RLSD	0x80
+
+// The size of the modem status header, and the largest packet size
+// among the supported chip generations.
+#define FTDI_HEADER		2
+#define FTDI_PACKET		512
+
+#define FTDI_TIMEOUT		1000
+
+#define FTDI_EXITCODE(rc) (rc == LIBUSB_ERROR_TIMEOUT ? DC_STATUS_TIMEOUT : DC_STATUS_IO)
+
+// The known FTDI based interface cables. The first entries are the
+// default FTDI product ids, the remainder are cables re-programmed
+// with a vendor specific product id.
+static const struct dc_serial_ftdi_id_t {
+	unsigned int vid;
+	unsigned int pid;
+} dc_serial_ftdi_ids[] = {
+	{0x0403, 0x6001}, // FT232
+	{0x0403, 0x6015}, // FT231X
+	{0x0403, 0xF460}, // Oceanic
+	{0x0403, 0xF680}, // Suunto
+	{0x0403, 0x87D0}, // Cressi
+};
+
+typedef struct dc_serial_ftdi_t {
+	libusb_context *usb;
+	libusb_device_handle *handle;
+	int interface;
+	unsigned char endpoint_in;
+	unsigned char endpoint_out;
+	unsigned int maxpacket;
+	/*
+	 * The value of the last SIO_SET_DATA request, to be able to
+	 * toggle the break bit without disturbing the line settings.
+	 */
+	unsigned int lineparams;
+	/*
+	 * Payload bytes received from the chip, but not yet consumed by
+	 * the backend. Every bulk transfer is sized to a single usb
+	 * packet, so at most one packet needs to be buffered.
+	 */
+	unsigned char cache[FTDI_PACKET];
+	size_t available;
+	size_t offset;
+} dc_serial_ftdi_t;
+
+static dc_status_t
+dc_serial_ftdi_control (dc_serial_t *device, unsigned char request, unsigned int value, unsigned int index)
+{
+	dc_serial_ftdi_t *ftdi = device->ftdi;
+
+	int rc = libusb_control_transfer (ftdi->handle,
+		LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE | LIBUSB_ENDPOINT_OUT,
+		request, value, index, NULL, 0, FTDI_TIMEOUT);
+	if (rc < 0) {
+		ERROR (device->context, "Failed to send the vendor request (%s).",
+			libusb_error_name (rc));
+		return FTDI_EXITCODE(rc);
+	}
+
+	return DC_STATUS_SUCCESS;
+}
+
+static dc_status_t
+dc_serial_ftdi_set_baudrate (dc_serial_t *device, unsigned int baudrate)
+{
+	// The chip generates the baudrate from a 3 MHz reference clock
+	// and a divisor with a resolution of 1/8, encoded as a 14 bit
+	// integer part and a 3 bit code for the fractional part. The two
+	// highest rates have a dedicated encoding.
+	static const unsigned char fraction[8] = {0, 3, 2, 4, 1, 5, 6, 7};
+
+	if (baudrate == 0)
+		return DC_STATUS_INVALIDARGS;
+
+	unsigned int divisor = (8 * 3000000 + baudrate / 2) / baudrate;
+
+	unsigned int value = 0, index = 0;
+	if (divisor == 8) {
+		value = 0; // 3 MBaud
+	} else if (divisor == 12) {
+		value = 1; // 2 MBaud
+	} else {
+		unsigned int code = fraction[divisor & 7];
+		value = (divisor >> 3) | ((code & 3) << 14);
+		index = code >> 2;
+	}
+
+	return dc_serial_ftdi_control (device, SIO_SET_BAUDRATE, value, index);
+}
+
+static dc_status_t
+dc_serial_ftdi_open (dc_serial_t *device, const char *name)
+{
+	dc_status_t status = DC_STATUS_SUCCESS;
+	dc_context_t *context = device->context;
+
+	// An explicit vendor and product id (in hexadecimal) overrides
+	// the builtin list of known cables.
+	unsigned int vid = 0, pid = 0;
+	if (*name && sscanf (name, "%x:%x", &vid, &pid) != 2) {
+		ERROR (context, "Invalid FTDI device address (%s).", name);
+		return DC_STATUS_INVALIDARGS;
+	}
+
+	// Allocate memory.
+	dc_serial_ftdi_t *ftdi = (dc_serial_ftdi_t *) malloc (sizeof (dc_serial_ftdi_t));
+	if (ftdi == NULL) {
+		SYSERROR (context, ENOMEM);
+		return DC_STATUS_NOMEMORY;
+	}
+
+	ftdi->usb = NULL;
+	ftdi->handle = NULL;
+	ftdi->interface = 0;
+	ftdi->endpoint_in = 0x81;
+	ftdi->endpoint_out = 0x02;
+	ftdi->maxpacket = 64;
+	ftdi->lineparams = 0;
+	ftdi->available = 0;
+	ftdi->offset = 0;
+
+	int rc = libusb_init (&ftdi->usb);
+	if (rc < 0) {
+		ERROR (context, "Failed to initialize usb support.");
+		status = DC_STATUS_IO;
+		goto error_free;
+	}
+
+	// Find the first matching device.
+	libusb_device **devices = NULL;
+	ssize_t ndevices = libusb_get_device_list (ftdi->usb, &devices);
+	if (ndevices < 0) {
+		ERROR (context, "Failed to enumerate the usb devices.");
+		status = DC_STATUS_IO;
+		goto error_usb_exit;
+	}
+
+	libusb_device *current = NULL;
+	for (ssize_t i = 0; i < ndevices && current == NULL; ++i) {
+		struct libusb_device_descriptor desc;
+		if (libusb_get_device_descriptor (devices[i], &desc) < 0)
+			continue;
+
+		if (vid || pid) {
+			if (desc.idVendor == vid && desc.idProduct == pid)
+				current = devices[i];
+		} else {
+			for (size_t j = 0; j < C_ARRAY_SIZE(dc_serial_ftdi_ids); ++j) {
+				if (desc.idVendor == dc_serial_ftdi_ids[j].vid &&
+					desc.idProduct == dc_serial_ftdi_ids[j].pid) {
+					current = devices[i];
+					break;
+				}
+			}
+		}
+	}
+
+	if (current == NULL) {
+		ERROR (context, "No FTDI device found.");
+		libusb_free_device_list (devices, 1);
+		status = DC_STATUS_NODEVICE;
+		goto error_usb_exit;
+	}
+
+	// The bulk endpoints of the first channel are fixed, but the
+	// packet size varies with the chip generation.
+	int maxpacket = libusb_get_max_packet_size (current, ftdi->endpoint_in);
+	if (maxpacket > FTDI_HEADER && maxpacket <= FTDI_PACKET)
+		ftdi->maxpacket = maxpacket;
+
+	rc = libusb_open (current, &ftdi->handle);
+	libusb_free_device_list (devices, 1);
+	if (rc < 0) {
+		ERROR (context, "Failed to open the usb device (%s).",
+			libusb_error_name (rc));
+		status = FTDI_EXITCODE(rc);
+		goto error_usb_exit;
+	}
+
+	// Temporarily detach the kernel usb-serial driver, if active.
+	libusb_set_auto_detach_kernel_driver (ftdi->handle, 1);
+
+	rc = libusb_claim_interface (ftdi->handle, ftdi->interface);
+	if (rc < 0) {
+		ERROR (context, "Failed to claim the usb interface (%s).",
+			libusb_error_name (rc));
+		status = FTDI_EXITCODE(rc);
+		goto error_usb_close;
+	}
+
+	device->ftdi = ftdi;
+
+	// Reset the chip and discard any buffered data.
+	status = dc_serial_ftdi_control (device, SIO_RESET, SIO_RESET_SIO, ftdi->interface + 1);
+	if (status != DC_STATUS_SUCCESS)
+		goto error_usb_release;
+
+	// Reduce the latency timer from its 16 ms default to the 1 ms
+	// minimum. The timer flushes the receive buffer of the chip to
+	// the host when it expires, and dominates the round trip time of
+	// the short request/response exchanges of the legacy protocols.
+	status = dc_serial_ftdi_control (device, SIO_SET_LATENCY_TIMER, 1, ftdi->interface + 1);
+	if (status != DC_STATUS_SUCCESS)
+		goto error_usb_release;
+
+	return DC_STATUS_SUCCESS;
+
+error_usb_release:
+	libusb_release_interface (ftdi->handle, ftdi->interface);
+	device->ftdi = NULL;
+error_usb_close:
+	libusb_close (ftdi->handle);
+error_usb_exit:
+	libusb_exit (ftdi->usb);
+error_free:
+	free (ftdi);
+	return status;
+}
+
+static dc_status_t
+dc_serial_ftdi_close (dc_serial_t *device)
+{
+	dc_serial_ftdi_t *ftdi = device->ftdi;
+
+	libusb_release_interface (ftdi->handle, ftdi->interface);
+	libusb_close (ftdi->handle);
+	libusb_exit (ftdi->usb);
+	free (ftdi);
+
+	return DC_STATUS_SUCCESS;
+}
+
+static dc_status_t
+dc_serial_ftdi_configure (dc_serial_t *device, unsigned int baudrate, unsigned int databits, dc_parity_t parity, dc_stopbits_t stopbits, dc_flowcontrol_t flowcontrol)
+{
+	dc_status_t status = DC_STATUS_SUCCESS;
+	dc_serial_ftdi_t *ftdi = device->ftdi;
+
+	// Set the baud rate.
+	status = dc_serial_ftdi_set_baudrate (device, baudrate);
+	if (status != DC_STATUS_SUCCESS)
+		return status;
+
+	// Encode the line parameters.
+	unsigned int value = 0;
+	switch (databits) {
+	case 7:
+	case 8:
+		value |= databits;
+		break;
+	default:
+		return DC_STATUS_INVALIDARGS;
+	}
+
+	switch (parity) {
+	case DC_PARITY_NONE:
+		break;
+	case DC_PARITY_ODD:
+		value |= 1 << 8;
+		break;
+	case DC_PARITY_EVEN:
+		value |= 2 << 8;
+		break;
+	case DC_PARITY_MARK:
+		value |= 3 << 8;
+		break;
+	case DC_PARITY_SPACE:
+		value |= 4 << 8;
+		break;
+	default:
+		return DC_STATUS_INVALIDARGS;
+	}
+
+	switch (stopbits) {
+	case DC_STOPBITS_ONE:
+		break;
+	case DC_STOPBITS_ONEPOINTFIVE:
+		value |= 1 << 11;
+		break;
+	case DC_STOPBITS_TWO:
+		value |= 2 << 11;
+		break;
+	default:
+		return DC_STATUS_INVALIDARGS;
+	}
+
+	status = dc_serial_ftdi_control (device, SIO_SET_DATA, value, ftdi->interface + 1);
+	if (status != DC_STATUS_SUCCESS)
+		return status;
+
+	ftdi->lineparams = value;
+
+	// Set the flow control.
+	unsigned int flow = 0;
+	switch (flowcontrol) {
+	case DC_FLOWCONTROL_NONE:
+		flow = SIO_DISABLE_FLOW_CTRL;
+		break;
+	case DC_FLOWCONTROL_HARDWARE:
+		flow = SIO_RTS_CTS_HS;
+		break;
+	case DC_FLOWCONTROL_SOFTWARE:
+		flow = SIO_XON_XOFF_HS;
+		break;
+	default:
+		return DC_STATUS_INVALIDARGS;
+	}
+
+	status = dc_serial_ftdi_control (device, SIO_SET_FLOW_CTRL, 0, flow | (ftdi->interface + 1));
+	if (status != DC_STATUS_SUCCESS)
+		return status;
+
+	device->baudrate = baudrate;
+	device->nbits = 1 + databits + stopbits + (parity ? 1 : 0);
+
+	return DC_STATUS_SUCCESS;
+}
+
+static dc_status_t
+dc_serial_ftdi_read (dc_serial_t *device, void *data, size_t size, size_t *actual)
+{
+	dc_status_t status = DC_STATUS_SUCCESS;
+	dc_serial_ftdi_t *ftdi = device->ftdi;
+	size_t nbytes = 0;
+
+	// The absolute target time (monotonic, nanoseconds).
+	unsigned long long deadline = 0;
+	if (device->timeout > 0) {
+		deadline = dc_common_now_ns () +
+			(unsigned long long) device->timeout * 1000000;
+	}
+
+	while (nbytes < size) {
+		// Serve the buffered payload first.
+		if (ftdi->available) {
+			size_t length = size - nbytes;
+			if (length > ftdi->available)
+				length = ftdi->available;
+			memcpy ((unsigned char *) data + nbytes, ftdi->cache + ftdi->offset, length);
+			ftdi->offset += length;
+			ftdi->available -= length;
+			nbytes += length;
+			continue;
+		}
+
+		// Calculate the timeout of the bulk transfer.
+		unsigned int timeout = 0;
+		if (device->timeout < 0) {
+			// Blocking mode. The individual transfers remain
+			// bounded, to keep the operation interruptible.
+			timeout = FTDI_TIMEOUT;
+		} else if (device->timeout == 0) {
+			// Non-blocking mode. The chip needs at least one
+			// latency interval to return the buffered data.
+			timeout = 5;
+		} else {
+			unsigned long long now = dc_common_now_ns ();
+			if (now < deadline) {
+				timeout = (deadline - now) / 1000000 + 1;
+			} else {
+				device->metrics.timeouts++;
+				device->metrics.stalltime += device->timeout;
+				break; // Timeout.
+			}
+		}
+
+		// Transfer a single usb packet. The first two bytes of every
+		// packet contain the modem status, not payload data.
+		unsigned char packet[FTDI_PACKET];
+		int length = 0;
+		int rc = libusb_bulk_transfer (ftdi->handle, ftdi->endpoint_in,
+			packet, ftdi->maxpacket, &length, timeout);
+		if (rc != LIBUSB_SUCCESS && rc != LIBUSB_ERROR_TIMEOUT) {
+			ERROR (device->context, "Failed to receive the usb packet (%s).",
+				libusb_error_name (rc));
+			status = FTDI_EXITCODE(rc);
+			goto out;
+		}
+
+		if (length > FTDI_HEADER) {
+			size_t payload = length - FTDI_HEADER;
+			memcpy (ftdi->cache, packet + FTDI_HEADER, payload);
+			ftdi->offset = 0;
+			ftdi->available = payload;
+			device->metrics.rbytes += payload;
+		} else if (device->timeout == 0) {
+			break; // No data available.
+		}
+	}
+
+	if (nbytes != size) {
+		status = DC_STATUS_TIMEOUT;
+	}
+
+out:
+#ifdef ENABLE_TRACE
+	dc_serial_trace_record (device, TRACE_INPUT, (const unsigned char *) data, nbytes);
+#endif
+	HEXDUMP (device->context, DC_LOGLEVEL_INFO, "Read", (unsigned char *) data, nbytes);
+
+	if (actual)
+		*actual = nbytes;
+
+	return status;
+}
+
+static dc_status_t
+dc_serial_ftdi_write (dc_serial_t *device, const void *data, size_t size, size_t *actual)
+{
+	dc_status_t status = DC_STATUS_SUCCESS;
+	dc_serial_ftdi_t *ftdi = device->ftdi;
+	size_t nbytes = 0;
+
+	unsigned long long begin = 0;
+	if (device->halfduplex) {
+		// Get the current time.
+		begin = dc_common_now_ns ();
+	}
+
+	while (nbytes < size) {
+		size_t length = size - nbytes;
+		if (length > ftdi->maxpacket)
+			length = ftdi->maxpacket;
+
+		int transferred = 0;
+		int rc = libusb_bulk_transfer (ftdi->handle, ftdi->endpoint_out,
+			(unsigned char *) data + nbytes, length, &transferred, FTDI_TIMEOUT);
+		if (rc != LIBUSB_SUCCESS) {
+			ERROR (device->context, "Failed to send the usb packet (%s).",
+				libusb_error_name (rc));
+			status = FTDI_EXITCODE(rc);
+			goto out;
+		}
+
+		nbytes += transferred;
+		device->metrics.wbytes += transferred;
+	}
+
+	if (device->halfduplex) {
+		// Calculate the elapsed time (microseconds).
+		unsigned long elapsed = (dc_common_now_ns () - begin) / 1000;
+
+		// Calculate the expected duration (microseconds). A 2 millisecond fudge
+		// factor is added because it improves the success rate significantly.
+		unsigned long expected = 1000000.0 * device->nbits / device->baudrate * size + 0.5 + 2000;
+
+		// Wait for the remaining time.
+		if (elapsed < expected) {
+			unsigned long remaining = expected - elapsed;
+
+			// The remaining time is rounded up to the nearest millisecond to
+			// match the Windows implementation. The higher resolution is
+			// pointless anyway, since we already added a fudge factor above.
+			dc_serial_sleep (device, (remaining + 999) / 1000);
+		}
+	}
+
+out:
+#ifdef ENABLE_TRACE
+	dc_serial_trace_record (device, TRACE_OUTPUT, (const unsigned char *) data, nbytes);
+#endif
+	HEXDUMP (device->context, DC_LOGLEVEL_INFO, "Write", (unsigned char *) data, nbytes);
+
+	if (actual)
+		*actual = nbytes;
+
+	return status;
+}
+
+static dc_status_t
+dc_serial_ftdi_purge (dc_serial_t *device, dc_direction_t direction)
+{
+	dc_status_t status = DC_STATUS_SUCCESS;
+	dc_serial_ftdi_t *ftdi = device->ftdi;
+
+	if (direction & DC_DIRECTION_INPUT) {
+		ftdi->available = 0;
+		ftdi->offset = 0;
+		status = dc_serial_ftdi_control (device, SIO_RESET, SIO_RESET_PURGE_RX, ftdi->interface + 1);
+		if (status != DC_STATUS_SUCCESS)
+			return status;
+	}
+
+	if (direction & DC_DIRECTION_OUTPUT) {
+		status = dc_serial_ftdi_control (device, SIO_RESET, SIO_RESET_PURGE_TX, ftdi->interface + 1);
+	}
+
+	return status;
+}
+
+static dc_status_t
+dc_serial_ftdi_set_latency (dc_serial_t *device, unsigned int milliseconds)
+{
+	dc_serial_ftdi_t *ftdi = device->ftdi;
+
+	// The latency timer of the chip has a valid range of 1 to 255
+	// milliseconds. A value of zero requests the lowest latency.
+	unsigned int value = milliseconds;
+	if (value < 1)
+		value = 1;
+	if (value > 255)
+		value = 255;
+
+	return dc_serial_ftdi_control (device, SIO_SET_LATENCY_TIMER, value, ftdi->interface + 1);
+}
+
+static dc_status_t
+dc_serial_ftdi_get_lines (dc_serial_t *device, unsigned int *value)
+{
+	dc_serial_ftdi_t *ftdi = device->ftdi;
+	unsigned int lines = 0;
+
+	unsigned char data[2] = {0};
+	int rc = libusb_control_transfer (ftdi->handle,
+		LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE | LIBUSB_ENDPOINT_IN,
+		SIO_GET_MODEM_STATUS, 0, ftdi->interface + 1, data, sizeof (data), FTDI_TIMEOUT);
+	if (rc < 0) {
+		ERROR (device->context, "Failed to read the modem status (%s).",
+			libusb_error_name (rc));
+		return FTDI_EXITCODE(rc);
+	}
+
+	if (data[0] & FTDI_STATUS_RLSD)
+		lines |= DC_LINE_DCD;
+	if (data[0] & FTDI_STATUS_CTS)
+		lines |= DC_LINE_CTS;
+	if (data[0] & FTDI_STATUS_DSR)
+		lines |= DC_LINE_DSR;
+	if (data[0] & FTDI_STATUS_RI)
+		lines |= DC_LINE_RNG;
+
+	if (value)
+		*value = lines;
+
+	return DC_STATUS_SUCCESS;
+}
+
+#endif /* HAVE_LIBUSB */
+
 dc_status_t
 dc_serial_enumerate (dc_serial_callback_t callback, void *userdata)
 {
@@ -139,6 +1078,111 @@ dc_serial_enumerate (dc_serial_callback_t callback, void *userdata)
 	return DC_STATUS_SUCCESS;
 }
 
+#ifdef HAVE_SYS_INOTIFY_H
+
+/*
+ * Cached enumeration. The cache holds the result of the previous
+ * scan, and is invalidated through an inotify watch on the device
+ * directory, so polling for new ports returns from the cache when
+ * nothing has changed.
+ */
+typedef struct dc_serial_cache_t {
+	pthread_mutex_t mutex;
+	int initialized;
+	int inotify;
+	int valid;
+	char **names;
+	size_t count;
+	size_t capacity;
+} dc_serial_cache_t;
+
+static dc_serial_cache_t g_serial_cache = {PTHREAD_MUTEX_INITIALIZER, 0, -1, 0, NULL, 0, 0};
+
+static void
+dc_serial_cache_append (const char *name, void *userdata)
+{
+	dc_serial_cache_t *cache = (dc_serial_cache_t *) userdata;
+
+	if (cache->count >= cache->capacity) {
+		size_t capacity = cache->capacity ? 2 * cache->capacity : 16;
+		char **names = (char **) realloc (cache->names, capacity * sizeof (char *));
+		if (names == NULL)
+			return;
+		cache->names = names;
+		cache->capacity = capacity;
+	}
+
+	char *copy = strdup (name);
+	if (copy == NULL)
+		return;
+
+	cache->names[cache->count++] = copy;
+}
+
+#endif /* HAVE_SYS_INOTIFY_H */
+
+dc_status_t
+dc_serial_enumerate_cached (dc_serial_callback_t callback, void *userdata)
+{
+#ifdef HAVE_SYS_INOTIFY_H
+	dc_status_t status = DC_STATUS_SUCCESS;
+	dc_serial_cache_t *cache = &g_serial_cache;
+
+	pthread_mutex_lock (&cache->mutex);
+
+	// Install the watch on the device directory. Without a watch, the
+	// cache can never be invalidated, and every call falls back to a
+	// full scan.
+	if (!cache->initialized) {
+		cache->inotify = inotify_init1 (IN_NONBLOCK | IN_CLOEXEC);
+		if (cache->inotify != -1 &&
+			inotify_add_watch (cache->inotify, "/dev",
+				IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO) == -1) {
+			close (cache->inotify);
+			cache->inotify = -1;
+		}
+		cache->initialized = 1;
+	}
+
+	if (cache->inotify == -1) {
+		pthread_mutex_unlock (&cache->mutex);
+		return dc_serial_enumerate (callback, userdata);
+	}
+
+	// Drain the pending change notifications. Any event invalidates
+	// the cache; the event details are not interesting.
+	unsigned char events[4096];
+	while (read (cache->inotify, events, sizeof (events)) > 0) {
+		cache->valid = 0;
+	}
+
+	// Re-scan if the cache is invalid.
+	if (!cache->valid) {
+		for (size_t i = 0; i < cache->count; ++i)
+			free (cache->names[i]);
+		cache->count = 0;
+
+		status = dc_serial_enumerate (dc_serial_cache_append, cache);
+		if (status != DC_STATUS_SUCCESS) {
+			pthread_mutex_unlock (&cache->mutex);
+			return status;
+		}
+		cache->valid = 1;
+	}
+
+	// Deliver the cached result.
+	for (size_t i = 0; i < cache->count; ++i) {
+		callback (cache->names[i], userdata);
+	}
+
+	pthread_mutex_unlock (&cache->mutex);
+
+	return status;
+#else
+	return dc_serial_enumerate (callback, userdata);
+#endif
+}
+
 dc_status_t
 dc_serial_open (dc_serial_t **out, dc_context_t *context, const char *name)
 {
@@ -162,11 +1206,146 @@ dc_serial_open (dc_serial_t **out, dc_context_t *context, const char *name)
 	// Default to blocking reads.
 	device->timeout = -1;
 
+	// Default to the normal (non-adaptive) timeout mode.
+	device->adaptive = 0;
+	device->latency = 0;
+
+	// Default to no cancellation callback.
+	device->cancel_callback = NULL;
+	device->cancel_userdata = NULL;
+
+	// Inherit the transfer scheduler from the context.
+	dc_context_get_scheduler (context,
+		&device->scheduler_callback,
+		&device->scheduler_userdata,
+		&device->scheduler_threshold);
+
 	// Default to full-duplex.
 	device->halfduplex = 0;
 	device->baudrate = 0;
 	device->nbits = 0;
 
+	device->name = NULL;
+	device->warm = 0;
+
+	memset (&device->metrics, 0, sizeof (device->metrics));
+
+#ifdef HAVE_LIBUSB
+	device->ftdi = NULL;
+#endif
+
+#ifdef ENABLE_TRACE
+	device->trace = NULL;
+	device->replay = 0;
+	device->timing = 0;
+	timerclear (&device->tlast);
+	device->rdir = 0;
+	device->rdelay = 0;
+	device->rsize = 0;
+	device->speed = 100;
+	device->fuzz = 0;
+	device->seed = 1;
+	device->iostats = NULL;
+	device->iostats_size = 0;
+	device->iostats_count = 0;
+
+	const char *timing = getenv ("DC_TRACE_TIMING");
+	if (timing)
+		device->timing = atoi (timing);
+
+	// A name with the trace prefix opens a recorded trace in replay
+	// mode, instead of a serial port.
+	if (name && strncmp (name, "trace:", 6) == 0) {
+		device->trace = fopen (name + 6, "rb");
+		if (device->trace == NULL) {
+			ERROR (context, "Failed to open the trace file.");
+			status = DC_STATUS_NODEVICE;
+			goto error_free;
+		}
+
+		unsigned char header[5];
+		if (fread (header, 1, sizeof (header), device->trace) != sizeof (header) ||
+			memcmp (header, TRACE_MAGIC, 4) != 0 ||
+			header[4] != TRACE_VERSION) {
+			ERROR (context, "Invalid trace file header.");
+			fclose (device->trace);
+			status = DC_STATUS_DATAFORMAT;
+			goto error_free;
+		}
+
+		// The replay speed scales the recorded timing, and implies
+		// timing reproduction. For example a value of 50 replays at
+		// twice the recorded speed, and 200 at half the speed.
+		const char *speed = getenv ("DC_TRACE_SPEED");
+		if (speed && atoi (speed) > 0) {
+			device->speed = atoi (speed);
+			device->timing = 1;
+		}
+
+		// Corrupt a single bit in roughly one out of every N replayed
+		// input bytes, to exercise the error handling of the backends.
+		// The injected errors are deterministic, so a failure can be
+		// reproduced by replaying the trace again.
+		const char *fuzz = getenv ("DC_TRACE_FUZZ");
+		if (fuzz && atoi (fuzz) > 0)
+			device->fuzz = atoi (fuzz);
+
+		device->replay = 1;
+		device->fd = -1;
+
+		*out = device;
+
+		return DC_STATUS_SUCCESS;
+	}
+#endif
+
+	// Revive a parked port with the same name, if keepalive is
+	// enabled. The parked port is still open and fully configured,
+	// so the port setup and the settle time are skipped.
+	if (name && dc_context_get_keepalive (context)) {
+		dc_serial_t *parked = dc_serial_park_take (name);
+		if (parked) {
+			struct termios tty;
+			if (tcgetattr (parked->fd, &tty) == 0) {
+				INFO (context, "Open: revived the parked port");
+				parked->context = context;
+				parked->warm = 1;
+				memset (&parked->metrics, 0, sizeof (parked->metrics));
+				dc_context_get_scheduler (context,
+					&parked->scheduler_callback,
+					&parked->scheduler_userdata,
+					&parked->scheduler_threshold);
+				free (device);
+				*out = parked;
+				return DC_STATUS_SUCCESS;
+			}
+			// The parked port went stale (e.g. unplugged), so
+			// dispose of it and open the port from scratch.
+			WARNING (context, "Discarded the stale parked port.");
+			dc_serial_destroy (parked);
+		}
+	}
+
+	// A name with the ftdi prefix bypasses the kernel usb-serial
+	// driver, and drives the FTDI chip directly over usb.
+	if (name && strncmp (name, "ftdi:", 5) == 0) {
+#ifdef HAVE_LIBUSB
+		status = dc_serial_ftdi_open (device, name + 5);
+		if (status != DC_STATUS_SUCCESS)
+			goto error_free;
+
+		device->fd = -1;
+
+		*out = device;
+
+		return DC_STATUS_SUCCESS;
+#else
+		ERROR (context, "FTDI support requires libusb.");
+		status = DC_STATUS_UNSUPPORTED;
+		goto error_free;
+#endif
+	}
+
 	// Open the device in non-blocking mode, to return immediately
 	// without waiting for the modem connection to complete.
 	device->fd = open (name, O_RDWR | O_NOCTTY | O_NONBLOCK);
@@ -198,6 +1377,40 @@ dc_serial_open (dc_serial_t **out, dc_context_t *context, const char *name)
 		goto error_close;
 	}
 
+	// Remember the device name for the keepalive mode. An allocation
+	// failure is harmless: the port simply can never be parked.
+	device->name = strdup (name);
+
+#ifdef ENABLE_TRACE
+	// Record all traffic when a trace file is requested.
+	const char *trace = getenv ("DC_TRACE_RECORD");
+	if (trace) {
+		device->trace = fopen (trace, "wb");
+		if (device->trace) {
+			unsigned char header[5] = {'D', 'C', 'T', 'R', TRACE_VERSION};
+			fwrite (header, 1, sizeof (header), device->trace);
+			gettimeofday (&device->tlast, NULL);
+		} else {
+			WARNING (context, "Failed to open the trace file.");
+		}
+	}
+
+	// Capture an in-memory I/O timeline when requested. The value of
+	// the environment variable overrides the default ring capacity.
+	const char *iostats = getenv ("DC_TRACE_IOSTATS");
+	if (iostats) {
+		int n = atoi (iostats);
+		if (n <= 0)
+			n = IOSTATS_SIZE;
+		device->iostats = (dc_serial_iostat_t *) malloc (n * sizeof (dc_serial_iostat_t));
+		if (device->iostats) {
+			device->iostats_size = n;
+		} else {
+			WARNING (context, "Failed to allocate the I/O timeline.");
+		}
+	}
+#endif
+
 	*out = device;
 
 	return DC_STATUS_SUCCESS;
@@ -217,6 +1430,39 @@ dc_serial_close (dc_serial_t *device)
 	if (device == NULL)
 		return DC_STATUS_SUCCESS;
 
+#ifdef ENABLE_TRACE
+	dc_serial_iostat_dump (device);
+	free (device->iostats);
+	device->iostats = NULL;
+	device->iostats_size = 0;
+	device->iostats_count = 0;
+
+	if (device->trace)
+		fclose (device->trace);
+	device->trace = NULL;
+
+	if (device->replay) {
+		free (device);
+		return status;
+	}
+#endif
+
+#ifdef HAVE_LIBUSB
+	if (device->ftdi) {
+		status = dc_serial_ftdi_close (device);
+		free (device);
+		return status;
+	}
+#endif
+
+	// Park the port instead of closing it, when keepalive is enabled.
+	// The terminal attributes are deliberately not restored, so the
+	// port is still configured when it is revived.
+	if (device->name && dc_context_get_keepalive (device->context)) {
+		dc_serial_park_put (device);
+		return status;
+	}
+
 	// Restore the initial terminal attributes.
 	if (tcsetattr (device->fd, TCSANOW, &device->tty) != 0) {
 		int errcode = errno;
@@ -237,6 +1483,7 @@ dc_serial_close (dc_serial_t *device)
 	}
 
 	// Free memory.
+	free (device->name);
 	free (device);
 
 	return status;
@@ -250,6 +1497,16 @@ dc_serial_configure (dc_serial_t *device, unsigned int baudrate, unsigned int da
 
 	INFO (device->context, "Configure: baudrate=%i, databits=%i, parity=%i, stopbits=%i, flowcontrol=%i",
 		baudrate, databits, parity, stopbits, flowcontrol);
+#ifdef ENABLE_TRACE
+	// The serial line settings have no effect on a replay.
+	if (device->replay)
+		return DC_STATUS_SUCCESS;
+#endif
+
+#ifdef HAVE_LIBUSB
+	if (device->ftdi)
+		return dc_serial_ftdi_configure (device, baudrate, databits, parity, stopbits, flowcontrol);
+#endif
 
 	// Retrieve the current settings.
 	struct termios tty;
@@ -508,6 +1765,62 @@ dc_serial_set_timeout (dc_serial_t *device, int timeout)
 	return DC_STATUS_SUCCESS;
 }
 
+dc_status_t
+dc_serial_set_timeout_adaptive (dc_serial_t *device, unsigned int value)
+{
+	if (device == NULL)
+		return DC_STATUS_INVALIDARGS;
+
+	INFO (device->context, "Adaptive: value=%i", value);
+
+	device->adaptive = value;
+	device->latency = 0;
+
+	return DC_STATUS_SUCCESS;
+}
+
+dc_status_t
+dc_serial_set_cancel (dc_serial_t *device, dc_cancel_callback_t callback, void *userdata)
+{
+	if (device == NULL)
+		return DC_STATUS_INVALIDARGS;
+
+	device->cancel_callback = callback;
+	device->cancel_userdata = userdata;
+
+	return DC_STATUS_SUCCESS;
+}
+
+dc_status_t
+dc_serial_set_scheduler (dc_serial_t *device, dc_scheduler_callback_t callback, void *userdata, size_t threshold)
+{
+	if (device == NULL)
+		return DC_STATUS_INVALIDARGS;
+
+	device->scheduler_callback = callback;
+	device->scheduler_userdata = userdata;
+	device->scheduler_threshold = threshold;
+
+	return DC_STATUS_SUCCESS;
+}
+
+/*
+ * Hand a transfer to the scheduler callback before it is submitted.
+ * The callback may block, to yield the bus to a higher priority
+ * connection.
+ */
+static void
+dc_serial_schedule (dc_serial_t *device, size_t size)
+{
+	if (device->scheduler_callback == NULL)
+		return;
+
+	dc_transfer_class_t type = size > device->scheduler_threshold ?
+		DC_TRANSFER_BULK : DC_TRANSFER_CONTROL;
+
+	device->scheduler_callback (type, size, device->scheduler_userdata);
+}
+
 dc_status_t
 dc_serial_set_halfduplex (dc_serial_t *device, unsigned int value)
 {
@@ -525,6 +1838,17 @@ dc_serial_set_latency (dc_serial_t *device, unsigned int milliseconds)
 	if (device == NULL)
 		return DC_STATUS_INVALIDARGS;
 
+#ifdef ENABLE_TRACE
+	// The serial line settings have no effect on a replay.
+	if (device->replay)
+		return DC_STATUS_SUCCESS;
+#endif
+
+#ifdef HAVE_LIBUSB
+	if (device->ftdi)
+		return dc_serial_ftdi_set_latency (device, milliseconds);
+#endif
+
 #if defined(TIOCGSERIAL) && defined(TIOCSSERIAL) && !defined(__ANDROID__)
 	// Get the current settings.
 	struct serial_struct ss;
@@ -547,6 +1871,28 @@ dc_serial_set_latency (dc_serial_t *device, unsigned int milliseconds)
 		SYSERROR (device->context, errcode);
 		return syserror (errcode);
 	}
+
+	// The low latency flag is a no-op in some usb-serial drivers. The
+	// FTDI driver also exposes its latency timer as a sysfs attribute,
+	// which accepts the value in milliseconds directly, with a valid
+	// range of 1 to 255. Ports without the attribute are skipped.
+	const char *tty = ttyname (device->fd);
+	if (tty) {
+		const char *p = strrchr (tty, '/');
+		char path[PATH_MAX];
+		snprintf (path, sizeof (path), "/sys/bus/usb-serial/devices/%s/latency_timer",
+			p ? p + 1 : tty);
+		FILE *fp = fopen (path, "w");
+		if (fp) {
+			unsigned int value = milliseconds;
+			if (value < 1)
+				value = 1;
+			if (value > 255)
+				value = 255;
+			fprintf (fp, "%u", value);
+			fclose (fp);
+		}
+	}
 #elif defined(IOSSDATALAT)
 	// Set the receive latency in microseconds. Serial drivers use this
 	// value to determine how often to dequeue characters received by
@@ -573,11 +1919,28 @@ dc_serial_read (dc_serial_t *device, void *data, size_t size, size_t *actual)
 		goto out_invalidargs;
 	}
 
+	dc_serial_schedule (device, size);
+
+#ifdef HAVE_LIBUSB
+	if (device->ftdi)
+		return dc_serial_ftdi_read (device, data, size, actual);
+#endif
+
+#ifdef ENABLE_TRACE
+	if (device->replay)
+		return dc_serial_replay_read (device, (unsigned char *) data, size, actual);
+
+	unsigned long long submitted = device->iostats ? dc_common_now_ns () : 0;
+#endif
+
 	// The total timeout.
 	int timeout = device->timeout;
 
-	// The absolute target time.
-	struct timeval tve;
+	// The absolute target time (monotonic, nanoseconds).
+	unsigned long long deadline = 0;
+
+	// The arrival time of the previous data.
+	unsigned long long last = 0;
 
 	int init = 1;
 	while (nbytes < size) {
@@ -587,33 +1950,52 @@ dc_serial_read (dc_serial_t *device, void *data, size_t size, size_t *actual)
 
 		struct timeval tvt;
 		if (timeout > 0) {
-			struct timeval now;
-			if (gettimeofday (&now, NULL) != 0) {
-				int errcode = errno;
-				SYSERROR (device->context, errcode);
-				status = syserror (errcode);
-				goto out;
-			}
+			unsigned long long now = dc_common_now_ns ();
 
 			if (init) {
-				// Calculate the initial timeout.
-				tvt.tv_sec  = (timeout / 1000);
-				tvt.tv_usec = (timeout % 1000) * 1000;
 				// Calculate the target time.
-				timeradd (&now, &tvt, &tve);
-			} else {
-				// Calculate the remaining timeout.
-				if (timercmp (&now, &tve, <))
-					timersub (&tve, &now, &tvt);
-				else
-					timerclear (&tvt);
+				deadline = now + (unsigned long long) timeout * 1000000;
 			}
 			init = 0;
+
+			// Calculate the remaining timeout (microseconds).
+			unsigned long long remaining = 0;
+			if (now < deadline)
+				remaining = (deadline - now) / 1000;
+
+			// Once data has started arriving, shrink the remaining
+			// timeout to the adaptive inter-byte bound. The full
+			// timeout remains the hard upper bound.
+			if (device->adaptive && nbytes && device->latency) {
+				unsigned long long bound = (unsigned long long) device->latency * ADAPTIVE_FACTOR;
+				if (bound < ADAPTIVE_MINIMUM)
+					bound = ADAPTIVE_MINIMUM;
+				if (bound < remaining)
+					remaining = bound;
+			}
+
+			tvt.tv_sec  = remaining / 1000000;
+			tvt.tv_usec = remaining % 1000000;
 		} else if (timeout == 0) {
 			timerclear (&tvt);
 		}
 
-		int rc = select (device->fd + 1, &fds, NULL, NULL, timeout >= 0 ? &tvt : NULL);
+		// With a cancellation callback registered, limit the wait to
+		// the polling interval, so a cancellation request is noticed
+		// while no data is arriving. A wakeup from an expired slice is
+		// not a timeout, and resumes the wait.
+		int sliced = 0;
+		if (device->cancel_callback && timeout != 0) {
+			struct timeval tvc;
+			tvc.tv_sec  = CANCEL_TIMESLICE / 1000;
+			tvc.tv_usec = (CANCEL_TIMESLICE % 1000) * 1000;
+			if (timeout < 0 || timercmp (&tvc, &tvt, <)) {
+				tvt = tvc;
+				sliced = 1;
+			}
+		}
+
+		int rc = select (device->fd + 1, &fds, NULL, NULL, timeout >= 0 || sliced ? &tvt : NULL);
 		if (rc < 0) {
 			int errcode = errno;
 			if (errcode == EINTR)
@@ -622,6 +2004,27 @@ dc_serial_read (dc_serial_t *device, void *data, size_t size, size_t *actual)
 			status = syserror (errcode);
 			goto out;
 		} else if (rc == 0) {
+			// Check for a cancellation request.
+			if (device->cancel_callback &&
+				device->cancel_callback (device->cancel_userdata)) {
+				status = DC_STATUS_CANCELLED;
+				goto out;
+			}
+
+			// An expired slice is not a timeout.
+			if (sliced)
+				continue;
+
+			// Account the time spent on the read that is about to
+			// fail, measured against the absolute target time.
+			device->metrics.timeouts++;
+			if (timeout > 0) {
+				unsigned long long now = dc_common_now_ns ();
+				unsigned int remaining = 0;
+				if (now < deadline)
+					remaining = (deadline - now) / 1000000;
+				device->metrics.stalltime += timeout - remaining;
+			}
 			break; // Timeout.
 		}
 
@@ -638,6 +2041,20 @@ dc_serial_read (dc_serial_t *device, void *data, size_t size, size_t *actual)
 		}
 
 		nbytes += n;
+		device->metrics.rbytes += n;
+
+		// Update the inter-byte latency estimate.
+		if (device->adaptive) {
+			unsigned long long now = dc_common_now_ns ();
+			if (last) {
+				unsigned long gap = (now - last) / 1000;
+				if (device->latency)
+					device->latency = (3 * device->latency + gap) / 4;
+				else
+					device->latency = gap;
+			}
+			last = now;
+		}
 	}
 
 	if (nbytes != size) {
@@ -645,6 +2062,11 @@ dc_serial_read (dc_serial_t *device, void *data, size_t size, size_t *actual)
 	}
 
 out:
+#ifdef ENABLE_TRACE
+	if (device->iostats)
+		dc_serial_iostat_record (device, TRACE_INPUT, nbytes, submitted, dc_common_now_ns ());
+	dc_serial_trace_record (device, TRACE_INPUT, (const unsigned char *) data, nbytes);
+#endif
 	HEXDUMP (device->context, DC_LOGLEVEL_INFO, "Read", (unsigned char *) data, nbytes);
 
 out_invalidargs:
@@ -665,15 +2087,30 @@ dc_serial_write (dc_serial_t *device, const void *data, size_t size, size_t *act
 		goto out_invalidargs;
 	}
 
-	struct timeval tve, tvb;
+	dc_serial_schedule (device, size);
+
+#ifdef HAVE_LIBUSB
+	if (device->ftdi)
+		return dc_serial_ftdi_write (device, data, size, actual);
+#endif
+
+#ifdef ENABLE_TRACE
+	// In replay mode, the commands are not sent anywhere. The replay
+	// of the input records automatically skips the recorded output.
+	if (device->replay) {
+		HEXDUMP (device->context, DC_LOGLEVEL_INFO, "Write", (unsigned char *) data, size);
+		if (actual)
+			*actual = size;
+		return DC_STATUS_SUCCESS;
+	}
+
+	unsigned long long submitted = device->iostats ? dc_common_now_ns () : 0;
+#endif
+
+	unsigned long long begin = 0;
 	if (device->halfduplex) {
 		// Get the current time.
-		if (gettimeofday (&tvb, NULL) != 0) {
-			int errcode = errno;
-			SYSERROR (device->context, errcode);
-			status = syserror (errcode);
-			goto out;
-		}
+		begin = dc_common_now_ns ();
 	}
 
 	while (nbytes < size) {
@@ -706,6 +2143,7 @@ dc_serial_write (dc_serial_t *device, const void *data, size_t size, size_t *act
 		}
 
 		nbytes += n;
+		device->metrics.wbytes += n;
 	}
 
 	// Wait until all data has been transmitted.
@@ -724,18 +2162,8 @@ dc_serial_write (dc_serial_t *device, const void *data, size_t size, size_t *act
 	}
 
 	if (device->halfduplex) {
-		// Get the current time.
-		if (gettimeofday (&tve, NULL) != 0) {
-			int errcode = errno;
-			SYSERROR (device->context, errcode);
-			status = syserror (errcode);
-			goto out;
-		}
-
 		// Calculate the elapsed time (microseconds).
-		struct timeval tvt;
-		timersub (&tve, &tvb, &tvt);
-		unsigned long elapsed = tvt.tv_sec * 1000000 + tvt.tv_usec;
+		unsigned long elapsed = (dc_common_now_ns () - begin) / 1000;
 
 		// Calculate the expected duration (microseconds). A 2 millisecond fudge
 		// factor is added because it improves the success rate significantly.
@@ -745,14 +2173,42 @@ dc_serial_write (dc_serial_t *device, const void *data, size_t size, size_t *act
 		if (elapsed < expected) {
 			unsigned long remaining = expected - elapsed;
 
-			// The remaining time is rounded up to the nearest millisecond to
-			// match the Windows implementation. The higher resolution is
-			// pointless anyway, since we already added a fudge factor above.
-			dc_serial_sleep (device, (remaining + 999) / 1000);
+			// Poll the transmitter state, and end the turnaround wait
+			// as soon as the line clears, instead of sleeping for the
+			// full worst case estimate. The polling interval doubles
+			// after every attempt, to keep the overhead bounded on
+			// large transfers. Drivers that cannot report the state
+			// fall back to the timed wait.
+			unsigned long backoff = 1;
+			while (remaining > 0) {
+				int empty = dc_serial_transmitter_empty (device);
+				if (empty > 0)
+					break;
+				if (empty < 0) {
+					// The remaining time is rounded up to the nearest millisecond to
+					// match the Windows implementation. The higher resolution is
+					// pointless anyway, since we already added a fudge factor above.
+					dc_serial_sleep (device, (remaining + 999) / 1000);
+					break;
+				}
+
+				unsigned long delay = backoff * 1000;
+				if (delay > remaining)
+					delay = remaining;
+				dc_serial_sleep (device, (delay + 999) / 1000);
+				remaining -= delay;
+				if (backoff < 8)
+					backoff *= 2;
+			}
 		}
 	}
 
 out:
+#ifdef ENABLE_TRACE
+	if (device->iostats)
+		dc_serial_iostat_record (device, TRACE_OUTPUT, nbytes, submitted, dc_common_now_ns ());
+	dc_serial_trace_record (device, TRACE_OUTPUT, (const unsigned char *) data, nbytes);
+#endif
 	HEXDUMP (device->context, DC_LOGLEVEL_INFO, "Write", (unsigned char *) data, nbytes);
 
 out_invalidargs:
@@ -768,8 +2224,19 @@ dc_serial_purge (dc_serial_t *device, dc_direction_t direction)
 	if (device == NULL)
 		return DC_STATUS_INVALIDARGS;
 
+#ifdef ENABLE_TRACE
+	// The serial line settings have no effect on a replay.
+	if (device->replay)
+		return DC_STATUS_SUCCESS;
+#endif
+
 	INFO (device->context, "Purge: direction=%u", direction);
 
+#ifdef HAVE_LIBUSB
+	if (device->ftdi)
+		return dc_serial_ftdi_purge (device, direction);
+#endif
+
 	int flags = 0;
 
 	switch (direction) {
@@ -801,6 +2268,12 @@ dc_serial_flush (dc_serial_t *device)
 	if (device == NULL)
 		return DC_STATUS_INVALIDARGS;
 
+#ifdef ENABLE_TRACE
+	// The serial line settings have no effect on a replay.
+	if (device->replay)
+		return DC_STATUS_SUCCESS;
+#endif
+
 	INFO (device->context, "Flush: none");
 
 	return DC_STATUS_SUCCESS;
@@ -812,8 +2285,24 @@ dc_serial_set_break (dc_serial_t *device, unsigned int level)
 	if (device == NULL)
 		return DC_STATUS_INVALIDARGS;
 
+#ifdef ENABLE_TRACE
+	// The serial line settings have no effect on a replay.
+	if (device->replay)
+		return DC_STATUS_SUCCESS;
+#endif
+
 	INFO (device->context, "Break: value=%i", level);
 
+#ifdef HAVE_LIBUSB
+	if (device->ftdi) {
+		unsigned int value = device->ftdi->lineparams;
+		if (level)
+			value |= SIO_BREAK_ON;
+		return dc_serial_ftdi_control (device, SIO_SET_DATA, value,
+			device->ftdi->interface + 1);
+	}
+#endif
+
 	unsigned long action = (level ? TIOCSBRK : TIOCCBRK);
 
 	if (ioctl (device->fd, action, NULL) != 0 && NOPTY) {
@@ -831,8 +2320,21 @@ dc_serial_set_dtr (dc_serial_t *device, unsigned int level)
 	if (device == NULL)
 		return DC_STATUS_INVALIDARGS;
 
+#ifdef ENABLE_TRACE
+	// The serial line settings have no effect on a replay.
+	if (device->replay)
+		return DC_STATUS_SUCCESS;
+#endif
+
 	INFO (device->context, "DTR: value=%i", level);
 
+#ifdef HAVE_LIBUSB
+	if (device->ftdi)
+		return dc_serial_ftdi_control (device, SIO_SET_MODEM_CTRL,
+			level ? SIO_SET_DTR_HIGH : SIO_SET_DTR_LOW,
+			device->ftdi->interface + 1);
+#endif
+
 	unsigned long action = (level ? TIOCMBIS : TIOCMBIC);
 
 	int value = TIOCM_DTR;
@@ -851,8 +2353,21 @@ dc_serial_set_rts (dc_serial_t *device, unsigned int level)
 	if (device == NULL)
 		return DC_STATUS_INVALIDARGS;
 
+#ifdef ENABLE_TRACE
+	// The serial line settings have no effect on a replay.
+	if (device->replay)
+		return DC_STATUS_SUCCESS;
+#endif
+
 	INFO (device->context, "RTS: value=%i", level);
 
+#ifdef HAVE_LIBUSB
+	if (device->ftdi)
+		return dc_serial_ftdi_control (device, SIO_SET_MODEM_CTRL,
+			level ? SIO_SET_RTS_HIGH : SIO_SET_RTS_LOW,
+			device->ftdi->interface + 1);
+#endif
+
 	unsigned long action = (level ? TIOCMBIS : TIOCMBIC);
 
 	int value = TIOCM_RTS;
@@ -871,6 +2386,25 @@ dc_serial_get_available (dc_serial_t *device, size_t *value)
 	if (device == NULL)
 		return DC_STATUS_INVALIDARGS;
 
+#ifdef ENABLE_TRACE
+	if (device->replay) {
+		if (value)
+			*value = device->rdir == TRACE_INPUT ? device->rsize : 0;
+		return DC_STATUS_SUCCESS;
+	}
+#endif
+
+#ifdef HAVE_LIBUSB
+	if (device->ftdi) {
+		// Only the payload already transferred to the host is
+		// counted. Data still buffered in the chip is not visible
+		// until the latency timer flushes it.
+		if (value)
+			*value = device->ftdi->available;
+		return DC_STATUS_SUCCESS;
+	}
+#endif
+
 	int bytes = 0;
 	if (ioctl (device->fd, TIOCINQ, &bytes) != 0) {
 		int errcode = errno;
@@ -892,6 +2426,19 @@ dc_serial_get_lines (dc_serial_t *device, unsigned int *value)
 	if (device == NULL)
 		return DC_STATUS_INVALIDARGS;
 
+#ifdef ENABLE_TRACE
+	if (device->replay) {
+		if (value)
+			*value = 0;
+		return DC_STATUS_SUCCESS;
+	}
+#endif
+
+#ifdef HAVE_LIBUSB
+	if (device->ftdi)
+		return dc_serial_ftdi_get_lines (device, value);
+#endif
+
 	int status = 0;
 	if (ioctl (device->fd, TIOCMGET, &status) != 0) {
 		int errcode = errno;
@@ -914,6 +2461,29 @@ dc_serial_get_lines (dc_serial_t *device, unsigned int *value)
 	return DC_STATUS_SUCCESS;
 }
 
+dc_status_t
+dc_serial_get_warm (dc_serial_t *device, unsigned int *value)
+{
+	if (device == NULL)
+		return DC_STATUS_INVALIDARGS;
+
+	if (value)
+		*value = device->warm;
+
+	return DC_STATUS_SUCCESS;
+}
+
+dc_status_t
+dc_serial_get_metrics (dc_serial_t *device, dc_event_metrics_t *metrics)
+{
+	if (device == NULL || metrics == NULL)
+		return DC_STATUS_INVALIDARGS;
+
+	*metrics = device->metrics;
+
+	return DC_STATUS_SUCCESS;
+}
+
 dc_status_t
 dc_serial_sleep (dc_serial_t *device, unsigned int timeout)
 {
@@ -28,6 +28,17 @@
 #include "common-private.h"
 #include "context-private.h"
 
+// The inter-byte timeout (in milliseconds) applied in the adaptive
+// timeout mode. Unlike the posix implementation, there is no latency
+// estimate, because the serial driver implements the inter-byte
+// timeout natively (ReadIntervalTimeout).
+#define ADAPTIVE_INTERVAL 100
+
+// The polling interval (in milliseconds) for the cancellation
+// callback while a read is waiting for incoming data. This bounds the
+// cancellation latency of a blocked transfer.
+#define CANCEL_TIMESLICE 50
+
 struct dc_serial_t {
 	/* Library context. */
 	dc_context_t *context;
@@ -35,6 +46,13 @@ struct dc_serial_t {
 	 * The file descriptor corresponding to the serial port.
 	 */
 	HANDLE hFile;
+	/*
+	 * Manual-reset events for the overlapped read and write
+	 * operations. Separate events allow a read and a write to be
+	 * outstanding at the same time.
+	 */
+	HANDLE hRead;
+	HANDLE hWrite;
 	/*
 	 * Serial port settings are saved into this variables immediately
 	 * after the port is opened. These settings are restored when the
@@ -42,10 +60,31 @@ struct dc_serial_t {
 	 */
 	DCB dcb;
 	COMMTIMEOUTS timeouts;
+	/* Adaptive timeout mode */
+	int adaptive;
+	int timeout;
+	/*
+	 * Cancellation support. While a read is waiting for data, the
+	 * callback is polled every CANCEL_TIMESLICE milliseconds, so a
+	 * cancellation request interrupts the read long before the
+	 * configured timeout expires.
+	 */
+	dc_cancel_callback_t cancel_callback;
+	void *cancel_userdata;
+	/*
+	 * Transfer scheduler support, see dc_serial_set_scheduler. The
+	 * callback is invoked before every transfer, classified as a
+	 * control exchange or a bulk transfer by its size.
+	 */
+	dc_scheduler_callback_t scheduler_callback;
+	void *scheduler_userdata;
+	size_t scheduler_threshold;
 	/* Half-duplex settings */
 	int halfduplex;
 	unsigned int baudrate;
 	unsigned int nbits;
+	/* Transfer statistics */
+	dc_event_metrics_t metrics;
 };
 
 static dc_status_t
@@ -119,6 +158,15 @@ dc_serial_enumerate (dc_serial_callback_t callback, void *userdata)
 	return DC_STATUS_SUCCESS;
 }
 
+dc_status_t
+dc_serial_enumerate_cached (dc_serial_callback_t callback, void *userdata)
+{
+	// A registry query is cheap compared to a directory scan, and a
+	// device change notification requires a window message loop, which
+	// a library function cannot assume. Always query the registry.
+	return dc_serial_enumerate (callback, userdata);
+}
+
 dc_status_t
 dc_serial_open (dc_serial_t **out, dc_context_t *context, const char *name)
 {
@@ -152,17 +200,35 @@ dc_serial_open (dc_serial_t **out, dc_context_t *context, const char *name)
 	// Library context.
 	device->context = context;
 
+	// Default to the normal (non-adaptive) timeout mode.
+	device->adaptive = 0;
+	device->timeout = -1;
+
+	// Default to no cancellation callback.
+	device->cancel_callback = NULL;
+	device->cancel_userdata = NULL;
+
+	// Inherit the transfer scheduler from the context.
+	dc_context_get_scheduler (context,
+		&device->scheduler_callback,
+		&device->scheduler_userdata,
+		&device->scheduler_threshold);
+
 	// Default to full-duplex.
 	device->halfduplex = 0;
 	device->baudrate = 0;
 	device->nbits = 0;
 
-	// Open the device.
+	memset (&device->metrics, 0, sizeof (device->metrics));
+
+	// Open the device with overlapped I/O enabled, so the read and
+	// write operations don't keep a thread blocked inside the kernel,
+	// and outstanding operations can be canceled.
 	device->hFile = CreateFileA (devname,
 			GENERIC_READ | GENERIC_WRITE, 0,
 			NULL, // No security attributes.
 			OPEN_EXISTING,
-			0, // Non-overlapped I/O.
+			FILE_FLAG_OVERLAPPED,
 			NULL);
 	if (device->hFile == INVALID_HANDLE_VALUE) {
 		DWORD errcode = GetLastError ();
@@ -171,6 +237,16 @@ dc_serial_open (dc_serial_t **out, dc_context_t *context, const char *name)
 		goto error_free;
 	}
 
+	// Create the events for the overlapped operations.
+	device->hRead = CreateEvent (NULL, TRUE, FALSE, NULL);
+	device->hWrite = CreateEvent (NULL, TRUE, FALSE, NULL);
+	if (device->hRead == NULL || device->hWrite == NULL) {
+		DWORD errcode = GetLastError ();
+		SYSERROR (context, errcode);
+		status = syserror (errcode);
+		goto error_close;
+	}
+
 	// Retrieve the current communication settings and timeouts,
 	// to be able to restore them when closing the device.
 	// It is also used to check if the obtained handle
@@ -188,6 +264,10 @@ dc_serial_open (dc_serial_t **out, dc_context_t *context, const char *name)
 	return DC_STATUS_SUCCESS;
 
 error_close:
+	if (device->hRead)
+		CloseHandle (device->hRead);
+	if (device->hWrite)
+		CloseHandle (device->hWrite);
 	CloseHandle (device->hFile);
 error_free:
 	free (device);
@@ -210,6 +290,10 @@ dc_serial_close (dc_serial_t *device)
 		dc_status_set_error(&status, syserror (errcode));
 	}
 
+	// Close the events.
+	CloseHandle (device->hRead);
+	CloseHandle (device->hWrite);
+
 	// Close the device.
 	if (!CloseHandle (device->hFile)) {
 		DWORD errcode = GetLastError ();
@@ -344,6 +428,8 @@ dc_serial_set_timeout (dc_serial_t *device, int timeout)
 
 	INFO (device->context, "Timeout: value=%i", timeout);
 
+	device->timeout = timeout;
+
 	// Retrieve the current timeouts.
 	COMMTIMEOUTS timeouts;
 	if (!GetCommTimeouts (device->hFile, &timeouts)) {
@@ -368,8 +454,10 @@ dc_serial_set_timeout (dc_serial_t *device, int timeout)
 		timeouts.WriteTotalTimeoutMultiplier = 0;
 		timeouts.WriteTotalTimeoutConstant = 0;
 	} else {
-		// Standard timeout mode.
-		timeouts.ReadIntervalTimeout = 0;
+		// Standard timeout mode. In adaptive mode, the driver applies
+		// a fixed inter-byte timeout once the first byte has arrived,
+		// with the total timeout as the hard upper bound.
+		timeouts.ReadIntervalTimeout = device->adaptive ? ADAPTIVE_INTERVAL : 0;
 		timeouts.ReadTotalTimeoutMultiplier = 0;
 		timeouts.ReadTotalTimeoutConstant = timeout;
 		timeouts.WriteTotalTimeoutMultiplier = 0;
@@ -386,6 +474,79 @@ dc_serial_set_timeout (dc_serial_t *device, int timeout)
 	return DC_STATUS_SUCCESS;
 }
 
+dc_status_t
+dc_serial_set_timeout_adaptive (dc_serial_t *device, unsigned int value)
+{
+	if (device == NULL)
+		return DC_STATUS_INVALIDARGS;
+
+	INFO (device->context, "Adaptive: value=%i", value);
+
+	device->adaptive = value;
+
+	// Re-apply the inter-byte timeout if a standard timeout is active.
+	COMMTIMEOUTS timeouts;
+	if (!GetCommTimeouts (device->hFile, &timeouts)) {
+		DWORD errcode = GetLastError ();
+		SYSERROR (device->context, errcode);
+		return syserror (errcode);
+	}
+
+	if (timeouts.ReadIntervalTimeout != MAXDWORD &&
+		timeouts.ReadTotalTimeoutConstant > 0) {
+		timeouts.ReadIntervalTimeout = value ? ADAPTIVE_INTERVAL : 0;
+		if (!SetCommTimeouts (device->hFile, &timeouts)) {
+			DWORD errcode = GetLastError ();
+			SYSERROR (device->context, errcode);
+			return syserror (errcode);
+		}
+	}
+
+	return DC_STATUS_SUCCESS;
+}
+
+dc_status_t
+dc_serial_set_cancel (dc_serial_t *device, dc_cancel_callback_t callback, void *userdata)
+{
+	if (device == NULL)
+		return DC_STATUS_INVALIDARGS;
+
+	device->cancel_callback = callback;
+	device->cancel_userdata = userdata;
+
+	return DC_STATUS_SUCCESS;
+}
+
+dc_status_t
+dc_serial_set_scheduler (dc_serial_t *device, dc_scheduler_callback_t callback, void *userdata, size_t threshold)
+{
+	if (device == NULL)
+		return DC_STATUS_INVALIDARGS;
+
+	device->scheduler_callback = callback;
+	device->scheduler_userdata = userdata;
+	device->scheduler_threshold = threshold;
+
+	return DC_STATUS_SUCCESS;
+}
+
+/*
+ * Hand a transfer to the scheduler callback before it is submitted.
+ * The callback may block, to yield the bus to a higher priority
+ * connection.
+ */
+static void
+dc_serial_schedule (dc_serial_t *device, size_t size)
+{
+	if (device->scheduler_callback == NULL)
+		return;
+
+	dc_transfer_class_t type = size > device->scheduler_threshold ?
+		DC_TRANSFER_BULK : DC_TRANSFER_CONTROL;
+
+	device->scheduler_callback (type, size, device->scheduler_userdata);
+}
+
 dc_status_t
 dc_serial_set_halfduplex (dc_serial_t *device, unsigned int value)
 {
@@ -417,14 +578,63 @@ dc_serial_read (dc_serial_t *device, void *data, size_t size, size_t *actual)
 		goto out_invalidargs;
 	}
 
-	if (!ReadFile (device->hFile, data, size, &dwRead, NULL)) {
+	dc_serial_schedule (device, size);
+
+	// Start the overlapped read operation. The communication timeouts
+	// remain in effect, so the operation completes (with the bytes
+	// received so far) when the configured timeout expires.
+	OVERLAPPED overlapped;
+	memset (&overlapped, 0, sizeof (overlapped));
+	overlapped.hEvent = device->hRead;
+	if (!ReadFile (device->hFile, data, size, NULL, &overlapped)) {
+		DWORD errcode = GetLastError ();
+		if (errcode != ERROR_IO_PENDING) {
+			SYSERROR (device->context, errcode);
+			status = syserror (errcode);
+			goto out;
+		}
+	}
+
+	// Wait for the operation to complete, polling the cancellation
+	// callback while no data is arriving. On a cancellation request,
+	// the outstanding operation is canceled and reaped before
+	// returning, because the kernel keeps writing into the buffer
+	// until the operation has completed.
+	for (;;) {
+		DWORD rc = WaitForSingleObject (overlapped.hEvent,
+			device->cancel_callback ? CANCEL_TIMESLICE : INFINITE);
+		if (rc == WAIT_OBJECT_0)
+			break;
+		if (rc == WAIT_TIMEOUT) {
+			if (device->cancel_callback (device->cancel_userdata)) {
+				CancelIo (device->hFile);
+				GetOverlappedResult (device->hFile, &overlapped, &dwRead, TRUE);
+				status = DC_STATUS_CANCELLED;
+				goto out;
+			}
+			continue;
+		}
+		DWORD errcode = GetLastError ();
+		SYSERROR (device->context, errcode);
+		status = syserror (errcode);
+		goto out;
+	}
+
+	if (!GetOverlappedResult (device->hFile, &overlapped, &dwRead, FALSE)) {
 		DWORD errcode = GetLastError ();
 		SYSERROR (device->context, errcode);
 		status = syserror (errcode);
 		goto out;
 	}
 
+	device->metrics.rbytes += dwRead;
+
 	if (dwRead != size) {
+		// The driver has waited out the full timeout before
+		// completing the operation with the bytes received so far.
+		device->metrics.timeouts++;
+		if (device->timeout > 0)
+			device->metrics.stalltime += device->timeout;
 		status = DC_STATUS_TIMEOUT;
 	}
 
@@ -449,6 +659,8 @@ dc_serial_write (dc_serial_t *device, const void *data, size_t size, size_t *act
 		goto out_invalidargs;
 	}
 
+	dc_serial_schedule (device, size);
+
 	LARGE_INTEGER begin, end, freq;
 	if (device->halfduplex) {
 		// Get the current time.
@@ -461,7 +673,21 @@ dc_serial_write (dc_serial_t *device, const void *data, size_t size, size_t *act
 		}
 	}
 
-	if (!WriteFile (device->hFile, data, size, &dwWritten, NULL)) {
+	// Start the overlapped write operation.
+	OVERLAPPED overlapped;
+	memset (&overlapped, 0, sizeof (overlapped));
+	overlapped.hEvent = device->hWrite;
+	if (!WriteFile (device->hFile, data, size, NULL, &overlapped)) {
+		DWORD errcode = GetLastError ();
+		if (errcode != ERROR_IO_PENDING) {
+			SYSERROR (device->context, errcode);
+			status = syserror (errcode);
+			goto out;
+		}
+	}
+
+	// Wait for the operation to complete.
+	if (!GetOverlappedResult (device->hFile, &overlapped, &dwWritten, TRUE)) {
 		DWORD errcode = GetLastError ();
 		SYSERROR (device->context, errcode);
 		status = syserror (errcode);
@@ -495,6 +721,8 @@ dc_serial_write (dc_serial_t *device, const void *data, size_t size, size_t *act
 		}
 	}
 
+	device->metrics.wbytes += dwWritten;
+
 	if (dwWritten != size) {
 		status = DC_STATUS_TIMEOUT;
 	}
@@ -672,6 +900,31 @@ dc_serial_get_lines (dc_serial_t *device, unsigned int *value)
 	return DC_STATUS_SUCCESS;
 }
 
+dc_status_t
+dc_serial_get_warm (dc_serial_t *device, unsigned int *value)
+{
+	if (device == NULL)
+		return DC_STATUS_INVALIDARGS;
+
+	// The keepalive mode is not implemented on this backend, so a
+	// connection is always opened from scratch.
+	if (value)
+		*value = 0;
+
+	return DC_STATUS_SUCCESS;
+}
+
+dc_status_t
+dc_serial_get_metrics (dc_serial_t *device, dc_event_metrics_t *metrics)
+{
+	if (device == NULL || metrics == NULL)
+		return DC_STATUS_INVALIDARGS;
+
+	*metrics = device->metrics;
+
+	return DC_STATUS_SUCCESS;
+}
+
 dc_status_t
 dc_serial_sleep (dc_serial_t *device, unsigned int timeout)
 {
@@ -26,19 +26,235 @@
 
 #include "context-private.h"
 #include "array.h"
+#include "lre.h"
 
 #define SZ_PACKET  254
 
+// The default RFCOMM channel for the Serial Port Profile.
+#define RFCOMM_CHANNEL 1
+
 // SLIP special character codes
 #define END       0xC0
 #define ESC       0xDB
 #define ESC_END   0xDC
 #define ESC_ESC   0xDD
 
+static int
+shearwater_common_bdaddr (const char *name, unsigned int *channel)
+{
+	// A Bluetooth address is formatted as six hexadecimal octets
+	// separated by colons (e.g. "00:11:22:33:44:55"), optionally
+	// followed by the RFCOMM channel number (e.g. ":5"). Anything
+	// else is treated as the name of a serial port.
+	if (name == NULL)
+		return 0;
+
+	for (unsigned int i = 0; i < 17; ++i) {
+		unsigned char c = name[i];
+		if (i % 3 == 2) {
+			if (c != ':')
+				return 0;
+		} else {
+			if (!((c >= '0' && c <= '9') ||
+				(c >= 'A' && c <= 'F') ||
+				(c >= 'a' && c <= 'f')))
+				return 0;
+		}
+	}
+
+	unsigned int number = RFCOMM_CHANNEL;
+	if (name[17] == ':') {
+		number = 0;
+		for (unsigned int i = 18; name[i] != '\0'; ++i) {
+			if (name[i] < '0' || name[i] > '9')
+				return 0;
+			number = number * 10 + (name[i] - '0');
+		}
+		if (number < 1 || number > 30)
+			return 0;
+	} else if (name[17] != '\0') {
+		return 0;
+	}
+
+	if (channel)
+		*channel = number;
+
+	return 1;
+}
+
+
+static dc_status_t
+shearwater_common_read (shearwater_common_device_t *device, void *data, size_t size)
+{
+	if (device->ble)
+		return dc_ble_read (device->ble, data, size, NULL);
+	else if (device->bluetooth)
+		return dc_bluetooth_read (device->bluetooth, data, size, NULL);
+	else
+		return dc_serial_read (device->port, data, size, NULL);
+}
+
+
+static dc_status_t
+shearwater_common_write (shearwater_common_device_t *device, const void *data, size_t size)
+{
+	if (device->ble)
+		return dc_ble_write (device->ble, data, size, NULL);
+	else if (device->bluetooth)
+		return dc_bluetooth_write (device->bluetooth, data, size, NULL);
+	else
+		return dc_serial_write (device->port, data, size, NULL);
+}
+
+
+static dc_status_t
+shearwater_common_get_available (shearwater_common_device_t *device, size_t *value)
+{
+	if (device->ble)
+		return dc_ble_get_available (device->ble, value);
+	else if (device->bluetooth)
+		return dc_bluetooth_get_available (device->bluetooth, value);
+	else
+		return dc_serial_get_available (device->port, value);
+}
+
+
+static dc_status_t
+shearwater_common_fill (shearwater_common_device_t *device)
+{
+	dc_status_t status = DC_STATUS_SUCCESS;
+	size_t available = 0;
+
+	// Wait for a single byte with a blocking read, and then drain
+	// whatever else has already arrived, so the framing layer can
+	// process the data in blocks instead of one transport call per
+	// byte. Transports without an available bytes query deliver one
+	// byte at a time, as before.
+	status = shearwater_common_read (device, device->cache, 1);
+	if (status != DC_STATUS_SUCCESS) {
+		return status;
+	}
+
+	device->cache_head = 0;
+	device->cache_tail = 1;
+
+	if (shearwater_common_get_available (device, &available) != DC_STATUS_SUCCESS)
+		return DC_STATUS_SUCCESS;
+
+	if (available > sizeof (device->cache) - 1)
+		available = sizeof (device->cache) - 1;
+
+	if (available) {
+		status = shearwater_common_read (device, device->cache + 1, available);
+		if (status != DC_STATUS_SUCCESS) {
+			return status;
+		}
+
+		device->cache_tail += available;
+	}
+
+	return DC_STATUS_SUCCESS;
+}
+
+
+static dc_status_t
+shearwater_common_open_ble (shearwater_common_device_t *device, dc_context_t *context, const char *address)
+{
+	dc_status_t status = DC_STATUS_SUCCESS;
+
+	// Open the BLE connection.
+	status = dc_ble_open (&device->ble, context);
+	if (status != DC_STATUS_SUCCESS) {
+		ERROR (context, "Failed to open the BLE connection.");
+		return status;
+	}
+
+	// Connect to the GATT service.
+	status = dc_ble_connect (device->ble, address);
+	if (status != DC_STATUS_SUCCESS) {
+		ERROR (context, "Failed to connect to the BLE device.");
+		goto error_close;
+	}
+
+	// Set the timeout for receiving data (3000ms).
+	status = dc_ble_set_timeout (device->ble, 3000);
+	if (status != DC_STATUS_SUCCESS) {
+		ERROR (context, "Failed to set the timeout.");
+		goto error_close;
+	}
+
+	return DC_STATUS_SUCCESS;
+
+error_close:
+	dc_ble_close (device->ble);
+	device->ble = NULL;
+	return status;
+}
+
+
+static dc_status_t
+shearwater_common_open_bluetooth (shearwater_common_device_t *device, dc_context_t *context, const char *name, unsigned int channel)
+{
+	dc_status_t status = DC_STATUS_SUCCESS;
+
+	// Strip the optional channel number from the address.
+	char address[18];
+	memcpy (address, name, 17);
+	address[17] = '\0';
+
+	// Open the bluetooth connection.
+	status = dc_bluetooth_open (&device->bluetooth, context);
+	if (status != DC_STATUS_SUCCESS) {
+		ERROR (context, "Failed to open the bluetooth connection.");
+		return status;
+	}
+
+	// Connect to the RFCOMM channel. The connection runs at the native
+	// link speed, without the extra latency and timeout problems of a
+	// virtual COM port emulated by the OS.
+	status = dc_bluetooth_connect (device->bluetooth, address, channel);
+	if (status != DC_STATUS_SUCCESS) {
+		ERROR (context, "Failed to connect to the bluetooth device.");
+		goto error_close;
+	}
+
+	// Set the timeout for receiving data (3000ms).
+	status = dc_bluetooth_set_timeout (device->bluetooth, 3000);
+	if (status != DC_STATUS_SUCCESS) {
+		ERROR (context, "Failed to set the timeout.");
+		goto error_close;
+	}
+
+	return DC_STATUS_SUCCESS;
+
+error_close:
+	dc_bluetooth_close (device->bluetooth);
+	device->bluetooth = NULL;
+	return status;
+}
+
+
 dc_status_t
 shearwater_common_open (shearwater_common_device_t *device, dc_context_t *context, const char *name)
 {
 	dc_status_t status = DC_STATUS_SUCCESS;
+	unsigned int channel = 0;
+
+	device->port = NULL;
+	device->bluetooth = NULL;
+	device->ble = NULL;
+	device->cache_head = 0;
+	device->cache_tail = 0;
+
+	// Connect over BLE GATT if the name is prefixed with "LE:".
+	if (name && strncmp (name, "LE:", 3) == 0) {
+		return shearwater_common_open_ble (device, context, name + 3);
+	}
+
+	// Connect directly over RFCOMM if the name is a bluetooth address.
+	if (shearwater_common_bdaddr (name, &channel)) {
+		return shearwater_common_open_bluetooth (device, context, name, channel);
+	}
 
 	// Open the device.
 	status = dc_serial_open (&device->port, context, name);
@@ -47,6 +263,9 @@ shearwater_common_open (shearwater_common_device_t *device, dc_context_t *contex
 		return status;
 	}
 
+	// Forward cancellation requests to the serial layer.
+	dc_serial_set_cancel (device->port, device_cancel_cb, device);
+
 	// Set the serial communication protocol (115200 8N1).
 	status = dc_serial_configure (device->port, 115200, 8, DC_PARITY_NONE, DC_STOPBITS_ONE, DC_FLOWCONTROL_NONE);
 	if (status != DC_STATUS_SUCCESS) {
@@ -77,66 +296,12 @@ dc_status_t
 shearwater_common_close (shearwater_common_device_t *device)
 {
 	// Close the device.
-	return dc_serial_close (device->port);
-}
-
-
-static int
-shearwater_common_decompress_lre (unsigned char *data, unsigned int size, dc_buffer_t *buffer, unsigned int *isfinal)
-{
-	// The RLE decompression algorithm does interpret the binary data as a
-	// stream of 9 bit values. Therefore, the total number of bits needs to be
-	// a multiple of 9 bits.
-	unsigned int nbits = size * 8;
-	if (nbits % 9 != 0)
-		return -1;
-
-	unsigned int offset = 0;
-	while (offset + 9 <= nbits) {
-		// Extract the 9 bit value.
-		unsigned int byte = offset / 8;
-		unsigned int bit  = offset % 8;
-		unsigned int shift = 16 - (bit + 9);
-		unsigned int value = (array_uint16_be (data + byte) >> shift) & 0x1FF;
-
-		// The 9th bit indicates whether the remaining 8 bits represent
-		// a run of zero bytes or not. If the bit is set, the value is
-		// not a run and doesn’t need expansion. If the bit is not set,
-		// the value contains the number of zero bytes in the run. A
-		// zero-length run indicates the end of the compressed stream.
-		if (value & 0x100) {
-			// Append the data byte directly.
-			unsigned char c = value & 0xFF;
-			if (!dc_buffer_append (buffer, &c, 1))
-				return -1;
-		} else if (value == 0) {
-			// Reached the end of the compressed stream.
-			if (isfinal)
-				*isfinal = 1;
-			break;
-		} else {
-			// Expand the run with zero bytes.
-			if (!dc_buffer_resize (buffer, dc_buffer_get_size (buffer) + value))
-				return -1;
-		}
-
-		offset += 9;
-	}
-
-	return 0;
-}
-
-
-static int
-shearwater_common_decompress_xor (unsigned char *data, unsigned int size)
-{
-	// Each block of 32 bytes is XOR'ed (in-place) with the previous block,
-	// except for the first block, which is passed through unchanged.
-	for (unsigned int i = 32; i < size; ++i) {
-		data[i] ^= data[i - 32];
-	}
-
-	return 0;
+	if (device->ble)
+		return dc_ble_close (device->ble);
+	else if (device->bluetooth)
+		return dc_bluetooth_close (device->bluetooth);
+	else
+		return dc_serial_close (device->port);
 }
 
 
@@ -144,45 +309,60 @@ static dc_status_t
 shearwater_common_slip_write (shearwater_common_device_t *device, const unsigned char data[], unsigned int size)
 {
 	dc_status_t status = DC_STATUS_SUCCESS;
-	const unsigned char end[] = {END};
-	const unsigned char esc_end[] = {ESC, ESC_END};
-	const unsigned char esc_esc[] = {ESC, ESC_ESC};
-	unsigned char buffer[32];
+	unsigned char buffer[2 * (SZ_PACKET + 4) + 1];
 	unsigned int nbytes = 0;
+	unsigned int offset = 0;
 
 #if 0
 	// Send an initial END character to flush out any data that may have
 	// accumulated in the receiver due to line noise.
-	status = dc_serial_write (device->port, end, sizeof (end), NULL);
+	const unsigned char end[] = {END};
+	status = shearwater_common_write (device, end, sizeof (end));
 	if (status != DC_STATUS_SUCCESS) {
 		return status;
 	}
 #endif
 
-	for (unsigned int i = 0; i < size; ++i) {
-		const unsigned char *seq = NULL;
-		unsigned int len = 0;
-		switch (data[i]) {
-		case END:
-			// Escape the END character.
-			seq = esc_end;
-			len = sizeof (esc_end);
-			break;
-		case ESC:
-			// Escape the ESC character.
-			seq = esc_esc;
-			len = sizeof (esc_esc);
-			break;
-		default:
-			// Normal character.
-			seq = data + i;
-			len = 1;
-			break;
+	while (offset < size) {
+		// Locate the first character that needs escaping. The clean run
+		// in front of it is copied in one go, so the common case costs a
+		// scan and a memcpy instead of a branch per byte.
+		const unsigned char *current = data + offset;
+		unsigned int remaining = size - offset;
+		const unsigned char *p_end = (const unsigned char *) memchr (current, END, remaining);
+		const unsigned char *p_esc = (const unsigned char *) memchr (current, ESC, remaining);
+		const unsigned char *special = p_end;
+		if (special == NULL || (p_esc && p_esc < special))
+			special = p_esc;
+
+		// Append the clean run, flushing the buffer when it fills up.
+		unsigned int len = special ? (unsigned int) (special - current) : remaining;
+		while (len) {
+			unsigned int space = sizeof (buffer) - nbytes;
+			if (space == 0) {
+				status = shearwater_common_write (device, buffer, nbytes);
+				if (status != DC_STATUS_SUCCESS) {
+					return status;
+				}
+
+				nbytes = 0;
+				space = sizeof (buffer);
+			}
+
+			unsigned int n = len < space ? len : space;
+			memcpy (buffer + nbytes, current, n);
+			nbytes += n;
+			current += n;
+			offset += n;
+			len -= n;
 		}
 
+		if (special == NULL)
+			break;
+
 		// Flush the buffer if necessary.
-		if (nbytes + len + sizeof(end) > sizeof(buffer)) {
-			status = dc_serial_write (device->port, buffer, nbytes, NULL);
+		if (nbytes + 2 > sizeof (buffer)) {
+			status = shearwater_common_write (device, buffer, nbytes);
 			if (status != DC_STATUS_SUCCESS) {
 				return status;
 			}
@@ -190,17 +370,27 @@ shearwater_common_slip_write (shearwater_common_device_t *device, const unsigned
 			nbytes = 0;
 		}
 
-		// Append the escaped character.
-		memcpy(buffer + nbytes, seq, len);
-		nbytes += len;
+		// Append the two byte escape sequence.
+		buffer[nbytes++] = ESC;
+		buffer[nbytes++] = (*special == END ? ESC_END : ESC_ESC);
+		offset++;
+	}
+
+	// Flush the buffer if necessary.
+	if (nbytes + 1 > sizeof (buffer)) {
+		status = shearwater_common_write (device, buffer, nbytes);
+		if (status != DC_STATUS_SUCCESS) {
+			return status;
+		}
+
+		nbytes = 0;
 	}
 
 	// Append the END character to indicate the end of the packet.
-	memcpy(buffer + nbytes, end, sizeof(end));
-	nbytes += sizeof(end);
+	buffer[nbytes++] = END;
 
 	// Flush the buffer.
-	status = dc_serial_write (device->port, buffer, nbytes, NULL);
+	status = shearwater_common_write (device, buffer, nbytes);
 	if (status != DC_STATUS_SUCCESS) {
 		return status;
 	}
@@ -218,52 +408,85 @@ shearwater_common_slip_read (shearwater_common_device_t *device, unsigned char d
 	// Read bytes until a complete packet has been received. If the
 	// buffer runs out of space, bytes are dropped. The caller can
 	// detect this condition because the return value will be larger
-	// than the supplied buffer size.
+	// than the supplied buffer size. Unprocessed bytes remain in the
+	// cache for the next packet.
 	while (1) {
-		unsigned char c = 0;
+		// Refill the cache when it runs empty.
+		if (device->cache_head == device->cache_tail) {
+			status = shearwater_common_fill (device);
+			if (status != DC_STATUS_SUCCESS) {
+				return status;
+			}
+		}
 
-		// Get a single character to process.
-		status = dc_serial_read (device->port, &c, 1, NULL);
-		if (status != DC_STATUS_SUCCESS) {
-			return status;
+		const unsigned char *cache = device->cache + device->cache_head;
+		unsigned int len = device->cache_tail - device->cache_head;
+
+		// Locate the first special character. The clean run in front of
+		// it is copied in one go, so the common case costs a scan and a
+		// memcpy instead of a branch per byte.
+		const unsigned char *p_end = (const unsigned char *) memchr (cache, END, len);
+		const unsigned char *p_esc = (const unsigned char *) memchr (cache, ESC, len);
+		const unsigned char *special = p_end;
+		if (special == NULL || (p_esc && p_esc < special))
+			special = p_esc;
+
+		// Copy the clean run.
+		unsigned int n = special ? (unsigned int) (special - cache) : len;
+		if (n) {
+			if (received < size) {
+				unsigned int ncopy = n;
+				if (ncopy > size - received)
+					ncopy = size - received;
+				memcpy (data + received, cache, ncopy);
+			}
+			received += n;
+			device->cache_head += n;
 		}
 
-		switch (c) {
-		case END:
+		if (special == NULL)
+			continue;
+
+		if (*special == END) {
 			// If it's an END character then we're done.
 			// As a minor optimization, empty packets are ignored. This
 			// is to avoid bothering the upper layers with all the empty
 			// packets generated by the duplicate END characters which
 			// are sent to try to detect line noise.
+			device->cache_head++;
 			if (received)
 				goto done;
 			else
-				break;
-		case ESC:
-			// If it's an ESC character, get another character and then
-			// figure out what to store in the packet based on that.
-			status = dc_serial_read (device->port, &c, 1, NULL);
+				continue;
+		}
+
+		// If it's an ESC character, get another character and then
+		// figure out what to store in the packet based on that.
+		device->cache_head++;
+		if (device->cache_head == device->cache_tail) {
+			status = shearwater_common_fill (device);
 			if (status != DC_STATUS_SUCCESS) {
 				return status;
 			}
+		}
 
-			// If it's not one of the two escaped characters, then we
-			// have a protocol violation. The best bet seems to be to
-			// leave the byte alone and just stuff it into the packet.
-			switch (c) {
-			case ESC_END:
-				c = END;
-				break;
-			case ESC_ESC:
-				c = ESC;
-				break;
-			}
-			// Fall-through!
-		default:
-			if (received < size)
-				data[received] = c;
-			received++;
+		unsigned char c = device->cache[device->cache_head++];
+
+		// If it's not one of the two escaped characters, then we
+		// have a protocol violation. The best bet seems to be to
+		// leave the byte alone and just stuff it into the packet.
+		switch (c) {
+		case ESC_END:
+			c = END;
+			break;
+		case ESC_ESC:
+			c = ESC;
+			break;
 		}
+
+		if (received < size)
+			data[received] = c;
+		received++;
 	}
 
 done:
@@ -363,8 +586,11 @@ shearwater_common_download (shearwater_common_device_t *device, dc_buffer_t *buf
 	unsigned char req_quit[] = {0x37};
 	unsigned char response[SZ_PACKET];
 
-	// Erase the current contents of the buffer.
-	if (!dc_buffer_clear (buffer)) {
+	// Erase the current contents of the buffer, and pre-allocate the
+	// requested number of bytes. The blocks arrive compressed, but the
+	// decompressed output is always exactly the requested size, so the
+	// buffer never has to grow while the download is in progress.
+	if (!dc_buffer_clear (buffer) || !dc_buffer_reserve (buffer, size)) {
 		ERROR (abstract->context, "Insufficient buffer space available.");
 		return DC_STATUS_NOMEMORY;
 	}
@@ -390,6 +616,14 @@ shearwater_common_download (shearwater_common_device_t *device, dc_buffer_t *buf
 	progress.current += 3;
 	device_event_emit (abstract, DC_EVENT_PROGRESS, &progress);
 
+	// Initialize the streaming decompressor. The decompressed data is
+	// appended to the output buffer as the blocks arrive, with the XOR
+	// phase applied on the fly (each block of 32 bytes is XOR'ed in
+	// place with the previous, already decoded, block, except for the
+	// first block, which is passed through unchanged).
+	dc_lre_t lre;
+	dc_lre_init (&lre, buffer, 32);
+
 	unsigned int done = 0;
 	unsigned char block = 1;
 	unsigned int nbytes = 0;
@@ -419,10 +653,11 @@ shearwater_common_download (shearwater_common_device_t *device, dc_buffer_t *buf
 		device_event_emit (abstract, DC_EVENT_PROGRESS, &progress);
 
 		if (compression) {
-			if (shearwater_common_decompress_lre (response + 2, length, buffer, &done) != 0) {
+			if (dc_lre_feed (&lre, response + 2, length) != 0) {
 				ERROR (abstract->context, "Decompression error (LRE phase).");
 				return DC_STATUS_PROTOCOL;
 			}
+			done = dc_lre_isfinished (&lre);
 		} else {
 			if (!dc_buffer_append (buffer, response + 2, length)) {
 				ERROR (abstract->context, "Insufficient buffer space available.");
@@ -434,13 +669,6 @@ shearwater_common_download (shearwater_common_device_t *device, dc_buffer_t *buf
 		block++;
 	}
 
-	if (compression) {
-		if (shearwater_common_decompress_xor (dc_buffer_get_data (buffer), dc_buffer_get_size (buffer)) != 0) {
-			ERROR (abstract->context, "Decompression error (XOR phase).");
-			return DC_STATUS_PROTOCOL;
-		}
-	}
-
 	// Transfer the quit request.
 	rc = shearwater_common_transfer (device, req_quit, sizeof (req_quit), response, 2, &n);
 	if (rc != DC_STATUS_SUCCESS) {
@@ -24,6 +24,8 @@
 
 #include "device-private.h"
 #include "serial.h"
+#include "bluetooth.h"
+#include "ble.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -35,6 +37,12 @@ extern "C" {
 typedef struct shearwater_common_device_t {
 	dc_device_t base;
 	dc_serial_t *port;
+	dc_bluetooth_t *bluetooth;
+	dc_ble_t *ble;
+	// Receive cache for the SLIP framing layer.
+	unsigned char cache[256];
+	unsigned int cache_head;
+	unsigned int cache_tail;
 } shearwater_common_device_t;
 
 dc_status_t
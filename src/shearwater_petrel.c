@@ -46,11 +46,13 @@ typedef struct shearwater_petrel_device_t {
 	unsigned char fingerprint[4];
 } shearwater_petrel_device_t;
 
+static dc_status_t shearwater_petrel_device_devinfo (dc_device_t *abstract);
 static dc_status_t shearwater_petrel_device_set_fingerprint (dc_device_t *abstract, const unsigned char data[], unsigned int size);
 static dc_status_t shearwater_petrel_device_foreach (dc_device_t *abstract, dc_dive_callback_t callback, void *userdata);
+static dc_status_t shearwater_petrel_device_enumerate (dc_device_t *abstract, dc_dive_summary_callback_t callback, void *userdata);
 static dc_status_t shearwater_petrel_device_close (dc_device_t *abstract);
 
-static const dc_device_vtable_t shearwater_petrel_device_vtable = {
+DC_VTABLE_STORAGE const dc_device_vtable_t shearwater_petrel_device_vtable = {
 	sizeof(shearwater_petrel_device_t),
 	DC_FAMILY_SHEARWATER_PETREL,
 	shearwater_petrel_device_set_fingerprint, /* set_fingerprint */
@@ -58,7 +60,12 @@ static const dc_device_vtable_t shearwater_petrel_device_vtable = {
 	NULL, /* write */
 	NULL, /* dump */
 	shearwater_petrel_device_foreach, /* foreach */
-	shearwater_petrel_device_close /* close */
+	shearwater_petrel_device_close, /* close */
+	NULL, /* foreach_buffer */
+	NULL, /* dump_delta */
+	NULL, /* read_multiple */
+	NULL, /* dump_stream */
+	shearwater_petrel_device_enumerate, /* enumerate */
 };
 
 
@@ -77,6 +84,59 @@ str2num (unsigned char data[], unsigned int size, unsigned int offset)
 }
 
 
+static dc_status_t
+shearwater_petrel_device_devinfo (dc_device_t *abstract)
+{
+	shearwater_petrel_device_t *device = (shearwater_petrel_device_t *) abstract;
+	dc_status_t rc = DC_STATUS_SUCCESS;
+
+	dc_buffer_t *buffer = dc_buffer_new (0);
+	if (buffer == NULL) {
+		ERROR (abstract->context, "Insufficient buffer space available.");
+		return DC_STATUS_NOMEMORY;
+	}
+
+	// Read the serial number.
+	rc = shearwater_common_identifier (&device->base, buffer, ID_SERIAL);
+	if (rc != DC_STATUS_SUCCESS) {
+		ERROR (abstract->context, "Failed to read the serial number.");
+		dc_buffer_free (buffer);
+		return rc;
+	}
+
+	// Convert to a number.
+	unsigned char serial[4] = {0};
+	if (array_convert_hex2bin (dc_buffer_get_data (buffer), dc_buffer_get_size (buffer),
+		serial, sizeof (serial)) != 0 ) {
+		ERROR (abstract->context, "Failed to convert the serial number.");
+		dc_buffer_free (buffer);
+		return DC_STATUS_DATAFORMAT;
+	}
+
+	// Read the firmware version.
+	rc = shearwater_common_identifier (&device->base, buffer, ID_FIRMWARE);
+	if (rc != DC_STATUS_SUCCESS) {
+		ERROR (abstract->context, "Failed to read the firmware version.");
+		dc_buffer_free (buffer);
+		return rc;
+	}
+
+	// Convert to a number.
+	unsigned int firmware = str2num (dc_buffer_get_data (buffer), dc_buffer_get_size (buffer), 1);
+
+	dc_buffer_free (buffer);
+
+	// Emit a device info event.
+	dc_event_devinfo_t devinfo;
+	devinfo.model = 3;
+	devinfo.firmware = firmware;
+	devinfo.serial = array_uint32_be (serial);
+	device_event_emit (abstract, DC_EVENT_DEVINFO, &devinfo);
+
+	return DC_STATUS_SUCCESS;
+}
+
+
 dc_status_t
 shearwater_petrel_device_open (dc_device_t **out, dc_context_t *context, const char *name)
 {
@@ -102,10 +162,20 @@ shearwater_petrel_device_open (dc_device_t **out, dc_context_t *context, const c
 		goto error_free;
 	}
 
+	// Read the device identification and emit the device info event, so
+	// the application learns the device identity right after the open,
+	// instead of deep into the first download.
+	status = shearwater_petrel_device_devinfo ((dc_device_t *) device);
+	if (status != DC_STATUS_SUCCESS) {
+		goto error_close;
+	}
+
 	*out = (dc_device_t *) device;
 
 	return DC_STATUS_SUCCESS;
 
+error_close:
+	shearwater_common_close (&device->base);
 error_free:
 	dc_device_deallocate ((dc_device_t *) device);
 	return status;
@@ -149,68 +219,47 @@ shearwater_petrel_device_foreach (dc_device_t *abstract, dc_dive_callback_t call
 	shearwater_petrel_device_t *device = (shearwater_petrel_device_t *) abstract;
 	dc_status_t rc = DC_STATUS_SUCCESS;
 
-	// Allocate memory buffers for the manifests.
-	dc_buffer_t *buffer = dc_buffer_new (MANIFEST_SIZE);
-	dc_buffer_t *manifests = dc_buffer_new (MANIFEST_SIZE);
-	if (buffer == NULL || manifests == NULL) {
+	// Allocate memory buffers for the manifest and the dive data. Two
+	// separate buffers are needed because the current manifest is still
+	// being processed while the dives are downloaded.
+	dc_buffer_t *manifest = dc_buffer_new (MANIFEST_SIZE);
+	dc_buffer_t *buffer = dc_buffer_new (0);
+	if (manifest == NULL || buffer == NULL) {
 		ERROR (abstract->context, "Insufficient buffer space available.");
+		dc_buffer_free (manifest);
 		dc_buffer_free (buffer);
-		dc_buffer_free (manifests);
 		return DC_STATUS_NOMEMORY;
 	}
 
-	// Read the serial number.
-	rc = shearwater_common_identifier (&device->base, buffer, ID_SERIAL);
-	if (rc != DC_STATUS_SUCCESS) {
-		ERROR (abstract->context, "Failed to read the serial number.");
-		dc_buffer_free (buffer);
-		dc_buffer_free (manifests);
-		return rc;
-	}
-
-	// Convert to a number.
-	unsigned char serial[4] = {0};
-	if (array_convert_hex2bin (dc_buffer_get_data (buffer), dc_buffer_get_size (buffer),
-		serial, sizeof (serial)) != 0 ) {
-		ERROR (abstract->context, "Failed to convert the serial number.");
-		dc_buffer_free (buffer);
-		dc_buffer_free (manifests);
-		return DC_STATUS_DATAFORMAT;
-
-	}
-
-	// Read the firmware version.
-	rc = shearwater_common_identifier (&device->base, buffer, ID_FIRMWARE);
-	if (rc != DC_STATUS_SUCCESS) {
-		ERROR (abstract->context, "Failed to read the firmware version.");
-		dc_buffer_free (buffer);
-		dc_buffer_free (manifests);
-		return rc;
-	}
-
-	// Convert to a number.
-	unsigned int firmware = str2num (dc_buffer_get_data (buffer), dc_buffer_get_size (buffer), 1);
-
-	// Emit a device info event.
-	dc_event_devinfo_t devinfo;
-	devinfo.model = 3;
-	devinfo.firmware = firmware;
-	devinfo.serial = array_uint32_be (serial);
-	device_event_emit (abstract, DC_EVENT_DEVINFO, &devinfo);
-
-	while (1) {
+	// Emit a device info event. The identification was already read
+	// when the device was opened, so re-emit the cached values instead
+	// of repeating the protocol exchanges.
+	device_event_emit (abstract, DC_EVENT_DEVINFO, &abstract->devinfo);
+
+	/*
+	 * The manifest is processed incrementally: the dives listed in a
+	 * manifest block are downloaded as soon as that block has arrived,
+	 * before the next manifest block is requested. Each download is a
+	 * self contained transaction with an explicit address, so the dive
+	 * downloads don't disturb the manifest walk. With a fingerprint set,
+	 * the walk already stops at the first matching record, and this way
+	 * the first new dive arrives right after the first manifest block
+	 * instead of after the entire manifest region has been read.
+	 */
+	unsigned int more = 1;
+	while (more) {
 		// Download a manifest.
-		rc = shearwater_common_download (&device->base, buffer, MANIFEST_ADDR, MANIFEST_SIZE, 0);
+		rc = shearwater_common_download (&device->base, manifest, MANIFEST_ADDR, MANIFEST_SIZE, 0);
 		if (rc != DC_STATUS_SUCCESS) {
 			ERROR (abstract->context, "Failed to download the manifest.");
+			dc_buffer_free (manifest);
 			dc_buffer_free (buffer);
-			dc_buffer_free (manifests);
 			return rc;
 		}
 
 		// Cache the buffer pointer and size.
-		unsigned char *data = dc_buffer_get_data (buffer);
-		unsigned int size = dc_buffer_get_size (buffer);
+		unsigned char *data = dc_buffer_get_data (manifest);
+		unsigned int size = dc_buffer_get_size (manifest);
 
 		// Process the records in the manifest.
 		unsigned int count = 0;
@@ -229,47 +278,116 @@ shearwater_petrel_device_foreach (dc_device_t *abstract, dc_dive_callback_t call
 			count++;
 		}
 
-		// Append the manifest records to the main buffer.
-		if (!dc_buffer_append (manifests, data, count * RECORD_SIZE)) {
-			ERROR (abstract->context, "Insufficient buffer space available.");
-			dc_buffer_free (buffer);
-			dc_buffer_free (manifests);
-			return DC_STATUS_NOMEMORY;
-		}
-
 		// Stop downloading manifest if there are no more records.
 		if (count != RECORD_COUNT)
-			break;
+			more = 0;
+
+		// Download the dives listed in this manifest.
+		offset = 0;
+		while (offset < count * RECORD_SIZE) {
+			// Get the address of the dive.
+			unsigned int address = array_uint32_be (data + offset + 20);
+
+			// Download the dive.
+			rc = shearwater_common_download (&device->base, buffer, DIVE_ADDR + address, DIVE_SIZE, 1);
+			if (rc != DC_STATUS_SUCCESS) {
+				ERROR (abstract->context, "Failed to download the dive.");
+				dc_buffer_free (manifest);
+				dc_buffer_free (buffer);
+				return rc;
+			}
+
+			unsigned char *buf = dc_buffer_get_data (buffer);
+			unsigned int len = dc_buffer_get_size (buffer);
+			if (callback && !callback (buf, len, buf + 12, sizeof (device->fingerprint), userdata)) {
+				more = 0;
+				break;
+			}
+
+			offset += RECORD_SIZE;
+		}
 	}
 
-	// Cache the buffer pointer and size.
-	unsigned char *data = dc_buffer_get_data (manifests);
-	unsigned int size = dc_buffer_get_size (manifests);
+	dc_buffer_free (manifest);
+	dc_buffer_free (buffer);
+
+	return rc;
+}
 
-	unsigned int offset = 0;
-	while (offset < size) {
-		// Get the address of the dive.
-		unsigned int address = array_uint32_be (data + offset + 20);
 
-		// Download the dive.
-		rc = shearwater_common_download (&device->base, buffer, DIVE_ADDR + address, DIVE_SIZE, 1);
+static dc_status_t
+shearwater_petrel_device_enumerate (dc_device_t *abstract, dc_dive_summary_callback_t callback, void *userdata)
+{
+	shearwater_petrel_device_t *device = (shearwater_petrel_device_t *) abstract;
+	dc_status_t rc = DC_STATUS_SUCCESS;
+
+	// Allocate a memory buffer for the manifest.
+	dc_buffer_t *manifest = dc_buffer_new (MANIFEST_SIZE);
+	if (manifest == NULL) {
+		ERROR (abstract->context, "Insufficient buffer space available.");
+		return DC_STATUS_NOMEMORY;
+	}
+
+	// Walk the manifest blocks without downloading the dives. Each
+	// record already contains the fingerprint and the dive header, so
+	// the identities come from the manifest region alone. With a
+	// fingerprint set, the walk stops at the first matching record.
+	unsigned int ndives = 0;
+	unsigned int more = 1;
+	while (more) {
+		// Download a manifest.
+		rc = shearwater_common_download (&device->base, manifest, MANIFEST_ADDR, MANIFEST_SIZE, 0);
 		if (rc != DC_STATUS_SUCCESS) {
-			ERROR (abstract->context, "Failed to download the dive.");
-			dc_buffer_free (buffer);
-			dc_buffer_free (manifests);
+			ERROR (abstract->context, "Failed to download the manifest.");
+			dc_buffer_free (manifest);
 			return rc;
 		}
 
-		unsigned char *buf = dc_buffer_get_data (buffer);
-		unsigned int len = dc_buffer_get_size (buffer);
-		if (callback && !callback (buf, len, buf + 12, sizeof (device->fingerprint), userdata))
-			break;
+		// Cache the buffer pointer and size.
+		unsigned char *data = dc_buffer_get_data (manifest);
+		unsigned int size = dc_buffer_get_size (manifest);
+
+		// Process the records in the manifest.
+		unsigned int count = 0;
+		unsigned int offset = 0;
+		while (offset < size) {
+			// Check for a valid dive header.
+			unsigned int header = array_uint16_be (data + offset);
+			if (header != 0xA5C4)
+				break;
 
-		offset += RECORD_SIZE;
+			// Check the fingerprint data.
+			if (memcmp (data + offset + 4, device->fingerprint, sizeof (device->fingerprint)) == 0)
+				break;
+
+			offset += RECORD_SIZE;
+			count++;
+		}
+
+		// Stop downloading manifest if there are no more records.
+		if (count != RECORD_COUNT)
+			more = 0;
+
+		// Deliver the dives listed in this manifest.
+		offset = 0;
+		while (offset < count * RECORD_SIZE) {
+			dc_dive_summary_t summary;
+			summary.number = ++ndives;
+			summary.fingerprint = data + offset + 4;
+			summary.fsize = sizeof (device->fingerprint);
+			summary.data = data + offset;
+			summary.size = RECORD_SIZE;
+			summary.datasize = 0;
+			if (callback && !callback (&summary, userdata)) {
+				more = 0;
+				break;
+			}
+
+			offset += RECORD_SIZE;
+		}
 	}
 
-	dc_buffer_free (manifests);
-	dc_buffer_free (buffer);
+	dc_buffer_free (manifest);
 
 	return rc;
 }
@@ -51,7 +51,7 @@ static dc_status_t shearwater_predator_device_dump (dc_device_t *abstract, dc_bu
 static dc_status_t shearwater_predator_device_foreach (dc_device_t *abstract, dc_dive_callback_t callback, void *userdata);
 static dc_status_t shearwater_predator_device_close (dc_device_t *abstract);
 
-static const dc_device_vtable_t shearwater_predator_device_vtable = {
+DC_VTABLE_STORAGE const dc_device_vtable_t shearwater_predator_device_vtable = {
 	sizeof(shearwater_predator_device_t),
 	DC_FAMILY_SHEARWATER_PREDATOR,
 	shearwater_predator_device_set_fingerprint, /* set_fingerprint */
@@ -69,7 +69,7 @@ static dc_status_t shearwater_predator_parser_get_datetime (dc_parser_t *abstrac
 static dc_status_t shearwater_predator_parser_get_field (dc_parser_t *abstract, dc_field_type_t type, unsigned int flags, void *value);
 static dc_status_t shearwater_predator_parser_samples_foreach (dc_parser_t *abstract, dc_sample_callback_t callback, void *userdata);
 
-static const dc_parser_vtable_t shearwater_predator_parser_vtable = {
+DC_VTABLE_STORAGE const dc_parser_vtable_t shearwater_predator_parser_vtable = {
 	sizeof(shearwater_predator_parser_t),
 	DC_FAMILY_SHEARWATER_PREDATOR,
 	shearwater_predator_parser_set_data, /* set_data */
@@ -79,7 +79,7 @@ static const dc_parser_vtable_t shearwater_predator_parser_vtable = {
 	NULL /* destroy */
 };
 
-static const dc_parser_vtable_t shearwater_petrel_parser_vtable = {
+DC_VTABLE_STORAGE const dc_parser_vtable_t shearwater_petrel_parser_vtable = {
 	sizeof(shearwater_predator_parser_t),
 	DC_FAMILY_SHEARWATER_PETREL,
 	shearwater_predator_parser_set_data, /* set_data */
@@ -399,9 +399,9 @@ shearwater_predator_parser_samples_foreach (dc_parser_t *abstract, dc_sample_cal
 		// Depth (1/10 m or ft).
 		unsigned int depth = array_uint16_be (data + offset);
 		if (units == IMPERIAL)
-			sample.depth = depth * FEET / 10.0;
+			sample.depth = array_scale (depth, FEET, 10);
 		else
-			sample.depth = depth / 10.0;
+			sample.depth = array_scale (depth, 1, 10);
 		if (callback) callback (DC_SAMPLE_DEPTH, sample, userdata);
 
 		// Temperature (°C or °F).
@@ -414,7 +414,7 @@ shearwater_predator_parser_samples_foreach (dc_parser_t *abstract, dc_sample_cal
 			}
 		}
 		if (units == IMPERIAL)
-			sample.temperature = (temperature - 32.0) * (5.0 / 9.0);
+			sample.temperature = FAHRENHEIT_TO_CELSIUS (temperature);
 		else
 			sample.temperature = temperature;
 		if (callback) callback (DC_SAMPLE_TEMPERATURE, sample, userdata);
@@ -423,18 +423,18 @@ shearwater_predator_parser_samples_foreach (dc_parser_t *abstract, dc_sample_cal
 		unsigned int status = data[offset + 11];
 
 		// PPO2
-		sample.ppo2 = data[offset + 6] / 100.0;
+		sample.ppo2 = array_scale (data[offset + 6], 1, 100);
 		if (callback) callback (DC_SAMPLE_PPO2, sample, userdata);
 
 		if ((status & OC) == 0) {
 			// Setpoint
 			if (parser->petrel) {
-				sample.setpoint = data[offset + 18] / 100.0;
+				sample.setpoint = array_scale (data[offset + 18], 1, 100);
 			} else {
 				if (status & SETPOINT_HIGH) {
-					sample.setpoint = data[18] / 100.0;
+					sample.setpoint = array_scale (data[18], 1, 100);
 				} else {
-					sample.setpoint = data[17] / 100.0;
+					sample.setpoint = array_scale (data[17], 1, 100);
 				}
 			}
 			if (callback) callback (DC_SAMPLE_SETPOINT, sample, userdata);
@@ -442,7 +442,7 @@ shearwater_predator_parser_samples_foreach (dc_parser_t *abstract, dc_sample_cal
 
 		// CNS
 		if (parser->petrel) {
-			sample.cns = data[offset + 22] / 100.0;
+			sample.cns = array_scale (data[offset + 22], 1, 100);
 			if (callback) callback (DC_SAMPLE_CNS, sample, userdata);
 		}
 
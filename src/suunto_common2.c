@@ -48,13 +48,21 @@ suunto_common2_device_init (suunto_common2_device_t *device)
 	// Set the default values.
 	device->layout = NULL;
 	memset (device->version, 0, sizeof (device->version));
+	device->version_valid = 0;
 	memset (device->fingerprint, 0, sizeof (device->fingerprint));
+	device->retries = 0;
+
+	// Pre-size the scratch region for the transfer loops. Not fatal
+	// on failure: a later push grows the region on demand.
+	device_scratch_reserve ((dc_device_t *) device, SZ_PACKET + 7);
 }
 
 
 static dc_status_t
 suunto_common2_transfer (dc_device_t *abstract, const unsigned char command[], unsigned int csize, unsigned char answer[], unsigned int asize, unsigned int size)
 {
+	suunto_common2_device_t *device = (suunto_common2_device_t *) abstract;
+
 	assert (asize >= size + 4);
 
 	if (VTABLE (abstract)->packet == NULL)
@@ -74,8 +82,10 @@ suunto_common2_transfer (dc_device_t *abstract, const unsigned char command[], u
 			return rc;
 
 		// Abort if the maximum number of retries is reached.
-		if (nretries++ >= MAXRETRIES)
+		if (nretries++ >= device_retry_limit (abstract, MAXRETRIES))
 			return rc;
+
+		device->retries++;
 	}
 
 	return rc;
@@ -102,18 +112,70 @@ suunto_common2_device_set_fingerprint (dc_device_t *abstract, const unsigned cha
 dc_status_t
 suunto_common2_device_version (dc_device_t *abstract, unsigned char data[], unsigned int size)
 {
+	suunto_common2_device_t *device = (suunto_common2_device_t*) abstract;
+
 	if (size < SZ_VERSION) {
 		ERROR (abstract->context, "Insufficient buffer space available.");
 		return DC_STATUS_INVALIDARGS;
 	}
 
-	unsigned char answer[SZ_VERSION + 4] = {0};
-	unsigned char command[4] = {0x0F, 0x00, 0x00, 0x0F};
-	dc_status_t rc = suunto_common2_transfer (abstract, command, sizeof (command), answer, sizeof (answer), 4);
-	if (rc != DC_STATUS_SUCCESS)
+	// The version info is a device constant, so the answer of the first
+	// exchange is cached for the remainder of the session, and repeated
+	// calls are served without a transfer.
+	if (!device->version_valid) {
+		unsigned char answer[SZ_VERSION + 4] = {0};
+		unsigned char command[4] = {0x0F, 0x00, 0x00, 0x0F};
+		dc_status_t rc = suunto_common2_transfer (abstract, command, sizeof (command), answer, sizeof (answer), 4);
+		if (rc != DC_STATUS_SUCCESS)
+			return rc;
+
+		memcpy (device->version, answer + 3, SZ_VERSION);
+		device->version_valid = 1;
+	}
+
+	if (data != device->version)
+		memcpy (data, device->version, SZ_VERSION);
+
+	return DC_STATUS_SUCCESS;
+}
+
+
+dc_status_t
+suunto_common2_device_devinfo (dc_device_t *abstract)
+{
+	suunto_common2_device_t *device = (suunto_common2_device_t*) abstract;
+
+	assert (device != NULL);
+	assert (device->layout != NULL);
+
+	const suunto_common2_layout_t *layout = device->layout;
+
+	// The serial number is a device constant too: once the event was
+	// emitted (and cached) during this session, re-emit the cached copy
+	// instead of repeating the multi-packet memory read.
+	if (abstract->devinfo_valid) {
+		device_event_emit (abstract, DC_EVENT_DEVINFO, &abstract->devinfo);
+		return DC_STATUS_SUCCESS;
+	}
+
+	// Read the serial number.
+	unsigned char serial[SZ_MINIMUM > 4 ? SZ_MINIMUM : 4] = {0};
+	dc_status_t rc = suunto_common2_device_read (abstract, layout->serial, serial, sizeof (serial));
+	if (rc != DC_STATUS_SUCCESS) {
+		ERROR (abstract->context, "Failed to read the serial number.");
 		return rc;
+	}
 
-	memcpy (data, answer + 3, SZ_VERSION);
+	// Emit a device info event.
+	dc_event_devinfo_t devinfo;
+	devinfo.model = device->version[0];
+	devinfo.firmware = array_uint24_be (device->version + 1);
+	devinfo.serial = 0;
+	for (unsigned int i = 0; i < 4; ++i) {
+		devinfo.serial *= 100;
+		devinfo.serial += serial[i];
+	}
+	device_event_emit (abstract, DC_EVENT_DEVINFO, &devinfo);
 
 	return DC_STATUS_SUCCESS;
 }
@@ -135,6 +197,11 @@ suunto_common2_device_reset_maxdepth (dc_device_t *abstract)
 dc_status_t
 suunto_common2_device_read (dc_device_t *abstract, unsigned int address, unsigned char data[], unsigned int size)
 {
+	// The answer buffer is reused for every packet.
+	unsigned char *answer = device_scratch_push (abstract, SZ_PACKET + 7);
+	if (answer == NULL)
+		return DC_STATUS_NOMEMORY;
+
 	unsigned int nbytes = 0;
 	while (nbytes < size) {
 		// Calculate the package size.
@@ -143,7 +210,6 @@ suunto_common2_device_read (dc_device_t *abstract, unsigned int address, unsigne
 			len = SZ_PACKET;
 
 		// Read the package.
-		unsigned char answer[SZ_PACKET + 7] = {0};
 		unsigned char command[7] = {0x05, 0x00, 0x03,
 				(address >> 8) & 0xFF, // high
 				(address     ) & 0xFF, // low
@@ -151,8 +217,10 @@ suunto_common2_device_read (dc_device_t *abstract, unsigned int address, unsigne
 				0};  // CRC
 		command[6] = checksum_xor_uint8 (command, 6, 0x00);
 		dc_status_t rc = suunto_common2_transfer (abstract, command, sizeof (command), answer, len + 7, len);
-		if (rc != DC_STATUS_SUCCESS)
+		if (rc != DC_STATUS_SUCCESS) {
+			device_scratch_pop (abstract, SZ_PACKET + 7);
 			return rc;
+		}
 
 		memcpy (data, answer + 6, len);
 
@@ -161,6 +229,8 @@ suunto_common2_device_read (dc_device_t *abstract, unsigned int address, unsigne
 		data += len;
 	}
 
+	device_scratch_pop (abstract, SZ_PACKET + 7);
+
 	return DC_STATUS_SUCCESS;
 }
 
@@ -168,6 +238,11 @@ suunto_common2_device_read (dc_device_t *abstract, unsigned int address, unsigne
 dc_status_t
 suunto_common2_device_write (dc_device_t *abstract, unsigned int address, const unsigned char data[], unsigned int size)
 {
+	// The command buffer is reused for every packet.
+	unsigned char *command = device_scratch_push (abstract, SZ_PACKET + 7);
+	if (command == NULL)
+		return DC_STATUS_NOMEMORY;
+
 	unsigned int nbytes = 0;
 	while (nbytes < size) {
 		// Calculate the package size.
@@ -177,22 +252,27 @@ suunto_common2_device_write (dc_device_t *abstract, unsigned int address, const
 
 		// Write the package.
 		unsigned char answer[7] = {0};
-		unsigned char command[SZ_PACKET + 7] = {0x06, 0x00, len + 3,
-				(address >> 8) & 0xFF, // high
-				(address     ) & 0xFF, // low
-				len, // count
-				0};  // data + CRC
+		command[0] = 0x06;
+		command[1] = 0x00;
+		command[2] = len + 3;
+		command[3] = (address >> 8) & 0xFF; // high
+		command[4] = (address     ) & 0xFF; // low
+		command[5] = len; // count
 		memcpy (command + 6, data, len);
 		command[len + 6] = checksum_xor_uint8 (command, len + 6, 0x00);
 		dc_status_t rc = suunto_common2_transfer (abstract, command, len + 7, answer, sizeof (answer), 0);
-		if (rc != DC_STATUS_SUCCESS)
+		if (rc != DC_STATUS_SUCCESS) {
+			device_scratch_pop (abstract, SZ_PACKET + 7);
 			return rc;
+		}
 
 		nbytes += len;
 		address += len;
 		data += len;
 	}
 
+	device_scratch_pop (abstract, SZ_PACKET + 7);
+
 	return DC_STATUS_SUCCESS;
 }
 
@@ -238,8 +318,7 @@ suunto_common2_device_foreach (dc_device_t *abstract, dc_dive_callback_t callbac
 
 	// Enable progress notifications.
 	dc_event_progress_t progress = EVENT_PROGRESS_INITIALIZER;
-	progress.maximum = layout->rb_profile_end - layout->rb_profile_begin +
-		8 + (SZ_MINIMUM > 4 ? SZ_MINIMUM : 4);
+	progress.maximum = layout->rb_profile_end - layout->rb_profile_begin + 8;
 	device_event_emit (abstract, DC_EVENT_PROGRESS, &progress);
 
 	// Emit a vendor event.
@@ -248,32 +327,14 @@ suunto_common2_device_foreach (dc_device_t *abstract, dc_dive_callback_t callbac
 	vendor.size = sizeof (device->version);
 	device_event_emit (abstract, DC_EVENT_VENDOR, &vendor);
 
-	// Read the serial number.
-	unsigned char serial[SZ_MINIMUM > 4 ? SZ_MINIMUM : 4] = {0};
-	dc_status_t rc = suunto_common2_device_read (abstract, layout->serial, serial, sizeof (serial));
-	if (rc != DC_STATUS_SUCCESS) {
-		ERROR (abstract->context, "Failed to read the memory header.");
-		return rc;
-	}
-
-	// Update and emit a progress event.
-	progress.current += sizeof (serial);
-	device_event_emit (abstract, DC_EVENT_PROGRESS, &progress);
-
-	// Emit a device info event.
-	dc_event_devinfo_t devinfo;
-	devinfo.model = device->version[0];
-	devinfo.firmware = array_uint24_be (device->version + 1);
-	devinfo.serial = 0;
-	for (unsigned int i = 0; i < 4; ++i) {
-		devinfo.serial *= 100;
-		devinfo.serial += serial[i];
-	}
-	device_event_emit (abstract, DC_EVENT_DEVINFO, &devinfo);
+	// Emit a device info event. The serial number was already read when
+	// the device was opened, so re-emit the cached values instead of
+	// repeating the protocol exchange.
+	device_event_emit (abstract, DC_EVENT_DEVINFO, &abstract->devinfo);
 
 	// Read the header bytes.
 	unsigned char header[8] = {0};
-	rc = suunto_common2_device_read (abstract, 0x0190, header, sizeof (header));
+	dc_status_t rc = suunto_common2_device_read (abstract, 0x0190, header, sizeof (header));
 	if (rc != DC_STATUS_SUCCESS) {
 		ERROR (abstract->context, "Failed to read the memory header.");
 		return rc;
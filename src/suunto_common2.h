@@ -44,7 +44,9 @@ typedef struct suunto_common2_device_t {
 	dc_device_t base;
 	const suunto_common2_layout_t *layout;
 	unsigned char version[4];
+	unsigned int version_valid;
 	unsigned char fingerprint[7];
+	unsigned int retries;
 } suunto_common2_device_t;
 
 typedef struct suunto_common2_device_vtable_t {
@@ -61,6 +63,15 @@ suunto_common2_device_set_fingerprint (dc_device_t *device, const unsigned char
 dc_status_t
 suunto_common2_device_version (dc_device_t *device, unsigned char data[], unsigned int size);
 
+/*
+ * Read the serial number and emit the DC_EVENT_DEVINFO event. Intended
+ * to be called at the end of the device open, after the version info
+ * and the memory layout have been established, so the application
+ * learns the device identity right after the open.
+ */
+dc_status_t
+suunto_common2_device_devinfo (dc_device_t *device);
+
 dc_status_t
 suunto_common2_device_read (dc_device_t *device, unsigned int address, unsigned char data[], unsigned int size);
 
@@ -154,6 +154,9 @@ suunto_d9_device_open (dc_device_t **out, dc_context_t *context, const char *nam
 		goto error_free;
 	}
 
+	// Forward cancellation requests to the serial layer.
+	dc_serial_set_cancel (device->port, device_cancel_cb, device);
+
 	// Set the serial communication protocol (9600 8N1).
 	status = dc_serial_configure (device->port, 9600, 8, DC_PARITY_NONE, DC_STOPBITS_ONE, DC_FLOWCONTROL_NONE);
 	if (status != DC_STATUS_SUCCESS) {
@@ -198,6 +201,12 @@ suunto_d9_device_open (dc_device_t **out, dc_context_t *context, const char *nam
 	else
 		device->base.layout = &suunto_d9_layout;
 
+	// Read the serial number and emit the device info event.
+	status = suunto_common2_device_devinfo ((dc_device_t *) device);
+	if (status != DC_STATUS_SUCCESS) {
+		goto error_close;
+	}
+
 	*out = (dc_device_t*) device;
 
 	return DC_STATUS_SUCCESS;
@@ -217,6 +226,13 @@ suunto_d9_device_close (dc_device_t *abstract)
 	suunto_d9_device_t *device = (suunto_d9_device_t*) abstract;
 	dc_status_t rc = DC_STATUS_SUCCESS;
 
+	// Emit the transfer statistics of the session.
+	dc_event_metrics_t metrics;
+	if (dc_serial_get_metrics (device->port, &metrics) == DC_STATUS_SUCCESS) {
+		metrics.retries = device->base.retries;
+		device_event_emit (abstract, DC_EVENT_METRICS, &metrics);
+	}
+
 	// Close the device.
 	rc = dc_serial_close (device->port);
 	if (rc != DC_STATUS_SUCCESS) {
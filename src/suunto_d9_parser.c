@@ -30,6 +30,8 @@
 
 #define ISINSTANCE(parser) dc_parser_isinstance((parser), &suunto_d9_parser_vtable)
 
+#define C_ARRAY_SIZE(a) (sizeof(a) / sizeof(*(a)))
+
 #define MAXPARAMS 3
 #define NGASMIXES 11
 
@@ -67,6 +69,125 @@
 #define DECOSTOP     (1 << 1)
 #define DEEPSTOP     (1 << 2)
 
+/*
+ * Translation table for the alarm/warning events (event 0x03), indexed
+ * by the event type. The decomask field lists the in_deco bits set (or
+ * cleared, for an end event) by the event.
+ */
+typedef struct suunto_d9_event_info_t {
+	unsigned int type;     // SAMPLE_EVENT_*
+	unsigned int value;
+	unsigned int decomask;
+} suunto_d9_event_info_t;
+
+static const suunto_d9_event_info_t g_events[] = {
+	{SAMPLE_EVENT_SAFETYSTOP_VOLUNTARY, 0,   SAFETYSTOP}, // 0x00: Voluntary Safety Stop
+	{SAMPLE_EVENT_SAFETYSTOP_MANDATORY, 0,   DECOSTOP},   // 0x01: Mandatory Safety Stop - odd concept; model as deco stop
+	{SAMPLE_EVENT_DEEPSTOP,             0,   DEEPSTOP},   // 0x02: Deep Safety Stop
+	{SAMPLE_EVENT_DECOSTOP,             0,   DECOSTOP},   // 0x03: Deco
+	{SAMPLE_EVENT_ASCENT,               0,   0},          // 0x04: Ascent Rate Warning
+	{SAMPLE_EVENT_CEILING,              0,   0},          // 0x05: Ceiling Broken
+	{SAMPLE_EVENT_CEILING_SAFETYSTOP,   0,   0},          // 0x06: Mandatory Safety Stop Ceiling Error
+	{SAMPLE_EVENT_FLOOR,                0,   0},          // 0x07: Below Deco Floor
+	{SAMPLE_EVENT_DIVETIME,             0,   0},          // 0x08: Dive Time
+	{SAMPLE_EVENT_MAXDEPTH,             0,   0},          // 0x09: Depth Alarm
+	{SAMPLE_EVENT_OLF,                  80,  0},          // 0x0A: OLF 80
+	{SAMPLE_EVENT_OLF,                  100, 0},          // 0x0B: OLF 100
+	{SAMPLE_EVENT_PO2,                  0,   0},          // 0x0C: PO2
+	{SAMPLE_EVENT_AIRTIME,              0,   0},          // 0x0D: Air Time Warning
+	{SAMPLE_EVENT_RGBM,                 0,   0},          // 0x0E: RGBM Warning
+	{SAMPLE_EVENT_PO2,                  0,   0},          // 0x0F: PO2 High
+	{SAMPLE_EVENT_PO2,                  0,   0},          // 0x10: PO2 Low
+	{SAMPLE_EVENT_TISSUELEVEL,          0,   0},          // 0x11: Tissue Level Warning
+	{SAMPLE_EVENT_TISSUELEVEL,          0,   0},          // 0x12: Tissue Calc Overflow
+	{SAMPLE_EVENT_DEEPSTOP,             0,   DEEPSTOP},   // 0x13: Deep Safety Stop
+	{SAMPLE_EVENT_SAFETYSTOP_MANDATORY, 0,   DECOSTOP},   // 0x14: Mandatory Safety Stop - again, model as deco stop
+};
+
+// Header layout, one per model family. All the header offsets live in
+// this table, and the header is decoded in a single pass (see
+// suunto_d9_parser_cache), so adding an OEM variant means adding a
+// table entry instead of touching every offset calculation. The models
+// with a logbook id tag moved some fields between firmware revisions;
+// those entries carry both offsets, selected by the id at decode time.
+typedef struct suunto_d9_layout_t {
+	unsigned int datetime; // Offset of the 7 byte timestamp.
+	unsigned int datetime_yearfirst; // Year first instead of hour first.
+	unsigned int divetime;
+	unsigned int divetime_scale; // Seconds per unit.
+	unsigned int gasmode;
+	unsigned int gasmix;
+	unsigned int gasmix_v2; // Offset for the V2 logbook id.
+	unsigned int gasmix_count;
+	unsigned int gasmix_size; // Bytes per gasmix entry.
+	unsigned int initial; // Initial gasmix (zero if absent).
+	unsigned int initial_v2;
+	unsigned int config; // Zero if located after the gasmix table.
+} suunto_d9_layout_t;
+
+static const suunto_d9_layout_t suunto_d9_layout_default = {
+	0x11, /* datetime */ 0, /* datetime_yearfirst */
+	0x0B, /* divetime */ 60, /* divetime_scale */
+	0x19, /* gasmode */
+	0x21, 0x21, /* gasmix */ 3, /* gasmix_count */ 1, /* gasmix_size */
+	0, 0, /* initial */
+	0x3A /* config */
+};
+
+static const suunto_d9_layout_t suunto_d9_layout_d4 = {
+	0x11, /* datetime */ 0, /* datetime_yearfirst */
+	0x0B, /* divetime */ 1, /* divetime_scale */
+	0x19, /* gasmode */
+	0x21, 0x21, /* gasmix */ 3, /* gasmix_count */ 1, /* gasmix_size */
+	0, 0, /* initial */
+	0x3B /* config */
+};
+
+static const suunto_d9_layout_t suunto_d9_layout_helo2 = {
+	0x17, /* datetime */ 0, /* datetime_yearfirst */
+	0x0D, /* divetime */ 60, /* divetime_scale */
+	0x1F, /* gasmode */
+	0x54, 0x54, /* gasmix */ 8, /* gasmix_count */ 6, /* gasmix_size */
+	0x26, 0x26, /* initial */
+	0 /* config */
+};
+
+static const suunto_d9_layout_t suunto_d9_layout_d4i = {
+	0x13, /* datetime */ 1, /* datetime_yearfirst */
+	0x0D, /* divetime */ 1, /* divetime_scale */
+	0x1D, /* gasmode */
+	0x5F, 0x67, /* gasmix */ 1, /* gasmix_count */ 6, /* gasmix_size */
+	0x28, 0x2D, /* initial */
+	0 /* config */
+};
+
+static const suunto_d9_layout_t suunto_d9_layout_d6i = {
+	0x13, /* datetime */ 1, /* datetime_yearfirst */
+	0x0D, /* divetime */ 1, /* divetime_scale */
+	0x1D, /* gasmode */
+	0x5F, 0x67, /* gasmix */ 2, /* gasmix_count */ 6, /* gasmix_size */
+	0x28, 0x2D, /* initial */
+	0 /* config */
+};
+
+static const suunto_d9_layout_t suunto_d9_layout_d9tx = {
+	0x13, /* datetime */ 1, /* datetime_yearfirst */
+	0x0D, /* divetime */ 1, /* divetime_scale */
+	0x1D, /* gasmode */
+	0x87, 0x87, /* gasmix */ 8, /* gasmix_count */ 6, /* gasmix_size */
+	0x28, 0x2D, /* initial */
+	0 /* config */
+};
+
+static const suunto_d9_layout_t suunto_d9_layout_dx = {
+	0x17, /* datetime */ 1, /* datetime_yearfirst */
+	0x0D, /* divetime */ 1, /* divetime_scale */
+	0x21, /* gasmode */
+	0xC1, 0xC3, /* gasmix */ 11, /* gasmix_count */ 6, /* gasmix_size */
+	0, 0, /* initial */
+	0 /* config */
+};
+
 typedef struct suunto_d9_parser_t suunto_d9_parser_t;
 
 struct suunto_d9_parser_t {
@@ -74,6 +195,9 @@ struct suunto_d9_parser_t {
 	unsigned int model;
 	// Cached fields.
 	unsigned int cached;
+	dc_datetime_t datetime;
+	unsigned int divetime;
+	double maxdepth;
 	unsigned int mode;
 	unsigned int ngasmixes;
 	unsigned int oxygen[NGASMIXES];
@@ -94,7 +218,7 @@ static dc_status_t suunto_d9_parser_get_datetime (dc_parser_t *abstract, dc_date
 static dc_status_t suunto_d9_parser_get_field (dc_parser_t *abstract, dc_field_type_t type, unsigned int flags, void *value);
 static dc_status_t suunto_d9_parser_samples_foreach (dc_parser_t *abstract, dc_sample_callback_t callback, void *userdata);
 
-static const dc_parser_vtable_t suunto_d9_parser_vtable = {
+DC_VTABLE_STORAGE const dc_parser_vtable_t suunto_d9_parser_vtable = {
 	sizeof(suunto_d9_parser_t),
 	DC_FAMILY_SUUNTO_D9,
 	suunto_d9_parser_set_data, /* set_data */
@@ -118,6 +242,32 @@ suunto_d9_parser_find_gasmix (suunto_d9_parser_t *parser, unsigned int o2, unsig
 	return i;
 }
 
+static const suunto_d9_layout_t *
+suunto_d9_parser_layout (unsigned int model)
+{
+	switch (model) {
+	case D4:
+		return &suunto_d9_layout_d4;
+	case HELO2:
+		return &suunto_d9_layout_helo2;
+	case D4i:
+	case ZOOPNOVO:
+		return &suunto_d9_layout_d4i;
+	case D6i:
+	case VYPERNOVO:
+		return &suunto_d9_layout_d6i;
+	case D9tx:
+		return &suunto_d9_layout_d9tx;
+	case DX:
+		return &suunto_d9_layout_dx;
+	default:
+		return &suunto_d9_layout_default;
+	}
+}
+
+// Decode the entire header in a single pass, and cache the results.
+// The datetime and field queries are served from the cache, so the
+// offset arithmetic is confined to this function and the layout table.
 static dc_status_t
 suunto_d9_parser_cache (suunto_d9_parser_t *parser)
 {
@@ -128,62 +278,57 @@ suunto_d9_parser_cache (suunto_d9_parser_t *parser)
 		return DC_STATUS_SUCCESS;
 	}
 
-	// Get the logbook id tag.
-	unsigned int id = array_uint32_le (data + 1);
+	if (size < 5)
+		return DC_STATUS_DATAFORMAT;
 
-	// Gasmix information.
-	unsigned int gasmode_offset = 0x19;
-	unsigned int gasmix_offset = 0x21;
-	unsigned int gasmix_count = 3;
-	if (parser->model == HELO2) {
-		gasmode_offset = 0x1F;
-		gasmix_offset = 0x54;
-		gasmix_count = 8;
-	} else if (parser->model == D4i || parser->model == ZOOPNOVO) {
-		gasmode_offset = 0x1D;
-		if (id == ID_D4I_V2)
-			gasmix_offset = 0x67;
-		else
-			gasmix_offset = 0x5F;
-		gasmix_count = 1;
-	} else if (parser->model == D6i || parser->model == VYPERNOVO) {
-		gasmode_offset = 0x1D;
-		if (id == ID_D6I_V2)
-			gasmix_offset = 0x67;
-		else
-			gasmix_offset = 0x5F;
-		if (id == ID_D6I_V1_MIX3 || id == ID_D6I_V2)
-			gasmix_count = 3;
-		else
-			gasmix_count = 2;
-	} else if (parser->model == D9tx) {
-		gasmode_offset = 0x1D;
-		gasmix_offset = 0x87;
-		gasmix_count = 8;
-	} else if (parser->model == DX) {
-		gasmode_offset = 0x21;
-		if (id == ID_DX_V2)
-			gasmix_offset = 0xC3;
-		else
-			gasmix_offset = 0xC1;
-		gasmix_count = 11;
-	}
+	const suunto_d9_layout_t *layout = suunto_d9_parser_layout (parser->model);
 
-	// Offset to the configuration data.
-	unsigned int config = 0x3A;
-	if (parser->model == D4) {
-		config += 1;
-	} else if (parser->model == HELO2 || parser->model == D4i ||
-		parser->model == D6i || parser->model == D9tx ||
-		parser->model == DX || parser->model == ZOOPNOVO ||
-		parser->model == VYPERNOVO) {
-		config = gasmix_offset + gasmix_count * 6;
-	}
+	// Get the logbook id tag, and select the offsets for the firmware
+	// revision it indicates.
+	unsigned int id = array_uint32_le (data + 1);
+	unsigned int v2 = (id == ID_D6I_V2 || id == ID_DX_V2);
+	unsigned int gasmix_offset = v2 ? layout->gasmix_v2 : layout->gasmix;
+	unsigned int initial_offset = v2 ? layout->initial_v2 : layout->initial;
+
+	// The D6i family gained a third gasmix in a firmware update.
+	unsigned int gasmix_count = layout->gasmix_count;
+	if ((parser->model == D6i || parser->model == VYPERNOVO) &&
+		(id == ID_D6I_V1_MIX3 || id == ID_D6I_V2))
+		gasmix_count = 3;
+
+	// Offset to the configuration data. The bounds check covers all
+	// the other header fields too, because they are located in front
+	// of it.
+	unsigned int config = layout->config;
+	if (config == 0)
+		config = gasmix_offset + gasmix_count * layout->gasmix_size;
 	if (config + 1 > size)
 		return DC_STATUS_DATAFORMAT;
 
-	// Cache the data for later use.
-	parser->mode = data[gasmode_offset];
+	// Date and time.
+	const unsigned char *p = data + layout->datetime;
+	if (layout->datetime_yearfirst) {
+		parser->datetime.year   = p[0] + (p[1] << 8);
+		parser->datetime.month  = p[2];
+		parser->datetime.day    = p[3];
+		parser->datetime.hour   = p[4];
+		parser->datetime.minute = p[5];
+		parser->datetime.second = p[6];
+	} else {
+		parser->datetime.hour   = p[0];
+		parser->datetime.minute = p[1];
+		parser->datetime.second = p[2];
+		parser->datetime.year   = p[3] + (p[4] << 8);
+		parser->datetime.month  = p[5];
+		parser->datetime.day    = p[6];
+	}
+
+	// Dive time and maximum depth.
+	parser->divetime = array_uint16_le (data + layout->divetime) * layout->divetime_scale;
+	parser->maxdepth = array_uint16_le (data + 0x09) / 100.0;
+
+	// Gasmix information.
+	parser->mode = data[layout->gasmode];
 	parser->gasmix = 0;
 	if (parser->mode == GAUGE || parser->mode == FREEDIVE) {
 		parser->ngasmixes = 0;
@@ -194,10 +339,7 @@ suunto_d9_parser_cache (suunto_d9_parser_t *parser)
 	} else {
 		parser->ngasmixes = 0;
 		for (unsigned int i = 0; i < gasmix_count; ++i) {
-			if (parser->model == HELO2 || parser->model == D4i ||
-				parser->model == D6i || parser->model == D9tx ||
-				parser->model == DX || parser->model == ZOOPNOVO ||
-				parser->model == VYPERNOVO) {
+			if (layout->gasmix_size == 6) {
 				parser->oxygen[i] = data[gasmix_offset + 6 * i + 1];
 				parser->helium[i] = data[gasmix_offset + 6 * i + 2];
 			} else {
@@ -211,17 +353,8 @@ suunto_d9_parser_cache (suunto_d9_parser_t *parser)
 		}
 
 		// Initial gasmix.
-		if (parser->model == HELO2) {
-			parser->gasmix = data[0x26];
-		} else if (parser->model == D4i || parser->model == D6i ||
-			parser->model == D9tx || parser->model == ZOOPNOVO ||
-			parser->model == VYPERNOVO) {
-			if (id == ID_D4I_V2 || id == ID_D6I_V2) {
-				parser->gasmix = data[0x2D];
-			} else {
-				parser->gasmix = data[0x28];
-			}
-		}
+		if (initial_offset)
+			parser->gasmix = data[initial_offset];
 	}
 	parser->config = config;
 	parser->cached = 1;
@@ -247,6 +380,9 @@ suunto_d9_parser_create (dc_parser_t **out, dc_context_t *context, unsigned int
 	// Set the default values.
 	parser->model = model;
 	parser->cached = 0;
+	memset (&parser->datetime, 0, sizeof (parser->datetime));
+	parser->divetime = 0;
+	parser->maxdepth = 0.0;
 	parser->mode = AIR;
 	parser->ngasmixes = 0;
 	for (unsigned int i = 0; i < NGASMIXES; ++i) {
@@ -269,6 +405,9 @@ suunto_d9_parser_set_data (dc_parser_t *abstract, const unsigned char *data, uns
 
 	// Reset the cache.
 	parser->cached = 0;
+	memset (&parser->datetime, 0, sizeof (parser->datetime));
+	parser->divetime = 0;
+	parser->maxdepth = 0.0;
 	parser->mode = AIR;
 	parser->ngasmixes = 0;
 	for (unsigned int i = 0; i < NGASMIXES; ++i) {
@@ -287,38 +426,13 @@ suunto_d9_parser_get_datetime (dc_parser_t *abstract, dc_datetime_t *datetime)
 {
 	suunto_d9_parser_t *parser = (suunto_d9_parser_t*) abstract;
 
-	unsigned int offset = 0x11;
-	if (parser->model == HELO2 || parser->model == DX)
-		offset = 0x17;
-	else if (parser->model == D4i || parser->model == D6i ||
-		parser->model == D9tx || parser->model == ZOOPNOVO ||
-		parser->model == VYPERNOVO)
-		offset = 0x13;
-
-	if (abstract->size < offset + 7)
-		return DC_STATUS_DATAFORMAT;
+	// Cache the header data.
+	dc_status_t rc = suunto_d9_parser_cache (parser);
+	if (rc != DC_STATUS_SUCCESS)
+		return rc;
 
-	const unsigned char *p = abstract->data + offset;
-
-	if (datetime) {
-		if (parser->model == D4i || parser->model == D6i ||
-			parser->model == D9tx || parser->model == DX ||
-			parser->model == ZOOPNOVO || parser->model == VYPERNOVO) {
-			datetime->year   = p[0] + (p[1] << 8);
-			datetime->month  = p[2];
-			datetime->day    = p[3];
-			datetime->hour   = p[4];
-			datetime->minute = p[5];
-			datetime->second = p[6];
-		} else {
-			datetime->hour   = p[0];
-			datetime->minute = p[1];
-			datetime->second = p[2];
-			datetime->year   = p[3] + (p[4] << 8);
-			datetime->month  = p[5];
-			datetime->day    = p[6];
-		}
-	}
+	if (datetime)
+		*datetime = parser->datetime;
 
 	return DC_STATUS_SUCCESS;
 }
@@ -329,10 +443,7 @@ suunto_d9_parser_get_field (dc_parser_t *abstract, dc_field_type_t type, unsigne
 {
 	suunto_d9_parser_t *parser = (suunto_d9_parser_t*) abstract;
 
-	const unsigned char *data = abstract->data;
-	unsigned int size = abstract->size;
-
-	// Cache the gas mix data.
+	// Cache the header data.
 	dc_status_t rc = suunto_d9_parser_cache (parser);
 	if (rc != DC_STATUS_SUCCESS)
 		return rc;
@@ -342,19 +453,10 @@ suunto_d9_parser_get_field (dc_parser_t *abstract, dc_field_type_t type, unsigne
 	if (value) {
 		switch (type) {
 		case DC_FIELD_DIVETIME:
-			if (parser->model == D4)
-				*((unsigned int *) value) = array_uint16_le (data + 0x0B);
-			else if (parser->model == D4i || parser->model == D6i ||
-				parser->model == D9tx || parser->model == DX ||
-				parser->model == ZOOPNOVO || parser->model == VYPERNOVO)
-				*((unsigned int *) value) = array_uint16_le (data + 0x0D);
-			else if (parser->model == HELO2)
-				*((unsigned int *) value) = array_uint16_le (data + 0x0D) * 60;
-			else
-				*((unsigned int *) value) = array_uint16_le (data + 0x0B) * 60;
+			*((unsigned int *) value) = parser->divetime;
 			break;
 		case DC_FIELD_MAXDEPTH:
-			*((double *) value) = array_uint16_le (data + 0x09) / 100.0;
+			*((double *) value) = parser->maxdepth;
 			break;
 		case DC_FIELD_GASMIX_COUNT:
 			*((unsigned int *) value) = parser->ngasmixes;
@@ -574,95 +676,18 @@ suunto_d9_parser_samples_foreach (dc_parser_t *abstract, dc_sample_callback_t ca
 					}
 					type    = data[offset + 0];
 					seconds = data[offset + 1];
-					switch (type & 0x7F) {
-					case 0x00: // Voluntary Safety Stop
-						sample.event.type = SAMPLE_EVENT_SAFETYSTOP_VOLUNTARY;
-						if (type & 0x80)
-							in_deco &= ~SAFETYSTOP;
-						else
-							in_deco |= SAFETYSTOP;
-						break;
-					case 0x01: // Mandatory Safety Stop - odd concept; model as deco stop
-						sample.event.type = SAMPLE_EVENT_SAFETYSTOP_MANDATORY;
-						if (type & 0x80)
-							in_deco &= ~DECOSTOP;
-						else
-							in_deco |= DECOSTOP;
-						break;
-					case 0x02: // Deep Safety Stop
-						sample.event.type = SAMPLE_EVENT_DEEPSTOP;
-						if (type & 0x80)
-							in_deco &= ~DEEPSTOP;
-						else
-							in_deco |= DEEPSTOP;
-						break;
-					case 0x03: // Deco
-						sample.event.type = SAMPLE_EVENT_DECOSTOP;
-						if (type & 0x80)
-							in_deco &= ~DECOSTOP;
-						else
-							in_deco |= DECOSTOP;
-						break;
-					case 0x04: // Ascent Rate Warning
-						sample.event.type = SAMPLE_EVENT_ASCENT;
-						break;
-					case 0x05: // Ceiling Broken
-						sample.event.type = SAMPLE_EVENT_CEILING;
-						break;
-					case 0x06: // Mandatory Safety Stop Ceiling Error
-						sample.event.type = SAMPLE_EVENT_CEILING_SAFETYSTOP;
-						break;
-					case 0x07: // Below Deco Floor
-						sample.event.type = SAMPLE_EVENT_FLOOR;
-						break;
-					case 0x08: // Dive Time
-						sample.event.type = SAMPLE_EVENT_DIVETIME;
-						break;
-					case 0x09: // Depth Alarm
-						sample.event.type = SAMPLE_EVENT_MAXDEPTH;
-						break;
-					case 0x0A: // OLF 80
-						sample.event.type = SAMPLE_EVENT_OLF;
-						sample.event.value = 80;
-						break;
-					case 0x0B: // OLF 100
-						sample.event.type = SAMPLE_EVENT_OLF;
-						sample.event.value = 100;
-						break;
-					case 0x0C: // PO2
-						sample.event.type = SAMPLE_EVENT_PO2;
-						break;
-					case 0x0D: // Air Time Warning
-						sample.event.type = SAMPLE_EVENT_AIRTIME;
-						break;
-					case 0x0E: // RGBM Warning
-						sample.event.type = SAMPLE_EVENT_RGBM;
-						break;
-					case 0x0F: // PO2 High
-					case 0x10: // PO2 Low
-						sample.event.type = SAMPLE_EVENT_PO2;
-						break;
-					case 0x11: // Tissue Level Warning
-					case 0x12: // Tissue Calc Overflow
-						sample.event.type = SAMPLE_EVENT_TISSUELEVEL;
-						break;
-					case 0x13: // Deep Safety Stop
-						sample.event.type = SAMPLE_EVENT_DEEPSTOP;
-						if (type & 0x80)
-							in_deco &= ~DEEPSTOP;
-						else
-							in_deco |= DEEPSTOP;
-						break;
-					case 0x14: // Mandatory Safety Stop - again, model as deco stop
-						sample.event.type = SAMPLE_EVENT_SAFETYSTOP_MANDATORY;
-						if (type & 0x80)
-							in_deco &= ~DECOSTOP;
-						else
-							in_deco |= DECOSTOP;
-						break;
-					default: // Unknown
+					if ((type & 0x7F) < C_ARRAY_SIZE (g_events)) {
+						const suunto_d9_event_info_t *info = g_events + (type & 0x7F);
+						sample.event.type = info->type;
+						sample.event.value = info->value;
+						if (info->decomask) {
+							if (type & 0x80)
+								in_deco &= ~info->decomask;
+							else
+								in_deco |= info->decomask;
+						}
+					} else { // Unknown
 						WARNING (abstract->context, "Unknown event type 0x%02x.", type);
-						break;
 					}
 					if (type & 0x80)
 						sample.event.flags = SAMPLE_FLAGS_END;
@@ -74,7 +74,7 @@ static dc_status_t suunto_eonsteel_device_set_fingerprint (dc_device_t *abstract
 static dc_status_t suunto_eonsteel_device_foreach(dc_device_t *abstract, dc_dive_callback_t callback, void *userdata);
 static dc_status_t suunto_eonsteel_device_close(dc_device_t *abstract);
 
-static const dc_device_vtable_t suunto_eonsteel_device_vtable = {
+DC_VTABLE_STORAGE const dc_device_vtable_t suunto_eonsteel_device_vtable = {
 	sizeof(suunto_eonsteel_device_t),
 	DC_FAMILY_SUUNTO_EONSTEEL,
 	suunto_eonsteel_device_set_fingerprint, /* set_fingerprint */
@@ -369,6 +369,10 @@ static int read_file(suunto_eonsteel_device_t *eon, const char *filename, dc_buf
 	size = array_uint32_le(result+4);
 	offset = 0;
 
+	// The file size is known up front, so the output buffer can be
+	// allocated in one go instead of growing with every read.
+	dc_buffer_reserve(buf, size);
+
 	while (size > 0) {
 		unsigned int ask, got, at;
 
@@ -707,6 +711,11 @@ suunto_eonsteel_device_close(dc_device_t *abstract)
 {
 	suunto_eonsteel_device_t *eon = (suunto_eonsteel_device_t *) abstract;
 
+	// Emit the transfer statistics of the session.
+	dc_event_metrics_t metrics;
+	if (dc_usbhid_get_metrics(eon->usbhid, &metrics) == DC_STATUS_SUCCESS)
+		device_event_emit(abstract, DC_EVENT_METRICS, &metrics);
+
 	dc_usbhid_close(eon->usbhid);
 
 	return DC_STATUS_SUCCESS;
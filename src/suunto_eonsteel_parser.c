@@ -83,9 +83,27 @@ struct type_desc {
 #define MAXTYPE 512
 #define MAXGASES 16
 
+/*
+ * Interning cache for the parsed type descriptors. The descriptor
+ * strings are identical across all the dives of a download session,
+ * so each unique descriptor text is parsed only once, and later
+ * occurrences are served from the cache. The interned entries own
+ * their strings, and stay alive until the parser is destroyed.
+ */
+#define DESC_HASHSIZE 64
+
+struct desc_intern {
+	struct desc_intern *next;
+	unsigned int hash;
+	unsigned int len;
+	char *name;
+	struct type_desc desc;
+};
+
 typedef struct suunto_eonsteel_parser_t {
 	dc_parser_t base;
 	struct type_desc type_desc[MAXTYPE];
+	struct desc_intern *desc_hash[DESC_HASHSIZE];
 	// field cache
 	struct {
 		unsigned int initialized;
@@ -297,13 +315,91 @@ static int fill_in_desc_details(suunto_eonsteel_parser_t *eon, struct type_desc
 	return 0;
 }
 
+static unsigned int
+desc_intern_hash (const char *name, int len)
+{
+	unsigned int hash = 5381;
+
+	for (int i = 0; i < len; ++i)
+		hash = hash * 33 + (unsigned char) name[i];
+
+	return hash;
+}
+
+static int
+desc_intern_lookup (suunto_eonsteel_parser_t *eon, const char *name, int len, struct type_desc *desc)
+{
+	unsigned int hash = desc_intern_hash(name, len);
+	struct desc_intern *entry = eon->desc_hash[hash % DESC_HASHSIZE];
+
+	while (entry) {
+		if (entry->hash == hash && entry->len == (unsigned int) len &&
+			memcmp(entry->name, name, len) == 0) {
+			*desc = entry->desc;
+			return 1;
+		}
+		entry = entry->next;
+	}
+
+	return 0;
+}
+
+static void
+desc_intern_add (suunto_eonsteel_parser_t *eon, const char *name, int len, struct type_desc *desc)
+{
+	unsigned int hash = desc_intern_hash(name, len);
+	struct desc_intern *entry;
+
+	entry = (struct desc_intern *) malloc(sizeof(*entry));
+	if (!entry)
+		return; // Not interned, the descriptor remains owned.
+
+	entry->name = (char *) malloc(len + 1);
+	if (!entry->name) {
+		free(entry);
+		return;
+	}
+	memcpy(entry->name, name, len);
+	entry->name[len] = 0;
+
+	// The cache keeps private copies of the descriptor strings, since
+	// the originals live in the per-dive arena.
+	entry->desc = *desc;
+	entry->desc.desc = desc->desc ? strdup(desc->desc) : NULL;
+	entry->desc.format = desc->format ? strdup(desc->format) : NULL;
+	entry->desc.mod = desc->mod ? strdup(desc->mod) : NULL;
+	if ((desc->desc && !entry->desc.desc) ||
+	    (desc->format && !entry->desc.format) ||
+	    (desc->mod && !entry->desc.mod)) {
+		free((void *)entry->desc.desc);
+		free((void *)entry->desc.format);
+		free((void *)entry->desc.mod);
+		free(entry->name);
+		free(entry);
+		return;
+	}
+
+	entry->hash = hash;
+	entry->len = len;
+	entry->next = eon->desc_hash[hash % DESC_HASHSIZE];
+	eon->desc_hash[hash % DESC_HASHSIZE] = entry;
+}
+
 static void
-desc_free (struct type_desc desc[], unsigned int count)
+desc_intern_free (suunto_eonsteel_parser_t *eon)
 {
-	for (unsigned int i = 0; i < count; ++i) {
-		free((void *)desc[i].desc);
-		free((void *)desc[i].format);
-		free((void *)desc[i].mod);
+	for (unsigned int i = 0; i < DESC_HASHSIZE; ++i) {
+		struct desc_intern *entry = eon->desc_hash[i];
+		while (entry) {
+			struct desc_intern *next = entry->next;
+			free((void *)entry->desc.desc);
+			free((void *)entry->desc.format);
+			free((void *)entry->desc.mod);
+			free(entry->name);
+			free(entry);
+			entry = next;
+		}
+		eon->desc_hash[i] = NULL;
 	}
 }
 
@@ -312,6 +408,14 @@ static int record_type(suunto_eonsteel_parser_t *eon, unsigned short type, const
 	struct type_desc desc;
 	const char *next;
 
+	// Serve the descriptor from the interning cache when this exact
+	// text has already been parsed, typically by a previous dive of
+	// the same download session.
+	if (type <= MAXTYPE && desc_intern_lookup(eon, name, namelen, &desc)) {
+		eon->type_desc[type] = desc;
+		return 0;
+	}
+
 	memset(&desc, 0, sizeof(desc));
 	do {
 		int len;
@@ -331,10 +435,9 @@ static int record_type(suunto_eonsteel_parser_t *eon, unsigned short type, const
 			ERROR(eon->base.context, "Unexpected type description: %.*s", len, name);
 			return -1;
 		}
-		p = (char *) malloc(len-4);
+		p = (char *) dc_parser_arena_alloc(&eon->base, len-4);
 		if (!p) {
 			ERROR(eon->base.context, "out of memory");
-			desc_free(&desc, 1);
 			return -1;
 		}
 		memcpy(p, name+5, len-5);
@@ -354,8 +457,6 @@ static int record_type(suunto_eonsteel_parser_t *eon, unsigned short type, const
 			break;
 		default:
 			ERROR(eon->base.context, "Unknown type descriptor: %.*s", len, name);
-			desc_free(&desc, 1);
-			free(p);
 			return -1;
 		}
 	} while ((name = next) != NULL);
@@ -366,13 +467,16 @@ static int record_type(suunto_eonsteel_parser_t *eon, unsigned short type, const
 			desc.desc ? desc.desc : "",
 			desc.format ? desc.format : "",
 			desc.mod ? desc.mod : "");
-		desc_free(&desc, 1);
 		return -1;
 	}
 
 	fill_in_desc_details(eon, &desc);
 
-	desc_free(eon->type_desc + type, 1);
+	// Group descriptors reference other entries by their per-dive
+	// index, so only the plain descriptors are interned.
+	if (desc.desc && !isdigit(desc.desc[0]))
+		desc_intern_add(eon, name, namelen, &desc);
+
 	eon->type_desc[type] = desc;
 	return 0;
 }
@@ -499,7 +603,7 @@ static void sample_depth(struct sample_data *info, unsigned short depth)
 	if (depth == 0xffff)
 		return;
 
-	sample.depth = depth / 100.0;
+	sample.depth = array_scale (depth, 1, 100);
 	if (info->callback) info->callback(DC_SAMPLE_DEPTH, sample, info->userdata);
 }
 
@@ -510,7 +614,7 @@ static void sample_temp(struct sample_data *info, short temp)
 	if (temp < -3000)
 		return;
 
-	sample.temperature = temp / 10.0;
+	sample.temperature = array_scale (temp, 1, 10);
 	if (info->callback) info->callback(DC_SAMPLE_TEMPERATURE, sample, info->userdata);
 }
 
@@ -589,7 +693,7 @@ static void sample_pressure(struct sample_data *info, unsigned short pressure)
 		return;
 
 	sample.pressure.tank = info->gasnr-1;
-	sample.pressure.value = pressure / 100.0;
+	sample.pressure.value = array_scale (pressure, 1, 100);
 	if (info->callback) info->callback(DC_SAMPLE_PRESSURE, sample, info->userdata);
 }
 
@@ -624,7 +728,7 @@ static void sample_gas_switch_event(struct sample_data *info, unsigned short idx
  *
  * "enum:0=NoFly Time,1=Depth,2=Surface Time,3=..."
  */
-static const char *lookup_enum(const struct type_desc *desc, unsigned char value)
+static const char *lookup_enum(suunto_eonsteel_parser_t *eon, const struct type_desc *desc, unsigned char value)
 {
 	const char *str = desc->format;
 	unsigned char c;
@@ -668,7 +772,7 @@ static const char *lookup_enum(const struct type_desc *desc, unsigned char value
 		if (n != value)
 			continue;
 
-		ret = (char *)malloc(end - begin + 1);
+		ret = (char *)dc_parser_arena_alloc(&eon->base, end - begin + 1);
 		if (!ret)
 			break;
 
@@ -685,7 +789,7 @@ static const char *lookup_enum(const struct type_desc *desc, unsigned char value
  */
 static void sample_event_state_type(const struct type_desc *desc, struct sample_data *info, unsigned char type)
 {
-	info->state_type = lookup_enum(desc, type);
+	info->state_type = lookup_enum(info->eon, desc, type);
 }
 
 static void sample_event_state_value(const struct type_desc *desc, struct sample_data *info, unsigned char value)
@@ -716,7 +820,7 @@ static void sample_event_state_value(const struct type_desc *desc, struct sample
 
 static void sample_event_notify_type(const struct type_desc *desc, struct sample_data *info, unsigned char type)
 {
-	info->notify_type = lookup_enum(desc, type);
+	info->notify_type = lookup_enum(info->eon, desc, type);
 }
 
 static void sample_event_notify_value(const struct type_desc *desc, struct sample_data *info, unsigned char value)
@@ -758,7 +862,7 @@ static void sample_event_notify_value(const struct type_desc *desc, struct sampl
 
 static void sample_event_warning_type(const struct type_desc *desc, struct sample_data *info, unsigned char type)
 {
-	info->warning_type = lookup_enum(desc, type);
+	info->warning_type = lookup_enum(info->eon, desc, type);
 }
 
 static void sample_event_warning_value(const struct type_desc *desc, struct sample_data *info, unsigned char value)
@@ -796,7 +900,7 @@ static void sample_event_warning_value(const struct type_desc *desc, struct samp
 
 static void sample_event_alarm_type(const struct type_desc *desc, struct sample_data *info, unsigned char type)
 {
-	info->alarm_type = lookup_enum(desc, type);
+	info->alarm_type = lookup_enum(info->eon, desc, type);
 }
 
 
@@ -830,7 +934,7 @@ static void sample_event_alarm_value(const struct type_desc *desc, struct sample
 static void sample_setpoint_type(const struct type_desc *desc, struct sample_data *info, unsigned char value)
 {
 	dc_sample_value_t sample = {0};
-	const char *type = lookup_enum(desc, value);
+	const char *type = lookup_enum(info->eon, desc, value);
 
 	if (!type) {
 		DEBUG(info->eon->base.context, "sample_setpoint_type(%u) did not match anything in %s", value, desc->format);
@@ -864,6 +968,19 @@ static void sample_setpoint_automatic(struct sample_data *info, unsigned char va
 	DEBUG(info->eon->base.context, "sample_setpoint_automatic(%u)", value);
 }
 
+/*
+ * Check the sample type filter, see dc_parser_set_sample_mask. The
+ * event samples involve string keyed descriptor and enum lookups, so
+ * skipping them when the caller didn't select the type saves real
+ * decoding work, not just the delivery.
+ */
+static int sample_selected(const struct sample_data *info, dc_sample_type_t type)
+{
+	unsigned int mask = info->eon->base.sample_filter;
+
+	return !mask || (mask & (1u << type));
+}
+
 static int handle_sample_type(const struct type_desc *desc, struct sample_data *info, enum eon_sample type, const unsigned char *data)
 {
 	switch (type) {
@@ -916,47 +1033,58 @@ static int handle_sample_type(const struct type_desc *desc, struct sample_data *
 		return 2;
 
 	case ES_state:
-		sample_event_state_type(desc, info, data[0]);
+		if (sample_selected(info, DC_SAMPLE_EVENT))
+			sample_event_state_type(desc, info, data[0]);
 		return 1;
 
 	case ES_state_active:
-		sample_event_state_value(desc, info, data[0]);
+		if (sample_selected(info, DC_SAMPLE_EVENT))
+			sample_event_state_value(desc, info, data[0]);
 		return 1;
 
 	case ES_notify:
-		sample_event_notify_type(desc, info, data[0]);
+		if (sample_selected(info, DC_SAMPLE_EVENT))
+			sample_event_notify_type(desc, info, data[0]);
 		return 1;
 
 	case ES_notify_active:
-		sample_event_notify_value(desc, info, data[0]);
+		if (sample_selected(info, DC_SAMPLE_EVENT))
+			sample_event_notify_value(desc, info, data[0]);
 		return 1;
 
 	case ES_warning:
-		sample_event_warning_type(desc, info, data[0]);
+		if (sample_selected(info, DC_SAMPLE_EVENT))
+			sample_event_warning_type(desc, info, data[0]);
 		return 1;
 
 	case ES_warning_active:
-		sample_event_warning_value(desc, info, data[0]);
+		if (sample_selected(info, DC_SAMPLE_EVENT))
+			sample_event_warning_value(desc, info, data[0]);
 		return 1;
 
 	case ES_alarm:
-		sample_event_alarm_type(desc, info, data[0]);
+		if (sample_selected(info, DC_SAMPLE_EVENT))
+			sample_event_alarm_type(desc, info, data[0]);
 		return 1;
 
 	case ES_alarm_active:
-		sample_event_alarm_value(desc, info, data[0]);
+		if (sample_selected(info, DC_SAMPLE_EVENT))
+			sample_event_alarm_value(desc, info, data[0]);
 		return 1;
 
 	case ES_bookmark:
-		sample_bookmark_event(info, array_uint16_le(data));
+		if (sample_selected(info, DC_SAMPLE_EVENT))
+			sample_bookmark_event(info, array_uint16_le(data));
 		return 2;
 
 	case ES_gasswitch:
-		sample_gas_switch_event(info, array_uint16_le(data));
+		if (sample_selected(info, DC_SAMPLE_GASMIX))
+			sample_gas_switch_event(info, array_uint16_le(data));
 		return 2;
 
 	case ES_setpoint_type:
-		sample_setpoint_type(desc, info, data[0]);
+		if (sample_selected(info, DC_SAMPLE_SETPOINT))
+			sample_setpoint_type(desc, info, data[0]);
 		return 1;
 
 	case ES_setpoint_po2:
@@ -1159,7 +1287,7 @@ static int add_gas_type(suunto_eonsteel_parser_t *eon, const struct type_desc *d
 		return 0;
 
 	eon->cache.ngases = idx+1;
-	name = lookup_enum(desc, type);
+	name = lookup_enum(eon, desc, type);
 	if (!name)
 		DEBUG(eon->base.context, "Unable to look up gas type %u in %s", type, desc->format);
 	else if (!strcasecmp(name, "Diluent"))
@@ -1484,7 +1612,8 @@ suunto_eonsteel_parser_set_data(dc_parser_t *parser, const unsigned char *data,
 {
 	suunto_eonsteel_parser_t *eon = (suunto_eonsteel_parser_t *) parser;
 
-	desc_free(eon->type_desc, MAXTYPE);
+	// The descriptor strings of the previous dive lived in the arena,
+	// which the core has already reset.
 	memset(eon->type_desc, 0, sizeof(eon->type_desc));
 	initialize_field_caches(eon);
 	show_all_descriptors(eon);
@@ -1496,12 +1625,12 @@ suunto_eonsteel_parser_destroy(dc_parser_t *parser)
 {
 	suunto_eonsteel_parser_t *eon = (suunto_eonsteel_parser_t *) parser;
 
-	desc_free(eon->type_desc, MAXTYPE);
+	desc_intern_free(eon);
 
 	return DC_STATUS_SUCCESS;
 }
 
-static const dc_parser_vtable_t suunto_eonsteel_parser_vtable = {
+DC_VTABLE_STORAGE const dc_parser_vtable_t suunto_eonsteel_parser_vtable = {
 	sizeof(suunto_eonsteel_parser_t),
 	DC_FAMILY_SUUNTO_EONSTEEL,
 	suunto_eonsteel_parser_set_data, /* set_data */
@@ -1526,6 +1655,7 @@ suunto_eonsteel_parser_create(dc_parser_t **out, dc_context_t *context, unsigned
 	}
 
 	memset(&parser->type_desc, 0, sizeof(parser->type_desc));
+	memset(&parser->desc_hash, 0, sizeof(parser->desc_hash));
 	memset(&parser->cache, 0, sizeof(parser->cache));
 
 	*out = (dc_parser_t *) parser;
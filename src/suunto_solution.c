@@ -46,7 +46,7 @@ static dc_status_t suunto_solution_device_dump (dc_device_t *abstract, dc_buffer
 static dc_status_t suunto_solution_device_foreach (dc_device_t *abstract, dc_dive_callback_t callback, void *userdata);
 static dc_status_t suunto_solution_device_close (dc_device_t *abstract);
 
-static const dc_device_vtable_t suunto_solution_device_vtable = {
+DC_VTABLE_STORAGE const dc_device_vtable_t suunto_solution_device_vtable = {
 	sizeof(suunto_solution_device_t),
 	DC_FAMILY_SUUNTO_SOLUTION,
 	NULL, /* set_fingerprint */
@@ -84,6 +84,9 @@ suunto_solution_device_open (dc_device_t **out, dc_context_t *context, const cha
 		goto error_free;
 	}
 
+	// Forward cancellation requests to the serial layer.
+	dc_serial_set_cancel (device->port, device_cancel_cb, device);
+
 	// Set the serial communication protocol (1200 8N2).
 	status = dc_serial_configure (device->port, 1200, 8, DC_PARITY_NONE, DC_STOPBITS_TWO, DC_FLOWCONTROL_NONE);
 	if (status != DC_STATUS_SUCCESS) {
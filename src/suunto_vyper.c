@@ -40,6 +40,8 @@
 #define SZ_MEMORY 0x2000
 #define SZ_PACKET 32
 
+#define MAXRETRIES 2
+
 #define HDR_DEVINFO_VYPER   0x24
 #define HDR_DEVINFO_SPYDER  0x16
 #define HDR_DEVINFO_BEGIN   (HDR_DEVINFO_SPYDER)
@@ -56,7 +58,7 @@ static dc_status_t suunto_vyper_device_dump (dc_device_t *abstract, dc_buffer_t
 static dc_status_t suunto_vyper_device_foreach (dc_device_t *abstract, dc_dive_callback_t callback, void *userdata);
 static dc_status_t suunto_vyper_device_close (dc_device_t *abstract);
 
-static const dc_device_vtable_t suunto_vyper_device_vtable = {
+DC_VTABLE_STORAGE const dc_device_vtable_t suunto_vyper_device_vtable = {
 	sizeof(suunto_vyper_device_t),
 	DC_FAMILY_SUUNTO_VYPER,
 	suunto_common_device_set_fingerprint, /* set_fingerprint */
@@ -113,6 +115,9 @@ suunto_vyper_device_open (dc_device_t **out, dc_context_t *context, const char *
 		goto error_free;
 	}
 
+	// Forward cancellation requests to the serial layer.
+	dc_serial_set_cancel (device->port, device_cancel_cb, device);
+
 	// Set the serial communication protocol (2400 8O1).
 	status = dc_serial_configure (device->port, 2400, 8, DC_PARITY_ODD, DC_STOPBITS_ONE, DC_FLOWCONTROL_NONE);
 	if (status != DC_STATUS_SUCCESS) {
@@ -127,6 +132,21 @@ suunto_vyper_device_open (dc_device_t **out, dc_context_t *context, const char *
 		goto error_close;
 	}
 
+	// Request the lowest possible receive latency. The protocol uses
+	// many small packets, and the default buffering of usb-serial
+	// adapters adds up to 16 ms to every round trip. This is a best
+	// effort tuning, so a failure is not fatal.
+	dc_serial_set_latency (device->port, 0);
+
+	// Enable the adaptive timeout mode. The packets are protected with
+	// a checksum and retried on a transmission error, so a prematurely
+	// truncated read is recoverable.
+	status = dc_serial_set_timeout_adaptive (device->port, 1);
+	if (status != DC_STATUS_SUCCESS) {
+		ERROR (context, "Failed to set the adaptive timeout mode.");
+		goto error_close;
+	}
+
 	// Set the DTR line (power supply for the interface).
 	status = dc_serial_set_dtr (device->port, 1);
 	if (status != DC_STATUS_SUCCESS) {
@@ -134,8 +154,12 @@ suunto_vyper_device_open (dc_device_t **out, dc_context_t *context, const char *
 		goto error_close;
 	}
 
-	// Give the interface 100 ms to settle and draw power up.
-	dc_serial_sleep (device->port, 100);
+	// Give the interface 100 ms to settle and draw power up. A port
+	// revived from the keepalive cache is already powered.
+	unsigned int warm = 0;
+	dc_serial_get_warm (device->port, &warm);
+	if (!warm)
+		dc_serial_sleep (device->port, 100);
 
 	// Make sure everything is in a sane state.
 	dc_serial_purge (device->port, DC_DIRECTION_ALL);
@@ -209,7 +233,7 @@ suunto_vyper_send (suunto_vyper_device_t *device, const unsigned char command[],
 
 
 static dc_status_t
-suunto_vyper_transfer (suunto_vyper_device_t *device, const unsigned char command[], unsigned int csize, unsigned char answer[], unsigned int asize, unsigned int size)
+suunto_vyper_packet (suunto_vyper_device_t *device, const unsigned char command[], unsigned int csize, unsigned char answer[], unsigned int asize, unsigned int size)
 {
 	dc_status_t status = DC_STATUS_SUCCESS;
 	dc_device_t *abstract = (dc_device_t *) device;
@@ -251,6 +275,31 @@ suunto_vyper_transfer (suunto_vyper_device_t *device, const unsigned char comman
 }
 
 
+static dc_status_t
+suunto_vyper_transfer (suunto_vyper_device_t *device, const unsigned char command[], unsigned int csize, unsigned char answer[], unsigned int asize, unsigned int size)
+{
+	dc_device_t *abstract = (dc_device_t *) device;
+	unsigned int nretries = 0;
+	dc_status_t rc = DC_STATUS_SUCCESS;
+	while ((rc = suunto_vyper_packet (device, command, csize, answer, asize, size)) != DC_STATUS_SUCCESS) {
+		// Automatically discard a corrupted packet,
+		// and request a new one. The commands address the memory
+		// explicitly, so requesting the same packet again is safe.
+		if (rc != DC_STATUS_PROTOCOL && rc != DC_STATUS_TIMEOUT)
+			return rc;
+
+		// Abort if the maximum number of retries is reached.
+		if (nretries++ >= device_retry_limit (abstract, MAXRETRIES))
+			return rc;
+
+		// Discard any garbage bytes.
+		dc_serial_purge (device->port, DC_DIRECTION_INPUT);
+	}
+
+	return rc;
+}
+
+
 static dc_status_t
 suunto_vyper_device_read (dc_device_t *abstract, unsigned int address, unsigned char data[], unsigned int size)
 {
@@ -102,6 +102,9 @@ suunto_vyper2_device_open (dc_device_t **out, dc_context_t *context, const char
 		goto error_free;
 	}
 
+	// Forward cancellation requests to the serial layer.
+	dc_serial_set_cancel (device->port, device_cancel_cb, device);
+
 	// Set the serial communication protocol (9600 8N1).
 	status = dc_serial_configure (device->port, 9600, 8, DC_PARITY_NONE, DC_STOPBITS_ONE, DC_FLOWCONTROL_NONE);
 	if (status != DC_STATUS_SUCCESS) {
@@ -146,6 +149,12 @@ suunto_vyper2_device_open (dc_device_t **out, dc_context_t *context, const char
 	else
 		device->base.layout = &suunto_vyper2_layout;
 
+	// Read the serial number and emit the device info event.
+	status = suunto_common2_device_devinfo ((dc_device_t *) device);
+	if (status != DC_STATUS_SUCCESS) {
+		goto error_close;
+	}
+
 	*out = (dc_device_t*) device;
 
 	return DC_STATUS_SUCCESS;
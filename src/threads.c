@@ -0,0 +1,514 @@
+/*
+ * libdivecomputer
+ *
+ * Copyright (C) 2016 Jef Driesen
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA
+ */
+
+#ifdef __linux__
+#define _GNU_SOURCE	// pthread_setaffinity_np
+#endif
+
+#include <stdlib.h>
+
+#ifndef _WIN32
+#include <unistd.h>
+#include <errno.h>
+#include <sys/time.h>	// gettimeofday
+#endif
+
+#include "threads.h"
+
+#ifdef _WIN32
+
+typedef struct dc_thread_wrapper_t {
+	dc_thread_func_t func;
+	void *arg;
+} dc_thread_wrapper_t;
+
+static DWORD WINAPI
+dc_thread_trampoline (LPVOID param)
+{
+	dc_thread_wrapper_t wrapper = *(dc_thread_wrapper_t *) param;
+
+	free (param);
+
+	wrapper.func (wrapper.arg);
+
+	return 0;
+}
+
+int
+dc_thread_create (dc_thread_t *thread, dc_thread_func_t func, void *arg)
+{
+	dc_thread_wrapper_t *wrapper = (dc_thread_wrapper_t *) malloc (sizeof (dc_thread_wrapper_t));
+	if (wrapper == NULL)
+		return -1;
+
+	wrapper->func = func;
+	wrapper->arg = arg;
+
+	*thread = CreateThread (NULL, 0, dc_thread_trampoline, wrapper, 0, NULL);
+	if (*thread == NULL) {
+		free (wrapper);
+		return -1;
+	}
+
+	return 0;
+}
+
+int
+dc_thread_join (dc_thread_t *thread)
+{
+	if (WaitForSingleObject (*thread, INFINITE) != WAIT_OBJECT_0)
+		return -1;
+
+	CloseHandle (*thread);
+
+	return 0;
+}
+
+int
+dc_thread_detach (dc_thread_t *thread)
+{
+	if (!CloseHandle (*thread))
+		return -1;
+
+	return 0;
+}
+
+int
+dc_mutex_init (dc_mutex_t *mutex)
+{
+	InitializeCriticalSection (mutex);
+
+	return 0;
+}
+
+int
+dc_mutex_lock (dc_mutex_t *mutex)
+{
+	EnterCriticalSection (mutex);
+
+	return 0;
+}
+
+int
+dc_mutex_unlock (dc_mutex_t *mutex)
+{
+	LeaveCriticalSection (mutex);
+
+	return 0;
+}
+
+int
+dc_mutex_destroy (dc_mutex_t *mutex)
+{
+	DeleteCriticalSection (mutex);
+
+	return 0;
+}
+
+int
+dc_cond_init (dc_cond_t *cond)
+{
+	InitializeConditionVariable (cond);
+
+	return 0;
+}
+
+int
+dc_cond_wait (dc_cond_t *cond, dc_mutex_t *mutex)
+{
+	if (!SleepConditionVariableCS (cond, mutex, INFINITE))
+		return -1;
+
+	return 0;
+}
+
+int
+dc_cond_timedwait (dc_cond_t *cond, dc_mutex_t *mutex, unsigned int milliseconds)
+{
+	if (!SleepConditionVariableCS (cond, mutex, milliseconds)) {
+		if (GetLastError () == ERROR_TIMEOUT)
+			return 1;
+		return -1;
+	}
+
+	return 0;
+}
+
+int
+dc_cond_signal (dc_cond_t *cond)
+{
+	WakeConditionVariable (cond);
+
+	return 0;
+}
+
+int
+dc_cond_broadcast (dc_cond_t *cond)
+{
+	WakeAllConditionVariable (cond);
+
+	return 0;
+}
+
+int
+dc_cond_destroy (dc_cond_t *cond)
+{
+	return 0;
+}
+
+static BOOL CALLBACK
+dc_once_trampoline (PINIT_ONCE once, PVOID param, PVOID *context)
+{
+	void (*func) (void) = (void (*) (void)) param;
+
+	func ();
+
+	return TRUE;
+}
+
+int
+dc_once (dc_once_t *once, void (*func) (void))
+{
+	if (!InitOnceExecuteOnce (once, dc_once_trampoline, (PVOID) func, NULL))
+		return -1;
+
+	return 0;
+}
+
+#else
+
+int
+dc_thread_create (dc_thread_t *thread, dc_thread_func_t func, void *arg)
+{
+	return pthread_create (thread, NULL, func, arg);
+}
+
+int
+dc_thread_join (dc_thread_t *thread)
+{
+	return pthread_join (*thread, NULL);
+}
+
+int
+dc_thread_detach (dc_thread_t *thread)
+{
+	return pthread_detach (*thread);
+}
+
+int
+dc_mutex_init (dc_mutex_t *mutex)
+{
+	return pthread_mutex_init (mutex, NULL);
+}
+
+int
+dc_mutex_lock (dc_mutex_t *mutex)
+{
+	return pthread_mutex_lock (mutex);
+}
+
+int
+dc_mutex_unlock (dc_mutex_t *mutex)
+{
+	return pthread_mutex_unlock (mutex);
+}
+
+int
+dc_mutex_destroy (dc_mutex_t *mutex)
+{
+	return pthread_mutex_destroy (mutex);
+}
+
+int
+dc_cond_init (dc_cond_t *cond)
+{
+	return pthread_cond_init (cond, NULL);
+}
+
+int
+dc_cond_wait (dc_cond_t *cond, dc_mutex_t *mutex)
+{
+	return pthread_cond_wait (cond, mutex);
+}
+
+int
+dc_cond_timedwait (dc_cond_t *cond, dc_mutex_t *mutex, unsigned int milliseconds)
+{
+	struct timeval now;
+	gettimeofday (&now, NULL);
+
+	struct timespec ts;
+	ts.tv_sec = now.tv_sec + milliseconds / 1000;
+	ts.tv_nsec = now.tv_usec * 1000 + (milliseconds % 1000) * 1000000;
+	if (ts.tv_nsec >= 1000000000) {
+		ts.tv_sec++;
+		ts.tv_nsec -= 1000000000;
+	}
+
+	int rc = pthread_cond_timedwait (cond, mutex, &ts);
+	if (rc == ETIMEDOUT)
+		return 1;
+	if (rc != 0)
+		return -1;
+
+	return 0;
+}
+
+int
+dc_cond_signal (dc_cond_t *cond)
+{
+	return pthread_cond_signal (cond);
+}
+
+int
+dc_cond_broadcast (dc_cond_t *cond)
+{
+	return pthread_cond_broadcast (cond);
+}
+
+int
+dc_cond_destroy (dc_cond_t *cond)
+{
+	return pthread_cond_destroy (cond);
+}
+
+int
+dc_once (dc_once_t *once, void (*func) (void))
+{
+	return pthread_once (once, func);
+}
+
+#endif
+
+unsigned int
+dc_thread_ncores (void)
+{
+#ifdef _WIN32
+	SYSTEM_INFO info;
+	GetSystemInfo (&info);
+	return info.dwNumberOfProcessors > 0 ? info.dwNumberOfProcessors : 1;
+#else
+	long ncores = sysconf (_SC_NPROCESSORS_ONLN);
+	return ncores > 0 ? (unsigned int) ncores : 1;
+#endif
+}
+
+int
+dc_thread_set_affinity (dc_thread_t *thread, unsigned int core)
+{
+#ifdef _WIN32
+	DWORD_PTR mask = 0;
+	if (core == DC_AFFINITY_ANY) {
+		DWORD_PTR process = 0, system = 0;
+		if (!GetProcessAffinityMask (GetCurrentProcess (), &process, &system))
+			return -1;
+		mask = process;
+	} else {
+		if (core >= 8 * sizeof (mask))
+			return -1;
+		mask = (DWORD_PTR) 1 << core;
+	}
+	return SetThreadAffinityMask (*thread, mask) != 0 ? 0 : -1;
+#elif defined (__linux__)
+	cpu_set_t cpuset;
+	CPU_ZERO (&cpuset);
+	if (core == DC_AFFINITY_ANY) {
+		unsigned int ncores = dc_thread_ncores ();
+		if (ncores > CPU_SETSIZE)
+			ncores = CPU_SETSIZE;
+		for (unsigned int i = 0; i < ncores; ++i)
+			CPU_SET (i, &cpuset);
+	} else {
+		if (core >= CPU_SETSIZE)
+			return -1;
+		CPU_SET (core, &cpuset);
+	}
+	return pthread_setaffinity_np (*thread, sizeof (cpuset), &cpuset) == 0 ? 0 : -1;
+#else
+	// No portable interface for thread affinity on the remaining
+	// platforms.
+	return -1;
+#endif
+}
+
+typedef struct dc_task_t {
+	struct dc_task_t *next;
+	dc_task_func_t func;
+	void *arg;
+} dc_task_t;
+
+struct dc_taskpool_t {
+	dc_mutex_t mutex;
+	dc_cond_t cond;
+	// FIFO queue of pending tasks.
+	dc_task_t *head;
+	dc_task_t *tail;
+	int shutdown;
+	unsigned int nthreads;
+	dc_thread_t threads[];
+};
+
+static void *
+dc_taskpool_worker (void *arg)
+{
+	dc_taskpool_t *pool = (dc_taskpool_t *) arg;
+
+	dc_mutex_lock (&pool->mutex);
+	while (1) {
+		while (pool->head == NULL && !pool->shutdown)
+			dc_cond_wait (&pool->cond, &pool->mutex);
+
+		// The queue is drained before shutting down, so tasks submitted
+		// before the pool is destroyed are always executed.
+		dc_task_t *task = pool->head;
+		if (task == NULL)
+			break;
+		pool->head = task->next;
+		if (pool->head == NULL)
+			pool->tail = NULL;
+
+		dc_mutex_unlock (&pool->mutex);
+		task->func (task->arg);
+		free (task);
+		dc_mutex_lock (&pool->mutex);
+	}
+	dc_mutex_unlock (&pool->mutex);
+
+	return NULL;
+}
+
+dc_taskpool_t *
+dc_taskpool_create (unsigned int nthreads)
+{
+	if (nthreads == 0)
+		return NULL;
+
+	dc_taskpool_t *pool = (dc_taskpool_t *) malloc (sizeof (dc_taskpool_t) + nthreads * sizeof (dc_thread_t));
+	if (pool == NULL)
+		return NULL;
+
+	pool->head = NULL;
+	pool->tail = NULL;
+	pool->shutdown = 0;
+	pool->nthreads = 0;
+
+	if (dc_mutex_init (&pool->mutex) != 0) {
+		free (pool);
+		return NULL;
+	}
+	if (dc_cond_init (&pool->cond) != 0) {
+		dc_mutex_destroy (&pool->mutex);
+		free (pool);
+		return NULL;
+	}
+
+	for (unsigned int i = 0; i < nthreads; ++i) {
+		if (dc_thread_create (pool->threads + i, dc_taskpool_worker, pool) != 0)
+			break;
+		pool->nthreads++;
+	}
+
+	if (pool->nthreads == 0) {
+		dc_cond_destroy (&pool->cond);
+		dc_mutex_destroy (&pool->mutex);
+		free (pool);
+		return NULL;
+	}
+
+	return pool;
+}
+
+int
+dc_taskpool_submit (dc_taskpool_t *pool, dc_task_func_t func, void *arg)
+{
+	if (pool == NULL || func == NULL)
+		return -1;
+
+	dc_task_t *task = (dc_task_t *) malloc (sizeof (dc_task_t));
+	if (task == NULL)
+		return -1;
+
+	task->next = NULL;
+	task->func = func;
+	task->arg = arg;
+
+	dc_mutex_lock (&pool->mutex);
+	if (pool->shutdown) {
+		dc_mutex_unlock (&pool->mutex);
+		free (task);
+		return -1;
+	}
+	if (pool->tail)
+		pool->tail->next = task;
+	else
+		pool->head = task;
+	pool->tail = task;
+	dc_cond_signal (&pool->cond);
+	dc_mutex_unlock (&pool->mutex);
+
+	return 0;
+}
+
+unsigned int
+dc_taskpool_nthreads (const dc_taskpool_t *pool)
+{
+	if (pool == NULL)
+		return 0;
+
+	return pool->nthreads;
+}
+
+void
+dc_taskpool_destroy (dc_taskpool_t *pool)
+{
+	if (pool == NULL)
+		return;
+
+	dc_mutex_lock (&pool->mutex);
+	pool->shutdown = 1;
+	dc_cond_broadcast (&pool->cond);
+	dc_mutex_unlock (&pool->mutex);
+
+	for (unsigned int i = 0; i < pool->nthreads; ++i)
+		dc_thread_join (pool->threads + i);
+
+	dc_cond_destroy (&pool->cond);
+	dc_mutex_destroy (&pool->mutex);
+	free (pool);
+}
+
+int
+dc_taskpool_set_affinity (dc_taskpool_t *pool, const unsigned int cores[], unsigned int ncores)
+{
+	if (pool == NULL || (cores == NULL && ncores != 0))
+		return -1;
+
+	// Distribute the workers round-robin over the given cores. With an
+	// empty list, the workers return to running on any core.
+	int result = 0;
+	for (unsigned int i = 0; i < pool->nthreads; ++i) {
+		unsigned int core = ncores ? cores[i % ncores] : DC_AFFINITY_ANY;
+		if (dc_thread_set_affinity (pool->threads + i, core) != 0)
+			result = -1;
+	}
+
+	return result;
+}
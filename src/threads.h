@@ -0,0 +1,178 @@
+/*
+ * libdivecomputer
+ *
+ * Copyright (C) 2016 Jef Driesen
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301 USA
+ */
+
+#ifndef DC_THREADS_H
+#define DC_THREADS_H
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/*
+ * Minimal portable threading primitives for internal use. The
+ * protocol code remains strictly synchronous; these primitives exist
+ * so that concurrent device sessions can be coordinated inside the
+ * library (worker pools, parallel parsing) without every feature
+ * growing its own platform specific code.
+ *
+ * All functions return zero on success, and a non-zero value on
+ * failure, following the pthreads convention.
+ */
+
+#ifdef _WIN32
+typedef HANDLE dc_thread_t;
+typedef CRITICAL_SECTION dc_mutex_t;
+typedef CONDITION_VARIABLE dc_cond_t;
+typedef INIT_ONCE dc_once_t;
+#define DC_ONCE_INIT INIT_ONCE_STATIC_INIT
+#else
+typedef pthread_t dc_thread_t;
+typedef pthread_mutex_t dc_mutex_t;
+typedef pthread_cond_t dc_cond_t;
+typedef pthread_once_t dc_once_t;
+#define DC_ONCE_INIT PTHREAD_ONCE_INIT
+#endif
+
+typedef void *(*dc_thread_func_t) (void *arg);
+
+int
+dc_thread_create (dc_thread_t *thread, dc_thread_func_t func, void *arg);
+
+int
+dc_thread_join (dc_thread_t *thread);
+
+/*
+ * Release the thread handle without waiting for the thread to finish.
+ * The thread keeps running and reclaims its resources on exit; it can
+ * no longer be joined.
+ */
+int
+dc_thread_detach (dc_thread_t *thread);
+
+int
+dc_mutex_init (dc_mutex_t *mutex);
+
+int
+dc_mutex_lock (dc_mutex_t *mutex);
+
+int
+dc_mutex_unlock (dc_mutex_t *mutex);
+
+int
+dc_mutex_destroy (dc_mutex_t *mutex);
+
+int
+dc_cond_init (dc_cond_t *cond);
+
+int
+dc_cond_wait (dc_cond_t *cond, dc_mutex_t *mutex);
+
+/*
+ * Wait on the condition variable with a timeout. Returns 0 when the
+ * condition was signalled, 1 when the timeout expired, and -1 on
+ * error. Spurious wakeups are possible, as with dc_cond_wait.
+ */
+int
+dc_cond_timedwait (dc_cond_t *cond, dc_mutex_t *mutex, unsigned int milliseconds);
+
+int
+dc_cond_signal (dc_cond_t *cond);
+
+int
+dc_cond_broadcast (dc_cond_t *cond);
+
+int
+dc_cond_destroy (dc_cond_t *cond);
+
+/*
+ * Run the function exactly once, even when called concurrently from
+ * multiple threads. The control variable must be statically initialized
+ * with DC_ONCE_INIT. All callers are guaranteed to observe the effects
+ * of the function on return.
+ */
+int
+dc_once (dc_once_t *once, void (*func) (void));
+
+/*
+ * Return the number of processor cores, or 1 if it cannot be
+ * determined.
+ */
+unsigned int
+dc_thread_ncores (void);
+
+/*
+ * Pin a thread to a single processor core, or release it to run on any
+ * core again with DC_AFFINITY_ANY. Returns non-zero on platforms
+ * without an affinity interface, where the placement is left to the
+ * operating system.
+ */
+#define DC_AFFINITY_ANY 0xFFFFFFFF
+
+int
+dc_thread_set_affinity (dc_thread_t *thread, unsigned int core);
+
+/*
+ * A small worker pool with a shared FIFO task queue. Features that
+ * need background work submit tasks here instead of creating their own
+ * threads, so multiple concurrent operations share one set of workers
+ * and don't oversubscribe the machine. The tasks are coarse grained
+ * (an entire dive, an entire transfer), so a single shared queue is
+ * sufficient; there is no per-worker queue or stealing.
+ *
+ * The pool has no completion notification of its own. Submitters that
+ * need to wait for their tasks track them with their own mutex and
+ * condition variable (see dc_parser_parse_many for an example).
+ */
+typedef struct dc_taskpool_t dc_taskpool_t;
+
+typedef void (*dc_task_func_t) (void *arg);
+
+dc_taskpool_t *
+dc_taskpool_create (unsigned int nthreads);
+
+int
+dc_taskpool_submit (dc_taskpool_t *pool, dc_task_func_t func, void *arg);
+
+unsigned int
+dc_taskpool_nthreads (const dc_taskpool_t *pool);
+
+/*
+ * Pin the workers round-robin to the given list of processor cores, or
+ * release them with an empty list. See dc_context_set_affinity for the
+ * intended use.
+ */
+int
+dc_taskpool_set_affinity (dc_taskpool_t *pool, const unsigned int cores[], unsigned int ncores);
+
+void
+dc_taskpool_destroy (dc_taskpool_t *pool);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+#endif /* DC_THREADS_H */
@@ -24,6 +24,7 @@
 #endif
 
 #include <stdlib.h>
+#include <string.h>
 
 #if defined(HAVE_LIBUSB) && !defined(__APPLE__)
 #define USBHID
@@ -40,9 +41,25 @@
 #include "common-private.h"
 #include "context-private.h"
 
+#if defined(HAVE_LIBUSB) && !defined(__APPLE__)
+// The number of input transfers that are kept in flight
+// simultaneously. With a single transfer, the throughput of an
+// interrupt endpoint is limited to one report per USB frame round-trip.
+#define NTRANSFERS 4
+
+typedef struct dc_usbhid_transfer_t {
+	struct libusb_transfer *transfer;
+	unsigned char *buffer;
+	int submitted;
+	int completed;
+} dc_usbhid_transfer_t;
+#endif
+
 struct dc_usbhid_t {
 	/* Library context. */
 	dc_context_t *context;
+	/* Transfer statistics */
+	dc_event_metrics_t metrics;
 	/* Internal state. */
 #if defined(HAVE_LIBUSB) && !defined(__APPLE__)
 	libusb_context *ctx;
@@ -51,6 +68,15 @@ struct dc_usbhid_t {
 	unsigned char endpoint_in;
 	unsigned char endpoint_out;
 	unsigned int timeout;
+	/*
+	 * Queue of asynchronous input transfers. The transfers are
+	 * submitted on the first read, and a completed transfer is
+	 * resubmitted immediately after its report has been consumed.
+	 * The reports are handed to the caller in submission order.
+	 */
+	unsigned int packetsize;
+	unsigned int head;
+	dc_usbhid_transfer_t transfers[NTRANSFERS];
 #elif defined(HAVE_HIDAPI)
 	hid_device *handle;
 	int timeout;
@@ -58,6 +84,14 @@ struct dc_usbhid_t {
 };
 
 #if defined(HAVE_LIBUSB) && !defined(__APPLE__)
+static void LIBUSB_CALL
+dc_usbhid_transfer_cb (struct libusb_transfer *transfer)
+{
+	int *completed = (int *) transfer->user_data;
+
+	*completed = 1;
+}
+
 static dc_status_t
 syserror(int errcode)
 {
@@ -103,6 +137,8 @@ dc_usbhid_open (dc_usbhid_t **out, dc_context_t *context, unsigned int vid, unsi
 	// Library context.
 	usbhid->context = context;
 
+	memset (&usbhid->metrics, 0, sizeof (usbhid->metrics));
+
 #if defined(HAVE_LIBUSB) && !defined(__APPLE__)
 	struct libusb_device **devices = NULL;
 	struct libusb_config_descriptor *config = NULL;
@@ -232,6 +268,27 @@ dc_usbhid_open (dc_usbhid_t **out, dc_context_t *context, unsigned int vid, unsi
 		goto error_usb_close;
 	}
 
+	// Allocate the input transfers. The transfers are submitted on
+	// the first read.
+	usbhid->packetsize = ep_in->wMaxPacketSize;
+	usbhid->head = 0;
+	for (unsigned int i = 0; i < NTRANSFERS; ++i) {
+		usbhid->transfers[i].transfer = NULL;
+		usbhid->transfers[i].buffer = NULL;
+		usbhid->transfers[i].submitted = 0;
+		usbhid->transfers[i].completed = 0;
+	}
+	for (unsigned int i = 0; i < NTRANSFERS; ++i) {
+		dc_usbhid_transfer_t *transfer = &usbhid->transfers[i];
+		transfer->transfer = libusb_alloc_transfer (0);
+		transfer->buffer = (unsigned char *) malloc (usbhid->packetsize);
+		if (transfer->transfer == NULL || transfer->buffer == NULL) {
+			ERROR (context, "Out of memory.");
+			status = DC_STATUS_NOMEMORY;
+			goto error_usb_free_transfers;
+		}
+	}
+
 	libusb_free_config_descriptor (config);
 	libusb_free_device_list (devices, 1);
 
@@ -261,6 +318,12 @@ dc_usbhid_open (dc_usbhid_t **out, dc_context_t *context, unsigned int vid, unsi
 	return DC_STATUS_SUCCESS;
 
 #if defined(HAVE_LIBUSB) && !defined(__APPLE__)
+error_usb_free_transfers:
+	for (unsigned int i = 0; i < NTRANSFERS; ++i) {
+		libusb_free_transfer (usbhid->transfers[i].transfer);
+		free (usbhid->transfers[i].buffer);
+	}
+	libusb_release_interface (usbhid->handle, usbhid->interface);
 error_usb_close:
 	libusb_close (usbhid->handle);
 error_usb_free_config:
@@ -291,6 +354,23 @@ dc_usbhid_close (dc_usbhid_t *usbhid)
 		return DC_STATUS_SUCCESS;
 
 #if defined(HAVE_LIBUSB) && !defined(__APPLE__)
+	// Cancel and drain the pending input transfers.
+	for (unsigned int i = 0; i < NTRANSFERS; ++i) {
+		dc_usbhid_transfer_t *transfer = &usbhid->transfers[i];
+		if (transfer->submitted && !transfer->completed)
+			libusb_cancel_transfer (transfer->transfer);
+	}
+	for (unsigned int i = 0; i < NTRANSFERS; ++i) {
+		dc_usbhid_transfer_t *transfer = &usbhid->transfers[i];
+		while (transfer->submitted && !transfer->completed) {
+			if (libusb_handle_events_completed (usbhid->ctx, &transfer->completed) != LIBUSB_SUCCESS)
+				break;
+		}
+	}
+	for (unsigned int i = 0; i < NTRANSFERS; ++i) {
+		libusb_free_transfer (usbhid->transfers[i].transfer);
+		free (usbhid->transfers[i].buffer);
+	}
 	libusb_release_interface (usbhid->handle, usbhid->interface);
 	libusb_close (usbhid->handle);
 	libusb_exit (usbhid->ctx);
@@ -350,20 +430,84 @@ dc_usbhid_read (dc_usbhid_t *usbhid, void *data, size_t size, size_t *actual)
 	}
 
 #if defined(HAVE_LIBUSB) && !defined(__APPLE__)
-	int rc = libusb_interrupt_transfer (usbhid->handle, usbhid->endpoint_in, data, size, &nbytes, usbhid->timeout);
-	if (rc != LIBUSB_SUCCESS) {
-		ERROR (usbhid->context, "Usb read interrupt transfer failed (%s).",
-			libusb_error_name (rc));
-		status = syserror (rc);
+	// Submit the idle input transfers, to keep multiple transfers in
+	// flight while the caller is processing the reports.
+	for (unsigned int i = 0; i < NTRANSFERS; ++i) {
+		dc_usbhid_transfer_t *transfer = &usbhid->transfers[(usbhid->head + i) % NTRANSFERS];
+		if (transfer->submitted)
+			continue;
+		libusb_fill_interrupt_transfer (transfer->transfer, usbhid->handle,
+			usbhid->endpoint_in, transfer->buffer, usbhid->packetsize,
+			dc_usbhid_transfer_cb, &transfer->completed, usbhid->timeout);
+		transfer->completed = 0;
+		int rc = libusb_submit_transfer (transfer->transfer);
+		if (rc != LIBUSB_SUCCESS) {
+			ERROR (usbhid->context, "Failed to submit the transfer (%s).",
+				libusb_error_name (rc));
+			if (i == 0) {
+				status = syserror (rc);
+				goto out;
+			}
+			break;
+		}
+		transfer->submitted = 1;
+	}
+
+	// Wait for the oldest transfer to complete, so the reports are
+	// delivered in order.
+	dc_usbhid_transfer_t *current = &usbhid->transfers[usbhid->head];
+	while (!current->completed) {
+		int rc = libusb_handle_events_completed (usbhid->ctx, &current->completed);
+		if (rc != LIBUSB_SUCCESS) {
+			ERROR (usbhid->context, "Failed to handle the usb events (%s).",
+				libusb_error_name (rc));
+			status = syserror (rc);
+			goto out;
+		}
+	}
+	current->submitted = 0;
+	usbhid->head = (usbhid->head + 1) % NTRANSFERS;
+
+	switch (current->transfer->status) {
+	case LIBUSB_TRANSFER_COMPLETED:
+		break;
+	case LIBUSB_TRANSFER_TIMED_OUT:
+		usbhid->metrics.timeouts++;
+		usbhid->metrics.stalltime += usbhid->timeout;
+		status = DC_STATUS_TIMEOUT;
 		goto out;
+	case LIBUSB_TRANSFER_NO_DEVICE:
+		ERROR (usbhid->context, "Usb read interrupt transfer failed (no device).");
+		status = DC_STATUS_NODEVICE;
+		goto out;
+	default:
+		ERROR (usbhid->context, "Usb read interrupt transfer failed (%i).",
+			current->transfer->status);
+		status = DC_STATUS_IO;
+		goto out;
+	}
+
+	// Copy the report to the caller.
+	nbytes = current->transfer->actual_length;
+	if ((size_t) nbytes > size) {
+		WARNING (usbhid->context, "Truncated the report (%i bytes) to the buffer size (%lu bytes).",
+			nbytes, (unsigned long) size);
+		nbytes = size;
 	}
+	memcpy (data, current->buffer, nbytes);
+	usbhid->metrics.rbytes += nbytes;
 #elif defined(HAVE_HIDAPI)
 	nbytes = hid_read_timeout(usbhid->handle, data, size, usbhid->timeout);
 	if (nbytes < 0) {
 		ERROR (usbhid->context, "Usb read interrupt transfer failed.");
 		status = DC_STATUS_IO;
 		goto out;
+	} else if (nbytes == 0) {
+		usbhid->metrics.timeouts++;
+		if (usbhid->timeout > 0)
+			usbhid->metrics.stalltime += usbhid->timeout;
 	}
+	usbhid->metrics.rbytes += nbytes;
 #endif
 
 out:
@@ -408,6 +552,8 @@ dc_usbhid_write (dc_usbhid_t *usbhid, const void *data, size_t size, size_t *act
 	}
 #endif
 
+	usbhid->metrics.wbytes += nbytes;
+
 out:
 	HEXDUMP (usbhid->context, DC_LOGLEVEL_INFO, "Write", (unsigned char *) data, nbytes);
 
@@ -420,3 +566,18 @@ out_invalidargs:
 	return DC_STATUS_UNSUPPORTED;
 #endif
 }
+
+dc_status_t
+dc_usbhid_get_metrics (dc_usbhid_t *usbhid, dc_event_metrics_t *metrics)
+{
+#ifdef USBHID
+	if (usbhid == NULL || metrics == NULL)
+		return DC_STATUS_INVALIDARGS;
+
+	*metrics = usbhid->metrics;
+
+	return DC_STATUS_SUCCESS;
+#else
+	return DC_STATUS_UNSUPPORTED;
+#endif
+}
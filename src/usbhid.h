@@ -24,6 +24,7 @@
 
 #include <libdivecomputer/common.h>
 #include <libdivecomputer/context.h>
+#include <libdivecomputer/device.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -116,6 +117,20 @@ dc_usbhid_read (dc_usbhid_t *usbhid, void *data, size_t size, size_t *actual);
 dc_status_t
 dc_usbhid_write (dc_usbhid_t *usbhid, const void *data, size_t size, size_t *actual);
 
+/**
+ * Query the transfer statistics of the connection.
+ *
+ * The retries field is not known to the transport layer, and is left
+ * zero.
+ *
+ * @param[in]   usbhid   A valid USB HID connection.
+ * @param[out]  metrics  A location to store the transfer statistics.
+ * @returns #DC_STATUS_SUCCESS on success, or another #dc_status_t code
+ * on failure.
+ */
+dc_status_t
+dc_usbhid_get_metrics (dc_usbhid_t *usbhid, dc_event_metrics_t *metrics);
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
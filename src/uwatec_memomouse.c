@@ -51,7 +51,7 @@ static dc_status_t uwatec_memomouse_device_dump (dc_device_t *abstract, dc_buffe
 static dc_status_t uwatec_memomouse_device_foreach (dc_device_t *abstract, dc_dive_callback_t callback, void *userdata);
 static dc_status_t uwatec_memomouse_device_close (dc_device_t *abstract);
 
-static const dc_device_vtable_t uwatec_memomouse_device_vtable = {
+DC_VTABLE_STORAGE const dc_device_vtable_t uwatec_memomouse_device_vtable = {
 	sizeof(uwatec_memomouse_device_t),
 	DC_FAMILY_UWATEC_MEMOMOUSE,
 	uwatec_memomouse_device_set_fingerprint, /* set_fingerprint */
@@ -92,6 +92,9 @@ uwatec_memomouse_device_open (dc_device_t **out, dc_context_t *context, const ch
 		goto error_free;
 	}
 
+	// Forward cancellation requests to the serial layer.
+	dc_serial_set_cancel (device->port, device_cancel_cb, device);
+
 	// Set the serial communication protocol (9600 8N1).
 	status = dc_serial_configure (device->port, 9600, 8, DC_PARITY_NONE, DC_STOPBITS_ONE, DC_FLOWCONTROL_NONE);
 	if (status != DC_STATUS_SUCCESS) {
@@ -383,9 +386,15 @@ uwatec_memomouse_dump_internal (uwatec_memomouse_device_t *device, dc_buffer_t *
 	dc_serial_sleep (device->port, 50);
 
 	// Keep send the command to the device,
-	// until the ACK answer is received.
+	// until the ACK answer is received. The device answers with NAK
+	// while it is not yet ready, so this loop is only bounded when a
+	// retry limit has been configured with dc_device_set_retry.
+	unsigned int nretries = 0;
 	unsigned char answer = NAK;
 	while (answer == NAK) {
+		// Abort if the maximum number of retries is reached.
+		if (nretries++ > device_retry_limit (abstract, (unsigned int) -1))
+			return DC_STATUS_PROTOCOL;
 		// Flush the input buffer.
 		dc_serial_purge (device->port, DC_DIRECTION_INPUT);
 
@@ -410,13 +419,19 @@ uwatec_memomouse_dump_internal (uwatec_memomouse_device_t *device, dc_buffer_t *
 		return DC_STATUS_PROTOCOL;
 	}
 
-	// Wait for the data packet.
+	// Wait for the data packet. Back off exponentially while nothing
+	// arrives, to save power on the long waits for user action; a
+	// dc_device_wake restarts the fast polling immediately.
+	unsigned int interval = 100;
 	while (dc_serial_get_available (device->port, &available) == DC_STATUS_SUCCESS && available == 0) {
 		if (device_is_cancelled (abstract))
 			return DC_STATUS_CANCELLED;
 
 		device_event_emit (&device->base, DC_EVENT_WAITING, NULL);
-		dc_serial_sleep (device->port, 100);
+		if (device_sleep_while_waiting (&device->base, interval))
+			interval = 100;
+		else if (interval < 1600)
+			interval *= 2;
 	}
 
 	// Fetch the current system time.
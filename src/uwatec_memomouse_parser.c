@@ -43,7 +43,7 @@ static dc_status_t uwatec_memomouse_parser_get_datetime (dc_parser_t *abstract,
 static dc_status_t uwatec_memomouse_parser_get_field (dc_parser_t *abstract, dc_field_type_t type, unsigned int flags, void *value);
 static dc_status_t uwatec_memomouse_parser_samples_foreach (dc_parser_t *abstract, dc_sample_callback_t callback, void *userdata);
 
-static const dc_parser_vtable_t uwatec_memomouse_parser_vtable = {
+DC_VTABLE_STORAGE const dc_parser_vtable_t uwatec_memomouse_parser_vtable = {
 	sizeof(uwatec_memomouse_parser_t),
 	DC_FAMILY_UWATEC_MEMOMOUSE,
 	uwatec_memomouse_parser_set_data, /* set_data */
@@ -233,7 +233,7 @@ uwatec_memomouse_parser_samples_foreach (dc_parser_t *abstract, dc_sample_callba
 		if (callback) callback (DC_SAMPLE_TIME, sample, userdata);
 
 		// Depth (meters)
-		sample.depth = depth * 10.0 / 64.0;
+		sample.depth = array_scale (depth, 10, 64);
 		if (callback) callback (DC_SAMPLE_DEPTH, sample, userdata);
 
 		// Gas change.
@@ -49,7 +49,7 @@ static dc_status_t uwatec_meridian_device_dump (dc_device_t *abstract, dc_buffer
 static dc_status_t uwatec_meridian_device_foreach (dc_device_t *abstract, dc_dive_callback_t callback, void *userdata);
 static dc_status_t uwatec_meridian_device_close (dc_device_t *abstract);
 
-static const dc_device_vtable_t uwatec_meridian_device_vtable = {
+DC_VTABLE_STORAGE const dc_device_vtable_t uwatec_meridian_device_vtable = {
 	sizeof(uwatec_meridian_device_t),
 	DC_FAMILY_UWATEC_MERIDIAN,
 	uwatec_meridian_device_set_fingerprint, /* set_fingerprint */
@@ -209,6 +209,9 @@ uwatec_meridian_device_open (dc_device_t **out, dc_context_t *context, const cha
 		goto error_free;
 	}
 
+	// Forward cancellation requests to the serial layer.
+	dc_serial_set_cancel (device->port, device_cancel_cb, device);
+
 	// Set the serial communication protocol (57600 8N1).
 	status = dc_serial_configure (device->port, 57600, 8, DC_PARITY_NONE, DC_STOPBITS_ONE, DC_FLOWCONTROL_NONE);
 	if (status != DC_STATUS_SUCCESS) {
@@ -45,7 +45,7 @@ static dc_status_t uwatec_smart_device_dump (dc_device_t *abstract, dc_buffer_t
 static dc_status_t uwatec_smart_device_foreach (dc_device_t *abstract, dc_dive_callback_t callback, void *userdata);
 static dc_status_t uwatec_smart_device_close (dc_device_t *abstract);
 
-static const dc_device_vtable_t uwatec_smart_device_vtable = {
+DC_VTABLE_STORAGE const dc_device_vtable_t uwatec_smart_device_vtable = {
 	sizeof(uwatec_smart_device_t),
 	DC_FAMILY_UWATEC_SMART,
 	uwatec_smart_device_set_fingerprint, /* set_fingerprint */
@@ -211,6 +211,12 @@ uwatec_smart_device_close (dc_device_t *abstract)
 	uwatec_smart_device_t *device = (uwatec_smart_device_t*) abstract;
 	dc_status_t rc = DC_STATUS_SUCCESS;
 
+	// Emit the transfer statistics of the session.
+	dc_event_metrics_t metrics;
+	if (dc_irda_get_metrics (device->socket, &metrics) == DC_STATUS_SUCCESS) {
+		device_event_emit (abstract, DC_EVENT_METRICS, &metrics);
+	}
+
 	// Close the device.
 	rc = dc_irda_close (device->socket);
 	if (status != DC_STATUS_SUCCESS) {
@@ -238,18 +244,57 @@ uwatec_smart_device_set_fingerprint (dc_device_t *abstract, const unsigned char
 }
 
 
+static void
+uwatec_smart_resume_position (const unsigned char data[], unsigned int size, unsigned int *position, unsigned int *timestamp)
+{
+	const unsigned char header[4] = {0xa5, 0xa5, 0x5a, 0x5a};
+
+	// Walk the complete dive records in the partial data. The device
+	// streams the dives oldest first, as adjacent records starting with
+	// a header marker, so the partial data contains a whole number of
+	// complete dives, followed by a truncated one. The walk stops at
+	// the first record that is truncated or misaligned.
+	unsigned int offset = 0;
+	while (offset + 12 <= size && memcmp (data + offset, header, sizeof (header)) == 0) {
+		unsigned int len = array_uint32_le (data + offset + 4);
+		if (len < 12 || len > size - offset)
+			break;
+
+		*position = offset + len;
+		*timestamp = array_uint32_le (data + offset + 8);
+
+		offset += len;
+	}
+}
+
+
 static dc_status_t
 uwatec_smart_device_dump (dc_device_t *abstract, dc_buffer_t *buffer)
 {
 	uwatec_smart_device_t *device = (uwatec_smart_device_t*) abstract;
 	dc_status_t rc = DC_STATUS_SUCCESS;
 
+	abstract->dump_position = 0;
+
 	// Erase the current contents of the buffer.
 	if (!dc_buffer_clear (buffer)) {
 		ERROR (abstract->context, "Insufficient buffer space available.");
 		return DC_STATUS_NOMEMORY;
 	}
 
+	// Resume an interrupted transfer from the partial data of a
+	// previous attempt, see dc_device_dump_resume. The protocol has no
+	// addressable reads: the device streams all the dives newer than
+	// the requested timestamp. But since each complete dive in the
+	// partial data is a verified unit, the transfer can be resumed at
+	// the last dive boundary, by requesting only the dives newer than
+	// the newest complete dive.
+	unsigned int skip = 0;
+	unsigned int timestamp = device->timestamp;
+	if (abstract->resume_data) {
+		uwatec_smart_resume_position (abstract->resume_data, abstract->resume_size, &skip, &timestamp);
+	}
+
 	// Enable progress notifications.
 	dc_event_progress_t progress = EVENT_PROGRESS_INITIALIZER;
 	device_event_emit (&device->base, DC_EVENT_PROGRESS, &progress);
@@ -298,10 +343,10 @@ uwatec_smart_device_dump (dc_device_t *abstract, dc_buffer_t *buffer)
 
 	// Command template.
 	unsigned char command[9] = {0x00,
-			(device->timestamp      ) & 0xFF,
-			(device->timestamp >> 8 ) & 0xFF,
-			(device->timestamp >> 16) & 0xFF,
-			(device->timestamp >> 24) & 0xFF,
+			(timestamp      ) & 0xFF,
+			(timestamp >> 8 ) & 0xFF,
+			(timestamp >> 16) & 0xFF,
+			(timestamp >> 24) & 0xFF,
 			0x10,
 			0x27,
 			0,
@@ -321,17 +366,26 @@ uwatec_smart_device_dump (dc_device_t *abstract, dc_buffer_t *buffer)
 	progress.current += 4;
 	device_event_emit (&device->base, DC_EVENT_PROGRESS, &progress);
 
-  	if (length == 0)
+  	if (length == 0 && skip == 0)
 		return DC_STATUS_SUCCESS;
 
 	// Allocate the required amount of memory.
-	if (!dc_buffer_resize (buffer, length)) {
+	if (!dc_buffer_resize (buffer, skip + length)) {
 		ERROR (abstract->context, "Insufficient buffer space available.");
 		return DC_STATUS_NOMEMORY;
 	}
 
 	unsigned char *data = dc_buffer_get_data (buffer);
 
+	// Copy the verified dives from the previous attempt.
+	if (skip) {
+		memcpy (data, abstract->resume_data, skip);
+		abstract->dump_position = skip;
+	}
+
+	if (length == 0)
+		return DC_STATUS_SUCCESS;
+
 	// Data.
 	command[0] = 0xC4;
 	rc = uwatec_smart_transfer (device, command, sizeof (command), answer, sizeof (answer));
@@ -364,7 +418,7 @@ uwatec_smart_device_dump (dc_device_t *abstract, dc_buffer_t *buffer)
 		if (nbytes + len > length)
 			len = length - nbytes;
 
-		rc = dc_irda_read (device->socket, data + nbytes, len, NULL);
+		rc = dc_irda_read (device->socket, data + skip + nbytes, len, NULL);
 		if (rc != DC_STATUS_SUCCESS) {
 			ERROR (abstract->context, "Failed to receive the answer.");
 			return rc;
@@ -375,6 +429,18 @@ uwatec_smart_device_dump (dc_device_t *abstract, dc_buffer_t *buffer)
 		device_event_emit (&device->base, DC_EVENT_PROGRESS, &progress);
 
 		nbytes += len;
+		abstract->dump_position = skip + nbytes;
+	}
+
+	// Spot check the resumed transfer: the new data must start at a
+	// dive boundary. A mismatch indicates the device contents changed
+	// since the previous attempt, or the stream lost its alignment.
+	const unsigned char header[4] = {0xa5, 0xa5, 0x5a, 0x5a};
+	if (skip && length >= sizeof (header) &&
+		memcmp (data + skip, header, sizeof (header)) != 0) {
+		ERROR (abstract->context, "Resumed data is misaligned.");
+		abstract->dump_position = 0;
+		return DC_STATUS_PROTOCOL;
 	}
 
 	return DC_STATUS_SUCCESS;
@@ -142,6 +142,8 @@ struct uwatec_smart_parser_t {
 	unsigned int nsamples;
 	const uwatec_smart_event_info_t *events[NEVENTS];
 	unsigned int nevents[NEVENTS];
+	// Precompiled decode tables, see uwatec_smart_parser_compile.
+	unsigned char idtable[256];
 	// Cached fields.
 	unsigned int cached;
 	unsigned int trimix;
@@ -153,12 +155,13 @@ struct uwatec_smart_parser_t {
 	dc_divemode_t divemode;
 };
 
+static void uwatec_smart_parser_compile (uwatec_smart_parser_t *parser);
 static dc_status_t uwatec_smart_parser_set_data (dc_parser_t *abstract, const unsigned char *data, unsigned int size);
 static dc_status_t uwatec_smart_parser_get_datetime (dc_parser_t *abstract, dc_datetime_t *datetime);
 static dc_status_t uwatec_smart_parser_get_field (dc_parser_t *abstract, dc_field_type_t type, unsigned int flags, void *value);
 static dc_status_t uwatec_smart_parser_samples_foreach (dc_parser_t *abstract, dc_sample_callback_t callback, void *userdata);
 
-static const dc_parser_vtable_t uwatec_smart_parser_vtable = {
+DC_VTABLE_STORAGE const dc_parser_vtable_t uwatec_smart_parser_vtable = {
 	sizeof(uwatec_smart_parser_t),
 	DC_FAMILY_UWATEC_SMART,
 	uwatec_smart_parser_set_data, /* set_data */
@@ -634,6 +637,9 @@ uwatec_smart_parser_create (dc_parser_t **out, dc_context_t *context, unsigned i
 		goto error_free;
 	}
 
+	// Precompile the sample decode tables for this model.
+	uwatec_smart_parser_compile (parser);
+
 	parser->cached = 0;
 	parser->trimix = 0;
 	parser->ngasmixes = 0;
@@ -849,6 +855,32 @@ uwatec_galileo_identify (unsigned char value)
 }
 
 
+static void
+uwatec_smart_parser_compile (uwatec_smart_parser_t *parser)
+{
+	int galileo = (parser->model == GALILEO || parser->model == GALILEOTRIMIX ||
+		parser->model == ALADIN2G || parser->model == MERIDIAN ||
+		parser->model == CHROMIS || parser->model == MANTIS2);
+
+	// Precompute the sample identification for every possible value of
+	// the first type byte, so the decode loop dispatches with a single
+	// table lookup per sample. In the Smart encoding, a first byte with
+	// all type bits set continues into the next byte. Those values are
+	// marked with an invalid entry, and fall back to the generic bit
+	// scan at decode time.
+	for (unsigned int value = 0; value < 256; ++value) {
+		unsigned int id = 0;
+		if (galileo) {
+			id = uwatec_galileo_identify (value);
+		} else {
+			unsigned char byte = value;
+			id = uwatec_smart_identify (&byte, 1);
+		}
+		parser->idtable[value] = (id < 0xFF ? id : 0xFF);
+	}
+}
+
+
 static unsigned int
 uwatec_smart_fixsignbit (unsigned int x, unsigned int n)
 {
@@ -888,16 +920,6 @@ uwatec_smart_parser_samples_foreach (dc_parser_t *abstract, dc_sample_callback_t
 		header = 0xB1;
 	}
 
-	// Get the maximum number of alarm bytes.
-	unsigned int nalarms = 0;
-	for (unsigned int i = 0; i < entries; ++i) {
-		if (table[i].type == ALARMS &&
-			table[i].index >= nalarms)
-		{
-			nalarms = table[i].index + 1;
-		}
-	}
-
 	int complete = 0;
 	int calibrated = 0;
 
@@ -929,15 +951,11 @@ uwatec_smart_parser_samples_foreach (dc_parser_t *abstract, dc_sample_callback_t
 	while (offset < size) {
 		dc_sample_value_t sample = {0};
 
-		// Process the type bits in the bitstream.
-		unsigned int id = 0;
-		if (parser->model == GALILEO || parser->model == GALILEOTRIMIX ||
-			parser->model == ALADIN2G || parser->model == MERIDIAN ||
-			parser->model == CHROMIS || parser->model == MANTIS2) {
-			// Uwatec Galileo
-			id = uwatec_galileo_identify (data[offset]);
-		} else {
-			// Uwatec Smart
+		// Process the type bits in the bitstream, using the precompiled
+		// identification table for the first type byte.
+		unsigned int id = parser->idtable[data[offset]];
+		if (id == 0xFF) {
+			// The type bits continue into the next byte(s).
 			id = uwatec_smart_identify (data + offset, size - offset);
 		}
 		if (id >= entries) {
@@ -988,8 +1006,8 @@ uwatec_smart_parser_samples_foreach (dc_parser_t *abstract, dc_sample_callback_t
 		const uwatec_smart_event_info_t *events = NULL;
 		switch (table[id].type) {
 		case PRESSURE_DEPTH:
-			pressure += ((signed char) ((svalue >> NBITS) & 0xFF)) / 4.0;
-			depth += ((signed char) (svalue & 0xFF)) / 50.0;
+			pressure += array_scale ((signed char) ((svalue >> NBITS) & 0xFF), 1, 4);
+			depth += array_scale ((signed char) (svalue & 0xFF), 1, 50);
 			complete = 1;
 			break;
 		case RBT:
@@ -1002,25 +1020,25 @@ uwatec_smart_parser_samples_foreach (dc_parser_t *abstract, dc_sample_callback_t
 			break;
 		case TEMPERATURE:
 			if (table[id].absolute) {
-				temperature = svalue / 2.5;
+				temperature = array_scale (svalue, 1, 2.5);
 				have_temperature = 1;
 			} else {
-				temperature += svalue / 2.5;
+				temperature += array_scale (svalue, 1, 2.5);
 			}
 			break;
 		case PRESSURE:
 			if (table[id].absolute) {
 				if (parser->trimix) {
 					tank = (value & 0xF000) >> 12;
-					pressure = (value & 0x0FFF) / 4.0;
+					pressure = array_scale (value & 0x0FFF, 1, 4);
 				} else {
 					tank = table[id].index;
-					pressure = value / 4.0;
+					pressure = array_scale (value, 1, 4);
 				}
 				have_pressure = 1;
 				gasmix = tank;
 			} else {
-				pressure += svalue / 4.0;
+				pressure += array_scale (svalue, 1, 4);
 			}
 			break;
 		case DEPTH:
@@ -38,6 +38,8 @@
 #define SZ_MEMORY 0x8000
 #define SZ_PACKET 64
 
+#define MAXRETRIES 2
+
 #define RB_PROFILE_BEGIN  0x3FA0
 #define RB_PROFILE_END    0x7EC0
 
@@ -57,7 +59,7 @@ static dc_status_t zeagle_n2ition3_device_dump (dc_device_t *abstract, dc_buffer
 static dc_status_t zeagle_n2ition3_device_foreach (dc_device_t *abstract, dc_dive_callback_t callback, void *userdata);
 static dc_status_t zeagle_n2ition3_device_close (dc_device_t *abstract);
 
-static const dc_device_vtable_t zeagle_n2ition3_device_vtable = {
+DC_VTABLE_STORAGE const dc_device_vtable_t zeagle_n2ition3_device_vtable = {
 	sizeof(zeagle_n2ition3_device_t),
 	DC_FAMILY_ZEAGLE_N2ITION3,
 	zeagle_n2ition3_device_set_fingerprint, /* set_fingerprint */
@@ -123,13 +125,37 @@ zeagle_n2ition3_packet (zeagle_n2ition3_device_t *device, const unsigned char co
 	return DC_STATUS_SUCCESS;
 }
 
+static dc_status_t
+zeagle_n2ition3_transfer (zeagle_n2ition3_device_t *device, const unsigned char command[], unsigned int csize, unsigned char answer[], unsigned int asize)
+{
+	dc_device_t *abstract = (dc_device_t *) device;
+	unsigned int nretries = 0;
+	dc_status_t rc = DC_STATUS_SUCCESS;
+	while ((rc = zeagle_n2ition3_packet (device, command, csize, answer, asize)) != DC_STATUS_SUCCESS) {
+		// Automatically discard a corrupted packet,
+		// and request a new one. The commands address the memory
+		// explicitly, so requesting the same packet again is safe.
+		if (rc != DC_STATUS_PROTOCOL && rc != DC_STATUS_TIMEOUT)
+			return rc;
+
+		// Abort if the maximum number of retries is reached.
+		if (nretries++ >= device_retry_limit (abstract, MAXRETRIES))
+			return rc;
+
+		// Discard any garbage bytes.
+		dc_serial_purge (device->port, DC_DIRECTION_INPUT);
+	}
+
+	return rc;
+}
+
 static dc_status_t
 zeagle_n2ition3_init (zeagle_n2ition3_device_t *device)
 {
 	unsigned char answer[6 + 13] = {0};
 	unsigned char command[6] = {0x02, 0x01, 0x00, 0x41, 0xBF, 0x03};
 
-	return zeagle_n2ition3_packet (device, command, sizeof (command), answer, sizeof (answer));
+	return zeagle_n2ition3_transfer (device, command, sizeof (command), answer, sizeof (answer));
 }
 
 dc_status_t
@@ -159,6 +185,9 @@ zeagle_n2ition3_device_open (dc_device_t **out, dc_context_t *context, const cha
 		goto error_free;
 	}
 
+	// Forward cancellation requests to the serial layer.
+	dc_serial_set_cancel (device->port, device_cancel_cb, device);
+
 	// Set the serial communication protocol (4800 8N1).
 	status = dc_serial_configure (device->port, 4800, 8, DC_PARITY_NONE, DC_STOPBITS_ONE, DC_FLOWCONTROL_NONE);
 	if (status != DC_STATUS_SUCCESS) {
@@ -179,6 +208,10 @@ zeagle_n2ition3_device_open (dc_device_t **out, dc_context_t *context, const cha
 	// Send the init commands.
 	zeagle_n2ition3_init (device);
 
+	// Pre-size the scratch region for the transfer loops. Not fatal
+	// on failure: a later push grows the region on demand.
+	device_scratch_reserve ((dc_device_t *) device, 13 + SZ_PACKET + 6);
+
 	*out = (dc_device_t *) device;
 
 	return DC_STATUS_SUCCESS;
@@ -230,6 +263,11 @@ zeagle_n2ition3_device_read (dc_device_t *abstract, unsigned int address, unsign
 {
 	zeagle_n2ition3_device_t *device = (zeagle_n2ition3_device_t*) abstract;
 
+	// The answer buffer is reused for every packet.
+	unsigned char *answer = device_scratch_push (abstract, 13 + SZ_PACKET + 6);
+	if (answer == NULL)
+		return DC_STATUS_NOMEMORY;
+
 	unsigned int nbytes = 0;
 	while (nbytes < size) {
 		// Calculate the package size.
@@ -238,16 +276,17 @@ zeagle_n2ition3_device_read (dc_device_t *abstract, unsigned int address, unsign
 			len = SZ_PACKET;
 
 		// Read the package.
-		unsigned char answer[13 + SZ_PACKET + 6] = {0};
 		unsigned char command[13] = {0x02, 0x08, 0x00, 0x4D,
 				(address     ) & 0xFF, // low
 				(address >> 8) & 0xFF, // high
 				len, // count
 				0x00, 0x00, 0x00, 0x00, 0x00, 0x03};
 		command[11] = ~checksum_add_uint8 (command + 3, 8, 0x00) + 1;
-		dc_status_t rc = zeagle_n2ition3_packet (device, command, sizeof (command), answer, 13 + len + 6);
-		if (rc != DC_STATUS_SUCCESS)
+		dc_status_t rc = zeagle_n2ition3_transfer (device, command, sizeof (command), answer, 13 + len + 6);
+		if (rc != DC_STATUS_SUCCESS) {
+			device_scratch_pop (abstract, 13 + SZ_PACKET + 6);
 			return rc;
+		}
 
 		memcpy (data, answer + 17, len);
 
@@ -256,6 +295,8 @@ zeagle_n2ition3_device_read (dc_device_t *abstract, unsigned int address, unsign
 		data += len;
 	}
 
+	device_scratch_pop (abstract, 13 + SZ_PACKET + 6);
+
 	return DC_STATUS_SUCCESS;
 }
 